@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) 2026 Kolibri-FC contributors
+ *
+ * This file is part of Kolibri-FC (https://github.com/bastian2001/Kolibri-FC).
+ *
+ * Kolibri-FC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Kolibri-FC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Windowed download of blackbox logs (BB_FILE_STREAM), see bbFileStream() in Firmware/src/blackbox.h
+import { CmdErrorTypes, onCommandHandler, removeCommandHandler, sendCommand } from "@/msp/comm"
+import { MspFn } from "@/msp/protocol"
+import { Command } from "@utils/types"
+import { intToLeBytes, leBytesToInt } from "@utils/utils"
+
+const BbStream = {
+	START: 0,
+	ACK: 1,
+	STOP: 2,
+	DATA: 3,
+	DONE: 4,
+}
+
+const WINDOW = 16 // chunks in flight, the FC allows up to 32
+const ACK_EVERY = 4 // received chunks between two ACKs
+const IDLE_ACK_MS = 150 // ACK again (with the missing chunks) if nothing arrived for this long
+const NACK_REPEAT_MS = 600 // a missing chunk is requested again at most this often
+const MAX_NACKS = 16
+const DONE_WAIT_MS = 1000 // everything arrived, but DONE got lost
+const STALL_MS = 5000
+
+/** thrown by streamLog() if the FC does not know BB_FILE_STREAM, BB_FILE_DOWNLOAD has to be used instead */
+export const BB_STREAM_UNSUPPORTED = "BB_FILE_STREAM not supported"
+
+export type BbStreamStats = {
+	bytesSent: number // including retransmits
+	durationMs: number
+	throughput: number // bytes/s
+	retransmits: number
+}
+
+/**
+ * Downloads a byte range of a log. The FC keeps up to WINDOW chunks in flight, lost chunks are requested again by their index
+ * @param logNum log number
+ * @param start first byte
+ * @param length number of bytes, 0 = until the end of the file
+ * @returns the data and the statistics of the FC (undefined if the final report got lost)
+ */
+export function streamLog(
+	logNum: number,
+	start = 0,
+	length = 0,
+	onProgress?: (received: number, total: number) => void,
+): Promise<{ data: Uint8Array; stats?: BbStreamStats }> {
+	return new Promise((resolve, reject) => {
+		let started = false
+		let chunkSize = 0
+		let chunkCount = 0
+		let data = new Uint8Array()
+		const received: boolean[] = []
+		const nackedAt: number[] = []
+		let receivedCount = 0
+		let contiguous = 0 // all chunks below this index are there
+		let sinceAck = 0
+		let lastData = Date.now()
+		let done = false
+
+		const finish = (error?: string, stats?: BbStreamStats) => {
+			if (done) return
+			done = true
+			removeCommandHandler(handler)
+			clearInterval(idleInterval)
+			if (error !== undefined) reject(error)
+			else resolve({ data, stats })
+		}
+		const abort = (error: string) => {
+			sendCommand(MspFn.BB_FILE_STREAM, { data: [BbStream.STOP], retries: 0 }).catch(() => {})
+			finish(error)
+		}
+
+		const sendAck = () => {
+			sinceAck = 0
+			const now = Date.now()
+			const nacks: number[] = []
+			for (let i = contiguous; i < received.length && nacks.length < MAX_NACKS; i++) {
+				if (received[i] || now - (nackedAt[i] ?? 0) < NACK_REPEAT_MS) continue
+				nackedAt[i] = now
+				nacks.push(...intToLeBytes(i, 4))
+			}
+			// the FC does not answer an ACK, the next chunks are the answer
+			sendCommand(MspFn.BB_FILE_STREAM, {
+				data: [BbStream.ACK, ...intToLeBytes(contiguous, 4), nacks.length / 4, ...nacks],
+				retries: 0,
+				verifyFn: (req, res) => req.command === res.command && res.cmdType === "response" && res.data[0] !== BbStream.START,
+			}).catch(() => {})
+		}
+
+		// registered before START goes out: the first chunks can arrive in the same read as the START response
+		const handler = (c: Command) => {
+			if (c.command !== MspFn.BB_FILE_STREAM) return
+			if (c.cmdType === "error") {
+				if (started) abort(c.dataStr) // errors before the START response are handled below
+				return
+			}
+			if (c.cmdType !== "response" || leBytesToInt(c.data, 1, 2) !== logNum) return
+			switch (c.data[0]) {
+				case BbStream.START:
+					if (started) return // answer to a repeated START
+					started = true
+					data = new Uint8Array(leBytesToInt(c.data, 7, 4))
+					chunkSize = leBytesToInt(c.data, 11, 4)
+					chunkCount = leBytesToInt(c.data, 15, 4)
+					lastData = Date.now()
+					onProgress?.(0, data.length)
+					if (!chunkCount) sendAck()
+					break
+				case BbStream.DATA: {
+					// chunks in front of the START response are left over from an earlier stream
+					if (!started) return
+					const chunk = leBytesToInt(c.data, 3, 4)
+					lastData = Date.now()
+					if (chunk >= chunkCount || received[chunk]) return
+					data.set(c.data.subarray(7, 7 + chunkSize), chunk * chunkSize)
+					received[chunk] = true
+					receivedCount++
+					while (received[contiguous]) contiguous++
+					onProgress?.(Math.min(receivedCount * chunkSize, data.length), data.length)
+					if (contiguous === chunkCount || ++sinceAck >= ACK_EVERY) sendAck()
+					break
+				}
+				case BbStream.DONE:
+					if (!started || contiguous < chunkCount) return
+					finish(undefined, {
+						bytesSent: leBytesToInt(c.data, 3, 4),
+						durationMs: leBytesToInt(c.data, 7, 4),
+						throughput: leBytesToInt(c.data, 11, 4),
+						retransmits: leBytesToInt(c.data, 15, 4),
+					})
+					break
+			}
+		}
+		onCommandHandler(handler, false)
+
+		const idleInterval = setInterval(() => {
+			if (!started) return
+			const idle = Date.now() - lastData
+			if (contiguous === chunkCount && idle > DONE_WAIT_MS) finish()
+			else if (idle > STALL_MS) abort("Blackbox download stalled")
+			else if (idle > IDLE_ACK_MS) sendAck()
+		}, IDLE_ACK_MS)
+
+		sendCommand(MspFn.BB_FILE_STREAM, {
+			data: [BbStream.START, ...intToLeBytes(logNum, 2), ...intToLeBytes(start, 4), ...intToLeBytes(length, 4), WINDOW],
+			verifyFn: (req, res) => req.command === res.command && (res.cmdType === "error" || res.data[0] === BbStream.START),
+		})
+			.then(c => {
+				if (c.cmdType !== "error") return
+				// firmware without BB_FILE_STREAM answers with the error of the MSP command registry
+				finish(c.dataStr === "Unknown command" ? BB_STREAM_UNSUPPORTED : c.dataStr)
+			})
+			.catch(er => {
+				// older firmware does not answer unknown commands at all
+				finish(er === CmdErrorTypes.TIMEOUT ? BB_STREAM_UNSUPPORTED : er)
+			})
+	})
+}
@@ -81,11 +81,13 @@ const setCommand = (cmd: Command) => {
 export function onCommandHandler(handler: (command: Command) => void, destroy = true) {
 	commandHandlers.push(handler)
 
-	if (destroy)
-		onBeforeUnmount(() => {
-			const i = commandHandlers.indexOf(handler)
-			if (i > -1) commandHandlers.splice(i, 1)
-		})
+	if (destroy) onBeforeUnmount(() => removeCommandHandler(handler))
+}
+
+/** removes a handler that was added with onCommandHandler(handler, false) */
+export function removeCommandHandler(handler: (command: Command) => void) {
+	const i = commandHandlers.indexOf(handler)
+	if (i > -1) commandHandlers.splice(i, 1)
 }
 
 onCommandHandler((c: Command) => {
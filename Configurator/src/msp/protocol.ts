@@ -55,6 +55,12 @@ export const MspFn = {
 	STATUS: 0x4000,
 	CONFIGURATOR_PING: 0x4001,
 	IND_MESSAGE: 0x4002,
+	GET_MSP_COMMANDS: 0x4003,
+	STREAM_SUBSCRIBE: 0x4004,
+	TRANSFER_BEGIN: 0x4005,
+	TRANSFER_READ: 0x4006,
+	TRANSFER_WRITE: 0x4007,
+	TRANSFER_FINISH: 0x4008,
 
 	// 0x401_ Entering special modes
 	SERIAL_PASSTHROUGH: 0x4010,
@@ -70,10 +76,7 @@ export const MspFn = {
 	// 0x410_ Settings Meta commands
 	SAVE_SETTINGS: 0x4100,
 
-	// 0x411_ OSD settings
-	WRITE_OSD_FONT_CHARACTER: 0x4110,
-	GET_OSD_ELEMENTS: 0x4111,
-	SET_OSD_ELEMENTS: 0x4112,
+	// 0x411_ OSD settings (font and elements: segmented transfer, MspObject)
 	GET_OSD_CONFIG: 0x4113,
 	SET_OSD_CONFIG: 0x4114,
 	OSD_CONTROL: 0x4115,
@@ -91,6 +94,8 @@ export const MspFn = {
 	BB_FAST_FILE_INIT: 0x4128,
 	BB_FAST_DATA_REQ: 0x4129,
 	BB_CLOSE_FILE: 0x412a,
+	BB_FILE_STREAM: 0x412b,
+	BB_STORAGE_HEALTH: 0x412c,
 
 	// 0x413_ GPS
 	GET_GPS_STATUS: 0x4130,
@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2026 Kolibri-FC contributors
+ *
+ * This file is part of Kolibri-FC (https://github.com/bastian2001/Kolibri-FC).
+ *
+ * Kolibri-FC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Kolibri-FC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Live data that the FC pushes on its own (STREAM_SUBSCRIBE), see Firmware/src/serialhandler/mspStream.h
+import { CmdErrorTypes, onCommandHandler, onConnectHandler, sendCommand } from "@/msp/comm"
+import { MspFn } from "@/msp/protocol"
+import { Command } from "@utils/types"
+import { intToLeBytes, leBytesToInt } from "@utils/utils"
+import { onBeforeUnmount } from "vue"
+
+const MAX_SUBSCRIPTIONS = 16 // MSP_STREAM_MAX of the FC
+const WATCHDOG_MS = 1000
+
+type Subscription = {
+	fn: number
+	intervalMs: number
+	granted: number // interval the FC accepted, 0 = polled
+	lastSeen: number
+	pollInterval: number
+}
+
+const subscriptions: Subscription[] = []
+let updateTimeout = -1
+let supported = true // false once the FC did not know STREAM_SUBSCRIBE, until the next connect
+
+function startPolling(s: Subscription) {
+	if (s.pollInterval !== -1) return
+	s.pollInterval = setInterval(() => {
+		sendCommand(s.fn).catch(() => {})
+	}, s.intervalMs)
+}
+
+function stopPolling(s: Subscription) {
+	clearInterval(s.pollInterval)
+	s.pollInterval = -1
+}
+
+// the FC replaces all subscriptions of the port with every STREAM_SUBSCRIBE, so changes are collected and sent as one set
+function scheduleUpdate() {
+	clearTimeout(updateTimeout)
+	updateTimeout = setTimeout(sendSubscriptions, 0)
+}
+
+async function sendSubscriptions() {
+	const wanted = new Map<number, number>()
+	if (supported)
+		for (const s of subscriptions) wanted.set(s.fn, Math.min(wanted.get(s.fn) ?? s.intervalMs, s.intervalMs))
+	const data: number[] = []
+	for (const [fn, intervalMs] of [...wanted].slice(0, MAX_SUBSCRIPTIONS))
+		data.push(...intToLeBytes(fn, 2), ...intToLeBytes(intervalMs, 2))
+	const granted = new Map<number, number>()
+	try {
+		if (supported) {
+			const c = await sendCommand(MspFn.STREAM_SUBSCRIBE, data)
+			// older firmware does not know the command
+			if (c.cmdType === "error") supported = false
+			else for (let i = 0; i + 4 <= c.length; i += 4) granted.set(leBytesToInt(c.data, i, 2), leBytesToInt(c.data, i + 2, 2))
+		}
+	} catch (er) {
+		if (er === CmdErrorTypes.NOT_CONNECTED || er === CmdErrorTypes.CMD_DISABLED) return // sent again on connect
+	}
+	const now = Date.now()
+	for (const s of subscriptions) {
+		s.granted = granted.get(s.fn) ?? 0
+		s.lastSeen = now
+		if (s.granted) stopPolling(s)
+		else startPolling(s)
+	}
+}
+
+// subscriptions end on the FC when it hears nothing from the host for a second, e.g. while the configurator was busy
+setInterval(() => {
+	const now = Date.now()
+	if (subscriptions.some(s => s.granted && now - s.lastSeen > Math.max(3 * s.granted, WATCHDOG_MS))) scheduleUpdate()
+}, WATCHDOG_MS)
+
+/**
+ * Calls handler with every response of fn, at intervalMs, for as long as the calling component is mounted.
+ *
+ * The FC pushes the responses if it supports subscriptions and accepts fn, otherwise fn is polled at the same interval
+ * @param fn MspFn.xxx, has to be read-only without request payload (MSP_CMD_STREAM on the FC)
+ * @param intervalMs requested interval, the FC sends no faster than every 5 ms
+ */
+export function subscribeCommand(fn: number, intervalMs: number, handler: (command: Command) => void) {
+	const s: Subscription = { fn, intervalMs, granted: 0, lastSeen: Date.now(), pollInterval: -1 }
+	subscriptions.push(s)
+	onCommandHandler(c => {
+		if (c.cmdType !== "response" || c.command !== fn) return
+		s.lastSeen = Date.now()
+		handler(c)
+	})
+	onConnectHandler(() => {
+		supported = true
+		scheduleUpdate()
+	})
+	onBeforeUnmount(() => {
+		stopPolling(s)
+		const i = subscriptions.indexOf(s)
+		if (i > -1) subscriptions.splice(i, 1)
+		scheduleUpdate()
+	})
+	scheduleUpdate()
+}
@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2026 Kolibri-FC contributors
+ * 
+ * This file is part of Kolibri-FC (https://github.com/bastian2001/Kolibri-FC).
+ * 
+ * Kolibri-FC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * Kolibri-FC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Segmented transfers of objects that don't fit into one MSP frame, see Firmware/src/serialhandler/mspTransfer.h
+import { sendCommand } from "@/msp/comm"
+import { MspFn } from "@/msp/protocol"
+import { intToLeBytes, leBytesToInt } from "@utils/utils"
+
+export const MspObject = {
+	OSD_ELEMENTS: 0,
+	OSD_FONT: 1,
+}
+
+export const TransferStatus = {
+	OK: 0,
+	BUSY: 1,
+	UNKNOWN_OBJECT: 2,
+	NOT_SUPPORTED: 3,
+	ARMED: 4,
+	TOO_LARGE: 5,
+	NO_SESSION: 6,
+	OFFSET: 7,
+	INCOMPLETE: 8,
+	CRC: 9,
+	REJECTED: 10,
+}
+const statusNames = Object.fromEntries(Object.entries(TransferStatus).map(([k, v]) => [v, k]))
+
+const CHUNK_SIZE = 1024 // stays below the 2048 byte MSP buffer of the FC with some margin for other traffic
+const MAX_CRC_RESTARTS = 2
+
+const crcTable = (() => {
+	const t = new Uint32Array(256)
+	for (let i = 0; i < 256; i++) {
+		let c = i
+		for (let j = 0; j < 8; j++) c = c & 1 ? (c >>> 1) ^ 0xedb88320 : c >>> 1
+		t[i] = c >>> 0
+	}
+	return t
+})()
+
+/** CRC32 (IEEE 802.3, as in zlib) */
+export function crc32(data: number[] | Uint8Array): number {
+	let c = 0xffffffff
+	for (let i = 0; i < data.length; i++) c = crcTable[(c ^ data[i]) & 0xff] ^ (c >>> 8)
+	return (c ^ 0xffffffff) >>> 0
+}
+
+function checkStatus(status: number) {
+	if (status !== TransferStatus.OK) throw "Transfer failed: " + (statusNames[status] ?? status)
+}
+
+/**
+ * Reads a whole object. Lost chunks are just read again (sendCommand retries), the CRC32 of the snapshot checks the result
+ */
+export async function downloadObject(object: number, onProgress?: (done: number, total: number) => void): Promise<number[]> {
+	const begin = await sendCommand(MspFn.TRANSFER_BEGIN, [object, 0])
+	checkStatus(begin.data[0])
+	const session = begin.data[1]
+	const len = leBytesToInt(begin.data, 2, 4)
+	const crc = leBytesToInt(begin.data, 6, 4)
+	const data: number[] = []
+	while (data.length < len) {
+		const offset = data.length
+		const res = await sendCommand(MspFn.TRANSFER_READ, {
+			data: [session, ...intToLeBytes(offset, 4), ...intToLeBytes(CHUNK_SIZE, 2)],
+			verifyFn: (req, res) =>
+				req.command === res.command && res.data[1] === session && leBytesToInt(res.data, 2, 4) === offset,
+		})
+		checkStatus(res.data[0])
+		if (res.length <= 6) throw "Transfer failed: no data"
+		data.push(...res.data.slice(6))
+		onProgress?.(data.length, len)
+	}
+	await sendCommand(MspFn.TRANSFER_FINISH, [session]).catch(() => {})
+	if (crc32(data) !== crc) throw "Transfer failed: CRC"
+	return data
+}
+
+/**
+ * Writes a whole object. Continues where the FC says it stands after every chunk, so lost frames only cost a repeat.
+ * The FC checks the CRC32 before it applies anything, slow objects (font) report their progress while being applied
+ */
+export async function uploadObject(
+	object: number,
+	data: number[] | Uint8Array,
+	onProgress?: (sent: number, applied: number, total: number) => void,
+): Promise<void> {
+	const len = data.length
+	const begin = await sendCommand(MspFn.TRANSFER_BEGIN, [object, 1, ...intToLeBytes(len, 4), ...intToLeBytes(crc32(data), 4)])
+	checkStatus(begin.data[0])
+	const session = begin.data[1]
+	let restarts = 0
+	let pos = 0
+	while (true) {
+		while (pos < len) {
+			const offset = pos
+			const res = await sendCommand(MspFn.TRANSFER_WRITE, {
+				data: [session, ...intToLeBytes(offset, 4), ...Array.from(data.slice(offset, offset + CHUNK_SIZE))],
+				verifyFn: (req, res) => req.command === res.command && res.data[1] === session,
+			})
+			// OFFSET: a write got lost, continue where the FC is
+			if (res.data[0] !== TransferStatus.OFFSET) checkStatus(res.data[0])
+			pos = leBytesToInt(res.data, 2, 4)
+			onProgress?.(pos, 0, len)
+		}
+		const fin = await sendCommand(MspFn.TRANSFER_FINISH, [session])
+		if (fin.data[0] === TransferStatus.CRC && restarts++ < MAX_CRC_RESTARTS) {
+			pos = 0
+			continue
+		}
+		let status = fin.data[0]
+		while (status === TransferStatus.BUSY) {
+			const res = await sendCommand(MspFn.TRANSFER_FINISH, [session])
+			status = res.data[0]
+			onProgress?.(len, leBytesToInt(res.data, 2, 4), len)
+		}
+		checkStatus(status)
+		onProgress?.(len, len, len)
+		return
+	}
+}
@@ -43,6 +43,7 @@ export type SerialPort = {
 		type: number
 		resolution: number
 	}
+	inverted: boolean
 }
 export const SERIAL_TYPE_LUT: { [key in SerialType]: string } = {
 	usb: "USB",
@@ -211,6 +212,7 @@ export const usePortStore = defineStore("port", () => {
 					txPin: tx,
 					type: type,
 					mspDp: { type: 0, resolution: 0 },
+					inverted: false,
 				}
 				serials.value.forEach(s => {
 					if (s.type === "pio" || s.type === "pio-hdx") s.hwParam = 0xff
@@ -236,6 +238,7 @@ export const usePortStore = defineStore("port", () => {
 			const s = serials.value[serialNum]
 			s.baud = 115200
 			s.baudSet = 0
+			s.inverted = false
 			s.exists = true
 			s.functions = 0
 			s.hwParam = serialNum
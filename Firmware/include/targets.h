@@ -73,7 +73,7 @@
 
 #define BLACKBOX_STORAGE SD_BB
 
-#define I2C_MAG i2c0 // I2C for magnetometer
+#define I2C_SENSORS i2c0 // I2C bus for baro, mag and other sensors on PIN_SDA0/PIN_SCL0
 
 #define SPI_OSD spi1 // SPI for OSD
 
@@ -130,7 +130,7 @@ inline constexpr char pinLabels[30][6]{"T0", "R0", "", "", "", "", "", "", "T1",
 #define PIN_DCDC_EN 28
 
 #define BLACKBOX_STORAGE FLASH_BB
-#define I2C_MAG i2c0 // I2C for magnetometer
+#define I2C_SENSORS i2c0 // I2C bus for baro, mag and other sensors on PIN_SDA0/PIN_SCL0
 #define SPI_OSD spi1 // SPI for OSD
 #define SPI_GYRO spi0
 
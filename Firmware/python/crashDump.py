@@ -0,0 +1,144 @@
+# Copyright (c) 2026 Kolibri-FC contributors
+#
+# This file is part of Kolibri-FC (https://github.com/bastian2001/Kolibri-FC).
+#
+# Kolibri-FC is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# Kolibri-FC is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
+
+"""Symbolizes a crash dump (MSP GET_CRASH_DUMP, saved by the configurator as crashdump.bin) against the firmware ELF.
+
+Usage: python python/crashDump.py crashdump.bin [--elf .pio/build/koli6/firmware.elf] [--addr2line PATH]
+
+The layout is CrashDump from src/crashDump.h. Stack words that point into flash or RAM code are
+possible return addresses, the list is a stack scan and may contain stale entries.
+"""
+
+import argparse
+import re
+import shutil
+import struct
+import subprocess
+import sys
+from pathlib import Path
+
+FIRMWARE_DIR = Path(__file__).resolve().parent.parent
+DUMP_VERSION = 1
+STACK_WORDS = 48
+CORE_FORMAT = "<13I5IBBH%dI" % STACK_WORDS
+HEADER_FORMAT = "<IBBBB5II32s8s"
+DUMP_SIZE = 612
+REASONS = ["none", "hard fault", "watchdog (stalled loop)", "watchdog reset without dump", "assertion failed"]
+CFSR_BITS = {
+    0: "IACCVIOL", 1: "DACCVIOL", 3: "MUNSTKERR", 4: "MSTKERR", 5: "MLSPERR", 7: "MMARVALID",
+    8: "IBUSERR", 9: "PRECISERR", 10: "IMPRECISERR", 11: "UNSTKERR", 12: "STKERR", 13: "LSPERR", 15: "BFARVALID",
+    16: "UNDEFINSTR", 17: "INVSTATE", 18: "INVPC", 19: "NOCP", 20: "STKOF (stack overflow)", 24: "UNALIGNED", 25: "DIVBYZERO",
+}
+
+
+def task_names():
+    """Tasks enum from taskManager.h, index -> name"""
+    text = (FIRMWARE_DIR / "src" / "taskManager.h").read_text()
+    body = re.search(r"enum Tasks \{(.*?)\};", text, re.S).group(1)
+    return re.findall(r"(TASK_\w+)", body)
+
+
+def is_code(addr):
+    # flash (XIP) and RAM, both only with the thumb bit for return addresses
+    return (0x10000000 <= addr < 0x11000000 or 0x20000000 <= addr < 0x20082000) and addr & 1
+
+
+def find_addr2line(path):
+    if path:
+        return path
+    found = shutil.which("arm-none-eabi-addr2line")
+    if found:
+        return found
+    for candidate in (Path.home() / ".platformio" / "packages").glob("toolchain-*/bin/arm-none-eabi-addr2line*"):
+        return str(candidate)
+    return None
+
+
+def symbolize(addr2line, elf, addrs):
+    if not addr2line or not elf or not addrs:
+        return {}
+    out = subprocess.run([addr2line, "-f", "-C", "-e", str(elf)] + ["0x%08x" % a for a in addrs],
+                         capture_output=True, text=True, check=True).stdout.splitlines()
+    return {a: "%s at %s" % (out[i * 2], out[i * 2 + 1]) for i, a in enumerate(addrs)}
+
+
+def load(path):
+    data = Path(path).read_bytes()
+    if len(data) != DUMP_SIZE:
+        # console output of the configurator: a list of decimal numbers
+        data = bytes(int(n) for n in re.findall(r"\d+", data.decode(errors="ignore")))
+    if len(data) != DUMP_SIZE:
+        sys.exit("expected %d bytes, got %d" % (DUMP_SIZE, len(data)))
+    return data
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Symbolize a Kolibri crash dump")
+    parser.add_argument("dump")
+    parser.add_argument("--elf", default=None, help="firmware.elf of the build that crashed")
+    parser.add_argument("--addr2line", default=None)
+    args = parser.parse_args()
+
+    data = load(args.dump)
+    header_size = struct.calcsize(HEADER_FORMAT)
+    core_size = struct.calcsize(CORE_FORMAT)
+    (magic, version, reason, core, armed, uptime, cfsr, hfsr, mmfar, bfar, assert_line, assert_file, git_hash) = struct.unpack_from(HEADER_FORMAT, data)
+    if version != DUMP_VERSION:
+        sys.exit("unsupported dump version %d" % version)
+    tasks = task_names()
+    elf = args.elf
+    if not elf:
+        builds = sorted((FIRMWARE_DIR / ".pio" / "build").glob("*/firmware.elf"), key=lambda p: p.stat().st_mtime)
+        elf = builds[-1] if builds else None
+    addr2line = find_addr2line(args.addr2line)
+
+    print("Reason:   %s on core %d" % (REASONS[reason] if reason < len(REASONS) else reason, core))
+    print("Firmware: %s" % git_hash.rstrip(b"\0").decode())
+    print("Uptime:   %.3f s, %s" % (uptime / 1000, "armed" if armed else "disarmed"))
+    if reason == 4:
+        print("Assert:   %s:%d" % (assert_file.rstrip(b"\0").decode(), assert_line))
+    if reason == 1:
+        flags = [name for bit, name in CFSR_BITS.items() if cfsr & (1 << bit)]
+        print("CFSR:     0x%08x %s" % (cfsr, " ".join(flags)))
+        print("HFSR:     0x%08x, MMFAR 0x%08x, BFAR 0x%08x" % (hfsr, mmfar, bfar))
+    if not elf or not addr2line:
+        print("(no ELF or addr2line found, addresses are not symbolized)")
+
+    for c in range(2):
+        fields = struct.unpack_from(CORE_FORMAT, data, header_size + c * core_size)
+        regs = fields[:13]
+        sp, lr, pc, xpsr, exc_return, valid, task, stack_words = fields[13:21]
+        stack = fields[21:21 + stack_words]
+        print("\nCore %d%s" % (c, "" if valid else ": no state (did not respond)"))
+        if not valid:
+            continue
+        print("  task %s" % (tasks[task] if task < len(tasks) else "none"))
+        for i in range(0, 13, 4):
+            print("  " + "  ".join("r%-2d %08x" % (i + j, regs[i + j]) for j in range(4) if i + j < 13))
+        print("  sp  %08x  lr  %08x  pc  %08x  xpsr %08x  exc_return %08x" % (sp, lr, pc, xpsr, exc_return))
+        # return addresses point behind the call, -1 for the thumb bit and one more byte to land on the call itself
+        calls = [w - 2 for w in stack if is_code(w)]
+        syms = symbolize(addr2line, elf, [pc, lr - 2 if is_code(lr) else lr] + calls)
+        print("  pc: %s" % syms.get(pc, "%08x" % pc))
+        print("  lr: %s" % syms.get(lr - 2 if is_code(lr) else lr, "%08x" % lr))
+        print("  stack scan:")
+        for a in calls:
+            print("    %08x %s" % (a, syms.get(a, "")))
+
+
+if __name__ == "__main__":
+    main()
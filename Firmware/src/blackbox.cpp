@@ -38,7 +38,17 @@ static FILE_CLASS blackboxFile;
 #define BLACKBOX_CRSF_CHUNK_SIZE 480
 #define BLACKBOX_MSPV1_CHUNK_SIZE 230
 
-#define BLACKBOX_WRITE_BUFFER_SIZE 8192
+#if BLACKBOX_STORAGE == SD_BB
+#define BLACKBOX_WRITE_BLOCK_SIZE 4096 // 8 sectors per write, clusters are always a multiple of this
+#define BLACKBOX_WRITE_BUFFER_SIZE 16384 // must be a multiple of BLACKBOX_WRITE_BLOCK_SIZE
+#define BLACKBOX_PREALLOC_SIZE (256ULL * 1024 * 1024) // contiguous extent that is reserved when logging starts
+#define BLACKBOX_PREALLOC_MIN_SIZE (16ULL * 1024 * 1024) // halve the extent until this size if the card has no larger free extent
+#elif BLACKBOX_STORAGE == FLASH_BB
+#define BLACKBOX_WRITE_BLOCK_SIZE 512 // one flash sector
+#define BLACKBOX_FLASH_MIN_FREE_BLOCKS 64 // 8 MiB, with bbKeepLogs set, old logs are deleted until a free extent of this size exists
+#define BLACKBOX_WRITE_BUFFER_SIZE 16384 // must be a multiple of BLACKBOX_WRITE_BLOCK_SIZE, absorbs block erases that run in the background
+#endif
+#define BLACKBOX_WRITE_BUFFER_OVERHANG 512 // one blackboxLoop() pass may write past the end of the ring, see wrapWriteBuffer()
 
 u64 bbFlags = 0;
 static volatile u64 currentBBFlags = 0;
@@ -48,6 +58,7 @@ volatile bool fsReady = false;
 
 u8 bbFreqDivider = 2;
 u8 bbSyncFreq = 100;
+u8 bbKeepLogs = 0;
 
 u32 bbDebug1, bbDebug2;
 u16 bbDebug3, bbDebug4;
@@ -90,13 +101,77 @@ static BbPrintConfig bbPrintLog = {
 	.logNum = 0,
 };
 
+#define BLACKBOX_STREAM_MAX_WINDOW 32 // maximum number of sent but unacknowledged chunks
+#define BLACKBOX_STREAM_ACK_TIMEOUT 300 // ms without an ACK until the oldest unacknowledged chunk is sent again
+#define BLACKBOX_STREAM_CHUNKS_PER_LOOP 4 // maximum number of chunks sent per blackboxLoop() pass
+
+typedef struct bbStreamBuffer {
+	i32 chunk; // chunk index held by this buffer, -1 if empty
+	u32 len; // net data length
+	u8 data[BLACKBOX_CHUNK_SIZE + 7]; // 7 bytes header: sub command, log number, chunk index
+} BbStreamBuffer;
+
+typedef struct bbStreamConfig {
+	bool active;
+	u32 startPos; // first byte of the requested range
+	u32 endPos; // first byte after the requested range
+	u32 chunkSize;
+	u32 chunkCount;
+	u32 nextChunk; // next chunk that has never been sent
+	u32 ackedChunks; // all chunks below this index were confirmed by the host
+	u8 window; // maximum number of sent, but unacknowledged chunks
+	u32 bytesSent; // including retransmits
+	u32 retransmitCount;
+	elapsedMillis sinceAck;
+	elapsedMillis duration;
+	BbStreamBuffer buffers[2]; // double buffer: one chunk is read from the file while the previous one is transmitted
+} BbStreamConfig;
+static BbStreamConfig bbStream = {
+	.active = false,
+	.buffers = {{.chunk = -1}, {.chunk = -1}},
+};
+static RingBuffer<u32> bbStreamRetransmits(BLACKBOX_STREAM_MAX_WINDOW);
+
+typedef struct bbSummarySample {
+	i16 gyro[3]; // deg/s
+	i16 maxITerm; // largest absolute I term of all axes
+	u16 frameInterval; // us since the previous frame
+	u8 motorSaturated; // 1 if any motor is at full throttle
+	u8 inFlight; // 1 if the throttle is above idle
+} BbSummarySample;
+#define BB_FRAME_ALLOC_SIZE 128 // 8 bytes header + max. 113 bytes frame, BbSummarySample follows after this
+
+// accumulated on core 0 in blackboxLoop(), written into the header by endLogging()
+typedef struct bbSummary {
+	u16 maxGyro[3];
+	u32 saturatedFrames;
+	u16 minVbat;
+	u64 vbatSum;
+	u32 vbatCount;
+	u64 intervalSum;
+	u64 intervalSqSum;
+	u32 droppedFrames;
+	u16 peakITerm;
+	u64 flightTimeUs;
+	u32 frames;
+} BbSummary;
+static BbSummary bbSummary;
+static volatile u32 bbDroppedFramesCore1 = 0; // frames that could not even be handed over to core 0
+static elapsedMicros bbSummaryFrametime;
+
 static elapsedMillis bbDuration;
 
 static i32 bbFrameNum = 0;
 static elapsedMicros frametime;
-static u8 bbWriteBuffer[BLACKBOX_WRITE_BUFFER_SIZE];
-static u32 bbWriteBufferPos = 0;
-#define BB_WR_BUF_HAS_FREE(bytes) ((bytes) < BLACKBOX_WRITE_BUFFER_SIZE - bbWriteBufferPos)
+static u8 bbWriteBuffer[BLACKBOX_WRITE_BUFFER_SIZE + BLACKBOX_WRITE_BUFFER_OVERHANG]; // ring buffer, the overhang is folded back by wrapWriteBuffer()
+static u32 bbWriteBufferPos = 0; // write head of the ring buffer
+static u32 bbWriteBufferTail = 0; // next byte that goes to the file. Always congruent to the file position modulo BLACKBOX_WRITE_BLOCK_SIZE
+static inline u32 bbWriteBufferUsed() {
+	if (bbWriteBufferPos >= bbWriteBufferTail)
+		return bbWriteBufferPos - bbWriteBufferTail;
+	return bbWriteBufferPos + BLACKBOX_WRITE_BUFFER_SIZE - bbWriteBufferTail;
+}
+#define BB_WR_BUF_HAS_FREE(bytes) ((bytes) < BLACKBOX_WRITE_BUFFER_SIZE - bbWriteBufferUsed() && bbWriteBufferPos + (bytes) <= BLACKBOX_WRITE_BUFFER_SIZE + BLACKBOX_WRITE_BUFFER_OVERHANG)
 static bool lastHighlightState = false;
 static FlightMode lastSavedFlightMode = FlightMode::LENGTH;
 static u32 writtenFrameNum = 0;
@@ -203,6 +278,92 @@ static size_t unescapeBytes(u8 *in, u8 *out, size_t inputLen, size_t outputLen,
 	return o++;
 }
 
+/**
+ * @brief folds bytes that were written into the overhang back to the start of the ring buffer
+ *
+ * @details Frames are always written linearly at bbWriteBufferPos, so they may run past BLACKBOX_WRITE_BUFFER_SIZE. This copies only those few bytes instead of moving the whole buffer.
+ */
+static void wrapWriteBuffer() {
+	if (bbWriteBufferPos < BLACKBOX_WRITE_BUFFER_SIZE) return;
+	bbWriteBufferPos -= BLACKBOX_WRITE_BUFFER_SIZE;
+	memcpy(bbWriteBuffer, bbWriteBuffer + BLACKBOX_WRITE_BUFFER_SIZE, bbWriteBufferPos);
+}
+
+/**
+ * @brief writes the next block from the ring buffer to the blackbox file
+ *
+ * @details Writes never cross a BLACKBOX_WRITE_BLOCK_SIZE boundary of the file, so that the SD card only sees whole, aligned multi-sector writes
+ *
+ * @param partial also write an incomplete block (used when logging ends)
+ * @return u32 number of bytes written, 0 if nothing was written or writing failed
+ */
+static u32 writeBlockToFile(bool partial) {
+	wrapWriteBuffer();
+	u32 used = bbWriteBufferUsed();
+	u32 len = BLACKBOX_WRITE_BLOCK_SIZE - bbWriteBufferTail % BLACKBOX_WRITE_BLOCK_SIZE;
+	if (len > used) {
+		if (!partial) return 0;
+		len = used;
+	}
+	if (!len) return 0;
+	if (!blackboxFile.write(bbWriteBuffer + bbWriteBufferTail, len)) return 0;
+	bbWriteBufferTail += len;
+	if (bbWriteBufferTail >= BLACKBOX_WRITE_BUFFER_SIZE) bbWriteBufferTail = 0;
+	return len;
+}
+
+static void accumulateSummary(const BbSummarySample &sample) {
+	for (int ax = 0; ax < 3; ax++) {
+		u16 rate = abs(sample.gyro[ax]);
+		if (rate > bbSummary.maxGyro[ax]) bbSummary.maxGyro[ax] = rate;
+	}
+	if (sample.maxITerm > bbSummary.peakITerm) bbSummary.peakITerm = sample.maxITerm;
+	bbSummary.saturatedFrames += sample.motorSaturated;
+	if (bbSummary.frames) {
+		// the first interval reaches back to the arming and is not a loop time
+		bbSummary.intervalSum += sample.frameInterval;
+		bbSummary.intervalSqSum += (u32)sample.frameInterval * sample.frameInterval;
+	}
+	if (sample.inFlight) bbSummary.flightTimeUs += sample.frameInterval;
+	u16 vbat = adcVoltage;
+	if (vbat) {
+		if (vbat < bbSummary.minVbat) bbSummary.minVbat = vbat;
+		bbSummary.vbatSum += vbat;
+		bbSummary.vbatCount++;
+	}
+	bbSummary.frames++;
+}
+
+static void getSummaryBlock(u8 block[LOG_HEAD_SUMMARY_SIZE]) {
+	memset(block, 0, LOG_HEAD_SUMMARY_SIZE);
+	block[LOG_SUMMARY_VERSION] = 1;
+	memcpy(&block[LOG_SUMMARY_MAX_GYRO], bbSummary.maxGyro, 6);
+	u16 sat = bbSummary.frames ? (u64)bbSummary.saturatedFrames * 10000 / bbSummary.frames : 0;
+	memcpy(&block[LOG_SUMMARY_MOTOR_SAT], &sat, 2);
+	u16 minVbat = bbSummary.vbatCount ? bbSummary.minVbat : 0;
+	u16 avgVbat = bbSummary.vbatCount ? bbSummary.vbatSum / bbSummary.vbatCount : 0;
+	memcpy(&block[LOG_SUMMARY_MIN_VBAT], &minVbat, 2);
+	memcpy(&block[LOG_SUMMARY_AVG_VBAT], &avgVbat, 2);
+	u32 intervals = bbSummary.frames > 1 ? bbSummary.frames - 1 : 0;
+	u16 avgLoop = 0, jitter = 0;
+	if (intervals && bbFreqDivider) {
+		// frame intervals are bbFreqDivider loops long
+		f64 mean = (f64)bbSummary.intervalSum / intervals;
+		f64 var = (f64)bbSummary.intervalSqSum / intervals - mean * mean;
+		if (var < 0) var = 0;
+		avgLoop = constrain(mean * 100 / bbFreqDivider, 0, 65535);
+		jitter = constrain(sqrt(var) * 100 / bbFreqDivider, 0, 65535);
+	}
+	memcpy(&block[LOG_SUMMARY_AVG_LOOP], &avgLoop, 2);
+	memcpy(&block[LOG_SUMMARY_LOOP_JITTER], &jitter, 2);
+	u32 dropped = bbSummary.droppedFrames + bbDroppedFramesCore1;
+	memcpy(&block[LOG_SUMMARY_DROPPED], &dropped, 4);
+	memcpy(&block[LOG_SUMMARY_PEAK_I], &bbSummary.peakITerm, 2);
+	u32 flightTime = bbSummary.flightTimeUs / 1000;
+	memcpy(&block[LOG_SUMMARY_FLIGHT_TIME], &flightTime, 4);
+	memcpy(&block[LOG_SUMMARY_FRAMES], &bbSummary.frames, 4);
+}
+
 static inline void writeFlightModeToBlackbox() {
 	FlightMode fm = flightMode;
 	bbWriteBuffer[bbWriteBufferPos++] = BB_FRAME_FLIGHTMODE;
@@ -253,33 +414,165 @@ static inline void writeElrsLinkToBlackbox() {
 	elrs->newLinkStatsFlag &= ~(1 << 0);
 }
 
+/**
+ * @brief reads a chunk of the streamed range into one of the stream buffers, unless it is already buffered
+ *
+ * @param chunk chunk index, relative to the start of the streamed range
+ * @return BbStreamBuffer* buffer that holds the chunk, nullptr if reading failed
+ */
+static BbStreamBuffer *bbStreamLoadChunk(u32 chunk) {
+	for (auto &b : bbStream.buffers) {
+		if (b.chunk == (i32)chunk) return &b;
+	}
+	BbStreamBuffer *b = &bbStream.buffers[0];
+	if (bbStream.buffers[0].chunk != -1) b = &bbStream.buffers[1];
+	u32 pos = bbStream.startPos + chunk * bbStream.chunkSize;
+	u32 len = bbStream.endPos - pos;
+	if (len > bbStream.chunkSize) len = bbStream.chunkSize;
+	if (!bbPrintLog.logFile.seek(pos)) return nullptr;
+	i32 bytesRead = bbPrintLog.logFile.read(b->data + 7, len);
+	if (bytesRead != (i32)len) return nullptr;
+	b->data[0] = BB_STREAM_DATA;
+	b->data[1] = bbPrintLog.logNum & 0xFF;
+	b->data[2] = bbPrintLog.logNum >> 8;
+	memcpy(&b->data[3], &chunk, 4);
+	b->chunk = chunk;
+	b->len = len;
+	return b;
+}
+
+/**
+ * @brief gets the chunk that is to be sent next: requested retransmits first, then new chunks within the window
+ *
+ * @param isRetransmit set to true if the chunk comes from the retransmit queue
+ * @return i32 chunk index, -1 if nothing can be sent right now
+ */
+static i32 bbStreamNextChunk(bool &isRetransmit) {
+	while (!bbStreamRetransmits.isEmpty()) {
+		u32 chunk = bbStreamRetransmits[0];
+		if (chunk >= bbStream.ackedChunks && chunk < bbStream.nextChunk) {
+			isRetransmit = true;
+			return chunk;
+		}
+		bbStreamRetransmits.pop(); // already acknowledged in the meantime
+	}
+	isRetransmit = false;
+	if (bbStream.nextChunk >= bbStream.chunkCount) return -1;
+	if (bbStream.nextChunk >= bbStream.ackedChunks + bbStream.window) return -1;
+	return bbStream.nextChunk;
+}
+
+static void bbStreamSendStats(MspMsgSetup &s, u8 subCmd) {
+	u8 b[19];
+	u32 duration = bbStream.duration;
+	u32 throughput = duration ? (u64)bbStream.bytesSent * 1000 / duration : 0;
+	b[0] = subCmd;
+	b[1] = bbPrintLog.logNum & 0xFF;
+	b[2] = bbPrintLog.logNum >> 8;
+	memcpy(&b[3], &bbStream.bytesSent, 4);
+	memcpy(&b[7], &duration, 4);
+	memcpy(&b[11], &throughput, 4);
+	memcpy(&b[15], &bbStream.retransmitCount, 4);
+	sendMsp(s, (char *)b, sizeof(b));
+}
+
+/// @brief sends the next chunks of a streaming download, called from blackboxLoop()
+static void bbStreamLoop() {
+	KoliSerial &serial = *bbPrintLog.serial;
+	MspMsgSetup s = {
+		.serial = serial,
+		.fn = MspFn::BB_FILE_STREAM,
+		.type = MspMsgType::RESPONSE,
+		.version = bbPrintLog.mspVer,
+	};
+
+	if (bbStream.ackedChunks >= bbStream.chunkCount) {
+		bbStreamSendStats(s, BB_STREAM_DONE);
+		bbStream.active = false;
+		return;
+	}
+
+	if (bbStream.sinceAck > BLACKBOX_STREAM_ACK_TIMEOUT) {
+		// host did not respond, the oldest chunk or its ACK was probably lost
+		bbStream.sinceAck = 0;
+		if (bbStream.ackedChunks < bbStream.nextChunk && !bbStreamRetransmits.isFull())
+			bbStreamRetransmits.push(bbStream.ackedChunks);
+	}
+
+	for (int i = 0; i < BLACKBOX_STREAM_CHUNKS_PER_LOOP; i++) {
+		bool isRetransmit = false;
+		i32 chunk = bbStreamNextChunk(isRetransmit);
+		if (chunk < 0) break;
+		if (serial.availableForWrite() < (i32)bbStream.chunkSize + 16) break; // never block on a full TX buffer
+		BbStreamBuffer *b = bbStreamLoadChunk(chunk);
+		if (b == nullptr) {
+			s.type = MspMsgType::ERROR;
+			sendMsp(s, "Error reading file", strlen("Error reading file"));
+			bbStream.active = false;
+			return;
+		}
+		sendMsp(s, (char *)b->data, b->len + 7);
+		bbStream.bytesSent += b->len;
+		b->chunk = -1;
+		if (isRetransmit) {
+			bbStreamRetransmits.pop();
+			bbStream.retransmitCount++;
+		} else {
+			bbStream.nextChunk++;
+		}
+	}
+	serial.loop(bbStream.chunkSize);
+
+	// read ahead while the USB/UART peripheral drains the TX buffer
+	for (u32 chunk = bbStream.nextChunk; chunk < bbStream.nextChunk + 2 && chunk < bbStream.chunkCount; chunk++) {
+		if (bbStream.buffers[0].chunk != -1 && bbStream.buffers[1].chunk != -1) break;
+		if (chunk >= bbStream.ackedChunks + bbStream.window) break;
+		bbStreamLoadChunk(chunk);
+	}
+}
+
 void blackboxLoop() {
 	if (!fsReady) return;
+#if BLACKBOX_STORAGE == FLASH_BB
+	bbFs.loop(); // poll the flash chip, start the next queued program/erase
+#endif
 	if (!bbLogging) {
-		if (bbPrintLog.printing) {
+		if (bbStream.active) {
+			TASK_START(TASK_CONFIGURATOR);
+			bbStreamLoop();
+			TASK_END(TASK_CONFIGURATOR);
+		} else if (bbPrintLog.printing) {
 			TASK_START(TASK_CONFIGURATOR);
 
-			u8 buffer[bbPrintLog.chunkSize + 6];
-			buffer[0] = bbPrintLog.logNum & 0xFF;
-			buffer[1] = bbPrintLog.logNum >> 8;
-			buffer[2] = bbPrintLog.currentChunk & 0xFF;
-			buffer[3] = bbPrintLog.currentChunk >> 8;
-			buffer[4] = bbPrintLog.currentChunk >> 16;
-			buffer[5] = bbPrintLog.currentChunk >> 24;
-			bbPrintLog.logFile.seek(bbPrintLog.currentChunk * bbPrintLog.chunkSize);
-			u32 bytesRead = bbPrintLog.logFile.read(buffer + 6, bbPrintLog.chunkSize);
-			if (bytesRead <= 0) {
-				bbStopPrinting();
-				TASK_END(TASK_CONFIGURATOR);
-				return;
-			}
 			MspMsgSetup s = {
 				.serial = *bbPrintLog.serial,
 				.fn = MspFn::BB_FILE_DOWNLOAD,
 				.type = MspMsgType::RESPONSE,
 				.version = bbPrintLog.mspVer,
 			};
-			sendMsp(s, (char *)buffer, bytesRead + 6);
+			bbPrintLog.logFile.seek(bbPrintLog.currentChunk * bbPrintLog.chunkSize);
+			MspResponse res(s);
+			res.put16(bbPrintLog.logNum);
+			res.put32(bbPrintLog.currentChunk);
+			// the file is read straight into the TX buffer, in two parts if it wraps
+			u32 bytesRead = 0;
+			while (bytesRead < bbPrintLog.chunkSize) {
+				u32 len = bbPrintLog.chunkSize - bytesRead;
+				u8 *p = res.space(&len);
+				if (p == nullptr) break;
+				i32 r = bbPrintLog.logFile.read(p, len);
+				if (r <= 0) break;
+				res.advance(r);
+				bytesRead += r;
+				if ((u32)r < len) break; // end of file
+			}
+			if (!bytesRead) {
+				res.discard();
+				bbStopPrinting();
+				TASK_END(TASK_CONFIGURATOR);
+				return;
+			}
+			res.finish();
 			bbPrintLog.currentChunk++;
 			bbPrintLog.serial->flush();
 
@@ -297,7 +590,7 @@ void blackboxLoop() {
 		size_t spaceNeeded = (len + (needsSync ? 10 : 1)) * 4 / 3;
 		if (BB_WR_BUF_HAS_FREE(spaceNeeded)) {
 			if (needsSync) {
-				u32 thisSyncPos = blackboxFile.position() + bbWriteBufferPos;
+				u32 thisSyncPos = blackboxFile.position() + bbWriteBufferUsed();
 				memcpy(bbWriteBuffer + bbWriteBufferPos, "SYNC", 4);
 				bbWriteBufferPos += 4;
 				u8 buf[9];
@@ -311,6 +604,9 @@ void blackboxLoop() {
 			bbWriteBuffer[bbWriteBufferPos++] = BB_FRAME_NORMAL;
 			writeToBlackboxWithEscape(frame + 8, len);
 			writtenFrameNum++;
+			accumulateSummary(*(BbSummarySample *)(frame + BB_FRAME_ALLOC_SIZE));
+		} else {
+			bbSummary.droppedFrames++;
 		}
 		free(frame);
 	}
@@ -354,20 +650,22 @@ void blackboxLoop() {
 		writeElrsLinkToBlackbox();
 	}
 
-	// write buffer
-	if (bbWriteBufferPos) {
-		u16 writeBytes = bbWriteBufferPos;
-		if (writeBytes > 512) writeBytes = 512;
-		if (!blackboxFile.write(bbWriteBuffer, writeBytes)) {
+	// write one full block, if available
+	wrapWriteBuffer();
+	if (bbWriteBufferUsed() >= BLACKBOX_WRITE_BLOCK_SIZE - bbWriteBufferTail % BLACKBOX_WRITE_BLOCK_SIZE) {
+#if BLACKBOX_STORAGE == FLASH_BB
+		if (blackboxFile.availableForWrite() < BLACKBOX_WRITE_BLOCK_SIZE) {
+			// all page buffers are still queued, keep the data in the ring buffer instead of waiting for the chip
+			TASK_END(TASK_BLACKBOX_WRITE);
+			return;
+		}
+#endif
+		if (!writeBlockToFile(false)) {
 			fsReady = false;
 			bbLogging = false;
 			TASK_END(TASK_BLACKBOX_WRITE);
 			return;
 		}
-		bbWriteBufferPos -= writeBytes;
-		if (bbWriteBufferPos) {
-			memmove(bbWriteBuffer, bbWriteBuffer + writeBytes, bbWriteBufferPos);
-		}
 	}
 
 	TASK_END(TASK_BLACKBOX_WRITE);
@@ -377,6 +675,7 @@ void initBlackbox() {
 	addSetting(SETTING_BB_FLAGS, &bbFlags, 0b1111111111111111100000000000000011111111111ULL);
 	addSetting(SETTING_BB_DIV, &bbFreqDivider, 2);
 	addSetting(SETTING_BB_SYNC, &bbSyncFreq, 100);
+	addSetting(SETTING_BB_KEEP_LOGS, &bbKeepLogs, 0);
 
 #if BLACKBOX_STORAGE == SD_BB
 	SdioConfig sdConfig(PIN_SD_SCLK, PIN_SD_CMD, PIN_SD_DAT);
@@ -392,7 +691,10 @@ void initBlackbox() {
 	bool r = false;
 	bool chip = bbFs.begin(PIN_FLASH_IO_BASE, PIN_FLASH_SCLK, PIN_FLASH_CS, r);
 	fsReady = r;
-	if (!fsReady && chip) {
+	if (!fsReady && chip && bbFs.otherVersion) {
+		// the logs on it may still be wanted, BB_FILE_LIST tells the configurator, which asks before formatting
+		DEBUG_PRINTLN("FCKAFD of another version, not logging until formatted");
+	} else if (!fsReady && chip) {
 		DEBUG_PRINTLN("Broken FCKAFD, formatting");
 		fsReady = bbFs.format(0);
 	} else if (!chip) {
@@ -1218,8 +1520,103 @@ void printLogBin(KoliSerial &serial, MspVersion mspVer, u16 logNum, i32 singleCh
 	bbPrintLog.chunkSize = chunkSize;
 }
 
+void bbFileStream(KoliSerial &serial, MspVersion mspVer, u8 subCmd, const char *reqPayload, u16 reqLen) {
+	MspMsgSetup s = {
+		.serial = serial,
+		.fn = MspFn::BB_FILE_STREAM,
+		.type = MspMsgType::ERROR,
+		.version = mspVer,
+	};
+	if (!fsReady || bbLogging) {
+		sendMsp(s, "Cannot read blackbox during logging", strlen("Cannot read blackbox during logging"));
+		return;
+	}
+
+	switch (subCmd) {
+	case BB_STREAM_START: {
+		if (reqLen < 11)
+			return sendMsp(s, "Incorrect usage of stream start", strlen("Incorrect usage of stream start"));
+		u16 logNum = DECODE_U2((u8 *)reqPayload);
+		u32 startPos = DECODE_U4((u8 *)&reqPayload[2]);
+		u32 length = DECODE_U4((u8 *)&reqPayload[6]);
+		u8 window = reqPayload[10];
+		if (!openLogFileIfDiffNum(logNum))
+			return sendMsp(s, "File not found", strlen("File not found"));
+		bbStopPrinting();
+		u32 size = bbPrintLog.logFile.size();
+		if (startPos > size)
+			return sendMsp(s, "Start beyond end of file", strlen("Start beyond end of file"));
+		if (!length || length > size - startPos) length = size - startPos;
+		if (!window) window = 1;
+		if (window > BLACKBOX_STREAM_MAX_WINDOW) window = BLACKBOX_STREAM_MAX_WINDOW;
+
+		bbPrintLog.serial = &serial;
+		bbPrintLog.mspVer = mspVer;
+		bbStream.startPos = startPos;
+		bbStream.endPos = startPos + length;
+		bbStream.chunkSize = getBlackboxChunkSize(mspVer);
+		bbStream.chunkCount = (length + bbStream.chunkSize - 1) / bbStream.chunkSize;
+		bbStream.nextChunk = 0;
+		bbStream.ackedChunks = 0;
+		bbStream.window = window;
+		bbStream.bytesSent = 0;
+		bbStream.retransmitCount = 0;
+		bbStream.buffers[0].chunk = -1;
+		bbStream.buffers[1].chunk = -1;
+		bbStreamRetransmits.clear();
+
+		u8 b[20];
+		b[0] = subCmd;
+		b[1] = logNum & 0xFF;
+		b[2] = logNum >> 8;
+		memcpy(&b[3], &startPos, 4);
+		memcpy(&b[7], &length, 4);
+		memcpy(&b[11], &bbStream.chunkSize, 4);
+		memcpy(&b[15], &bbStream.chunkCount, 4);
+		b[19] = window;
+		s.type = MspMsgType::RESPONSE;
+		sendMsp(s, (char *)b, sizeof(b));
+
+		bbStream.sinceAck = 0;
+		bbStream.duration = 0;
+		bbStream.active = true;
+	} break;
+	case BB_STREAM_ACK: {
+		// no response, the next data chunks are the response
+		if (!bbStream.active || reqLen < 5) return;
+		u32 acked = DECODE_U4((u8 *)reqPayload);
+		if (acked > bbStream.nextChunk) acked = bbStream.nextChunk;
+		if (acked > bbStream.ackedChunks) bbStream.ackedChunks = acked;
+		u8 nackCount = reqPayload[4];
+		if (reqLen < 5 + nackCount * 4) nackCount = (reqLen - 5) / 4;
+		for (int i = 0; i < nackCount; i++) {
+			u32 chunk = DECODE_U4((u8 *)&reqPayload[5 + i * 4]);
+			if (chunk < bbStream.ackedChunks || chunk >= bbStream.nextChunk) continue;
+			bool queued = false;
+			for (u32 j = 0; j < bbStreamRetransmits.itemCount(); j++) {
+				if (bbStreamRetransmits[j] == chunk) {
+					queued = true;
+					break;
+				}
+			}
+			if (!queued && !bbStreamRetransmits.isFull()) bbStreamRetransmits.push(chunk);
+		}
+		bbStream.sinceAck = 0;
+	} break;
+	case BB_STREAM_STOP: {
+		s.type = MspMsgType::RESPONSE;
+		bbStreamSendStats(s, BB_STREAM_STOP);
+		bbStream.active = false;
+	} break;
+	default:
+		sendMsp(s, "invalid subCmd", strlen("invalid subCmd"));
+		break;
+	}
+}
+
 void bbStopPrinting() {
 	bbPrintLog.printing = false;
+	bbStream.active = false;
 }
 
 void bbClosePrintFile(KoliSerial &serial, MspVersion mspVer) {
@@ -1322,10 +1719,21 @@ void startLogging() {
 	snprintf(path, 32, "/blackbox/KOLI%04d.kbb", i + 1);
 	blackboxFile = bbFs.open(path, O_WRITE | O_CREAT);
 #elif BLACKBOX_STORAGE == FLASH_BB
+	if (bbKeepLogs) {
+		// make room for the new log: bbKeepLogs - 1 old logs at most, and a large enough free extent
+		bbFs.removeOldest(bbKeepLogs - 1, BLACKBOX_FLASH_MIN_FREE_BLOCKS);
+	}
 	blackboxFile = bbFs.open(bbFs.getNewBbFileNum(), O_WRITE | O_CREAT);
 #endif
 	if (!blackboxFile)
 		return;
+#if BLACKBOX_STORAGE == SD_BB
+	// reserve a contiguous extent now, so that no cluster has to be allocated during flight. The file is truncated to its real size in endLogging()
+	for (u64 prealloc = BLACKBOX_PREALLOC_SIZE; prealloc >= BLACKBOX_PREALLOC_MIN_SIZE; prealloc /= 2) {
+		rp2040.wdt_reset();
+		if (blackboxFile.preAllocate(prealloc)) break;
+	}
+#endif
 	const u8 data[] = {
 		0xDC, 0xDF, 0x4B, 0x4F, 0x4C, 0x49, 0x01, 0x00, 0x00, 0x00, 0x01 // magic bytes, version
 	};
@@ -1354,10 +1762,15 @@ void startLogging() {
 	while (blackboxFile.position() < LOG_DATA_START) {
 		blackboxFile.write((u8)0);
 	}
+	memset(&bbSummary, 0, sizeof(bbSummary));
+	bbSummary.minVbat = 0xFFFF;
+	bbDroppedFramesCore1 = 0;
 	bbDuration = 0;
 	bbFrameNum = 0;
 	writtenFrameNum = 0;
-	bbWriteBufferPos = 0;
+	// let the ring index match the file position, so that blocks never wrap around the end of the ring
+	bbWriteBufferPos = LOG_DATA_START % BLACKBOX_WRITE_BUFFER_SIZE;
+	bbWriteBufferTail = bbWriteBufferPos;
 	lastSyncPos = 0;
 	writeFlightModeToBlackbox();
 	if (currentBBFlags & LOG_GPS) writeGpsToBlackbox();
@@ -1366,6 +1779,7 @@ void startLogging() {
 	if (currentBBFlags & LOG_LINK_STATS) writeElrsLinkToBlackbox();
 	bbLogging = true;
 	frametime = 0;
+	bbSummaryFrametime = 0;
 }
 
 void endLogging(DisarmReason reason) {
@@ -1375,20 +1789,50 @@ void endLogging(DisarmReason reason) {
 	if (bbLogging) {
 		bbLogging = false;
 		u32 duration = bbDuration;
+		while (writeBlockToFile(true)) {
+			rp2040.wdt_reset();
+		}
+#if BLACKBOX_STORAGE == SD_BB
+		blackboxFile.truncate(blackboxFile.position()); // drop the unused part of the preallocated extent
+#endif
 		blackboxFile.seek(LOG_HEAD_DURATION);
 		blackboxFile.write((u8 *)&duration, 4);
 		blackboxFile.seek(LOG_HEAD_DISARM_REASON);
 		blackboxFile.write((u8)reason);
+		u8 summary[LOG_HEAD_SUMMARY_SIZE];
+		getSummaryBlock(summary);
+		blackboxFile.seek(LOG_HEAD_SUMMARY);
+		blackboxFile.write(summary, LOG_HEAD_SUMMARY_SIZE);
 		blackboxFile.close();
 	}
 }
 
+bool bbReadSummary(u16 logNum, u8 summary[LOG_HEAD_SUMMARY_SIZE]) {
+	memset(summary, 0, LOG_HEAD_SUMMARY_SIZE);
+#if BLACKBOX_STORAGE == SD_BB
+	char path[32];
+	snprintf(path, 32, "/blackbox/KOLI%04d.kbb", logNum);
+	FsFile logFile = bbFs.open(path);
+#elif BLACKBOX_STORAGE == FLASH_BB
+	FlashFile logFile = bbFs.open(logNum);
+#endif
+	if (!logFile) return false;
+	if (logFile.size() >= LOG_DATA_START) {
+		logFile.seek(LOG_HEAD_SUMMARY);
+		logFile.read(summary, LOG_HEAD_SUMMARY_SIZE);
+		if (summary[LOG_SUMMARY_VERSION] != 1) // unknown or missing summary
+			memset(summary, 0, LOG_HEAD_SUMMARY_SIZE);
+	}
+	logFile.close();
+	return true;
+}
+
 u32 writeSingleFrame() {
 	if (!fsReady || !bbLogging) {
 		return 0;
 	}
 	TASK_START(TASK_BLACKBOX);
-	u8 *bbBufferStart = (u8 *)aligned_alloc(4, 128);
+	u8 *bbBufferStart = (u8 *)aligned_alloc(4, BB_FRAME_ALLOC_SIZE + sizeof(BbSummarySample));
 	if (bbBufferStart == nullptr) return 0;
 	BlackboxPackPtr bbBuffer;
 	bbBuffer.u8p = bbBufferStart + 8; // 5 bytes + padding to a 4-alignment
@@ -1547,6 +1991,18 @@ u32 writeSingleFrame() {
 		*bbBuffer.u8p++ = val >> 16;
 	}
 
+	// values for the summary in the log header, evaluated on core 0
+	BbSummarySample *sample = (BbSummarySample *)(bbBufferStart + BB_FRAME_ALLOC_SIZE);
+	for (int ax = 0; ax < 3; ax++)
+		sample->gyro[ax] = constrain(gyroScaled[ax].geti32(), -32768, 32767);
+	i32 maxI = max(max(abs(rollI.geti32()), abs(pitchI.geti32())), abs(yawI.geti32()));
+	sample->maxITerm = maxI > 32767 ? 32767 : maxI;
+	u32 summaryFt = bbSummaryFrametime;
+	bbSummaryFrametime -= summaryFt;
+	sample->frameInterval = summaryFt > 65535 ? 65535 : summaryFt;
+	sample->motorSaturated = throttles[0] >= 2000 || throttles[1] >= 2000 || throttles[2] >= 2000 || throttles[3] >= 2000;
+	sample->inFlight = throttle.geti32() > idlePermille * 2 + 100;
+
 	bbBufferStart[3] = (bbBuffer.u8p - bbBufferStart) - 8;
 	memcpy(bbBufferStart + 4, &bbFrameNum, 4);
 	bbFrameNum++;
@@ -1580,6 +2036,7 @@ u32 writeSingleFrame() {
 		} else {
 			free(bbBufferStart);
 			bbFrameNum--;
+			bbDroppedFramesCore1++;
 			// Both FIFOs are full, we can't keep up with the logging, dropping newest frame
 		}
 	}
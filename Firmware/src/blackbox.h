@@ -98,6 +98,8 @@
 #define LOG_HEAD_DISARM_REASON 151
 #define LOG_HEAD_SYNC_FREQ 152
 #define LOG_HEAD_FRAMESIZE 153
+#define LOG_HEAD_SUMMARY 160
+#define LOG_HEAD_SUMMARY_SIZE 32
 #define LOG_DATA_START 256
 
 #define BB_FRAME_NORMAL 0 // normal frame, i.e. gyro, setpoints, pid, etc.
@@ -113,6 +115,12 @@
 #define BB_FRAME_RESERVED_3 67 // 'C'
 #define BB_FRAME_RESERVED_4 33 // '!'
 
+#define BB_STREAM_START 0 // host requests a byte range of a file
+#define BB_STREAM_ACK 1 // host acknowledges chunks and requests retransmits
+#define BB_STREAM_STOP 2 // host aborts the stream
+#define BB_STREAM_DATA 3 // FC sends a chunk
+#define BB_STREAM_DONE 4 // FC reports that all chunks were acknowledged
+
 #define BB_FRAMESIZE_FLIGHTMODE 2
 #define BB_FRAMESIZE_HIGHLIGHT 1
 #define BB_FRAMESIZE_GPS 93
@@ -121,10 +129,24 @@
 #define BB_FRAMESIZE_LINK_STATS 12
 #define BB_FRAMESIZE_SYNC 13
 
+// summary block at LOG_HEAD_SUMMARY, written by endLogging()
+#define LOG_SUMMARY_VERSION 0 // u8: 1 = summary valid, 0 = no summary (log not closed properly or older firmware)
+#define LOG_SUMMARY_MAX_GYRO 2 // u16[3]: maximum absolute rotation rate per axis in deg/s
+#define LOG_SUMMARY_MOTOR_SAT 8 // u16: share of frames with at least one motor at full throttle, in 0.01%
+#define LOG_SUMMARY_MIN_VBAT 10 // u16: lowest battery voltage in centivolts
+#define LOG_SUMMARY_AVG_VBAT 12 // u16: average battery voltage in centivolts
+#define LOG_SUMMARY_AVG_LOOP 14 // u16: average PID loop time in 0.01us
+#define LOG_SUMMARY_LOOP_JITTER 16 // u16: standard deviation of the PID loop time in 0.01us
+#define LOG_SUMMARY_DROPPED 18 // u32: number of frames that could not be logged
+#define LOG_SUMMARY_PEAK_I 22 // u16: peak absolute I term of any axis
+#define LOG_SUMMARY_FLIGHT_TIME 24 // u32: time in ms with the throttle above idle
+#define LOG_SUMMARY_FRAMES 28 // u32: number of logged normal frames
+
 extern u64 bbFlags; // 64 bits of flags for the blackbox (LOG_ macros)
 extern volatile bool fsReady; // Blackbox state
 extern u8 bbFreqDivider; // Blackbox frequency divider (compared to PID loop)
 extern u8 bbSyncFreq; // Blackbox makes SYNC after ... frames
+extern u8 bbKeepLogs; // flash only: keep at most this many logs and delete the oldest ones when the flash is full, 0 = never delete automatically
 extern u32 bbDebug1, bbDebug2;
 extern u16 bbDebug3, bbDebug4;
 #if BLACKBOX_STORAGE == SD_BB
@@ -150,6 +172,15 @@ void endLogging(DisarmReason reason = DisarmReason::LENGTH);
  */
 bool clearBlackbox();
 
+/**
+ * @brief Read the summary block (LOG_HEAD_SUMMARY) of a log file
+ *
+ * @param logNum log number
+ * @param summary destination, filled with zeros if the file has no summary
+ * @return false if the file could not be opened
+ */
+bool bbReadSummary(u16 logNum, u8 summary[LOG_HEAD_SUMMARY_SIZE]);
+
 /// @brief Write a single frame to the blackbox file
 /// @return u32 micros it took
 u32 writeSingleFrame();
@@ -200,6 +231,24 @@ void printFileInit(KoliSerial &serial, MspVersion mspVer, u16 logNum);
  */
 void printLogBin(KoliSerial &serial, MspVersion mspVer, u16 logNum, i32 singleChunk);
 
+/**
+ * @brief Streams a byte range of a log file to the configurator using MspFn::BB_FILE_STREAM
+ *
+ * @details Unlike printLogBin(), multiple chunks are in flight at the same time. Every MSP payload starts with the sub command byte.
+ * - BB_STREAM_START request: u16 log number, u32 start position, u32 length (0 = until end of file), u8 window (max. unacknowledged chunks). Response: u16 log number, u32 start, u32 length, u32 chunk size, u32 chunk count, u8 window
+ * - BB_STREAM_ACK request: u32 number of chunks received without gaps, u8 count n, n * u32 chunk indices to send again. No response
+ * - BB_STREAM_STOP request, response: u16 log number and the statistics (see BB_STREAM_DONE)
+ * - BB_STREAM_DATA response: u16 log number, u32 chunk index (relative to the start position), data
+ * - BB_STREAM_DONE response: u16 log number, u32 bytes sent, u32 duration in ms, u32 throughput in bytes/s, u32 retransmitted chunks
+ *
+ * @param serial serial to send to
+ * @param mspVer MSP version to use
+ * @param subCmd one of BB_STREAM_START, BB_STREAM_ACK, BB_STREAM_STOP
+ * @param reqPayload request payload after the sub command byte
+ * @param reqLen length of reqPayload
+ */
+void bbFileStream(KoliSerial &serial, MspVersion mspVer, u8 subCmd, const char *reqPayload, u16 reqLen);
+
 /**
  * @brief Closes a file, if open, that is currently used to print a log to the configurator
  */
@@ -208,7 +257,7 @@ void bbClosePrintFile(KoliSerial &serial, MspVersion mspVer);
 /// @brief Writes the prepared blackbox frames to the SD card
 void blackboxLoop();
 
-/// @brief just sets .printing to false, so that an invalid .serial pointer does not create problems
+/// @brief stops printing and streaming, so that an invalid .serial pointer does not create problems
 void bbStopPrinting();
 
 #endif
@@ -0,0 +1,225 @@
+/**
+ * @file crashDump.cpp
+ * @brief Crash capture: fault handlers, pre-watchdog alarm and the no-init RAM record that survives the reset
+ *
+ * Copyright (c) 2026 Kolibri-FC contributors
+ *
+ * This file is part of Kolibri-FC (https://github.com/bastian2001/Kolibri-FC).
+ *
+ * Kolibri-FC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Kolibri-FC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "git_version.h"
+#include "global.h"
+#include "hardware/exception.h"
+#include "hardware/structs/sio.h"
+#include "hardware/structs/timer.h"
+#include "hardware/sync.h"
+#include "hardware/timer.h"
+
+#define CRASH_MAGIC 0x4B435253 // "SRCK"
+
+// fault status registers of the Cortex-M33 (System Control Block)
+#define SCB_CFSR (*(volatile u32 *)0xE000ED28)
+#define SCB_HFSR (*(volatile u32 *)0xE000ED2C)
+#define SCB_MMFAR (*(volatile u32 *)0xE000ED34)
+#define SCB_BFAR (*(volatile u32 *)0xE000ED38)
+
+// from the linker script: core 0 runs on the stack in SCRATCH_Y, core 1 on the one in SCRATCH_X, below them are the scratch sections
+extern "C" u32 __StackTop, __StackOneTop, __scratch_x_end__, __scratch_y_end__;
+
+static CrashDump __uninitialized_ram(crashRecord); // not cleared by the reset, only valid with magic and checksum
+CrashDump lastCrash = {};
+
+static u32 crashOwner = 0; // 1 + core that captures the dump, the other core only adds its state
+static volatile u8 pendingReason[2] = {0, 0}; // reason for the doorbell a core rings on itself
+static volatile bool otherCoreSaved = false;
+static i32 watchdogAlarm = -1;
+static char assertFile[32] = {}; // of this boot, set by crashAssertFailed()
+static u32 assertLine = 0;
+
+static u32 crashChecksum(const CrashDump &d) {
+	// FNV-1a over everything but the checksum
+	u32 hash = 2166136261;
+	const u8 *data = (const u8 *)&d;
+	for (u32 i = 0; i < offsetof(CrashDump, checksum); i++) {
+		hash ^= data[i];
+		hash *= 16777619;
+	}
+	return hash;
+}
+
+static void setStackLimit(u32 limit, u32 top) {
+	// only if the core really runs on the expected stack, a wrong limit would fault right away
+	u32 sp;
+	asm volatile("mov %0, sp" : "=r"(sp));
+	limit = (limit + 7) & ~7;
+	if (sp > limit && sp <= top) asm volatile("msr msplim, %0" ::"r"(limit));
+}
+
+static void saveCoreState(CrashCoreState &s, const u32 *frame, u32 excReturn, const u32 *highRegs, u32 core) {
+	for (int i = 0; i < 4; i++) s.r[i] = frame[i];
+	for (int i = 0; i < 8; i++) s.r[i + 4] = highRegs[i];
+	s.r[12] = frame[4];
+	s.lr = frame[5];
+	s.pc = frame[6];
+	s.xpsr = frame[7];
+	s.excReturn = excReturn;
+	// the exception frame has 8 words, 26 with the FPU registers (EXC_RETURN.FType = 0), plus one for alignment (xPSR bit 9)
+	u32 sp = (u32)frame + ((excReturn & (1 << 4)) ? 32 : 104);
+	if (s.xpsr & (1 << 9)) sp += 4;
+	s.sp = sp;
+	s.task = currentTask[core];
+	s.stackWords = 0;
+	const u32 top = core ? (u32)&__StackOneTop : (u32)&__StackTop;
+	if (sp >= SRAM_BASE && sp < top) {
+		for (u32 addr = sp; addr + 4 <= top && s.stackWords < CRASH_STACK_WORDS; addr += 4)
+			s.stack[s.stackWords++] = *(const u32 *)addr;
+	}
+	s.valid = 1;
+}
+
+/**
+ * @brief Common part of all captures, called by the exception entries below with the stacked frame
+ *
+ * @details The first core to get here owns the dump: it saves its own state, rings the doorbell of the other core so that it saves its state as well, then reboots. The other core waits in its doorbell interrupt until the reset. If it does not respond (interrupts disabled, locked up), its state stays invalid.
+ */
+extern "C" [[noreturn]] void crashCapture(u32 *frame, u32 excReturn, u32 *highRegs, u32 reason) {
+	const u32 core = get_core_num();
+	sio_hw->doorbell_in_clr = 1 << CRASH_DOORBELL;
+	if (reason == (u32)CrashReason::NONE) {
+		// own doorbell (watchdog, assertion) or the other core crashed
+		reason = pendingReason[core];
+		pendingReason[core] = 0;
+	}
+	u32 expected = 0;
+	if (reason == (u32)CrashReason::NONE || !__atomic_compare_exchange_n(&crashOwner, &expected, core + 1, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+		saveCoreState(crashRecord.cores[core], frame, excReturn, highRegs, core);
+		otherCoreSaved = true;
+		while (true) tight_loop_contents();
+	}
+
+	CrashDump &d = crashRecord;
+	memset(&d, 0, offsetof(CrashDump, cores));
+	d.version = CRASH_DUMP_VERSION;
+	d.reason = (CrashReason)reason;
+	d.core = core;
+	d.armed = armed;
+	d.uptime = to_ms_since_boot(get_absolute_time());
+	d.cfsr = SCB_CFSR;
+	d.hfsr = SCB_HFSR;
+	d.mmfar = SCB_MMFAR;
+	d.bfar = SCB_BFAR;
+	d.assertLine = assertLine;
+	memcpy(d.assertFile, assertFile, sizeof(d.assertFile));
+	memcpy(d.gitHash, GIT_HASH, 7);
+	d.cores[core ^ 1].valid = 0;
+	saveCoreState(d.cores[core], frame, excReturn, highRegs, core);
+
+	sio_hw->doorbell_out_set = 1 << CRASH_DOORBELL;
+	const u32 start = time_us_32();
+	while (!otherCoreSaved && time_us_32() - start < 2000) tight_loop_contents();
+
+	d.magic = CRASH_MAGIC;
+	d.checksum = crashChecksum(d);
+	watchdog_reboot(0, 0, 1);
+	while (true) tight_loop_contents();
+}
+
+// saves r4-r11 and the exception frame, then continues in crashCapture(). The stack limit is removed first: after a stack overflow there is no room below it
+#define CRASH_ENTRY(name, reason)                   \
+	extern "C" __attribute__((naked)) void name() { \
+		asm volatile(                               \
+			"movs r3, #0\n"                         \
+			"msr msplim, r3\n"                      \
+			"tst lr, #4\n"                          \
+			"ite eq\n"                              \
+			"mrseq r0, msp\n"                       \
+			"mrsne r0, psp\n"                       \
+			"mov r1, lr\n"                          \
+			"push {r4-r11}\n"                       \
+			"mov r2, sp\n"                          \
+			"movs r3, %0\n"                         \
+			"b crashCapture\n" ::"i"(reason));      \
+	}
+
+CRASH_ENTRY(crashHardFaultIsr, (u8)CrashReason::HARDFAULT)
+CRASH_ENTRY(crashDoorbellIsr, (u8)CrashReason::NONE)
+
+static void crashWatchdogIsr() {
+	timer_hw->intr = 1 << watchdogAlarm;
+	const u32 remaining = watchdog_get_time_remaining_ms();
+	if (remaining <= CRASH_PREWATCHDOG_MS) {
+		// ring the own doorbell, it is taken right after this interrupt with the frame of the stalled code
+		pendingReason[0] = (u8)CrashReason::WATCHDOG;
+		sio_hw->doorbell_in_set = 1 << CRASH_DOORBELL;
+		return;
+	}
+	// wake up shortly before the watchdog would expire if it is not reset until then
+	timer_hw->alarm[watchdogAlarm] = timer_hw->timerawl + (remaining - CRASH_PREWATCHDOG_MS) * 1000;
+}
+
+void initCrashDump() {
+	if (crashRecord.magic == CRASH_MAGIC && crashRecord.checksum == crashChecksum(crashRecord)) {
+		lastCrash = crashRecord;
+		DEBUG_PRINTF("Crash dump from last boot: reason %d on core %d after %d ms\n", (int)lastCrash.reason, lastCrash.core, lastCrash.uptime);
+	} else if (watchdog_enable_caused_reboot()) {
+		lastCrash.version = CRASH_DUMP_VERSION;
+		lastCrash.reason = CrashReason::WATCHDOG_RESET;
+		memcpy(lastCrash.gitHash, GIT_HASH, 7);
+		DEBUG_PRINTLN("Watchdog reset without crash dump");
+	}
+	crashRecord.magic = 0;
+
+	// both cores share the vector table
+	exception_set_exclusive_handler(HARDFAULT_EXCEPTION, crashHardFaultIsr);
+	irq_set_exclusive_handler(SIO_IRQ_BELL, crashDoorbellIsr);
+	irq_set_priority(SIO_IRQ_BELL, PICO_HIGHEST_IRQ_PRIORITY);
+	irq_set_enabled(SIO_IRQ_BELL, true);
+	setStackLimit((u32)&__scratch_y_end__, (u32)&__StackTop);
+}
+
+void initCrashDumpCore1() {
+	irq_set_priority(SIO_IRQ_BELL, PICO_HIGHEST_IRQ_PRIORITY);
+	irq_set_enabled(SIO_IRQ_BELL, true);
+	setStackLimit((u32)&__scratch_x_end__, (u32)&__StackOneTop);
+}
+
+void startCrashWatchdog() {
+	watchdogAlarm = hardware_alarm_claim_unused(false);
+	if (watchdogAlarm < 0) return;
+	const u32 irq = hardware_alarm_get_irq_num(watchdogAlarm);
+	irq_set_exclusive_handler(irq, crashWatchdogIsr);
+	irq_set_priority(irq, PICO_HIGHEST_IRQ_PRIORITY);
+	hw_set_bits(&timer_hw->inte, 1 << watchdogAlarm);
+	irq_set_enabled(irq, true);
+	timer_hw->alarm[watchdogAlarm] = timer_hw->timerawl + 1000;
+}
+
+void clearCrashDump() {
+	memset(&lastCrash, 0, sizeof(lastCrash));
+}
+
+void crashAssertFailed(const char *file, u32 line) {
+	save_and_disable_interrupts();
+	const size_t len = strlen(file);
+	const char *tail = len >= sizeof(assertFile) ? file + len - sizeof(assertFile) + 1 : file;
+	strncpy(assertFile, tail, sizeof(assertFile) - 1);
+	assertLine = line;
+	// same layout as an exception frame, the caller is the pc
+	const u32 caller = (u32)__builtin_return_address(0);
+	u32 frame[8] = {0, 0, 0, 0, 0, caller, caller, 1 << 24};
+	u32 highRegs[8] = {};
+	crashCapture(frame, 0xFFFFFFF9, highRegs, (u32)CrashReason::ASSERT);
+}
@@ -0,0 +1,96 @@
+/**
+ * @file crashDump.h
+ * @brief Captures the state of both cores on faults, watchdog stalls and failed assertions, and keeps it across the reset
+ *
+ * Copyright (c) 2026 Kolibri-FC contributors
+ *
+ * This file is part of Kolibri-FC (https://github.com/bastian2001/Kolibri-FC).
+ *
+ * Kolibri-FC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Kolibri-FC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include "typedefs.h"
+
+#define CRASH_DUMP_VERSION 1
+#define CRASH_STACK_WORDS 48 // raw stack words per core, python/crashDump.py symbolizes the ones that point into flash
+#define CRASH_PREWATCHDOG_MS 30 // a stalled loop is captured this long before the watchdog resets the chip
+#define CRASH_DOORBELL 7 // SIO doorbell that stops the other core and lets it save its state
+
+enum class CrashReason : u8 {
+	NONE = 0,
+	HARDFAULT, // any fault, all of them escalate to HardFault. CFSR.STKOF (bit 20) marks a stack overflow
+	WATCHDOG, // the watchdog was not reset for too long, captured just before it would reset the chip
+	WATCHDOG_RESET, // the watchdog reset the chip without a capture (stalled in an interrupt of the highest priority)
+	ASSERT, // CRASH_ASSERT() failed
+};
+
+typedef struct crashCoreState {
+	u32 r[13]; // r0-r12
+	u32 sp; // before the exception
+	u32 lr;
+	u32 pc;
+	u32 xpsr;
+	u32 excReturn;
+	u8 valid; // 0 if the core did not respond
+	u8 task; // Tasks entry that was running on the core, TASK_LENGTH if none
+	u16 stackWords; // valid entries of stack
+	u32 stack[CRASH_STACK_WORDS]; // stack from sp upwards
+} CrashCoreState;
+
+/// @brief sent as is by MSP GET_CRASH_DUMP, all little endian without padding
+typedef struct crashDump {
+	u32 magic;
+	u8 version; // CRASH_DUMP_VERSION
+	CrashReason reason;
+	u8 core; // core that crashed
+	u8 armed;
+	u32 uptime; // ms since boot
+	u32 cfsr; // fault status registers of the core that crashed
+	u32 hfsr;
+	u32 mmfar;
+	u32 bfar;
+	u32 assertLine;
+	char assertFile[32]; // last characters of the file name
+	char gitHash[8];
+	CrashCoreState cores[2];
+	u32 checksum;
+} CrashDump;
+static_assert(sizeof(CrashDump) == 612, "CrashDump is sent as is, keep python/crashDump.py in sync");
+
+extern CrashDump lastCrash; // crash of the previous boot, reason NONE if there was none
+
+/**
+ * @brief Loads the crash of the previous boot and installs the fault handlers
+ *
+ * @details Call on core 0 as early as possible. Also enables the stack limit of core 0, so that a stack overflow faults instead of running into the stack of core 1.
+ */
+void initCrashDump();
+
+/// @brief enables the stack limit and the doorbell interrupt on core 1, call in setup1()
+void initCrashDumpCore1();
+
+/// @brief captures the loop of core 0 if it stalls, call right after the watchdog is enabled
+void startCrashWatchdog();
+
+/// @brief forgets the crash of the previous boot
+void clearCrashDump();
+
+/// @brief captures both cores and reboots, use CRASH_ASSERT()
+[[noreturn]] void crashAssertFailed(const char *file, u32 line);
+
+#define CRASH_ASSERT(cond)                                  \
+	do {                                                    \
+		if (!(cond)) crashAssertFailed(__FILE__, __LINE__); \
+	} while (0)
@@ -42,8 +42,11 @@ static i32 baroTempRaw;
 #endif
 
 fix32 baroASL = 0; // above sea level
-static fix32 lastBaroASL = 0, gpsBaroOffset = 0;
-static PT2 baroAslFiltered(1, 50);
+static fix32 gpsBaroOffset = 0;
+BaroPipeline baroPipeline;
+u32 baroRate = 50;
+f32 baroTempCoeff = 0;
+static f32 baroTemperature = 0; // °C
 enum class BaroState {
 	NOT_INIT = 0, // not inited / no baro detected yet
 	INITIALIZING, // initializing (baro detected but depending on model maybe needs more initialization steps than can be done at once)
@@ -65,13 +68,86 @@ static u8 baroBuffer[32] = {};
 static elapsedMicros baroTimer = 0;
 static u32 baroTimerTimeout = 0;
 i32 pressureRaw;
+#if HW_BARO == BARO_LPS22
+static I2cDevice *baroDevice = nullptr;
+static bool baroReadFailed = false;
+static u8 baroCtrlReg1 = 0;
+static u32 baroSamplePeriod = 20000; // us
+
+/**
+ * @brief picks the output data rate for baroRate
+ *
+ * @details The sensor averages internally between two samples, so the lowest rate that is not below the setting gives the least noise. The internal low pass runs at ODR/9, its delay is compensated by the pipeline.
+ */
+static void baroSelectRate() {
+	static const u8 rates[] = {10, 25, 50, 75};
+	u8 i = 0;
+	while (i < ARRAYLEN(rates) - 1 && rates[i] < baroRate) i++;
+	baroRate = rates[i];
+	baroSamplePeriod = 1000000 / baroRate;
+	baroCtrlReg1 = (i + 2) << 4 | 0b1010; // ODR, low pass at ODR/9, block data update (from now on, only single byte reads allowed)
+	baroPipeline.configure(baroRate, 1, 9 / (2 * PI * baroRate));
+	baroImuUpVelFilter = PT1(0.2f, baroRate);
+}
+
+void initBaro() {
+	addSetting(SETTING_BARO_RATE, &baroRate, 50);
+	addSetting(SETTING_BARO_TEMP_COEFF, &baroTempCoeff, 0);
+	baroPipeline.tempCoeff = baroTempCoeff;
+	baroSelectRate();
+	baroDevice = i2cAddDevice("Baro", I2C_BARO_ADDR);
+}
+
+static void baroProbeDone(const I2cTransaction &t, I2cResult result) {
+	baroSubState = 0;
+	if (result == I2cResult::OK && baroBuffer[0] == 0xB1)
+		baroState = BaroState::INITIALIZING;
+}
+
+static void baroConfigDone(const I2cTransaction &t, I2cResult result) {
+	if (result != I2cResult::OK) baroState = BaroState::NOT_INIT;
+}
+
+static void baroStatusDone(const I2cTransaction &t, I2cResult result) {
+	baroSubState = 0;
+	if (result == I2cResult::OK && baroBuffer[0] & (1 << 0)) {
+		baroState = BaroState::READ_DATA;
+		baroTimerTimeout = baroSamplePeriod * 19 / 20; // baro data is available, check again slightly before the next sample to allow for clock deviations
+	} else {
+		baroState = BaroState::MEASURING;
+		baroTimerTimeout = 2000; // check for new data again after 2ms
+	}
+}
+
+// called for all three pressure and both temperature bytes, they are read one by one because of the block data update
+static void baroDataDone(const I2cTransaction &t, I2cResult result) {
+	if (result != I2cResult::OK) baroReadFailed = true;
+	if (t.reg != (u8)BaroRegs::TEMP_OUT_H) return;
+	baroSubState = 0;
+	if (baroReadFailed) {
+		baroReadFailed = false;
+		baroState = BaroState::MEASURING;
+		baroTimerTimeout = 2000;
+		return;
+	}
+	pressureRaw = ((i32)baroBuffer[0] << 8 | (i32)baroBuffer[1] << 16 | (i32)baroBuffer[2] << 24) >> 8; // preserve the sign bit
+	baroTemperature = (i16)(baroBuffer[3] | baroBuffer[4] << 8) * 0.01f;
+	baroState = BaroState::EVAL_DATA;
+}
+#else
+void initBaro() {
+	addSetting(SETTING_BARO_RATE, &baroRate, 50);
+	addSetting(SETTING_BARO_TEMP_COEFF, &baroTempCoeff, 0);
+	baroPipeline.tempCoeff = baroTempCoeff;
+	baroPipeline.configure(baroRate, 1, 0);
+}
+#endif
 
 void baroLoop() {
 	TASK_START(TASK_BARO);
 	switch (baroState) {
 	case BaroState::NOT_INIT: {
 		if (baroTimer < 5000) break;
-		if (i2c0blocker) break;
 		baroTimer = 0;
 		// no baro detected yet
 #if HW_BARO == BARO_SPL006
@@ -84,17 +160,13 @@ void baroLoop() {
 			return;
 		}
 #elif HW_BARO == BARO_LPS22
-		baroBuffer[0] = (u8)BaroRegs::WHO_AM_I;
-		i2c_write_blocking(I2C_BARO, I2C_BARO_ADDR, baroBuffer, 1, false);
-		i2c_read_blocking(I2C_BARO, I2C_BARO_ADDR, baroBuffer, 1, false);
-		if (baroBuffer[0] == 0xB1) {
-			baroState = BaroState::INITIALIZING;
-		}
+		if (baroSubState) break; // probe still pending
+		if (i2cReadReg(baroDevice, (u8)BaroRegs::WHO_AM_I, baroBuffer, 1, baroProbeDone, I2cPriority::LOW))
+			baroSubState = 1;
 #endif
 	} break;
 	case BaroState::INITIALIZING: {
 		// baro detected
-		if (i2c0blocker) break;
 #if HW_BARO == BARO_SPL006
 		regRead(SPI_BARO, PIN_BARO_CS, 0x10, baroBuffer, 18, 0, false); // read calibration data
 		baroCalibration[c0] = (((u32)baroBuffer[0]) << 4) + (baroBuffer[1] >> 4);
@@ -122,12 +194,11 @@ void baroLoop() {
 		baroBuffer[0] = 0b00000111; // enable pressureRaw and temperature measurement
 		regWrite(SPI_BARO, PIN_BARO_CS, 0x08, baroBuffer, 1, 0); // set MEAS_CFG register
 #elif HW_BARO == BARO_LPS22
-		baroBuffer[0] = (u8)BaroRegs::CTRL_REG1;
-		baroBuffer[1] = 0b01001010; // 50Hz, Low-pass, block data update (from now on, only single byte reads allowed)
-		i2c_write_blocking(I2C_BARO, I2C_BARO_ADDR, baroBuffer, 2, false);
-		baroBuffer[0] = (u8)BaroRegs::CTRL_REG2;
-		baroBuffer[1] = 0b00000000; // clear register increment (needs to be unset when using block data update)
-		i2c_write_blocking(I2C_BARO, I2C_BARO_ADDR, baroBuffer, 2, false);
+		if (i2cQueueFree() < 2) break;
+		baroBuffer[0] = baroCtrlReg1;
+		i2cWriteReg(baroDevice, (u8)BaroRegs::CTRL_REG1, baroBuffer, 1, baroConfigDone, I2cPriority::LOW);
+		baroBuffer[0] = 0b00000000; // clear register increment (needs to be unset when using block data update)
+		i2cWriteReg(baroDevice, (u8)BaroRegs::CTRL_REG2, baroBuffer, 1, baroConfigDone, I2cPriority::LOW);
 		baroTimerTimeout = 100000; // delay first reading
 		baroTimer = 0;
 #endif
@@ -146,37 +217,9 @@ void baroLoop() {
 #if HW_BARO == BARO_SPL006
 		baroState = BaroState::READ_DATA;
 #elif HW_BARO == BARO_LPS22
-		switch (baroSubState) {
-		case 0:
-			if (i2c0blocker == 0) {
-				i2c0blocker = 1;
-				baroSubState = 1;
-				baroBuffer[0] = (u8)BaroRegs::STATUS;
-				startI2cWrite(I2C_BARO_ADDR, baroBuffer, 1);
-			}
-			break;
-		case 1:
-			if (checkI2cWriteDone()) {
-				startI2cRead(I2C_BARO_ADDR, 1);
-				baroSubState = 2;
-			}
-			break;
-		case 2:
-			if (getI2cReadCount()) {
-				getI2cReadData(baroBuffer, 1);
-				if (baroBuffer[0] & (1 << 0)) {
-					baroState = BaroState::READ_DATA;
-					baroSubState = 0;
-					baroTimerTimeout = 19000; // baro data is available, check after a total of 19ms (slightly faster than 50Hz to allow for slight clock deviations)
-				} else {
-					baroState = BaroState::MEASURING;
-					baroSubState = 0;
-					baroTimerTimeout = 2000; // check for new data again after 2ms
-				}
-				i2c0blocker = 0;
-			}
-			break;
-		}
+		// baroStatusDone() continues
+		if (baroSubState == 0 && i2cReadReg(baroDevice, (u8)BaroRegs::STATUS, baroBuffer, 1, baroStatusDone, I2cPriority::NORMAL, 2000))
+			baroSubState = 1;
 #endif
 		TASK_END(TASK_BARO_CHECK);
 	} break;
@@ -190,51 +233,15 @@ void baroLoop() {
 		pressureRaw >>= 8;
 		temperature >>= 8;
 #elif HW_BARO == BARO_LPS22
-		switch (baroSubState) {
-		case 0:
-			if (i2c0blocker == 0) {
-				i2c0blocker = 1;
-				baroSubState = 1;
-				baroBuffer[0] = (u8)BaroRegs::PRESS_OUT_XL;
-				startI2cWrite(I2C_BARO_ADDR, baroBuffer, 1);
-			}
-			break;
-		case 1:
-		case 3:
-		case 5:
-			if (checkI2cWriteDone()) {
-				baroSubState++;
-				startI2cRead(I2C_BARO_ADDR, 1);
-			}
-			break;
-		case 2:
-			if (getI2cReadCount()) {
-				baroSubState = 3;
-				getI2cReadData(baroBuffer, 1);
-				pressureRaw = (i32)baroBuffer[0] << 8;
-				baroBuffer[0] = (u8)BaroRegs::PRESS_OUT_L;
-				startI2cWrite(I2C_BARO_ADDR, baroBuffer, 1);
-			}
-			break;
-		case 4:
-			if (getI2cReadCount()) {
-				baroSubState = 5;
-				getI2cReadData(baroBuffer, 1);
-				pressureRaw |= (i32)baroBuffer[0] << 16;
-				baroBuffer[0] = (u8)BaroRegs::PRESS_OUT_H;
-				startI2cWrite(I2C_BARO_ADDR, baroBuffer, 1);
-			}
-			break;
-		case 6:
-			if (getI2cReadCount()) {
-				i2c0blocker = 0;
-				baroSubState = 0;
-				baroState = BaroState::EVAL_DATA;
-				getI2cReadData(baroBuffer, 1);
-				pressureRaw |= (i32)baroBuffer[0] << 24;
-				pressureRaw >>= 8;
-			}
-			break;
+		// baroDataDone() continues, a read that is late by half a sample period is dropped
+		if (baroSubState == 0 && i2cQueueFree() >= 5) {
+			const u32 deadline = baroSamplePeriod / 2;
+			i2cReadReg(baroDevice, (u8)BaroRegs::PRESS_OUT_XL, &baroBuffer[0], 1, baroDataDone, I2cPriority::NORMAL, deadline);
+			i2cReadReg(baroDevice, (u8)BaroRegs::PRESS_OUT_L, &baroBuffer[1], 1, baroDataDone, I2cPriority::NORMAL, deadline);
+			i2cReadReg(baroDevice, (u8)BaroRegs::PRESS_OUT_H, &baroBuffer[2], 1, baroDataDone, I2cPriority::NORMAL, deadline);
+			i2cReadReg(baroDevice, (u8)BaroRegs::TEMP_OUT_L, &baroBuffer[3], 1, baroDataDone, I2cPriority::NORMAL, deadline);
+			i2cReadReg(baroDevice, (u8)BaroRegs::TEMP_OUT_H, &baroBuffer[4], 1, baroDataDone, I2cPriority::NORMAL, deadline);
+			baroSubState = 1;
 		}
 #endif
 		TASK_END(TASK_BARO_READ);
@@ -246,17 +253,20 @@ void baroLoop() {
 		f32 pressureScaled = pressureRaw / 7864320.f;
 		f32 temperatureScaled = baroTempRaw / 7864320.f;
 		baroPres = baroCalibration[c00] + pressureScaled * (baroCalibration[c10] + pressureScaled * (baroCalibration[c20] + pressureScaled * baroCalibration[c30])) + temperatureScaled * baroCalibration[c01] + temperatureScaled * pressureScaled * (baroCalibration[c11] + pressureScaled * baroCalibration[c21]);
+		baroTemperature = baroTemp;
 #elif HW_BARO == BARO_LPS22
 		blackboxPres = pressureRaw;
 		baroPres = pressureRaw * (1 / 40.96f);
+		baroTemp = baroTemperature;
 #endif
-		lastBaroASL = baroASL;
-		baroASL = baroAslFiltered.update(44330 * (1 - powf(baroPres / 101325.f, 1 / 5.255f)));
+		// outlier rejection, temperature and latency compensation
+		baroPipeline.update(baroPres, baroTemperature);
+		baroASL = baroPipeline.altitude();
 		if (gpsGoodQuality)
 			gpsBaroAlt = baroASL - gpsBaroOffset;
 		else
 			gpsBaroOffset = baroASL - gpsMotion.alt / 1000.f;
-		baroUpVel = (baroASL - lastBaroASL) * 50;
+		baroUpVel = baroPipeline.velocity();
 		baroImuUpVelFilter.update(gpsGoodQuality ? fix32(-gpsMotion.velD / 10) * 0.01f : baroUpVel);
 		mspDebugSensors[1] = (fix32(baroImuUpVelFilter) * 1000).geti32();
 		baroState = altInitState ? BaroState::MEASURING : BaroState::FORCE_SET_ALT;
@@ -267,9 +277,8 @@ void baroLoop() {
 			baroState = BaroState::MEASURING;
 			break;
 		}
-		baroAslFiltered.set(44330 * (1 - powf(baroPres / 101325.f, 1 / 5.255f)));
-		baroASL = baroAslFiltered;
-		lastBaroASL = baroASL;
+		baroPipeline.reset(baroPres, baroTemperature);
+		baroASL = baroPipeline.altitude();
 		gpsBaroAlt = baroASL;
 		baroUpVel = 0;
 		baroImuUpVelFilter.set(0);
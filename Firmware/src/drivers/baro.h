@@ -22,6 +22,7 @@
 
 #pragma once
 #include <Arduino.h>
+#include "baroPipeline.h"
 #include <fixedPointInt.h>
 
 extern fix32 baroASL;
@@ -31,6 +32,9 @@ extern u8 baroTemp;
 extern fix32 gpsBaroAlt;
 extern i32 pressureRaw;
 extern volatile i32 blackboxPres;
+extern BaroPipeline baroPipeline;
+extern u32 baroRate; // Hz, rounded up to the next rate the sensor supports
+extern f32 baroTempCoeff; // Pa/°C, temperature drift of the sensor, 0 to disable the compensation
 
 #if HW_BARO == BARO_LPS22
 #define I2C_BARO_ADDR 0x5D
@@ -61,6 +65,9 @@ enum BaroRegs {
 };
 #endif
 
+/// @brief Registers the barometer on the I2C bus (if it is an I2C baro) and loads the settings
+void initBaro();
+
 /**
  * @brief The main barometer loop function
  *
@@ -0,0 +1,94 @@
+/**
+ * @file baroPipeline.cpp
+ * @brief Barometer processing: outlier rejection, temperature compensation, low pass and latency compensation
+ *
+ * Copyright (c) 2026 Kolibri-FC contributors
+ *
+ * This file is part of Kolibri-FC (https://github.com/bastian2001/Kolibri-FC).
+ *
+ * Kolibri-FC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Kolibri-FC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "baroPipeline.h"
+#include <math.h>
+#include <string.h>
+
+BaroPipeline::BaroPipeline(u32 sampleHz, f32 cutoffHz, f32 sensorDelayS) {
+	configure(sampleHz, cutoffHz, sensorDelayS);
+}
+
+void BaroPipeline::configure(u32 sampleHz, f32 cutoffHz, f32 sensorDelayS) {
+	this->sampleHz = sampleHz;
+	// same as PT2 in filters.cpp
+	const f32 omega = 2 * (f32)M_PI * 1.5537f * cutoffHz / sampleHz;
+	alpha = omega / (omega + 1);
+	// the velocity is the derivative of the PT2 output, a little extra smoothing at twice the cutoff
+	const f32 velOmega = 2 * (f32)M_PI * 2 * cutoffHz / sampleHz;
+	velAlpha = velOmega / (velOmega + 1);
+	// each PT1 stage delays by (1 - alpha) / alpha samples, the velocity is half a sample behind on top
+	delayS = (2 * (1 - alpha) / alpha + 0.5f) / sampleHz + sensorDelayS;
+}
+
+f32 BaroPipeline::toAltitude(f32 pressure) {
+	return 44330 * (1 - powf(pressure / 101325.f, 1 / 5.255f));
+}
+
+f32 BaroPipeline::median(f32 *values, u8 count) const {
+	// insertion sort, the window is tiny
+	for (u8 i = 1; i < count; i++) {
+		const f32 v = values[i];
+		u8 j = i;
+		for (; j > 0 && values[j - 1] > v; j--) values[j] = values[j - 1];
+		values[j] = v;
+	}
+	return count & 1 ? values[count / 2] : (values[count / 2 - 1] + values[count / 2]) / 2;
+}
+
+void BaroPipeline::reset(f32 pressure, f32 temperature) {
+	refTemperature = temperature;
+	for (u8 i = 0; i < BARO_HAMPEL_WINDOW; i++) window[i] = pressure;
+	windowPos = 0;
+	windowCount = BARO_HAMPEL_WINDOW;
+	lastPressure = pressure;
+	y1 = y = compensated = toAltitude(pressure);
+	vel = 0;
+}
+
+bool BaroPipeline::update(f32 pressure, f32 temperature) {
+	samples++;
+	pressure -= tempCoeff * (temperature - refTemperature);
+
+	window[windowPos] = pressure;
+	windowPos = (windowPos + 1) % BARO_HAMPEL_WINDOW;
+	if (windowCount < BARO_HAMPEL_WINDOW) windowCount++;
+	f32 sorted[BARO_HAMPEL_WINDOW];
+	memcpy(sorted, window, sizeof(sorted));
+	const f32 med = median(sorted, windowCount);
+	for (u8 i = 0; i < windowCount; i++) sorted[i] = fabsf(sorted[i] - med);
+	const f32 mad = median(sorted, windowCount) * 1.4826f; // scaled to the standard deviation of normal noise
+	const f32 threshold = fmaxf(BARO_HAMPEL_K * mad, BARO_HAMPEL_FLOOR_PA);
+	const bool accepted = fabsf(pressure - med) <= threshold;
+	if (!accepted) {
+		outliers++;
+		pressure = med;
+	}
+	lastPressure = pressure;
+
+	const f32 lastY = y;
+	y1 += alpha * (toAltitude(pressure) - y1);
+	y += alpha * (y1 - y);
+	vel += velAlpha * ((y - lastY) * sampleHz - vel);
+	compensated = y + vel * delayS;
+	return accepted;
+}
@@ -0,0 +1,95 @@
+/**
+ * @file baroPipeline.h
+ * @brief Barometer processing: outlier rejection, temperature compensation, low pass and latency compensation
+ *
+ * Copyright (c) 2026 Kolibri-FC contributors
+ *
+ * This file is part of Kolibri-FC (https://github.com/bastian2001/Kolibri-FC).
+ *
+ * Kolibri-FC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Kolibri-FC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include "typedefs.h"
+
+#define BARO_HAMPEL_WINDOW 7 // samples for the median, odd
+#define BARO_HAMPEL_K 3.f // outlier if further than this many (scaled) MADs from the median
+#define BARO_HAMPEL_FLOOR_PA 12.f // never reject closer to the median than this (about 1 m), the MAD of a quiet sensor is almost 0
+
+/**
+ * @brief Turns raw pressure samples into altitude and vertical velocity
+ *
+ * @details Stages, in order:
+ * 1. temperature compensation: the pressure is corrected by tempCoeff per °C relative to the temperature at reset(), for sensors that drift while they warm up
+ * 2. Hampel filter: a sample that is far from the median of the last BARO_HAMPEL_WINDOW samples (measured in median absolute deviations) is replaced by the median. This removes prop wash and impact spikes and broken I2C reads without delaying the good samples, a real altitude change passes once it makes up half of the window
+ * 3. conversion to altitude and a PT2 low pass
+ * 4. latency compensation: the output is extrapolated by the group delay of the low pass and the sensor with the filtered vertical velocity
+ *
+ * Uses floats only, so that it can be benchmarked on the host against recorded blackbox data.
+ */
+class BaroPipeline {
+public:
+	/**
+	 * @param sampleHz rate at which update() is called
+	 * @param cutoffHz cutoff of the PT2 low pass on the altitude
+	 * @param sensorDelayS delay of the sensor itself (internal low pass), also compensated
+	 */
+	BaroPipeline(u32 sampleHz = 50, f32 cutoffHz = 1, f32 sensorDelayS = 0);
+
+	/// @brief same parameters as the constructor, keeps the state
+	void configure(u32 sampleHz, f32 cutoffHz, f32 sensorDelayS);
+
+	/**
+	 * @brief start over at this sample, e.g. after boot
+	 *
+	 * @param pressure in Pa
+	 * @param temperature in °C, becomes the reference of the temperature compensation
+	 */
+	void reset(f32 pressure, f32 temperature);
+
+	/**
+	 * @brief process one sample
+	 *
+	 * @param pressure in Pa
+	 * @param temperature in °C
+	 * @return false if the sample was rejected as an outlier
+	 */
+	bool update(f32 pressure, f32 temperature);
+
+	f32 altitude() const { return compensated; } // m above sea level, latency compensated
+	f32 filteredAltitude() const { return y; } // m above sea level, low pass only
+	f32 velocity() const { return vel; } // m/s, up
+	f32 pressure() const { return lastPressure; } // Pa, after outlier rejection and temperature compensation
+	f32 delay() const { return delayS; } // s, compensated by altitude()
+
+	f32 tempCoeff = 0; // Pa/°C, 0 to disable the temperature compensation
+	u32 samples = 0;
+	u32 outliers = 0;
+
+private:
+	static f32 toAltitude(f32 pressure);
+	f32 median(f32 *values, u8 count) const;
+	f32 window[BARO_HAMPEL_WINDOW] = {};
+	u8 windowPos = 0;
+	u8 windowCount = 0;
+	f32 refTemperature = 0;
+	f32 lastPressure = 101325;
+	u32 sampleHz = 50;
+	f32 alpha = 1; // PT2
+	f32 velAlpha = 1; // PT1 on the velocity
+	f32 delayS = 0;
+	f32 y1 = 0, y = 0; // PT2 state
+	f32 vel = 0;
+	f32 compensated = 0;
+};
@@ -0,0 +1,50 @@
+/**
+ * @file crcSniffer.cpp
+ * @brief CRC16 XMODEM on the DMA sniffer
+ *
+ * Copyright (c) 2026 Kolibri-FC contributors
+ *
+ * This file is part of Kolibri-FC (https://github.com/bastian2001/Kolibri-FC).
+ *
+ * Kolibri-FC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Kolibri-FC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "global.h"
+
+static int crcDmaChannel = -1;
+static dma_channel_config_t crcDmaConfig;
+static volatile u8 crcDmaSink; // the bytes only pass the sniffer, they have to be written somewhere
+
+void initCrcSniffer() {
+	if (crcDmaChannel >= 0) return;
+	crcDmaChannel = dma_claim_unused_channel(false);
+	if (crcDmaChannel < 0) return;
+	crcDmaConfig = dma_channel_get_default_config(crcDmaChannel);
+	channel_config_set_transfer_data_size(&crcDmaConfig, DMA_SIZE_8);
+	channel_config_set_read_increment(&crcDmaConfig, true);
+	channel_config_set_write_increment(&crcDmaConfig, false);
+	channel_config_set_sniff_enable(&crcDmaConfig, true);
+}
+
+u16 crc16XmodemDma(const u8 *data, u32 len, u16 crc) {
+	if (crcDmaChannel < 0 || len < CRC_DMA_MIN_LEN) return crc16Xmodem(data, len, crc);
+	dma_sniffer_enable(crcDmaChannel, DMA_SNIFF_CTRL_CALC_VALUE_CRC16, false);
+	dma_sniffer_set_data_accumulator(crc);
+	__dmb(); // data written by the CPU has to be in memory before the channel reads it
+	dma_channel_configure(crcDmaChannel, &crcDmaConfig, &crcDmaSink, data, len, true);
+	dma_channel_wait_for_finish_blocking(crcDmaChannel);
+	crc = dma_sniffer_get_data_accumulator();
+	dma_sniffer_disable();
+	return crc;
+}
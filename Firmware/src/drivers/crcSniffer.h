@@ -0,0 +1,40 @@
+/**
+ * @file crcSniffer.h
+ * @brief CRC16 XMODEM on the DMA sniffer
+ *
+ * Copyright (c) 2026 Kolibri-FC contributors
+ *
+ * This file is part of Kolibri-FC (https://github.com/bastian2001/Kolibri-FC).
+ *
+ * Kolibri-FC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Kolibri-FC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include "typedefs.h"
+
+#define CRC_DMA_MIN_LEN 32 // below this, the channel setup costs more than the table
+
+/*
+ * The sniffer calculates CRC32, CRC16-CCITT (poly 0x1021) and sums over the bytes a channel moves. CRC16-CCITT with seed 0 and no reflection is XMODEM, the CRC of the 4way interface. CRC8 0xD5 (CRSF, MSP) and Fletcher (UBX) are not among its modes, they stay on the tables in utils/checksum.h.
+ */
+
+/// @brief claims the channel for the sniffer, falls back to the tables if none is free
+void initCrcSniffer();
+
+/**
+ * @brief CRC16 XMODEM, the DMA channel reads the data while the sniffer calculates the CRC
+ *
+ * @details Blocks until the transfer is done. The sniffer exists only once, so this is for the serial loop only, not for interrupts or the other core.
+ */
+u16 crc16XmodemDma(const u8 *data, u32 len, u16 crc = 0);
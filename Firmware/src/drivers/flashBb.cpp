@@ -20,8 +20,12 @@
  * along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#ifdef FCKAFD_NATIVE
+#include "fckafdNative.h" // host build with a simulated chip, see test/test_fckafd
+#else
 #include "global.h"
 #include "pioasm/extended_spi.pio.h"
+#endif
 #if BLACKBOX_STORAGE == FLASH_BB
 
 enum FlashRegisters {
@@ -30,8 +34,8 @@ enum FlashRegisters {
 	FLASH_CMD_SET_FEATURE = 0x1F,
 	FLASH_CMD_READ_ID = 0x9F,
 	FLASH_CMD_PAGE_READ = 0x13,
-	// FLASH_CMD_READ_PAGE_CACHE_RANDOM = 0x30,
-	// FLASH_CMD_READ_PAGE_CACHE_LAST = 0x3F,
+	FLASH_CMD_READ_PAGE_CACHE_RANDOM = 0x30,
+	FLASH_CMD_READ_PAGE_CACHE_LAST = 0x3F,
 	FLASH_CMD_READ_FROM_CACHE_X1 = 0x03,
 	FLASH_CMD_READ_FROM_CACHE_X2 = 0x3B,
 	// FLASH_CMD_READ_FROM_CACHE_X4 = 0x6B,
@@ -48,6 +52,19 @@ enum FlashRegisters {
 	// FLASH_CMD_PERMANENT_BLOCK_LOCK_PROTECTION = 0x2C,
 };
 
+// bits of the status register (feature 0xC0)
+#define FLASH_STATUS_OIP (1 << 0) // operation in progress
+#define FLASH_STATUS_E_FAIL (1 << 2)
+#define FLASH_STATUS_P_FAIL (1 << 3)
+#define FLASH_STATUS_CRBSY (1 << 7) // cache read busy: the chip is reading the next page into its data register
+
+#ifndef FCKAFD_NATIVE // the native build provides these in nandSim.cpp
+void Fckafd::select() {
+	gpio_put(PIN_FLASH_CS, false);
+}
+void Fckafd::deselect() {
+	gpio_put(PIN_FLASH_CS, true);
+}
 // sends/receives a simple RX/TX byte via SPI to the blackbox flash chip
 u8 Fckafd::singleSpiTransfer(u8 txByte) {
 	pio_sm_clear_fifos(PIO_EXT_SPI_BB, blackboxSm);
@@ -99,48 +116,81 @@ void Fckafd::burstSpiWrite(u16 len, const void *src) {
 	free(dummy);
 }
 
+void Fckafd::initSpi(pin_size_t ioBase, pin_size_t sckPin, pin_size_t csPin) {
+	gpio_init(csPin);
+	gpio_set_dir(csPin, GPIO_OUT);
+	gpio_put(csPin, true);
+	gpio_set_slew_rate(csPin, GPIO_SLEW_RATE_FAST);
+	gpio_set_slew_rate(sckPin, GPIO_SLEW_RATE_FAST);
+	gpio_set_slew_rate(ioBase, GPIO_SLEW_RATE_FAST);
+	blackboxSm = pio_claim_unused_sm(PIO_EXT_SPI_BB, true);
+	DEBUG_PRINTF("Got blackbox SM %d\n", blackboxSm);
+	blackboxOffset = pio_add_program(PIO_EXT_SPI_BB, &extended_spi_program);
+	pio_spi_init(PIO_EXT_SPI_BB, blackboxSm, blackboxOffset, 8, 1, sckPin, ioBase, ioBase + 1);
+
+	// set up DMA channels for RX/TX
+	dmaTxChannel = dma_claim_unused_channel(false);
+	dmaRxChannel = dma_claim_unused_channel(false);
+	CRASH_ASSERT(dmaTxChannel < NUM_DMA_CHANNELS && dmaRxChannel < NUM_DMA_CHANNELS); // -1 if none was free
+	dma_channel_config flashDmaTxConfig = dma_channel_get_default_config(dmaTxChannel);
+	dma_channel_config flashDmaRxConfig = dma_channel_get_default_config(dmaRxChannel);
+	channel_config_set_read_increment(&flashDmaTxConfig, true);
+	channel_config_set_write_increment(&flashDmaTxConfig, false);
+	channel_config_set_read_increment(&flashDmaRxConfig, false);
+	channel_config_set_write_increment(&flashDmaRxConfig, true);
+	channel_config_set_dreq(&flashDmaTxConfig, pio_get_dreq(PIO_EXT_SPI_BB, blackboxSm, true));
+	channel_config_set_dreq(&flashDmaRxConfig, pio_get_dreq(PIO_EXT_SPI_BB, blackboxSm, false));
+	channel_config_set_transfer_data_size(&flashDmaTxConfig, DMA_SIZE_8);
+	channel_config_set_transfer_data_size(&flashDmaRxConfig, DMA_SIZE_8);
+	dma_channel_set_config(dmaTxChannel, &flashDmaTxConfig, false);
+	dma_channel_set_config(dmaRxChannel, &flashDmaRxConfig, false);
+	dma_channel_set_write_addr(dmaTxChannel, &PIO_EXT_SPI_BB->txf[blackboxSm], false);
+	dma_channel_set_read_addr(dmaRxChannel, &PIO_EXT_SPI_BB->rxf[blackboxSm], false);
+}
+#endif
+
 bool Fckafd::checkReadId() {
-	gpio_put(PIN_FLASH_CS, false);
+	select();
 	singleSpiTransfer(FLASH_CMD_READ_ID);
 	singleSpiTransfer(); // dummy byte
 	u8 read0 = singleSpiTransfer();
 	u8 read1 = singleSpiTransfer();
-	gpio_put(PIN_FLASH_CS, true);
+	deselect();
 	return read0 == 0x2c && read1 == 0x24;
 }
 
 void Fckafd::reset() {
-	gpio_put(PIN_FLASH_CS, false);
+	select();
 	singleSpiTransfer(FLASH_CMD_RESET);
-	gpio_put(PIN_FLASH_CS, true);
+	deselect();
 }
 
 u8 Fckafd::getFeature(u8 featureRegister) {
-	gpio_put(PIN_FLASH_CS, false);
+	select();
 	singleSpiTransfer(FLASH_CMD_GET_FEATURE);
 	singleSpiTransfer(featureRegister);
 	u8 ret = singleSpiTransfer();
-	gpio_put(PIN_FLASH_CS, true);
+	deselect();
 	return ret;
 }
 
 void Fckafd::setFeature(u8 featureRegister, u8 data) {
-	gpio_put(PIN_FLASH_CS, false);
+	select();
 	singleSpiTransfer(FLASH_CMD_SET_FEATURE);
 	singleSpiTransfer(featureRegister);
 	singleSpiTransfer(data);
-	gpio_put(PIN_FLASH_CS, true);
+	deselect();
 }
 
 void Fckafd::writeEnable() {
-	gpio_put(PIN_FLASH_CS, false);
+	select();
 	singleSpiTransfer(FLASH_CMD_WRITE_ENABLE);
-	gpio_put(PIN_FLASH_CS, true);
+	deselect();
 }
 void Fckafd::writeDisable() {
-	gpio_put(PIN_FLASH_CS, false);
+	select();
 	singleSpiTransfer(FLASH_CMD_WRITE_DISABLE);
-	gpio_put(PIN_FLASH_CS, true);
+	deselect();
 }
 
 bool Fckafd::checkFeature(u8 mask, u8 value, u8 featureRegister) {
@@ -151,69 +201,161 @@ bool Fckafd::checkFeature(u8 mask, u8 value, u8 featureRegister) {
 void Fckafd::invalidateCaches() {
 	cachedBlock = 0xFFFF;
 	cachedPage = 0xFF;
-	for (auto &sc : secCaches) {
-		sc.block = 0xFFFF;
-		sc.page = 0xFF;
-		sc.sector = 0xFF;
-		sc.prio = 0xFF;
+	invalidateCachedPages(0xFFFF);
+}
+
+void Fckafd::invalidateCachedPages(u16 block, u8 page) {
+	// block 0xFFFF: all pages, page 0xFF: all pages of the block
+	for (auto &pc : pageCaches) {
+		if (block != 0xFFFF && (pc.block != block || (page != 0xFF && pc.page != page))) continue;
+		pc.block = 0xFFFF;
+		pc.page = 0xFF;
+		pc.lastUse = 0;
 	}
 }
 
+PageCache *Fckafd::findCachedPage(u16 block, u8 page) {
+	for (auto &pc : pageCaches)
+		if (pc.block == block && pc.page == page) return &pc;
+	return nullptr;
+}
+
 u16 Fckafd::getData(u16 block, u8 page, u16 start, u16 length, u8 *buf) {
 	if ((u32)start + (u32)length > 2176 || length == 0) return 0;
-	// TODO caching
-	// if (start < 2048) {
-	// 	u8 needSecs = 0b0000;
-	// 	if (start < 512 && start + length > 0) needSecs |= 1u << 0;
-	// 	if (start < 1024 && start + length > 512) needSecs |= 1u << 1;
-	// 	if (start < 1536 && start + length > 1024) needSecs |= 1u << 2;
-	// 	if (start < 2048 && start + length > 1536) needSecs |= 1u << 3;
-
-	// 	u8 haveSecs = 0b0000;
-	// 	for (auto &sc : secCaches) {
-	// 		if (sc.prio != 0xFF && sc.block == block && sc.page == page) haveSecs |= 1u << sc.sector;
-	// 	}
-
-	// }
+	block = mapBlock(block);
+	if (start + length <= pageSize) {
+		PageCache *pc = findCachedPage(block, page);
+		if (pc) {
+			memcpy(buf, pc->buf + start, length);
+			return length;
+		}
+	}
 	pageRead(block, page);
 	return readFromCache(block, start, length, buf);
 }
 
-void Fckafd::pageRead(u16 block, u8 page, bool getFeatureWait) {
-	if (cachedBlock == block && cachedPage == page) return;
-	gpio_put(PIN_FLASH_CS, false);
+u16 Fckafd::readCached(u16 block, u8 page, u16 start, u16 length, u8 *buf) {
+	if ((u32)start + (u32)length > pageSize || length == 0) return 0;
+	const u16 phys = mapBlock(block);
+	PageCache *pc = findCachedPage(phys, page);
+	if (pc) {
+		cacheHits++;
+	} else {
+		cacheMisses++;
+		pc = &pageCaches[0];
+		for (auto &c : pageCaches)
+			if (c.lastUse < pc->lastUse) pc = &c;
+		// a page that follows the last loaded one is most likely a download or a log being scanned, the next one will be needed too
+		bool sequential = block == lastLoadedBlock && page == lastLoadedPage + 1;
+		if (page == 0 && lastLoadedPage == pageCount - 1 && block == nextGoodBlock(lastLoadedBlock)) sequential = true;
+		loadPage(phys, page, sequential && page + 1u < pageCount, pc->buf);
+		pc->block = phys;
+		pc->page = page;
+		lastLoadedBlock = block;
+		lastLoadedPage = page;
+	}
+	pc->lastUse = ++cacheUseCounter;
+	memcpy(buf, pc->buf + start, length);
+	return length;
+}
+
+/**
+ * @brief Loads a whole page into dst
+ *
+ * @details With readAhead, the chip reads page + 1 into its data register (PAGE READ CACHE RANDOM) while the cache register is transferred. If that page is requested next, it only has to be moved into the cache register. Read ahead stays within the block, the chip can only move data within a plane.
+ */
+void Fckafd::loadPage(u16 block, u8 page, bool readAhead, u8 *dst) {
+	drain();
+	if (readAheadBlock == block && readAheadPage == page) {
+		readAheads++;
+		sendPageReadCache(block, page + 1, !readAhead);
+	} else {
+		endReadAhead();
+		sendPageRead(block, page);
+		waitReady();
+		if (readAhead) sendPageReadCache(block, page + 1, false);
+	}
+	readStatus = waitReady(); // only the transfer to the cache register, the next page is read in the background
+	cachedBlock = block;
+	cachedPage = page;
+	readFromCache(block, 0, pageSize, dst);
+}
+
+void Fckafd::sendPageReadCache(u16 block, u8 page, bool last) {
+	select();
+	if (last) {
+		singleSpiTransfer(FLASH_CMD_READ_PAGE_CACHE_LAST);
+		readAheadBlock = 0xFFFF;
+		readAheadPage = 0xFF;
+	} else {
+		u32 addr = (page & 0x3F) | ((u32)block << 6);
+		u8 buf[4] = {FLASH_CMD_READ_PAGE_CACHE_RANDOM, (u8)(addr >> 16), (u8)(addr >> 8), (u8)addr};
+		burstSpiWrite(4, buf);
+		readAheadBlock = block;
+		readAheadPage = page;
+	}
+	deselect();
+}
+
+void Fckafd::endReadAhead() {
+	// other commands are only accepted once the chip finished reading ahead, the page in the data register is dropped
+	if (readAheadBlock == 0xFFFF) return;
+	readAheadBlock = 0xFFFF;
+	readAheadPage = 0xFF;
+	while (getFeature() & (FLASH_STATUS_OIP | FLASH_STATUS_CRBSY)) {
+		tight_loop_contents();
+	}
+}
+
+void Fckafd::sendPageRead(u16 block, u8 page) {
+	endReadAhead();
+	select();
 	u32 addr = (page & 0x3F) | ((u32)block << 6);
 	u8 buf[4] = {FLASH_CMD_PAGE_READ, (u8)(addr >> 16), (u8)(addr >> 8), (u8)addr};
 	burstSpiWrite(4, buf);
-	gpio_put(PIN_FLASH_CS, true);
+	deselect();
+}
+
+void Fckafd::pageRead(u16 block, u8 page, bool getFeatureWait) {
+	drain();
+	if (cachedBlock == block && cachedPage == page) return;
+	sendPageRead(block, page);
 	cachedBlock = block;
 	cachedPage = page;
-	if (getFeatureWait) {
-		while (checkFeature(0b1, 0b1)) {
-			tight_loop_contents();
-		}
-	}
+	if (getFeatureWait) readStatus = waitReady();
 }
 
 u16 Fckafd::readFromCache(u16 block, u16 start, u16 length, u8 *buf) {
 	if ((u32)start + (u32)length > 2176 || length == 0) return 0;
 	start |= (block & 0b1) << 12;
 	const u16 lenBackup = length;
-	gpio_put(PIN_FLASH_CS, false);
+	select();
 	u8 req[4] = {FLASH_CMD_READ_FROM_CACHE_X1, (u8)(start >> 8), (u8)start, 0};
 	burstSpiWrite(4, req);
 	burstSpiRead(length, buf);
-	gpio_put(PIN_FLASH_CS, true);
+	deselect();
 	return lenBackup;
 }
 
-void Fckafd::eraseBlock(u16 block, bool getFeatureWait) {
+void Fckafd::sendBlockErase(u16 block) {
+	endReadAhead();
 	writeEnable();
-	gpio_put(PIN_FLASH_CS, false);
+	select();
 	u32 addr = (u32)block << 6;
 	u8 buf[4] = {FLASH_CMD_BLOCK_ERASE, (u8)(addr >> 16), (u8)(addr >> 8), (u8)(addr)};
 	burstSpiWrite(4, buf);
-	gpio_put(PIN_FLASH_CS, true);
+	deselect();
+	if (eraseCounts && block < FCKAFD_MAX_BLOCKS) eraseCounts[block]++;
+	invalidateCachedPages(block);
+	if (cachedBlock == block) {
+		cachedBlock = 0xFFFF;
+		cachedPage = 0xFF;
+	}
+}
+
+void Fckafd::eraseBlock(u16 block, bool getFeatureWait) {
+	drain();
+	sendBlockErase(block);
 	if (getFeatureWait) {
 		while (checkFeature(0b1, 0b1)) {
 			tight_loop_contents();
@@ -221,36 +363,59 @@ void Fckafd::eraseBlock(u16 block, bool getFeatureWait) {
 	}
 }
 
-u16 Fckafd::programLoad(u16 block, u16 start, u16 length, const u8 *buf) {
-	if ((u32)start + (u32)length > 2176) return 0;
+void Fckafd::sendProgramLoad(u16 block, u16 start, u16 length, const u8 *buf) {
+	endReadAhead();
 	writeEnable();
 	start |= (block & 0b1) << 12;
-	const u16 lenBackup = length;
-	gpio_put(PIN_FLASH_CS, false);
+	select();
 	u8 req[3] = {FLASH_CMD_PROGRAM_LOAD_X1, (u8)(start >> 8), (u8)start};
 	burstSpiWrite(3, req);
 	burstSpiWrite(length, buf);
-	gpio_put(PIN_FLASH_CS, true);
+	deselect();
 	cachedBlock = 0xFFFF;
 	cachedPage = 0xFF;
-	return lenBackup;
 }
 
-void Fckafd::programExecute(u16 block, u8 page, bool getFeatureWait) {
+void Fckafd::sendProgramLoadRandom(u16 block, u16 start, u16 length, const u8 *buf) {
+	// unlike PROGRAM LOAD, this keeps the rest of the cache register
+	start |= (block & 0b1) << 12;
+	select();
+	u8 req[3] = {FLASH_CMD_PROGRAM_LOAD_RANDOM_DATA_X1, (u8)(start >> 8), (u8)start};
+	burstSpiWrite(3, req);
+	burstSpiWrite(length, buf);
+	deselect();
+}
+
+void Fckafd::loadProgramData(const FlashJob &job, u16 block) {
+	FckafdPageTag tag;
+	tag.serial = job.serial;
+	tag.seq = job.seq;
+	tag.length = job.length;
+	tag.check = tagCheck(tag);
+	sendProgramLoad(block, 0, job.length, pageBufs[job.bufIndex]);
+	sendProgramLoadRandom(block, FCKAFD_TAG_COLUMN, sizeof(tag), (u8 *)&tag);
+}
+
+u16 Fckafd::programLoad(u16 block, u16 start, u16 length, const u8 *buf) {
+	if ((u32)start + (u32)length > 2176) return 0;
+	drain();
+	sendProgramLoad(block, start, length, buf);
+	return length;
+}
+
+void Fckafd::sendProgramExecute(u16 block, u8 page) {
 	writeEnable();
-	gpio_put(PIN_FLASH_CS, false);
+	select();
 	u32 addr = (page & 0x3F) | ((u32)block << 6);
 	u8 buf[4] = {FLASH_CMD_PROGRAM_EXECUTE, (u8)(addr >> 16), (u8)(addr >> 8), (u8)addr};
 	burstSpiWrite(4, buf);
-	gpio_put(PIN_FLASH_CS, true);
-	for (auto &sc : secCaches) {
-		if (sc.block == block && sc.page == page) {
-			sc.block = 0xFFFF;
-			sc.page = 0xFF;
-			sc.prio = 0xFF;
-			sc.sector = 0xFF;
-		}
-	}
+	deselect();
+	invalidateCachedPages(block, page);
+}
+
+void Fckafd::programExecute(u16 block, u8 page, bool getFeatureWait) {
+	// no drain() here: this always follows programLoad(), which already drained the queue
+	sendProgramExecute(block, page);
 	if (getFeatureWait) {
 		while (checkFeature(0b1, 0b1)) {
 			tight_loop_contents();
@@ -258,39 +423,248 @@ void Fckafd::programExecute(u16 block, u8 page, bool getFeatureWait) {
 	}
 }
 
+//==============================JOB QUEUE=================================//
+u8 *Fckafd::getPageBuffer() {
+	while (true) {
+		for (int i = 0; i < FLASH_PAGE_BUFFERS; i++) {
+			if (!(pageBufsInUse & (1 << i))) {
+				pageBufsInUse |= 1 << i;
+				return pageBufs[i];
+			}
+		}
+		loop();
+	}
+}
+
+u8 Fckafd::freePageBuffers() {
+	u8 free = 0;
+	for (int i = 0; i < FLASH_PAGE_BUFFERS; i++)
+		if (!(pageBufsInUse & (1 << i))) free++;
+	return free;
+}
+
+void Fckafd::pushJob(const FlashJob &job) {
+	while (((jobHead + 1) & (FLASH_JOB_QUEUE_SIZE - 1)) == jobTail) {
+		loop();
+	}
+	jobs[jobHead] = job;
+	jobHead = (jobHead + 1) & (FLASH_JOB_QUEUE_SIZE - 1);
+	loop(); // start it right away if the chip is idle
+}
+
+void Fckafd::queueProgram(u16 block, u8 page, u16 length, u8 *buf, u32 serial, u32 seq) {
+	FlashJob job;
+	job.type = FlashJobType::PROGRAM;
+	job.block = mapBlock(block);
+	job.page = page;
+	job.length = length;
+	job.bufIndex = (buf - pageBufs[0]) / sizeof(pageBufs[0]);
+	job.serial = serial;
+	job.seq = seq;
+	pushJob(job);
+}
+
+void Fckafd::queueErase(u16 block) {
+	FlashJob job;
+	job.type = FlashJobType::ERASE;
+	job.block = mapBlock(block);
+	job.page = 0;
+	job.length = 0;
+	job.bufIndex = 0xFF;
+	job.serial = 0;
+	job.seq = 0;
+	pushJob(job);
+}
+
+void Fckafd::startJob(const FlashJob &job) {
+	switch (job.type) {
+	case FlashJobType::PROGRAM:
+		loadProgramData(job, job.block);
+		sendProgramExecute(job.block, job.page);
+		break;
+	case FlashJobType::ERASE:
+		sendBlockErase(job.block);
+		break;
+	}
+}
+
+void Fckafd::loop() {
+	if (jobRunning) {
+		u8 status = getFeature();
+		if (status & FLASH_STATUS_OIP) return;
+
+		FlashJob &job = jobs[jobTail];
+		if (job.type == FlashJobType::PROGRAM) {
+			if (status & FLASH_STATUS_P_FAIL) {
+				programFailures++;
+				relocateBlock(job);
+			}
+			pageBufsInUse &= ~(1 << job.bufIndex);
+		} else if (status & FLASH_STATUS_E_FAIL) {
+			eraseFailures++;
+			relocateBlock(job);
+		}
+		jobTail = (jobTail + 1) & (FLASH_JOB_QUEUE_SIZE - 1);
+		jobRunning = false;
+	}
+	if (jobTail == jobHead) {
+		if (remapsDirty) {
+			remapsDirty = false; // before writing, writeRemapSlot() calls loop() again through drain()
+			writeRemapSlot();
+		}
+		return;
+	}
+	startJob(jobs[jobTail]);
+	jobRunning = true;
+}
+
+void Fckafd::drain() {
+	while (jobRunning || jobTail != jobHead) {
+		loop();
+	}
+}
+
+//==============================BAD BLOCKS================================//
+// Blocks that are bad when formatting are marked in the bad block bitmap and skipped by files (nextGoodBlock()).
+// Blocks that fail later are replaced by a spare block (mapBlock()), so that the block numbers of existing files stay valid.
+
+u8 Fckafd::waitReady() {
+	u8 status;
+	do {
+		status = getFeature();
+	} while (status & FLASH_STATUS_OIP);
+	return status;
+}
+
+u16 Fckafd::nextGoodBlock(u16 block) {
+	do {
+		block++;
+	} while (block < maxBbBlock && isBadBlock(block));
+	return block;
+}
+
+u16 Fckafd::mapBlock(u16 block) {
+	for (int i = 0; i < remapCount; i++)
+		if (remaps[i].block == block) return remaps[i].spare;
+	return block;
+}
+
+u16 Fckafd::allocateSpare(u16 failedBlock) {
+	for (u16 b = spareStart; b <= maxBbBlock; b++) {
+		// internal data moves only work within the same plane
+		if ((b & 1) != (failedBlock & 1) || isBadBlock(b) || b == failedBlock) continue;
+		bool used = false;
+		for (int i = 0; i < remapCount; i++)
+			if (remaps[i].spare == b) used = true;
+		if (!used) return b;
+	}
+	return 0xFFFF;
+}
+
+void Fckafd::markBad(u16 block) {
+	// bad block marker: first byte of the spare area of page 0, recognized by the next format()
+	u8 marker = 0;
+	sendProgramLoad(block, 2048, 1, &marker);
+	sendProgramExecute(block, 0);
+	waitReady();
+	DEBUG_PRINTF("Marked block %d as bad\n", block);
+}
+
+/**
+ * @brief Replaces a block after a failed program or erase job
+ *
+ * @details The pages that were already programmed are moved to a spare block on chip (page read + program execute), then the failed page is programmed again from its page buffer. Queued jobs for the failed block are redirected to the spare block. The new remap is written to the file table once the queue is empty. Blocks, but only runs on failures.
+ */
+void Fckafd::relocateBlock(const FlashJob &job) {
+	const u16 failed = job.block;
+	for (int attempt = 0; attempt < 3; attempt++) {
+		const u16 spare = allocateSpare(failed);
+		if (spare == 0xFFFF) break;
+		bool ok = true;
+		sendBlockErase(spare);
+		if (waitReady() & FLASH_STATUS_E_FAIL) ok = false;
+		if (ok && job.type == FlashJobType::PROGRAM) {
+			for (u8 p = 0; ok && p < job.page; p++) {
+				sendPageRead(failed, p);
+				waitReady();
+				sendProgramExecute(spare, p);
+				if (waitReady() & FLASH_STATUS_P_FAIL) ok = false;
+			}
+			if (ok) {
+				loadProgramData(job, spare);
+				sendProgramExecute(spare, job.page);
+				if (waitReady() & FLASH_STATUS_P_FAIL) ok = false;
+			}
+		}
+		cachedBlock = 0xFFFF;
+		cachedPage = 0xFF;
+		if (!ok) {
+			// the spare block itself is bad, it is outside of the data area, so it can be marked in the bitmap right away
+			markBad(spare);
+			badBlockBitmap[spare / 8] &= ~(1 << (spare % 8));
+			continue;
+		}
+
+		// a spare block that fails again is replaced in its existing remap
+		bool found = false;
+		for (int i = 0; i < remapCount; i++) {
+			if (remaps[i].spare == failed) {
+				remaps[i].spare = spare;
+				found = true;
+			}
+		}
+		if (!found) {
+			remaps[remapCount].block = failed;
+			remaps[remapCount].spare = spare;
+			remapCount++;
+		}
+		remapsDirty = true;
+		markBad(failed);
+		for (u8 j = (jobTail + 1) & (FLASH_JOB_QUEUE_SIZE - 1); j != jobHead; j = (j + 1) & (FLASH_JOB_QUEUE_SIZE - 1))
+			if (jobs[j].block == failed) jobs[j].block = spare;
+		DEBUG_PRINTF("Replaced block %d with spare block %d\n", failed, spare);
+		return;
+	}
+	DEBUG_PRINTF("No spare block left for block %d, data lost\n", failed);
+}
+
+FckafdHealth Fckafd::getHealth() {
+	FckafdHealth h = {};
+	h.blockCount = maxBbBlock + 1;
+	h.minEraseCount = 0xFFFF;
+	h.programFailures = programFailures;
+	h.eraseFailures = eraseFailures;
+	h.cacheHits = cacheHits;
+	h.cacheMisses = cacheMisses;
+	h.readAheads = readAheads;
+	h.remappedBlocks = remapCount;
+	for (u16 b = 0; b <= maxBbBlock; b++) {
+		if (isBadBlock(b)) {
+			h.factoryBadBlocks++;
+			continue;
+		}
+		if (b >= spareStart) continue;
+		u16 count = eraseCounts ? eraseCounts[b] : 0;
+		h.totalEraseCount += count;
+		if (count < h.minEraseCount) h.minEraseCount = count;
+		if (count > h.maxEraseCount) h.maxEraseCount = count;
+	}
+	for (u16 b = spareStart; b <= maxBbBlock; b++) {
+		if (isBadBlock(b)) continue;
+		bool used = false;
+		for (int i = 0; i < remapCount; i++)
+			if (remaps[i].spare == b) used = true;
+		if (!used) h.sparesLeft++;
+	}
+	if (h.minEraseCount == 0xFFFF) h.minEraseCount = 0;
+	return h;
+}
+
 //==============================FCKAFD====================================//
 bool Fckafd::begin(pin_size_t ioBase, pin_size_t sckPin, pin_size_t csPin, bool &fsReady) {
 	fsReady = false;
 
-	// set up SPI
-	gpio_init(csPin);
-	gpio_set_dir(csPin, GPIO_OUT);
-	gpio_put(csPin, true);
-	gpio_set_slew_rate(csPin, GPIO_SLEW_RATE_FAST);
-	gpio_set_slew_rate(sckPin, GPIO_SLEW_RATE_FAST);
-	gpio_set_slew_rate(ioBase, GPIO_SLEW_RATE_FAST);
-	blackboxSm = pio_claim_unused_sm(PIO_EXT_SPI_BB, true);
-	DEBUG_PRINTF("Got blackbox SM %d\n", blackboxSm);
-	blackboxOffset = pio_add_program(PIO_EXT_SPI_BB, &extended_spi_program);
-	pio_spi_init(PIO_EXT_SPI_BB, blackboxSm, blackboxOffset, 8, 1, sckPin, ioBase, ioBase + 1);
-
-	// set up DMA channels for RX/TX
-	dmaTxChannel = dma_claim_unused_channel(true);
-	dmaRxChannel = dma_claim_unused_channel(true);
-	dma_channel_config flashDmaTxConfig = dma_channel_get_default_config(dmaTxChannel);
-	dma_channel_config flashDmaRxConfig = dma_channel_get_default_config(dmaRxChannel);
-	channel_config_set_read_increment(&flashDmaTxConfig, true);
-	channel_config_set_write_increment(&flashDmaTxConfig, false);
-	channel_config_set_read_increment(&flashDmaRxConfig, false);
-	channel_config_set_write_increment(&flashDmaRxConfig, true);
-	channel_config_set_dreq(&flashDmaTxConfig, pio_get_dreq(PIO_EXT_SPI_BB, blackboxSm, true));
-	channel_config_set_dreq(&flashDmaRxConfig, pio_get_dreq(PIO_EXT_SPI_BB, blackboxSm, false));
-	channel_config_set_transfer_data_size(&flashDmaTxConfig, DMA_SIZE_8);
-	channel_config_set_transfer_data_size(&flashDmaRxConfig, DMA_SIZE_8);
-	dma_channel_set_config(dmaTxChannel, &flashDmaTxConfig, false);
-	dma_channel_set_config(dmaRxChannel, &flashDmaRxConfig, false);
-	dma_channel_set_write_addr(dmaTxChannel, &PIO_EXT_SPI_BB->txf[blackboxSm], false);
-	dma_channel_set_read_addr(dmaRxChannel, &PIO_EXT_SPI_BB->rxf[blackboxSm], false);
+	initSpi(ioBase, sckPin, csPin);
 
 	// find flash chip
 	for (int i = 0; i < 50; i++) {
@@ -347,86 +721,536 @@ bool Fckafd::begin(pin_size_t ioBase, pin_size_t sckPin, pin_size_t csPin, bool
 		return false;
 	}
 
-	// Block 0:
-	// Page 0 sector 0: Filesystem metadata: magic, version, anything else?
-	// TODO Page 0 sector 1: ~Bad blocks that should be avoided (just set the corresponding bit to 0 to indicate that)
-	// if filesystem magic not found: format filesystem (erase blocks 0-1999, recreate block 0 with no files in it; usually sector 1 of page 0 of block 0 would be cached and rewritten afterwards)
+	if (blockCount > FCKAFD_MAX_BLOCKS) {
+		DEBUG_PRINTF("Block count refused %d\n", blockCount);
+		free(buf);
+		return false;
+	}
+	spareStart = maxBbBlock + 1 - FCKAFD_SPARE_BLOCKS;
+	memset(badBlockBitmap, 0xFF, sizeof(badBlockBitmap));
+	if (!eraseCounts) eraseCounts = (u16 *)calloc(FCKAFD_MAX_BLOCKS, sizeof(u16));
+	if (!eraseCounts) {
+		free(buf);
+		return false;
+	}
 
-	pageRead(0, 0);
-	readFromCache(0, 0, 256, buf);
+	// Meta blocks (the first two good blocks, usually 0 and 1), only one of them is in use:
+	// Page 0 sector 0: Filesystem metadata: magic, version, generation (the meta block with the higher generation is the current one), number of slots whose erases are included in the erase counts
+	// Page 0 sector 1: Bad blocks that should be avoided (bit is 0 for bad blocks)
+	// Pages 1-59: file table, 2 slots of 1024 bytes per page. Each slot is a file, a tombstone, a list of remapped blocks or the end of a recovered file
+	// Pages 60-63: u16 erase count per block, as of the last compaction/format
+	// Data pages: a FckafdPageTag in the spare area identifies the file and the position of the page, to find the end of files that were not closed
+	// if filesystem magic not found: format filesystem (erase all blocks, recreate block 0 with no files in it)
+	// if it is another version: keep it until the user formats it (otherVersion), an automatic format would take the logs with it
 
-	bool isValidFs = true;
-	// Filesystem that Captures Kolibri's Awesome Flight Data
-	if (memcmp(&buf[0], "FCKAFD", 6)) isValidFs = false;
-	// check version 0.1.0
-	if (buf[6] != 0) isValidFs = false;
-	if (buf[7] != 1) isValidFs = false;
-	if (buf[8] != 0) isValidFs = false;
-	DEBUG_PRINTF("%s %d %d %d\n", buf, buf[6], buf[7], buf[8]);
+	chipReady = true;
+	if (!findMetaBlocks()) {
+		DEBUG_PRINTLN("No good blocks for the FCKAFD file table");
+		free(buf);
+		return true;
+	}
 
-	if (isValidFs) {
-		u16 checkBlock = 0xFFFF;
-		u16 firstFreeBlock = 0;
-
-		for (int page = 1; page < 64; page++) {
-			pageRead(0, page);
-			for (int i = 0; i < 2; i++) {
-				readFromCache(0, 1024 * i, 1024, buf);
-				if (buf[0] != 0) break; // file table end reached
-				if (buf[512] != 1) {
-					// file incomplete, intiate check block
-					checkBlock = DECODE_U2(&buf[3]);
-					break;
-				}
-				firstFreeBlock = DECODE_U2(&buf[1]) + 1;
-			}
-			if (checkBlock != 0xFFFF) break;
-		}
-		if (checkBlock != 0xFFFF) {
-			// TODO check block, broken file
+	u32 bestGen = 0;
+	bool isValidFs = false;
+	bool foundOther = false;
+	for (u16 block : metaBlocks) {
+		pageRead(block, 0);
+		readFromCache(block, 0, 14, buf);
+		// Filesystem that Captures Kolibri's Awesome Flight Data
+		if (memcmp(&buf[0], "FCKAFD", 6)) continue;
+		// check version 0.2.0
+		if (buf[6] != 0 || buf[7] != 2 || buf[8] != 0) {
+			DEBUG_PRINTF("FCKAFD %d.%d.%d in block %d\n", buf[6], buf[7], buf[8], block);
+			foundOther = true;
+			continue;
 		}
-		fsReady = true;
-		this->fsReady = true;
+		u32 gen = DECODE_U4(&buf[9]);
+		if (gen == 0xFFFFFFFF || (isValidFs && gen <= bestGen)) continue;
+		isValidFs = true;
+		bestGen = gen;
+		metaBlock = block;
+		accountedSlots = buf[13];
 	}
+	otherVersion = !isValidFs && foundOther;
+	DEBUG_PRINTF("FCKAFD valid %d, meta block %d, generation %d\n", isValidFs, metaBlock, bestGen);
 
-	chipReady = true;
+	if (isValidFs) {
+		generation = bestGen;
+		getData(metaBlock, 0, 512, 512, badBlockBitmap);
+		for (u32 i = 0; i * 1024 < blockCount; i++)
+			getData(metaBlock, FCKAFD_WEAR_PAGE + i, 0, 2048, (u8 *)&eraseCounts[i * 1024]);
+		for (u32 i = 0; i < blockCount; i++)
+			if (eraseCounts[i] == 0xFFFF) eraseCounts[i] = 0;
+		if (scanFileTable(true)) {
+			// a file that was not closed (power loss while logging) is closed where its last programmed page is
+			for (int i = 0; i < fileCount; i++)
+				if (files[i].lastBlock == 0xFFFF) recoverFile(i);
+			fsReady = true;
+			this->fsReady = true;
+		}
+	}
 
 	free(buf);
 	return true;
 }
 
+bool Fckafd::findMetaBlocks() {
+	// NAND vendors only guarantee block 0, the file table goes into the first two blocks without a bad block marker. The markers survive format(), so begin() finds the same blocks again
+	u8 found = 0;
+	for (u16 b = 0; b < FCKAFD_META_SEARCH_BLOCKS && found < FCKAFD_META_BLOCKS; b++) {
+		u8 marker;
+		pageRead(b, 0);
+		readFromCache(b, 2048, 1, &marker);
+		if (marker == 0xFF) metaBlocks[found++] = b;
+	}
+	if (found < FCKAFD_META_BLOCKS) return false;
+	firstDataBlock = metaBlocks[FCKAFD_META_BLOCKS - 1] + 1;
+	return true;
+}
+
+bool Fckafd::writeMetaHeader(u16 block, u32 gen, u8 accounted) {
+	u8 buf[14] = "FCKAFD";
+	buf[6] = 0;
+	buf[7] = 2;
+	buf[8] = 0;
+	memcpy(&buf[9], &gen, 4);
+	buf[13] = accounted;
+	programLoad(block, 0, 14, buf);
+	programExecute(block, 0);
+	u8 buf2[14];
+	getData(block, 0, 0, 14, buf2);
+	return memcmp(buf, buf2, 14) == 0;
+}
+
+void Fckafd::writeWearPages(u16 block) {
+	programLoad(block, 512, sizeof(badBlockBitmap), badBlockBitmap);
+	programExecute(block, 0);
+	for (u32 i = 0; i * 1024 < blockCount; i++) {
+		programLoad(block, 0, 2048, (u8 *)&eraseCounts[i * 1024]);
+		programExecute(block, FCKAFD_WEAR_PAGE + i);
+	}
+}
+
 bool Fckafd::format(u8 partition) {
 	if (!chipReady) return false;
 	if (partition != 0) return false;
-	for (int i = 0; i < maxBbBlock; i++) {
-		eraseBlock(i);
+	if (writeOpen) return false;
+	drain();
+	// erase counts survive a format if the filesystem was mounted before
+	if (!fsReady) memset(eraseCounts, 0, FCKAFD_MAX_BLOCKS * sizeof(u16));
+	memset(badBlockBitmap, 0xFF, sizeof(badBlockBitmap));
+	// a block that failed at runtime may not have taken its bad block marker either
+	if (fsReady)
+		for (int i = 0; i < remapCount; i++)
+			badBlockBitmap[remaps[i].block / 8] &= ~(1 << (remaps[i].block % 8));
+	u16 badBlocks = 0;
+	for (u32 i = 0; i <= maxBbBlock; i++) {
 		rp2040.wdt_reset();
+		if (isBadBlock(i)) {
+			badBlocks++;
+			continue;
+		}
+		// factory bad blocks and blocks that failed at runtime have a bad block marker, which an erase would remove
+		u8 marker;
+		pageRead(i, 0);
+		readFromCache(i, 2048, 1, &marker);
+		if (marker != 0xFF) {
+			badBlockBitmap[i / 8] &= ~(1 << (i % 8));
+			badBlocks++;
+			continue;
+		}
+		eraseBlock(i);
 	}
-	u8 buf[9] = "FCKAFD";
-	buf[6] = 0;
-	buf[7] = 1;
-	buf[8] = 0;
-	DEBUG_PRINTF("fmt %s %d %d %d\n", buf, buf[6], buf[7], buf[8]);
-	programLoad(0, 0, 9, buf);
-	programExecute(0, 0);
-	pageRead(0, 0);
-	u8 buf2[9];
-	readFromCache(0, 0, 9, buf2);
-	fsReady = memcmp(buf, buf2, 9) == 0;
+	DEBUG_PRINTF("fmt FCKAFD 0.2.0, %d bad blocks\n", badBlocks);
+	if (!findMetaBlocks()) return false;
+	metaBlock = metaBlocks[0];
+	generation = 1;
+	fileCount = 0;
+	usedSlots = 0;
+	accountedSlots = 0;
+	remapCount = 0;
+	remapsDirty = false;
+	writeWearPages(metaBlock);
+	fsReady = writeMetaHeader(metaBlock, generation, 0);
+	if (fsReady) otherVersion = false;
 	return fsReady;
 }
 
+void Fckafd::countFileErases(u16 firstBlock, u16 lastBlock) {
+	// a file erases its blocks and the one after it (erase ahead), lastBlock is unknown if it was not closed
+	if (lastBlock == 0xFFFF) lastBlock = firstBlock;
+	for (u16 b = firstBlock; b < spareStart; b = nextGoodBlock(b)) {
+		eraseCounts[b]++;
+		if (b > lastBlock) break;
+	}
+}
+
+u16 Fckafd::slotCheck(const u8 *buf, u16 length) {
+	// Fletcher-16, never 0xFFFF, so erased bytes never pass
+	u16 a = 0, b = 0;
+	for (u16 i = 0; i < length; i++) {
+		a = (a + buf[i]) % 255;
+		b = (b + a) % 255;
+	}
+	return a | b << 8;
+}
+
+bool Fckafd::scanFileTable(bool countErases) {
+	fileCount = 0;
+	remapCount = 0;
+	usedSlots = FCKAFD_MAX_SLOTS;
+	u8 buf[2 + FCKAFD_MAX_TOMBSTONE_FILES * 2 + 2];
+	for (u8 slot = 0; slot < FCKAFD_MAX_SLOTS; slot++) {
+		const u8 page = slotPage(slot);
+		const u16 offset = slotOffset(slot);
+		getData(metaBlock, page, offset, 2, buf);
+		u16 length = 0;
+		if (buf[0] == FCKAFD_SLOT_FILE)
+			length = 13;
+		else if (buf[0] == FCKAFD_SLOT_CLOSE)
+			length = 9;
+		else if (buf[0] == FCKAFD_SLOT_TOMBSTONE)
+			length = 2 + buf[1] * 2;
+		else if (buf[0] == FCKAFD_SLOT_REMAP && buf[1] <= FCKAFD_SPARE_BLOCKS)
+			length = 2 + buf[1] * 4;
+		if (buf[0] == FCKAFD_SLOT_FREE) {
+			getData(metaBlock, page, offset, 512, buf);
+			bool erased = true;
+			for (int i = 0; i < 512; i++)
+				if (buf[i] != 0xFF) erased = false;
+			if (erased) {
+				usedSlots = slot; // file table end reached
+				break;
+			}
+		}
+		// a slot that was programmed during a power loss is torn. It can only be the last slot, it is skipped, but stays used
+		if (length) getData(metaBlock, page, offset, length + 2, buf);
+		if (!length || DECODE_U2(&buf[length]) != slotCheck(buf, length)) {
+			DEBUG_PRINTF("Skipping torn file table slot %d\n", slot);
+			continue;
+		}
+
+		if (buf[0] == FCKAFD_SLOT_FILE) {
+			FckafdFile &f = files[fileCount++];
+			f.fileNum = DECODE_U2(&buf[1]);
+			f.firstBlock = DECODE_U2(&buf[3]);
+			f.slot = slot;
+			f.recovered = false;
+			getData(metaBlock, page, offset + 512, 9, buf);
+			if (buf[0] == 1 && DECODE_U2(&buf[7]) == slotCheck(buf, 7)) {
+				f.lastBlock = DECODE_U2(&buf[1]);
+				f.size = DECODE_U4(&buf[3]);
+				if (countErases && slot >= accountedSlots) countFileErases(f.firstBlock, f.lastBlock);
+			} else {
+				// not closed, see recoverFile()
+				f.lastBlock = 0xFFFF;
+				f.size = 0;
+			}
+		} else if (buf[0] == FCKAFD_SLOT_CLOSE) {
+			i16 index = findFile(DECODE_U2(&buf[1]));
+			if (index < 0) continue;
+			FckafdFile &f = files[index];
+			f.lastBlock = DECODE_U2(&buf[3]);
+			f.size = DECODE_U4(&buf[5]);
+			f.recovered = true;
+			if (countErases && f.slot >= accountedSlots) countFileErases(f.firstBlock, f.lastBlock);
+		} else if (buf[0] == FCKAFD_SLOT_TOMBSTONE) {
+			for (int i = 0; i < buf[1]; i++) {
+				i16 index = findFile(DECODE_U2(&buf[2 + i * 2]));
+				if (index >= 0) removeFromTable(index);
+			}
+		} else if (buf[0] == FCKAFD_SLOT_REMAP) {
+			// each remap slot holds the complete list
+			remapCount = buf[1];
+			for (int i = 0; i < remapCount; i++) {
+				remaps[i].block = DECODE_U2(&buf[2 + i * 4]);
+				remaps[i].spare = DECODE_U2(&buf[2 + i * 4 + 2]);
+			}
+		}
+	}
+	DEBUG_PRINTF("Found %d files and %d remapped blocks in %d slots\n", fileCount, remapCount, usedSlots);
+	return true;
+}
+
+bool Fckafd::readChecked(u16 block, u8 page, u16 start, u16 length, u8 *buf) {
+	// the ECC status covers the whole page, so this only suits pages that are programmed at once
+	block = mapBlock(block);
+	pageRead(block, page);
+	readFromCache(block, start, length, buf);
+	return ((readStatus >> 4) & 0b111) != 0b010;
+}
+
+bool Fckafd::readTag(u16 firstBlock, u32 serial, u32 seq, FckafdPageTag &tag, u16 &block) {
+	block = firstBlock;
+	for (u32 i = seq / pageCount; i && block < spareStart; i--)
+		block = nextGoodBlock(block);
+	if (block >= spareStart) return false;
+	if (!readChecked(block, seq % pageCount, FCKAFD_TAG_COLUMN, sizeof(tag), (u8 *)&tag)) return false;
+	return tag.serial == serial && tag.seq == seq && tag.length <= pageSize && tag.check == tagCheck(tag);
+}
+
+/**
+ * @brief Finds the end of a file that was not closed and closes it there
+ *
+ * @details Pages are programmed in order and each carries its position in the file, so the pages with a valid tag form a prefix of the file. A binary search over the page index finds its end with about 20 page reads. Data that was still in RAM and the correction bytes of the file are lost.
+ */
+bool Fckafd::recoverFile(u16 index) {
+	FckafdFile &f = files[index];
+	u8 buf[4];
+	getData(metaBlock, slotPage(f.slot), slotOffset(f.slot) + 9, 4, buf);
+	const u32 serial = DECODE_U4(buf);
+	u32 lo = 0; // pages [0, lo) are valid
+	u32 hi = (u32)(spareStart - f.firstBlock) * pageCount; // pages [hi, ...) are not
+	FckafdPageTag tag;
+	u16 block;
+	u32 size = 0;
+	u16 lastBlock = f.firstBlock;
+	while (lo < hi) {
+		const u32 mid = (lo + hi) / 2;
+		if (readTag(f.firstBlock, serial, mid, tag, block)) {
+			lo = mid + 1;
+			size = mid * pageSize + tag.length;
+			lastBlock = block;
+		} else {
+			hi = mid;
+		}
+	}
+	f.lastBlock = lastBlock;
+	f.size = size;
+	f.recovered = true;
+	if (f.slot >= accountedSlots) countFileErases(f.firstBlock, f.lastBlock);
+	DEBUG_PRINTF("Recovered file %d: %d bytes, last block %d\n", f.fileNum, size, lastBlock);
+	return writeCloseSlot(f);
+}
+
+bool Fckafd::writeCloseSlot(const FckafdFile &f) {
+	// compacting writes the end into the file's own slot
+	if (usedSlots >= FCKAFD_MAX_SLOTS) return compactFileTable();
+	u8 buf[11];
+	buf[0] = FCKAFD_SLOT_CLOSE;
+	memcpy(&buf[1], &f.fileNum, 2);
+	memcpy(&buf[3], &f.lastBlock, 2);
+	memcpy(&buf[5], &f.size, 4);
+	const u16 check = slotCheck(buf, 9);
+	memcpy(&buf[9], &check, 2);
+	const u8 slot = usedSlots++;
+	programLoad(metaBlock, slotOffset(slot), sizeof(buf), buf);
+	programExecute(metaBlock, slotPage(slot));
+	return true;
+}
+
+/**
+ * @brief Moves all live files to the other meta block, dropping tombstones and deleted files
+ *
+ * @details The new table is only valid once its header with the next generation is written, so a power loss during compaction leaves the old table in place. The current erase counts and the bad block bitmap are written along with it.
+ */
+bool Fckafd::compactFileTable() {
+	const u16 oldMeta = metaBlock;
+	const u16 newMeta = metaBlock == metaBlocks[0] ? metaBlocks[1] : metaBlocks[0];
+	u8 *buf = (u8 *)malloc(2048);
+	if (!buf) return false;
+	eraseBlock(newMeta);
+	// remaps go into slot 0 if there are any, files follow
+	const u8 first = remapCount ? 1 : 0;
+	const u8 total = first + fileCount;
+	if (remapCount) {
+		memset(buf, 0xFF, 1024);
+		buf[0] = FCKAFD_SLOT_REMAP;
+		buf[1] = remapCount;
+		memcpy(&buf[2], remaps, remapCount * 4);
+		const u16 check = slotCheck(buf, 2 + remapCount * 4);
+		memcpy(&buf[2 + remapCount * 4], &check, 2);
+	}
+	for (int s = first; s < total; s++) {
+		rp2040.wdt_reset();
+		FckafdFile &f = files[s - first];
+		const u8 half = s % 2;
+		getData(oldMeta, slotPage(f.slot), slotOffset(f.slot), 1024, buf + half * 1024);
+		if (f.recovered) {
+			// the close slot is dropped, the end goes into the file slot like for a closed file
+			u8 *close = buf + half * 1024 + 512;
+			memset(close, 0xFF, 512);
+			close[0] = 1;
+			memcpy(&close[1], &f.lastBlock, 2);
+			memcpy(&close[3], &f.size, 4);
+			const u16 check = slotCheck(close, 7);
+			memcpy(&close[7], &check, 2);
+			f.recovered = false;
+		}
+		f.slot = s;
+		if (half || s == total - 1) {
+			// only program the second half if it holds a file, so that it can still be written later
+			programLoad(newMeta, 0, half ? 2048 : 1024, buf);
+			programExecute(newMeta, slotPage(s));
+		}
+	}
+	if (total == 1 && remapCount) {
+		programLoad(newMeta, 0, 1024, buf);
+		programExecute(newMeta, slotPage(0));
+	}
+	free(buf);
+	writeWearPages(newMeta);
+	if (!writeMetaHeader(newMeta, generation + 1, total)) {
+		scanFileTable(); // slots were already changed
+		return false;
+	}
+	metaBlock = newMeta;
+	generation++;
+	usedSlots = total;
+	accountedSlots = total;
+	remapsDirty = false;
+	eraseBlock(oldMeta);
+	DEBUG_PRINTF("Compacted file table into block %d, %d files\n", newMeta, fileCount);
+	return true;
+}
+
+bool Fckafd::writeRemapSlot() {
+	if (usedSlots >= FCKAFD_MAX_SLOTS) return compactFileTable();
+	u8 buf[2 + FCKAFD_SPARE_BLOCKS * 4 + 2];
+	buf[0] = FCKAFD_SLOT_REMAP;
+	buf[1] = remapCount;
+	memcpy(&buf[2], remaps, remapCount * 4);
+	const u16 check = slotCheck(buf, 2 + remapCount * 4);
+	memcpy(&buf[2 + remapCount * 4], &check, 2);
+	const u8 slot = usedSlots++;
+	programLoad(metaBlock, slotOffset(slot), 2 + remapCount * 4 + 2, buf);
+	programExecute(metaBlock, slotPage(slot));
+	return true;
+}
+
+bool Fckafd::writeTombstone(const u16 *fileNums, u16 count) {
+	if (count > FCKAFD_MAX_TOMBSTONE_FILES) return false;
+	if (usedSlots >= FCKAFD_MAX_SLOTS) {
+		// the files are already gone from the RAM table, so compacting drops them as well
+		return compactFileTable();
+	}
+	u8 buf[2 + FCKAFD_MAX_TOMBSTONE_FILES * 2 + 2];
+	buf[0] = FCKAFD_SLOT_TOMBSTONE;
+	buf[1] = count;
+	memcpy(&buf[2], fileNums, count * 2);
+	const u16 check = slotCheck(buf, 2 + count * 2);
+	memcpy(&buf[2 + count * 2], &check, 2);
+	const u8 slot = usedSlots++;
+	programLoad(metaBlock, slotOffset(slot), 2 + count * 2 + 2, buf);
+	programExecute(metaBlock, slotPage(slot));
+	return true;
+}
+
+i16 Fckafd::findFile(u16 fileNum) {
+	for (int i = 0; i < fileCount; i++)
+		if (files[i].fileNum == fileNum) return i;
+	return -1;
+}
+
+void Fckafd::removeFromTable(u16 index) {
+	fileCount--;
+	for (int i = index; i < fileCount; i++)
+		files[i] = files[i + 1];
+}
+
+bool Fckafd::remove(const u16 fileNum) {
+	if (!fsReady || writeOpen) return false;
+	i16 index = findFile(fileNum);
+	if (index < 0) return false;
+	removeFromTable(index);
+	if (!writeTombstone(&fileNum, 1)) {
+		scanFileTable();
+		return false;
+	}
+	return true;
+}
+
+u16 Fckafd::removeOldest(u16 maxFiles, u16 minFreeBlocks) {
+	if (!fsReady || writeOpen) return 0;
+	u16 nums[FCKAFD_MAX_SLOTS];
+	u16 count = 0;
+	u16 first;
+	while (fileCount && (fileCount > maxFiles || getLargestFreeExtent(first) < minFreeBlocks)) {
+		nums[count++] = files[0].fileNum;
+		removeFromTable(0);
+	}
+	if (!count) return 0;
+	DEBUG_PRINTF("Deleting %d old files\n", count);
+	if (!writeTombstone(nums, count)) {
+		scanFileTable();
+		return 0;
+	}
+	return count;
+}
+
+u16 Fckafd::getFreeExtents(u16 *starts, u16 *lengths) {
+	// used ranges sorted by first block
+	u16 usedStarts[FCKAFD_MAX_SLOTS];
+	u16 usedEnds[FCKAFD_MAX_SLOTS];
+	for (int i = 0; i < fileCount; i++) {
+		u16 s = files[i].firstBlock;
+		u16 e = files[i].lastBlock == 0xFFFF ? spareStart - 1 : files[i].lastBlock; // incomplete files: unknown size, assume the worst
+		e = nextGoodBlock(e); // the erase ahead block is not free either, the next file would erase it again
+		int j = i;
+		for (; j > 0 && usedStarts[j - 1] > s; j--) {
+			usedStarts[j] = usedStarts[j - 1];
+			usedEnds[j] = usedEnds[j - 1];
+		}
+		usedStarts[j] = s;
+		usedEnds[j] = e;
+	}
+	u16 count = 0;
+	u32 cursor = firstDataBlock;
+	for (int i = 0; i <= fileCount; i++) {
+		while (cursor < spareStart && isBadBlock(cursor)) cursor++;
+		u32 end = i < fileCount ? usedStarts[i] : spareStart; // exclusive
+		if (end > cursor) {
+			starts[count] = cursor;
+			lengths[count++] = end - cursor;
+		}
+		if (i < fileCount && usedEnds[i] + 1u > cursor) cursor = usedEnds[i] + 1;
+	}
+	return count;
+}
+
+u16 Fckafd::getLargestFreeExtent(u16 &first) {
+	u16 starts[FCKAFD_MAX_SLOTS + 1];
+	u16 lengths[FCKAFD_MAX_SLOTS + 1];
+	u16 count = getFreeExtents(starts, lengths);
+	u16 best = 0;
+	first = firstDataBlock;
+	for (int i = 0; i < count; i++) {
+		if (lengths[i] > best) {
+			best = lengths[i];
+			first = starts[i];
+		}
+	}
+	return best;
+}
+
+u16 Fckafd::allocateExtent(u16 &first) {
+	u16 starts[FCKAFD_MAX_SLOTS + 1];
+	u16 lengths[FCKAFD_MAX_SLOTS + 1];
+	u16 count = getFreeExtents(starts, lengths);
+	u16 largest = 0;
+	for (int i = 0; i < count; i++)
+		if (lengths[i] > largest) largest = lengths[i];
+	u16 best = 0;
+	u32 bestAvg = 0xFFFFFFFF;
+	first = firstDataBlock;
+	for (int i = 0; i < count; i++) {
+		if (lengths[i] * 2 < largest) continue;
+		u32 sum = 0;
+		for (u16 b = starts[i]; b < starts[i] + lengths[i]; b++) sum += eraseCounts[b];
+		u32 avg = sum * 16 / lengths[i];
+		if (avg < bestAvg) {
+			bestAvg = avg;
+			best = lengths[i];
+			first = starts[i];
+		}
+	}
+	return best;
+}
+
 bool Fckafd::exists(u16 num) {
 	if (!chipReady) return false;
 	if (!fsReady) return false;
-	u8 page = num / 2 + 1;
-	u16 offset = (num % 2) * 1024;
-	if (page >= 64) return false;
-	u8 buf[3];
-	pageRead(0, page);
-	readFromCache(0, offset, 3, buf);
-	if (buf[0] != 0 || DECODE_U2(&buf[1]) != num) return false;
-	return true;
+	return findFile(num) >= 0;
 }
 
 FlashFile Fckafd::open(u16 num, oflag_t oflag) {
@@ -434,7 +1258,7 @@ FlashFile Fckafd::open(u16 num, oflag_t oflag) {
 	if (oflag == O_RDONLY) {
 		return FlashFile(0, num, false, *this);
 	}
-	if (oflag == O_WRITE | O_CREAT) {
+	if (oflag == (O_WRITE | O_CREAT)) {
 		DEBUG_PRINTF("Will create file %d\n", num);
 		return FlashFile(0, num, true, *this);
 	}
@@ -448,16 +1272,9 @@ u16 Fckafd::getNewBbFileNum() {
 	DEBUG_PRINTLN("chip ready");
 	if (!fsReady) return 0xFFFF;
 	DEBUG_PRINTLN("FCKAFD ready");
-	u8 buf[3];
 	i32 highest = -1;
-	for (int page = 1; page < 64; page++) {
-		pageRead(0, page);
-		for (int offset = 0; offset < 2048; offset += 1024) {
-			readFromCache(0, offset, 3, buf);
-			if (buf[0] != 0x00) continue;
-			i32 num = DECODE_U2(&buf[1]);
-			if (num > highest) highest = num;
-		}
+	for (int i = 0; i < fileCount; i++) {
+		if (files[i].fileNum > highest) highest = files[i].fileNum;
 	}
 	DEBUG_PRINTF("Suggested number %d\n", highest + 1);
 	return highest + 1;
@@ -473,106 +1290,102 @@ FlashFile::FlashFile() : fck(&dummy) {
 FlashFile::FlashFile(u8 partition, u16 fileNum, bool forWrite, Fckafd &fs) : fck(&fs) {
 	this->fileNum = fileNum;
 	this->writeAccess = forWrite;
-	u8 buf[130];
+	u8 buf[15];
 
 	if (forWrite) {
-		u16 freePage = 0xFFFF;
-		u16 freeOffset = 0xFFFF;
-		i32 maxBlock = 0;
-		for (int page = 1; page < 64; page++) {
-			for (int offset = 0; offset < 2048; offset += 1024) {
-				fck->getData(0, page, offset, 9, buf);
-
-				// remember page and offset so we can place the file here later
-				if (buf[0] == 0xFF && freePage == 0xFFFF) {
-					freePage = page;
-					freeOffset = offset;
-				}
-
-				// if we find a file, check the fileNum and mark the highest used block
-				if (buf[0] == 0x00) {
-					u16 fn = DECODE_U2(&buf[1]);
-					if (fn == fileNum) {
-						// found file, do not open
-						isOpen = false;
-						DEBUG_PRINTLN("Found File. Do not open");
-						return;
-					}
-
-					firstBlock = DECODE_U2(&buf[3]);
-					fck->getData(0, page, offset + 512, 7, buf);
-					if (buf[0] != 1) {
-						// failed finishing file (should not happen when the file is being cleaned on mount)
-						isOpen = false;
-						DEBUG_PRINTLN("Found incomplete file. Cannot create a new one");
-						return;
-					}
-
-					u16 endBlock = DECODE_U2(&buf[1]);
-					if (endBlock > maxBlock) maxBlock = endBlock;
-				}
+		if (fck->writeOpen) {
+			isOpen = false;
+			DEBUG_PRINTLN("Another file is open for writing");
+			return;
+		}
+		if (fck->findFile(fileNum) >= 0) {
+			// found file, do not open
+			isOpen = false;
+			DEBUG_PRINTLN("Found File. Do not open");
+			return;
+		}
+		for (int i = 0; i < fck->fileCount; i++) {
+			if (fck->files[i].lastBlock == 0xFFFF) {
+				// failed finishing file (should not happen when the file is being cleaned on mount)
+				isOpen = false;
+				DEBUG_PRINTLN("Found incomplete file. Cannot create a new one");
+				return;
 			}
 		}
-
-		if (freePage == 0xFFFF) {
+		if (fck->usedSlots >= FCKAFD_MAX_SLOTS) fck->compactFileTable();
+		if (fck->usedSlots >= FCKAFD_MAX_SLOTS) {
+			isOpen = false;
+			DEBUG_PRINTLN("Could not find a free slot to create the file in");
+			return;
+		}
+		u16 freeBlocks = fck->allocateExtent(firstBlock);
+		if (!freeBlocks) {
 			isOpen = false;
-			DEBUG_PRINTLN("Could not find a free meta page to create the file in");
+			DEBUG_PRINTLN("No free blocks left");
 			return;
 		}
-		DEBUG_PRINTF("Found a free page %d %d \n", freePage, freeOffset);
+		blockLimit = firstBlock + freeBlocks - 1;
 
-		firstBlock = maxBlock + 1;
+		slot = fck->usedSlots++;
 		currentBlock = firstBlock;
 		lastBlock = firstBlock;
-		buf[0] = 0;
+		maxBlock = firstBlock;
+		buf[0] = FCKAFD_SLOT_FILE;
 		buf[1] = fileNum;
 		buf[2] = fileNum >> 8;
 		buf[3] = firstBlock;
 		buf[4] = firstBlock >> 8;
 		startTime = rtcGetUnixTimestamp();
 		memcpy(&buf[5], &startTime, 4);
-		fck->programLoad(0, freeOffset, 9, buf);
-		fck->programExecute(0, freePage);
-		metaPage = freePage;
-		metaPagePart = freeOffset / 1024;
-
-		DEBUG_PRINTF("Created file %d for write with its first block %d, on meta page %d at offset %d. Start time %d\n", fileNum, firstBlock, freePage, freeOffset, startTime);
+		serial = (fck->generation << 8) | slot; // unique, slots are not reused within a generation
+		memcpy(&buf[9], &serial, 4);
+		const u16 check = Fckafd::slotCheck(buf, 13);
+		memcpy(&buf[13], &check, 2);
+		fck->programLoad(fck->metaBlock, Fckafd::slotOffset(slot), 15, buf);
+		fck->programExecute(fck->metaBlock, Fckafd::slotPage(slot));
+		FckafdFile &f = fck->files[fck->fileCount++];
+		f.fileNum = fileNum;
+		f.firstBlock = firstBlock;
+		f.lastBlock = 0xFFFF;
+		f.slot = slot;
+		f.size = 0;
+		f.recovered = false;
+		fck->writeOpen = true;
+		// erase ahead, further blocks are erased one block ahead of the cursor by write()
+		fck->queueErase(firstBlock);
+		if (fck->nextGoodBlock(firstBlock) <= blockLimit) fck->queueErase(fck->nextGoodBlock(firstBlock));
+
+		DEBUG_PRINTF("Created file %d for write in blocks %d-%d, in slot %d. Start time %d\n", fileNum, firstBlock, blockLimit, slot, startTime);
 	} else {
-		bool foundFile = false;
 		// for reading
-		for (int page = 1; page < 64; page++) {
-			for (int offset = 0; offset < 2048; offset += 1024) {
-				fck->getData(0, page, offset, 9, buf);
-
-				if (buf[0] == 0x00) {
-					// found a file, check if it is this
-					u16 fn = DECODE_U2(&buf[1]);
-					if (fn == fileNum) {
-						firstBlock = DECODE_U2(&buf[3]);
-						currentBlock = firstBlock;
-						startTime = DECODE_U4(&buf[5]);
-						fck->getData(0, page, offset + 512, 7, buf);
-						if (buf[0] != 1) continue; // failed finishing file (should not happen when the file is being cleaned on mount)
-						lastBlock = DECODE_U2(&buf[1]);
-						fileSize = DECODE_U4(&buf[3]);
-						foundFile = true;
-						fck->getData(0, page, offset + 512 + 126, 130, buf);
-						for (int i = 0; i < 26; i++) {
-							int pos = i * 5;
-							u32 bytePos = DECODE_U4(&buf[pos]);
-							u8 byte = buf[pos + 4];
-							if (bytePos == 0xFFFFFFFF) break;
-							corrBytes[i].pos = bytePos;
-							corrBytes[i].byte = byte;
-							corrCount++;
-						}
-						break;
-					}
-				}
-			}
-			if (foundFile) break;
+		i16 index = fck->findFile(fileNum);
+		if (index < 0 || fck->files[index].lastBlock == 0xFFFF) {
+			// not found or failed finishing file (should not happen when the file is being cleaned on mount)
+			isOpen = false;
+			return;
+		}
+		const FckafdFile &f = fck->files[index];
+		slot = f.slot;
+		const u8 page = Fckafd::slotPage(slot);
+		const u16 offset = Fckafd::slotOffset(slot);
+		fck->getData(fck->metaBlock, page, offset, 9, buf);
+		firstBlock = DECODE_U2(&buf[3]);
+		currentBlock = firstBlock;
+		startTime = DECODE_U4(&buf[5]);
+		lastBlock = f.lastBlock;
+		fileSize = f.size;
+		if (f.recovered) return; // no correction bytes
+		u8 corrBuf[FLASH_CORRECTION_BYTES * 5];
+		fck->getData(fck->metaBlock, page, offset + 512 + 126, FLASH_CORRECTION_BYTES * 5, corrBuf);
+		for (int i = 0; i < FLASH_CORRECTION_BYTES; i++) {
+			int pos = i * 5;
+			u32 bytePos = DECODE_U4(&corrBuf[pos]);
+			u8 byte = corrBuf[pos + 4];
+			if (bytePos == 0xFFFFFFFF) break;
+			corrBytes[i].pos = bytePos;
+			corrBytes[i].byte = byte;
+			corrCount++;
 		}
-		if (!foundFile) isOpen = false;
 	}
 }
 
@@ -583,7 +1396,9 @@ bool FlashFile::seek(u32 newPos) {
 	}
 
 	const size_t blockSize = fck->pageSize * fck->pageCount;
-	currentBlock = firstBlock + newPos / blockSize;
+	currentBlock = firstBlock;
+	for (u32 i = newPos / blockSize; i; i--)
+		currentBlock = fck->nextGoodBlock(currentBlock); // bad blocks are skipped
 	const size_t blockOffset = newPos % blockSize;
 	currentPage = blockOffset / fck->pageSize;
 	currentPagePos = blockOffset % fck->pageSize;
@@ -599,7 +1414,7 @@ void FlashFile::moveCursorFwd(u32 count) {
 		currentPage++;
 		if (currentPage >= fck->pageCount) {
 			currentPage -= fck->pageCount;
-			currentBlock++;
+			currentBlock = fck->nextGoodBlock(currentBlock);
 		}
 	}
 }
@@ -629,27 +1444,27 @@ i32 FlashFile::read(u8 *buffer, size_t length) {
 
 	// simplest read: no page boundary
 	if (currentPagePos + length <= fck->pageSize) {
-		fck->getData(currentBlock, currentPage, currentPagePos, length, buffer);
+		fck->readCached(currentBlock, currentPage, currentPagePos, length, buffer);
 		moveCursorFwd(length);
 	} else {
 		// else read first (part) page
 		size_t thisLength = fck->pageSize - currentPagePos;
 		size_t bufPos = 0;
-		fck->getData(currentBlock, currentPage, currentPagePos, thisLength, buffer);
+		fck->readCached(currentBlock, currentPage, currentPagePos, thisLength, buffer);
 		bufPos += thisLength;
 		moveCursorFwd(thisLength);
 
 		// as long as we can still read full pages
 		thisLength = fck->pageSize;
 		while (length - bufPos > fck->pageSize) {
-			fck->getData(currentBlock, currentPage, 0, thisLength, buffer + bufPos);
+			fck->readCached(currentBlock, currentPage, 0, thisLength, buffer + bufPos);
 			bufPos += thisLength;
 			moveCursorFwd(thisLength);
 		}
 
 		// read remaining bytes
 		thisLength = length - bufPos;
-		fck->getData(currentBlock, currentPage, 0, thisLength, buffer + bufPos);
+		fck->readCached(currentBlock, currentPage, 0, thisLength, buffer + bufPos);
 		// bufPos += thisLength;
 		moveCursorFwd(thisLength);
 	}
@@ -669,7 +1484,7 @@ int FlashFile::peek() {
 		}
 	}
 	u8 buf;
-	fck->getData(currentBlock, currentPage, currentPagePos, 1, &buf);
+	fck->readCached(currentBlock, currentPage, currentPagePos, 1, &buf);
 	return buf;
 }
 
@@ -685,54 +1500,33 @@ size_t FlashFile::write(const uint8_t *buffer, size_t size) {
 		return written;
 	}
 
-	u16 sectorPos = currentPagePos % 512;
-
-	// partial sector write (don't send to flash)
-	u16 maxWrite = 512 - sectorPos;
-	if (maxWrite > size) {
-		memcpy(writeBuf + sectorPos, buffer, size);
-		moveCursorFwd(size);
-		fileSize += size;
-		return size;
-	}
-
-	// finish the current sector and send it off
+	// fill the page buffer, full pages are queued and programmed in the background
 	size_t wrPos = 0;
-	size_t wrLeft = size;
-	memcpy(writeBuf + sectorPos, buffer, maxWrite);
-	fck->programLoad(currentBlock, currentPagePos - sectorPos, 512, writeBuf);
-	fck->programExecute(currentBlock, currentPage);
-	moveCursorFwd(maxWrite);
-	wrPos += maxWrite;
-	wrLeft -= maxWrite;
-	if (currentBlock > fck->maxBbBlock) {
-		correctionMode = true;
-		fileSize += wrPos;
-		return wrPos;
-	}
-
-	// any other sectors able to be fully written?
-	while (wrLeft >= 512) {
-		memcpy(writeBuf, buffer + wrPos, 512);
-		fck->programLoad(currentBlock, currentPagePos, 512, writeBuf);
-		fck->programExecute(currentBlock, currentPage);
-		moveCursorFwd(512);
-		wrPos += 512;
-		wrLeft -= 512;
-		if (currentBlock > fck->maxBbBlock) {
+	while (wrPos < size) {
+		if (!pageBuf) pageBuf = fck->getPageBuffer();
+		size_t len = fck->pageSize - currentPagePos;
+		if (len > size - wrPos) len = size - wrPos;
+		memcpy(pageBuf + currentPagePos, buffer + wrPos, len);
+		const u16 block = currentBlock;
+		const u8 page = currentPage;
+		moveCursorFwd(len);
+		wrPos += len;
+		fileSize += len;
+		if (currentPagePos) continue;
+
+		// page full
+		fck->queueProgram(block, page, fck->pageSize, pageBuf, serial, pageSeq++);
+		pageBuf = nullptr;
+		maxBlock = block;
+		if (currentBlock > blockLimit) {
 			correctionMode = true;
-			fileSize += wrPos;
 			return wrPos;
 		}
+		if (currentBlock != block && fck->nextGoodBlock(currentBlock) <= blockLimit) {
+			// entered a new block, erase the next one while this one is being filled
+			fck->queueErase(fck->nextGoodBlock(currentBlock));
+		}
 	}
-	fileSize += size;
-
-	// no data left
-	if (!wrLeft) return size;
-
-	// partial sector left (only write to writeBuf)
-	memcpy(writeBuf, buffer + wrPos, wrLeft);
-	moveCursorFwd(wrLeft);
 	return size;
 
 	// TODO maximum file size
@@ -741,31 +1535,22 @@ size_t FlashFile::write(uint8_t data) {
 	if (!writeAccess || !isOpen) return 0;
 
 	if (correctionMode) {
-		if (corrCount >= 26) return 0;
+		if (corrCount >= FLASH_CORRECTION_BYTES) return 0;
 		corrBytes[corrCount].pos = currentFilePos;
 		moveCursorFwd();
 		corrBytes[corrCount++].byte = data;
 		return 1;
 	}
 
-	u16 sectorPos = currentPagePos % 512;
-	writeBuf[sectorPos] = data;
-	if (sectorPos == 511) {
-		fck->programLoad(currentBlock, currentPagePos - 511, 512, writeBuf);
-		fck->programExecute(currentBlock, currentPage);
-	}
-	moveCursorFwd();
-	if (currentBlock > fck->maxBbBlock) {
-		maxBlock = currentBlock;
-		correctionMode = true;
-	}
-	fileSize++;
-	return 1;
+	return write(&data, 1);
 }
 int FlashFile::availableForWrite() {
 	if (!writeAccess || !isOpen) return 0;
-	// TODO bytes that can be written immediately
-	return 1;
+	if (correctionMode) return FLASH_CORRECTION_BYTES - corrCount;
+	// bytes that can be written without waiting for the flash chip
+	int av = fck->freePageBuffers() * fck->pageSize;
+	if (pageBuf) av += fck->pageSize - currentPagePos;
+	return av;
 }
 void FlashFile::flush() {
 	// no flushing supported due to unpredictability. privateFlush() exists for internal flushing
@@ -775,32 +1560,49 @@ void FlashFile::flush() {
 void FlashFile::close() {
 	if (!isOpen || !writeAccess) return;
 	if (!correctionMode) privateFlush();
+	fck->drain();
+	if (fck->remapsDirty) {
+		fck->remapsDirty = false;
+		fck->writeRemapSlot();
+	}
 
-	u8 buf[256];
-	memset(buf, 0xFF, 256);
+	u8 buf[126 + FLASH_CORRECTION_BYTES * 5];
+	memset(buf, 0xFF, sizeof(buf));
 	buf[0] = 1;
 	buf[1] = maxBlock;
 	buf[2] = maxBlock >> 8;
 	memcpy(&buf[3], &fileSize, 4);
-	for (int i = 0; i < 26; i++) {
+	const u16 check = Fckafd::slotCheck(buf, 7);
+	memcpy(&buf[7], &check, 2);
+	for (int i = 0; i < FLASH_CORRECTION_BYTES; i++) {
 		int pos = i * 5 + 126;
 		memcpy(&buf[pos], &corrBytes[i].pos, 4);
 		buf[pos + 4] = corrBytes[i].byte;
 	}
 
-	fck->programLoad(0, metaPagePart * 1024 + 512, 256, buf);
-	fck->programExecute(0, metaPage);
-	DEBUG_PRINTF("Closing file %d on max block %d with offset %d on metaPage %d\n", fileNum, maxBlock, metaPagePart * 1024, metaPage);
+	// a compaction while writing (remap slot) may have moved the file to another slot
+	i16 index = fck->findFile(fileNum);
+	if (index >= 0) slot = fck->files[index].slot;
+	fck->programLoad(fck->metaBlock, Fckafd::slotOffset(slot) + 512, sizeof(buf), buf);
+	fck->programExecute(fck->metaBlock, Fckafd::slotPage(slot));
+	DEBUG_PRINTF("Closing file %d on max block %d in slot %d\n", fileNum, maxBlock, slot);
+	if (index >= 0) {
+		fck->files[index].lastBlock = maxBlock;
+		fck->files[index].size = fileSize;
+	}
+	fck->writeOpen = false;
 
 	isOpen = false;
 }
 
 void FlashFile::privateFlush() {
 	if (!writeAccess || !isOpen) return;
-	if (currentPagePos == 0) return;
-	fck->programLoad(currentBlock, currentPagePos / 512 * 512, currentPagePos % 512, writeBuf);
-	fck->programExecute(currentBlock, currentPage);
-	maxBlock = currentBlock;
+	if (pageBuf) {
+		// a page buffer is only held while the current page is partially filled
+		fck->queueProgram(currentBlock, currentPage, currentPagePos, pageBuf, serial, pageSeq++);
+		pageBuf = nullptr;
+		maxBlock = currentBlock;
+	}
 
 	correctionMode = true;
 	DEBUG_PRINTLN("Flushed file, going to correction mode now");
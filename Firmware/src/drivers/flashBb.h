@@ -25,6 +25,23 @@
 
 class Fckafd;
 
+#define FCKAFD_META_BLOCKS 2 // the first two good blocks alternately hold the file table, see Fckafd::compactFileTable()
+#define FCKAFD_META_SEARCH_BLOCKS 8 // only block 0 is guaranteed to be good, the meta blocks are looked for in this many blocks
+#define FCKAFD_MAX_SLOTS 118 // file table slots, 2 per page on pages 1-59 of the meta block
+#define FCKAFD_WEAR_PAGE 60 // pages 60-63 of the meta block: u16 erase count per block
+#define FCKAFD_MAX_BLOCKS 4096 // limited by the bad block bitmap (one sector) and the erase count pages
+#define FCKAFD_SPARE_BLOCKS 24 // blocks at the end of the blackbox partition that replace blocks failing at runtime
+#define FCKAFD_SLOT_FILE 0x00
+#define FCKAFD_SLOT_TOMBSTONE 0x01 // deletes all listed files that were created before this slot
+#define FCKAFD_SLOT_REMAP 0x02 // pairs of u16 failed block, u16 spare block that replaces it
+#define FCKAFD_SLOT_CLOSE 0x03 // u16 file num, u16 last block, u32 size of a file that was closed by Fckafd::recoverFile()
+#define FCKAFD_SLOT_FREE 0xFF
+#define FCKAFD_MAX_TOMBSTONE_FILES 254 // u8 count + u16 file nums + u16 check, must fit into one sector
+#define FCKAFD_TAG_COLUMN 2080 // FckafdPageTag in the ECC protected user bytes of the spare area
+#define FCKAFD_OTHER_VERSION_MSG "FCKAFD version mismatch" // error of BB_FILE_LIST while Fckafd::otherVersion is set, the configurator offers to format
+
+#define FLASH_CORRECTION_BYTES 64 // max. bytes that can be replaced after flushing, stored as 5 bytes each in the file metadata (126 + 64 * 5 <= 512)
+
 typedef struct correctionByte {
 	u32 pos = 0xFFFFFFFF;
 	u8 byte = 0;
@@ -68,7 +85,8 @@ private:
 
 	bool isOpen = true;
 	bool writeAccess = false;
-	CorrectionByte corrBytes[26];
+	u8 slot = 0xFF; // file table slot
+	CorrectionByte corrBytes[FLASH_CORRECTION_BYTES];
 	bool correctionMode = false;
 	u8 corrCount = 0;
 	u32 fileSize = 0;
@@ -82,24 +100,82 @@ private:
 
 	u16 currentBlock = 0;
 	u8 currentPage = 0;
-	u8 writeBuf[512];
+	u8 *pageBuf = nullptr; // page that is currently being filled, handed to the program queue once full
+	u32 serial = 0; // unique per created file, written into the page tags
+	u32 pageSeq = 0; // index of the next page that is programmed
 	u32 currentFilePos = 0;
 	size_t currentPagePos = 0;
 
-	u8 metaPage = 0xFF;
-	u8 metaPagePart = 0;
-	u16 maxBlock = 0;
+	u16 maxBlock = 0; // last block that contains data
+	u16 blockLimit = 0; // last block of the free extent that this file was placed in
 };
 
-#define CACHED_SECTORS 3
+#ifndef FLASH_CACHED_PAGES
+#define FLASH_CACHED_PAGES 4 // RAM page cache for file reads, 2 KiB each, see Fckafd::readCached()
+#endif
+
+#define FLASH_PAGE_BUFFERS 3 // one being filled by the file, one queued, one programming
+#define FLASH_JOB_QUEUE_SIZE 8 // must be a power of 2
 
-typedef struct sectorCache {
-	u8 buf[512];
-	u16 block = 0xFFFF;
+enum class FlashJobType : u8 {
+	PROGRAM,
+	ERASE,
+};
+
+typedef struct fckafdFile {
+	u16 fileNum;
+	u16 firstBlock;
+	u16 lastBlock; // 0xFFFF while the file is open for writing (or until it is recovered on mount)
+	u8 slot; // position in the file table
+	u32 size;
+	bool recovered; // closed by Fckafd::recoverFile(), has no correction bytes
+} FckafdFile;
+
+/// @brief stored in the spare area of every file page, lets Fckafd::recoverFile() find the end of a file that was not closed
+typedef struct fckafdPageTag {
+	u32 serial; // file serial, (generation << 8) | slot when the file was created
+	u32 seq; // page index within the file
+	u16 length; // bytes of file data in this page
+	u16 check; // detects partially programmed tags
+} FckafdPageTag;
+
+typedef struct fckafdRemap {
+	u16 block; // block that failed
+	u16 spare; // block that is used instead
+} FckafdRemap;
+
+/// @brief block health statistics, see Fckafd::getHealth()
+typedef struct fckafdHealth {
+	u16 blockCount; // blocks of the blackbox partition
+	u16 factoryBadBlocks; // bad blocks found when formatting (including blocks that failed before the last format)
+	u16 remappedBlocks; // blocks that failed since the last format and were replaced by a spare block
+	u16 sparesLeft; // good spare blocks that can still replace failing blocks
+	u16 minEraseCount;
+	u16 maxEraseCount;
+	u32 totalEraseCount;
+	u32 programFailures;
+	u32 eraseFailures;
+	u32 cacheHits; // file reads served from the RAM page cache
+	u32 cacheMisses; // file reads that had to load a page from the chip
+	u32 readAheads; // misses where the chip had already read the page ahead
+} FckafdHealth;
+
+typedef struct flashJob {
+	FlashJobType type;
+	u8 page;
+	u16 block;
+	u16 length; // PROGRAM only
+	u8 bufIndex; // PROGRAM only
+	u32 serial; // PROGRAM only, for the page tag
+	u32 seq; // PROGRAM only, for the page tag
+} FlashJob;
+
+typedef struct pageCache {
+	u8 buf[2048];
+	u16 block = 0xFFFF; // physical block, 0xFFFF = empty
 	u8 page = 0xFF;
-	u8 sector = 0xFF;
-	u8 prio = 0xFF;
-} SectorCache;
+	u32 lastUse = 0; // for least recently used replacement
+} PageCache;
 
 // Filesystem that Captures Kolibri's Awesome Flight Data
 class Fckafd {
@@ -120,6 +196,9 @@ public:
 	 */
 	bool begin(pin_size_t ioBase, pin_size_t sckPin, pin_size_t csPin, bool &fsReady);
 
+	/// @brief set by begin() if the chip holds an FCKAFD of another format version instead of a valid one. Its logs can only be read by the firmware that wrote them, so it is only formatted on request
+	bool otherVersion = false;
+
 	/**
 	 * @brief formats a partition on the flash chip
 	 *
@@ -150,7 +229,7 @@ public:
 	 * @brief Opens a file
 	 *
 	 * @param num blackbox file num (first partition)
-	 * @param oflag Either O_RDONLY or O_WRITE | O_CREAT. No read and write combined. You can replace a max of 26 bytes in a file after you've written them. Once an O_WRITE | O_CREAT file is closed, you cannot edit it anymore.
+	 * @param oflag Either O_RDONLY or O_WRITE | O_CREAT. No read and write combined. You can replace a max of FLASH_CORRECTION_BYTES bytes in a file after you've written them. Once an O_WRITE | O_CREAT file is closed, you cannot edit it anymore.
 	 * @return FlashBbFile The opened file, nullptr if file already exists and trying to write
 	 */
 	FlashFile open(u16 num, oflag_t oflag = O_RDONLY);
@@ -164,10 +243,58 @@ public:
 	 */
 	FlashFile open(const char *path, oflag_t oflag = O_RDONLY) { return FlashFile(); };
 
-	/// remove not supported
+	/// remove by path not supported
 	bool remove(const char *path) { return false; };
-	/// remove not supported
-	bool remove(const u16 fileNum) { return false; };
+
+	/**
+	 * @brief Deletes a blackbox file
+	 *
+	 * @details Appends a tombstone to the file table, the blocks of the file are reused by later files (they are erased right before they are written again)
+	 * @param fileNum blackbox file num
+	 * @return false if the file does not exist, a file is open for writing or the file table could not be written
+	 */
+	bool remove(const u16 fileNum);
+
+	/**
+	 * @brief Deletes the oldest files until both conditions are met
+	 *
+	 * @param maxFiles at most this many files remain, 0xFFFF = no limit
+	 * @param minFreeBlocks the largest free extent is at least this many blocks, unless all files are deleted
+	 * @return u16 number of deleted files
+	 */
+	u16 removeOldest(u16 maxFiles, u16 minFreeBlocks);
+
+	/// @brief number of files in the file table
+	u16 getFileCount() { return fileCount; };
+
+	/// @brief bad block and wear statistics of the blackbox partition
+	FckafdHealth getHealth();
+
+	/// @brief true if the block was marked bad when formatting. Such blocks are skipped by files
+	bool isBadBlock(u16 block) { return !(badBlockBitmap[block / 8] & (1 << (block % 8))); };
+
+	/// @brief next block after block that is not marked bad, used to advance files
+	u16 nextGoodBlock(u16 block);
+
+	/// @brief block that really holds the data of block, differs if block failed and was replaced by a spare block
+	u16 mapBlock(u16 block);
+
+	/**
+	 * @brief Finds the largest range of contiguous free blocks
+	 *
+	 * @param first first block of the extent is written here
+	 * @return u16 number of blocks in the extent
+	 */
+	u16 getLargestFreeExtent(u16 &first);
+
+	/**
+	 * @brief Finds the free extent for a new file
+	 *
+	 * @details Wear leveling: among the extents that are at least half as large as the largest one, the one with the lowest average erase count is chosen
+	 * @param first first block of the extent is written here
+	 * @return u16 number of blocks in the extent, 0 if the partition is full
+	 */
+	u16 allocateExtent(u16 &first);
 
 	/**
 	 * @brief Get the file num that is one higher than the highest file num currently present
@@ -183,9 +310,66 @@ public:
 	u16 cachedBlock = 0xFFFF;
 	u8 cachedPage = 0xFF;
 
+	/**
+	 * @brief Get a free page buffer to fill and pass to queueProgram() later
+	 *
+	 * @details blocks (and processes the queue) if all FLASH_PAGE_BUFFERS are in use
+	 * @return u8* pageSize bytes
+	 */
+	u8 *getPageBuffer();
+
+	/**
+	 * @brief Queue programming of a page, returns immediately
+	 *
+	 * @param block block to program
+	 * @param page page within the block
+	 * @param length bytes to program, starting at column 0
+	 * @param buf buffer from getPageBuffer(), released once the page is programmed
+	 * @param serial serial of the file, stored in the page tag
+	 * @param seq index of the page within the file, stored in the page tag
+	 */
+	void queueProgram(u16 block, u8 page, u16 length, u8 *buf, u32 serial, u32 seq);
+
+	/**
+	 * @brief Queue erasing of a block, returns immediately
+	 *
+	 * @details blocks only if the job queue is full
+	 */
+	void queueErase(u16 block);
+
+	/// @brief number of page buffers that getPageBuffer() can return without blocking
+	u8 freePageBuffers();
+
+	/**
+	 * @brief Processes the job queue without blocking
+	 *
+	 * @details Polls the status register if an operation is in progress, and starts the next job once the chip is ready. Call this regularly, e.g. from blackboxLoop()
+	 */
+	void loop();
+
+	/// @brief Blocks until all queued jobs are finished
+	void drain();
+
+	u32 programFailures = 0; // P_FAIL reported by the chip for queued programs
+	u32 eraseFailures = 0; // E_FAIL reported by the chip for queued erases
+
+	/**
+	 * @brief Reads from a page through the RAM page cache
+	 *
+	 * @details Whole pages are loaded into the least recently used cache entry. If the page follows the one that was loaded last, the next page of the block is read ahead by the chip (PAGE READ CACHE RANDOM) while this one is transferred.
+	 * @param block block number, remapped like getData()
+	 * @return u16 bytes read, 0 if the range exceeds the page
+	 */
+	u16 readCached(u16 block, u8 page, u16 start, u16 length, u8 *buf);
+
+	u32 cacheHits = 0;
+	u32 cacheMisses = 0;
+	u32 readAheads = 0;
+
+	// direct chip access, the block numbers are NOT remapped (except for getData)
 	u16 programLoad(u16 block, u16 start, u16 length, const u8 *buf);
 	void programExecute(u16 block, u8 page, bool getFeatureWait = true);
-	u16 getData(u16 block, u8 page, u16 start, u16 length, u8 *buf);
+	u16 getData(u16 block, u8 page, u16 start, u16 length, u8 *buf); // uncached, but served from the page cache if it holds the page
 	void invalidateCaches();
 	void eraseBlock(u16 block, bool getFeatureWait = true);
 	u8 getFeature(u8 featureRegister = 0xC0);
@@ -194,8 +378,14 @@ public:
 	u32 pageCount = 0;
 	u32 blockCount = 0;
 	u32 maxBbBlock = 0;
+	u32 spareStart = 0; // first spare block, data blocks are firstDataBlock to spareStart - 1
+	u16 firstDataBlock = FCKAFD_META_BLOCKS; // block after the second meta block
 
 private:
+	// hardware layer, replaced by a simulated chip in the native test build
+	void initSpi(pin_size_t ioBase, pin_size_t sckPin, pin_size_t csPin);
+	void select();
+	void deselect();
 	u8 singleSpiTransfer(u8 txByte = 0);
 	void burstSpiRead(u16 len, void *dst);
 	void burstSpiWrite(u16 len, const void *src);
@@ -207,11 +397,76 @@ private:
 	u16 readFromCache(u16 block, u16 start, u16 length, u8 *buf);
 	void pageRead(u16 block, u8 page, bool getFeatureWait = true);
 	bool checkFeature(u8 mask, u8 value, u8 featureRegister = 0xC0);
+	void sendProgramLoad(u16 block, u16 start, u16 length, const u8 *buf);
+	void sendProgramLoadRandom(u16 block, u16 start, u16 length, const u8 *buf);
+	void loadProgramData(const FlashJob &job, u16 block);
+	void sendProgramExecute(u16 block, u8 page);
+	void sendBlockErase(u16 block);
+	void startJob(const FlashJob &job);
+	void pushJob(const FlashJob &job);
+	u8 waitReady();
+	void sendPageRead(u16 block, u8 page);
+	void sendPageReadCache(u16 block, u8 page, bool last);
+	void endReadAhead();
+	void loadPage(u16 block, u8 page, bool readAhead, u8 *dst);
+	PageCache *findCachedPage(u16 block, u8 page);
+	void invalidateCachedPages(u16 block, u8 page = 0xFF);
+	void relocateBlock(const FlashJob &job);
+	u16 allocateSpare(u16 failedBlock);
+	void markBad(u16 block);
+	bool findMetaBlocks();
+
+	u8 pageBufs[FLASH_PAGE_BUFFERS][2048];
+	u8 pageBufsInUse = 0; // bitmask
+	FlashJob jobs[FLASH_JOB_QUEUE_SIZE];
+	u8 jobHead = 0; // next free slot
+	u8 jobTail = 0; // oldest job, the running one if jobRunning
+	bool jobRunning = false;
 
 	u8 blackboxSm;
 	u8 blackboxOffset;
 
-	SectorCache secCaches[CACHED_SECTORS];
+	PageCache pageCaches[FLASH_CACHED_PAGES];
+	u32 cacheUseCounter = 0;
+	u16 lastLoadedBlock = 0xFFFF; // logical block of the page loaded last by readCached(), to detect sequential reads
+	u8 lastLoadedPage = 0xFF;
+	u8 readStatus = 0; // status register after the last page read, for its ECC bits
+	u16 readAheadBlock = 0xFFFF; // physical block of the page the chip is reading into its data register
+	u8 readAheadPage = 0xFF;
+
+	bool scanFileTable(bool countErases = false);
+	u16 getFreeExtents(u16 *starts, u16 *lengths);
+	bool compactFileTable();
+	bool writeMetaHeader(u16 block, u32 gen, u8 accounted);
+	void writeWearPages(u16 block);
+	bool writeRemapSlot();
+	void countFileErases(u16 firstBlock, u16 lastBlock);
+	bool writeTombstone(const u16 *fileNums, u16 count);
+	bool readChecked(u16 block, u8 page, u16 start, u16 length, u8 *buf);
+	bool readTag(u16 firstBlock, u32 serial, u32 seq, FckafdPageTag &tag, u16 &block);
+	bool recoverFile(u16 index);
+	bool writeCloseSlot(const FckafdFile &f);
+	static u16 slotCheck(const u8 *buf, u16 length);
+	static u16 tagCheck(const FckafdPageTag &tag) { return tag.serial ^ (tag.serial >> 16) ^ tag.seq ^ (tag.seq >> 16) ^ tag.length ^ 0x4B46; };
+	i16 findFile(u16 fileNum);
+	void removeFromTable(u16 index);
+	static u8 slotPage(u8 slot) { return slot / 2 + 1; };
+	static u16 slotOffset(u8 slot) { return (slot % 2) * 1024; };
+
+	friend class FlashFile;
+	u16 metaBlocks[FCKAFD_META_BLOCKS] = {0, 1}; // first two blocks without a bad block marker, see findMetaBlocks()
+	u16 metaBlock = 0; // block that currently holds the file table, one of metaBlocks
+	u32 generation = 0; // incremented each time the file table moves to the other meta block
+	FckafdFile files[FCKAFD_MAX_SLOTS]; // in the order of creation
+	u16 fileCount = 0;
+	u8 usedSlots = 0; // slots of the file table that are programmed (files and tombstones)
+	u8 accountedSlots = 0; // slots at the beginning of the table whose erases are already included in the erase count pages
+	u8 badBlockBitmap[FCKAFD_MAX_BLOCKS / 8]; // 1 = good, stored in sector 1 of page 0 of the meta block
+	u16 *eraseCounts = nullptr; // blockCount entries
+	FckafdRemap remaps[FCKAFD_SPARE_BLOCKS];
+	u8 remapCount = 0;
+	bool remapsDirty = false; // remaps changed, but are not in the file table yet
+	bool writeOpen = false; // a file is currently open for writing
 
 	u8 dmaTxChannel, dmaRxChannel;
 	bool chipReady = false;
@@ -222,7 +477,6 @@ private:
 	u32 maxEraseTime = 0;
 	u32 maxReadTime = 0;
 
-	u32 firstFreeBlock = 0;
 };
 
 #endif
@@ -589,8 +589,9 @@ int gyroInit() {
 #endif
 
 	// set up DMA channel
-	gyroDmaTxChannel = dma_claim_unused_channel(true);
-	gyroDmaRxChannel = dma_claim_unused_channel(true);
+	gyroDmaTxChannel = dma_claim_unused_channel(false);
+	gyroDmaRxChannel = dma_claim_unused_channel(false);
+	CRASH_ASSERT(gyroDmaTxChannel < NUM_DMA_CHANNELS && gyroDmaRxChannel < NUM_DMA_CHANNELS); // -1 if none was free
 	dma_channel_config gyroDmaTxConfig = dma_channel_get_default_config(gyroDmaTxChannel);
 	dma_channel_config gyroDmaRxConfig = dma_channel_get_default_config(gyroDmaRxChannel);
 	channel_config_set_read_increment(&gyroDmaTxConfig, true);
@@ -37,40 +37,35 @@ SerialPioHdx::SerialPioHdx(PIO pio, i8 sm)
 		}
 		offsetsSet = true;
 	}
-	rxDmaChan = dma_claim_unused_channel(false);
 }
 
 SerialPioHdx::~SerialPioHdx() {
-	if (running) {
-		end();
-		if (rxBuf != nullptr) free(rxBuf);
-		if (rxDmaChan != 255) dma_channel_unclaim(rxDmaChan);
-	}
+	if (running) end();
 }
 
 int SerialPioHdx::available() {
-	u8 *dmaPtr = (u8 *)dma_hw->ch[rxDmaChan].write_addr;
-	if (dmaPtr >= rxPtr) return dmaPtr - rxPtr;
-	return rxBufSize - (rxPtr - dmaPtr);
+	return rx.available();
 }
 int SerialPioHdx::read() {
 	if (!running) return -1;
-	volatile u8 *dmaPtr = (volatile u8 *)dma_hw->ch[rxDmaChan].write_addr;
-	if (dmaPtr == rxPtr) return -1;
-	int res = *rxPtr++;
-	if (rxPtr >= rxBuf + rxBufSize)
-		rxPtr = rxBuf;
-	return res;
+	return rx.read();
+}
+size_t SerialPioHdx::read(u8 *buffer, size_t size) {
+	if (!running) return 0;
+	return rx.read(buffer, size);
 }
 int SerialPioHdx::peek() {
-	if (!running || !available()) return -1;
-	return *rxPtr;
+	if (!running) return -1;
+	return rx.peek();
 }
 
 size_t SerialPioHdx::write(uint8_t c) {
 	if (!running) {
 		return 0;
 	}
+	while (tx.busy()) {
+		tight_loop_contents();
+	}
 	pio_sm_put_blocking(pio, sm, c);
 	return 1;
 }
@@ -78,6 +73,9 @@ size_t SerialPioHdx::write(const uint8_t *buffer, size_t size) {
 	if (!running) {
 		return 0;
 	}
+	while (tx.busy()) {
+		tight_loop_contents();
+	}
 	for (size_t i = 0; i < size; i++) {
 		pio_sm_put_blocking(pio, sm, buffer[i]);
 		rp2040.wdt_reset();
@@ -85,18 +83,19 @@ size_t SerialPioHdx::write(const uint8_t *buffer, size_t size) {
 	return size;
 }
 void SerialPioHdx::flush() {
-	while (!pio_sm_is_tx_fifo_empty(pio, sm)) {
+	while (tx.busy() || !pio_sm_is_tx_fifo_empty(pio, sm)) {
 		tight_loop_contents();
 	}
 	return;
 }
 int SerialPioHdx::availableForWrite() {
+	if (tx.busy()) return 0;
 	return 4 - pio_sm_get_tx_fifo_level(pio, sm);
 }
 
 void SerialPioHdx::begin() {
 	if (running) return;
-	if (!pio || !baudrate || pin == 255 || rxBuf == nullptr || rxDmaChan == 255) {
+	if (!pio || !baudrate || pin == 255 || !rx.getSize()) {
 		DEBUG_PRINTLN("Assign values to halfduplex UART first");
 		return;
 	}
@@ -160,18 +159,16 @@ void SerialPioHdx::begin() {
 	pio_sm_set_enabled(pio, sm, true);
 	pio_sm_set_clkdiv(pio, sm, clkdiv);
 
-	// set up RX DMA channel
-	dma_channel_config_t dmaCfg = dma_channel_get_default_config(rxDmaChan);
-	channel_config_set_read_increment(&dmaCfg, false);
-	channel_config_set_write_increment(&dmaCfg, true);
-	channel_config_set_dreq(&dmaCfg, pio_get_dreq(pio, sm, false));
-	channel_config_set_transfer_data_size(&dmaCfg, DMA_SIZE_8);
-	channel_config_set_ring(&dmaCfg, true, 31 - __builtin_clz(rxBufSize));
-	dma_channel_set_config(rxDmaChan, &dmaCfg, false);
-	dma_channel_set_read_addr(rxDmaChan, ((u8 *)&pio->rxf[sm]) + 3, false);
-	dma_channel_set_write_addr(rxDmaChan, rxBuf, false);
-	dma_channel_set_transfer_count(rxDmaChan, 0xFFFFFFFFUL, true);
-	rxPtr = rxBuf;
+	// RX: DMA ring from the MSB of the FIFO (right shift), TX: one word per byte, CPU writes if no channel is left
+	if (!rx.start(((u8 *)&pio->rxf[sm]) + 3, pio_get_dreq(pio, sm, false))) {
+		DEBUG_PRINTLN("No free DMA channel for RX");
+		pio_sm_set_enabled(pio, sm, false);
+		pio_sm_set_consecutive_pindirs(pio, sm, pin, 1, false);
+		gpio_set_function(pin, GPIO_FUNC_NULL);
+		pio_sm_unclaim(pio, sm);
+		return;
+	}
+	tx.start(&pio->txf[sm], pio_get_dreq(pio, sm, true), SerialDmaTxFormat::WORDS);
 
 	pioConfig.pio = pioIndex;
 	configs.push_back(&pioConfig);
@@ -189,6 +186,8 @@ void SerialPioHdx::begin(unsigned long baudrate, uint16_t _config) {
 }
 void SerialPioHdx::end() {
 	running = false;
+	rx.stop();
+	tx.stop();
 
 	// erase this serial from the configs
 	for (auto it = configs.begin(); it != configs.end();) {
@@ -230,11 +229,5 @@ bool SerialPioHdx::setPinout(u8 pin, u8 _) {
 
 bool SerialPioHdx::setFIFOSize(size_t size) {
 	if (running) return false;
-	// only accept powers of 2, don't accept zero size
-	if (!size || (size & (size - 1)) != 0) return false;
-	if (rxBuf != nullptr) free(rxBuf);
-	rxBuf = (u8 *)aligned_alloc(size, size);
-	if (rxBuf == nullptr) return false;
-	rxBufSize = size;
-	return true;
+	return rx.setSize(size);
 }
@@ -22,6 +22,7 @@
 
 #pragma once
 #include "Arduino.h"
+#include "serialDma.h"
 #include "typedefs.h"
 
 typedef struct serialPioHdxConfig {
@@ -37,6 +38,8 @@ public:
 	// from Stream
 	virtual int available() override;
 	int read();
+	/// @brief bulk read from the DMA ring, returns the number of bytes copied
+	size_t read(u8 *buffer, size_t size);
 	int peek();
 
 	// from Print
@@ -61,6 +64,11 @@ public:
 
 	operator bool() override;
 
+	/// @brief RX ring, for the overrun and idle statistics
+	SerialDmaRx &dmaRx() { return rx; }
+	/// @brief TX channel, not running if no DMA channel was free at begin(). Don't mix with write() while busy.
+	SerialDmaTx &dmaTx() { return tx; }
+
 private:
 	void begin();
 	u8 pin = 255;
@@ -71,8 +79,6 @@ private:
 	bool running = false;
 	u8 pioIndex = 255;
 	SerialPioHdxConfig pioConfig;
-	size_t rxBufSize = 0;
-	u8 *rxBuf = nullptr;
-	u8 rxDmaChan = 255;
-	u8 *rxPtr = nullptr;
+	SerialDmaRx rx;
+	SerialDmaTx tx;
 };
@@ -1,6 +1,6 @@
 /**
  * @file i2c.cpp
- * @brief Functions for asynchronous I2C communication
+ * @brief I2C bus manager: queued register transactions on DMA, shared by all I2C sensors
  *
  * Copyright (c) 2026 Kolibri-FC contributors
  *
@@ -20,79 +20,277 @@
  * along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include "Wire.h"
 #include "global.h"
-u8 i2c0blocker = 0; // 0: free, 1: blocked for baro, 2: for mag
 
-static void startI2cTransmission(u8 addr, bool read) {
-	i2c0->hw->enable = 0;
-	i2c0->hw->tar = addr;
-	i2c0->hw->enable = 1;
+#define I2C_HW (I2C_SENSORS->hw)
+#define I2C_MIN_TIMEOUT_US 1000 // on top of twice the bit time of a transfer
 
-	while (i2c_get_read_available(i2c0))
-		i2c0->hw->data_cmd; // flush RX FIFO
+u32 i2cBusRecoveries = 0;
+
+static I2cDevice devices[I2C_MAX_DEVICES] = {};
+static u8 deviceCount = 0;
+static I2cTransaction queue[I2C_QUEUE_SIZE] = {};
+static bool queueUsed[I2C_QUEUE_SIZE] = {};
+static u32 nextSeq = 0;
+
+static I2cTransaction running; // copy of the transaction that is on the bus
+static bool busy = false;
+static u32 runStart = 0;
+static u32 runTimeout = 0;
+static u32 busBaud = 0;
+static u16 cmdBuf[I2C_MAX_LEN + 1]; // IC_DATA_CMD words for the TX DMA: register address, then data bytes or read commands
+static u32 dmaTxChannel = 0, dmaRxChannel = 0;
+static dma_channel_config dmaTxConfig, dmaRxConfig;
+
+void initI2c() {
+	busBaud = I2C_DEFAULT_BAUD;
+	i2c_init(I2C_SENSORS, busBaud); // also enables the DMA requests of the controller
+	gpio_set_function(PIN_SDA0, GPIO_FUNC_I2C);
+	gpio_set_function(PIN_SCL0, GPIO_FUNC_I2C);
+	gpio_pull_up(PIN_SDA0);
+	gpio_pull_up(PIN_SCL0);
+
+	dmaTxChannel = dma_claim_unused_channel(false);
+	dmaRxChannel = dma_claim_unused_channel(false);
+	CRASH_ASSERT(dmaTxChannel < NUM_DMA_CHANNELS && dmaRxChannel < NUM_DMA_CHANNELS); // -1 if none was free
+	dmaTxConfig = dma_channel_get_default_config(dmaTxChannel);
+	dmaRxConfig = dma_channel_get_default_config(dmaRxChannel);
+	channel_config_set_read_increment(&dmaTxConfig, true);
+	channel_config_set_write_increment(&dmaTxConfig, false);
+	channel_config_set_read_increment(&dmaRxConfig, false);
+	channel_config_set_write_increment(&dmaRxConfig, true);
+	channel_config_set_transfer_data_size(&dmaTxConfig, DMA_SIZE_16); // data byte plus the CMD/STOP/RESTART bits
+	channel_config_set_transfer_data_size(&dmaRxConfig, DMA_SIZE_8);
+	channel_config_set_dreq(&dmaTxConfig, i2c_get_dreq(I2C_SENSORS, true));
+	channel_config_set_dreq(&dmaRxConfig, i2c_get_dreq(I2C_SENSORS, false));
 }
 
-void startI2cRead(u8 addr, u8 len) {
-	startI2cTransmission(addr, true);
-	if (len > 16) len = 16;
-	for (int i = 0; i < len; i++) {
-		u32 last = i == len - 1;
+I2cDevice *i2cAddDevice(const char *name, u8 addr, u32 baudrate) {
+	if (deviceCount >= I2C_MAX_DEVICES) return nullptr;
+	I2cDevice &dev = devices[deviceCount++];
+	dev.name = name;
+	dev.addr = addr;
+	dev.baudrate = baudrate;
+	return &dev;
+}
 
-		// clear any errors -> we do not have any way to deal with them appropriately
-		i2c0->hw->tx_abrt_source;
-		if (i2c0->hw->raw_intr_stat & I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS) {
-			i2c0->hw->clr_tx_abrt;
-		}
+u8 i2cDeviceCount() {
+	return deviceCount;
+}
+
+I2cDevice *i2cGetDevice(u8 index) {
+	if (index >= deviceCount) return nullptr;
+	return &devices[index];
+}
 
-		while (!i2c_get_write_available(i2c0))
-			tight_loop_contents();
+void i2cResetStats() {
+	for (int i = 0; i < deviceCount; i++) {
+		I2cDevice &dev = devices[i];
+		dev.transfers = 0;
+		dev.nacks = 0;
+		dev.busErrors = 0;
+		dev.timeouts = 0;
+		dev.expired = 0;
+		dev.queueFull = 0;
+		dev.totalLatency = 0;
+		dev.maxLatency = 0;
+	}
+	i2cBusRecoveries = 0;
+}
 
-		i2c0->hw->data_cmd = (last << I2C_IC_DATA_CMD_STOP_LSB) | I2C_IC_DATA_CMD_CMD_BITS; // -> 1 for read
+static bool submit(I2cDevice *dev, u8 reg, bool read, u8 *buf, const u8 *data, u8 len, I2cCallback callback, I2cPriority priority, u32 deadlineUs, u32 arg) {
+	if (dev == nullptr || len == 0 || len > I2C_MAX_LEN) return false;
+	for (int i = 0; i < I2C_QUEUE_SIZE; i++) {
+		if (queueUsed[i]) continue;
+		I2cTransaction &t = queue[i];
+		t.dev = dev;
+		t.reg = reg;
+		t.read = read;
+		t.len = len;
+		t.buf = buf;
+		if (!read) memcpy(t.data, data, len);
+		t.priority = priority;
+		t.submitted = time_us_32();
+		t.deadline = deadlineUs ? (t.submitted + deadlineUs) | 1 : 0; // never 0, that means no deadline
+		t.seq = nextSeq++;
+		t.callback = callback;
+		t.arg = arg;
+		queueUsed[i] = true;
+		return true;
 	}
+	dev->queueFull++;
+	return false;
 }
 
-void startI2cWrite(u8 addr, u8 *buf, u8 len) {
-	startI2cTransmission(addr, false);
-	if (len > 16) len = 16;
-	for (int i = 0; i < len; i++) {
-		u32 last = i == len - 1;
+bool i2cReadReg(I2cDevice *dev, u8 reg, u8 *buf, u8 len, I2cCallback callback, I2cPriority priority, u32 deadlineUs, u32 arg) {
+	if (buf == nullptr) return false;
+	return submit(dev, reg, true, buf, nullptr, len, callback, priority, deadlineUs, arg);
+}
 
-		// clear any errors -> we do not have any way to deal with them appropriately
-		if (i2c0->hw->tx_abrt_source) {
-			i2c0->hw->clr_tx_abrt;
-		}
+bool i2cWriteReg(I2cDevice *dev, u8 reg, const u8 *data, u8 len, I2cCallback callback, I2cPriority priority, u32 deadlineUs, u32 arg) {
+	if (data == nullptr) return false;
+	return submit(dev, reg, false, nullptr, data, len, callback, priority, deadlineUs, arg);
+}
 
-		while (!i2c_get_write_available(i2c0))
-			tight_loop_contents();
+u8 i2cQueueFree() {
+	u8 free = 0;
+	for (int i = 0; i < I2C_QUEUE_SIZE; i++)
+		if (!queueUsed[i]) free++;
+	return free;
+}
 
-		i2c0->hw->data_cmd = last << I2C_IC_DATA_CMD_STOP_LSB | *buf++;
+/**
+ * @brief Frees the bus if a device holds SDA low
+ *
+ * @details A device that missed clocks in the middle of a byte (reset of the FC during a transfer, glitch on SCL) keeps driving SDA until it got the rest of its clocks. Up to 9 clocks are sent on SCL until SDA is released, then a stop condition resets all devices on the bus. Blocks for about 100µs.
+ */
+static void recoverBus() {
+	i2cBusRecoveries++;
+	I2C_HW->enable = 0;
+	// open drain: output low or input with the pull-up
+	gpio_put(PIN_SCL0, 0);
+	gpio_put(PIN_SDA0, 0);
+	gpio_set_dir(PIN_SCL0, GPIO_IN);
+	gpio_set_dir(PIN_SDA0, GPIO_IN);
+	gpio_set_function(PIN_SCL0, GPIO_FUNC_SIO);
+	gpio_set_function(PIN_SDA0, GPIO_FUNC_SIO);
+	for (int i = 0; i < 9 && !gpio_get(PIN_SDA0); i++) {
+		gpio_set_dir(PIN_SCL0, GPIO_OUT);
+		sleep_us(5);
+		gpio_set_dir(PIN_SCL0, GPIO_IN);
+		sleep_us(5);
 	}
+	// stop condition: SDA rises while SCL is high
+	gpio_set_dir(PIN_SCL0, GPIO_OUT);
+	gpio_set_dir(PIN_SDA0, GPIO_OUT);
+	sleep_us(5);
+	gpio_set_dir(PIN_SCL0, GPIO_IN);
+	sleep_us(5);
+	gpio_set_dir(PIN_SDA0, GPIO_IN);
+	sleep_us(5);
+	gpio_set_function(PIN_SCL0, GPIO_FUNC_I2C);
+	gpio_set_function(PIN_SDA0, GPIO_FUNC_I2C);
+	I2C_HW->enable = 1;
+}
+
+static void stopDma() {
+	dma_channel_abort(dmaTxChannel);
+	dma_channel_abort(dmaRxChannel);
+	while (i2c_get_read_available(I2C_SENSORS))
+		I2C_HW->data_cmd;
 }
 
-int checkI2cWriteDone() {
-	if (i2c0->hw->tx_abrt_source) {
-		i2c0->hw->clr_tx_abrt;
-		return -1;
+static void finishTransfer(I2cResult result) {
+	busy = false;
+	I2cDevice &dev = *running.dev;
+	const u32 latency = time_us_32() - running.submitted;
+	switch (result) {
+	case I2cResult::OK:
+		dev.transfers++;
+		dev.totalLatency += latency;
+		if (latency > dev.maxLatency) dev.maxLatency = latency;
+		break;
+	case I2cResult::NACK:
+		dev.nacks++;
+		break;
+	case I2cResult::BUS_ERROR:
+		dev.busErrors++;
+		break;
+	case I2cResult::TIMEOUT:
+		dev.timeouts++;
+		break;
+	case I2cResult::EXPIRED:
+		dev.expired++;
+		break;
 	}
-	if (i2c0->hw->raw_intr_stat & I2C_IC_RAW_INTR_STAT_TX_EMPTY_BITS) {
-		return 1;
+	if (result != I2cResult::OK) {
+		tasks[TASK_I2C].errorCount++;
+		tasks[TASK_I2C].lastError = (u32)result << 8 | dev.addr;
 	}
-	return 0;
+	if (running.callback) running.callback(running, result);
 }
 
-int getI2cReadCount() {
-	if (i2c0->hw->tx_abrt_source) {
-		i2c0->hw->clr_tx_abrt;
-		return -1;
+// a goes before b: higher priority, then the earlier deadline (none is the latest), then the earlier submission
+static bool runsBefore(const I2cTransaction &a, const I2cTransaction &b) {
+	if (a.priority != b.priority) return a.priority > b.priority;
+	if (a.deadline != b.deadline) {
+		if (!b.deadline) return true;
+		if (!a.deadline) return false;
+		return (i32)(a.deadline - b.deadline) < 0;
 	}
-	return i2c_get_read_available(i2c0);
+	return (i32)(a.seq - b.seq) < 0;
 }
 
-int getI2cReadData(u8 *buf, u8 len) {
-	if (len > 16) len = 16;
-	for (int i = 0; i < len; i++) {
-		*buf++ = (u8)i2c0->hw->data_cmd;
+static void startNext() {
+	const u32 now = time_us_32();
+	int next = -1;
+	for (int i = 0; i < I2C_QUEUE_SIZE; i++) {
+		if (!queueUsed[i]) continue;
+		if (queue[i].deadline && (i32)(now - queue[i].deadline) > 0) {
+			running = queue[i];
+			queueUsed[i] = false;
+			finishTransfer(I2cResult::EXPIRED);
+			continue;
+		}
+		if (next < 0 || runsBefore(queue[i], queue[next])) next = i;
+	}
+	if (next < 0) return;
+
+	// the bus is idle, SDA must be high
+	if (!gpio_get(PIN_SDA0)) recoverBus();
+
+	running = queue[next];
+	queueUsed[next] = false;
+	const u32 baud = running.dev->baudrate ? running.dev->baudrate : I2C_DEFAULT_BAUD;
+	if (baud != busBaud) {
+		i2c_set_baudrate(I2C_SENSORS, baud);
+		busBaud = baud;
+	}
+	I2C_HW->enable = 0;
+	I2C_HW->tar = running.dev->addr;
+	I2C_HW->enable = 1;
+	I2C_HW->clr_tx_abrt;
+	I2C_HW->clr_stop_det;
+
+	cmdBuf[0] = running.reg;
+	if (running.read) {
+		for (int i = 1; i <= running.len; i++)
+			cmdBuf[i] = I2C_IC_DATA_CMD_CMD_BITS;
+		cmdBuf[1] |= I2C_IC_DATA_CMD_RESTART_BITS;
+		dma_channel_configure(dmaRxChannel, &dmaRxConfig, running.buf, &I2C_HW->data_cmd, running.len, true);
+	} else {
+		for (int i = 1; i <= running.len; i++)
+			cmdBuf[i] = running.data[i - 1];
+	}
+	cmdBuf[running.len] |= I2C_IC_DATA_CMD_STOP_BITS;
+	dma_channel_configure(dmaTxChannel, &dmaTxConfig, &I2C_HW->data_cmd, cmdBuf, running.len + 1, true);
+
+	// 9 clocks per byte for address, register, repeated address and data, doubled for clock stretching and gaps
+	runTimeout = I2C_MIN_TIMEOUT_US + (running.len + 3) * 9 * 2000000 / baud;
+	runStart = time_us_32();
+	busy = true;
+}
+
+void i2cLoop() {
+	TASK_START(TASK_I2C);
+	if (busy) {
+		const u32 status = I2C_HW->raw_intr_stat;
+		if (status & I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS) {
+			const u32 source = I2C_HW->tx_abrt_source;
+			stopDma();
+			I2C_HW->clr_tx_abrt;
+			constexpr u32 nackBits = I2C_IC_TX_ABRT_SOURCE_ABRT_7B_ADDR_NOACK_BITS | I2C_IC_TX_ABRT_SOURCE_ABRT_TXDATA_NOACK_BITS;
+			finishTransfer(source & nackBits ? I2cResult::NACK : I2cResult::BUS_ERROR);
+		} else if ((status & I2C_IC_RAW_INTR_STAT_STOP_DET_BITS) && !dma_channel_is_busy(dmaTxChannel) && !dma_channel_is_busy(dmaRxChannel)) {
+			I2C_HW->clr_stop_det;
+			finishTransfer(I2cResult::OK);
+		} else if (time_us_32() - runStart > runTimeout) {
+			stopDma();
+			recoverBus();
+			finishTransfer(I2cResult::TIMEOUT);
+		}
 	}
-	return len;
+	if (!busy) startNext();
+	tasks[TASK_I2C].debugInfo = I2C_QUEUE_SIZE - i2cQueueFree();
+	TASK_END(TASK_I2C);
 }
@@ -1,6 +1,6 @@
 /**
  * @file i2c.h
- * @brief Functions for asynchronous I2C communication
+ * @brief I2C bus manager: queued register transactions on DMA, shared by all I2C sensors
  *
  * Copyright (c) 2026 Kolibri-FC contributors
  *
@@ -20,16 +20,127 @@
  * along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
  */
 
+
 #pragma once
 #include "typedefs.h"
-extern u8 i2c0blocker;
 
-void startI2cRead(u8 addr, u8 len);
+#define I2C_MAX_DEVICES 8 // devices that can be added with i2cAddDevice()
+#define I2C_QUEUE_SIZE 16 // pending transactions of all devices together
+#define I2C_MAX_LEN 16 // data bytes per transaction, the register address is not counted
+#define I2C_DEFAULT_BAUD 400000 // bus speed for devices that do not set their own
+
+enum class I2cResult : u8 {
+	OK = 0,
+	NACK, // address or data byte not acknowledged, device missing or busy
+	BUS_ERROR, // arbitration lost or other abort of the controller
+	TIMEOUT, // transfer did not finish in time, the bus was recovered
+	EXPIRED, // the deadline passed before the transfer could start, nothing was sent
+};
+
+enum class I2cPriority : u8 {
+	LOW = 0, // probing and configuration
+	NORMAL, // regular sensor reads
+	HIGH, // time critical reads, go before everything else that is pending
+};
+
+typedef struct i2cDevice {
+	const char *name;
+	u8 addr; // 7 bit address
+	u32 baudrate; // switched to before each transfer to this device, 0 for I2C_DEFAULT_BAUD
+	// stats since boot or the last i2cResetStats()
+	u32 transfers; // completed successfully
+	u32 nacks;
+	u32 busErrors;
+	u32 timeouts;
+	u32 expired; // dropped because of the deadline
+	u32 queueFull; // submissions that were rejected
+	u32 totalLatency; // us from submission to completion, summed over all transfers
+	u32 maxLatency; // us
+} I2cDevice;
+
+struct i2cTransaction;
+/// @brief called from i2cLoop() when a transaction is done, may submit new transactions
+typedef void (*I2cCallback)(const struct i2cTransaction &t, I2cResult result);
+
+typedef struct i2cTransaction {
+	I2cDevice *dev;
+	u8 reg; // register address, sent first
+	bool read; // read len bytes into buf after a repeated start, otherwise write data
+	u8 len;
+	u8 *buf; // read destination, must stay valid until the callback
+	u8 data[I2C_MAX_LEN]; // copy of the data to write
+	I2cPriority priority;
+	u32 submitted; // time_us_32() of the submission
+	u32 deadline; // time_us_32() by which the transfer has to start, 0 for none
+	u32 seq; // submission order, for fairness between equal transactions
+	I2cCallback callback; // may be nullptr
+	u32 arg; // free for the caller
+} I2cTransaction;
+
+extern u32 i2cBusRecoveries; // stuck SDA or hung transfers that needed clocking out
+
+/// @brief sets up the sensor bus (I2C_SENSORS on PIN_SDA0/PIN_SCL0) and its DMA channels
+void initI2c();
+
+/**
+ * @brief Adds a device to the bus
+ *
+ * @param name shown in the stats, not copied
+ * @param addr 7 bit address
+ * @param baudrate bus speed for this device, 0 for I2C_DEFAULT_BAUD
+ * @return the device for i2cReadReg()/i2cWriteReg(), nullptr if I2C_MAX_DEVICES is reached
+ */
+I2cDevice *i2cAddDevice(const char *name, u8 addr, u32 baudrate = 0);
+
+/**
+ * @brief Queues a register read
+ *
+ * @details The register address is written, then len bytes are read after a repeated start. Pending transactions are started by priority, then by deadline, then in the order of submission.
+ *
+ * @param dev device from i2cAddDevice()
+ * @param reg register address
+ * @param buf destination, written by DMA, must stay valid until the callback
+ * @param len bytes to read, 1...I2C_MAX_LEN
+ * @param callback called from i2cLoop() when done, may be nullptr
+ * @param priority see I2cPriority
+ * @param deadlineUs the transfer is dropped with I2cResult::EXPIRED if it can not start within this time, 0 for no deadline
+ * @param arg stored in the transaction for the callback
+ * @return false if the queue is full or the parameters are invalid, the callback is not called then
+ */
+bool i2cReadReg(I2cDevice *dev, u8 reg, u8 *buf, u8 len, I2cCallback callback, I2cPriority priority = I2cPriority::NORMAL, u32 deadlineUs = 0, u32 arg = 0);
 
-void startI2cWrite(u8 addr, u8 *buf, u8 len);
+/**
+ * @brief Queues a register write
+ *
+ * @details The data is copied, the buffer can be reused right away. See i2cReadReg() for the scheduling.
+ *
+ * @param dev device from i2cAddDevice()
+ * @param reg register address
+ * @param data bytes to write to reg (and the following registers on devices with auto increment)
+ * @param len 1...I2C_MAX_LEN
+ * @param callback called from i2cLoop() when done, may be nullptr
+ * @param priority see I2cPriority
+ * @param deadlineUs the transfer is dropped with I2cResult::EXPIRED if it can not start within this time, 0 for no deadline
+ * @param arg stored in the transaction for the callback
+ * @return false if the queue is full or the parameters are invalid, the callback is not called then
+ */
+bool i2cWriteReg(I2cDevice *dev, u8 reg, const u8 *data, u8 len, I2cCallback callback = nullptr, I2cPriority priority = I2cPriority::NORMAL, u32 deadlineUs = 0, u32 arg = 0);
+
+/// @brief free places in the queue, to submit transactions that belong together only if all fit
+u8 i2cQueueFree();
+
+/**
+ * @brief Runs the bus: finishes the running transfer, calls its callback and starts the next one
+ *
+ * @details Call from the loop on the core of the I2C drivers. Callbacks run in here, so they never race with the drivers.
+ */
+void i2cLoop();
 
-int checkI2cWriteDone();
+/// @brief number of devices added so far, for the stats
+u8 i2cDeviceCount();
 
-int getI2cReadCount();
+/// @brief device by index, for the stats
+I2cDevice *i2cGetDevice(u8 index);
 
-int getI2cReadData(u8 *buf, u8 len);
+/// @brief clears the stats of all devices
+void i2cResetStats();
@@ -29,6 +29,7 @@ static u8 magSubState = 0;
 static elapsedMicros magTimer;
 static u32 magTimerTimeout = 0;
 static u8 magBuffer[6] = {};
+static I2cDevice *magDevice = nullptr;
 i32 magData[3] = {};
 
 i16 magOffset[3] = {};
@@ -38,12 +39,48 @@ fix32 magHeading = 0;
 
 void initMag() {
 	addArraySetting(SETTING_MAG_CAL_HARD, magOffset);
+	magDevice = i2cAddDevice("Mag", MAG_ADDRESS);
+}
 
-	i2c_init(I2C_MAG, 400000);
-	gpio_set_function(PIN_SDA0, GPIO_FUNC_I2C);
-	gpio_set_function(PIN_SCL0, GPIO_FUNC_I2C);
-	gpio_pull_up(PIN_SDA0);
-	gpio_pull_up(PIN_SCL0);
+static void magProbeDone(const I2cTransaction &t, I2cResult result) {
+	magSubState = 0;
+	if (result != I2cResult::OK) return;
+#if HW_MAG == MAG_HMC5883L
+	if (strncmp((char *)magBuffer, "H43", 3) == 0)
+		magState = MagState::INITIALIZING;
+#elif HW_MAG == MAG_QMC5883L
+	if (magBuffer[0] == 0xFF)
+		magState = MagState::INITIALIZING;
+#endif
+}
+
+static void magConfigDone(const I2cTransaction &t, I2cResult result) {
+	if (result != I2cResult::OK) {
+		magState = MagState::NOT_INIT;
+		return;
+	}
+#if HW_MAG == MAG_HMC5883L
+	magDevice->baudrate = 3400000;
+#endif
+}
+
+static void magStatusDone(const I2cTransaction &t, I2cResult result) {
+	magSubState = 0;
+	if (result == I2cResult::OK && magBuffer[0] & (1 << 0)) {
+		// data ready
+		magState = MagState::READ_DATA;
+		magTimerTimeout = 4000;
+	} else {
+		// data not ready, check again in 1ms
+		magState = MagState::MEASURING;
+		magTimerTimeout = 1000;
+	}
+}
+
+static void magDataDone(const I2cTransaction &t, I2cResult result) {
+	magSubState = 0; // retry on errors
+	if (result == I2cResult::OK)
+		magState = magStateAfterRead;
 }
 
 MagState magStateAfterRead = MagState::PROCESS_DATA;
@@ -73,41 +110,29 @@ void magLoop() {
 	TASK_START(TASK_MAG);
 	switch (magState) {
 	case MagState::NOT_INIT:
-		if (magTimer < 5000) break;
-		if (i2c0blocker) break;
+		if (magTimer < 5000 || magSubState) break;
 		magTimer = 0;
 #if HW_MAG == MAG_HMC5883L
-		magBuffer[0] = (u8)MAG_REG::ID_A;
-		i2c_write_blocking(I2C_MAG, MAG_ADDRESS, magBuffer, 1, false);
-		i2c_read_blocking(I2C_MAG, MAG_ADDRESS, magBuffer, 3, false);
-		if (strncmp((char *)magBuffer, "H43", 3) == 0)
-			magState = MagState::INITIALIZING;
+		if (i2cReadReg(magDevice, (u8)MAG_REG::ID_A, magBuffer, 3, magProbeDone, I2cPriority::LOW))
 #elif HW_MAG == MAG_QMC5883L
-		magBuffer[0] = (u8)MAG_REG::ID;
-		i2c_write_blocking(I2C_MAG, MAG_ADDRESS, magBuffer, 1, false);
-		i2c_read_blocking(I2C_MAG, MAG_ADDRESS, magBuffer, 1, false);
-		if (magBuffer[0] == 0xFF)
-			magState = MagState::INITIALIZING;
+		if (i2cReadReg(magDevice, (u8)MAG_REG::ID, magBuffer, 1, magProbeDone, I2cPriority::LOW))
 #endif
+			magSubState = 1;
 		break;
 	case MagState::INITIALIZING:
-		if (i2c0blocker) break;
+		if (i2cQueueFree() < 2) break;
 #if HW_MAG == MAG_HMC5883L
-		magBuffer[0] = (u8)MAG_REG::CONF_REGA;
-		magBuffer[1] = MAG_AVG_8 | MAG_ODR_75HZ | MAG_LOAD_FLOAT;
-		magBuffer[2] = MAG_RANGE_2_5;
-		magBuffer[3] = MAG_MODE_CONTINUOUS | MAG_MODE_HS_I2C;
-		i2c_write_blocking(I2C_MAG, MAG_ADDRESS, magBuffer, 4, false);
-		i2c_set_baudrate(I2C_MAG, 3400000);
+		magBuffer[0] = MAG_AVG_8 | MAG_ODR_75HZ | MAG_LOAD_FLOAT; // CONF_REGA
+		magBuffer[1] = MAG_RANGE_2_5; // CONF_REGB
+		magBuffer[2] = MAG_MODE_CONTINUOUS | MAG_MODE_HS_I2C; // MODE
+		i2cWriteReg(magDevice, (u8)MAG_REG::CONF_REGA, magBuffer, 3, magConfigDone, I2cPriority::LOW);
 		magState = MagState::MEASURING;
 		magTimerTimeout = 13000;
 #elif HW_MAG == MAG_QMC5883L
-		magBuffer[0] = (u8)MAG_REG::SET_RESET;
-		magBuffer[1] = 1;
-		i2c_write_blocking(I2C_MAG, MAG_ADDRESS, magBuffer, 2, false);
-		magBuffer[0] = (u8)MAG_REG::CONTROL_1;
-		magBuffer[1] = MAG_OSR_512 | MAG_RANGE_2 | MAG_ODR_200HZ | MAG_MODE_CONTINUOUS;
-		i2c_write_blocking(I2C_MAG, MAG_ADDRESS, magBuffer, 2, false);
+		magBuffer[0] = 1;
+		i2cWriteReg(magDevice, (u8)MAG_REG::SET_RESET, magBuffer, 1, magConfigDone, I2cPriority::LOW);
+		magBuffer[0] = MAG_OSR_512 | MAG_RANGE_2 | MAG_ODR_200HZ | MAG_MODE_CONTINUOUS;
+		i2cWriteReg(magDevice, (u8)MAG_REG::CONTROL_1, magBuffer, 1, magConfigDone, I2cPriority::LOW);
 		magState = MagState::MEASURING;
 		magTimerTimeout = 4000;
 #endif
@@ -129,77 +154,21 @@ void magLoop() {
 	case MagState::CHECK_DATA_READY: {
 		TASK_START(TASK_MAG_CHECK);
 #if HW_MAG == MAG_QMC5883L
-		// check every ms if data is ready
-		switch (magSubState) {
-		case 0:
-			if (i2c0blocker == 0) {
-				i2c0blocker = 2;
-				magSubState = 1;
-				magBuffer[0] = (u8)MAG_REG::STATUS;
-				startI2cWrite(MAG_ADDRESS, magBuffer, 1);
-			}
-			break;
-		case 1:
-			if (checkI2cWriteDone()) {
-				startI2cRead(MAG_ADDRESS, 1);
-				magSubState = 2;
-			}
-			break;
-		case 2:
-			if (getI2cReadCount()) {
-				getI2cReadData(magBuffer, 1);
-				if (magBuffer[0] & (1 << 0)) {
-					// data ready
-					magState = MagState::READ_DATA;
-					magSubState = 0;
-					magTimerTimeout = 4000;
-				} else {
-					// data not ready, check again in 1ms
-					magState = MagState::MEASURING;
-					magSubState = 0;
-					magTimerTimeout = 1000;
-				}
-				i2c0blocker = 0;
-			}
-			break;
-		}
+		// check every ms if data is ready, magStatusDone() continues
+		if (magSubState == 0 && i2cReadReg(magDevice, (u8)MAG_REG::STATUS, magBuffer, 1, magStatusDone, I2cPriority::NORMAL, 1000))
+			magSubState = 1;
 #endif
 		TASK_END(TASK_MAG_CHECK);
 	} break;
 	case MagState::READ_DATA: {
 		TASK_START(TASK_MAG_READ);
-		switch (magSubState) {
-		case 0:
-			if (i2c0blocker == 0) {
-				i2c0blocker = 2;
-				magSubState = 1;
+		// magDataDone() continues
 #if HW_MAG == MAG_HMC5883L
-				magBuffer[0] = (u8)MAG_REG::DATA_X_H;
+		if (magSubState == 0 && i2cReadReg(magDevice, (u8)MAG_REG::DATA_X_H, magBuffer, 6, magDataDone, I2cPriority::NORMAL, 5000))
 #elif HW_MAG == MAG_QMC5883L
-				magBuffer[0] = (u8)MAG_REG::DATA_X_L;
+		if (magSubState == 0 && i2cReadReg(magDevice, (u8)MAG_REG::DATA_X_L, magBuffer, 6, magDataDone, I2cPriority::NORMAL, 2000))
 #endif
-				startI2cWrite(MAG_ADDRESS, magBuffer, 1);
-			}
-			break;
-		case 1:
-			if (checkI2cWriteDone()) {
-				startI2cRead(MAG_ADDRESS, 6);
-				magSubState = 2;
-			}
-			break;
-		case 2: {
-			i8 rc = getI2cReadCount();
-			if (rc == 6) {
-				getI2cReadData(magBuffer, 6);
-				magState = magStateAfterRead;
-				magSubState = 0;
-				i2c0blocker = 0;
-			} else if (rc < 0) {
-				magSubState = 0;
-				i2c0blocker = 0;
-			}
-		} break;
-		}
+			magSubState = 1;
 		TASK_END(TASK_MAG_READ);
 	} break;
 	case MagState::PROCESS_DATA: {
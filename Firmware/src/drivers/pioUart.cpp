@@ -41,49 +41,47 @@ SerialPio::SerialPio(PIO pioTx, PIO pioRx, i8 smTx, i8 smRx)
 		}
 		offsetsSet = true;
 	}
-	rxDmaChan = dma_claim_unused_channel(false);
 }
 
 SerialPio::~SerialPio() {
-	if (running) {
-		end();
-		if (rxBuf != nullptr) free(rxBuf);
-		if (rxDmaChan != 255) dma_channel_unclaim(rxDmaChan);
-	}
+	if (running) end();
 }
 
 int SerialPio::available() {
-	u8 *dmaPtr = (u8 *)dma_hw->ch[rxDmaChan].write_addr;
-	if (dmaPtr >= rxPtr) return dmaPtr - rxPtr;
-	return rxBufSize - (rxPtr - dmaPtr);
+	return rx.available();
 }
 int SerialPio::read() {
 	if (!running) return -1;
-	volatile u8 *dmaPtr = (volatile u8 *)dma_hw->ch[rxDmaChan].write_addr;
-	if (dmaPtr == rxPtr) return -1;
-	int res = *rxPtr++;
-	if (rxPtr >= rxBuf + rxBufSize)
-		rxPtr = rxBuf;
-	return res;
+	return rx.read();
+}
+size_t SerialPio::read(u8 *buffer, size_t size) {
+	if (!running) return 0;
+	return rx.read(buffer, size);
 }
 int SerialPio::peek() {
-	if (!running || !available()) return -1;
-	return *rxPtr;
+	if (!running) return -1;
+	return rx.peek();
 }
 
 size_t SerialPio::write(uint8_t c) {
 	if (!running) {
 		return 0;
 	}
+	while (tx.busy()) {
+		tight_loop_contents();
+	}
 	u32 data = 0x100 | c;
 	data <<= 1;
-	pio_sm_put_blocking(pioTx, smTx, c);
+	pio_sm_put_blocking(pioTx, smTx, data);
 	return 1;
 }
 size_t SerialPio::write(const uint8_t *buffer, size_t size) {
 	if (!running) {
 		return 0;
 	}
+	while (tx.busy()) {
+		tight_loop_contents();
+	}
 	for (size_t i = 0; i < size; i++) {
 		u32 data = 0x100 | buffer[i];
 		data <<= 1;
@@ -93,18 +91,19 @@ size_t SerialPio::write(const uint8_t *buffer, size_t size) {
 	return size;
 }
 void SerialPio::flush() {
-	while (!pio_sm_is_tx_fifo_empty(pioTx, smTx)) {
+	while (tx.busy() || !pio_sm_is_tx_fifo_empty(pioTx, smTx)) {
 		tight_loop_contents();
 	}
 	return;
 }
 int SerialPio::availableForWrite() {
+	if (tx.busy()) return 0;
 	return 8 - pio_sm_get_tx_fifo_level(pioTx, smTx);
 }
 
 void SerialPio::begin() {
 	if (running) return;
-	if (!pioTx || !pioRx || !baudrate || pinRx == 255 || pinTx == 255 || rxBuf == nullptr || rxDmaChan == 255) {
+	if (!pioTx || !pioRx || !baudrate || pinRx == 255 || pinTx == 255 || !rx.getSize()) {
 		DEBUG_PRINTLN("Assign values to UART first");
 		return;
 	}
@@ -180,18 +179,16 @@ void SerialPio::begin() {
 	uart_tx_program_init(pioTx, smTx, programOffsetsTx[pioIndexTx], pinTx, baudrate);
 	uart_rx_program_init(pioRx, smRx, programOffsetsRx[pioIndexRx], pinRx, baudrate);
 
-	// set up RX DMA channel
-	dma_channel_config_t dmaCfg = dma_channel_get_default_config(rxDmaChan);
-	channel_config_set_read_increment(&dmaCfg, false);
-	channel_config_set_write_increment(&dmaCfg, true);
-	channel_config_set_dreq(&dmaCfg, pio_get_dreq(pioRx, smRx, false));
-	channel_config_set_transfer_data_size(&dmaCfg, DMA_SIZE_8);
-	channel_config_set_ring(&dmaCfg, true, 31 - __builtin_clz(rxBufSize));
-	dma_channel_set_config(rxDmaChan, &dmaCfg, false);
-	dma_channel_set_read_addr(rxDmaChan, ((u8 *)&pioRx->rxf[smRx]) + 3, false);
-	dma_channel_set_write_addr(rxDmaChan, rxBuf, false);
-	dma_channel_set_transfer_count(rxDmaChan, 0xFFFFFFFFUL, true);
-	rxPtr = rxBuf;
+	// RX: DMA ring from the MSB of the FIFO (right shift), TX: framed words, CPU writes if no channel is left
+	if (!rx.start(((u8 *)&pioRx->rxf[smRx]) + 3, pio_get_dreq(pioRx, smRx, false))) {
+		DEBUG_PRINTLN("No free DMA channel for RX");
+		uart_rx_program_end(pioRx, smRx, pinRx);
+		uart_tx_program_end(pioTx, smTx, pinTx);
+		pio_sm_unclaim(pioTx, smTx);
+		pio_sm_unclaim(pioRx, smRx);
+		return;
+	}
+	tx.start(&pioTx->txf[smTx], pio_get_dreq(pioTx, smTx, true), SerialDmaTxFormat::PIO_UART);
 
 	pioConfig.txPio = pioIndexTx;
 	pioConfig.rxPio = pioIndexRx;
@@ -210,6 +207,8 @@ void SerialPio::begin(unsigned long baudrate, uint16_t _config) {
 }
 void SerialPio::end() {
 	running = false;
+	rx.stop();
+	tx.stop();
 
 	// erase this serial from the configs
 	for (auto it = configs.begin(); it != configs.end();) {
@@ -258,11 +257,5 @@ bool SerialPio::setPinout(u8 tx, u8 rx) {
 
 bool SerialPio::setFIFOSize(size_t size) {
 	if (running) return false;
-	// only accept powers of 2, don't accept zero size
-	if (!size || (size & (size - 1)) != 0) return false;
-	if (rxBuf != nullptr) free(rxBuf);
-	rxBuf = (u8 *)aligned_alloc(size, size);
-	if (rxBuf == nullptr) return false;
-	rxBufSize = size;
-	return true;
+	return rx.setSize(size);
 }
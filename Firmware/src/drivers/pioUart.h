@@ -22,6 +22,7 @@
 
 #pragma once
 #include "Arduino.h"
+#include "serialDma.h"
 #include "typedefs.h"
 
 typedef struct serialPioConfig {
@@ -39,6 +40,8 @@ public:
 	// from Stream
 	virtual int available() override;
 	int read();
+	/// @brief bulk read from the DMA ring, returns the number of bytes copied
+	size_t read(u8 *buffer, size_t size);
 	int peek();
 
 	// from Print
@@ -58,6 +61,11 @@ public:
 
 	operator bool() override;
 
+	/// @brief RX ring, for the overrun and idle statistics
+	SerialDmaRx &dmaRx() { return rx; }
+	/// @brief TX channel, not running if no DMA channel was free at begin(). Don't mix with write() while busy.
+	SerialDmaTx &dmaTx() { return tx; }
+
 private:
 	void begin();
 	u8 pinTx = 255;
@@ -73,8 +81,6 @@ private:
 	u8 pioIndexTx = 255;
 	u8 pioIndexRx = 255;
 	SerialPioConfig pioConfig;
-	size_t rxBufSize = 0;
-	u8 *rxBuf = nullptr;
-	u8 rxDmaChan = 255;
-	u8 *rxPtr = nullptr;
+	SerialDmaRx rx;
+	SerialDmaTx tx;
 };
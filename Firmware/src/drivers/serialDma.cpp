@@ -0,0 +1,194 @@
+/**
+ * @file serialDma.cpp
+ * @brief DMA transport for the serial ports
+ *
+ * Copyright (c) 2026 Kolibri-FC contributors
+ *
+ * This file is part of Kolibri-FC (https://github.com/bastian2001/Kolibri-FC).
+ *
+ * Kolibri-FC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Kolibri-FC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "global.h"
+
+SerialDmaRx::~SerialDmaRx() {
+	stop();
+	if (buf != nullptr) free(buf);
+}
+
+bool SerialDmaRx::setSize(size_t size) {
+	if (running()) return false;
+	// only accept powers of 2, don't accept zero size, the DMA ring can wrap at most 32 KB
+	if (!size || (size & (size - 1)) != 0 || size > 32768) return false;
+	if (buf != nullptr) free(buf);
+	buf = (u8 *)aligned_alloc(size, size);
+	if (buf == nullptr) {
+		this->size = 0;
+		return false;
+	}
+	this->size = size;
+	return true;
+}
+
+bool SerialDmaRx::start(const volatile void *src, u32 dreq) {
+	if (running()) return true;
+	if (buf == nullptr) return false;
+	CRASH_ASSERT(((uintptr_t)buf & (size - 1)) == 0); // the ring wraps on address bits, a misaligned buffer gets written past its end
+	chan = dma_claim_unused_channel(false);
+	if (chan < 0) return false;
+
+	dma_channel_config_t cfg = dma_channel_get_default_config(chan);
+	channel_config_set_read_increment(&cfg, false);
+	channel_config_set_write_increment(&cfg, true);
+	channel_config_set_dreq(&cfg, dreq);
+	channel_config_set_transfer_data_size(&cfg, DMA_SIZE_8);
+	channel_config_set_ring(&cfg, true, 31 - __builtin_clz(size));
+	base = 0;
+	readCount = 0;
+	lastWritten = 0;
+	lastRxUs = time_us_32();
+	dma_channel_configure(chan, &cfg, buf, src, SERIAL_DMA_RX_ARM, true);
+	return true;
+}
+
+void SerialDmaRx::stop() {
+	if (!running()) return;
+	dma_channel_abort(chan);
+	dma_channel_unclaim(chan);
+	chan = -1;
+}
+
+u32 SerialDmaRx::written() {
+	u32 remaining = dma_hw->ch[chan].transfer_count & SERIAL_DMA_RX_ARM;
+	if (remaining < SERIAL_DMA_RX_ARM / 2) {
+		// after ~128M bytes: restart the count where the channel is, the peripheral FIFO covers the few cycles in between
+		dma_channel_abort(chan);
+		remaining = dma_hw->ch[chan].transfer_count & SERIAL_DMA_RX_ARM;
+		base += SERIAL_DMA_RX_ARM - remaining;
+		dma_channel_set_trans_count(chan, SERIAL_DMA_RX_ARM, true);
+		remaining = SERIAL_DMA_RX_ARM;
+	}
+	u32 w = base + (SERIAL_DMA_RX_ARM - remaining);
+	if (w != lastWritten) {
+		lastWritten = w;
+		lastRxUs = time_us_32();
+	}
+	return w;
+}
+
+u32 SerialDmaRx::overflowCheck() {
+	u32 w = written();
+	u32 avail = w - readCount;
+	if (avail > size) {
+		// the channel lapped the reader, the oldest bytes are gone
+		overruns += avail - size;
+		readCount = w - size;
+		avail = size;
+	}
+	return avail;
+}
+
+u32 SerialDmaRx::available() {
+	if (!running()) return 0;
+	return overflowCheck();
+}
+
+int SerialDmaRx::read() {
+	if (!running() || !overflowCheck()) return -1;
+	return buf[readCount++ & (size - 1)];
+}
+
+int SerialDmaRx::peek() {
+	if (!running() || !overflowCheck()) return -1;
+	return buf[readCount & (size - 1)];
+}
+
+size_t SerialDmaRx::read(u8 *dest, size_t len) {
+	if (!running()) return 0;
+	u32 avail = overflowCheck();
+	if (len > avail) len = avail;
+	u32 pos = readCount & (size - 1);
+	size_t first = size - pos;
+	if (first > len) first = len;
+	memcpy(dest, buf + pos, first);
+	memcpy(dest + first, buf, len - first);
+	readCount += len;
+	return len;
+}
+
+void SerialDmaRx::clear() {
+	if (!running()) return;
+	overflowCheck();
+	readCount = lastWritten;
+}
+
+u32 SerialDmaRx::idleUs() {
+	if (running()) written();
+	return time_us_32() - lastRxUs;
+}
+
+SerialDmaTx::~SerialDmaTx() {
+	stop();
+	delete[] stage;
+}
+
+bool SerialDmaTx::start(volatile void *dst, u32 dreq, SerialDmaTxFormat format) {
+	if (running()) return true;
+	this->format = format;
+	if (format != SerialDmaTxFormat::BYTES && stage == nullptr) {
+		stage = new u32[SERIAL_DMA_TX_CHUNK];
+		if (stage == nullptr) return false;
+	}
+	chan = dma_claim_unused_channel(false);
+	if (chan < 0) return false;
+
+	dma_channel_config_t cfg = dma_channel_get_default_config(chan);
+	channel_config_set_read_increment(&cfg, true);
+	channel_config_set_write_increment(&cfg, false);
+	channel_config_set_dreq(&cfg, dreq);
+	channel_config_set_transfer_data_size(&cfg, format == SerialDmaTxFormat::BYTES ? DMA_SIZE_8 : DMA_SIZE_32);
+	dma_channel_configure(chan, &cfg, dst, nullptr, 0, false);
+	return true;
+}
+
+void SerialDmaTx::stop() {
+	if (!running()) return;
+	dma_channel_abort(chan);
+	dma_channel_unclaim(chan);
+	chan = -1;
+}
+
+bool SerialDmaTx::busy() const {
+	return running() && dma_channel_is_busy(chan);
+}
+
+size_t SerialDmaTx::write(const u8 *data, size_t len) {
+	if (!running() || busy() || !len) return 0;
+	if (len > SERIAL_DMA_TX_CHUNK) len = SERIAL_DMA_TX_CHUNK;
+	switch (format) {
+	case SerialDmaTxFormat::BYTES:
+		dma_channel_transfer_from_buffer_now(chan, data, len);
+		return len;
+	case SerialDmaTxFormat::WORDS:
+		for (size_t i = 0; i < len; i++)
+			stage[i] = data[i];
+		break;
+	case SerialDmaTxFormat::PIO_UART:
+		for (size_t i = 0; i < len; i++)
+			stage[i] = (0x100 | data[i]) << 1; // start bit (0), 8 data bits, stop bit (1)
+		break;
+	}
+	dma_channel_transfer_from_buffer_now(chan, stage, len);
+	return len;
+}
@@ -0,0 +1,112 @@
+/**
+ * @file serialDma.h
+ * @brief DMA transport for the serial ports: ring buffer RX with idle detection and chunked TX
+ *
+ * Copyright (c) 2026 Kolibri-FC contributors
+ *
+ * This file is part of Kolibri-FC (https://github.com/bastian2001/Kolibri-FC).
+ *
+ * Kolibri-FC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Kolibri-FC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include "typedefs.h"
+#include <stddef.h>
+
+#define SERIAL_DMA_TX_CHUNK 128 // max bytes per TX transfer, PIO ports stage this many words
+#define SERIAL_DMA_RX_ARM 0x0FFFFFFFUL // transfer count of the RX channel, re-armed when it runs low
+
+/**
+ * @brief Peripheral RX FIFO -> ring buffer, without any CPU work per byte
+ *
+ * @details The channel writes into a power of 2 sized, aligned ring and counts down a normal (not endless) transfer count, so the number of received bytes is always known. The reader keeps its own count, if the DMA got more than a full ring ahead, the overwritten bytes are counted as overruns and skipped. Every poll (available(), read()) also notes when the write position last moved, which gives the time the line has been idle.
+ */
+class SerialDmaRx {
+public:
+	SerialDmaRx() = default;
+	SerialDmaRx(const SerialDmaRx &) = delete;
+	~SerialDmaRx();
+
+	/// @brief allocates the ring, size must be a power of 2, only while stopped
+	bool setSize(size_t size);
+	size_t getSize() const { return size; }
+
+	/**
+	 * @brief Claims a channel and starts the transfer
+	 *
+	 * @param src byte address to read from (UART DR, or the MSB of a PIO RX FIFO for right-shifting programs)
+	 * @param dreq DREQ of the peripheral
+	 * @return false if no ring is allocated or no channel is free
+	 */
+	bool start(const volatile void *src, u32 dreq);
+	void stop();
+	bool running() const { return chan >= 0; }
+
+	u32 available();
+	int read();
+	int peek();
+	/// @brief copies up to len bytes, returns how many were copied
+	size_t read(u8 *buf, size_t len);
+	/// @brief drops everything received so far
+	void clear();
+
+	/// @brief time since the last byte arrived, resolution is the polling interval
+	u32 idleUs();
+
+	u32 overruns = 0; // bytes lost because the ring was full
+
+private:
+	u32 written(); // bytes written by the channel since start(), also notes the idle time and re-arms
+	u32 overflowCheck();
+
+	i32 chan = -1;
+	u8 *buf = nullptr;
+	size_t size = 0;
+	u32 base = 0; // bytes written before the last re-arm
+	u32 readCount = 0;
+	u32 lastWritten = 0;
+	u32 lastRxUs = 0;
+};
+
+enum class SerialDmaTxFormat : u8 {
+	BYTES, // 8 bit transfers straight from the caller's buffer (hardware UART, DR)
+	WORDS, // each byte zero-extended to a 32 bit FIFO word (half-duplex PIO, which treats 0xFFFFFFFF as "no data")
+	PIO_UART, // each byte framed to start, 8 data and stop bit for the 10 bit autopull of uart_tx
+};
+
+/**
+ * @brief Chunked DMA into a peripheral TX FIFO
+ *
+ * @details With BYTES the transfer reads straight from the given buffer, which has to stay untouched until busy() returns false. The word formats copy (and frame) up to SERIAL_DMA_TX_CHUNK bytes into a staging buffer, the source can be reused right away.
+ */
+class SerialDmaTx {
+public:
+	SerialDmaTx() = default;
+	SerialDmaTx(const SerialDmaTx &) = delete;
+	~SerialDmaTx();
+
+	/// @brief claims a channel, false if none is free (the caller then falls back to CPU writes)
+	bool start(volatile void *dst, u32 dreq, SerialDmaTxFormat format);
+	void stop();
+	bool running() const { return chan >= 0; }
+	bool busy() const;
+
+	/// @brief starts a transfer of up to SERIAL_DMA_TX_CHUNK bytes, returns how many were taken, 0 if still busy
+	size_t write(const u8 *data, size_t len);
+
+private:
+	i32 chan = -1;
+	SerialDmaTxFormat format = SerialDmaTxFormat::BYTES;
+	u32 *stage = nullptr;
+};
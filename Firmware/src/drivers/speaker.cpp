@@ -125,9 +125,10 @@ void initSpeaker() {
 	pwm_set_enabled(sliceNum, true);
 
 #if BLACKBOX_STORAGE == SD_BB
-	speakerDmaAChan = dma_claim_unused_channel(true);
+	speakerDmaAChan = dma_claim_unused_channel(false);
+	speakerDmaBChan = dma_claim_unused_channel(false);
+	CRASH_ASSERT(speakerDmaAChan < NUM_DMA_CHANNELS && speakerDmaBChan < NUM_DMA_CHANNELS); // -1 if none was free
 	speakerDmaAConfig = dma_channel_get_default_config(speakerDmaAChan);
-	speakerDmaBChan = dma_claim_unused_channel(true);
 	speakerDmaBConfig = dma_channel_get_default_config(speakerDmaBChan);
 	channel_config_set_read_increment(&speakerDmaAConfig, true);
 	channel_config_set_write_increment(&speakerDmaAConfig, false);
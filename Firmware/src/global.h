@@ -62,8 +62,10 @@
 #include "adc.h"
 #include "blackbox.h"
 #include "control.h"
+#include "crashDump.h"
 #include "customSimdMath.h"
 #include "drivers/baro.h"
+#include "drivers/crcSniffer.h"
 #include "drivers/esc.h"
 #include "drivers/flashBb.h"
 #include "drivers/gyro.h"
@@ -71,6 +73,7 @@
 #include "drivers/i2c.h"
 #include "drivers/mag.h"
 #include "drivers/pioUart.h"
+#include "drivers/serialDma.h"
 #include "drivers/speaker.h"
 #include "drivers/spi.h"
 #include "imu.h"
@@ -94,6 +97,9 @@
 #include "serialhandler/elrs.h"
 #include "serialhandler/gps.h"
 #include "serialhandler/msp.h"
+#include "serialhandler/mspBlackbox.h"
+#include "serialhandler/serialBridge.h"
+#include "serialhandler/serialDetect.h"
 #include "serialhandler/tramp.h"
 #include "settings/arraySetting.h"
 #include "settings/littleFs.h"
@@ -103,6 +109,7 @@
 #include "taskManager.h"
 #include "typedefs.h"
 #include "unittest.h"
+#include "utils/checksum.h"
 #include "utils/filters.h"
 #include "utils/koliSerial.h"
 #include "utils/quaternion.h"
@@ -111,10 +118,6 @@
 #define SPI_BARO spi0 // SPI for baro
 #endif
 
-#if HW_BARO == BARO_LPS22
-#define I2C_BARO i2c0 // I2C for baro
-#endif
-
 #define PROPS_OUT
 
 #define ARRAYLEN(arr) (sizeof(arr) / sizeof(arr[0])) // Get the length of an array
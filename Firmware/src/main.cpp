@@ -34,6 +34,7 @@ void setup() {
 	sleep_ms(100);
 	set_sys_clock_khz(360000, false);
 
+	initCrashDump();
 	initFixMath();
 
 	runUnitTests();
@@ -55,6 +56,8 @@ void setup() {
 	OsdCanvas::get().begin();
 	AnalogOsdOutput::get().begin();
 	inFlightTuningInit();
+	initI2c();
+	initBaro();
 	initMag();
 	imuInit();
 	initADC();
@@ -82,6 +85,7 @@ void setup() {
 
 	rp2040.wdt_begin(200);
 	rp2040.wdt_reset();
+	startCrashWatchdog();
 
 	DEBUG_PRINTLN("Setup complete");
 	taskTimer0 = 0;
@@ -99,6 +103,7 @@ void loop() {
 	}
 	TASK_START(TASK_LOOP0);
 	speakerLoop();
+	i2cLoop();
 	baroLoop();
 #ifdef BLACKBOX_STORAGE
 	blackboxLoop();
@@ -135,6 +140,7 @@ void setup1() {
 	while (!(setupDone & 0b1)) {
 		tight_loop_contents();
 	}
+	initCrashDumpCore1();
 	initESCs();
 	gyroInit();
 	setupDone |= 0b10000;
@@ -22,8 +22,6 @@
 
 #include "global.h"
 
-u32 crcLutD5[256] = {};
-
 char const serialFunctionNames[SERIAL_FUNCTION_COUNT][20] = {
 	"CRSF",
 	"MSP",
@@ -33,12 +31,15 @@ char const serialFunctionNames[SERIAL_FUNCTION_COUNT][20] = {
 	"Smartaudio",
 	"ESC Telem",
 	"MSP Displayport",
+	"Auto detect",
 };
 
 std::optional<KoliSerial> serials[SERIAL_COUNT];
+static SerialDetector *detectors[SERIAL_COUNT] = {}; // only allocated for ports with SERIAL_AUTO_DETECT, the parsers take about 5 KB
 static SerialConfig serialConfigs[SERIAL_COUNT] = {};
 static u32 serialConfigsSettings[SERIAL_COUNT - 1][16] = {};
-static u8 currentSerial = 0;
+static u8 currentSerial = 0; // first port of the next serialLoop() pass
+static u8 rxBuf[SERIAL_RX_CHUNK]; // bytes copied out of one RX ring at once, serialLoop() only runs on core 0
 static u32 freeInstructions[NUM_PIOS] = {}; // we need to copy it manually, because the variable is static
 static u8 freeSms[NUM_PIOS] = {};
 static elapsedMicros lastMspReset = 0;
@@ -55,6 +56,8 @@ void stopSerials() {
 	// destroy all the serials (end() is called in the destructor)
 	for (int i = 1; i < SERIAL_COUNT; i++) {
 		if (serials[i]) serials[i].reset();
+		delete detectors[i];
+		detectors[i] = nullptr;
 	}
 }
 
@@ -75,6 +78,7 @@ static void settingsToConfigs(SerialConfig cfgs[SERIAL_COUNT - 1]) {
 		cfg.baud = setting[4];
 		cfg.functions = setting[5];
 		cfg.mspDpSettings = setting[6];
+		cfg.flags = setting[7];
 	}
 }
 
@@ -89,6 +93,7 @@ static void configsToSettings(const SerialConfig cfgs[SERIAL_COUNT - 1]) {
 		setting[4] = cfg.baud;
 		setting[5] = cfg.functions;
 		setting[6] = cfg.mspDpSettings;
+		setting[7] = cfg.flags;
 	}
 }
 
@@ -102,6 +107,7 @@ static void setSerialDefaults() {
 		setting[4] = 0;
 		setting[5] = 0;
 		setting[6] = 0;
+		setting[7] = 0;
 	}
 }
 
@@ -159,8 +165,17 @@ bool startSerials(SerialConfig newCfgs[SERIAL_COUNT - 1]) {
 		u32 rxFifo = 4;
 		u32 baud = 115200;
 		u16 config = SERIAL_8N1;
+		bool inverted = cfg.flags & SERIAL_FLAG_INVERTED;
 
-		if (cfg.functions & SERIAL_CRSF) {
+		if (cfg.functions & SERIAL_AUTO_DETECT) {
+			// the other functions only start once the detector found something
+			if (rxFifo < 256) rxFifo = 256;
+			delete detectors[i + 1];
+			detectors[i + 1] = new SerialDetector();
+			detectors[i + 1]->begin(millis());
+			baud = detectors[i + 1]->probe().baud;
+			inverted = detectors[i + 1]->probe().inverted;
+		} else if (cfg.functions & SERIAL_CRSF) {
 			if (rxFifo < 256) rxFifo = 256;
 			baud = 420000;
 			elrsSerial = &serial;
@@ -188,7 +203,7 @@ bool startSerials(SerialConfig newCfgs[SERIAL_COUNT - 1]) {
 			// baud = MSP_DP_SPEED;
 			serial.getDp()->setSettings(cfg.mspDpSettings);
 		}
-		if (cfg.baud) baud = cfg.baud;
+		if (cfg.baud && detectors[i + 1] == nullptr) baud = cfg.baud;
 
 		if (!pinIsAllowed(cfg.txPin) || !pinIsAllowed(cfg.rxPin)) {
 			success = false;
@@ -197,6 +212,7 @@ bool startSerials(SerialConfig newCfgs[SERIAL_COUNT - 1]) {
 
 		serial.setPinout(cfg.txPin, cfg.rxPin);
 		serial.setRxFifoSize(rxFifo);
+		serial.setInverted(inverted);
 		serial.begin(baud, config);
 		if (!serial) {
 			success = false;
@@ -247,16 +263,8 @@ u8 getFreeSms(int pioNum) { return freeSms[pioNum]; }
 void initSerial() {
 	addArraySetting(SETTING_SERIAL_CONFIGS, serialConfigsSettings, &setSerialDefaults);
 
-	for (u32 i = 0; i < 256; i++) {
-		u32 crc = i;
-		for (u32 j = 0; j < 8; j++) {
-			if (crc & 0x80)
-				crc = (crc << 1) ^ 0xD5;
-			else
-				crc <<= 1;
-		}
-		crcLutD5[i] = crc & 0xFF;
-	}
+	crcInit();
+	initCrcSniffer();
 
 	for (int i = 0; i < NUM_PIOS; i++) {
 		PIO pio = pio_get_instance(i);
@@ -284,27 +292,74 @@ void initSerial() {
 	startSerials(cfgs);
 }
 
-void serialLoop() {
-	TASK_START(TASK_SERIAL);
-
-	if (++currentSerial >= SERIAL_COUNT) currentSerial = 0;
-	if (!serials[currentSerial]) return;
+// switches the port to the detected function and saves that, restarts all ports, so it waits until disarmed
+static void applyDetection(u8 index) {
+	static const u32 detectedFunctions[SerialDetector::PROTOCOL_COUNT] = {0, SERIAL_CRSF, SERIAL_MSP, SERIAL_GPS, SERIAL_IRC_TRAMP};
+	// copies, the detector is gone after stopSerials()
+	const SerialDetector::Protocol protocol = detectors[index]->result();
+	const SerialProbe probe = detectors[index]->probe();
 
-	KoliSerial &serial = *serials[currentSerial];
-	const u32 &functions = serial.functions();
+	SerialConfig cfgs[SERIAL_COUNT - 1];
+	for (int i = 0; i < SERIAL_COUNT - 1; i++) {
+		cfgs[i] = serialConfigs[i + 1];
+	}
+	SerialConfig &cfg = cfgs[index - 1];
+	cfg.functions = detectedFunctions[protocol];
+	// the GPS driver negotiates the baud rate with the receiver itself
+	cfg.baud = protocol == SerialDetector::GPS ? 0 : probe.baud;
+	if (probe.inverted)
+		cfg.flags |= SERIAL_FLAG_INVERTED;
+	else
+		cfg.flags &= ~SERIAL_FLAG_INVERTED;
 
-	if (!functions) {
-		while (serial.read() != -1) { // empty RX buf
-			tight_loop_contents();
-		}
-		TASK_END(TASK_SERIAL);
+	stopSerials();
+	if (!startSerials(cfgs)) {
+		revertSerials();
 		return;
 	}
+	openSettingsFile();
+	getSetting(SETTING_SERIAL_CONFIGS)->updateSettingInFile();
+	printfIndMessage("Serial %d: detected %s at %d baud%s", index, SerialDetector::protocolName(protocol), probe.baud, probe.inverted ? ", inverted" : "");
+}
 
-	// max 16 chars per loop, stop when no char to read
-	for (int i = 16; i; i--) {
-		int c = serial.read();
-		if (c == -1) break;
+// may restart all ports, returns true then (serial is invalid afterwards)
+static bool autoDetectLoop(u8 index, KoliSerial &serial, u32 &budget) {
+	SerialDetector &det = *detectors[index];
+	while (budget) {
+		size_t rxLen = serial.read(rxBuf, min((u32)sizeof(rxBuf), budget));
+		if (!rxLen) break;
+		budget -= rxLen;
+		det.feed(rxBuf, rxLen);
+	}
+	if (det.tick(millis())) {
+		const SerialProbe &probe = det.probe();
+		serial.setBaudrate(probe.baud);
+		serial.setInverted(probe.inverted);
+		u8 query[16];
+		u8 queryLen = det.query(query);
+		if (queryLen) serial.write(query, queryLen);
+	}
+	serial.loop();
+
+	if (det.result() == SerialDetector::NONE || armed) return false;
+	applyDetection(index);
+	return true;
+}
+
+/// @brief bytes the queues of the port's functions can take, the rest stays in the port's RX buffer until they are read
+static u32 rxRoom(u32 functions) {
+	u32 room = SERIAL_RX_CHUNK;
+	if (functions & SERIAL_CRSF) room = min(room, (u32)elrsBuffer.freeSpace());
+	if (functions & SERIAL_GPS) room = min(room, (u32)gpsBuffer.freeSpace());
+	if (functions & SERIAL_IRC_TRAMP) room = min(room, (u32)trampRxBuffer.freeSpace());
+	return room;
+}
+
+/// @brief hands received bytes to the functions of the port, returns the time spent in MSP handlers
+static u32 handleRx(KoliSerial &serial, u32 functions, const u8 *data, size_t len) {
+	u32 handlerUs = 0;
+	for (size_t i = 0; i < len; i++) {
+		u8 c = data[i];
 
 		if (functions & SERIAL_CRSF) {
 			if (!elrsBuffer.isFull())
@@ -314,7 +369,7 @@ void serialLoop() {
 			rp2040.wdt_reset();
 			elapsedMicros timer = 0;
 			serial.mspParser().handleByte(c);
-			taskTimerTASK_SERIAL -= timer;
+			handlerUs += timer;
 		}
 		if (functions & SERIAL_GPS) {
 			if (!gpsBuffer.isFull())
@@ -332,7 +387,56 @@ void serialLoop() {
 		if (functions & SERIAL_ESC_TELEM) {
 		}
 	}
-	serial.loop();
+	return handlerUs;
+}
+
+void serialLoop() {
+	TASK_START(TASK_SERIAL);
+
+	// every port every pass, RX limited by a shared budget. The pass starts where the last one ran out of budget, so a flooded port cannot starve the ones behind it
+	elapsedMicros passTime = 0;
+	u32 budget = SERIAL_LOOP_RX_BUDGET;
+	const u8 first = currentSerial;
+	for (u8 n = 0; n < SERIAL_COUNT; n++) {
+		const u8 index = (first + n) % SERIAL_COUNT;
+		if (!serials[index]) continue;
+		if (passTime >= SERIAL_LOOP_TIME_BUDGET_US) budget = 0;
+		const u32 budgetBefore = budget;
+
+		KoliSerial &serial = *serials[index];
+		const u32 functions = serial.functions();
+
+		if ((functions & SERIAL_AUTO_DETECT) && detectors[index] != nullptr) {
+			if (autoDetectLoop(index, serial, budget)) break; // ports restarted
+		} else if (!functions) {
+			while (serial.read(rxBuf, sizeof(rxBuf))) { // empty RX buf, nobody is waiting for it
+				tight_loop_contents();
+			}
+		} else {
+			bool received = false;
+			while (budget && passTime < SERIAL_LOOP_TIME_BUDGET_US) {
+				// whatever is there (read() stops at what is available), not in small fixed steps
+				u32 len = min(rxRoom(functions), budget);
+				if (!len) break;
+				len = serial.read(rxBuf, len);
+				if (!len) break;
+				received = true;
+				budget -= len;
+				taskTimerTASK_SERIAL -= handleRx(serial, functions, rxBuf, len);
+				if (!serials[index]) break; // an MSP command reconfigured the ports
+			}
+			if (!serials[index]) continue;
+			if (!received && (functions & (SERIAL_MSP | SERIAL_MSP_DISPLAYPORT)) && serial.rxIdleUs() > MSP_RX_TIMEOUT_US) {
+				// line went idle in the middle of a frame: the rest is not coming, don't let it swallow the start of the next one
+				serial.mspParser().abortFrame();
+			}
+			if (functions & SERIAL_MSP) {
+				mspStreamLoop(serial);
+			}
+			serial.loop();
+		}
+		if (budgetBefore && (!budget || passTime >= SERIAL_LOOP_TIME_BUDGET_US)) currentSerial = (index + 1) % SERIAL_COUNT;
+	}
 
 	if (lastMspReset > 1000000) {
 		for (auto &s : serials) {
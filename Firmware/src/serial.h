@@ -22,6 +22,7 @@
 
 #pragma once
 
+#include "utils/checksum.h"
 #include "utils/koliSerial.h"
 #include <Arduino.h>
 #include <optional>
@@ -35,9 +36,16 @@
 #define SERIAL_SMARTAUDIO (1 << 5)
 #define SERIAL_ESC_TELEM (1 << 6)
 #define SERIAL_MSP_DISPLAYPORT (1 << 7)
+#define SERIAL_AUTO_DETECT (1 << 8) // probes baud rates and polarity until CRSF, MSP, GPS or Tramp is found, then replaces itself with that function, see SerialDetector
 
 #define SERIAL_COUNT 5
-#define SERIAL_FUNCTION_COUNT 8
+#define SERIAL_RX_CHUNK 256 // max bytes copied out of a port's RX buffer at once
+#define SERIAL_LOOP_RX_BUDGET 2048 // max received bytes handled per serialLoop(), over all ports
+#define SERIAL_LOOP_TIME_BUDGET_US 300 // no further RX chunk is started after this long, handlers included
+#define SERIAL_FUNCTION_COUNT 9
+
+#define SERIAL_FLAG_INVERTED (1 << 0) // RX and TX levels inverted
+#define SERIAL_FLAG_COUNT 1
 
 typedef struct serialConfig {
 	SerialType type = SerialType::DISABLED;
@@ -47,6 +55,7 @@ typedef struct serialConfig {
 	u32 baud = 0;
 	u32 functions = 0;
 	u8 mspDpSettings = 0;
+	u8 flags = 0; // SERIAL_FLAG_ bits
 } SerialConfig;
 
 void revertSerials();
@@ -60,10 +69,9 @@ u8 getFreeSms(int pioNum);
 // 0 = Serial (USB CDC), 1 = Serial1 = UART0, 2 = Serial2 = UART1, 3 = Software Serial
 extern std::optional<KoliSerial> serials[SERIAL_COUNT];
 
-extern u32 crcLutD5[256]; // u32 is used because it is faster than u8
 #define CRC_LUT_D5_APPLY(crc, data) crc = crcLutD5[(crc) ^ (u8)(data)]
 
-/// @brief fills crcLutD5
+/// @brief fills the checksum tables, sets up the serial ports
 void initSerial();
 
 /// @brief reads the serial port and sends it to the appropriate handler
@@ -20,6 +20,7 @@
  * along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "4wayParser.h"
 #include "global.h"
 #include "pioasm/onewire_receive.pio.h"
 #include "pioasm/onewire_transmit.pio.h"
@@ -47,16 +48,6 @@ static std::deque<uint8_t> escRxBuf;
 #define SERIAL_4WAY_VERSION_LO (uint8_t)(SERIAL_4WAY_VERSION % 100)
 #define IM_ARM_BLB 4
 
-enum class State4Way {
-	IDLE, // waiting for '/'
-	CMD,
-	ADDR_HI,
-	ADDR_LO,
-	LEN,
-	PAYLOAD,
-	CHECKSUM_HI,
-	CHECKSUM_LO
-};
 enum class Res4Way {
 	ACK_OK = 0x00,
 	NACK_INVALID_CMD = 0x02,
@@ -193,17 +184,6 @@ uint16_t byteCrc4Way(uint8_t data, uint16_t crc) {
 	return crc;
 }
 
-u16 crcUpdateXmodem(u16 crc, u8 c) {
-	crc ^= (u16)c << 8;
-	for (u8 i = 0; i < 8; i++) {
-		if (crc & 0x8000)
-			crc = (crc << 1) ^ 0x1021;
-		else
-			crc <<= 1;
-	}
-	return crc;
-}
-
 void sendEsc(uint8_t tx_buf[], uint16_t buf_size, bool CRC = true) {
 	uint16_t i = 0;
 	u16 esc_crc = 0;
@@ -223,7 +203,8 @@ void sendEsc(uint8_t tx_buf[], uint16_t buf_size, bool CRC = true) {
 	pioDisableTx();
 }
 
-uint16_t getEsc(uint8_t rx_buf[], uint16_t wait_ms) {
+/// @brief reads one answer of the ESC into rx_buf, bytes beyond bufSize are read and dropped
+uint16_t getEsc(uint8_t rx_buf[], uint16_t bufSize, uint16_t wait_ms) {
 	uint16_t i = 0;
 	bool timeout = false;
 	while ((!pioAvailable()) && (!timeout)) {
@@ -236,8 +217,8 @@ uint16_t getEsc(uint8_t rx_buf[], uint16_t wait_ms) {
 	}
 	i = 0;
 	while (pioAvailable()) {
-		rx_buf[i] = pioRead();
-		i++;
+		u8 c = pioRead();
+		if (i < bufSize) rx_buf[i++] = c;
 		rp2040.wdt_reset();
 		if (!pioAvailable())
 			delayMicrosWhileRead(1000);
@@ -295,15 +276,10 @@ void send4WayResponse(u8 cmd, u16 address, u8 *payload = nullptr, u16 len = 1, R
 	else if (payload == nullptr && len == 1)
 		payload = &dummy;
 	if (len == 0) len = 256;
-	u16 crc = 0;
 	u8 header[5] = {0x2E, cmd, (u8)(address >> 8), (u8)(address & 0xFF), (u8)(len & 0xFF)};
-	for (u16 i = 0; i < 5; i++) {
-		crc = crcUpdateXmodem(crc, header[i]);
-	}
-	for (u16 i = 0; i < len; i++) {
-		crc = crcUpdateXmodem(crc, payload[i]);
-	}
-	crc = crcUpdateXmodem(crc, (u8)resCode);
+	u16 crc = crc16Xmodem(header, 5);
+	crc = crc16XmodemDma(payload, len, crc);
+	crc = crc16XmodemByte(crc, (u8)resCode);
 	serial4Way->write(header, 5);
 	serial4Way->write(payload, len);
 	serial4Way->write((u8)resCode);
@@ -318,7 +294,7 @@ uint8_t blSendCmdSetAddr(uint8_t addrHi, uint8_t addrLo) {
 	uint8_t rxBuf[50] = {};
 	sendEsc(sCmd, 4);
 	delayWhileRead(5);
-	uint16_t rxSize = getEsc(rxBuf, 20);
+	uint16_t rxSize = getEsc(rxBuf, sizeof(rxBuf), 20);
 	// return (rxSize ? rxBuf[rxSize - 1] : brNONE) == brSUCCESS;
 	return rxSize && rxBuf[rxSize - 1] == (u8)BlRes::SUCCESS;
 }
@@ -328,12 +304,12 @@ uint8_t blSendCmdSetBuf(uint8_t len, uint8_t buf[256]) {
 	uint8_t rxBuf[50] = {};
 	sendEsc(sCmd, 4);
 	delayWhileRead(5);
-	uint16_t rxSize = getEsc(rxBuf, 20);
+	uint16_t rxSize = getEsc(rxBuf, sizeof(rxBuf), 20);
 	if (rxSize && rxBuf[rxSize - 1] != (u8)BlRes::NONE) return 0;
 
 	sendEsc(buf, len);
 	delayWhileRead(5);
-	rxSize = getEsc(rxBuf, 80);
+	rxSize = getEsc(rxBuf, sizeof(rxBuf), 80);
 	return rxSize && rxBuf[rxSize - 1] == (u8)BlRes::SUCCESS;
 }
 
@@ -344,7 +320,7 @@ uint8_t blVerifyFlash(uint8_t len, uint8_t buf[256], uint8_t addrHi, uint8_t add
 		if (!blSendCmdSetBuf(len, buf)) return 0;
 		sendEsc(sCmd, 2);
 		delayWhileRead(5);
-		uint16_t rxSize = getEsc(rxBuf, 20);
+		uint16_t rxSize = getEsc(rxBuf, sizeof(rxBuf), 20);
 		return rxSize ? rxBuf[rxSize - 1] : (u8)BlRes::NONE;
 	}
 	return 0;
@@ -359,7 +335,7 @@ void process4WayCmd(u8 cmd, u16 address, u8 *payload, u16 len) {
 		buf[1] = 0;
 		sendEsc(buf, 2);
 		delayWhileRead(5);
-		getEsc(buf, 200); // data is ignored
+		getEsc(buf, sizeof(buf), 200); // data is ignored
 		send4WayResponse(cmd, address);
 		break;
 
@@ -390,7 +366,7 @@ void process4WayCmd(u8 cmd, u16 address, u8 *payload, u16 len) {
 			buf[1] = 0;
 			sendEsc(buf, 2);
 			pioResetESC();
-			getEsc(buf, 50); // data is ignored
+			getEsc(buf, sizeof(buf), 50); // data is ignored
 			send4WayResponse(cmd, address);
 		} else {
 			send4WayResponse(cmd, address, nullptr, 1, Res4Way::NACK_INVALID_CHANNEL);
@@ -402,7 +378,7 @@ void process4WayCmd(u8 cmd, u16 address, u8 *payload, u16 len) {
 			changePin(PIN_MOTORS + payload[0]);
 			u8 bootInit[] = {0, 0, 0, 0, 0, 0, 0, 0, 0x0D, 'B', 'L', 'H', 'e', 'l', 'i', 0xF4, 0x7D};
 			sendEsc(bootInit, 17, false);
-			u8 rxSize = getEsc(buf, 200);
+			u8 rxSize = getEsc(buf, sizeof(buf), 200);
 			if (rxSize && buf[rxSize - 1] == (u8)BlRes::SUCCESS) {
 				buf[0] = buf[5]; // Device Signature2?
 				buf[1] = buf[4]; // Device Signature1?
@@ -428,13 +404,13 @@ void process4WayCmd(u8 cmd, u16 address, u8 *payload, u16 len) {
 		buf[3] = address & 0xFF;
 		sendEsc(buf, 4);
 		delayWhileRead(5);
-		u16 rxSize = getEsc(buf, 200);
+		u16 rxSize = getEsc(buf, sizeof(buf), 200);
 		if (buf[0] == (u8)BlRes::SUCCESS) {
 			buf[0] = (u8)BlCmd::READ_FLASH_SIL;
 			buf[1] = payload[0];
 			sendEsc(buf, 2);
-			rxSize = getEsc(buf, 500);
-			if (rxSize) {
+			rxSize = getEsc(buf, sizeof(buf), 500);
+			if (rxSize >= 3) {
 				u16 rxCrc = 0;
 				if (buf[rxSize - 1] != (u8)BlRes::SUCCESS) {
 					send4WayResponse(cmd, address, nullptr, 1, Res4Way::NACK_GENERAL_ERROR);
@@ -465,7 +441,7 @@ void process4WayCmd(u8 cmd, u16 address, u8 *payload, u16 len) {
 		buf[2] = address >> 8;
 		buf[3] = address & 0xFF;
 		sendEsc(buf, 4);
-		u16 rxSize = getEsc(buf, 100);
+		u16 rxSize = getEsc(buf, sizeof(buf), 100);
 		if (buf[0] != (u8)BlRes::SUCCESS) {
 			send4WayResponse(cmd, address, nullptr, 1, Res4Way::NACK_GENERAL_ERROR);
 			break;
@@ -477,7 +453,7 @@ void process4WayCmd(u8 cmd, u16 address, u8 *payload, u16 len) {
 		sendEsc(buf, 4);
 		delayWhileRead(5);
 		sendEsc(payload, len);
-		rxSize = getEsc(buf, 200);
+		rxSize = getEsc(buf, sizeof(buf), 200);
 		if (buf[0] != (u8)BlRes::SUCCESS) {
 			send4WayResponse(cmd, address, nullptr, 1, Res4Way::NACK_GENERAL_ERROR);
 			break;
@@ -485,7 +461,7 @@ void process4WayCmd(u8 cmd, u16 address, u8 *payload, u16 len) {
 		buf[0] = (u8)BlCmd::PROG_FLASH;
 		buf[1] = 1;
 		sendEsc(buf, 2);
-		rxSize = getEsc(buf, 100);
+		rxSize = getEsc(buf, sizeof(buf), 100);
 		if (buf[0] == (u8)BlRes::SUCCESS)
 			send4WayResponse(cmd, address);
 		else
@@ -523,14 +499,14 @@ void process4WayCmd(u8 cmd, u16 address, u8 *payload, u16 len) {
 		buf[3] = 0;
 		sendEsc(buf, 4);
 		delayWhileRead(5);
-		getEsc(rx, 200);
+		getEsc(rx, sizeof(rx), 200);
 		if (rx[0] != (u8)BlRes::SUCCESS)
 			ack = (u8)Res4Way::NACK_GENERAL_ERROR;
 
 		buf[0] = (u8)BlCmd::ERASE_FLASH;
 		buf[1] = 0x01;
 		sendEsc(buf, 2);
-		getEsc(rx, 100);
+		getEsc(rx, sizeof(rx), 100);
 		if (rx[0] != (u8)BlRes::SUCCESS)
 			ack = (u8)Res4Way::NACK_GENERAL_ERROR;
 
@@ -545,62 +521,15 @@ void process4WayCmd(u8 cmd, u16 address, u8 *payload, u16 len) {
 
 void process4Way(u8 c) {
 	if (!setup4WayDone) return;
-	static u8 cmd;
-	static u16 address;
-	static u16 len;
-	static u16 crc;
-	static u16 crcIn;
-	static u8 payload[256];
-	static u16 pos;
-	static State4Way state = State4Way::IDLE;
-	switch (state) {
-	case State4Way::IDLE:
-		if (c == '/') {
-			pos = 0;
-			crc = crcUpdateXmodem(0, c);
-			state = State4Way::CMD;
-		}
+	static Parser4Way parser;
+	switch (parser.feed(c)) {
+	case Parser4Way::FRAME:
+		process4WayCmd(parser.cmd, parser.address, parser.payload, parser.len);
 		break;
-	case State4Way::CMD:
-		cmd = c;
-		crc = crcUpdateXmodem(crc, c);
-		state = State4Way::ADDR_HI;
+	case Parser4Way::ERROR_CRC:
+		send4WayResponse(parser.cmd, parser.address, nullptr, 1, Res4Way::NACK_INVALID_CRC);
 		break;
-	case State4Way::ADDR_HI:
-		address = c << 8;
-		crc = crcUpdateXmodem(crc, c);
-		state = State4Way::ADDR_LO;
-		break;
-	case State4Way::ADDR_LO:
-		address |= c;
-		crc = crcUpdateXmodem(crc, c);
-		state = State4Way::LEN;
-		break;
-	case State4Way::LEN:
-		len = c;
-		if (!len) len = 256;
-		crc = crcUpdateXmodem(crc, c);
-		state = State4Way::PAYLOAD;
-		break;
-	case State4Way::PAYLOAD:
-		payload[pos++] = c;
-		crc = crcUpdateXmodem(crc, c);
-		if (pos == len) {
-			state = State4Way::CHECKSUM_HI;
-		}
-		break;
-	case State4Way::CHECKSUM_HI:
-		crcIn = (u16)c << 8;
-		state = State4Way::CHECKSUM_LO;
-		break;
-	case State4Way::CHECKSUM_LO:
-		crcIn |= c;
-		if (crc == crcIn) {
-			process4WayCmd(cmd, address, payload, len);
-		} else {
-			send4WayResponse(cmd, address, nullptr, 1, Res4Way::NACK_INVALID_CRC);
-		}
-		state = State4Way::IDLE;
+	default:
 		break;
 	}
 }
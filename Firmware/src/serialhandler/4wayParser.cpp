@@ -0,0 +1,73 @@
+/**
+ * @file 4wayParser.cpp
+ * @brief Frame parser of the 4way interface (configurator to FC), without any I/O so it builds on the host
+ *
+ * Copyright (c) 2026 Kolibri-FC contributors
+ *
+ * This file is part of Kolibri-FC (https://github.com/bastian2001/Kolibri-FC).
+ *
+ * Kolibri-FC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Kolibri-FC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "4wayParser.h"
+#include "utils/checksum.h"
+
+Parser4Way::Result Parser4Way::feed(u8 c) {
+	switch (state) {
+	case State4Way::IDLE:
+		if (c == '/') {
+			pos = 0;
+			crc = crc16XmodemByte(0, c);
+			state = State4Way::CMD;
+		}
+		break;
+	case State4Way::CMD:
+		cmd = c;
+		crc = crc16XmodemByte(crc, c);
+		state = State4Way::ADDR_HI;
+		break;
+	case State4Way::ADDR_HI:
+		address = c << 8;
+		crc = crc16XmodemByte(crc, c);
+		state = State4Way::ADDR_LO;
+		break;
+	case State4Way::ADDR_LO:
+		address |= c;
+		crc = crc16XmodemByte(crc, c);
+		state = State4Way::LEN;
+		break;
+	case State4Way::LEN:
+		len = c;
+		if (!len) len = 256;
+		crc = crc16XmodemByte(crc, c);
+		state = State4Way::PAYLOAD;
+		break;
+	case State4Way::PAYLOAD:
+		payload[pos++] = c;
+		crc = crc16XmodemByte(crc, c);
+		if (pos == len) {
+			state = State4Way::CHECKSUM_HI;
+		}
+		break;
+	case State4Way::CHECKSUM_HI:
+		crcIn = (u16)c << 8;
+		state = State4Way::CHECKSUM_LO;
+		break;
+	case State4Way::CHECKSUM_LO:
+		crcIn |= c;
+		state = State4Way::IDLE;
+		return crc == crcIn ? FRAME : ERROR_CRC;
+	}
+	return NONE;
+}
@@ -0,0 +1,60 @@
+/**
+ * @file 4wayParser.h
+ * @brief Frame parser of the 4way interface (configurator to FC), without any I/O so it builds on the host
+ *
+ * Copyright (c) 2026 Kolibri-FC contributors
+ *
+ * This file is part of Kolibri-FC (https://github.com/bastian2001/Kolibri-FC).
+ *
+ * Kolibri-FC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Kolibri-FC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include "typedefs.h"
+
+enum class State4Way {
+	IDLE, // waiting for '/'
+	CMD,
+	ADDR_HI,
+	ADDR_LO,
+	LEN,
+	PAYLOAD,
+	CHECKSUM_HI,
+	CHECKSUM_LO
+};
+
+/**
+ * @brief Assembles 4way requests: '/', command, address (big endian), length (0 = 256), payload, CRC16 XMODEM (big endian)
+ */
+class Parser4Way {
+public:
+	enum Result : u8 {
+		NONE, // frame not complete yet
+		FRAME, // complete with a valid CRC
+		ERROR_CRC, // CRC wrong, cmd and address are valid
+	};
+
+	Result feed(u8 c);
+
+	u8 cmd = 0;
+	u16 address = 0;
+	u16 len = 0; // 1-256
+	u8 payload[256];
+
+private:
+	State4Way state = State4Way::IDLE;
+	u16 pos = 0;
+	u16 crc = 0;
+	u16 crcIn = 0;
+};
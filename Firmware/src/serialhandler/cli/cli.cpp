@@ -31,6 +31,7 @@ void initExit();
 void initGet();
 void initGyroCalibration();
 void initHelp();
+void initI2cStats();
 void initMan();
 void initPrint();
 void initReboot();
@@ -50,6 +51,7 @@ void initCli() {
 	initGet();
 	initGyroCalibration();
 	initHelp();
+	initI2cStats();
 	initMan();
 	initPrint();
 	initReboot();
@@ -0,0 +1,51 @@
+/**
+ * @file i2c_stats.cpp
+ * @brief Implementation of the i2c_stats command
+ *
+ * Copyright (c) 2026 Kolibri-FC contributors
+ *
+ * This file is part of Kolibri-FC (https://github.com/bastian2001/Kolibri-FC).
+ *
+ * Kolibri-FC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Kolibri-FC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "global.h"
+
+void initI2cStats() {
+	Command *cmd = new Command("i2c_stats", "Get or reset statistics about the devices on the I2C bus");
+	cmd->addFlagArg("reset", 'r', "Reset the I2C statistics after printing");
+	cmd->setExecuteFunction([](std::map<string, RuntimeArg> &args, Command *cmd) {
+		const auto &resetArg = args["reset"];
+		bool reset = std::get<bool>(resetArg.value);
+		string response = "";
+
+		for (int i = 0; i < i2cDeviceCount(); i++) {
+			char line[192];
+			const I2cDevice &d = *i2cGetDevice(i);
+			const u32 avgLatency = d.transfers ? d.totalLatency / d.transfers : 0;
+			snprintf(line, 192, CLI_COLOR_CYAN "%-6s" CLI_COLOR_MAGENTA " (0x%02X)" CLI_COLOR_WHITE ":" CLI_COLOR_BLUE " %8u transfers, latency avg %4uus max %5uus" CLI_COLOR_WHITE "," CLI_COLOR_RED " NACK %u, bus error %u, timeout %u, expired %u, queue full %u\n" CLI_COLOR_WHITE, d.name, d.addr, d.transfers, avgLatency, d.maxLatency, d.nacks, d.busErrors, d.timeouts, d.expired, d.queueFull);
+			response += line;
+		}
+		response += "Bus recoveries: " + std::to_string(i2cBusRecoveries) + '\n';
+
+		if (reset) {
+			i2cResetStats();
+			response += CLI_COLOR_GREEN "\nI2C statistics reset" CLI_COLOR_WHITE;
+		}
+
+		cmd->print(response.c_str());
+		return false;
+	});
+	Command::cliCommands.push_back(cmd);
+}
@@ -33,10 +33,10 @@ void initSerialStats() {
 		f32 timeSinceReset = f32(KoliSerial::sinceReset) / 1000.f;
 		response = "Statistics since the last reset (" + std::to_string((u32)timeSinceReset) + "ms ago)\n";
 		for (int i = 0; i < SERIAL_COUNT; i++) {
-			char line[128];
+			char line[192];
 			if (!serials[i]) continue;
 			KoliSerial &s = *serials[i];
-			snprintf(line, 128, CLI_COLOR_CYAN "Serial %d" CLI_COLOR_MAGENTA " (%s)" CLI_COLOR_WHITE ":" CLI_COLOR_BLUE "     TX: %7d bytes (%.2fKB/s)" CLI_COLOR_WHITE "," CLI_COLOR_BLUE "     RX: %7d bytes (%.2fKB/s)" CLI_COLOR_WHITE ",     " CLI_COLOR_YELLOW, i, KoliSerial::SERIAL_TYPE_NAMES[(u8)s.serialType], s.totalTx, s.totalTx / timeSinceReset, s.totalRx, s.totalRx / timeSinceReset);
+			snprintf(line, 192, CLI_COLOR_CYAN "Serial %d" CLI_COLOR_MAGENTA " (%s)" CLI_COLOR_WHITE ":" CLI_COLOR_BLUE "     TX: %7d bytes (%.2fKB/s, %s)" CLI_COLOR_WHITE "," CLI_COLOR_BLUE "     RX: %7d bytes (%.2fKB/s, %s)" CLI_COLOR_WHITE ", " "%s%5u overruns" CLI_COLOR_WHITE ",     " CLI_COLOR_YELLOW, i, KoliSerial::SERIAL_TYPE_NAMES[(u8)s.serialType], s.totalTx, s.totalTx / timeSinceReset, s.txUsesDma() ? "DMA" : "CPU", s.totalRx, s.totalRx / timeSinceReset, s.rxUsesDma() ? "DMA" : "CPU", s.rxOverruns() ? CLI_COLOR_RED : CLI_COLOR_GREEN, s.rxOverruns());
 			response += line;
 			bool firstFunction = true;
 			for (int j = 0; j < SERIAL_FUNCTION_COUNT; j++) {
@@ -59,6 +59,7 @@ void initSerialStats() {
 					s->totalRx = 0;
 					s->totalTx = 0;
 				}
+				s->resetRxOverruns();
 			}
 			KoliSerial::sinceReset = 0;
 			response += CLI_COLOR_GREEN "\nSerial statistics reset" CLI_COLOR_WHITE;
@@ -0,0 +1,225 @@
+/**
+ * @file crsf.cpp
+ * @brief CRSF frame parser, RC channel unpacking and MSP over CRSF reassembly, without any I/O so it builds on the host
+ *
+ * Copyright (c) 2026 Kolibri-FC contributors
+ *
+ * This file is part of Kolibri-FC (https://github.com/bastian2001/Kolibri-FC).
+ *
+ * Kolibri-FC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Kolibri-FC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "crsf.h"
+#include "utils/checksum.h"
+#include <string.h>
+
+CrsfParser::Result CrsfParser::parseChar(u8 c) {
+	switch (state) {
+	case CRSF_STATE_SYNC:
+		if (c == CRSF_SYNC_BYTE) {
+			crc = 0;
+			index = 0;
+			state = CRSF_STATE_LEN;
+		}
+		break;
+	case CRSF_STATE_LEN:
+		msgLen = c;
+		state = CRSF_STATE_TYPE;
+		break;
+	case CRSF_STATE_TYPE:
+		type = c;
+		crc = crc8D5Byte(crc, c);
+		if (c >= 0x28) {
+			len = msgLen - 4;
+			state = CRSF_STATE_EXT_DEST;
+			isExtended = true;
+		} else {
+			len = msgLen - 2;
+			isExtended = false;
+			state = len ? CRSF_STATE_PAYLOAD : CRSF_STATE_CRC;
+		}
+		if (len > CRSF_MAX_PAYLOAD) {
+			// also catches lengths below the header size, they wrap around
+			state = CRSF_STATE_SYNC;
+			return ERROR_LENGTH;
+		}
+		break;
+	case CRSF_STATE_EXT_DEST:
+		extDest = c;
+		crc = crc8D5Byte(crc, c);
+		state = CRSF_STATE_EXT_SRC;
+		break;
+	case CRSF_STATE_EXT_SRC:
+		extSrc = c;
+		crc = crc8D5Byte(crc, c);
+		state = len ? CRSF_STATE_PAYLOAD : CRSF_STATE_CRC;
+		break;
+	case CRSF_STATE_PAYLOAD:
+		payload[index++] = c;
+		crc = crc8D5Byte(crc, c);
+		if (index >= len)
+			state = CRSF_STATE_CRC;
+		break;
+	case CRSF_STATE_CRC:
+		crc = crc8D5Byte(crc, c);
+		state = CRSF_STATE_SYNC;
+		return crc ? ERROR_CRC : FRAME;
+	default:
+		state = CRSF_STATE_SYNC;
+		break;
+	}
+	return NONE;
+}
+
+// frames may carry fewer bytes than the struct, the missing channels read as 0
+template <typename T>
+static void unpackChannels(const u8 *src, u8 len, u32 out[16]) {
+	T chs = {};
+	memcpy(&chs, src, len < sizeof(T) ? len : sizeof(T));
+	out[0] = chs.ch0;
+	out[1] = chs.ch1;
+	out[2] = chs.ch2;
+	out[3] = chs.ch3;
+	out[4] = chs.ch4;
+	out[5] = chs.ch5;
+	out[6] = chs.ch6;
+	out[7] = chs.ch7;
+	out[8] = chs.ch8;
+	out[9] = chs.ch9;
+	out[10] = chs.ch10;
+	out[11] = chs.ch11;
+	out[12] = chs.ch12;
+	out[13] = chs.ch13;
+	out[14] = chs.ch14;
+	out[15] = chs.ch15;
+}
+
+bool crsfUnpackSubsetChannels(const u8 *payload, u8 len, u32 raw[16], u8 *firstChannel, u8 *channelCount) {
+	if (len < 2) return false;
+	const u8 cfg = payload[0];
+	const u8 first = cfg & 0x1F;
+	const u8 res = (cfg >> 5) & 0x03;
+	const u8 chanSizeBytes = len - 1;
+	const u8 count = chanSizeBytes * 8 / (res + 10);
+	if (!count || first + count > 16) return false;
+
+	u32 unpacked[16];
+	switch (res) {
+	case 0b00:
+		unpackChannels<crsf_channels_10>(&payload[1], chanSizeBytes, unpacked);
+		break;
+	case 0b01:
+		unpackChannels<crsf_channels_11>(&payload[1], chanSizeBytes, unpacked);
+		break;
+	case 0b10:
+		unpackChannels<crsf_channels_12>(&payload[1], chanSizeBytes, unpacked);
+		break;
+	default:
+		unpackChannels<crsf_channels_13>(&payload[1], chanSizeBytes, unpacked);
+		break;
+	}
+	for (u8 i = 0; i < count; i++)
+		raw[first + i] = unpacked[i];
+	*firstChannel = first;
+	*channelCount = count;
+	return true;
+}
+
+void CrsfMspRx::reset() {
+	pos = 0;
+	recording = false;
+	payloadLen = 0;
+	version = MspVersion::V2_OVER_CRSF;
+	srcAddr = 0;
+	cmd = 0;
+	seq = 0;
+}
+
+CrsfMspRx::Result CrsfMspRx::feed(const u8 *frame, u8 len, u8 src) {
+	if (!len) return fail(); // need at least the status byte
+	const u8 *const mspData = frame + 1;
+	const u8 status = *frame;
+	const u8 isError = (status >> 7);
+	const bool isNewFrame = (status >> 4) & 0b1;
+	const u8 sequenceNo = status & 0xF;
+	u8 readPos = 0; // read position for MSP payload
+
+	const u8 expectedSequence = (seq + 1) & 0xF;
+	const bool sequenceError = sequenceNo != expectedSequence;
+
+	if (isError || (!isNewFrame && sequenceError)) return fail();
+
+	if (isNewFrame) {
+		reset(); // if a new frame comes in before the previous one is complete we need to reset the rxPos
+
+		// set MSP version
+		const u8 headerVersion = (status >> 5) & 0b11; // 1 = V1 or V1_JUMBO, 2 = V2
+		switch (headerVersion) {
+		case 1:
+			if (len >= 2 && mspData[0] == 0xFF)
+				version = MspVersion::V1_JUMBO_OVER_CRSF;
+			else
+				version = MspVersion::V1_OVER_CRSF;
+			break;
+		case 2:
+			version = MspVersion::V2_OVER_CRSF;
+			break;
+		default:
+			return fail(); // unsupported MSP version
+		}
+
+		// save return address for once packet is complete
+		srcAddr = src;
+
+		// calculate frame length
+		switch (version) {
+		case MspVersion::V1_OVER_CRSF:
+			if (len < 3) return fail(); // need at least status byte, payload len and function
+			readPos = 2;
+			payloadLen = mspData[0];
+			cmd = mspData[1];
+			break;
+		case MspVersion::V1_JUMBO_OVER_CRSF:
+			if (len < 5) return fail(); // 1+2 payload length, 1 command
+			readPos = 4;
+			cmd = mspData[1];
+			payloadLen = mspData[2] | (mspData[3] << 8);
+			if (payloadLen > CRSF_MSP_MAX_PAYLOAD) return fail();
+			break;
+		default:
+			if (len < 6) return fail(); // 1 flags, 2 payload length, 2 command
+			readPos = 5;
+			flag = mspData[0];
+			cmd = mspData[1] | (mspData[2] << 8);
+			payloadLen = mspData[3] | (mspData[4] << 8);
+			if (payloadLen > CRSF_MSP_MAX_PAYLOAD) return fail();
+			break;
+		}
+		recording = true;
+	}
+	if (!recording) return fail(); // continuation without a start, probably packet loss
+	seq = sequenceNo; // save the sequence number for next frame
+
+	i16 thisMspPayloadLen = len - 1 - readPos; // how much MSP payload is in this CRSF frame = total payload size minus status, then deduct start of MSP payload (readPos)
+	if (thisMspPayloadLen < 0) return fail();
+
+	i16 mspNeedsPayloadBytes = payloadLen - pos; // how many bytes we still need to read for the MSP payload
+	i16 readFromThisPacket = thisMspPayloadLen < mspNeedsPayloadBytes ? thisMspPayloadLen : mspNeedsPayloadBytes; // how much MSP payload we can read from this packet
+	if (readFromThisPacket < 0) return fail();
+
+	memcpy(payload + pos, &mspData[readPos], readFromThisPacket);
+	pos += readFromThisPacket; // update the position in the MSP payload
+
+	return pos >= payloadLen ? COMPLETE : NONE;
+}
@@ -0,0 +1,194 @@
+/**
+ * @file crsf.h
+ * @brief CRSF frame parser, RC channel unpacking and MSP over CRSF reassembly, without any I/O so it builds on the host
+ *
+ * Copyright (c) 2026 Kolibri-FC contributors
+ *
+ * This file is part of Kolibri-FC (https://github.com/bastian2001/Kolibri-FC).
+ *
+ * Kolibri-FC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Kolibri-FC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include "mspRegistry.h"
+
+// protocol wiki of CRSF, made by ExpressLRS
+// https://github.com/crsf-wg/crsf/wiki
+
+#define CRSF_SYNC_BYTE 0xC8
+#define CRSF_MAX_PAYLOAD 60 // without ext src/dest
+#define CRSF_MSP_MAX_PAYLOAD 512 // MSP requests reassembled from MSP_REQ/MSP_WRITE frames
+
+struct __attribute__((packed)) crsf_channels_10 {
+	unsigned ch0 : 10;
+	unsigned ch1 : 10;
+	unsigned ch2 : 10;
+	unsigned ch3 : 10;
+	unsigned ch4 : 10;
+	unsigned ch5 : 10;
+	unsigned ch6 : 10;
+	unsigned ch7 : 10;
+	unsigned ch8 : 10;
+	unsigned ch9 : 10;
+	unsigned ch10 : 10;
+	unsigned ch11 : 10;
+	unsigned ch12 : 10;
+	unsigned ch13 : 10;
+	unsigned ch14 : 10;
+	unsigned ch15 : 10;
+};
+
+struct __attribute__((packed)) crsf_channels_11 {
+	unsigned ch0 : 11;
+	unsigned ch1 : 11;
+	unsigned ch2 : 11;
+	unsigned ch3 : 11;
+	unsigned ch4 : 11;
+	unsigned ch5 : 11;
+	unsigned ch6 : 11;
+	unsigned ch7 : 11;
+	unsigned ch8 : 11;
+	unsigned ch9 : 11;
+	unsigned ch10 : 11;
+	unsigned ch11 : 11;
+	unsigned ch12 : 11;
+	unsigned ch13 : 11;
+	unsigned ch14 : 11;
+	unsigned ch15 : 11;
+};
+
+struct __attribute__((packed)) crsf_channels_12 {
+	unsigned ch0 : 12;
+	unsigned ch1 : 12;
+	unsigned ch2 : 12;
+	unsigned ch3 : 12;
+	unsigned ch4 : 12;
+	unsigned ch5 : 12;
+	unsigned ch6 : 12;
+	unsigned ch7 : 12;
+	unsigned ch8 : 12;
+	unsigned ch9 : 12;
+	unsigned ch10 : 12;
+	unsigned ch11 : 12;
+	unsigned ch12 : 12;
+	unsigned ch13 : 12;
+	unsigned ch14 : 12;
+	unsigned ch15 : 12;
+};
+
+struct __attribute__((packed)) crsf_channels_13 {
+	unsigned ch0 : 13;
+	unsigned ch1 : 13;
+	unsigned ch2 : 13;
+	unsigned ch3 : 13;
+	unsigned ch4 : 13;
+	unsigned ch5 : 13;
+	unsigned ch6 : 13;
+	unsigned ch7 : 13;
+	unsigned ch8 : 13;
+	unsigned ch9 : 13;
+	unsigned ch10 : 13;
+	unsigned ch11 : 13;
+	unsigned ch12 : 13;
+	unsigned ch13 : 13;
+	unsigned ch14 : 13;
+	unsigned ch15 : 13;
+};
+
+/**
+ * @brief Assembles CRSF frames from single bytes
+ *
+ * @details Checks length and CRC only, the content is up to ExpressLRS. The fields are valid after parseChar() returned FRAME, until the next byte.
+ */
+class CrsfParser {
+public:
+	enum Result : u8 {
+		NONE, // frame not complete yet
+		FRAME, // complete with a valid CRC
+		ERROR_CRC,
+		ERROR_LENGTH, // payload longer than CRSF_MAX_PAYLOAD
+	};
+
+	Result parseChar(u8 c);
+
+	u8 type = 0;
+	u8 extDest = 0;
+	u8 extSrc = 0;
+	u8 len = 0; // payload length, without ext src/dest
+	bool isExtended = false;
+	u8 payload[CRSF_MAX_PAYLOAD]; // only actual payload, not ext src/dest
+
+private:
+	enum {
+		CRSF_STATE_SYNC,
+		CRSF_STATE_LEN,
+		CRSF_STATE_TYPE,
+		CRSF_STATE_EXT_DEST,
+		CRSF_STATE_EXT_SRC,
+		CRSF_STATE_PAYLOAD,
+		CRSF_STATE_CRC
+	};
+	u8 state = CRSF_STATE_SYNC;
+	u8 index = 0;
+	u8 msgLen = 0;
+	u32 crc = 0;
+};
+
+/**
+ * @brief Unpacks a SUBSET_RC_CHANNELS_PACKED payload
+ *
+ * @param payload config byte, then the packed channels
+ * @param len payload length
+ * @param raw raw values are written to raw[*firstChannel] ... raw[*firstChannel + *channelCount - 1], the rest is untouched
+ * @return false if the frame has no channels or more than fit into 16
+ */
+bool crsfUnpackSubsetChannels(const u8 *payload, u8 len, u32 raw[16], u8 *firstChannel, u8 *channelCount);
+
+/**
+ * @brief Collects MSP requests that are split over several MSP_REQ/MSP_WRITE frames
+ *
+ * @details The first byte of each frame is the status: bit 7 error, bit 5-6 MSP version, bit 4 start of a new request, bits 0-3 sequence number. The first frame of a request contains the MSP header (without $, direction and checksum), the rest is payload.
+ */
+class CrsfMspRx {
+public:
+	enum Result : u8 {
+		NONE, // waiting for more frames
+		COMPLETE, // request complete, see the public fields, call reset() when done with it
+		ERROR, // frame lost or invalid, the request was dropped
+	};
+
+	/**
+	 * @param frame payload of the CRSF frame, starting with the status byte
+	 * @param len length of it, at least 1
+	 * @param srcAddr ext src of the frame, the response goes there
+	 */
+	Result feed(const u8 *frame, u8 len, u8 srcAddr);
+	void reset();
+
+	u8 payload[CRSF_MSP_MAX_PAYLOAD] = {};
+	u16 payloadLen = 0;
+	u16 cmd = 0;
+	u8 flag = 0;
+	u8 srcAddr = 0;
+	MspVersion version = MspVersion::V2_OVER_CRSF;
+
+private:
+	Result fail() {
+		reset();
+		return ERROR;
+	}
+	u8 seq = 0;
+	u16 pos = 0;
+	bool recording = false;
+};
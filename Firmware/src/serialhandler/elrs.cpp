@@ -23,82 +23,6 @@
 #include "global.h"
 #include "hardware/interp.h"
 
-struct __attribute__((packed)) crsf_channels_10 {
-	unsigned ch0 : 10;
-	unsigned ch1 : 10;
-	unsigned ch2 : 10;
-	unsigned ch3 : 10;
-	unsigned ch4 : 10;
-	unsigned ch5 : 10;
-	unsigned ch6 : 10;
-	unsigned ch7 : 10;
-	unsigned ch8 : 10;
-	unsigned ch9 : 10;
-	unsigned ch10 : 10;
-	unsigned ch11 : 10;
-	unsigned ch12 : 10;
-	unsigned ch13 : 10;
-	unsigned ch14 : 10;
-	unsigned ch15 : 10;
-};
-
-struct __attribute__((packed)) crsf_channels_11 {
-	unsigned ch0 : 11;
-	unsigned ch1 : 11;
-	unsigned ch2 : 11;
-	unsigned ch3 : 11;
-	unsigned ch4 : 11;
-	unsigned ch5 : 11;
-	unsigned ch6 : 11;
-	unsigned ch7 : 11;
-	unsigned ch8 : 11;
-	unsigned ch9 : 11;
-	unsigned ch10 : 11;
-	unsigned ch11 : 11;
-	unsigned ch12 : 11;
-	unsigned ch13 : 11;
-	unsigned ch14 : 11;
-	unsigned ch15 : 11;
-};
-
-struct __attribute__((packed)) crsf_channels_12 {
-	unsigned ch0 : 12;
-	unsigned ch1 : 12;
-	unsigned ch2 : 12;
-	unsigned ch3 : 12;
-	unsigned ch4 : 12;
-	unsigned ch5 : 12;
-	unsigned ch6 : 12;
-	unsigned ch7 : 12;
-	unsigned ch8 : 12;
-	unsigned ch9 : 12;
-	unsigned ch10 : 12;
-	unsigned ch11 : 12;
-	unsigned ch12 : 12;
-	unsigned ch13 : 12;
-	unsigned ch14 : 12;
-	unsigned ch15 : 12;
-};
-
-struct __attribute__((packed)) crsf_channels_13 {
-	unsigned ch0 : 13;
-	unsigned ch1 : 13;
-	unsigned ch2 : 13;
-	unsigned ch3 : 13;
-	unsigned ch4 : 13;
-	unsigned ch5 : 13;
-	unsigned ch6 : 13;
-	unsigned ch7 : 13;
-	unsigned ch8 : 13;
-	unsigned ch9 : 13;
-	unsigned ch10 : 13;
-	unsigned ch11 : 13;
-	unsigned ch12 : 13;
-	unsigned ch13 : 13;
-	unsigned ch14 : 13;
-	unsigned ch15 : 13;
-};
-
 #define ELRS_BUFFER_SIZE 600
 
 #define ELRS_RAISE_ERROR(code)     \
@@ -265,30 +189,30 @@ void ExpressLRS::processMessage() {
 	sinceLastMessage = 0;
 	packetRateCounter++;
 
-	if (inMsgIsExtended && (inExtDest != ADDRESS_FLIGHT_CONTROLLER && inExtDest != ADDRESS_CRSF_BROADCAST)) return;
+	if (in.isExtended && (in.extDest != ADDRESS_FLIGHT_CONTROLLER && in.extDest != ADDRESS_CRSF_BROADCAST)) return;
 
-	if (inMsgIsExtended && !armed && subscribeCount && subscribeSerial != nullptr) {
+	if (in.isExtended && !armed && subscribeCount && subscribeSerial != nullptr) {
 		for (int i = 0; i < subscribeCount; i++) {
-			if (subscribeList[i] == inType) {
+			if (subscribeList[i] == in.type) {
 				char buf[62];
-				buf[0] = inExtSrc;
-				buf[1] = inType;
-				memcpy(&buf[2], inPayload, inActualLen);
+				buf[0] = in.extSrc;
+				buf[1] = in.type;
+				memcpy(&buf[2], in.payload, in.len);
 				MspMsgSetup s = {
 					.serial = *subscribeSerial,
 					.fn = MspFn::CRSF_GOT_MESSAGE,
 					.type = MspMsgType::REQUEST,
 					.version = subscribeMspVersion,
 				};
-				sendMsp(s, buf, inActualLen + 2);
+				sendMsp(s, buf, in.len + 2);
 				break;
 			}
 		}
 	}
 
-	switch (inType) {
+	switch (in.type) {
 	case FRAMETYPE_RC_CHANNELS_PACKED: {
-		if (inActualLen != 22) // 16 channels * 11 bits
+		if (in.len != 22) // 16 channels * 11 bits
 		{
 			lastError = ERROR_INVALID_LENGTH;
 			errorFlag = true;
@@ -297,7 +221,7 @@ void ExpressLRS::processMessage() {
 			tasks[TASK_ELRS].lastError = ERROR_INVALID_LENGTH;
 			break;
 		}
-		crsf_channels_11 *chs = (crsf_channels_11 *)(inPayload);
+		crsf_channels_11 *chs = (crsf_channels_11 *)(in.payload);
 		i32 pChannels[16] = {(i32)chs->ch0, (i32)chs->ch1, (i32)chs->ch2, (i32)chs->ch3, (i32)chs->ch4, (i32)chs->ch5, (i32)chs->ch6, (i32)chs->ch7, (i32)chs->ch8, (i32)chs->ch9, (i32)chs->ch10, (i32)chs->ch11, (i32)chs->ch12, (i32)chs->ch13, (i32)chs->ch14, (i32)chs->ch15};
 		// map pChannels to 989-2012 (?)
 		for (u8 i = 0; i < 16; i++) {
@@ -328,117 +252,18 @@ void ExpressLRS::processMessage() {
 		rcMsgCount++;
 	} break;
 	case FRAMETYPE_SUBSET_RC_CHANNELS_PACKED: {
-		u8 cfg = *inPayload;
-		u8 firstChannel = cfg & 0x1F;
-		u8 res = (cfg >> 5) & 0x03;
-		u8 chanSizeBytes = inActualLen - 1;
-		u8 channelCount = chanSizeBytes * 8 / (res + 10);
-		if (firstChannel + channelCount > 16) {
+		u32 raw[16];
+		u8 firstChannel, channelCount;
+		if (!crsfUnpackSubsetChannels(in.payload, in.len, raw, &firstChannel, &channelCount)) {
 			ELRS_RAISE_ERROR(ERROR_INVALID_LENGTH);
 			break;
 		}
-		u32 pChannels[16] = {};
-		switch (res) {
-		case 0b00: {
-			// 10 bits
-			crsf_channels_10 chs;
-			memcpy(&chs, &inPayload[1], chanSizeBytes);
-			pChannels[0] = chs.ch0;
-			pChannels[1] = chs.ch1;
-			pChannels[2] = chs.ch2;
-			pChannels[3] = chs.ch3;
-			pChannels[4] = chs.ch4;
-			pChannels[5] = chs.ch5;
-			pChannels[6] = chs.ch6;
-			pChannels[7] = chs.ch7;
-			pChannels[8] = chs.ch8;
-			pChannels[9] = chs.ch9;
-			pChannels[10] = chs.ch10;
-			pChannels[11] = chs.ch11;
-			pChannels[12] = chs.ch12;
-			pChannels[13] = chs.ch13;
-			pChannels[14] = chs.ch14;
-			pChannels[15] = chs.ch15;
-		} break;
-		case 0b01: {
-			// 11 bits
-			crsf_channels_11 chs;
-			memcpy(&chs, &inPayload[1], chanSizeBytes);
-			pChannels[0] = chs.ch0;
-			pChannels[1] = chs.ch1;
-			pChannels[2] = chs.ch2;
-			pChannels[3] = chs.ch3;
-			pChannels[4] = chs.ch4;
-			pChannels[5] = chs.ch5;
-			pChannels[6] = chs.ch6;
-			pChannels[7] = chs.ch7;
-			pChannels[8] = chs.ch8;
-			pChannels[9] = chs.ch9;
-			pChannels[10] = chs.ch10;
-			pChannels[11] = chs.ch11;
-			pChannels[12] = chs.ch12;
-			pChannels[13] = chs.ch13;
-			pChannels[14] = chs.ch14;
-			pChannels[15] = chs.ch15;
-		} break;
-		case 0b10: {
-			// 12 bits
-			crsf_channels_12 chs;
-			memcpy(&chs, &inPayload[1], chanSizeBytes);
-			pChannels[0] = chs.ch0;
-			pChannels[1] = chs.ch1;
-			pChannels[2] = chs.ch2;
-			pChannels[3] = chs.ch3;
-			pChannels[4] = chs.ch4;
-			pChannels[5] = chs.ch5;
-			pChannels[6] = chs.ch6;
-			pChannels[7] = chs.ch7;
-			pChannels[8] = chs.ch8;
-			pChannels[9] = chs.ch9;
-			pChannels[10] = chs.ch10;
-			pChannels[11] = chs.ch11;
-			pChannels[12] = chs.ch12;
-			pChannels[13] = chs.ch13;
-			pChannels[14] = chs.ch14;
-			pChannels[15] = chs.ch15;
-		} break;
-		case 0b11: {
-			// 13 bits
-			crsf_channels_13 chs;
-			memcpy(&chs, &inPayload[1], chanSizeBytes);
-			pChannels[0] = chs.ch0;
-			pChannels[1] = chs.ch1;
-			pChannels[2] = chs.ch2;
-			pChannels[3] = chs.ch3;
-			pChannels[4] = chs.ch4;
-			pChannels[5] = chs.ch5;
-			pChannels[6] = chs.ch6;
-			pChannels[7] = chs.ch7;
-			pChannels[8] = chs.ch8;
-			pChannels[9] = chs.ch9;
-			pChannels[10] = chs.ch10;
-			pChannels[11] = chs.ch11;
-			pChannels[12] = chs.ch12;
-			pChannels[13] = chs.ch13;
-			pChannels[14] = chs.ch14;
-			pChannels[15] = chs.ch15;
-		} break;
-		default:
-			return;
-		}
-		// shift pChannels by firstChannel
-		for (u32 i = channelCount - 1; i; i--) {
-			pChannels[i + firstChannel] = pChannels[i];
-		}
-		for (u32 i = 0; i < firstChannel; i++) {
-			pChannels[i] = this->channels[i];
-		}
-		for (u32 i = firstChannel + channelCount; i < 16; i++) {
-			pChannels[i] = this->channels[i];
-		}
+		// channels outside the subset keep their (already mapped) values
+		u32 pChannels[16];
+		memcpy(pChannels, this->channels, sizeof(pChannels));
 		// map pChannels to 988-2012 (?)
-		for (u8 i = 0; i < 16; i++) {
-			pChannels[i] = 1500 + (1023 * ((i32)pChannels[i] - 992) / 1636);
+		for (u8 i = firstChannel; i < firstChannel + channelCount; i++) {
+			pChannels[i] = 1500 + (1023 * ((i32)raw[i] - 992) / 1636);
 			pChannels[i] = constrain(pChannels[i], 988, 2012);
 		}
 
@@ -463,26 +288,27 @@ void ExpressLRS::processMessage() {
 		rcMsgCount++;
 	} break;
 	case FRAMETYPE_LINK_STATISTICS: {
-		if (inActualLen != 10) {
+		if (in.len != 10) {
 			ELRS_RAISE_ERROR(ERROR_INVALID_LENGTH);
 			break;
 		}
-		uplinkRssi[0] = -inPayload[0];
-		uplinkRssi[1] = -inPayload[1];
-		uplinkLinkQuality = inPayload[2];
-		uplinkSNR = inPayload[3];
-		antennaSelection = inPayload[4];
-		packetRateIdx = inPayload[5];
+		uplinkRssi[0] = -in.payload[0];
+		uplinkRssi[1] = -in.payload[1];
+		uplinkLinkQuality = in.payload[2];
+		uplinkSNR = in.payload[3];
+		antennaSelection = in.payload[4];
+		packetRateIdx = in.payload[5];
 		if (packetRateIdx < 20)
 			targetPacketRate = packetRates900[packetRateIdx];
 		else if (packetRateIdx < 40)
 			targetPacketRate = packetRates2400[packetRateIdx - 20];
 		else if (packetRateIdx < 120 && packetRateIdx >= 100)
 			targetPacketRate = packetRatesX[packetRateIdx - 100];
-		txPower = powerStates[inPayload[6]];
-		downlinkRssi = -inPayload[7];
-		downlinkLinkQuality = inPayload[8];
-		downlinkSNR = inPayload[9];
+		if (in.payload[6] < sizeof(powerStates) / sizeof(powerStates[0]))
+			txPower = powerStates[in.payload[6]];
+		downlinkRssi = -in.payload[7];
+		downlinkLinkQuality = in.payload[8];
+		downlinkSNR = in.payload[9];
 		newLinkStatsFlag = 0xFFFFFFFF;
 	} break;
 	case FRAMETYPE_DEVICE_PING: {
@@ -500,24 +326,24 @@ void ExpressLRS::processMessage() {
 		buf[pos++] = FIRMWARE_VERSION_PATCH;
 		buf[pos++] = 0; // config parameter count
 		buf[pos++] = 0; // parameter protocol version (0)
-		this->sendExtPacket(FRAMETYPE_DEVICE_INFO, inExtSrc, ADDRESS_FLIGHT_CONTROLLER, buf, pos);
+		this->sendExtPacket(FRAMETYPE_DEVICE_INFO, in.extSrc, ADDRESS_FLIGHT_CONTROLLER, buf, pos);
 	} break;
 	case FRAMETYPE_DEVICE_INFO: {
 		CrsfDevice thisDevice;
-		u32 len = strlen((char *)inPayload);
+		u32 len = strlen((char *)in.payload);
 		if (len > 31) break;
-		memcpy(thisDevice.name, inPayload, len + 1);
+		memcpy(thisDevice.name, in.payload, len + 1);
 		thisDevice.name[32] = 0;
 		int index = len + 1;
-		memcpy(&thisDevice.serialNo, &inPayload[index], 4);
+		memcpy(&thisDevice.serialNo, &in.payload[index], 4);
 		index += 4;
-		memcpy(&thisDevice.hardwareId, &inPayload[index], 4);
+		memcpy(&thisDevice.hardwareId, &in.payload[index], 4);
 		index += 4;
-		memcpy(&thisDevice.firmwareId, &inPayload[index], 4);
+		memcpy(&thisDevice.firmwareId, &in.payload[index], 4);
 		index += 4;
-		thisDevice.paramCount = inPayload[index++];
-		thisDevice.paramVersion = inPayload[index++];
-		thisDevice.address = inExtSrc;
+		thisDevice.paramCount = in.payload[index++];
+		thisDevice.paramVersion = in.payload[index++];
+		thisDevice.address = in.extSrc;
 		for (auto it = deviceList.begin(); it != deviceList.end(); it++) {
 			if (it->address == thisDevice.address) {
 				// remove device if it already exists
@@ -545,65 +371,19 @@ void ExpressLRS::processMessage() {
 }
 
 bool ExpressLRS::parseChar(u8 c) {
-	switch (inMsgState) {
-	case CRSF_STATE_SYNC:
-		if (c == CRSF_SYNC_BYTE) {
-			inCrc = 0;
-			inPayloadIndex = 0;
-			inMsgState = CRSF_STATE_LEN;
-		}
-		break;
-	case CRSF_STATE_LEN:
-		inMsgLen = c;
-		inMsgState = CRSF_STATE_TYPE;
-		break;
-	case CRSF_STATE_TYPE:
-		inType = c;
-		CRC_LUT_D5_APPLY(inCrc, c);
-		if (c >= 0x28) {
-			inActualLen = inMsgLen - 4;
-			inMsgState = CRSF_STATE_EXT_DEST;
-			inMsgIsExtended = true;
-		} else {
-			inActualLen = inMsgLen - 2;
-			inMsgIsExtended = false;
-			inMsgState = inActualLen ? CRSF_STATE_PAYLOAD : CRSF_STATE_CRC;
-		}
-		if (inActualLen > 60) {
-			ELRS_RAISE_ERROR(ERROR_INVALID_PKT_LEN);
-			inMsgState = CRSF_STATE_SYNC;
-		}
-		break;
-	case CRSF_STATE_EXT_DEST:
-		inExtDest = c;
-		CRC_LUT_D5_APPLY(inCrc, c);
-		inMsgState = CRSF_STATE_EXT_SRC;
-		break;
-	case CRSF_STATE_EXT_SRC:
-		inExtSrc = c;
-		CRC_LUT_D5_APPLY(inCrc, c);
-		inMsgState = inActualLen ? CRSF_STATE_PAYLOAD : CRSF_STATE_CRC;
-		break;
-	case CRSF_STATE_PAYLOAD:
-		inPayload[inPayloadIndex++] = c;
-		CRC_LUT_D5_APPLY(inCrc, c);
-		if (inPayloadIndex >= inActualLen)
-			inMsgState = CRSF_STATE_CRC;
+	switch (in.parseChar(c)) {
+	case CrsfParser::FRAME:
+		TASK_START(TASK_ELRS_MSG);
+		processMessage();
+		TASK_END(TASK_ELRS_MSG);
+		return true;
+	case CrsfParser::ERROR_CRC:
+		ELRS_RAISE_ERROR(ERROR_CRC);
 		break;
-	case CRSF_STATE_CRC:
-		CRC_LUT_D5_APPLY(inCrc, c);
-		inMsgState = CRSF_STATE_SYNC;
-		if (!inCrc) {
-			TASK_START(TASK_ELRS_MSG);
-			processMessage();
-			TASK_END(TASK_ELRS_MSG);
-			return true;
-		} else {
-			ELRS_RAISE_ERROR(ERROR_CRC);
-		}
+	case CrsfParser::ERROR_LENGTH:
+		ELRS_RAISE_ERROR(ERROR_INVALID_PKT_LEN);
 		break;
 	default:
-		inMsgState = CRSF_STATE_SYNC;
 		break;
 	}
 	return false;
@@ -635,11 +415,7 @@ void ExpressLRS::sendPacket(u8 cmd, const char *payload, u8 payloadLen) {
 	u8 packet[64] = {CRSF_SYNC_BYTE, (u8)(payloadLen + 2), cmd};
 	if (payloadLen)
 		memcpy(&packet[3], payload, payloadLen);
-	u32 crc = 0;
-	for (int i = 2; i < 3 + payloadLen; i++) {
-		CRC_LUT_D5_APPLY(crc, packet[i]);
-	}
-	packet[3 + payloadLen] = crc;
+	packet[3 + payloadLen] = crc8D5(&packet[2], 1 + payloadLen);
 	serial->write(packet, 4 + payloadLen);
 }
 
@@ -648,11 +424,7 @@ void ExpressLRS::sendExtPacket(u8 cmd, u8 destAddr, u8 srcAddr, const char *extP
 	u8 packet[64] = {CRSF_SYNC_BYTE, (u8)(extPayloadLen + 4), cmd, destAddr, srcAddr};
 	if (extPayloadLen)
 		memcpy(&packet[5], extPayload, extPayloadLen);
-	u32 crc = 0;
-	for (int i = 2; i < 5 + extPayloadLen; i++) {
-		CRC_LUT_D5_APPLY(crc, packet[i]);
-	}
-	packet[5 + extPayloadLen] = crc;
+	packet[5 + extPayloadLen] = crc8D5(&packet[2], 3 + extPayloadLen);
 	serial->write(packet, 6 + extPayloadLen);
 }
 
@@ -673,7 +445,7 @@ void ExpressLRS::sendMspMsg(MspMsgType type, u8 mspVersion, const char *payload,
 
 		this->mspTelemSeq++;
 		this->mspTelemSeq &= 0xF;
-		u8 packet[60] = {this->mspExtSrcAddr, ADDRESS_FLIGHT_CONTROLLER, stat};
+		u8 packet[60] = {mspRx.srcAddr, ADDRESS_FLIGHT_CONTROLLER, stat};
 		firstPacket = 0;
 		if (chunkSize)
 			memcpy(&packet[3], &payload[chunk * 57], chunkSize);
@@ -710,134 +482,21 @@ bool ExpressLRS::setupSubscription(u8 crsfAddress, const u8 subList[], u8 subCou
 	return true;
 }
 
-void ExpressLRS::resetMsp(bool setError) {
-	this->mspRxPos = 0;
-	this->mspRecording = false;
-	this->mspRxPayloadLen = 0;
-	this->mspVersion = MspVersion::V2_OVER_CRSF;
-	this->mspExtSrcAddr = 0;
-	this->mspRxCmd = 0;
-	this->mspRxSeq = 0;
-	if (setError) {
-		ELRS_RAISE_ERROR(ERROR_MSP_OVER_CRSF);
-	}
-}
-
 void ExpressLRS::processMspReq() {
-	const u8 *const mspData = inPayload + 1;
-	if (inActualLen < 1) {
+	if (in.len < 1) {
 		// need at least status byte
 		ELRS_RAISE_ERROR(ERROR_INVALID_LENGTH);
 		return;
 	}
-	const u8 status = *inPayload; // first byte of payload is the status byte
-	const u8 isError = (status >> 7);
-	const bool isNewFrame = (status >> 4) & 0b1;
-	const u8 sequenceNo = status & 0xF;
-	u8 readPos = 0; // read position for MSP payload
-
-	const u8 expectedSequence = (this->mspRxSeq + 1) & 0xF;
-	const bool sequenceError = sequenceNo != expectedSequence;
-
-	if (isError || (!isNewFrame && sequenceError)) return this->resetMsp(true);
-
-	if (isNewFrame) {
-		this->resetMsp(); // if a new frame comes in before the previous one is complete we need to reset the rxPos
-
-		// set MSP version
-		const u8 headerVersion = (status >> 5) & 0b11; // 1 = V1 or V1_JUMBO, 2 = V2
-		switch (headerVersion) {
-		case 1:
-			if (mspData[0] == 0xFF)
-				this->mspVersion = MspVersion::V1_JUMBO_OVER_CRSF;
-			else
-				this->mspVersion = MspVersion::V1_OVER_CRSF;
-			break;
-		case 2:
-			this->mspVersion = MspVersion::V2_OVER_CRSF;
-			break;
-		default:
-			DEBUG_PRINTLN("unsupported MSP version: " + String(headerVersion));
-			this->resetMsp(true);
-			return;
-		}
-
-		// save return address for once packet is complete
-		this->mspExtSrcAddr = inExtSrc;
-
-		// calculate frame length
-		switch (this->mspVersion) {
-		case MspVersion::V1_OVER_CRSF:
-			if (inActualLen < 3) {
-				// need at least status byte, payload len and function
-				DEBUG_PRINTLN("Too small V1");
-				this->resetMsp(true);
-				return; // broken packet
-			}
-			readPos = 2;
-			this->mspRxPayloadLen = mspData[0];
-			this->mspRxCmd = mspData[1];
-			break;
-		case MspVersion::V1_JUMBO_OVER_CRSF:
-			if (inActualLen < 5) {
-				// 1+2 payload length, 1 command
-				DEBUG_PRINTLN("Too small V1 Jumbo");
-				this->resetMsp(true);
-				return; // broken packet
-			}
-			readPos = 4;
-			this->mspRxCmd = mspData[1];
-			this->mspRxPayloadLen = mspData[2] | (mspData[3] << 8);
-			if (this->mspRxPayloadLen > 512) {
-				DEBUG_PRINTLN("Too large V1 Jumbo");
-				this->resetMsp(true);
-				return; // invalid payload length
-			}
-			break;
-		case MspVersion::V2_OVER_CRSF:
-			if (inActualLen < 6) {
-				// 1 flags, 2 payload length, 2 command
-				DEBUG_PRINTLN("Too small V2");
-				this->resetMsp(true);
-				return;
-			}
-			readPos = 5;
-			this->mspRxFlag = mspData[0];
-			this->mspRxCmd = mspData[1] | (mspData[2] << 8);
-			this->mspRxPayloadLen = mspData[3] | (mspData[4] << 8);
-			if (this->mspRxPayloadLen > 512) {
-				DEBUG_PRINTLN("Too large V2");
-				this->resetMsp(true);
-				return; // invalid payload length
-			}
-		}
-		this->mspRecording = true;
-	}
-	if (!this->mspRecording) {
-		DEBUG_PRINTLN("MSP recording not started, but got a packet, probably packet loss");
-		this->resetMsp(true);
-		return;
-	}
-	this->mspRxSeq = sequenceNo; // save the sequence number for next frame
-
-	i8 thisMspPayloadLen = inActualLen - 1 - readPos; // how much MSP payload is in this CRSF frame = total payload size minus status, then deduct start of MSP payload (readPos)
-
-	// something is wrong
-	if (thisMspPayloadLen < 0) return this->resetMsp(true);
-
-	i16 mspNeedsPayloadBytes = this->mspRxPayloadLen - this->mspRxPos; // how many bytes we still need to read for the MSP payload
-	i16 readFromThisPacket = MIN(thisMspPayloadLen, mspNeedsPayloadBytes); // how much MSP payload we can read from this packet
-
-	// something is wrong
-	if (readFromThisPacket < 0) return this->resetMsp(true);
-
-	memcpy(this->mspRxPayload + this->mspRxPos, &mspData[readPos], readFromThisPacket);
-
-	this->mspRxPos += readFromThisPacket; // update the position in the MSP payload
-
-	// if we have a full packet
-	if (this->mspRxPos >= this->mspRxPayloadLen) {
-		processMspCmd(*serial, MspMsgType::REQUEST, (MspFn)this->mspRxCmd, this->mspVersion, (char *)this->mspRxPayload, this->mspRxPayloadLen);
-		this->resetMsp();
+	switch (mspRx.feed(in.payload, in.len, in.extSrc)) {
+	case CrsfMspRx::COMPLETE:
+		processMspCmd(*serial, MspMsgType::REQUEST, (MspFn)mspRx.cmd, mspRx.version, (char *)mspRx.payload, mspRx.payloadLen);
+		mspRx.reset();
+		break;
+	case CrsfMspRx::ERROR:
+		ELRS_RAISE_ERROR(ERROR_MSP_OVER_CRSF);
+		break;
+	default:
+		break;
 	}
 }
@@ -22,14 +22,12 @@
 
 #pragma once
 #include "hardware/interp.h"
+#include "crsf.h"
 #include "msp.h"
 #include <Arduino.h>
 #include <elapsedMillis.h>
 #include <list>
 
-// protocol wiki of CRSF, made by ExpressLRS
-// https://github.com/crsf-wg/crsf/wiki
-
 extern RingBuffer<u8> elrsBuffer;
 
 typedef struct crsfDevice {
@@ -208,28 +206,9 @@ private:
 		25, 50, 100, 100, 150, 200, 200, 250, 333, 500, 250, 500, 500, 1000, 250, 500, 1000};
 	static constexpr u16 packetRatesX[20] = {
 		100, 150};
-	static constexpr u8 CRSF_SYNC_BYTE = 0xC8;
 
 	// incoming packets
-	enum {
-		CRSF_STATE_SYNC,
-		CRSF_STATE_LEN,
-		CRSF_STATE_TYPE,
-		CRSF_STATE_EXT_DEST,
-		CRSF_STATE_EXT_SRC,
-		CRSF_STATE_PAYLOAD,
-		CRSF_STATE_CRC
-	};
-	u8 inMsgState = CRSF_STATE_SYNC;
-	u8 inPayloadIndex = 0;
-	u8 inType = 0;
-	u8 inMsgLen = 0;
-	u8 inActualLen = 0;
-	u8 inExtDest = 0;
-	u8 inExtSrc = 0;
-	u32 inCrc = 0;
-	bool inMsgIsExtended = false;
-	u8 inPayload[60]; // only actual payload, not ext src/dest
+	CrsfParser in;
 	void processMessage();
 	bool parseChar(u8 c); // returns true if a packet is done
 
@@ -256,16 +235,7 @@ private:
 	MspVersion subscribeMspVersion = MspVersion::V2;
 
 	// MSP packets (in/out)
-	u8 mspExtSrcAddr = 0;
-	u8 mspRxPayload[512] = {};
+	CrsfMspRx mspRx;
 	u8 mspTelemSeq = 0;
-	u16 mspRxPayloadLen = 0;
-	u16 mspRxCmd = 0;
-	u8 mspRxSeq = 0;
-	u16 mspRxPos = 0;
-	bool mspRecording = false;
-	u8 mspRxFlag = 0;
-	MspVersion mspVersion = MspVersion::V2_OVER_CRSF;
-	void resetMsp(bool setError = false);
 	void processMspReq();
 };
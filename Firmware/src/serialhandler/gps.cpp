@@ -23,12 +23,14 @@
 #include "global.h"
 
 RingBuffer<u8> gpsBuffer(1024);
-static elapsedMicros gpsInitTimer;
-static bool gpsInitAck = false;
 GpsAccuracy gpsAcc;
 struct tm gpsTime;
 GpsStatus gpsStatus;
 GpsMotion gpsMotion;
+GpsDop gpsDop;
+GpsReceiver gpsReceiver;
+GpsSatellite gpsSats[GPS_MAX_SATS];
+u8 gpsSatsTracked = 0;
 fix64 gpsLatitudeFiltered, gpsLongitudeFiltered;
 static char olcString[14] = "AABBCCDD+EEFG";
 static char olcAlphabet[] = "23456789CFGHJMPQRVWX";
@@ -38,26 +40,118 @@ u32 gpsUpdateRate;
 fix32 gpsVelocityFilterCutoff;
 static KoliSerial *gpsSerial = nullptr;
 bool gpsGoodQuality = false;
+u8 gpsPpsPin = 255;
+GpsTimebase gpsTimebase;
+static volatile u32 ppsCaptureUs = 0;
+static volatile u32 ppsCaptures = 0;
+static u32 ppsCapturesSeen = 0;
 static bool firstGoodQuality = true;
 
 int gpsSerialSpeed = 38400;
 u8 retryCounter = 0;
 elapsedMicros lastPvtMessage = 0;
 
-void gpsChecksum(const u8 *buf, int len, u8 *ck_a, u8 *ck_b) {
-	*ck_a = 0;
-	*ck_b = 0;
-	for (int i = 0; i < len; i++) {
-		*ck_a += buf[i];
-		*ck_b += *ck_a;
+#define GPS_BYTES_PER_LOOP 128 // bounds the time per loop, a long message is collected over several loops
+
+UbxParser gpsUbx;
+static u32 gpsUbxErrors = 0; // parser errors that were already counted in the task stats
+
+static void gpsSend(const u8 *frame, u16 len) {
+	gpsSerial->write(frame, len);
+}
+
+// the receiver may still be on its default 38400 baud or already on 115200, alternate every two attempts
+static void gpsSetupUart(u8 attempt) {
+	if (retryCounter++ % 2 == 0) {
+		gpsSerialSpeed = 153600 - gpsSerialSpeed;
+		gpsSerial->end();
+		gpsSerial->begin(gpsSerialSpeed);
 	}
 }
 
+// the receiver switched to 115200 when it acknowledged CFG-PRT
+static void gpsSwitchTo115200(u8 attempt) {
+	gpsSerial->end();
+	gpsSerial->begin(115200);
+}
+
+static u8 msgSetNavRate[6];
+static void gpsFillNavRate(u8 attempt) {
+	u16 milliseconds = 1000 / gpsUpdateRate;
+	msgSetNavRate[0] = milliseconds & 0xFF; // measurement interval in ms U2
+	msgSetNavRate[1] = milliseconds >> 8;
+	msgSetNavRate[2] = 0x01; // navRate divider U2
+	msgSetNavRate[3] = 0x00;
+	msgSetNavRate[4] = 0x01; // time system alignment (1 = GPS time) U2
+	msgSetNavRate[5] = 0x00;
+}
+
+static const u8 msgSetupUart[] = {
+	0x01, 0x00, 0x00, 0x00, // port identifier U1, reserved U1, txReady pin config X2
+	0xD0, 0x08, 0x00, 0x00, // UART mode (8N1) X4
+	0x00, 0xC2, 0x01, 0x00, // baudrate (115200) U4
+	0x01, 0x00, 0x01, 0x00, // in proto X2, out proto X2 (UBX only)
+	0x00, 0x00, 0x00, 0x00, // flags X2, reserved U1[2]
+};
+// CFG-MSG: message class U1, message ID U1, rate (0 = disable, 1+ = divider) U1
+static const u8 msgDisableGxGGA[] = {NMEA_CLASS_STANDARD, NMEA_ID_GGA, 0};
+static const u8 msgDisableGxGSA[] = {NMEA_CLASS_STANDARD, NMEA_ID_GSA, 0};
+static const u8 msgDisableGxGSV[] = {NMEA_CLASS_STANDARD, NMEA_ID_GSV, 0};
+static const u8 msgDisableGxRMC[] = {NMEA_CLASS_STANDARD, NMEA_ID_RMC, 0};
+static const u8 msgDisableGxVTG[] = {NMEA_CLASS_STANDARD, NMEA_ID_VTG, 0};
+static const u8 msgDisableGxGLL[] = {NMEA_CLASS_STANDARD, NMEA_ID_GLL, 0};
+static const u8 msgEnableNavPvt[] = {UBX_CLASS_NAV, UBX_ID_NAV_PVT, 1};
+static const u8 msgEnableNavStatus[] = {UBX_CLASS_NAV, UBX_ID_NAV_STATUS, 5};
+static const u8 msgEnableNavDop[] = {UBX_CLASS_NAV, UBX_ID_NAV_DOP, 5};
+static const u8 msgEnableNavSat[] = {UBX_CLASS_NAV, UBX_ID_NAV_SAT, 10};
+static const u8 msgEnableMonHw[] = {UBX_CLASS_MON, UBX_ID_MON_HW, 10};
+
+static const UbxConfigStep gpsConfigSteps[] = {
+	{UBX_CLASS_CFG, UBX_ID_CFG_PRT, msgSetupUart, sizeof(msgSetupUart), gpsSetupUart},
+	{UBX_CLASS_CFG, UBX_ID_CFG_MSG, msgDisableGxGGA, 3, gpsSwitchTo115200},
+	{UBX_CLASS_CFG, UBX_ID_CFG_MSG, msgDisableGxGSA, 3},
+	{UBX_CLASS_CFG, UBX_ID_CFG_MSG, msgDisableGxGSV, 3},
+	{UBX_CLASS_CFG, UBX_ID_CFG_MSG, msgDisableGxRMC, 3},
+	{UBX_CLASS_CFG, UBX_ID_CFG_MSG, msgDisableGxVTG, 3},
+	{UBX_CLASS_CFG, UBX_ID_CFG_MSG, msgEnableNavPvt, 3},
+	{UBX_CLASS_CFG, UBX_ID_CFG_MSG, msgDisableGxGLL, 3},
+	{UBX_CLASS_CFG, UBX_ID_CFG_RATE, msgSetNavRate, sizeof(msgSetNavRate), gpsFillNavRate},
+	// status messages at a lower rate, not supported by every receiver
+	{UBX_CLASS_CFG, UBX_ID_CFG_MSG, msgEnableNavStatus, 3, nullptr, true},
+	{UBX_CLASS_CFG, UBX_ID_CFG_MSG, msgEnableNavDop, 3, nullptr, true},
+	{UBX_CLASS_CFG, UBX_ID_CFG_MSG, msgEnableNavSat, 3, nullptr, true},
+	{UBX_CLASS_CFG, UBX_ID_CFG_MSG, msgEnableMonHw, 3, nullptr, true},
+};
+UbxConfigSequencer gpsConfig(gpsConfigSteps, ARRAYLEN(gpsConfigSteps), gpsSend);
+
 void setGpsSerial(KoliSerial *g) {
 	gpsSerial = g;
 }
 
-void initGPS() {}
+static void __not_in_flash_func(gpsPpsIsr)() {
+	// read the timer first, everything after that only adds to the jitter
+	const u32 now = time_us_32();
+	if (gpio_get_irq_event_mask(gpsPpsPin) & GPIO_IRQ_EDGE_RISE) {
+		gpio_acknowledge_irq(gpsPpsPin, GPIO_IRQ_EDGE_RISE);
+		ppsCaptureUs = now;
+		ppsCaptures = ppsCaptures + 1;
+	}
+}
+
+void initGPS() {
+	addSetting(SETTING_GPS_PPS_PIN, &gpsPpsPin, 255);
+	if (gpsPpsPin >= NUM_BANK0_GPIOS || !pinIsAllowed(gpsPpsPin)) {
+		gpsPpsPin = 255;
+		return;
+	}
+	gpio_init(gpsPpsPin);
+	gpio_set_dir(gpsPpsPin, GPIO_IN);
+	gpio_pull_down(gpsPpsPin);
+	// shared with the gyro interrupt, but ahead of it
+	gpio_add_raw_irq_handler_with_order_priority(gpsPpsPin, gpsPpsIsr, PICO_SHARED_IRQ_HANDLER_HIGHEST_ORDER_PRIORITY);
+	gpio_set_irq_enabled(gpsPpsPin, GPIO_IRQ_EDGE_RISE, true);
+	irq_set_enabled(IO_IRQ_BANK0, true);
+}
 
 void fillOpenLocationCode() {
 	u32 lat = gpsMotion.lat / 1250 + 720000;
@@ -79,260 +173,193 @@ void fillOpenLocationCode() {
 	olcString[11] = olcAlphabet[(lat % 5) * 4 + (lon % 4)];
 }
 
+static void onAck(const u8 *payload, u16 len) {
+	gpsConfig.onAck(payload, true);
+}
+
+static void onNak(const u8 *payload, u16 len) {
+	gpsConfig.onAck(payload, false);
+}
+
+static void onNavPvt(const u8 *payload, u16 len) {
+	static u32 goodTimes = 0;
+	const u32 now = time_us_32();
+	gpsTimebase.epochTime(DECODE_U4(payload), (payload[11] & 0x03) == 0x03, now, &gpsMotion.epochUs);
+	const u32 fixAge = now - gpsMotion.epochUs; // 0 without the time pulse
+	memcpy(currentPvtMsg, payload, 92);
+	memcpy(&currentPvtMsg[80], &fixAge, 4); // reserved in NAV-PVT, the blackbox gets the age of the fix in us
+	lastPvtMessage = 0;
+	newPvtMessageFlag = 0xFFFFFFFF;
+	gpsTime.tm_year = DECODE_U2(&payload[4]);
+	gpsTime.tm_mon = payload[6];
+	gpsTime.tm_mday = payload[7];
+	gpsTime.tm_hour = payload[8];
+	gpsTime.tm_min = payload[9];
+	gpsTime.tm_sec = payload[10];
+	gpsStatus.timeValidityFlags = payload[11];
+	gpsAcc.tAcc = DECODE_U4(&payload[12]);
+	gpsStatus.fixType = payload[20];
+	gpsStatus.flags = payload[21];
+	gpsStatus.flags2 = payload[22];
+	bool fullyResolved = (gpsStatus.timeValidityFlags & 0x04) == 0x04;
+	bool valid = (gpsStatus.timeValidityFlags & 0x03) == 0x03;
+	bool confirmed = (gpsStatus.flags2 & 0xC0) == 0xC0;
+	u8 thisQuality = TIME_QUALITY_NONE;
+	if (confirmed) {
+		thisQuality = TIME_QUALITY_CONFIRMED;
+	} else if (valid) {
+		thisQuality = TIME_QUALITY_VALID;
+	} else if (fullyResolved) {
+		thisQuality = TIME_QUALITY_FULLY_RESOLVED;
+	}
+	if (thisQuality >= rtcTimeQuality) {
+		// refresh from gpsTime every 1200 frames, typically 1 min at 20Hz, as long as the quality is not decreasing
+		if (++goodTimes == 1200 || thisQuality > rtcTimeQuality) {
+			goodTimes = (thisQuality > rtcTimeQuality) * 1100; // already update time 10s after the quality has settled
+			struct timespec gpsTimespec;
+			rtcConvertToTimespec(&gpsTime, &gpsTimespec);
+			// nano is signed, then the time since the epoch, so that the RTC is set to now and not to the epoch
+			i64 nsec = (i64)DECODE_I4(&payload[16]) + (i64)(time_us_32() - gpsMotion.epochUs) * 1000;
+			while (nsec < 0) {
+				nsec += 1000000000;
+				gpsTimespec.tv_sec--;
+			}
+			gpsTimespec.tv_sec += nsec / 1000000000;
+			gpsTimespec.tv_nsec = nsec % 1000000000;
+			rtcSetTime(&gpsTimespec, thisQuality);
+		}
+	}
+	gpsStatus.satCount = payload[23];
+	gpsMotion.lon = DECODE_I4(&payload[24]);
+	gpsMotion.lat = DECODE_I4(&payload[28]);
+	gpsMotion.alt = DECODE_I4(&payload[36]);
+	gpsAcc.hAcc = DECODE_U4(&payload[40]);
+	gpsAcc.vAcc = DECODE_U4(&payload[44]);
+	gpsMotion.velN = DECODE_I4(&payload[48]);
+	gpsMotion.velE = DECODE_I4(&payload[52]);
+	gpsMotion.velD = DECODE_I4(&payload[56]);
+	gpsMotion.gSpeed = DECODE_I4(&payload[60]);
+	gpsMotion.headMot = DECODE_I4(&payload[64]);
+	gpsAcc.sAcc = DECODE_U4(&payload[68]);
+	gpsAcc.headAcc = DECODE_U4(&payload[72]);
+	gpsAcc.pDop = DECODE_U2(&payload[76]);
+	gpsStatus.flags3 = DECODE_U2(&payload[78]);
+	fix64 lat64 = fix64(gpsMotion.lat) / 10000000;
+	fix64 lon64 = fix64(gpsMotion.lon) / 10000000;
+
+	gpsGoodQuality = gpsStatus.fixType == FIX_3D &&
+					 gpsStatus.satCount >= 6 &&
+					 gpsAcc.hAcc < 20000 &&
+					 gpsAcc.vAcc < 20000;
+	if (gpsGoodQuality && firstGoodQuality) {
+		firstGoodQuality = false;
+		eVelFilter.set(fix32(0.001f) * gpsMotion.velE);
+		nVelFilter.set(fix32(0.001f) * gpsMotion.velN);
+		gpsLatitudeFiltered = lat64;
+		gpsLongitudeFiltered = lon64;
+		if (altInitState < 2) altInitState = 2;
+	} else {
+		eVelFilter.update(fix32(0.001f) * gpsMotion.velE);
+		nVelFilter.update(fix32(0.001f) * gpsMotion.velN);
+		gpsLatitudeFiltered = (gpsLatitudeFiltered * 3 + lat64) / 4;
+		gpsLongitudeFiltered = (gpsLongitudeFiltered * 3 + lon64) / 4;
+	}
+	if (gpsGoodQuality) {
+		// extrapolated from the epoch to now, the fix can be over 100 ms old when it is decoded
+		const i64 altNow = gpsMotion.alt - (i64)gpsMotion.velD * fixAge / 1000000;
+		gpsBaroAlt.setRaw((altNow << 16) / 1000);
+		// armingDisableFlags &= ~0x04;
+	} // else {
+	// armingDisableFlags |= 0x04;
+	// }
+}
+
+static void onNavStatus(const u8 *payload, u16 len) {
+	gpsReceiver.fixStat = payload[6];
+	gpsReceiver.ttff = DECODE_U4(&payload[8]);
+	gpsReceiver.msss = DECODE_U4(&payload[12]);
+}
+
+static void onNavDop(const u8 *payload, u16 len) {
+	gpsDop.gDop = DECODE_U2(&payload[4]);
+	gpsDop.pDop = DECODE_U2(&payload[6]);
+	gpsDop.tDop = DECODE_U2(&payload[8]);
+	gpsDop.vDop = DECODE_U2(&payload[10]);
+	gpsDop.hDop = DECODE_U2(&payload[12]);
+	gpsDop.nDop = DECODE_U2(&payload[14]);
+	gpsDop.eDop = DECODE_U2(&payload[16]);
+}
+
+static void onNavSat(const u8 *payload, u16 len) {
+	const u8 numSvs = payload[5];
+	gpsSatsTracked = numSvs < GPS_MAX_SATS ? numSvs : GPS_MAX_SATS;
+	for (int i = 0; i < gpsSatsTracked; i++) {
+		const u8 *sv = &payload[8 + 12 * i];
+		GpsSatellite &sat = gpsSats[i];
+		sat.gnssId = sv[0];
+		sat.svId = sv[1];
+		sat.cno = sv[2];
+		sat.elev = (i8)sv[3];
+		sat.azim = DECODE_I2(&sv[4]);
+		sat.flags = DECODE_U4(&sv[8]);
+	}
+}
+
+static void onMonHw(const u8 *payload, u16 len) {
+	gpsReceiver.noisePerMs = DECODE_U2(&payload[16]);
+	gpsReceiver.agcCnt = DECODE_U2(&payload[18]);
+	gpsReceiver.antennaStatus = payload[20];
+	gpsReceiver.antennaPower = payload[21];
+	gpsReceiver.jammingState = (payload[22] >> 2) & 0b11;
+	gpsReceiver.jamInd = payload[45];
+}
+
+static const UbxMsgSchema gpsMessages[] = {
+	{UBX_CLASS_ACK, UBX_ID_ACK_ACK, 2, 0, 0, onAck},
+	{UBX_CLASS_ACK, UBX_ID_ACK_NAK, 2, 0, 0, onNak},
+	{UBX_CLASS_NAV, UBX_ID_NAV_PVT, 92, 0, 0, onNavPvt},
+	{UBX_CLASS_NAV, UBX_ID_NAV_STATUS, 16, 0, 0, onNavStatus},
+	{UBX_CLASS_NAV, UBX_ID_NAV_DOP, 18, 0, 0, onNavDop},
+	{UBX_CLASS_NAV, UBX_ID_NAV_SAT, 8, 12, 5, onNavSat}, // 8 byte header, 12 bytes per satellite, numSvs at 5
+	{UBX_CLASS_MON, UBX_ID_MON_HW, 60, 0, 0, onMonHw},
+};
+
 void gpsLoop() {
 	if (gpsSerial == nullptr) return;
 	TASK_START(TASK_GPS);
 	if (lastPvtMessage > 2000000) {
-		// no PVT message received for 1 second
+		// no PVT message received for 2 seconds
 		gpsStatus.fixType = fixTypes::FIX_NONE;
 		if (gpsStatus.gpsInited) {
 			gpsStatus.gpsInited = false;
-			lastPvtMessage = 0;
-			gpsStatus.initStep = 0;
-			gpsInitAck = false;
-			gpsInitTimer = 0;
+			gpsConfig.restart(time_us_32());
 			lastPvtMessage = 0;
 		}
 	}
-	// UBX implementation
-	if (!gpsStatus.gpsInited && (gpsInitAck || gpsInitTimer > 1000000)) {
-		switch (gpsStatus.initStep) {
-		case 0: {
-			if (retryCounter++ % 2 == 0) {
-				gpsSerialSpeed = 153600 - gpsSerialSpeed;
-				gpsSerial->end();
-				gpsSerial->begin(gpsSerialSpeed);
-			}
-			u8 msgSetupUart[] = {UBX_SYNC1, UBX_SYNC2, UBX_CLASS_CFG, UBX_ID_CFG_PRT,
-								 0x14, 0x00, // length 20
-								 0x01, 0x00, 0x00, 0x00, // port identifier U1, reserved U1, txReady pin config X2
-								 0xD0, 0x08, 0x00, 0x00, // UART mode (8N1) X4
-								 0x00, 0xC2, 0x01, 0x00, // baudrate (115200) U4
-								 0x01, 0x00, 0x01, 0x00, // in proto X2, out proto X2 (UBX only)
-								 0x00, 0x00, 0x00, 0x00, // flags X2, reserved U1[2]
-								 0, 0}; // checksum X1[2]
-			gpsChecksum(&msgSetupUart[2], 24, &msgSetupUart[26], &msgSetupUart[27]);
-			gpsSerial->write(msgSetupUart, 28);
-			gpsInitAck = false;
-			gpsInitTimer = 0;
-		} break;
-		case 1: {
-			gpsSerial->end();
-			gpsSerial->begin(115200);
-			u8 msgDisableGxGGA[] = {UBX_SYNC1, UBX_SYNC2, UBX_CLASS_CFG, UBX_ID_CFG_MSG,
-									0x03, 0x00, // length 3
-									NMEA_CLASS_STANDARD, // message class U1
-									NMEA_ID_GGA, // message ID U1
-									0, // rate (0 = disable, 1+ = divider) U1
-									0, 0};
-			gpsChecksum(&msgDisableGxGGA[2], 7, &msgDisableGxGGA[9], &msgDisableGxGGA[10]);
-			gpsSerial->write(msgDisableGxGGA, 11);
-			gpsInitAck = false;
-			gpsInitTimer = 0;
-		} break;
-		case 2: {
-			u8 msgDisableGxGSA[] = {UBX_SYNC1, UBX_SYNC2, UBX_CLASS_CFG, UBX_ID_CFG_MSG, 0x03, 0x00, NMEA_CLASS_STANDARD, NMEA_ID_GSA, 0, 0, 0};
-			gpsChecksum(&msgDisableGxGSA[2], 7, &msgDisableGxGSA[9], &msgDisableGxGSA[10]);
-			gpsSerial->write(msgDisableGxGSA, 11);
-			gpsInitAck = false;
-			gpsInitTimer = 0;
-		} break;
-		case 3: {
-			u8 msgDisableGxGSV[] = {UBX_SYNC1, UBX_SYNC2, UBX_CLASS_CFG, UBX_ID_CFG_MSG, 0x03, 0x00, NMEA_CLASS_STANDARD, NMEA_ID_GSV, 0, 0, 0};
-			gpsChecksum(&msgDisableGxGSV[2], 7, &msgDisableGxGSV[9], &msgDisableGxGSV[10]);
-			gpsSerial->write(msgDisableGxGSV, 11);
-			gpsInitAck = false;
-			gpsInitTimer = 0;
-		} break;
-		case 4: {
-			u8 msgDisableGxRMC[] = {UBX_SYNC1, UBX_SYNC2, UBX_CLASS_CFG, UBX_ID_CFG_MSG, 0x03, 0x00, NMEA_CLASS_STANDARD, NMEA_ID_RMC, 0, 0, 0};
-			gpsChecksum(&msgDisableGxRMC[2], 7, &msgDisableGxRMC[9], &msgDisableGxRMC[10]);
-			gpsSerial->write(msgDisableGxRMC, 11);
-			gpsInitAck = false;
-			gpsInitTimer = 0;
-		} break;
-		case 5: {
-			u8 msgDisableGxVTG[] = {UBX_SYNC1, UBX_SYNC2, UBX_CLASS_CFG, UBX_ID_CFG_MSG, 0x03, 0x00, NMEA_CLASS_STANDARD, NMEA_ID_VTG, 0, 0, 0};
-			gpsChecksum(&msgDisableGxVTG[2], 7, &msgDisableGxVTG[9], &msgDisableGxVTG[10]);
-			gpsSerial->write(msgDisableGxVTG, 11);
-			gpsInitAck = false;
-			gpsInitTimer = 0;
-		} break;
-		case 6: {
-			u8 msgEnableNavPvt[] = {UBX_SYNC1, UBX_SYNC2, UBX_CLASS_CFG, UBX_ID_CFG_MSG,
-									0x03, 0x00, // length 3
-									UBX_CLASS_NAV, // message class U1
-									UBX_ID_NAV_PVT, // message ID U1
-									1, // rate (0 = disable, 1+ = divider) U1
-									0, 0};
-			gpsChecksum(&msgEnableNavPvt[2], 7, &msgEnableNavPvt[9], &msgEnableNavPvt[10]);
-			gpsSerial->write(msgEnableNavPvt, 11);
-			gpsInitAck = false;
-			gpsInitTimer = 0;
-		} break;
-		case 7: {
-			u8 msgDisableGxGLL[] = {UBX_SYNC1, UBX_SYNC2, UBX_CLASS_CFG, UBX_ID_CFG_MSG, 0x03, 0x00, NMEA_CLASS_STANDARD, NMEA_ID_GLL, 0, 0, 0};
-			gpsChecksum(&msgDisableGxGLL[2], 7, &msgDisableGxGLL[9], &msgDisableGxGLL[10]);
-			gpsSerial->write(msgDisableGxGLL, 11);
-			gpsInitAck = false;
-			gpsInitTimer = 0;
-		} break;
-		case 8: {
-			u16 milliseconds = 1000 / gpsUpdateRate;
-			u8 msgSetNavRate[] = {UBX_SYNC1, UBX_SYNC2, UBX_CLASS_CFG, UBX_ID_CFG_RATE,
-								  0x06, 0x00, // length 6
-								  (u8)(milliseconds & 0xFF), (u8)(milliseconds >> 8), // measurement interval in ms U2
-								  0x01, 0x00, // navRate divider U2
-								  0x01, 0x00, // time system alignment (1 = GPS time) U2
-								  0x00, 0x00};
-			gpsChecksum(&msgSetNavRate[2], 10, &msgSetNavRate[12], &msgSetNavRate[13]);
-			gpsSerial->write(msgSetNavRate, 14);
-			gpsInitAck = false;
-			gpsInitTimer = 0;
-		} break;
-		case 9:
-			gpsStatus.gpsInited = true;
-			break;
-		}
+	if (ppsCaptures != ppsCapturesSeen) {
+		ppsCapturesSeen = ppsCaptures;
+		gpsTimebase.addPulse(ppsCaptureUs);
 	}
-	if (gpsBuffer.itemCount() >= 8) {
-		if (gpsBuffer[0] != UBX_SYNC1 || gpsBuffer[1] != UBX_SYNC2) {
-			gpsBuffer.pop();
-			tasks[TASK_GPS].errorCount++;
-			tasks[TASK_GPS].lastError = 1;
-			TASK_END(TASK_GPS);
-			return;
-		}
-		int len = gpsBuffer[4] | (gpsBuffer[5] << 8);
-		if (len > GPS_BUF_LEN - 8) {
-			gpsBuffer.pop();
-			tasks[TASK_GPS].errorCount++;
-			tasks[TASK_GPS].lastError = 2;
-			TASK_END(TASK_GPS);
-			return;
-		}
-		if (gpsBuffer.itemCount() < len + 8) {
-			TASK_END(TASK_GPS);
-			return;
-		}
-		u8 msg[len + 8];
-		gpsBuffer.copyToArray(msg, 2, len + 6);
-		u8 ck_a, ck_b;
-		gpsChecksum(msg, len + 4, &ck_a, &ck_b);
-		if (ck_a != msg[len + 4] || ck_b != msg[len + 5]) {
-			gpsBuffer.pop();
-			tasks[TASK_GPS].errorCount++;
-			tasks[TASK_GPS].lastError = 3;
-			TASK_END(TASK_GPS);
-			return;
-		}
-		TASK_START(TASK_GPS_MSG);
-		u8 *msgData = &msg[4];
-		// ensured that the packet is valid
-		u32 id = msg[1], classId = msg[0];
+	gpsConfig.loop(time_us_32());
+	gpsStatus.initStep = gpsConfig.currentStep();
+	gpsStatus.gpsInited = gpsConfig.done();
 
-		switch (classId) {
-		case UBX_CLASS_ACK: {
-			switch (id) {
-			case UBX_ID_ACK_ACK:
-				if (gpsStatus.initStep < 9 && len == 2 && msgData[0] == UBX_CLASS_CFG && (msgData[1] == UBX_ID_CFG_MSG || msgData[1] == UBX_ID_CFG_PRT || msgData[1] == UBX_ID_CFG_RATE)) {
-					gpsStatus.initStep++;
-					gpsInitAck = true;
-				}
-				break;
-			}
-		} break;
-		case UBX_CLASS_NAV: {
-			switch (id) {
-			case UBX_ID_NAV_PVT: {
-				if (len != 92) {
-					gpsBuffer.pop();
-					return;
-				}
-				static u32 goodTimes = 0;
-				memcpy(currentPvtMsg, msgData, 92);
-				lastPvtMessage = 0;
-				newPvtMessageFlag = 0xFFFFFFFF;
-				gpsTime.tm_year = DECODE_U2(&msgData[4]);
-				gpsTime.tm_mon = msgData[6];
-				gpsTime.tm_mday = msgData[7];
-				gpsTime.tm_hour = msgData[8];
-				gpsTime.tm_min = msgData[9];
-				gpsTime.tm_sec = msgData[10];
-				gpsStatus.timeValidityFlags = msgData[11];
-				gpsAcc.tAcc = DECODE_U4(&msgData[12]);
-				gpsStatus.fixType = msgData[20];
-				gpsStatus.flags = msgData[21];
-				gpsStatus.flags2 = msgData[22];
-				bool fullyResolved = (gpsStatus.timeValidityFlags & 0x04) == 0x04;
-				bool valid = (gpsStatus.timeValidityFlags & 0x03) == 0x03;
-				bool confirmed = (gpsStatus.flags2 & 0xC0) == 0xC0;
-				u8 thisQuality = TIME_QUALITY_NONE;
-				if (confirmed) {
-					thisQuality = TIME_QUALITY_CONFIRMED;
-				} else if (valid) {
-					thisQuality = TIME_QUALITY_VALID;
-				} else if (fullyResolved) {
-					thisQuality = TIME_QUALITY_FULLY_RESOLVED;
-				}
-				if (thisQuality >= rtcTimeQuality) {
-					// refresh from gpsTime every 1200 frames, typically 1 min at 20Hz, as long as the quality is not decreasing
-					if (++goodTimes == 1200 || thisQuality > rtcTimeQuality) {
-						goodTimes = (thisQuality > rtcTimeQuality) * 1100; // already update time 10s after the quality has settled
-						struct timespec gpsTimespec;
-						rtcConvertToTimespec(&gpsTime, &gpsTimespec);
-						gpsTimespec.tv_nsec = DECODE_U4(&msgData[16]);
-						rtcSetTime(&gpsTimespec, thisQuality);
-					}
-				}
-				gpsStatus.satCount = msgData[23];
-				gpsMotion.lon = DECODE_I4(&msgData[24]);
-				gpsMotion.lat = DECODE_I4(&msgData[28]);
-				gpsMotion.alt = DECODE_I4(&msgData[36]);
-				gpsAcc.hAcc = DECODE_U4(&msgData[40]);
-				gpsAcc.vAcc = DECODE_U4(&msgData[44]);
-				gpsMotion.velN = DECODE_I4(&msgData[48]);
-				gpsMotion.velE = DECODE_I4(&msgData[52]);
-				gpsMotion.velD = DECODE_I4(&msgData[56]);
-				gpsMotion.gSpeed = DECODE_I4(&msgData[60]);
-				gpsMotion.headMot = DECODE_I4(&msgData[64]);
-				gpsAcc.sAcc = DECODE_U4(&msgData[68]);
-				gpsAcc.headAcc = DECODE_U4(&msgData[72]);
-				gpsAcc.pDop = DECODE_U2(&msgData[76]);
-				gpsStatus.flags3 = DECODE_U2(&msgData[78]);
-				fix64 lat64 = fix64(gpsMotion.lat) / 10000000;
-				fix64 lon64 = fix64(gpsMotion.lon) / 10000000;
-
-				gpsGoodQuality = gpsStatus.fixType == FIX_3D &&
-								 gpsStatus.satCount >= 6 &&
-								 gpsAcc.hAcc < 20000 &&
-								 gpsAcc.vAcc < 20000;
-				if (gpsGoodQuality && firstGoodQuality) {
-					firstGoodQuality = false;
-					eVelFilter.set(fix32(0.001f) * gpsMotion.velE);
-					nVelFilter.set(fix32(0.001f) * gpsMotion.velN);
-					gpsLatitudeFiltered = lat64;
-					gpsLongitudeFiltered = lon64;
-					if (altInitState < 2) altInitState = 2;
-				} else {
-					eVelFilter.update(fix32(0.001f) * gpsMotion.velE);
-					nVelFilter.update(fix32(0.001f) * gpsMotion.velN);
-					gpsLatitudeFiltered = (gpsLatitudeFiltered * 3 + lat64) / 4;
-					gpsLongitudeFiltered = (gpsLongitudeFiltered * 3 + lon64) / 4;
-				}
-				if (gpsGoodQuality) {
-					gpsBaroAlt.setRaw(((i64)gpsMotion.alt << 16) / 1000);
-					// armingDisableFlags &= ~0x04;
-				} // else {
-				// armingDisableFlags |= 0x04;
-				// }
-			} break;
-			}
-		}
+	for (int i = 0; i < GPS_BYTES_PER_LOOP && !gpsBuffer.isEmpty(); i++) {
+		if (!gpsUbx.feed(gpsBuffer.pop())) continue;
+		TASK_START(TASK_GPS_MSG);
+		// one message per loop
+		if (ubxDispatch(gpsMessages, ARRAYLEN(gpsMessages), gpsUbx.cls(), gpsUbx.id(), gpsUbx.payload(), gpsUbx.len()) == UbxDispatch::BAD_LENGTH) {
+			tasks[TASK_GPS].errorCount++;
+			tasks[TASK_GPS].lastError = 4;
 		}
-		// pop the packet
-		gpsBuffer.erase(len + 8);
 		TASK_END(TASK_GPS_MSG);
+		break;
+	}
+	const u32 ubxErrors = gpsUbx.checksumErrors + gpsUbx.lengthErrors;
+	if (ubxErrors != gpsUbxErrors) {
+		tasks[TASK_GPS].errorCount += ubxErrors - gpsUbxErrors;
+		tasks[TASK_GPS].lastError = gpsUbx.lastError;
+		gpsUbxErrors = ubxErrors;
 	}
 	TASK_END(TASK_GPS);
 }
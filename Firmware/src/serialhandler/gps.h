@@ -22,6 +22,8 @@
 
 #include <Arduino.h>
 #include <pico/aon_timer.h>
+#include "gpsTimebase.h"
+#include "ubx.h"
 
 #define GPS_BUF_LEN 256
 
@@ -33,6 +35,8 @@ extern fix64 gpsLatitudeFiltered, gpsLongitudeFiltered;
 extern u32 gpsUpdateRate;
 extern fix32 gpsVelocityFilterCutoff;
 extern bool gpsGoodQuality; // whether the GPS data of the last frame is good
+extern u8 gpsPpsPin; // GPIO with the time pulse of the receiver, 255 if not connected
+extern GpsTimebase gpsTimebase;
 
 /**
  * @brief Set the serial that the GPS uses
@@ -44,7 +48,7 @@ void setGpsSerial(KoliSerial *g);
 /**
  * @brief initialize GPS driver
  *
- * @details Uses Serial2 and sets the baudrate to 38400, also enables the OSD elements
+ * @details Uses Serial2 and sets the baudrate to 38400, also enables the OSD elements. Starts capturing the time pulse if gps_pps_pin is set
  */
 void initGPS();
 
@@ -62,8 +66,6 @@ enum fixTypes : u8 {
 	FIX_TIME_ONLY = 5,
 };
 
-#define UBX_SYNC1 0xB5
-#define UBX_SYNC2 0x62
 typedef struct gpsAccuracy {
 	u32 tAcc; // unit: ns
 	u32 hAcc; // unit: mm
@@ -91,126 +93,45 @@ typedef struct gpsMotion {
 	i32 velD; // unit: mm/s
 	i32 gSpeed; // unit: mm/s
 	i32 headMot; // unit: 10^-5 deg
+	u32 epochUs; // micros() at the measurement epoch: from the time pulse if synced, otherwise when the message was decoded
 } GpsMotion;
+typedef struct gpsDop {
+	u16 gDop; // unit: 10^-2, all of them
+	u16 pDop;
+	u16 tDop;
+	u16 vDop;
+	u16 hDop;
+	u16 nDop;
+	u16 eDop;
+} GpsDop;
+typedef struct gpsReceiver {
+	u32 ttff; // unit: ms, time to first fix (NAV-STATUS)
+	u32 msss; // unit: ms since startup or reset of the receiver (NAV-STATUS)
+	u8 fixStat; // NAV-STATUS fixStat: differential corrections, map matching
+	u8 antennaStatus; // MON-HW: 0 init, 1 unknown, 2 ok, 3 short, 4 open
+	u8 antennaPower; // MON-HW: 0 off, 1 on, 2 unknown
+	u8 jammingState; // MON-HW: 0 unknown, 1 ok, 2 warning, 3 critical
+	u8 jamInd; // MON-HW: CW jamming indicator, 0 (none) to 255 (strong)
+	u16 noisePerMs; // MON-HW
+	u16 agcCnt; // MON-HW: automatic gain control, 0 to 8191
+} GpsReceiver;
+typedef struct gpsSatellite {
+	u8 gnssId; // 0 GPS, 1 SBAS, 2 Galileo, 3 BeiDou, 5 QZSS, 6 GLONASS
+	u8 svId;
+	u8 cno; // unit: dBHz
+	i8 elev; // unit: deg
+	i16 azim; // unit: deg
+	u32 flags; // NAV-SAT flags, bit 3: used for navigation
+} GpsSatellite;
+#define GPS_MAX_SATS 40 // NAV-SAT entries that are kept
+
 extern GpsAccuracy gpsAcc;
 extern struct tm gpsTime;
 extern GpsStatus gpsStatus;
 extern GpsMotion gpsMotion;
-
-enum ubx_class : u8 {
-	UBX_CLASS_NAV = 0x01,
-	UBX_CLASS_RXM = 0x02,
-	UBX_CLASS_INF = 0x04,
-	UBX_CLASS_ACK = 0x05,
-	UBX_CLASS_CFG = 0x06,
-	UBX_CLASS_UPD = 0x09,
-	UBX_CLASS_MON = 0x0A,
-	UBX_CLASS_AID = 0x0B,
-	UBX_CLASS_TIM = 0x0D,
-	UBX_CLASS_ESF = 0x10,
-	UBX_CLASS_MGA = 0x13,
-	UBX_CLASS_LOG = 0x21,
-	UBX_CLASS_SEC = 0x27,
-	UBX_CLASS_HNR = 0x28,
-	UBX_CLASS_TP5 = 0x31,
-};
-
-enum nmea_class : u8 {
-	NMEA_CLASS_STANDARD = 0xF0,
-	NMEA_CLASS_PUBX = 0xF1,
-};
-
-enum ubx_msg_id : u8 {
-	UBX_ID_ACK_ACK = 0x01,
-	UBX_ID_ACK_NAK = 0x00,
-	UBX_ID_AID_ALM = 0x30,
-	UBX_ID_AID_AOP = 0x33,
-	UBX_ID_AID_EPH = 0x31,
-	UBX_ID_AID_HUI = 0x02,
-	UBX_ID_AID_INI = 0x01,
-	UBX_ID_CFG_ANT = 0x13,
-	UBX_ID_CFG_BATCH = 0x93,
-	UBX_ID_CFG_CFG = 0x09,
-	UBX_ID_CFG_DAT = 0x06,
-	UBX_ID_CFG_DGNSS = 0x70,
-	UBX_ID_CFG_DOSC = 0x61,
-	UBX_ID_CFG_ESFALG = 0x56,
-	UBX_ID_CFG_ESFA = 0x4C,
-	UBX_ID_CFG_ESFG = 0x4D,
-	UBX_ID_CFG_ESFWT = 0x82,
-	UBX_ID_CFG_ESRC = 0x60,
-	UBX_ID_CFG_GEOFENCE = 0x69,
-	UBX_ID_CFG_GNSS = 0x3E,
-	UBX_ID_CFG_HNR = 0x5C,
-	UBX_ID_CFG_INF = 0x02,
-	UBX_ID_CFG_ITFM = 0x39,
-	UBX_ID_CFG_LOGFILTER = 0x47,
-	UBX_ID_CFG_MSG = 0x01,
-	UBX_ID_CFG_NAV5 = 0x24,
-	UBX_ID_CFG_NAVX5 = 0x23,
-	UBX_ID_CFG_NMEA = 0x17,
-	UBX_ID_CFG_ODO = 0x1E,
-	UBX_ID_CFG_PM2 = 0x3B,
-	UBX_ID_CFG_PMS = 0x86,
-	UBX_ID_CFG_PRT = 0x00,
-	UBX_ID_CFG_PWR = 0x57,
-	UBX_ID_CFG_RATE = 0x08,
-	UBX_ID_CFG_RINV = 0x34,
-	UBX_ID_CFG_RST = 0x04,
-	UBX_ID_CFG_RXM = 0x11,
-	UBX_ID_CFG_SBAS = 0x16,
-	UBX_ID_CFG_SENIF = 0x88,
-	UBX_ID_CFG_SLAS = 0x8D,
-	UBX_ID_CFG_SMGR = 0x62,
-	UBX_ID_CFG_SPT = 0x64,
-	UBX_ID_CFG_TMODE2 = 0x3D,
-	UBX_ID_CFG_TMODE3 = 0x71,
-	UBX_ID_CFG_TP5 = 0x31,
-	UBX_ID_CFG_TXSLOT = 0x53,
-	UBX_ID_CFG_USB = 0x1B,
-	UBX_ID_ESF_ALG = 0x14,
-	UBX_ID_ESF_INS = 0x15,
-	UBX_ID_ESF_MEAS = 0x02,
-	UBX_ID_ESF_RAW = 0x03,
-	UBX_ID_ESF_STATUS = 0x10,
-	UBX_ID_HNR_ATT = 0x01,
-	UBX_ID_HNR_INS = 0x02,
-	UBX_ID_HNR_PVT = 0x00,
-	UBX_ID_INF_DEBUG = 0x04,
-	UBX_ID_INF_ERROR = 0x00,
-	UBX_ID_INF_NOTICE = 0x02,
-	UBX_ID_INF_TEST = 0x03,
-	UBX_ID_INF_WARNING = 0x01,
-	UBX_ID_SEC_UNIQID = 0x03,
-	UBX_ID_NAV_DOP = 0x04,
-	UBX_ID_NAV_PVT = 0x07,
-	UBX_ID_NAV_SAT = 0x35,
-};
-
-enum nmea_msg_id : u8 {
-	NMEA_ID_DTM = 0x0A,
-	NMEA_ID_GBQ = 0x44,
-	NMEA_ID_GBS = 0x09,
-	NMEA_ID_GGA = 0x00,
-	NMEA_ID_GLL = 0x01,
-	NMEA_ID_GLQ = 0x43,
-	NMEA_ID_GNQ = 0x42,
-	NMEA_ID_GNS = 0x0D,
-	NMEA_ID_GPQ = 0x40,
-	NMEA_ID_GRS = 0x06,
-	NMEA_ID_GSA = 0x02,
-	NMEA_ID_GST = 0x07,
-	NMEA_ID_GSV = 0x03,
-	NMEA_ID_RMC = 0x04,
-	NMEA_ID_THS = 0x0E,
-	NMEA_ID_TXT = 0x41,
-	NMEA_ID_VLW = 0x0F,
-	NMEA_ID_VTG = 0x05,
-	NMEA_ID_ZDA = 0x08,
-
-	NMEA_ID_CONFIG = 0x41,
-	NMEA_ID_POSITION = 0x00,
-	NMEA_ID_RATE = 0x40,
-	NMEA_ID_SVSTATUS = 0x03,
-	NMEA_ID_TIME = 0x04,
-};
+extern GpsDop gpsDop;
+extern GpsReceiver gpsReceiver;
+extern GpsSatellite gpsSats[GPS_MAX_SATS];
+extern u8 gpsSatsTracked; // valid entries in gpsSats
+extern UbxParser gpsUbx;
+extern UbxConfigSequencer gpsConfig;
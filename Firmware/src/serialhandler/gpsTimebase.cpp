@@ -0,0 +1,121 @@
+/**
+ * @file gpsTimebase.cpp
+ * @brief Local timebase disciplined by the GPS time pulse (PPS), maps navigation epochs to micros()
+ *
+ * Copyright (c) 2026 Kolibri-FC contributors
+ *
+ * This file is part of Kolibri-FC (https://github.com/bastian2001/Kolibri-FC).
+ *
+ * Kolibri-FC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Kolibri-FC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gpsTimebase.h"
+#include <stdlib.h>
+
+u32 GpsTimebase::scaleMs(u32 ms) const {
+	return ((u64)ms * periodQ8 + 128000) / 256000;
+}
+
+void GpsTimebase::addPulse(u32 us) {
+	if (!havePulse || us - lastPulse >= GPS_PPS_TIMEOUT_US) {
+		// first pulse, or the first after an outage: only a new reference, the period estimate stays
+		lastPulse = us;
+		towKnown = false;
+		havePulse = true;
+		pulses++;
+		return;
+	}
+	// a missed pulse is fine, the interval just covers several seconds
+	const u32 interval = us - lastPulse;
+	const u32 period = periodQ8 >> 8;
+	const u32 seconds = (interval + period / 2) / period;
+	const i32 deviation = seconds ? (i32)(interval - seconds * period) : -(i32)interval;
+	if (seconds == 0 || seconds > 4 || (u32)abs(deviation) > GPS_PPS_TOLERANCE_US * seconds) {
+		rejectedPulses++;
+		// two bad pulses in a row: the reference itself was probably a glitch, start over from this one
+		if (++consecutiveRejects >= 2) {
+			lastPulse = us;
+			periodValid = false;
+			towKnown = false;
+			consecutiveRejects = 0;
+		}
+		return;
+	}
+	consecutiveRejects = 0;
+	const u32 measuredQ8 = ((u64)interval << 8) / seconds;
+	if (periodValid) {
+		// slow filter, the crystal drifts with temperature over minutes, not seconds
+		periodQ8 += ((i32)(measuredQ8 - periodQ8)) / 8;
+		jitterUs += ((i32)(abs(deviation) / seconds) - (i32)jitterUs) / 8;
+	} else {
+		periodQ8 = measuredQ8;
+		periodValid = true;
+	}
+	lastPulse = us;
+	pulseTow += seconds;
+	pulses++;
+}
+
+bool GpsTimebase::epochTime(u32 iTow, bool timeValid, u32 rxUs, u32 *epochUs) {
+	*epochUs = rxUs;
+	if (!timeValid || !synced(rxUs) || !periodValid) {
+		towKnown = false;
+		return false;
+	}
+	// epoch in the second that started with the last pulse (or a missed one after it), or in the one before if that is still in the future
+	const u32 period = periodQ8 >> 8;
+	const u32 missed = (rxUs - lastPulse) / period;
+	u32 epoch = lastPulse + missed * period + scaleMs(iTow % 1000);
+	u32 second = iTow / 1000 + 604800 - missed; // one week ahead, wraps in localToTow()
+	if ((i32)(rxUs - epoch) < 0) {
+		epoch -= period;
+		second++;
+	}
+	const u32 latency = rxUs - epoch;
+	if (latency > GPS_MAX_FIX_LATENCY_US) {
+		unmatchedEpochs++;
+		towKnown = false;
+		return false;
+	}
+	pulseTow = second;
+	towKnown = true;
+	lastLatencyUs = latency;
+	*epochUs = epoch;
+	return true;
+}
+
+bool GpsTimebase::synced(u32 nowUs) const {
+	return havePulse && periodValid && nowUs - lastPulse < GPS_PPS_TIMEOUT_US;
+}
+
+bool GpsTimebase::localToTow(u32 localUs, u32 *towMs, u16 *subMsUs) const {
+	if (!towKnown || !periodValid) return false;
+	const i32 sinceUs = localUs - lastPulse;
+	// local us to GPS us, negative for times before the pulse
+	const i64 gpsUs = ((i64)sinceUs << 8) * 1000000 / (i64)periodQ8;
+	const i64 week = 604800000000LL;
+	const i64 tow = (((i64)pulseTow * 1000000 + gpsUs) % week + week) % week;
+	*towMs = tow / 1000;
+	*subMsUs = tow % 1000;
+	return true;
+}
+
+void GpsTimebase::reset() {
+	havePulse = false;
+	periodValid = false;
+	towKnown = false;
+	consecutiveRejects = 0;
+	periodQ8 = 1000000 << 8;
+	jitterUs = 0;
+}
@@ -0,0 +1,84 @@
+/**
+ * @file gpsTimebase.h
+ * @brief Local timebase disciplined by the GPS time pulse (PPS), maps navigation epochs to micros()
+ *
+ * Copyright (c) 2026 Kolibri-FC contributors
+ *
+ * This file is part of Kolibri-FC (https://github.com/bastian2001/Kolibri-FC).
+ *
+ * Kolibri-FC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Kolibri-FC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include "typedefs.h"
+
+#define GPS_PPS_TOLERANCE_US 1000 // accepted deviation of a pulse from the expected second, 1000 ppm
+#define GPS_PPS_TIMEOUT_US 3500000 // without a pulse for this long the timebase is not synced anymore, up to 3 missed pulses are bridged
+#define GPS_MAX_FIX_LATENCY_US 900000 // an epoch that would be older than this when its message is processed is not trusted
+
+/**
+ * @brief Relates the local microsecond timer to GPS time using the time pulse of the receiver
+ *
+ * @details The receiver pulses at the start of every second of GPS/UTC time (u-blox default: 1 Hz, rising edge, aligned to the top of the second). The pulses are captured in the GPIO interrupt and fed here, together with every navigation solution. This keeps the length of one GPS second in local microseconds (crystal drift) and the local time of the last pulse. A navigation epoch with iTOW t was measured at pulse + (t mod 1000) ms, which is what the fix is tagged with instead of the time its message was decoded.
+ *
+ * Runs without any hardware access, so that it can be tested on the host.
+ */
+class GpsTimebase {
+public:
+	/// @brief add a captured pulse (local time of the rising edge)
+	void addPulse(u32 us);
+
+	/**
+	 * @brief find the local time at which a navigation epoch was measured
+	 *
+	 * @param iTow GPS time of week of the epoch in ms, as in NAV-PVT
+	 * @param timeValid whether the receiver reports a valid time (otherwise the pulses may not be aligned yet)
+	 * @param rxUs local time at which the message was decoded
+	 * @param epochUs set to the local time of the epoch, or rxUs if not synced
+	 * @return true if the epoch time comes from the time pulse
+	 */
+	bool epochTime(u32 iTow, bool timeValid, u32 rxUs, u32 *epochUs);
+
+	/// @brief whether recent pulses are available and the last epoch was matched to them
+	bool synced(u32 nowUs) const;
+
+	/**
+	 * @brief convert a local time to GPS time of week
+	 *
+	 * @param localUs local time, at most a few seconds away from the last pulse
+	 * @param towMs set to the GPS time of week in ms
+	 * @param subMsUs set to the microseconds within that ms
+	 * @return false if not synced
+	 */
+	bool localToTow(u32 localUs, u32 *towMs, u16 *subMsUs) const;
+
+	/// @brief forget all pulses, e.g. when the receiver is reconfigured
+	void reset();
+
+	u32 pulses = 0; // accepted pulses
+	u32 rejectedPulses = 0; // pulses that did not fit the expected second
+	u32 unmatchedEpochs = 0; // epochs that could not be related to a pulse
+	u32 periodQ8 = 1000000 << 8; // length of one GPS second in local us, Q24.8
+	u32 jitterUs = 0; // filtered deviation of the pulses from the expected time
+	u32 lastLatencyUs = 0; // age of the last matched epoch when its message was decoded
+
+private:
+	u32 scaleMs(u32 ms) const; // GPS ms to local us
+	u32 lastPulse = 0;
+	u32 pulseTow = 0; // GPS second of the last pulse (time of week in s, modulo one week), valid if towKnown
+	bool havePulse = false;
+	bool periodValid = false; // at least one interval between two pulses was measured
+	bool towKnown = false;
+	u8 consecutiveRejects = 0;
+};
@@ -29,10 +29,10 @@
 #define SEND_BASIC_ERROR               \
 	msgSetup.type = MspMsgType::ERROR; \
 	sendMsp(msgSetup);
-#define BREAK_WITH_BASIC_ERROR_IF(cond) \
-	if (cond) {                         \
-		SEND_BASIC_ERROR                \
-		break;                          \
+#define RETURN_WITH_BASIC_ERROR_IF(cond) \
+	if (cond) {                          \
+		SEND_BASIC_ERROR                 \
+		return;                          \
 	}
 
 elapsedMillis mspOverrideMotors = 1001;
@@ -46,7 +46,58 @@ i16 mspDebugSensors[4] = {0, 0, 0, 0};
 
 KoliSerial *lastMspSerial = nullptr;
 
+// segmented transfers (mspTransfer.h), the objects
+static i32 saveOsdElements(u8 *buf, u32 bufSize) {
+	u32 len = 0;
+	for (u32 i = 0; i < OsdCanvas::MAX_ELEMENTS && len + 8 <= bufSize; i++) {
+		const OsdElement &el = OsdCanvas::get().getElement(i);
+		if (el.type == OsdElementType::DISABLED) continue;
+		u16 type = (u16)el.type;
+		memcpy(&buf[len], &type, 2);
+		buf[len + 2] = el.col;
+		buf[len + 3] = el.row;
+		memcpy(&buf[len + 4], &el.option, 4);
+		len += 8;
+	}
+	return len;
+}
+
+static i32 loadOsdElements(const u8 *data, u32 len, u32 pos) {
+	if (len % 8) return -1;
+	OsdCanvas::get().resetElements();
+	u32 elementIndex = 0;
+	for (u32 i = 0; i < len; i += 8) {
+		OsdElement el = {
+			.type = (OsdElementType)DECODE_U2(&data[i]),
+			.col = (i8)data[i + 2],
+			.row = (i8)data[i + 3],
+			.option = DECODE_U4(&data[i + 4]),
+		};
+		if (el.type != OsdElementType::DISABLED) {
+			OsdCanvas::get().setElement(elementIndex++, el);
+		}
+	}
+	return len;
+}
+
+static i32 loadOsdFont(const u8 *data, u32 len, u32 pos) {
+	// one character per loop, each is an NVM write of ~15 ms
+	if (len % 54) return -1;
+	if (pos >= len) return len;
+	AnalogOsdOutput::get().updateCharacter(pos / 54, (u8 *)&data[pos]);
+	return pos + 54;
+}
+
+static const MspTransferObject mspTransferObjects[] = {
+	{.save = saveOsdElements, .load = loadOsdElements, .maxLen = OsdCanvas::MAX_ELEMENTS * 8, .flags = MSP_CMD_ARMED}, // OSD_ELEMENTS
+	{.save = nullptr, .load = loadOsdFont, .maxLen = 256 * 54, .flags = 0}, // OSD_FONT
+};
+static_assert(ARRAYLEN(mspTransferObjects) == (u8)MspObject::COUNT, "every MspObject needs an entry, in the order of MspObject");
+static u8 mspTransferBuf[MSP_TRANSFER_BUF_SIZE];
+static MspTransfer mspTransfer(mspTransferObjects, (u8)MspObject::COUNT, mspTransferBuf, sizeof(mspTransferBuf));
+
 void configuratorLoop() {
+	mspTransfer.loop(armed);
 	if (accelCalDone) {
 		accelCalDone = false;
 		if (accelCalState == 0) {
@@ -171,9 +222,7 @@ void sendMsp(MspMsgSetup setup, const char *data, u16 len) {
 			CRC_LUT_D5_APPLY(crcV2, (u16)fn >> 8);
 			CRC_LUT_D5_APPLY(crcV2, len & 0xFF);
 			CRC_LUT_D5_APPLY(crcV2, len >> 8);
-			for (int i = 0; i < len; i++) {
-				CRC_LUT_D5_APPLY(crcV2, data[i]);
-			}
+			crcV2 = crc8D5((const u8 *)data, len, crcV2);
 		}
 		if (versionHasV1) {
 			for (int i = 3; i < pos; i++) {
@@ -195,1722 +244,1828 @@ void sendMsp(MspMsgSetup setup, const char *data, u16 len) {
 	}
 }
 
-void processMspCmd(KoliSerial &serial, MspMsgType type, MspFn fn, MspVersion version, const char *reqPayload, u16 reqLen) {
-	serial.lastMspVersion = version;
-	MspMsgSetup msgSetup = {
-		.serial = serial,
-		.fn = fn,
-		.type = MspMsgType::RESPONSE,
-		.version = version,
-	};
-	static char buf[2048];
+// MspResponse target for everything that can't be written in place
+class MspScratchTarget : public MspTxTarget {
+public:
+	virtual void txLock() override {}
+	virtual void txUnlock() override {}
+	virtual u8 *txSpan(u32 offset, u32 *len) override {
+		*len = offset < sizeof(buf) ? sizeof(buf) - offset : 0;
+		return buf + offset;
+	}
+	virtual void txPublish(u32 len) override {}
+	u8 buf[MSP_MAX_PAYLOAD];
+};
+static MspScratchTarget mspScratch;
+
+static bool mspInPlace(const MspMsgSetup &setup) {
+	return setup.version == MspVersion::V2;
+}
+
+MspResponse::MspResponse(const MspMsgSetup &setup, i32 len)
+	: MspWriter(mspInPlace(setup) ? (MspTxTarget &)setup.serial : (MspTxTarget &)mspScratch, setup.fn, setup.type, len, !mspInPlace(setup)),
+	  setup(setup) {}
+
+i32 MspResponse::finish() {
+	i32 len = MspWriter::finish();
+	if (len >= 0 && !mspInPlace(setup)) sendMsp(setup, (char *)mspScratch.buf, len);
+	return len;
+}
+
+/// @brief all handlers share this signature, MSP_COMMAND_LIST in mspRegistry.h maps the functions to them
+#define MSP_HANDLER(name) static void name(KoliSerial &serial, MspMsgSetup &msgSetup, MspVersion version, const char *reqPayload, u16 reqLen, char *buf)
+typedef void (*MspHandler)(KoliSerial &serial, MspMsgSetup &msgSetup, MspVersion version, const char *reqPayload, u16 reqLen, char *buf);
+
+MSP_HANDLER(handleApiVersion) {
 	u16 len = 0;
-	if (type == MspMsgType::REQUEST) {
-		switch (fn) {
-		case MspFn::API_VERSION:
-			buf[len++] = MSP_PROTOCOL_VERSION;
-			buf[len++] = API_VERSION_MAJOR;
-			buf[len++] = API_VERSION_MINOR;
-			sendMsp(msgSetup, buf, len);
-			break;
-		case MspFn::FIRMWARE_VARIANT:
-			sendMsp(msgSetup, KOLIBRI_IDENTIFIER, FIRMWARE_IDENTIFIER_LENGTH);
-			break;
-		case MspFn::FIRMWARE_VERSION:
-			buf[len++] = FIRMWARE_VERSION_MAJOR;
-			buf[len++] = FIRMWARE_VERSION_MINOR;
-			buf[len++] = FIRMWARE_VERSION_PATCH;
-			sendMsp(msgSetup, buf, len);
-			break;
-		case MspFn::BOARD_INFO: {
-			memcpy(&buf[len], targetIdentifier, TARGET_IDENTIFIER_LENGTH);
-			len += TARGET_IDENTIFIER_LENGTH;
-			buf[len++] = 0; // board revision
-			buf[len++] = 0;
-			buf[len++] = 2; // 2 == FC with MAX7456
-			u8 targetCapabilities = 0;
-			targetCapabilities |= 1 << 0; // VCP / CDC
-			targetCapabilities |= 0 << 1; // no soft serial
-			buf[len++] = targetCapabilities;
-			u8 targetNameLen = strlen(targetFullName);
-			buf[len++] = targetNameLen;
-			memcpy(&buf[len], targetFullName, targetNameLen);
-			len += targetNameLen;
-			sendMsp(msgSetup, buf, len);
-		} break;
-		case MspFn::BUILD_INFO:
-			memcpy(&buf[len], __DATE__, 11);
-			len += 11;
-			memcpy(&buf[len], __TIME__, 8);
-			len += 8;
-			memcpy(&buf[len], GIT_HASH, 7);
-			len += 7;
-			sendMsp(msgSetup, buf, len);
-			break;
-		case MspFn::GET_NAME: {
-			sendMsp(msgSetup, uavName.c_str(), strlen(uavName.c_str()));
-		} break;
-		case MspFn::SET_NAME: {
-			openSettingsFile();
-			uavName = string(reqPayload, reqLen);
-			getSetting(SETTING_UAV_NAME)->updateSettingInFile();
-			sendMsp(msgSetup);
-		} break;
-		case MspFn::GET_FEATURE_CONFIG: {
-			// only exists for compatibility with BLHeliSuite32
-			u32 features = 0;
-			features |= 1 << 3; // FEATURE_RX_SERIAL
-			features |= 1 << 4; // FEATURE_MOTOR_STOP
-			features |= 1 << 7; // FEATURE_GPS
-			features |= 1 << 10; // FEATURE_TELEMETRY
-			features |= 1 << 18; // FEATURE_OSD
-			features |= 1 << 22; // FEATURE_AIRMODE
-			sendMsp(msgSetup, (char *)features, len);
-		} break;
-		case MspFn::REBOOT:
-			switch (reqPayload[0]) {
-			case MSP_REBOOT_FIRMWARE:
-				sendMsp(msgSetup);
-				serial.flush();
-				sleep_ms(100);
-				rp2040.reboot();
-				break;
-			case MSP_REBOOT_BOOTLOADER_FLASH:
-			case MSP_REBOOT_BOOTLOADER_ROM:
-				sendMsp(msgSetup);
-				serial.flush();
-				sleep_ms(100);
-				rp2040.rebootToBootloader();
-				break;
-			default:
-				msgSetup.type = MspMsgType::ERROR;
-				sendMsp(msgSetup, "Invalid reboot mode");
-				break;
-			}
-			break;
-		case MspFn::GET_ADVANCED_CONFIG:
-			// only exists for compatibility with BLHeliSuite32
-			buf[len++] = 1; // gyro_sync_denom
-			buf[len++] = 1; // pid_process_denom
-			buf[len++] = 0; // useUnsyncedPwm => true if motors are updated asynchronously from the PID
-			buf[len++] = 6; // motorPwmProtocol, 6 = DShot 300
-			buf[len++] = PID_FREQ & 0xFF;
-			buf[len++] = PID_FREQ >> 8;
-			buf[len++] = (idlePermille * 10) & 0xFF;
-			buf[len++] = (idlePermille * 10) >> 8;
-			buf[len++] = 0; // gyro_use_32kHz
-			buf[len++] = 0; // motorPwmInversion
-			buf[len++] = 0; // gyro_to_use
-			buf[len++] = 0; // gyro_high_fsr (true if > 2000dps)
-			buf[len++] = GYRO_CALIBRATION_TOLERANCE;
-			buf[len++] = (CALIBRATION_SAMPLES * 100 / PID_FREQ) & 0xFF; // calibration duration in centiseconds
-			buf[len++] = (CALIBRATION_SAMPLES * 100 / PID_FREQ) >> 8;
-			buf[len++] = 0; // gyro_offset_yaw
-			buf[len++] = 0;
-			buf[len++] = 0; // checkOverflow, no overflow
-			sendMsp(msgSetup, buf, len);
-			break;
-		case MspFn::SET_ARMING_DISABLED: {
-			BREAK_WITH_BASIC_ERROR_IF(reqLen < 1);
-			if (reqPayload[0]) {
-				serial.armingDisabled = true;
-			} else {
-				serial.armingDisabled = false;
-			}
-			bool disabled = false;
-			for (int i = 0; i < SERIAL_COUNT; i++) {
-				if (!serials[i]) continue;
-				disabled = disabled || serial.armingDisabled;
-			}
-			if (disabled)
-				armingDisableFlags |= 0x80;
-			else
-				armingDisableFlags &= ~0x80;
-			sendMsp(msgSetup);
-		} break;
-		case MspFn::MSP_STATUS:
-			// only exists for compatibility with BLHeliSuite32
-			buf[len++] = (1000000 / PID_FREQ) & 0xFF;
-			buf[len++] = (1000000 / PID_FREQ) >> 8;
-			buf[len++] = 0; // I2C error count
-			buf[len++] = 0;
-			buf[len++] = 0b101111; // gyro, no rangefinder, gps, mag, baro, accel
-			buf[len++] = 0; // no other sensors
-			buf[len++] = armed ? 1 : 0; // flight mode flags
-			buf[len++] = 0;
-			buf[len++] = 0;
-			buf[len++] = 0;
-			buf[len++] = 0; // PID profile index
-			buf[len++] = 0; // CPU load (%)
-			buf[len++] = 0; // gyro cycle time
-			buf[len++] = 0;
-			buf[len++] = 0; // how many more flight mode flags follow
-			buf[len++] = 7; // arming disable flags count
-			buf[len++] = armingDisableFlags;
-			buf[len++] = armingDisableFlags >> 8;
-			buf[len++] = armingDisableFlags >> 16;
-			buf[len++] = armingDisableFlags >> 24;
-			buf[len++] = 0; // config state flags, e.g. reboot required
-			sendMsp(msgSetup, buf, len);
-			break;
-		case MspFn::MSP_RAW_IMU: {
-			buf[len++] = accelAligned[0] & 0xFF; // accel x
-			buf[len++] = accelAligned[0] >> 8;
-			buf[len++] = accelAligned[1] & 0xFF; // accel y
-			buf[len++] = accelAligned[1] >> 8;
-			buf[len++] = accelAligned[2] & 0xFF; // accel z
-			buf[len++] = accelAligned[2] >> 8;
-			i16 gyroX = gyroScaled[0].geti32(); // gyro x
-			i16 gyroY = gyroScaled[1].geti32(); // gyro y
-			i16 gyroZ = gyroScaled[2].geti32(); // gyro z
-			buf[len++] = gyroX & 0xFF;
-			buf[len++] = gyroX >> 8;
-			buf[len++] = gyroY & 0xFF;
-			buf[len++] = gyroY >> 8;
-			buf[len++] = gyroZ & 0xFF;
-			buf[len++] = gyroZ >> 8;
-			buf[len++] = magData[0] & 0xFF; // mag x
-			buf[len++] = magData[0] >> 8;
-			buf[len++] = magData[1] & 0xFF; // mag y
-			buf[len++] = magData[1] >> 8;
-			buf[len++] = magData[2] & 0xFF; // mag z
-			buf[len++] = magData[2] >> 8;
-			sendMsp(msgSetup, buf, len);
-		} break;
-		case MspFn::GET_MOTOR: {
-			u16 motors[8];
-			for (int i = 0; i < 4; i++) {
-				motors[i] = throttles[i] / 2 + 1000;
-			}
-			for (int i = 4; i < 8; i++) {
-				motors[i] = 0;
-			}
-			memcpy(buf, motors, 16);
-			sendMsp(msgSetup, buf, 16);
-		} break;
-		case MspFn::RC: {
-			u16 channels[16];
-			for (int i = 0; i < 16; i++)
-				channels[i] = elrs ? elrs->channels[i] : 0;
-			memcpy(buf, channels, 32);
-			sendMsp(msgSetup, buf, 32);
-		} break;
-		case MspFn::MSP_ATTITUDE: {
-			// not used by Kolibri configurator, that uses GET_ROTATION
-			i16 rollInt = (-roll * (FIX_RAD_TO_DEG * 10)).geti32(); // decidegrees
-			i16 pitchInt = (pitch * (FIX_RAD_TO_DEG * 10)).geti32(); // decidegrees
-			i16 yawInt = (combinedHeading * FIX_RAD_TO_DEG).geti32(); // degrees
-			buf[len++] = rollInt & 0xFF;
-			buf[len++] = rollInt >> 8;
-			buf[len++] = pitchInt & 0xFF;
-			buf[len++] = pitchInt >> 8;
-			buf[len++] = yawInt & 0xFF;
-			buf[len++] = yawInt >> 8;
-			sendMsp(msgSetup, buf, len);
-		} break;
-		case MspFn::MSP_ALTITUDE: {
-			i32 altitudeInt = combinedAltitude.raw / 656; // fix32 raw (m) to cm
-			buf[len++] = altitudeInt & 0xFF;
-			buf[len++] = altitudeInt >> 8;
-			buf[len++] = altitudeInt >> 16;
-			buf[len++] = altitudeInt >> 24;
-			buf[len++] = 0; // vario
-			buf[len++] = 0; // vario
-			sendMsp(msgSetup, buf, len);
-		} break;
-		case MspFn::MSP_ANALOG: {
-			u8 voltage = adcVoltage / 10; // dV
-			u16 current = adcCurrent * 100; // cA
-			u16 mAh = 0; // mW
-			u16 rssi = elrs->uplinkLinkQuality * 10; // 0-1000, 1000 = 100%
-			buf[len++] = voltage;
-			buf[len++] = current & 0xFF;
-			buf[len++] = current >> 8;
-			buf[len++] = mAh & 0xFF;
-			buf[len++] = mAh >> 8;
-			buf[len++] = rssi & 0xFF;
-			buf[len++] = rssi >> 8;
-			sendMsp(msgSetup, buf, len);
-		} break;
-		case MspFn::BOXIDS:
-			// only exists for compatibility with BLHeliSuite32
-			sendMsp(msgSetup);
-			break;
-		case MspFn::GET_MOTOR_3D_CONFIG:
-			buf[len++] = 1450 & 0xFF; // deadband low
-			buf[len++] = 1450 >> 8;
-			buf[len++] = 1550 & 0xFF; // deadband high
-			buf[len++] = 1550 >> 8;
-			buf[len++] = 1500 & 0xFF; // neutral
-			buf[len++] = 1500 >> 8;
-			sendMsp(msgSetup, buf, len);
-			break;
-		case MspFn::MSP_BATTERY_STATE:
-			buf[len++] = batCells;
-			buf[len++] = 0; // battery capacity
-			buf[len++] = 0;
-			buf[len++] = (adcVoltage + 5) / 10; // voltage in 0.1V steps :/
-			buf[len++] = 0; // mAh drawn
-			buf[len++] = 0;
-			buf[len++] = 0; // amps in 0.01A steps
-			buf[len++] = 0;
-			buf[len++] = batState == 0 ? 4 : 0; // 4 = init, 0 = ok
-			buf[len++] = adcVoltage;
-			buf[len++] = adcVoltage >> 8;
-			sendMsp(msgSetup, buf, len);
-		case MspFn::GET_MOTOR_CONFIG:
-			buf[len++] = (1000 + idlePermille) & 0xFF; // min throttle
-			buf[len++] = (1000 + idlePermille) >> 8;
-			buf[len++] = 2000 & 0xFF; // max throttle
-			buf[len++] = 2000 >> 8;
-			buf[len++] = 1000 & 0xFF; // min command
-			buf[len++] = 1000 >> 8;
-			buf[len++] = 4; // motor count
-			buf[len++] = MOTOR_POLES;
-			buf[len++] = 1; // use dshot telemetry
-			buf[len++] = 0; // esc sensor
-			sendMsp(msgSetup, buf, len);
-			break;
-		case MspFn::UID: {
-			const char *chipId = rp2040.getChipID();
-			memcpy(buf, chipId, 12);
-			sendMsp(msgSetup, buf, 12);
-		} break;
-		case MspFn::MSP_DISPLAYPORT:
-			// MSP_DISPLAYPORT is just responses without a request
-			break;
-		case MspFn::MSP_SET_OSD_CANVAS: {
-			BREAK_WITH_BASIC_ERROR_IF(reqLen < 2 || reqPayload[0] > 192 || reqPayload[1] > 192);
-			MspOsdOutput *dp = serial.getDp();
-			if (dp != nullptr) {
-				dp->setSize(reqPayload[0], reqPayload[1]);
-			}
-			sendMsp(msgSetup);
-		} break;
-		case MspFn::MSP_GET_OSD_CANVAS:
-			OsdCanvas::get().getSize((u8 *)&buf[0], (u8 *)&buf[1]);
-			sendMsp(msgSetup, buf, 2);
-			break;
-		case MspFn::ACC_CALIBRATION:
-			startAccelCalibration();
-			sendMsp(msgSetup, buf, 1);
-			break;
-		case MspFn::MAG_CALIBRATION:
-			magStateAfterRead = MagState::CALIBRATE;
-			sendMsp(msgSetup, buf, 1);
-			snprintf(buf, 32, "Offsets: %d %d %d", magOffset[0], magOffset[1], magOffset[2]);
-			msgSetup.fn = MspFn::IND_MESSAGE;
-			sendMsp(msgSetup, buf, strlen(buf));
-			break;
-		case MspFn::SET_MOTOR:
-			if (!armed) {
-				throttles[(u8)MOTOR::RR] = ((u16)reqPayload[0] + ((u16)reqPayload[1] << 8)) * 2 - 2000;
-				throttles[(u8)MOTOR::FR] = ((u16)reqPayload[2] + ((u16)reqPayload[3] << 8)) * 2 - 2000;
-				throttles[(u8)MOTOR::RL] = ((u16)reqPayload[4] + ((u16)reqPayload[5] << 8)) * 2 - 2000;
-				throttles[(u8)MOTOR::FL] = ((u16)reqPayload[6] + ((u16)reqPayload[7] << 8)) * 2 - 2000;
-			}
-			mspOverrideMotors = 0;
-			sendMsp(msgSetup);
-			break;
-		case MspFn::ENABLE_4WAY_IF:
-			begin4Way(&serial);
-			buf[0] = 4; // ESC count
-			sendMsp(msgSetup, buf, 1);
-			break;
-		case MspFn::SET_RTC: {
-			BREAK_WITH_BASIC_ERROR_IF(reqLen < 6);
-			const struct timespec t = {
-				.tv_sec = DECODE_U4((u8 *)reqPayload),
-				.tv_nsec = DECODE_U2((u8 *)&reqPayload[4]) * 1000000, // convert millis to nanoseconds
-			};
-			rtcSetTime(&t, TIME_QUALITY_MSP);
-			sendMsp(msgSetup);
-		} break;
-		case MspFn::GET_RTC: {
-			struct tm tm;
-			struct timespec ts;
-			rtcGetTime(&ts, true);
-			rtcConvertToTm(&ts, &tm);
-			buf[0] = tm.tm_year & 0xFF;
-			buf[1] = tm.tm_year >> 8;
-			buf[2] = tm.tm_mon;
-			buf[3] = tm.tm_mday;
-			buf[4] = tm.tm_hour;
-			buf[5] = tm.tm_min;
-			buf[6] = tm.tm_sec;
-			u16 millis = ts.tv_nsec / 1000000;
-			buf[7] = millis & 0xFF; // millis
-			buf[8] = millis >> 8; // millis
-			sendMsp(msgSetup, buf, 9);
-		} break;
-		case MspFn::STATUS: {
-			u16 voltage = adcVoltage;
-			buf[len++] = voltage & 0xFF;
-			buf[len++] = voltage >> 8;
-			buf[len++] = armed;
-			buf[len++] = (u8)flightMode;
-			buf[len++] = (u8)(armingDisableFlags & 0xFF);
-			buf[len++] = (u8)(armingDisableFlags >> 8);
-			buf[len++] = (u8)(armingDisableFlags >> 16);
-			buf[len++] = (u8)(armingDisableFlags >> 24);
-			sendMsp(msgSetup, buf, len);
-		} break;
-		case MspFn::CONFIGURATOR_PING:
-			lastConfigPingRx = 0;
-			sendMsp(msgSetup, reqPayload, reqLen);
-			break;
-		case MspFn::SERIAL_PASSTHROUGH: {
-			u8 fromNum = 255;
-			if (reqLen > 5) {
-				fromNum = reqPayload[5];
-				BREAK_WITH_BASIC_ERROR_IF(fromNum >= SERIAL_COUNT || !serials[fromNum]);
-			}
-			BREAK_WITH_BASIC_ERROR_IF(reqPayload[0] >= SERIAL_COUNT || !serials[reqPayload[0]] || armed);
-
-			KoliSerial &from = fromNum == 255 ? serial : *serials[fromNum];
-			KoliSerial &to = *serials[reqPayload[0]];
-			u32 baud = DECODE_U4((u8 *)&reqPayload[1]);
-			sendMsp(msgSetup, (char *)reqPayload, 5);
-			serial.flush();
-
-			u8 plusCount = 0;
-			elapsedMillis breakoutCounter = 0;
-			to.end();
-			to.begin(baud);
-			while (true) {
-				if (breakoutCounter > 1000 && plusCount >= 3) break;
-				if (from.available()) {
-					breakoutCounter = 0;
-
-					char c = from.read();
-					if (c == '+')
-						plusCount++;
-					else
-						plusCount = 0;
-					to.write(c);
-				}
-				if (to.available()) {
-					from.write(to.read());
-				}
-				from.loop();
-				to.loop();
-				rp2040.wdt_reset();
-			}
-		} break;
-		case MspFn::SERIAL_SNIFF: {
-			// sniffing forwards all bytes to the host, but does not allow communication the other way round
-			KoliSerial &to = serial;
-
-			u8 plusCount = 0;
-			elapsedMillis breakoutCounter = 0;
-
-			sendMsp(msgSetup);
-
-			while (true) {
-				if (breakoutCounter > 1000 && plusCount >= 3) break;
-				int c = to.read();
-				if (c != -1) {
-					breakoutCounter = 0;
-					if (c == '+')
-						plusCount++;
-					else
-						plusCount = 0;
-				}
+	buf[len++] = MSP_PROTOCOL_VERSION;
+	buf[len++] = API_VERSION_MAJOR;
+	buf[len++] = API_VERSION_MINOR;
+	sendMsp(msgSetup, buf, len);
+}
 
-				for (int i = 0; i < reqLen; i++) {
-					u8 num = reqPayload[i];
-					if (num >= SERIAL_COUNT) continue; // invalid request
-					auto &from = serials[num];
-					if (!from) continue; // if disabled
-					if (!*from) continue; // if not running
-					if (&*from == &to) continue; // no feeding back
-					c = from->read();
-					if (c != -1) {
-						for (int j = 0; j < i; j++) {
-							to.print("\t\t");
-						}
-						to.printf("%3d %02X %c\n", c, c, c);
-					}
-					from->loop();
-				}
-				to.loop();
-				to.flush();
-				rp2040.wdt_reset();
-			}
-		} break;
-		case MspFn::CLI_INIT: {
-			// send start info
-			snprintf(buf, 256, FIRMWARE_NAME " v" FIRMWARE_VERSION_STRING "\n%s => %s\nType 'help' to get a list of commands" CLI_PROMPT, targetIdentifier, targetFullName);
-			openSettingsFile();
-			sendMsp(msgSetup, buf, strlen(buf));
-		} break;
-		case MspFn::CLI_COMMAND: {
-			string total = string(reqPayload, reqLen);
-			string cmdName = total;
-			string payload = "";
-			size_t spaceIndex = cmdName.find(' ');
-			if (spaceIndex != string::npos) {
-				payload = cmdName.substr(spaceIndex + 1);
-				cmdName = cmdName.substr(0, spaceIndex);
-			}
+MSP_HANDLER(handleFirmwareVariant) {
+	sendMsp(msgSetup, KOLIBRI_IDENTIFIER, FIRMWARE_IDENTIFIER_LENGTH);
+}
 
-			Command *cmd = Command::getCommandByName(cmdName);
-			if (Command::activeLoopCommand && Command::activeLoopCommand->getSerial() == &serial) {
-				Command::activeLoopCommand->input(total);
-			} else {
-				string response = CLI_COLOR_WHITE + string(reqPayload, reqLen) + "\n";
-				sendMsp(msgSetup, response.c_str(), response.length());
-				if (cmd) {
-					cmd->execute(payload, &serial);
-				} else {
-					snprintf(buf, 256, CLI_COLOR_RED "Unknown command: %s\n" CLI_COLOR_WHITE, cmdName.c_str());
-					sendMsp(msgSetup, buf, strlen(buf));
-				}
-			}
+MSP_HANDLER(handleFirmwareVersion) {
+	u16 len = 0;
+	buf[len++] = FIRMWARE_VERSION_MAJOR;
+	buf[len++] = FIRMWARE_VERSION_MINOR;
+	buf[len++] = FIRMWARE_VERSION_PATCH;
+	sendMsp(msgSetup, buf, len);
+}
 
-			if (!Command::activeLoopCommand) {
-				string response = CLI_PROMPT;
-				sendMsp(msgSetup, response.c_str(), response.length());
-			}
-		} break;
-		case MspFn::CLI_GET_SUGGESTION: {
-			if (reqLen == 0) {
-				msgSetup.type = MspMsgType::ERROR;
-				sendMsp(msgSetup);
-				break;
-			}
-			if (Command::activeLoopCommand) return sendMsp(msgSetup, reqPayload, 1);
-			std::vector<string> suggestions;
-			getCliSuggestions(string(reqPayload + 1, reqLen - 1), suggestions);
-			string response;
-			response = reqPayload[0]; // sequence byte
-			for (size_t i = 0; i < suggestions.size(); i++) {
-				const string &s = suggestions[i];
-				if (response.length() + s.length() + 1 >= 479) {
-					break;
-				}
-				if (i > 0) {
-					response += '\n';
-				}
-				response += s;
-			}
-			sendMsp(msgSetup, response.c_str(), response.length());
-		} break;
-		case MspFn::CLI_ABORT_COMMAND:
-			if (Command::activeLoopCommand) {
-				Command::activeLoopCommand->abort();
-				Command::activeLoopCommand = nullptr;
-			}
-			sendMsp(msgSetup);
-			break;
-		case MspFn::CLI_CHECK_RUNNING:
-			buf[0] = Command::activeLoopCommand ? 1 : 0;
-			sendMsp(msgSetup, buf, 1);
-			break;
-		case MspFn::SAVE_SETTINGS:
-			closeSettingsFile();
-			sendMsp(msgSetup);
-			break;
-		case MspFn::WRITE_OSD_FONT_CHARACTER:
-			BREAK_WITH_BASIC_ERROR_IF(reqLen < 55);
-			AnalogOsdOutput::get().updateCharacter(reqPayload[0], (u8 *)&reqPayload[1]);
-			sendMsp(msgSetup, reqPayload, 1);
-			break;
-		case MspFn::SET_OSD_ELEMENTS: {
-			BREAK_WITH_BASIC_ERROR_IF(reqLen < 1 || reqLen % 8 != 1);
-			static u32 elementIndex = 0;
-			const char *data = &reqPayload[1];
-			if (reqPayload[0] == 0) { // initial element index
-				OsdCanvas::get().resetElements();
-				elementIndex = 0;
-			}
-			for (int i = 0; i < (reqLen - 1) / 8; i++) {
-				OsdElement el = {
-					.type = (OsdElementType)DECODE_U2(&data[0]),
-					.col = (i8)data[2],
-					.row = (i8)data[3],
-					.option = DECODE_U4((const u8 *)&data[4]),
-				};
-				if (el.type != OsdElementType::DISABLED) {
-					OsdCanvas::get().setElement(elementIndex++, el);
-				}
-				data += 8;
-			}
-			buf[0] = reqPayload[0];
-			sendMsp(msgSetup, buf, 1);
-		} break;
-		case MspFn::GET_OSD_ELEMENTS: {
-			u8 initial = 0;
-			if (reqLen) initial = reqPayload[0];
-			buf[len++] = initial;
-			buf[len++] = OsdCanvas::MAX_ELEMENTS - initial > 60; // whether there will be more chunks
-			for (int i = 0; i < 60; i++) {
-				if (i + initial >= OsdCanvas::MAX_ELEMENTS) break;
-				const OsdElement &el = OsdCanvas::get().getElement(i + initial);
-				u16 type = (u16)el.type;
-				buf[len++] = type;
-				buf[len++] = type >> 8;
-				buf[len++] = el.col;
-				buf[len++] = el.row;
-				memcpy(&buf[len], &el.option, 4);
-				len += 4;
-			}
-			sendMsp(msgSetup, buf, len);
-		} break;
-		case MspFn::GET_OSD_CONFIG: {
-			buf[0] = osdCanvasSizeSrc;
-			sendMsp(msgSetup, buf, 1);
-		} break;
-		case MspFn::SET_OSD_CONFIG: {
-			BREAK_WITH_BASIC_ERROR_IF(reqLen < 1);
-			if (reqPayload[0] < 4) osdCanvasSizeSrc = reqPayload[0];
-			getSetting(SETTING_OSD_CANVAS_SIZE_SRC)->updateSettingInFile();
-			switch (osdCanvasSizeSrc) {
-			case 0: { // analog auto
-				u8 width, height;
-				AnalogOsdOutput::get().getSize(&width, &height);
-				OsdCanvas::get().setSize(width, height, 0);
-			} break;
-			case 1: { // analog PAL
-				OsdCanvas::get().setSize(OSD_WIDTH_PAL_NTSC, OSD_HEIGHT_PAL, 1);
-			} break;
-			case 2: { // analog NTSC
-				OsdCanvas::get().setSize(OSD_WIDTH_PAL_NTSC, OSD_HEIGHT_NTSC, 2);
-			} break;
-			case 3: { // digital
-				OsdCanvas::get().setSize(MSP_DP_DEFAULT_WIDTH, MSP_DP_DEFAULT_HEIGHT, 3);
-				for (auto &serial : serials) {
-					if (!serial) continue;
-					if (!serial->getDp()) continue;
-					serial->getDp()->propagateSize();
-				}
-			} break;
-			}
-			sendMsp(msgSetup);
-		} break;
-		case MspFn::OSD_CONTROL: {
-			BREAK_WITH_BASIC_ERROR_IF(reqLen < 1);
-			switch (reqPayload[0]) {
-			case 0:
-				// add function MSP_DP to this serial
-				serial.setFunctionBits(SERIAL_MSP_DISPLAYPORT);
-				sendMsp(msgSetup);
-				break;
-			case 1:
-				// remove function MSP_DP from this serial
-				serial.clearFunctionBits(SERIAL_MSP_DISPLAYPORT);
-				sendMsp(msgSetup);
-				break;
-			case 2:
-				// revert OSD setup to what it was before (moving tabs without saving)
-				OsdCanvas::get().revertElements();
-				sendMsp(msgSetup);
-				break;
-			case 3:
-				// optimize and save (requires fetching the setup again)
-				OsdCanvas::get().saveElements();
-				sendMsp(msgSetup);
-				break;
-			case 4:
-				// draw cursor
-				BREAK_WITH_BASIC_ERROR_IF(reqLen < 2);
-				OsdCanvas::get().drawCursor(reqPayload[1], reqPayload[2]);
-				sendMsp(msgSetup);
-				break;
-			case 5:
-				// set drag and drop
-				BREAK_WITH_BASIC_ERROR_IF(reqLen < 5 || reqLen != reqPayload[3] * reqPayload[4] + 5);
-				OsdCanvas::get().setDragNDrop(reqPayload + 5, (i8)reqPayload[1], (i8)reqPayload[2], reqPayload[3], reqPayload[4]);
-				sendMsp(msgSetup);
-			}
-		} break;
-		case MspFn::GET_OSD_STATUS: {
-			// bit 0: Analog OSD module detected
-			// bit 1: Analog OSD detected PAL
-			// bit 2: Analog OSD detected NTSC
-			buf[0] = 0;
-			if (AnalogOsdOutput::get().devDetected()) buf[0] |= 1 << 0;
-			if (AnalogOsdOutput::get().isPal()) buf[0] |= 1 << 1;
-			if (AnalogOsdOutput::get().isNtsc()) buf[0] |= 1 << 2;
-			// bitmap: At least one MSP message came from a serial within the last second
-			buf[1] = 0;
-			for (int i = 0; i < SERIAL_COUNT; i++) {
-				auto &serial = serials[i];
-				if (!serial) continue;
-				if (!(serial->functions() & (SERIAL_MSP | SERIAL_MSP_DISPLAYPORT))) continue;
-				if (serial->mspParser().getMessageCounter()) {
-					buf[1] |= 1 << i;
-				}
-			}
-			sendMsp(msgSetup, buf, 2);
-		} break;
-		case MspFn::GET_BB_SETTINGS: {
-#ifdef BLACKBOX_STORAGE
-			u8 bbSettings[10];
-			bbSettings[0] = bbFreqDivider;
-			bbSettings[9] = bbSyncFreq;
-			memcpy(&bbSettings[1], &bbFlags, 8);
-			sendMsp(msgSetup, (char *)bbSettings, sizeof(bbSettings));
-#else
-			msgSetup.type = MspMsgType::ERROR;
-			sendMsp(msgSetup);
-#endif
-		} break;
-		case MspFn::SET_BB_SETTINGS: {
-#ifdef BLACKBOX_STORAGE
-			bbFreqDivider = reqPayload[0];
-			bbSyncFreq = reqPayload[9];
-			memcpy(&bbFlags, &reqPayload[1], 8);
-			sendMsp(msgSetup);
-			openSettingsFile();
-			getSetting(SETTING_BB_DIV)->updateSettingInFile();
-			getSetting(SETTING_BB_FLAGS)->updateSettingInFile();
-			getSetting(SETTING_BB_SYNC)->updateSettingInFile();
-#else
-			msgSetup.type = MspMsgType::ERROR;
-			sendMsp(msgSetup);
-#endif
-		} break;
-		case MspFn::BB_FILE_LIST: {
-#ifdef BLACKBOX_STORAGE
-			int i = 0;
-			u16 b[500];
-#if BLACKBOX_STORAGE == SD_BB
-			FsFile dir = bbFs.open("/blackbox");
-			FsFile file;
-			while (file.openNext(&dir)) {
-				if (file.isFile()) {
-					char path[32];
-					file.getName(path, 32);
-					String name = path;
-					if (!name.startsWith("KOLI") || !name.endsWith(".kbb")) {
-						continue;
-					}
-					if (name.length() != 12) {
-						continue;
-					}
-					char num[5];
-					name.substring(4, 8).toCharArray(num, 5);
-					u32 index = 0;
-					for (int j = 0; j < 4; j++) {
-						if (num[j] < '0' || num[j] > '9') {
-							index = 99999;
-						}
-						index = index * 10 + (num[j] - '0');
-					}
-					if (index < 10000) {
-						b[i++] = index;
-					}
-				}
-				if (i >= 500) {
-					break;
-				}
-			}
-#elif BLACKBOX_STORAGE == FLASH_BB
-			int max = bbFs.getNewBbFileNum();
-			for (int j = 0; j < max; j++) {
-				if (bbFs.exists(j)) {
-					b[i++] = j;
-				}
-			}
-#endif // write nums into b
-			sendMsp(msgSetup, (const char *)b, i * 2);
-#else // #ifdef BLACKBOX_STORAGE
-			sendMsp(msgSetup);
-#endif // #ifdef BLACKBOX_STORAGE
-		} break;
-		case MspFn::BB_FILE_INFO: {
-#ifdef BLACKBOX_STORAGE
-			/* data of command
-			 * 0...len-1: file numbers (LE 2 bytes each)
-			 *
-			 * data of response
-			 * 0-1: file number
-			 * 2-5: file size in bytes
-			 * 6-8: version of bb file format
-			 * 9-12: time of recording start
-			 * 13-16: duration in ms
-			 */
-			u8 len = reqLen / 2;
-			len = len > 15 ? 15 : len;
-			u16 fileNums[len];
-			memcpy(fileNums, reqPayload, len * 2);
-			u8 buffer[17 * len];
-			u8 index = 0;
-			for (int i = 0; i < len; i++) {
-				rp2040.wdt_reset();
-				u16 fileNum = fileNums[i];
-#if BLACKBOX_STORAGE == SD_BB
-				char path[32];
-				snprintf(path, 32, "/blackbox/KOLI%04d.kbb", fileNum);
-				FsFile logFile = bbFs.open(path);
-#elif BLACKBOX_STORAGE == FLASH_BB
-				FlashFile logFile = bbFs.open(fileNum);
-#endif
-				if (!logFile) {
-					buffer[index++] = fileNum;
-					buffer[index++] = fileNum >> 8;
-					// print all zeros to indicate broken file
-					for (int i = 0; i < 15; i++)
-						buffer[index++] = 0;
-				} else {
-					buffer[index++] = fileNum;
-					buffer[index++] = fileNum >> 8;
-					buffer[index++] = logFile.size() & 0xFF;
-					buffer[index++] = (logFile.size() >> 8) & 0xFF;
-					buffer[index++] = (logFile.size() >> 16) & 0xFF;
-					buffer[index++] = (logFile.size() >> 24) & 0xFF;
-					logFile.seek(LOG_HEAD_BB_VERSION);
-					// version, timestamp, pid and divider can directly be read from the file
-					for (int i = 0; i < 7; i++)
-						buffer[index++] = logFile.read();
-					logFile.seek(LOG_HEAD_DURATION);
-					for (int i = 0; i < 4; i++)
-						buffer[index++] = logFile.read();
-					logFile.close();
-				}
-			}
-			sendMsp(msgSetup, (char *)buffer, index);
-#else
-			msgSetup.type = MspMsgType::ERROR;
-			sendMsp(msgSetup);
-#endif
-		} break;
-		case MspFn::BB_FILE_DOWNLOAD: {
-#ifdef BLACKBOX_STORAGE
-			u16 fileNum = DECODE_U2((u8 *)&reqPayload[0]);
-			i32 chunkNum = -1;
-			if (reqLen >= 6) {
-				chunkNum = DECODE_I4((u8 *)&reqPayload[2]);
-			}
-			printLogBin(serial, version, fileNum, chunkNum);
-#else
-			msgSetup.type = MspMsgType::ERROR;
-			sendMsp(msgSetup);
-#endif
-		} break;
-		case MspFn::BB_FILE_DELETE: {
-#ifdef BLACKBOX_STORAGE
-			// data just includes one byte of file number
-			u16 fileNum = DECODE_U2((u8 *)&reqPayload[0]);
-#if BLACKBOX_STORAGE == SD_BB
-			char path[32];
-			snprintf(path, 32, "/blackbox/KOLI%04d.kbb", fileNum);
-			if (bbFs.remove(path))
-#elif BLACKBOX_STORAGE == FLASH_BB
-			if (bbFs.remove(fileNum))
-#endif // if (remove)
-				sendMsp(msgSetup, (char *)&fileNum, 2);
-			else
-				msgSetup.type = MspMsgType::ERROR;
-			sendMsp(msgSetup, (char *)&fileNum, 2);
-#else // #ifdef BLACKBOX_STORAGE
-			msgSetup.type = MspMsgType::ERROR;
-			sendMsp(msgSetup);
-#endif // #ifdef BLACKBOX_STORAGE
-		} break;
-		case MspFn::BB_FORMAT:
-#ifdef BLACKBOX_STORAGE
-			if (clearBlackbox())
-				sendMsp(msgSetup);
-			else
-				msgSetup.type = MspMsgType::ERROR;
-			sendMsp(msgSetup);
-#else
-			msgSetup.type = MspMsgType::ERROR;
-			sendMsp(msgSetup);
-#endif
-			break;
-		case MspFn::BB_FILE_INIT: {
-#ifdef BLACKBOX_STORAGE
-			BREAK_WITH_BASIC_ERROR_IF(reqLen < 2);
-			u16 fileNum = DECODE_U2((u8 *)&reqPayload[0]);
-			printFileInit(serial, version, fileNum);
-#else
-			msgSetup.type = MspMsgType::ERROR;
-			sendMsp(msgSetup);
-#endif
-		} break;
-		case MspFn::BB_FAST_FILE_INIT: {
-#ifdef BLACKBOX_STORAGE
-			BREAK_WITH_BASIC_ERROR_IF(reqLen < 3);
-			u16 fileNum = DECODE_U2((u8 *)&reqPayload[0]);
-			u8 subCmd = reqPayload[2];
-			printFastFileInit(serial, version, fileNum, subCmd, reqPayload + 3, reqLen - 3);
-#else
-			msgSetup.type = MspMsgType::ERROR;
-			sendMsp(msgSetup);
-#endif
-		} break;
-		case MspFn::BB_FAST_DATA_REQ: {
-#ifdef BLACKBOX_STORAGE
-			/**
-			 * params:
-			 * - request identifier 2 byte (sequence number)
-			 * - file number to avoid confusion 2 byte
-			 * - size of regular frame 1 byte
-			 * - array of the following (length defines how many response frames are wanted)
-			 *   - requested frame number 4 byte
-			 *   - bitmask of what parts of that frame are wanted 1 byte
-			 *   - last sync pos before 4 byte
-			 */
-			BREAK_WITH_BASIC_ERROR_IF(reqLen < 5);
-			u16 sequenceNum = DECODE_U2((u8 *)&reqPayload[0]);
-			u16 fileNum = DECODE_U2((u8 *)&reqPayload[2]);
-			u8 frameSize = reqPayload[4];
-			printFastDataReq(serial, version, sequenceNum, fileNum, frameSize, reqPayload + 5, reqLen - 5);
-#else
-			msgSetup.type = MspMsgType::ERROR;
-			sendMsp(msgSetup);
-#endif
-		} break;
-		case MspFn::BB_CLOSE_FILE: {
-#ifdef BLACKBOX_STORAGE
-			bbClosePrintFile(serial, version);
-#else
-			msgSetup.type = MspMsgType::ERROR;
-			sendMsp(msgSetup);
-#endif
-		} break;
-		case MspFn::GET_GPS_STATUS:
-			buf[0] = gpsStatus.gpsInited;
-			buf[1] = gpsStatus.initStep;
-			buf[2] = gpsStatus.fixType;
-			buf[3] = gpsStatus.timeValidityFlags;
-			buf[4] = gpsStatus.flags;
-			buf[5] = gpsStatus.flags2;
-			buf[6] = gpsStatus.flags3 & 0xFF;
-			buf[7] = gpsStatus.flags3 >> 8;
-			buf[8] = gpsStatus.satCount;
-			sendMsp(msgSetup, buf, 9);
-			break;
-		case MspFn::GET_GPS_ACCURACY:
-			// through padding and compiler optimization, it is not possible to just memcpy the struct
-			memcpy(buf, &gpsAcc.tAcc, 4);
-			memcpy(&buf[4], &gpsAcc.hAcc, 4);
-			memcpy(&buf[8], &gpsAcc.vAcc, 4);
-			memcpy(&buf[12], &gpsAcc.sAcc, 4);
-			memcpy(&buf[16], &gpsAcc.headAcc, 4);
-			memcpy(&buf[20], &gpsAcc.pDop, 4);
-			sendMsp(msgSetup, buf, 24);
-			break;
-		case MspFn::GET_GPS_TIME:
-			buf[0] = gpsTime.tm_year & 0xFF;
-			buf[1] = gpsTime.tm_year >> 8;
-			buf[2] = gpsTime.tm_mon;
-			buf[3] = gpsTime.tm_mday;
-			buf[4] = gpsTime.tm_hour;
-			buf[5] = gpsTime.tm_min;
-			buf[6] = gpsTime.tm_sec;
-			sendMsp(msgSetup, buf, 7);
-			break;
-		case MspFn::GET_GPS_MOTION: {
-			memcpy(buf, &gpsMotion.lat, 4);
-			memcpy(&buf[4], &gpsMotion.lon, 4);
-			memcpy(&buf[8], &gpsMotion.alt, 4);
-			memcpy(&buf[12], &gpsMotion.velN, 4);
-			memcpy(&buf[16], &gpsMotion.velE, 4);
-			memcpy(&buf[20], &gpsMotion.velD, 4);
-			memcpy(&buf[24], &gpsMotion.gSpeed, 4);
-			memcpy(&buf[28], &gpsMotion.headMot, 4);
-			memcpy(&buf[32], &combinedAltitude.raw, 4);
-			memcpy(&buf[36], &vVel.raw, 4);
-			sendMsp(msgSetup, buf, 40);
-		} break;
-		case MspFn::GET_MAG_DATA: {
-			i16 raw[6] = {(i16)magData[0], (i16)magData[1], (i16)magData[2], (i16)magRight.geti32(), (i16)magFront.geti32(), (i16)(magHeading * FIX_RAD_TO_DEG).geti32()};
-			sendMsp(msgSetup, (char *)raw, sizeof(raw));
-		} break;
-		case MspFn::GET_BARO_DATA: {
-			i32 raw[4] = {
-				(i32)(baroASL.raw / 66),
-				(i32)(baroPres * 1000),
-				(i32)(baroTemp * 100),
-				pressureRaw};
-			sendMsp(msgSetup, (char *)raw, sizeof(raw));
-		} break;
-		case MspFn::GET_ROTATION: {
-			// https://en.wikipedia.org/wiki/Conversion_between_quaternions_and_Euler_angles
-			int rotationRoll = roll.raw >> 3;
-			int rotationPitch = pitch.raw >> 3;
-			int rotationYaw = yaw.raw >> 3;
-			int heading = combinedHeading.raw >> 3;
-			buf[0] = rotationRoll & 0xFF;
-			buf[1] = rotationRoll >> 8;
-			buf[2] = rotationPitch & 0xFF;
-			buf[3] = rotationPitch >> 8;
-			buf[4] = rotationYaw & 0xFF;
-			buf[5] = rotationYaw >> 8;
-			buf[6] = heading & 0xFF;
-			buf[7] = heading >> 8;
-			sendMsp(msgSetup, buf, 8);
-		} break;
-		case MspFn::GET_IMU_SETUP_STATE: {
-			buf[0] = imuAlignmentStep;
-			buf[1] = imuAlignmentCounter * 100 / PID_FREQ;
-			getImuAlignment((u8 *)&buf[2]);
-			buf[5] = accelCalState;
-			buf[6] = HW_GYRO;
-			buf[7] = gyroReadyFlags;
-			sendMsp(msgSetup, buf, 8);
-		} break;
-		case MspFn::START_IMU_ALIGNMENT: {
-			startImuAlignment();
-			sendMsp(msgSetup);
-		} break;
-		case MspFn::TASK_STATUS: {
-			u32 *buf2 = (u32 *)buf;
-			for (int i = 0; i < TASK_LENGTH; i++) {
-				buf2[i * 7 + 0] = tasks[i].debugInfo;
-				buf2[i * 7 + 1] = tasks[i].minMaxDuration;
-				buf2[i * 7 + 2] = tasks[i].frequency;
-				buf2[i * 7 + 3] = tasks[i].lastTotalDuration;
-				buf2[i * 7 + 4] = tasks[i].errorCount;
-				buf2[i * 7 + 5] = tasks[i].lastError;
-				buf2[i * 7 + 6] = tasks[i].maxGap;
-			}
-			sendMsp(msgSetup, buf, TASK_LENGTH * 7 * 4);
-			for (int i = 0; i < TASK_LENGTH; i++) {
-				tasks[i].minMaxDuration = 0x7FFF0000;
-				tasks[i].maxGap = 0;
-			}
-		} break;
-		case MspFn::GET_RX_STATUS: {
-			BREAK_WITH_BASIC_ERROR_IF(!elrs);
-			buf[0] = elrs->isReceiverUp;
-			buf[1] = elrs->isLinkUp;
-			buf[2] = elrs->uplinkRssi[0];
-			buf[3] = elrs->uplinkRssi[1];
-			buf[4] = elrs->uplinkLinkQuality;
-			buf[5] = elrs->uplinkSNR;
-			buf[6] = elrs->antennaSelection;
-			buf[7] = elrs->packetRateIdx;
-			memcpy(&buf[8], &elrs->txPower, 2);
-			memcpy(&buf[10], &elrs->targetPacketRate, 2);
-			memcpy(&buf[12], &elrs->actualPacketRate, 2);
-			memcpy(&buf[14], &elrs->rcMsgCount, 4);
-			sendMsp(msgSetup, buf, 18);
-		} break;
-		case MspFn::GET_RX_MODES: {
-			mspGetRxModes(&serial, version);
-		} break;
-		case MspFn::SET_RX_MODES: {
-			mspSetRxModes(&serial, version, reqPayload, reqLen);
-		} break;
-		case MspFn::CRSF_SCAN_DEVICES: {
-			BREAK_WITH_BASIC_ERROR_IF(!elrs);
-			elrs->scanDevices();
-			sendMsp(msgSetup);
-		} break;
-		case MspFn::CRSF_GET_DEVICES: {
-			BREAK_WITH_BASIC_ERROR_IF(!elrs);
-			std::list<CrsfDevice> devs = elrs->getDeviceList();
-			u32 count = devs.size();
-			BREAK_WITH_BASIC_ERROR_IF(count > 20);
-			char buf[47 * count];
-			u32 i = 0;
-			for (CrsfDevice dev : devs) {
-				memcpy(&buf[i], dev.name, 32);
-				i += 32;
-				buf[i++] = dev.address;
-				buf[i++] = dev.paramCount;
-				buf[i++] = dev.paramVersion;
-				memcpy(&buf[i], &dev.serialNo, 4);
-				i += 4;
-				memcpy(&buf[i], &dev.hardwareId, 4);
-				i += 4;
-				memcpy(&buf[i], &dev.firmwareId, 4);
-				i += 4;
-			}
-			sendMsp(msgSetup, buf, i);
-		} break;
-		case MspFn::CRSF_SEND_MESSAGE: {
-			BREAK_WITH_BASIC_ERROR_IF(!elrs);
-			// Configurator wants to send message to a device
-			u8 len = reqLen - 1;
-			if (len > 60) {
-				msgSetup.type = MspMsgType::ERROR;
-				return sendMsp(msgSetup);
-			}
-			u8 cmd = reqPayload[0];
-			elrs->sendPacket(cmd, &reqPayload[1], len);
-			sendMsp(msgSetup);
-		} break;
-		case MspFn::CRSF_SUBSCRIBE: {
-			BREAK_WITH_BASIC_ERROR_IF(!elrs);
-			// Configurator wants to start or stop passthrough to a device
-			// => enable flags to forward any messages from said device to configurator
-			// MSP message data: device to forward from, start or stop, array of wanted commands
-			i16 subCount = reqLen - 2;
-			if (subCount > 20) subCount = 20;
-			BREAK_WITH_BASIC_ERROR_IF(subCount < 0);
-			u8 address = reqPayload[0];
-			if (subCount == 0 || reqPayload[1] == 0) {
-				// stop passthrough when receiving stop command or no functions
-				buf[0] = address;
-				buf[1] = 0;
-				elrs->setupSubscription(0, nullptr, 0, nullptr, MspVersion::V2);
-				return sendMsp(msgSetup, buf, 2);
-			}
-			BREAK_WITH_BASIC_ERROR_IF(address == 0);
-			if (elrs->setupSubscription(address, (const u8 *)&reqPayload[2], subCount, &serial, version)) {
-				buf[0] = address;
-				buf[1] = 1;
-				sendMsp(msgSetup, buf, 2);
-			} else {
-				SEND_BASIC_ERROR;
-			}
-		} break;
-		case MspFn::GET_BATTERY_SETTINGS: {
-			buf[len++] = cellCountSetting;
-			buf[len++] = emptyVoltageSetting;
-			buf[len++] = emptyVoltageSetting >> 8;
-			sendMsp(msgSetup, buf, len);
-		} break;
-		case MspFn::SET_BATTERY_SETTINGS: {
-			cellCountSetting = reqPayload[0];
-			emptyVoltageSetting = reqPayload[1] | ((i16)reqPayload[2] << 8);
-			openSettingsFile();
-			getSetting(SETTING_CELL_COUNT)->updateSettingInFile();
-			getSetting(SETTING_EMPTY_VOLTAGE)->updateSettingInFile();
-			sendMsp(msgSetup);
-		} break;
-		case MspFn::GET_MOTOR_LAYOUT: {
-			getMotorPins((u8 *)buf);
-			sendMsp(msgSetup, buf, 4);
-		} break;
-		case MspFn::SET_MOTOR_LAYOUT: {
-			buf[0] = updateMotorPins((const u8 *)reqPayload);
-			sendMsp(msgSetup, buf, 1);
-		} break;
-		case MspFn::GET_MOTOR_STATE: {
-			for (int m = 0; m < 4; m++) {
-				u8 motor = 1 << 0; // motor output is enabled
-				motor |= 1 << 1; // output is bidir
-				if (escFound[m]) motor |= 1 << 2;
-				if (escEdtFound[m]) motor |= 1 << 3;
-				buf[m] = motor;
-			}
-			for (int m = 4; m < 8; m++) {
-				buf[m] = 0;
-			}
-			sendMsp(msgSetup, buf, 8);
-		} break;
-		case MspFn::GET_VTX_CURRENT_STATE: {
-			u8 len = sendTrampUpdateMsg(buf);
-			sendMsp(msgSetup, buf, len);
-		} break;
-		case MspFn::GET_VTX_CONFIG: {
-			u8 len = sendTrampConfigMsg(buf);
-			sendMsp(msgSetup, buf, len);
-		} break;
-		case MspFn::SET_VTX_CONFIG: {
-			setTrampConfig(reqPayload);
-			sendMsp(msgSetup);
-		} break;
-		case MspFn::VTX_APPLY_CONFIG: {
-			applyTrampConfig();
-			sendMsp(msgSetup);
-		} break;
-		case MspFn::GET_IO_CONSTRAINTS: {
-			u8 page = 0;
-			if (reqLen) page = reqPayload[0];
-			bool suc = sendIoConstraints(page, buf, len);
-			if (!suc) msgSetup.type = MspMsgType::ERROR;
-			sendMsp(msgSetup, buf, len);
-		} break;
-		case MspFn::GET_SERIAL_SETUP: {
-			for (int i = 1; i < SERIAL_COUNT; i++) {
-				std::optional<KoliSerial> &serial = serials[i];
-				const SerialConfig &cfg = getSerialConfig(i);
-				buf[len] = 0;
-				if (!serial) {
-					len += 27; // TODO
-					continue;
-				}
-				KoliSerial &ser = *serial;
-				buf[len++] = 1; // serial exists
-				buf[len++] = (u8)ser.serialType;
-				memcpy(&buf[len], &ser.getBaudrate(), 4);
-				len += 4;
-				memcpy(&buf[len], &cfg.baud, 4);
-				len += 4;
-				buf[len++] = ser.getTxPin();
-				buf[len++] = ser.getRxPin();
-				memcpy(&buf[len], &ser.functions(), 4);
-				len += 4;
-				buf[len++] = cfg.hwParam;
-				buf[len++] = cfg.mspDpSettings;
-				len += 9; // reserved
-			}
-			sendMsp(msgSetup, buf, len);
-		} break;
-		case MspFn::SET_SERIAL_SETUP: {
-			// check new config options for validity
-			// 0: serial type (255 = disabled)
-			// 1: special hw info (pio index, serial number)
-			// 2-5: baudrate
-			// 6-9: functions
-			// 10: tx pin
-			// 11: rx pin
-			// 12: msp dp settings
-			// 13-21: reserved for future use, should be 0
-
-			// only allow full configs per serial, and first serial (USB) cannot be reconfigured
-			int totalSerials = reqLen / 22;
-			BREAK_WITH_BASIC_ERROR_IF(reqLen % 22 != 0 || totalSerials > SERIAL_COUNT - 1 || armed);
-			bool ok = true;
-			string errorMsg = "You should not be able to even make something this incorrect. Configurator error.\n";
-			for (int i = 0; i < totalSerials; i++) {
-				const char *ser = &reqPayload[i * 22];
-				SerialType type = (SerialType)ser[0];
-				u8 hwParam = ser[1];
-				if (type == SerialType::DISABLED) continue; // serial disabled
-
-				// check if hardware is existent
-				if (type == SerialType::UART && hwParam >= NUM_UARTS) {
-					errorMsg += "Serial " + std::to_string(i) + " has HW UART index invalid.\n";
-					ok = false;
-					continue;
-				}
-				u8 rxPio = hwParam >> 4;
-				u8 txPio = hwParam & 0xF;
-				if (type >= SerialType::PIO && (rxPio >= NUM_PIOS || txPio >= NUM_PIOS)) {
-					errorMsg += "Serial " + std::to_string(i) + " invalid PIO index.\n";
-					ok = false;
-					continue;
-				}
+MSP_HANDLER(handleBoardInfo) {
+	u16 len = 0;
+	memcpy(&buf[len], targetIdentifier, TARGET_IDENTIFIER_LENGTH);
+	len += TARGET_IDENTIFIER_LENGTH;
+	buf[len++] = 0; // board revision
+	buf[len++] = 0;
+	buf[len++] = 2; // 2 == FC with MAX7456
+	u8 targetCapabilities = 0;
+	targetCapabilities |= 1 << 0; // VCP / CDC
+	targetCapabilities |= 0 << 1; // no soft serial
+	buf[len++] = targetCapabilities;
+	u8 targetNameLen = strlen(targetFullName);
+	buf[len++] = targetNameLen;
+	memcpy(&buf[len], targetFullName, targetNameLen);
+	len += targetNameLen;
+	sendMsp(msgSetup, buf, len);
+}
 
-				// only UART until NUM_UARTS
-				if (i < NUM_UARTS && type >= SerialType::PIO) {
-					errorMsg += "Serial " + std::to_string(i) + " invalid type. First serials only HW UARTs.\n";
-					ok = false;
-					continue;
-				}
-				// UART number = HW UART index
-				if (i < NUM_UARTS && i != hwParam) {
-					errorMsg += "Serial " + std::to_string(i) + " needs to be the same number HW serial.\n";
-					ok = false;
-					continue;
-				}
-				// only allow PIO beyond NUM_UARTs
-				if (i >= NUM_UARTS && type < SerialType::PIO) {
-					errorMsg += "Serial " + std::to_string(i) + " invalid type. Serial 3+ only PIO/PIO HDx.\n";
-					ok = false;
-					continue;
-				}
+MSP_HANDLER(handleBuildInfo) {
+	u16 len = 0;
+	memcpy(&buf[len], __DATE__, 11);
+	len += 11;
+	memcpy(&buf[len], __TIME__, 8);
+	len += 8;
+	memcpy(&buf[len], GIT_HASH, 7);
+	len += 7;
+	sendMsp(msgSetup, buf, len);
+}
 
-				// check baud and functions
-				u32 temp;
-				memcpy(&temp, &ser[2], 4);
-				if (temp && (temp < 1200 || temp > 10000000)) {
-					errorMsg += "Serial " + std::to_string(i) + " needs at least 1200 baud, maximum 10 MBaud.\n";
-					ok = false;
-					continue;
-				}
-				memcpy(&temp, &ser[6], 4);
-				if (temp >> SERIAL_FUNCTION_COUNT) {
-					errorMsg += "Serial " + std::to_string(i) + " requests invalid function.\n";
-					ok = false;
-					continue;
-				}
+MSP_HANDLER(handleGetName) {
+	sendMsp(msgSetup, uavName.c_str(), strlen(uavName.c_str()));
+}
 
-				// check pins
-				bool pinok = true;
-				if (type == SerialType::UART) {
-					u8 pin = ser[10]; // tx
-					pinok &= pinHasHwUart(pin, hwParam, true);
-					pin = ser[11]; // rx
-					pinok &= pinHasHwUart(pin, hwParam, false);
-				}
-				if (!pinok) {
-					errorMsg += "Serial " + std::to_string(i + 1) + " cannot use one of the provided pins.\n";
-					ok = false;
-					continue;
-				}
-			}
-			if (!ok) {
-				msgSetup.type = MspMsgType::ERROR;
-				return sendMsp(msgSetup, errorMsg.c_str(), errorMsg.length());
-			}
+MSP_HANDLER(handleSetName) {
+	openSettingsFile();
+	uavName = string(reqPayload, reqLen);
+	getSetting(SETTING_UAV_NAME)->updateSettingInFile();
+	sendMsp(msgSetup);
+}
 
-			SerialConfig newCfgs[SERIAL_COUNT - 1];
-			stopSerials();
-
-			for (int i = 0; i < SERIAL_COUNT - 1; i++) {
-				if (i >= totalSerials) {
-					// serial is unconfigured => insert DISABLED
-					newCfgs[i] = {
-						.type = SerialType::DISABLED,
-						.hwParam = 255,
-						.txPin = 255,
-						.rxPin = 255,
-						.baud = 0,
-						.functions = 0,
-					};
-					continue;
-				}
+MSP_HANDLER(handleGetFeatureConfig) {
+	u16 len = 0;
+	// only exists for compatibility with BLHeliSuite32
+	u32 features = 0;
+	features |= 1 << 3; // FEATURE_RX_SERIAL
+	features |= 1 << 4; // FEATURE_MOTOR_STOP
+	features |= 1 << 7; // FEATURE_GPS
+	features |= 1 << 10; // FEATURE_TELEMETRY
+	features |= 1 << 18; // FEATURE_OSD
+	features |= 1 << 22; // FEATURE_AIRMODE
+	sendMsp(msgSetup, (char *)features, len);
+}
 
-				const u8 *ser = (const u8 *)&reqPayload[i * 22];
-				if (ser[0] == 255) {
-					// serial is disabled
-					newCfgs[i] = {
-						.type = SerialType::DISABLED,
-						.hwParam = 255,
-						.txPin = 255,
-						.rxPin = 255,
-						.baud = 0,
-						.functions = 0,
-					};
-					continue;
-				}
+MSP_HANDLER(handleReboot) {
+	switch (reqPayload[0]) {
+	case MSP_REBOOT_FIRMWARE:
+		sendMsp(msgSetup);
+		serial.flush();
+		sleep_ms(100);
+		rp2040.reboot();
+		break;
+	case MSP_REBOOT_BOOTLOADER_FLASH:
+	case MSP_REBOOT_BOOTLOADER_ROM:
+		sendMsp(msgSetup);
+		serial.flush();
+		sleep_ms(100);
+		rp2040.rebootToBootloader();
+		break;
+	default:
+		msgSetup.type = MspMsgType::ERROR;
+		sendMsp(msgSetup, "Invalid reboot mode");
+		break;
+	}
+}
 
-				newCfgs[i] = {
-					.type = (SerialType)ser[0],
-					.hwParam = (u8)ser[1],
-					.txPin = (u8)ser[10],
-					.rxPin = (u8)ser[11],
-					.mspDpSettings = ser[12],
-				};
-				memcpy(&newCfgs[i].baud, &ser[2], 4);
-				memcpy(&newCfgs[i].functions, &ser[6], 4);
-			}
+MSP_HANDLER(handleGetAdvancedConfig) {
+	u16 len = 0;
+	// only exists for compatibility with BLHeliSuite32
+	buf[len++] = 1; // gyro_sync_denom
+	buf[len++] = 1; // pid_process_denom
+	buf[len++] = 0; // useUnsyncedPwm => true if motors are updated asynchronously from the PID
+	buf[len++] = 6; // motorPwmProtocol, 6 = DShot 300
+	buf[len++] = PID_FREQ & 0xFF;
+	buf[len++] = PID_FREQ >> 8;
+	buf[len++] = (idlePermille * 10) & 0xFF;
+	buf[len++] = (idlePermille * 10) >> 8;
+	buf[len++] = 0; // gyro_use_32kHz
+	buf[len++] = 0; // motorPwmInversion
+	buf[len++] = 0; // gyro_to_use
+	buf[len++] = 0; // gyro_high_fsr (true if > 2000dps)
+	buf[len++] = GYRO_CALIBRATION_TOLERANCE;
+	buf[len++] = (CALIBRATION_SAMPLES * 100 / PID_FREQ) & 0xFF; // calibration duration in centiseconds
+	buf[len++] = (CALIBRATION_SAMPLES * 100 / PID_FREQ) >> 8;
+	buf[len++] = 0; // gyro_offset_yaw
+	buf[len++] = 0;
+	buf[len++] = 0; // checkOverflow, no overflow
+	sendMsp(msgSetup, buf, len);
+}
 
-			buf[0] = startSerials(newCfgs);
-			if (buf[0]) {
-				openSettingsFile();
-				getSetting(SETTING_SERIAL_CONFIGS)->updateSettingInFile();
-			} else {
-				revertSerials();
-			}
-			sendMsp(msgSetup, buf, 1);
-		} break;
-		case MspFn::GET_TZ_OFFSET: {
-			buf[0] = rtcTimezoneOffset;
-			buf[1] = rtcTimezoneOffset >> 8;
-			sendMsp(msgSetup, buf, 2);
-		} break;
-		case MspFn::SET_TZ_OFFSET: {
-			i16 offset = DECODE_I2((u8 *)reqPayload);
-			BREAK_WITH_BASIC_ERROR_IF(offset > 14 * 60 || offset < -12 * 60);
-			rtcTimezoneOffset = offset;
-			openSettingsFile();
-			getSetting(SETTING_TIMEZONE_OFFSET)->updateSettingInFile();
-			sendMsp(msgSetup);
-		} break;
-		case MspFn::GET_PIDS: {
-			// copying just for future proofing, in case more things are added
-			u16 pids[3][5];
-			for (int i = 0; i < 3; i++) {
-				pids[i][0] = pidGainsNice[i][0];
-				pids[i][1] = pidGainsNice[i][1];
-				pids[i][2] = pidGainsNice[i][2];
-				pids[i][3] = pidGainsNice[i][3];
-				pids[i][4] = pidGainsNice[i][4];
-			}
-			sendMsp(msgSetup, (char *)pids, sizeof(pids));
-		} break;
-		case MspFn::SET_PIDS: {
-			u16 pids[3][5];
-			memcpy(pids, reqPayload, sizeof(pids));
-			for (int i = 0; i < 3; i++) {
-				pidGainsNice[i][0] = pids[i][0];
-				pidGainsNice[i][1] = pids[i][1];
-				pidGainsNice[i][2] = pids[i][2];
-				pidGainsNice[i][3] = pids[i][3];
-				pidGainsNice[i][4] = pids[i][4];
-			}
-			convertPidsFromNice();
-			openSettingsFile();
-			getSetting(SETTING_PID_GAINS)->updateSettingInFile();
-			sendMsp(msgSetup);
-		} break;
-		case MspFn::GET_RATES: {
-			i16 rates[3][3];
-			for (int ax = 0; ax < 3; ax++) {
-				rates[ax][ACTUAL_CENTER_SENSITIVITY] = rateCoeffs[ax][ACTUAL_CENTER_SENSITIVITY].geti32();
-				rates[ax][ACTUAL_MAX_RATE] = rateCoeffs[ax][ACTUAL_MAX_RATE].geti32();
-				rates[ax][ACTUAL_EXPO] = rateCoeffs[ax][ACTUAL_EXPO].raw >> 3; // expo, 3.13 fixed point
-			}
-			sendMsp(msgSetup, (char *)rates, sizeof(rates));
-		} break;
-		case MspFn::SET_RATES: {
-			i16 rates[3][3];
-			memcpy(rates, reqPayload, sizeof(rates));
-			for (int ax = 0; ax < 3; ax++) {
-				if (rates[ax][ACTUAL_CENTER_SENSITIVITY] > rates[ax][ACTUAL_MAX_RATE]) {
-					rates[ax][ACTUAL_MAX_RATE] = rates[ax][ACTUAL_CENTER_SENSITIVITY];
-				}
-				rateCoeffs[ax][ACTUAL_CENTER_SENSITIVITY] = rates[ax][ACTUAL_CENTER_SENSITIVITY];
-				rateCoeffs[ax][ACTUAL_MAX_RATE] = rates[ax][ACTUAL_MAX_RATE];
-				rateCoeffs[ax][ACTUAL_EXPO].raw = (i32)rates[ax][ACTUAL_EXPO] << 3; // 3.13 fixed point for expo (normally [0,1], but technically [-4,4) are allowed here)
-			}
-			sendMsp(msgSetup);
-			openSettingsFile();
-			getSetting(SETTING_RATE_COEFFS)->updateSettingInFile();
-		} break;
-		case MspFn::GET_EXT_PID: {
-			u16 ifall = iFalloff.geti32();
-			buf[len++] = ifall & 0xFF;
-			buf[len++] = ifall >> 8;
-			buf[len++] = useDynamicIdle;
-			buf[len++] = idlePermille;
-			buf[len++] = dynamicIdleRpm;
-			buf[len++] = dynamicIdleRpm >> 8;
-			sendMsp(msgSetup, buf, len);
-		} break;
-		case MspFn::SET_EXT_PID: {
-			iFalloff = DECODE_U2(reqPayload);
-			useDynamicIdle = reqPayload[2];
-			idlePermille = reqPayload[3];
-			dynamicIdleRpm = DECODE_U2(&reqPayload[4]);
-			sendMsp(msgSetup);
-			openSettingsFile();
-			getSetting(SETTING_IFALLOFF)->updateSettingInFile();
-			getSetting(SETTING_DYNAMIC_IDLE_EN)->updateSettingInFile();
-			getSetting(SETTING_IDLE_PERMILLE)->updateSettingInFile();
-			getSetting(SETTING_DYNAMIC_IDLE_RPM)->updateSettingInFile();
-		} break;
-		case MspFn::GET_FILTER_CONFIG: {
-			buf[len++] = gyroFilterCutoff & 0xFF;
-			buf[len++] = gyroFilterCutoff >> 8;
-			u16 data = accelFilterCutoff.geti32();
-			buf[len++] = data & 0xFF;
-			buf[len++] = data >> 8;
-			buf[len++] = dFilterCutoff & 0xFF;
-			buf[len++] = dFilterCutoff >> 8;
-			data = (setpointDiffCutoff * 10 + 0.5f).geti32();
-			buf[len++] = data & 0xFF;
-			buf[len++] = data >> 8;
-			data = (magFilterCutoff * 100 + 0.5f).geti32();
-			buf[len++] = data & 0xFF;
-			buf[len++] = data >> 8;
-			data = (vvelFFFilterCutoff * 100 + 0.5f).geti32();
-			buf[len++] = data & 0xFF;
-			buf[len++] = data >> 8;
-			data = (vvelDFilterCutoff * 10 + 0.5f).geti32();
-			buf[len++] = data & 0xFF;
-			buf[len++] = data >> 8;
-			data = (hvelFfFilterCutoff * 100 + 0.5f).geti32();
-			buf[len++] = data & 0xFF;
-			buf[len++] = data >> 8;
-			data = (hvelIRelaxFilterCutoff * 100 + 0.5f).geti32();
-			buf[len++] = data & 0xFF;
-			buf[len++] = data >> 8;
-			data = (hvelPushFilterCutoff * 10 + 0.5f).geti32();
-			buf[len++] = data & 0xFF;
-			buf[len++] = data >> 8;
-			data = (gpsVelocityFilterCutoff * 100 + 0.5f).geti32();
-			buf[len++] = data & 0xFF;
-			buf[len++] = data >> 8;
-			sendMsp(msgSetup, buf, len);
-		} break;
-		case MspFn::SET_FILTER_CONFIG: {
-			BREAK_WITH_BASIC_ERROR_IF(reqLen < 22);
-			openSettingsFile();
+MSP_HANDLER(handleSetArmingDisabled) {
+	if (reqPayload[0]) {
+		serial.armingDisabled = true;
+	} else {
+		serial.armingDisabled = false;
+	}
+	bool disabled = false;
+	for (int i = 0; i < SERIAL_COUNT; i++) {
+		if (!serials[i]) continue;
+		disabled = disabled || serial.armingDisabled;
+	}
+	if (disabled)
+		armingDisableFlags |= 0x80;
+	else
+		armingDisableFlags &= ~0x80;
+	sendMsp(msgSetup);
+}
+
+MSP_HANDLER(handleMspStatus) {
+	u16 len = 0;
+	// only exists for compatibility with BLHeliSuite32
+	buf[len++] = (1000000 / PID_FREQ) & 0xFF;
+	buf[len++] = (1000000 / PID_FREQ) >> 8;
+	buf[len++] = 0; // I2C error count
+	buf[len++] = 0;
+	buf[len++] = 0b101111; // gyro, no rangefinder, gps, mag, baro, accel
+	buf[len++] = 0; // no other sensors
+	buf[len++] = armed ? 1 : 0; // flight mode flags
+	buf[len++] = 0;
+	buf[len++] = 0;
+	buf[len++] = 0;
+	buf[len++] = 0; // PID profile index
+	buf[len++] = 0; // CPU load (%)
+	buf[len++] = 0; // gyro cycle time
+	buf[len++] = 0;
+	buf[len++] = 0; // how many more flight mode flags follow
+	buf[len++] = 7; // arming disable flags count
+	buf[len++] = armingDisableFlags;
+	buf[len++] = armingDisableFlags >> 8;
+	buf[len++] = armingDisableFlags >> 16;
+	buf[len++] = armingDisableFlags >> 24;
+	buf[len++] = 0; // config state flags, e.g. reboot required
+	sendMsp(msgSetup, buf, len);
+}
 
-			gyroFilterCutoff = DECODE_U2((u8 *)&reqPayload[0]);
-			getSetting(SETTING_GYRO_FILTER_CUTOFF)->updateSettingInFile();
+MSP_HANDLER(handleMspRawImu) {
+	u16 len = 0;
+	buf[len++] = accelAligned[0] & 0xFF; // accel x
+	buf[len++] = accelAligned[0] >> 8;
+	buf[len++] = accelAligned[1] & 0xFF; // accel y
+	buf[len++] = accelAligned[1] >> 8;
+	buf[len++] = accelAligned[2] & 0xFF; // accel z
+	buf[len++] = accelAligned[2] >> 8;
+	i16 gyroX = gyroScaled[0].geti32(); // gyro x
+	i16 gyroY = gyroScaled[1].geti32(); // gyro y
+	i16 gyroZ = gyroScaled[2].geti32(); // gyro z
+	buf[len++] = gyroX & 0xFF;
+	buf[len++] = gyroX >> 8;
+	buf[len++] = gyroY & 0xFF;
+	buf[len++] = gyroY >> 8;
+	buf[len++] = gyroZ & 0xFF;
+	buf[len++] = gyroZ >> 8;
+	buf[len++] = magData[0] & 0xFF; // mag x
+	buf[len++] = magData[0] >> 8;
+	buf[len++] = magData[1] & 0xFF; // mag y
+	buf[len++] = magData[1] >> 8;
+	buf[len++] = magData[2] & 0xFF; // mag z
+	buf[len++] = magData[2] >> 8;
+	sendMsp(msgSetup, buf, len);
+}
+
+MSP_HANDLER(handleGetMotor) {
+	u16 motors[8];
+	for (int i = 0; i < 4; i++) {
+		motors[i] = throttles[i] / 2 + 1000;
+	}
+	for (int i = 4; i < 8; i++) {
+		motors[i] = 0;
+	}
+	memcpy(buf, motors, 16);
+	sendMsp(msgSetup, buf, 16);
+}
 
-			accelFilterCutoff = DECODE_U2((u8 *)&reqPayload[2]);
-			getSetting(SETTING_ACC_FILTER_CUTOFF)->updateSettingInFile();
+MSP_HANDLER(handleRc) {
+	u16 channels[16];
+	for (int i = 0; i < 16; i++)
+		channels[i] = elrs ? elrs->channels[i] : 0;
+	memcpy(buf, channels, 32);
+	sendMsp(msgSetup, buf, 32);
+}
 
-			dFilterCutoff = DECODE_U2((u8 *)&reqPayload[4]);
-			getSetting(SETTING_DFILTER_CUTOFF)->updateSettingInFile();
+MSP_HANDLER(handleMspAttitude) {
+	u16 len = 0;
+	// not used by Kolibri configurator, that uses GET_ROTATION
+	i16 rollInt = (-roll * (FIX_RAD_TO_DEG * 10)).geti32(); // decidegrees
+	i16 pitchInt = (pitch * (FIX_RAD_TO_DEG * 10)).geti32(); // decidegrees
+	i16 yawInt = (combinedHeading * FIX_RAD_TO_DEG).geti32(); // degrees
+	buf[len++] = rollInt & 0xFF;
+	buf[len++] = rollInt >> 8;
+	buf[len++] = pitchInt & 0xFF;
+	buf[len++] = pitchInt >> 8;
+	buf[len++] = yawInt & 0xFF;
+	buf[len++] = yawInt >> 8;
+	sendMsp(msgSetup, buf, len);
+}
 
-			setpointDiffCutoff = DECODE_U2((u8 *)&reqPayload[6]) / 10.0f;
-			getSetting(SETTING_SETPOINT_DIFF_CUTOFF)->updateSettingInFile();
+MSP_HANDLER(handleMspAltitude) {
+	u16 len = 0;
+	i32 altitudeInt = combinedAltitude.raw / 656; // fix32 raw (m) to cm
+	buf[len++] = altitudeInt & 0xFF;
+	buf[len++] = altitudeInt >> 8;
+	buf[len++] = altitudeInt >> 16;
+	buf[len++] = altitudeInt >> 24;
+	buf[len++] = 0; // vario
+	buf[len++] = 0; // vario
+	sendMsp(msgSetup, buf, len);
+}
 
-			magFilterCutoff = DECODE_U2((u8 *)&reqPayload[8]) / 100.0f;
-			getSetting(SETTING_MAG_FILTER_CUTOFF)->updateSettingInFile();
+MSP_HANDLER(handleMspAnalog) {
+	u16 len = 0;
+	u8 voltage = adcVoltage / 10; // dV
+	u16 current = adcCurrent * 100; // cA
+	u16 mAh = 0; // mW
+	u16 rssi = elrs->uplinkLinkQuality * 10; // 0-1000, 1000 = 100%
+	buf[len++] = voltage;
+	buf[len++] = current & 0xFF;
+	buf[len++] = current >> 8;
+	buf[len++] = mAh & 0xFF;
+	buf[len++] = mAh >> 8;
+	buf[len++] = rssi & 0xFF;
+	buf[len++] = rssi >> 8;
+	sendMsp(msgSetup, buf, len);
+}
 
-			vvelFFFilterCutoff = DECODE_U2((u8 *)&reqPayload[10]) / 100.0f;
-			getSetting(SETTING_VVEL_FF_FILTER_CUTOFF)->updateSettingInFile();
+MSP_HANDLER(handleBoxids) {
+	// only exists for compatibility with BLHeliSuite32
+	sendMsp(msgSetup);
+}
 
-			vvelDFilterCutoff = DECODE_U2((u8 *)&reqPayload[12]) / 10.0f;
-			getSetting(SETTING_VVEL_D_FILTER_CUTOFF)->updateSettingInFile();
+MSP_HANDLER(handleGetMotor3dConfig) {
+	u16 len = 0;
+	buf[len++] = 1450 & 0xFF; // deadband low
+	buf[len++] = 1450 >> 8;
+	buf[len++] = 1550 & 0xFF; // deadband high
+	buf[len++] = 1550 >> 8;
+	buf[len++] = 1500 & 0xFF; // neutral
+	buf[len++] = 1500 >> 8;
+	sendMsp(msgSetup, buf, len);
+}
 
-			hvelFfFilterCutoff = DECODE_U2((u8 *)&reqPayload[14]) / 100.0f;
-			getSetting(SETTING_HVEL_FF_FILTER_CUTOFF)->updateSettingInFile();
+MSP_HANDLER(handleMspBatteryState) {
+	u16 len = 0;
+	buf[len++] = batCells;
+	buf[len++] = 0; // battery capacity
+	buf[len++] = 0;
+	buf[len++] = (adcVoltage + 5) / 10; // voltage in 0.1V steps :/
+	buf[len++] = 0; // mAh drawn
+	buf[len++] = 0;
+	buf[len++] = 0; // amps in 0.01A steps
+	buf[len++] = 0;
+	buf[len++] = batState == 0 ? 4 : 0; // 4 = init, 0 = ok
+	buf[len++] = adcVoltage;
+	buf[len++] = adcVoltage >> 8;
+	sendMsp(msgSetup, buf, len);
+}
 
-			hvelIRelaxFilterCutoff = DECODE_U2((u8 *)&reqPayload[16]) / 100.0f;
-			getSetting(SETTING_HVEL_I_RELAX_FILTER_CUTOFF)->updateSettingInFile();
+MSP_HANDLER(handleGetMotorConfig) {
+	u16 len = 0;
+	buf[len++] = (1000 + idlePermille) & 0xFF; // min throttle
+	buf[len++] = (1000 + idlePermille) >> 8;
+	buf[len++] = 2000 & 0xFF; // max throttle
+	buf[len++] = 2000 >> 8;
+	buf[len++] = 1000 & 0xFF; // min command
+	buf[len++] = 1000 >> 8;
+	buf[len++] = 4; // motor count
+	buf[len++] = MOTOR_POLES;
+	buf[len++] = 1; // use dshot telemetry
+	buf[len++] = 0; // esc sensor
+	sendMsp(msgSetup, buf, len);
+}
 
-			hvelPushFilterCutoff = DECODE_U2((u8 *)&reqPayload[18]) / 10.0f;
-			getSetting(SETTING_HVEL_PUSH_FILTER_CUTOFF)->updateSettingInFile();
+MSP_HANDLER(handleUid) {
+	const char *chipId = rp2040.getChipID();
+	memcpy(buf, chipId, 12);
+	sendMsp(msgSetup, buf, 12);
+}
 
-			gpsVelocityFilterCutoff = DECODE_U2((u8 *)&reqPayload[20]) / 100.0f;
-			getSetting(SETTING_GPS_VEL_FILTER_CUTOFF)->updateSettingInFile();
+MSP_HANDLER(handleMspDisplayport) {
+	// MSP_DISPLAYPORT is just responses without a request
+}
 
-			sendMsp(msgSetup);
-		} break;
-		case MspFn::GET_CRASH_DUMP:
-			sendMsp(msgSetup);
-			break;
-		case MspFn::CLEAR_CRASH_DUMP:
-			sendMsp(msgSetup);
-			break;
-		case MspFn::SET_DEBUG_LED:
-			p.neoPixelSetValue(1, reqPayload[0] * 255, reqPayload[0] * 255, reqPayload[0] * 255, true);
-			sendMsp(msgSetup);
-			break;
-		case MspFn::PLAY_SOUND: {
-			const u16 startFreq = random(1000, 5000);
-			const u16 endFreq = random(1000, 5000);
-			const u16 sweepDuration = random(400, 1000);
-			u16 pauseDuration = random(100, 1000);
-			const u16 pauseEn = random(0, 2);
-			pauseDuration *= pauseEn;
-			const u16 repeat = random(1, 11);
-			makeSweepSound(startFreq, endFreq, ((sweepDuration + pauseDuration) * repeat) - 1, sweepDuration, pauseDuration);
-			u8 len = 0;
-			buf[len++] = startFreq & 0xFF;
-			buf[len++] = startFreq >> 8;
-			buf[len++] = endFreq & 0xFF;
-			buf[len++] = endFreq >> 8;
-			buf[len++] = sweepDuration & 0xFF;
-			buf[len++] = sweepDuration >> 8;
-			buf[len++] = pauseDuration & 0xFF;
-			buf[len++] = pauseDuration >> 8;
-			buf[len++] = pauseEn;
-			buf[len++] = repeat;
-			buf[len++] = (((sweepDuration + pauseDuration) * repeat) - 1) & 0xFF;
-			buf[len++] = (((sweepDuration + pauseDuration) * repeat) - 1) >> 8;
-			sendMsp(msgSetup, buf, len);
-		} break;
-		case MspFn::DEBUG_SENSORS: {
-			memcpy(buf, mspDebugSensors, sizeof(mspDebugSensors));
-			sendMsp(msgSetup, buf, sizeof(mspDebugSensors));
-		} break;
-		default:
-			msgSetup.type = MspMsgType::ERROR;
-			sendMsp(msgSetup, "Unknown command", strlen("Unknown command"));
-			break;
-		}
+MSP_HANDLER(handleMspSetOsdCanvas) {
+	RETURN_WITH_BASIC_ERROR_IF(reqPayload[0] > 192 || reqPayload[1] > 192);
+	MspOsdOutput *dp = serial.getDp();
+	if (dp != nullptr) {
+		dp->setSize(reqPayload[0], reqPayload[1]);
 	}
+	sendMsp(msgSetup);
 }
 
-void MspParser::handleByte(u8 c) {
-	TASK_START(TASK_CONFIGURATOR);
+MSP_HANDLER(handleMspGetOsdCanvas) {
+	OsdCanvas::get().getSize((u8 *)&buf[0], (u8 *)&buf[1]);
+	sendMsp(msgSetup, buf, 2);
+}
 
-	switch (mspState) {
-	case MspState::IDLE:
-		if (c == '$')
-			mspState = MspState::PACKET_START;
-		break;
-	case MspState::PACKET_START:
-		payloadBufIndex = 0;
-		switch (c) {
-		case 'M':
-			mspState = MspState::TYPE_V1;
-			msgMspVer = MspVersion::V1;
-			break;
-		case 'X':
-			mspState = MspState::TYPE_V2;
-			msgMspVer = MspVersion::V2;
-			break;
-		default:
-			mspState = MspState::IDLE;
-			break;
-		}
-		break;
-	case MspState::TYPE_V1:
-		crcV1 = 0;
-		mspState = MspState::LEN_V1;
-		switch (c) {
-		case '<':
-			msgType = MspMsgType::REQUEST;
-			break;
-		case '>':
-			msgType = MspMsgType::RESPONSE;
-			break;
-		case '!':
-			msgType = MspMsgType::ERROR;
-			break;
-		default:
-			mspState = MspState::IDLE;
-			break;
-		}
-		break;
-	case MspState::LEN_V1:
-		crcV1 ^= c;
-		payloadLen = c;
-		mspState = MspState::CMD_V1;
-		break;
-	case MspState::CMD_V1:
-		crcV1 ^= c;
-		fn = (MspFn)c;
-		if (c == (u8)MspFn::MSP_V2_FRAME) {
-			msgMspVer = MspVersion::V2_OVER_V1;
-			crcV2 = 0;
-			mspState = MspState::FLAG_V2_OVER_V1;
-		} else if (payloadLen == 255) {
-			msgMspVer = MspVersion::V1_JUMBO;
-			mspState = MspState::JUMBO_LEN_LO_V1;
+MSP_HANDLER(handleAccCalibration) {
+	startAccelCalibration();
+	sendMsp(msgSetup, buf, 1);
+}
+
+MSP_HANDLER(handleMagCalibration) {
+	magStateAfterRead = MagState::CALIBRATE;
+	sendMsp(msgSetup, buf, 1);
+	snprintf(buf, 32, "Offsets: %d %d %d", magOffset[0], magOffset[1], magOffset[2]);
+	msgSetup.fn = MspFn::IND_MESSAGE;
+	sendMsp(msgSetup, buf, strlen(buf));
+}
+
+MSP_HANDLER(handleSetMotor) {
+	if (!armed) {
+		throttles[(u8)MOTOR::RR] = ((u16)reqPayload[0] + ((u16)reqPayload[1] << 8)) * 2 - 2000;
+		throttles[(u8)MOTOR::FR] = ((u16)reqPayload[2] + ((u16)reqPayload[3] << 8)) * 2 - 2000;
+		throttles[(u8)MOTOR::RL] = ((u16)reqPayload[4] + ((u16)reqPayload[5] << 8)) * 2 - 2000;
+		throttles[(u8)MOTOR::FL] = ((u16)reqPayload[6] + ((u16)reqPayload[7] << 8)) * 2 - 2000;
+	}
+	mspOverrideMotors = 0;
+	sendMsp(msgSetup);
+}
+
+MSP_HANDLER(handleEnable4wayIf) {
+	begin4Way(&serial);
+	buf[0] = 4; // ESC count
+	sendMsp(msgSetup, buf, 1);
+}
+
+MSP_HANDLER(handleSetRtc) {
+	const struct timespec t = {
+		.tv_sec = DECODE_U4((u8 *)reqPayload),
+		.tv_nsec = DECODE_U2((u8 *)&reqPayload[4]) * 1000000, // convert millis to nanoseconds
+	};
+	rtcSetTime(&t, TIME_QUALITY_MSP);
+	sendMsp(msgSetup);
+}
+
+MSP_HANDLER(handleGetRtc) {
+	struct tm tm;
+	struct timespec ts;
+	rtcGetTime(&ts, true);
+	rtcConvertToTm(&ts, &tm);
+	buf[0] = tm.tm_year & 0xFF;
+	buf[1] = tm.tm_year >> 8;
+	buf[2] = tm.tm_mon;
+	buf[3] = tm.tm_mday;
+	buf[4] = tm.tm_hour;
+	buf[5] = tm.tm_min;
+	buf[6] = tm.tm_sec;
+	u16 millis = ts.tv_nsec / 1000000;
+	buf[7] = millis & 0xFF; // millis
+	buf[8] = millis >> 8; // millis
+	sendMsp(msgSetup, buf, 9);
+}
+
+MSP_HANDLER(handleStatus) {
+	u16 len = 0;
+	u16 voltage = adcVoltage;
+	buf[len++] = voltage & 0xFF;
+	buf[len++] = voltage >> 8;
+	buf[len++] = armed;
+	buf[len++] = (u8)flightMode;
+	buf[len++] = (u8)(armingDisableFlags & 0xFF);
+	buf[len++] = (u8)(armingDisableFlags >> 8);
+	buf[len++] = (u8)(armingDisableFlags >> 16);
+	buf[len++] = (u8)(armingDisableFlags >> 24);
+	sendMsp(msgSetup, buf, len);
+}
+
+MSP_HANDLER(handleConfiguratorPing) {
+	lastConfigPingRx = 0;
+	sendMsp(msgSetup, reqPayload, reqLen);
+}
+
+MSP_HANDLER(handleGetMspCommands) {
+	// paged list of all commands with their descriptors, see mspEncodeCommandList()
+	u16 first = reqLen >= 2 ? DECODE_U2((u8 *)reqPayload) : 0;
+	u16 len = mspEncodeCommandList(first, (u8 *)buf);
+	sendMsp(msgSetup, buf, len);
+}
+
+MSP_HANDLER(handleStreamSubscribe) {
+	// pairs of u16 function and u16 interval (ms), replaces all subscriptions of this port, an empty payload ends them
+	static_assert(4 * MSP_STREAM_MAX == 64, "update the maxLen of STREAM_SUBSCRIBE in mspRegistry.h");
+	RETURN_WITH_BASIC_ERROR_IF(reqLen % 4 || !(serial.functions() & SERIAL_MSP));
+	MspFn fns[MSP_STREAM_MAX];
+	u16 intervals[MSP_STREAM_MAX];
+	u16 granted[MSP_STREAM_MAX];
+	u8 count = reqLen / 4;
+	for (int i = 0; i < count; i++) {
+		fns[i] = (MspFn)DECODE_U2((u8 *)&reqPayload[i * 4]);
+		intervals[i] = DECODE_U2((u8 *)&reqPayload[i * 4 + 2]);
+	}
+	serial.mspParser().streams().set(fns, intervals, count, time_us_32(), granted);
+	// answer with the granted interval of each function, 0 = rejected
+	u16 len = 0;
+	for (int i = 0; i < count; i++) {
+		buf[len++] = (u16)fns[i] & 0xFF;
+		buf[len++] = (u16)fns[i] >> 8;
+		buf[len++] = granted[i] & 0xFF;
+		buf[len++] = granted[i] >> 8;
+	}
+	sendMsp(msgSetup, buf, len);
+}
+
+MSP_HANDLER(handleTransferBegin) {
+	/* request: object (1), direction (1, 0 = download, 1 = upload), for uploads: length (4), CRC32 (4)
+	 * response: status (1, MspTransferStatus), session (1), length (4), CRC32 (4)
+	 */
+	const u8 object = reqPayload[0];
+	u8 session = 0;
+	u32 len = 0, crc = 0;
+	MspTransferStatus status;
+	if (reqPayload[1] == 0) {
+		status = mspTransfer.beginDownload(object, &session, &len, &crc);
+	} else {
+		RETURN_WITH_BASIC_ERROR_IF(reqLen < 10);
+		len = DECODE_U4((const u8 *)&reqPayload[2]);
+		crc = DECODE_U4((const u8 *)&reqPayload[6]);
+		status = mspTransfer.beginUpload(object, len, crc, armed, &session);
+	}
+	buf[0] = (u8)status;
+	buf[1] = session;
+	memcpy(&buf[2], &len, 4);
+	memcpy(&buf[6], &crc, 4);
+	sendMsp(msgSetup, buf, 10);
+}
+
+MSP_HANDLER(handleTransferRead) {
+	/* request: session (1), offset (4), max length (2)
+	 * response: status (1), session (1), offset (4), data
+	 */
+	const u8 session = reqPayload[0];
+	const u32 offset = DECODE_U4((const u8 *)&reqPayload[1]);
+	u32 maxLen = DECODE_U2(&reqPayload[5]);
+	const u32 maxData = mspMaxResponse(version) - MSP_TRANSFER_HEADER;
+	if (maxLen > maxData) maxLen = maxData;
+	const u8 *data = nullptr;
+	u32 len = 0;
+	MspTransferStatus status = mspTransfer.read(session, offset, maxLen, &data, &len);
+	buf[0] = (u8)status;
+	buf[1] = session;
+	memcpy(&buf[2], &offset, 4);
+	if (status == MspTransferStatus::OK) memcpy(&buf[MSP_TRANSFER_HEADER], data, len);
+	sendMsp(msgSetup, buf, MSP_TRANSFER_HEADER + len);
+}
+
+MSP_HANDLER(handleTransferWrite) {
+	/* request: session (1), offset (4), data
+	 * response: status (1), session (1), bytes received so far (4), i.e. where the next write continues
+	 */
+	const u8 session = reqPayload[0];
+	const u32 offset = DECODE_U4((const u8 *)&reqPayload[1]);
+	u32 received = 0;
+	MspTransferStatus status = mspTransfer.write(session, offset, (const u8 *)&reqPayload[5], reqLen - 5, &received);
+	buf[0] = (u8)status;
+	buf[1] = session;
+	memcpy(&buf[2], &received, 4);
+	sendMsp(msgSetup, buf, 6);
+}
+
+MSP_HANDLER(handleTransferFinish) {
+	/* request: session (1)
+	 * response: status (1, BUSY while an upload is applied, ask again), session (1), bytes applied (4)
+	 */
+	const u8 session = reqPayload[0];
+	u32 progress = 0;
+	MspTransferStatus status = mspTransfer.finish(session, &progress);
+	buf[0] = (u8)status;
+	buf[1] = session;
+	memcpy(&buf[2], &progress, 4);
+	sendMsp(msgSetup, buf, 6);
+}
+
+MSP_HANDLER(handleSerialPassthrough) {
+	u8 fromNum = 255;
+	if (reqLen > 5) {
+		fromNum = reqPayload[5];
+		RETURN_WITH_BASIC_ERROR_IF(fromNum >= SERIAL_COUNT || !serials[fromNum]);
+	}
+	RETURN_WITH_BASIC_ERROR_IF(reqPayload[0] >= SERIAL_COUNT || !serials[reqPayload[0]]);
+
+	KoliSerial &from = fromNum == 255 ? serial : *serials[fromNum];
+	KoliSerial &to = *serials[reqPayload[0]];
+	RETURN_WITH_BASIC_ERROR_IF(&from == &to);
+	u32 baud = DECODE_U4((u8 *)&reqPayload[1]);
+	sendMsp(msgSetup, (char *)reqPayload, 5);
+	serial.flush();
+
+	runSerialBridge(from, to, baud);
+}
+
+MSP_HANDLER(handleSerialSniff) {
+	// sniffing forwards all bytes to the host, but does not allow communication the other way round
+	KoliSerial &to = serial;
+
+	u8 plusCount = 0;
+	elapsedMillis breakoutCounter = 0;
+
+	sendMsp(msgSetup);
+
+	while (true) {
+		if (breakoutCounter > 1000 && plusCount >= 3) break;
+		int c = to.read();
+		if (c != -1) {
+			breakoutCounter = 0;
+			if (c == '+')
+				plusCount++;
+			else
+				plusCount = 0;
+		}
+
+		for (int i = 0; i < reqLen; i++) {
+			u8 num = reqPayload[i];
+			if (num >= SERIAL_COUNT) continue; // invalid request
+			auto &from = serials[num];
+			if (!from) continue; // if disabled
+			if (!*from) continue; // if not running
+			if (&*from == &to) continue; // no feeding back
+			c = from->read();
+			if (c != -1) {
+				for (int j = 0; j < i; j++) {
+					to.print("\t\t");
+				}
+				to.printf("%3d %02X %c\n", c, c, c);
+			}
+			from->loop();
+		}
+		to.loop();
+		to.flush();
+		rp2040.wdt_reset();
+	}
+}
+
+MSP_HANDLER(handleCliInit) {
+	// send start info
+	snprintf(buf, 256, FIRMWARE_NAME " v" FIRMWARE_VERSION_STRING "\n%s => %s\nType 'help' to get a list of commands" CLI_PROMPT, targetIdentifier, targetFullName);
+	openSettingsFile();
+	sendMsp(msgSetup, buf, strlen(buf));
+}
+
+MSP_HANDLER(handleCliCommand) {
+	string total = string(reqPayload, reqLen);
+	string cmdName = total;
+	string payload = "";
+	size_t spaceIndex = cmdName.find(' ');
+	if (spaceIndex != string::npos) {
+		payload = cmdName.substr(spaceIndex + 1);
+		cmdName = cmdName.substr(0, spaceIndex);
+	}
+
+	Command *cmd = Command::getCommandByName(cmdName);
+	if (Command::activeLoopCommand && Command::activeLoopCommand->getSerial() == &serial) {
+		Command::activeLoopCommand->input(total);
+	} else {
+		string response = CLI_COLOR_WHITE + string(reqPayload, reqLen) + "\n";
+		sendMsp(msgSetup, response.c_str(), response.length());
+		if (cmd) {
+			cmd->execute(payload, &serial);
 		} else {
-			mspState = payloadLen ? MspState::PAYLOAD_V1 : MspState::CHECKSUM_V1;
+			snprintf(buf, 256, CLI_COLOR_RED "Unknown command: %s\n" CLI_COLOR_WHITE, cmdName.c_str());
+			sendMsp(msgSetup, buf, strlen(buf));
 		}
-		break;
-	case MspState::JUMBO_LEN_LO_V1:
-		payloadLen = c;
-		crcV1 ^= c;
-		mspState = MspState::JUMBO_LEN_HI_V1;
-		break;
-	case MspState::JUMBO_LEN_HI_V1:
-		payloadLen |= ((u16)c << 8);
-		if (payloadLen > 2048) {
-			mspState = MspState::IDLE;
+	}
+
+	if (!Command::activeLoopCommand) {
+		string response = CLI_PROMPT;
+		sendMsp(msgSetup, response.c_str(), response.length());
+	}
+}
+
+MSP_HANDLER(handleCliGetSuggestion) {
+	if (Command::activeLoopCommand) return sendMsp(msgSetup, reqPayload, 1);
+	std::vector<string> suggestions;
+	getCliSuggestions(string(reqPayload + 1, reqLen - 1), suggestions);
+	string response;
+	response = reqPayload[0]; // sequence byte
+	for (size_t i = 0; i < suggestions.size(); i++) {
+		const string &s = suggestions[i];
+		if (response.length() + s.length() + 1 >= 479) {
 			break;
 		}
-		crcV1 ^= c;
-		mspState = payloadLen ? MspState::PAYLOAD_V1 : MspState::CHECKSUM_V1;
-		break;
-	case MspState::PAYLOAD_V1:
-		crcV1 ^= c;
-		payloadBuf[payloadBufIndex++] = c;
-		if (payloadBufIndex == payloadLen)
-			mspState = MspState::CHECKSUM_V1;
+		if (i > 0) {
+			response += '\n';
+		}
+		response += s;
+	}
+	sendMsp(msgSetup, response.c_str(), response.length());
+}
+
+MSP_HANDLER(handleCliAbortCommand) {
+	if (Command::activeLoopCommand) {
+		Command::activeLoopCommand->abort();
+		Command::activeLoopCommand = nullptr;
+	}
+	sendMsp(msgSetup);
+}
+
+MSP_HANDLER(handleCliCheckRunning) {
+	buf[0] = Command::activeLoopCommand ? 1 : 0;
+	sendMsp(msgSetup, buf, 1);
+}
+
+MSP_HANDLER(handleSaveSettings) {
+	closeSettingsFile();
+	sendMsp(msgSetup);
+}
+
+MSP_HANDLER(handleGetOsdConfig) {
+	buf[0] = osdCanvasSizeSrc;
+	sendMsp(msgSetup, buf, 1);
+}
+
+MSP_HANDLER(handleSetOsdConfig) {
+	if (reqPayload[0] < 4) osdCanvasSizeSrc = reqPayload[0];
+	getSetting(SETTING_OSD_CANVAS_SIZE_SRC)->updateSettingInFile();
+	switch (osdCanvasSizeSrc) {
+	case 0: { // analog auto
+		u8 width, height;
+		AnalogOsdOutput::get().getSize(&width, &height);
+		OsdCanvas::get().setSize(width, height, 0);
+	} break;
+	case 1: { // analog PAL
+		OsdCanvas::get().setSize(OSD_WIDTH_PAL_NTSC, OSD_HEIGHT_PAL, 1);
+	} break;
+	case 2: { // analog NTSC
+		OsdCanvas::get().setSize(OSD_WIDTH_PAL_NTSC, OSD_HEIGHT_NTSC, 2);
+	} break;
+	case 3: { // digital
+		OsdCanvas::get().setSize(MSP_DP_DEFAULT_WIDTH, MSP_DP_DEFAULT_HEIGHT, 3);
+		for (auto &serial : serials) {
+			if (!serial) continue;
+			if (!serial->getDp()) continue;
+			serial->getDp()->propagateSize();
+		}
+	} break;
+	}
+	sendMsp(msgSetup);
+}
+
+MSP_HANDLER(handleOsdControl) {
+	switch (reqPayload[0]) {
+	case 0:
+		// add function MSP_DP to this serial
+		serial.setFunctionBits(SERIAL_MSP_DISPLAYPORT);
+		sendMsp(msgSetup);
 		break;
-	case MspState::FLAG_V2_OVER_V1:
-		msgFlag = c;
-		crcV1 ^= c;
-		CRC_LUT_D5_APPLY(crcV2, c);
-		mspState = MspState::CMD_LO_V2_OVER_V1;
+	case 1:
+		// remove function MSP_DP from this serial
+		serial.clearFunctionBits(SERIAL_MSP_DISPLAYPORT);
+		sendMsp(msgSetup);
 		break;
-	case MspState::CMD_LO_V2_OVER_V1:
-		fn = (MspFn)c;
-		crcV1 ^= c;
-		CRC_LUT_D5_APPLY(crcV2, c);
-		mspState = MspState::CMD_HI_V2_OVER_V1;
+	case 2:
+		// revert OSD setup to what it was before (moving tabs without saving)
+		OsdCanvas::get().revertElements();
+		sendMsp(msgSetup);
 		break;
-	case MspState::CMD_HI_V2_OVER_V1:
-		fn = (MspFn)((u32)fn | (u32)c << 8);
-		crcV1 ^= c;
-		CRC_LUT_D5_APPLY(crcV2, c);
-		mspState = MspState::LEN_LO_V2_OVER_V1;
+	case 3:
+		// optimize and save (requires fetching the setup again)
+		OsdCanvas::get().saveElements();
+		sendMsp(msgSetup);
 		break;
-	case MspState::LEN_LO_V2_OVER_V1:
-		payloadLen = c;
-		crcV1 ^= c;
-		CRC_LUT_D5_APPLY(crcV2, c);
-		mspState = MspState::LEN_HI_V2_OVER_V1;
+	case 4:
+		// draw cursor
+		RETURN_WITH_BASIC_ERROR_IF(reqLen < 3);
+		OsdCanvas::get().drawCursor(reqPayload[1], reqPayload[2]);
+		sendMsp(msgSetup);
 		break;
-	case MspState::LEN_HI_V2_OVER_V1:
-		payloadLen |= ((u16)c << 8);
-		if (payloadLen > 2048) {
-			mspState = MspState::IDLE;
-			break;
+	case 5:
+		// set drag and drop
+		RETURN_WITH_BASIC_ERROR_IF(reqLen < 5 || reqLen != reqPayload[3] * reqPayload[4] + 5);
+		OsdCanvas::get().setDragNDrop(reqPayload + 5, (i8)reqPayload[1], (i8)reqPayload[2], reqPayload[3], reqPayload[4]);
+		sendMsp(msgSetup);
+	}
+}
+
+MSP_HANDLER(handleGetOsdStatus) {
+	// bit 0: Analog OSD module detected
+	// bit 1: Analog OSD detected PAL
+	// bit 2: Analog OSD detected NTSC
+	buf[0] = 0;
+	if (AnalogOsdOutput::get().devDetected()) buf[0] |= 1 << 0;
+	if (AnalogOsdOutput::get().isPal()) buf[0] |= 1 << 1;
+	if (AnalogOsdOutput::get().isNtsc()) buf[0] |= 1 << 2;
+	// bitmap: At least one MSP message came from a serial within the last second
+	buf[1] = 0;
+	for (int i = 0; i < SERIAL_COUNT; i++) {
+		auto &serial = serials[i];
+		if (!serial) continue;
+		if (!(serial->functions() & (SERIAL_MSP | SERIAL_MSP_DISPLAYPORT))) continue;
+		if (serial->mspParser().getMessageCounter()) {
+			buf[1] |= 1 << i;
 		}
-		crcV1 ^= c;
-		CRC_LUT_D5_APPLY(crcV2, c);
-		mspState = payloadLen ? MspState::PAYLOAD_V2_OVER_V1 : MspState::CHECKSUM_V2_OVER_V1;
-		payloadBufIndex = 0;
-		break;
-	case MspState::PAYLOAD_V2_OVER_V1:
-		crcV1 ^= c;
-		CRC_LUT_D5_APPLY(crcV2, c);
-		payloadBuf[payloadBufIndex++] = c;
-		if (payloadBufIndex == payloadLen)
-			mspState = MspState::CHECKSUM_V2_OVER_V1;
-		break;
-	case MspState::CHECKSUM_V2_OVER_V1:
-		if (c != crcV2) {
-			mspState = MspState::IDLE;
-			MspMsgSetup s = {
-				.serial = ser,
-				.fn = fn,
-				.type = MspMsgType::ERROR,
-				.version = msgMspVer,
-			};
-			sendMsp(s, "CRCv2", 5);
+	}
+	sendMsp(msgSetup, buf, 2);
+}
+
+MSP_HANDLER(handleGetBbSettings) {
+#ifdef BLACKBOX_STORAGE
+	u8 bbSettings[11];
+	bbSettings[0] = bbFreqDivider;
+	bbSettings[9] = bbSyncFreq;
+	bbSettings[10] = bbKeepLogs;
+	memcpy(&bbSettings[1], &bbFlags, 8);
+	sendMsp(msgSetup, (char *)bbSettings, sizeof(bbSettings));
+#else
+	msgSetup.type = MspMsgType::ERROR;
+	sendMsp(msgSetup);
+#endif
+}
+
+MSP_HANDLER(handleSetBbSettings) {
+#ifdef BLACKBOX_STORAGE
+	bbFreqDivider = reqPayload[0];
+	bbSyncFreq = reqPayload[9];
+	memcpy(&bbFlags, &reqPayload[1], 8);
+	if (reqLen >= 11) bbKeepLogs = reqPayload[10]; // optional
+	sendMsp(msgSetup);
+	openSettingsFile();
+	getSetting(SETTING_BB_DIV)->updateSettingInFile();
+	getSetting(SETTING_BB_FLAGS)->updateSettingInFile();
+	getSetting(SETTING_BB_SYNC)->updateSettingInFile();
+	getSetting(SETTING_BB_KEEP_LOGS)->updateSettingInFile();
+#else
+	msgSetup.type = MspMsgType::ERROR;
+	sendMsp(msgSetup);
+#endif
+}
+
+MSP_HANDLER(handleBbFileList) {
+#ifdef BLACKBOX_STORAGE
+	int i = 0;
+	u16 b[500];
+#if BLACKBOX_STORAGE == SD_BB
+	FsFile dir = bbFs.open("/blackbox");
+	FsFile file;
+	while (file.openNext(&dir)) {
+		if (file.isFile()) {
+			char path[32];
+			file.getName(path, 32);
+			String name = path;
+			if (!name.startsWith("KOLI") || !name.endsWith(".kbb")) {
+				continue;
+			}
+			if (name.length() != 12) {
+				continue;
+			}
+			char num[5];
+			name.substring(4, 8).toCharArray(num, 5);
+			u32 index = 0;
+			for (int j = 0; j < 4; j++) {
+				if (num[j] < '0' || num[j] > '9') {
+					index = 99999;
+				}
+				index = index * 10 + (num[j] - '0');
+			}
+			if (index < 10000) {
+				b[i++] = index;
+			}
+		}
+		if (i >= 500) {
 			break;
 		}
-		crcV1 ^= c;
-		mspState = MspState::CHECKSUM_V1;
-		break;
-	case MspState::CHECKSUM_V1:
-		if (c == crcV1) {
-			messageCounter++;
-			processMspCmd(ser, msgType, fn, msgMspVer, payloadBuf, payloadLen);
+	}
+#elif BLACKBOX_STORAGE == FLASH_BB
+	if (bbFs.otherVersion) {
+		// written by a firmware with another storage format, only BB_FORMAT makes it usable
+		msgSetup.type = MspMsgType::ERROR;
+		sendMsp(msgSetup, FCKAFD_OTHER_VERSION_MSG, strlen(FCKAFD_OTHER_VERSION_MSG));
+		return;
+	}
+	int max = bbFs.getNewBbFileNum();
+	for (int j = 0; j < max; j++) {
+		if (bbFs.exists(j)) {
+			b[i++] = j;
+		}
+	}
+#endif // write nums into b
+	if (reqLen >= 1 && (reqPayload[0] & 1)) {
+		/* with summaries, paged
+		 * data of command
+		 * 0: flags, bit 0: include the log summary
+		 * 1-2: index of the first file to include (optional, default 0)
+		 *
+		 * data of response
+		 * 0-1: total number of files
+		 * 2-3: index of the first file in this response
+		 * then per file: 2 bytes file number, LOG_HEAD_SUMMARY_SIZE bytes summary, as many as fit into a frame of the request's MSP version
+		 */
+		u16 first = reqLen >= 3 ? DECODE_U2((u8 *)&reqPayload[1]) : 0;
+		u16 len = bbEncodeListPage((u8 *)buf, mspMaxResponse(version), b, i, first, LOG_HEAD_SUMMARY_SIZE, [](u16 logNum, u8 *summary) {
+			rp2040.wdt_reset();
+			return bbReadSummary(logNum, summary);
+		});
+		sendMsp(msgSetup, buf, len);
+		return;
+	}
+	sendMsp(msgSetup, (const char *)b, i * 2);
+#else // #ifdef BLACKBOX_STORAGE
+	sendMsp(msgSetup);
+#endif // #ifdef BLACKBOX_STORAGE
+}
+
+MSP_HANDLER(handleBbFileInfo) {
+#ifdef BLACKBOX_STORAGE
+	/* data of command
+	 * 0...len-1: file numbers (LE 2 bytes each)
+	 * (optional) last byte if reqLen is odd: flags, bit 0: include the log summary
+	 *
+	 * data of response
+	 * 0-1: file number
+	 * 2-5: file size in bytes
+	 * 6-8: version of bb file format
+	 * 9-12: time of recording start
+	 * 13-16: duration in ms
+	 * (optional) 17-48: log summary, zeros if not available
+	 * for up to 15 files, fewer if they don't fit into a frame of the request's MSP version
+	 */
+	bool withSummary = (reqLen & 1) && (reqPayload[reqLen - 1] & 1);
+	u16 len = reqLen / 2;
+	u16 maxFiles = bbInfoMaxFiles(mspMaxResponse(version), withSummary, LOG_HEAD_SUMMARY_SIZE);
+	if (len > maxFiles) len = maxFiles;
+	u16 entrySize = BB_INFO_ENTRY_SIZE + (withSummary ? LOG_HEAD_SUMMARY_SIZE : 0);
+	u16 fileNums[len];
+	memcpy(fileNums, reqPayload, len * 2);
+	u8 *buffer = (u8 *)buf;
+	u16 index = 0;
+	for (int i = 0; i < len; i++) {
+		rp2040.wdt_reset();
+		u16 fileNum = fileNums[i];
+#if BLACKBOX_STORAGE == SD_BB
+		char path[32];
+		snprintf(path, 32, "/blackbox/KOLI%04d.kbb", fileNum);
+		FsFile logFile = bbFs.open(path);
+#elif BLACKBOX_STORAGE == FLASH_BB
+		FlashFile logFile = bbFs.open(fileNum);
+#endif
+		if (!logFile) {
+			buffer[index++] = fileNum;
+			buffer[index++] = fileNum >> 8;
+			// print all zeros to indicate broken file
+			for (int i = 2; i < entrySize; i++)
+				buffer[index++] = 0;
 		} else {
-			MspMsgSetup s = {
-				.serial = ser,
-				.fn = fn,
-				.type = MspMsgType::ERROR,
-				.version = msgMspVer,
-			};
-			sendMsp(s, "CRCv1", 5);
+			buffer[index++] = fileNum;
+			buffer[index++] = fileNum >> 8;
+			buffer[index++] = logFile.size() & 0xFF;
+			buffer[index++] = (logFile.size() >> 8) & 0xFF;
+			buffer[index++] = (logFile.size() >> 16) & 0xFF;
+			buffer[index++] = (logFile.size() >> 24) & 0xFF;
+			logFile.seek(LOG_HEAD_BB_VERSION);
+			// version, timestamp, pid and divider can directly be read from the file
+			for (int i = 0; i < 7; i++)
+				buffer[index++] = logFile.read();
+			logFile.seek(LOG_HEAD_DURATION);
+			for (int i = 0; i < 4; i++)
+				buffer[index++] = logFile.read();
+			if (withSummary) {
+				memset(&buffer[index], 0, LOG_HEAD_SUMMARY_SIZE);
+				if (logFile.size() >= LOG_DATA_START) {
+					logFile.seek(LOG_HEAD_SUMMARY);
+					logFile.read(&buffer[index], LOG_HEAD_SUMMARY_SIZE);
+					if (buffer[index + LOG_SUMMARY_VERSION] != 1)
+						memset(&buffer[index], 0, LOG_HEAD_SUMMARY_SIZE);
+				}
+				index += LOG_HEAD_SUMMARY_SIZE;
+			}
+			logFile.close();
 		}
-		mspState = MspState::IDLE;
-		break;
-	case MspState::TYPE_V2:
-		mspState = MspState::FLAG_V2;
-		crcV2 = 0;
-		switch (c) {
-		case '<':
-			msgType = MspMsgType::REQUEST;
-			break;
-		case '>':
-			msgType = MspMsgType::RESPONSE;
-			break;
-		case '!':
-			msgType = MspMsgType::ERROR;
-			break;
-		default:
-			mspState = MspState::IDLE;
-			break;
+	}
+	sendMsp(msgSetup, (char *)buffer, index);
+#else
+	msgSetup.type = MspMsgType::ERROR;
+	sendMsp(msgSetup);
+#endif
+}
+
+MSP_HANDLER(handleBbFileDownload) {
+#ifdef BLACKBOX_STORAGE
+	u16 fileNum = DECODE_U2((u8 *)&reqPayload[0]);
+	i32 chunkNum = -1;
+	if (reqLen >= 6) {
+		chunkNum = DECODE_I4((u8 *)&reqPayload[2]);
+	}
+	printLogBin(serial, version, fileNum, chunkNum);
+#else
+	msgSetup.type = MspMsgType::ERROR;
+	sendMsp(msgSetup);
+#endif
+}
+
+MSP_HANDLER(handleBbFileDelete) {
+#ifdef BLACKBOX_STORAGE
+	// data just includes one byte of file number
+	u16 fileNum = DECODE_U2((u8 *)&reqPayload[0]);
+#if BLACKBOX_STORAGE == SD_BB
+	char path[32];
+	snprintf(path, 32, "/blackbox/KOLI%04d.kbb", fileNum);
+	if (!bbFs.remove(path))
+#elif BLACKBOX_STORAGE == FLASH_BB
+	if (!bbFs.remove(fileNum)) // refused while logging
+#endif // if (!remove)
+		msgSetup.type = MspMsgType::ERROR;
+	sendMsp(msgSetup, (char *)&fileNum, 2);
+#else // #ifdef BLACKBOX_STORAGE
+	msgSetup.type = MspMsgType::ERROR;
+	sendMsp(msgSetup);
+#endif // #ifdef BLACKBOX_STORAGE
+}
+
+MSP_HANDLER(handleBbStorageHealth) {
+#if BLACKBOX_STORAGE == FLASH_BB
+	/* data of response
+	 * 0-1: blocks of the blackbox partition
+	 * 2-3: bad blocks (found when formatting)
+	 * 4-5: blocks that failed since the last format and were replaced by spare blocks
+	 * 6-7: spare blocks left
+	 * 8-9: lowest erase count of a data block
+	 * 10-11: highest erase count of a data block
+	 * 12-15: sum of all erase counts
+	 * 16-19: program failures since boot
+	 * 20-23: erase failures since boot
+	 * 24-27: page cache hits since boot
+	 * 28-31: page cache misses since boot
+	 * 32-35: misses that the chip had already read ahead
+	 */
+	FckafdHealth h = bbFs.getHealth();
+	u8 buf[36];
+	memcpy(&buf[0], &h.blockCount, 2);
+	memcpy(&buf[2], &h.factoryBadBlocks, 2);
+	memcpy(&buf[4], &h.remappedBlocks, 2);
+	memcpy(&buf[6], &h.sparesLeft, 2);
+	memcpy(&buf[8], &h.minEraseCount, 2);
+	memcpy(&buf[10], &h.maxEraseCount, 2);
+	memcpy(&buf[12], &h.totalEraseCount, 4);
+	memcpy(&buf[16], &h.programFailures, 4);
+	memcpy(&buf[20], &h.eraseFailures, 4);
+	memcpy(&buf[24], &h.cacheHits, 4);
+	memcpy(&buf[28], &h.cacheMisses, 4);
+	memcpy(&buf[32], &h.readAheads, 4);
+	sendMsp(msgSetup, (char *)buf, sizeof(buf));
+#else
+	// SD cards handle bad blocks and wear leveling internally
+	msgSetup.type = MspMsgType::ERROR;
+	sendMsp(msgSetup);
+#endif
+}
+
+MSP_HANDLER(handleBbFormat) {
+#ifdef BLACKBOX_STORAGE
+	if (clearBlackbox())
+		sendMsp(msgSetup);
+	else
+		msgSetup.type = MspMsgType::ERROR;
+	sendMsp(msgSetup);
+#else
+	msgSetup.type = MspMsgType::ERROR;
+	sendMsp(msgSetup);
+#endif
+}
+
+MSP_HANDLER(handleBbFileInit) {
+#ifdef BLACKBOX_STORAGE
+	u16 fileNum = DECODE_U2((u8 *)&reqPayload[0]);
+	printFileInit(serial, version, fileNum);
+#else
+	msgSetup.type = MspMsgType::ERROR;
+	sendMsp(msgSetup);
+#endif
+}
+
+MSP_HANDLER(handleBbFastFileInit) {
+#ifdef BLACKBOX_STORAGE
+	u16 fileNum = DECODE_U2((u8 *)&reqPayload[0]);
+	u8 subCmd = reqPayload[2];
+	printFastFileInit(serial, version, fileNum, subCmd, reqPayload + 3, reqLen - 3);
+#else
+	msgSetup.type = MspMsgType::ERROR;
+	sendMsp(msgSetup);
+#endif
+}
+
+MSP_HANDLER(handleBbFastDataReq) {
+#ifdef BLACKBOX_STORAGE
+	/**
+	 * params:
+	 * - request identifier 2 byte (sequence number)
+	 * - file number to avoid confusion 2 byte
+	 * - size of regular frame 1 byte
+	 * - array of the following (length defines how many response frames are wanted)
+	 *   - requested frame number 4 byte
+	 *   - bitmask of what parts of that frame are wanted 1 byte
+	 *   - last sync pos before 4 byte
+	 */
+	u16 sequenceNum = DECODE_U2((u8 *)&reqPayload[0]);
+	u16 fileNum = DECODE_U2((u8 *)&reqPayload[2]);
+	u8 frameSize = reqPayload[4];
+	printFastDataReq(serial, version, sequenceNum, fileNum, frameSize, reqPayload + 5, reqLen - 5);
+#else
+	msgSetup.type = MspMsgType::ERROR;
+	sendMsp(msgSetup);
+#endif
+}
+
+MSP_HANDLER(handleBbCloseFile) {
+#ifdef BLACKBOX_STORAGE
+	bbClosePrintFile(serial, version);
+#else
+	msgSetup.type = MspMsgType::ERROR;
+	sendMsp(msgSetup);
+#endif
+}
+
+MSP_HANDLER(handleBbFileStream) {
+#ifdef BLACKBOX_STORAGE
+	bbFileStream(serial, version, reqPayload[0], reqPayload + 1, reqLen - 1);
+#else
+	msgSetup.type = MspMsgType::ERROR;
+	sendMsp(msgSetup);
+#endif
+}
+
+MSP_HANDLER(handleGetGpsStatus) {
+	buf[0] = gpsStatus.gpsInited;
+	buf[1] = gpsStatus.initStep;
+	buf[2] = gpsStatus.fixType;
+	buf[3] = gpsStatus.timeValidityFlags;
+	buf[4] = gpsStatus.flags;
+	buf[5] = gpsStatus.flags2;
+	buf[6] = gpsStatus.flags3 & 0xFF;
+	buf[7] = gpsStatus.flags3 >> 8;
+	buf[8] = gpsStatus.satCount;
+	sendMsp(msgSetup, buf, 9);
+}
+
+MSP_HANDLER(handleGetGpsAccuracy) {
+	// through padding and compiler optimization, it is not possible to just memcpy the struct
+	memcpy(buf, &gpsAcc.tAcc, 4);
+	memcpy(&buf[4], &gpsAcc.hAcc, 4);
+	memcpy(&buf[8], &gpsAcc.vAcc, 4);
+	memcpy(&buf[12], &gpsAcc.sAcc, 4);
+	memcpy(&buf[16], &gpsAcc.headAcc, 4);
+	memcpy(&buf[20], &gpsAcc.pDop, 4);
+	sendMsp(msgSetup, buf, 24);
+}
+
+MSP_HANDLER(handleGetGpsTime) {
+	buf[0] = gpsTime.tm_year & 0xFF;
+	buf[1] = gpsTime.tm_year >> 8;
+	buf[2] = gpsTime.tm_mon;
+	buf[3] = gpsTime.tm_mday;
+	buf[4] = gpsTime.tm_hour;
+	buf[5] = gpsTime.tm_min;
+	buf[6] = gpsTime.tm_sec;
+	sendMsp(msgSetup, buf, 7);
+}
+
+MSP_HANDLER(handleGetGpsMotion) {
+	memcpy(buf, &gpsMotion.lat, 4);
+	memcpy(&buf[4], &gpsMotion.lon, 4);
+	memcpy(&buf[8], &gpsMotion.alt, 4);
+	memcpy(&buf[12], &gpsMotion.velN, 4);
+	memcpy(&buf[16], &gpsMotion.velE, 4);
+	memcpy(&buf[20], &gpsMotion.velD, 4);
+	memcpy(&buf[24], &gpsMotion.gSpeed, 4);
+	memcpy(&buf[28], &gpsMotion.headMot, 4);
+	memcpy(&buf[32], &combinedAltitude.raw, 4);
+	memcpy(&buf[36], &vVel.raw, 4);
+	sendMsp(msgSetup, buf, 40);
+}
+
+MSP_HANDLER(handleGetMagData) {
+	i16 raw[6] = {(i16)magData[0], (i16)magData[1], (i16)magData[2], (i16)magRight.geti32(), (i16)magFront.geti32(), (i16)(magHeading * FIX_RAD_TO_DEG).geti32()};
+	sendMsp(msgSetup, (char *)raw, sizeof(raw));
+}
+
+MSP_HANDLER(handleGetBaroData) {
+	i32 raw[4] = {
+		(i32)(baroASL.raw / 66),
+		(i32)(baroPres * 1000),
+		(i32)(baroTemp * 100),
+		pressureRaw};
+	sendMsp(msgSetup, (char *)raw, sizeof(raw));
+}
+
+MSP_HANDLER(handleGetRotation) {
+	// https://en.wikipedia.org/wiki/Conversion_between_quaternions_and_Euler_angles
+	int rotationRoll = roll.raw >> 3;
+	int rotationPitch = pitch.raw >> 3;
+	int rotationYaw = yaw.raw >> 3;
+	int heading = combinedHeading.raw >> 3;
+	buf[0] = rotationRoll & 0xFF;
+	buf[1] = rotationRoll >> 8;
+	buf[2] = rotationPitch & 0xFF;
+	buf[3] = rotationPitch >> 8;
+	buf[4] = rotationYaw & 0xFF;
+	buf[5] = rotationYaw >> 8;
+	buf[6] = heading & 0xFF;
+	buf[7] = heading >> 8;
+	sendMsp(msgSetup, buf, 8);
+}
+
+MSP_HANDLER(handleGetImuSetupState) {
+	buf[0] = imuAlignmentStep;
+	buf[1] = imuAlignmentCounter * 100 / PID_FREQ;
+	getImuAlignment((u8 *)&buf[2]);
+	buf[5] = accelCalState;
+	buf[6] = HW_GYRO;
+	buf[7] = gyroReadyFlags;
+	sendMsp(msgSetup, buf, 8);
+}
+
+MSP_HANDLER(handleStartImuAlignment) {
+	startImuAlignment();
+	sendMsp(msgSetup);
+}
+
+MSP_HANDLER(handleTaskStatus) {
+	u32 *buf2 = (u32 *)buf;
+	for (int i = 0; i < TASK_LENGTH; i++) {
+		buf2[i * 7 + 0] = tasks[i].debugInfo;
+		buf2[i * 7 + 1] = tasks[i].minMaxDuration;
+		buf2[i * 7 + 2] = tasks[i].frequency;
+		buf2[i * 7 + 3] = tasks[i].lastTotalDuration;
+		buf2[i * 7 + 4] = tasks[i].errorCount;
+		buf2[i * 7 + 5] = tasks[i].lastError;
+		buf2[i * 7 + 6] = tasks[i].maxGap;
+	}
+	sendMsp(msgSetup, buf, TASK_LENGTH * 7 * 4);
+	for (int i = 0; i < TASK_LENGTH; i++) {
+		tasks[i].minMaxDuration = 0x7FFF0000;
+		tasks[i].maxGap = 0;
+	}
+}
+
+MSP_HANDLER(handleGetRxStatus) {
+	RETURN_WITH_BASIC_ERROR_IF(!elrs);
+	buf[0] = elrs->isReceiverUp;
+	buf[1] = elrs->isLinkUp;
+	buf[2] = elrs->uplinkRssi[0];
+	buf[3] = elrs->uplinkRssi[1];
+	buf[4] = elrs->uplinkLinkQuality;
+	buf[5] = elrs->uplinkSNR;
+	buf[6] = elrs->antennaSelection;
+	buf[7] = elrs->packetRateIdx;
+	memcpy(&buf[8], &elrs->txPower, 2);
+	memcpy(&buf[10], &elrs->targetPacketRate, 2);
+	memcpy(&buf[12], &elrs->actualPacketRate, 2);
+	memcpy(&buf[14], &elrs->rcMsgCount, 4);
+	sendMsp(msgSetup, buf, 18);
+}
+
+MSP_HANDLER(handleGetRxModes) {
+	mspGetRxModes(&serial, version);
+}
+
+MSP_HANDLER(handleSetRxModes) {
+	mspSetRxModes(&serial, version, reqPayload, reqLen);
+}
+
+MSP_HANDLER(handleCrsfScanDevices) {
+	RETURN_WITH_BASIC_ERROR_IF(!elrs);
+	elrs->scanDevices();
+	sendMsp(msgSetup);
+}
+
+MSP_HANDLER(handleCrsfGetDevices) {
+	RETURN_WITH_BASIC_ERROR_IF(!elrs);
+	std::list<CrsfDevice> devs = elrs->getDeviceList();
+	u32 count = devs.size();
+	RETURN_WITH_BASIC_ERROR_IF(count > 20);
+	char buf[47 * count];
+	u32 i = 0;
+	for (CrsfDevice dev : devs) {
+		memcpy(&buf[i], dev.name, 32);
+		i += 32;
+		buf[i++] = dev.address;
+		buf[i++] = dev.paramCount;
+		buf[i++] = dev.paramVersion;
+		memcpy(&buf[i], &dev.serialNo, 4);
+		i += 4;
+		memcpy(&buf[i], &dev.hardwareId, 4);
+		i += 4;
+		memcpy(&buf[i], &dev.firmwareId, 4);
+		i += 4;
+	}
+	sendMsp(msgSetup, buf, i);
+}
+
+MSP_HANDLER(handleCrsfSendMessage) {
+	RETURN_WITH_BASIC_ERROR_IF(!elrs);
+	// Configurator wants to send message to a device
+	u8 len = reqLen - 1;
+	u8 cmd = reqPayload[0];
+	elrs->sendPacket(cmd, &reqPayload[1], len);
+	sendMsp(msgSetup);
+}
+
+MSP_HANDLER(handleCrsfSubscribe) {
+	RETURN_WITH_BASIC_ERROR_IF(!elrs);
+	// Configurator wants to start or stop passthrough to a device
+	// => enable flags to forward any messages from said device to configurator
+	// MSP message data: device to forward from, start or stop, array of wanted commands
+	i16 subCount = reqLen - 2;
+	if (subCount > 20) subCount = 20;
+	u8 address = reqPayload[0];
+	if (subCount == 0 || reqPayload[1] == 0) {
+		// stop passthrough when receiving stop command or no functions
+		buf[0] = address;
+		buf[1] = 0;
+		elrs->setupSubscription(0, nullptr, 0, nullptr, MspVersion::V2);
+		return sendMsp(msgSetup, buf, 2);
+	}
+	RETURN_WITH_BASIC_ERROR_IF(address == 0);
+	if (elrs->setupSubscription(address, (const u8 *)&reqPayload[2], subCount, &serial, version)) {
+		buf[0] = address;
+		buf[1] = 1;
+		sendMsp(msgSetup, buf, 2);
+	} else {
+		SEND_BASIC_ERROR;
+	}
+}
+
+MSP_HANDLER(handleGetBatterySettings) {
+	u16 len = 0;
+	buf[len++] = cellCountSetting;
+	buf[len++] = emptyVoltageSetting;
+	buf[len++] = emptyVoltageSetting >> 8;
+	sendMsp(msgSetup, buf, len);
+}
+
+MSP_HANDLER(handleSetBatterySettings) {
+	cellCountSetting = reqPayload[0];
+	emptyVoltageSetting = reqPayload[1] | ((i16)reqPayload[2] << 8);
+	openSettingsFile();
+	getSetting(SETTING_CELL_COUNT)->updateSettingInFile();
+	getSetting(SETTING_EMPTY_VOLTAGE)->updateSettingInFile();
+	sendMsp(msgSetup);
+}
+
+MSP_HANDLER(handleGetMotorLayout) {
+	getMotorPins((u8 *)buf);
+	sendMsp(msgSetup, buf, 4);
+}
+
+MSP_HANDLER(handleSetMotorLayout) {
+	buf[0] = updateMotorPins((const u8 *)reqPayload);
+	sendMsp(msgSetup, buf, 1);
+}
+
+MSP_HANDLER(handleGetMotorState) {
+	for (int m = 0; m < 4; m++) {
+		u8 motor = 1 << 0; // motor output is enabled
+		motor |= 1 << 1; // output is bidir
+		if (escFound[m]) motor |= 1 << 2;
+		if (escEdtFound[m]) motor |= 1 << 3;
+		buf[m] = motor;
+	}
+	for (int m = 4; m < 8; m++) {
+		buf[m] = 0;
+	}
+	sendMsp(msgSetup, buf, 8);
+}
+
+MSP_HANDLER(handleGetVtxCurrentState) {
+	u8 len = sendTrampUpdateMsg(buf);
+	sendMsp(msgSetup, buf, len);
+}
+
+MSP_HANDLER(handleGetVtxConfig) {
+	u8 len = sendTrampConfigMsg(buf);
+	sendMsp(msgSetup, buf, len);
+}
+
+MSP_HANDLER(handleSetVtxConfig) {
+	setTrampConfig(reqPayload);
+	sendMsp(msgSetup);
+}
+
+MSP_HANDLER(handleVtxApplyConfig) {
+	applyTrampConfig();
+	sendMsp(msgSetup);
+}
+
+MSP_HANDLER(handleGetIoConstraints) {
+	u16 len = 0;
+	u8 page = 0;
+	if (reqLen) page = reqPayload[0];
+	bool suc = sendIoConstraints(page, buf, len);
+	if (!suc) msgSetup.type = MspMsgType::ERROR;
+	sendMsp(msgSetup, buf, len);
+}
+
+MSP_HANDLER(handleGetSerialSetup) {
+	u16 len = 0;
+	for (int i = 1; i < SERIAL_COUNT; i++) {
+		std::optional<KoliSerial> &serial = serials[i];
+		const SerialConfig &cfg = getSerialConfig(i);
+		buf[len] = 0;
+		if (!serial) {
+			len += 27; // TODO
+			continue;
 		}
-		break;
-	case MspState::FLAG_V2:
-		msgFlag = c;
-		CRC_LUT_D5_APPLY(crcV2, c);
-		mspState = MspState::CMD_LO_V2;
-		break;
-	case MspState::CMD_LO_V2:
-		fn = (MspFn)c;
-		CRC_LUT_D5_APPLY(crcV2, c);
-		mspState = MspState::CMD_HI_V2;
-		break;
-	case MspState::CMD_HI_V2:
-		fn = (MspFn)((u32)fn | (u32)c << 8);
-		CRC_LUT_D5_APPLY(crcV2, c);
-		mspState = MspState::LEN_LO_V2;
-		break;
-	case MspState::LEN_LO_V2:
-		payloadLen = c;
-		CRC_LUT_D5_APPLY(crcV2, c);
-		mspState = MspState::LEN_HI_V2;
-		break;
-	case MspState::LEN_HI_V2:
-		payloadLen |= ((u16)c << 8);
-		if (payloadLen > 2048) {
-			mspState = MspState::IDLE;
-			break;
+		KoliSerial &ser = *serial;
+		buf[len++] = 1; // serial exists
+		buf[len++] = (u8)ser.serialType;
+		memcpy(&buf[len], &ser.getBaudrate(), 4);
+		len += 4;
+		memcpy(&buf[len], &cfg.baud, 4);
+		len += 4;
+		buf[len++] = ser.getTxPin();
+		buf[len++] = ser.getRxPin();
+		memcpy(&buf[len], &ser.functions(), 4);
+		len += 4;
+		buf[len++] = cfg.hwParam;
+		buf[len++] = cfg.mspDpSettings;
+		buf[len++] = cfg.flags;
+		len += 8; // reserved
+	}
+	sendMsp(msgSetup, buf, len);
+}
+
+MSP_HANDLER(handleSetSerialSetup) {
+	// check new config options for validity
+	// 0: serial type (255 = disabled)
+	// 1: special hw info (pio index, serial number)
+	// 2-5: baudrate
+	// 6-9: functions
+	// 10: tx pin
+	// 11: rx pin
+	// 12: msp dp settings
+	// 13: flags (SERIAL_FLAG_)
+	// 14-21: reserved for future use, should be 0
+
+	// only allow full configs per serial, and first serial (USB) cannot be reconfigured
+	int totalSerials = reqLen / 22;
+	RETURN_WITH_BASIC_ERROR_IF(reqLen % 22 != 0);
+	bool ok = true;
+	string errorMsg = "You should not be able to even make something this incorrect. Configurator error.\n";
+	for (int i = 0; i < totalSerials; i++) {
+		const char *ser = &reqPayload[i * 22];
+		SerialType type = (SerialType)ser[0];
+		u8 hwParam = ser[1];
+		if (type == SerialType::DISABLED) continue; // serial disabled
+
+		// check if hardware is existent
+		if (type == SerialType::UART && hwParam >= NUM_UARTS) {
+			errorMsg += "Serial " + std::to_string(i) + " has HW UART index invalid.\n";
+			ok = false;
+			continue;
 		}
-		CRC_LUT_D5_APPLY(crcV2, c);
-		mspState = payloadLen ? MspState::PAYLOAD_V2 : MspState::CHECKSUM_V2;
-		break;
-	case MspState::PAYLOAD_V2:
-		CRC_LUT_D5_APPLY(crcV2, c);
-		payloadBuf[payloadBufIndex++] = c;
-		if (payloadBufIndex == payloadLen)
-			mspState = MspState::CHECKSUM_V2;
-		break;
-	case MspState::CHECKSUM_V2:
-		if (c == crcV2) {
-			messageCounter++;
-			processMspCmd(ser, msgType, fn, msgMspVer, payloadBuf, payloadLen);
-		} else {
-			MspMsgSetup s = {
-				.serial = ser,
-				.fn = fn,
-				.type = MspMsgType::ERROR,
-				.version = msgMspVer,
+		u8 rxPio = hwParam >> 4;
+		u8 txPio = hwParam & 0xF;
+		if (type >= SerialType::PIO && (rxPio >= NUM_PIOS || txPio >= NUM_PIOS)) {
+			errorMsg += "Serial " + std::to_string(i) + " invalid PIO index.\n";
+			ok = false;
+			continue;
+		}
+
+		// only UART until NUM_UARTS
+		if (i < NUM_UARTS && type >= SerialType::PIO) {
+			errorMsg += "Serial " + std::to_string(i) + " invalid type. First serials only HW UARTs.\n";
+			ok = false;
+			continue;
+		}
+		// UART number = HW UART index
+		if (i < NUM_UARTS && i != hwParam) {
+			errorMsg += "Serial " + std::to_string(i) + " needs to be the same number HW serial.\n";
+			ok = false;
+			continue;
+		}
+		// only allow PIO beyond NUM_UARTs
+		if (i >= NUM_UARTS && type < SerialType::PIO) {
+			errorMsg += "Serial " + std::to_string(i) + " invalid type. Serial 3+ only PIO/PIO HDx.\n";
+			ok = false;
+			continue;
+		}
+
+		// check baud and functions
+		u32 temp;
+		memcpy(&temp, &ser[2], 4);
+		if (temp && (temp < 1200 || temp > 10000000)) {
+			errorMsg += "Serial " + std::to_string(i) + " needs at least 1200 baud, maximum 10 MBaud.\n";
+			ok = false;
+			continue;
+		}
+		memcpy(&temp, &ser[6], 4);
+		if (temp >> SERIAL_FUNCTION_COUNT) {
+			errorMsg += "Serial " + std::to_string(i) + " requests invalid function.\n";
+			ok = false;
+			continue;
+		}
+		if ((temp & SERIAL_AUTO_DETECT) && temp != SERIAL_AUTO_DETECT) {
+			errorMsg += "Serial " + std::to_string(i) + ": auto detect cannot be combined with other functions.\n";
+			ok = false;
+			continue;
+		}
+		if ((u8)ser[13] >> SERIAL_FLAG_COUNT) {
+			errorMsg += "Serial " + std::to_string(i) + " requests invalid flags.\n";
+			ok = false;
+			continue;
+		}
+
+		// check pins
+		bool pinok = true;
+		if (type == SerialType::UART) {
+			u8 pin = ser[10]; // tx
+			pinok &= pinHasHwUart(pin, hwParam, true);
+			pin = ser[11]; // rx
+			pinok &= pinHasHwUart(pin, hwParam, false);
+		}
+		if (!pinok) {
+			errorMsg += "Serial " + std::to_string(i + 1) + " cannot use one of the provided pins.\n";
+			ok = false;
+			continue;
+		}
+	}
+	if (!ok) {
+		msgSetup.type = MspMsgType::ERROR;
+		return sendMsp(msgSetup, errorMsg.c_str(), errorMsg.length());
+	}
+
+	SerialConfig newCfgs[SERIAL_COUNT - 1];
+	stopSerials();
+
+	for (int i = 0; i < SERIAL_COUNT - 1; i++) {
+		if (i >= totalSerials) {
+			// serial is unconfigured => insert DISABLED
+			newCfgs[i] = {
+				.type = SerialType::DISABLED,
+				.hwParam = 255,
+				.txPin = 255,
+				.rxPin = 255,
+				.baud = 0,
+				.functions = 0,
+			};
+			continue;
+		}
+
+		const u8 *ser = (const u8 *)&reqPayload[i * 22];
+		if (ser[0] == 255) {
+			// serial is disabled
+			newCfgs[i] = {
+				.type = SerialType::DISABLED,
+				.hwParam = 255,
+				.txPin = 255,
+				.rxPin = 255,
+				.baud = 0,
+				.functions = 0,
 			};
-			sendMsp(s, "CRCv2", 5);
+			continue;
 		}
-		mspState = MspState::IDLE;
+
+		newCfgs[i] = {
+			.type = (SerialType)ser[0],
+			.hwParam = (u8)ser[1],
+			.txPin = (u8)ser[10],
+			.rxPin = (u8)ser[11],
+			.mspDpSettings = ser[12],
+			.flags = ser[13],
+		};
+		memcpy(&newCfgs[i].baud, &ser[2], 4);
+		memcpy(&newCfgs[i].functions, &ser[6], 4);
+	}
+
+	buf[0] = startSerials(newCfgs);
+	if (buf[0]) {
+		openSettingsFile();
+		getSetting(SETTING_SERIAL_CONFIGS)->updateSettingInFile();
+	} else {
+		revertSerials();
+	}
+	sendMsp(msgSetup, buf, 1);
+}
+
+MSP_HANDLER(handleGetTzOffset) {
+	buf[0] = rtcTimezoneOffset;
+	buf[1] = rtcTimezoneOffset >> 8;
+	sendMsp(msgSetup, buf, 2);
+}
+
+MSP_HANDLER(handleSetTzOffset) {
+	i16 offset = DECODE_I2((u8 *)reqPayload);
+	RETURN_WITH_BASIC_ERROR_IF(offset > 14 * 60 || offset < -12 * 60);
+	rtcTimezoneOffset = offset;
+	openSettingsFile();
+	getSetting(SETTING_TIMEZONE_OFFSET)->updateSettingInFile();
+	sendMsp(msgSetup);
+}
+
+MSP_HANDLER(handleGetPids) {
+	// copying just for future proofing, in case more things are added
+	u16 pids[3][5];
+	for (int i = 0; i < 3; i++) {
+		pids[i][0] = pidGainsNice[i][0];
+		pids[i][1] = pidGainsNice[i][1];
+		pids[i][2] = pidGainsNice[i][2];
+		pids[i][3] = pidGainsNice[i][3];
+		pids[i][4] = pidGainsNice[i][4];
+	}
+	sendMsp(msgSetup, (char *)pids, sizeof(pids));
+}
+
+MSP_HANDLER(handleSetPids) {
+	u16 pids[3][5];
+	memcpy(pids, reqPayload, sizeof(pids));
+	for (int i = 0; i < 3; i++) {
+		pidGainsNice[i][0] = pids[i][0];
+		pidGainsNice[i][1] = pids[i][1];
+		pidGainsNice[i][2] = pids[i][2];
+		pidGainsNice[i][3] = pids[i][3];
+		pidGainsNice[i][4] = pids[i][4];
+	}
+	convertPidsFromNice();
+	openSettingsFile();
+	getSetting(SETTING_PID_GAINS)->updateSettingInFile();
+	sendMsp(msgSetup);
+}
+
+MSP_HANDLER(handleGetRates) {
+	i16 rates[3][3];
+	for (int ax = 0; ax < 3; ax++) {
+		rates[ax][ACTUAL_CENTER_SENSITIVITY] = rateCoeffs[ax][ACTUAL_CENTER_SENSITIVITY].geti32();
+		rates[ax][ACTUAL_MAX_RATE] = rateCoeffs[ax][ACTUAL_MAX_RATE].geti32();
+		rates[ax][ACTUAL_EXPO] = rateCoeffs[ax][ACTUAL_EXPO].raw >> 3; // expo, 3.13 fixed point
+	}
+	sendMsp(msgSetup, (char *)rates, sizeof(rates));
+}
+
+MSP_HANDLER(handleSetRates) {
+	i16 rates[3][3];
+	memcpy(rates, reqPayload, sizeof(rates));
+	for (int ax = 0; ax < 3; ax++) {
+		if (rates[ax][ACTUAL_CENTER_SENSITIVITY] > rates[ax][ACTUAL_MAX_RATE]) {
+			rates[ax][ACTUAL_MAX_RATE] = rates[ax][ACTUAL_CENTER_SENSITIVITY];
+		}
+		rateCoeffs[ax][ACTUAL_CENTER_SENSITIVITY] = rates[ax][ACTUAL_CENTER_SENSITIVITY];
+		rateCoeffs[ax][ACTUAL_MAX_RATE] = rates[ax][ACTUAL_MAX_RATE];
+		rateCoeffs[ax][ACTUAL_EXPO].raw = (i32)rates[ax][ACTUAL_EXPO] << 3; // 3.13 fixed point for expo (normally [0,1], but technically [-4,4) are allowed here)
+	}
+	sendMsp(msgSetup);
+	openSettingsFile();
+	getSetting(SETTING_RATE_COEFFS)->updateSettingInFile();
+}
+
+MSP_HANDLER(handleGetExtPid) {
+	u16 len = 0;
+	u16 ifall = iFalloff.geti32();
+	buf[len++] = ifall & 0xFF;
+	buf[len++] = ifall >> 8;
+	buf[len++] = useDynamicIdle;
+	buf[len++] = idlePermille;
+	buf[len++] = dynamicIdleRpm;
+	buf[len++] = dynamicIdleRpm >> 8;
+	sendMsp(msgSetup, buf, len);
+}
+
+MSP_HANDLER(handleSetExtPid) {
+	iFalloff = DECODE_U2(reqPayload);
+	useDynamicIdle = reqPayload[2];
+	idlePermille = reqPayload[3];
+	dynamicIdleRpm = DECODE_U2(&reqPayload[4]);
+	sendMsp(msgSetup);
+	openSettingsFile();
+	getSetting(SETTING_IFALLOFF)->updateSettingInFile();
+	getSetting(SETTING_DYNAMIC_IDLE_EN)->updateSettingInFile();
+	getSetting(SETTING_IDLE_PERMILLE)->updateSettingInFile();
+	getSetting(SETTING_DYNAMIC_IDLE_RPM)->updateSettingInFile();
+}
+
+MSP_HANDLER(handleGetFilterConfig) {
+	u16 len = 0;
+	buf[len++] = gyroFilterCutoff & 0xFF;
+	buf[len++] = gyroFilterCutoff >> 8;
+	u16 data = accelFilterCutoff.geti32();
+	buf[len++] = data & 0xFF;
+	buf[len++] = data >> 8;
+	buf[len++] = dFilterCutoff & 0xFF;
+	buf[len++] = dFilterCutoff >> 8;
+	data = (setpointDiffCutoff * 10 + 0.5f).geti32();
+	buf[len++] = data & 0xFF;
+	buf[len++] = data >> 8;
+	data = (magFilterCutoff * 100 + 0.5f).geti32();
+	buf[len++] = data & 0xFF;
+	buf[len++] = data >> 8;
+	data = (vvelFFFilterCutoff * 100 + 0.5f).geti32();
+	buf[len++] = data & 0xFF;
+	buf[len++] = data >> 8;
+	data = (vvelDFilterCutoff * 10 + 0.5f).geti32();
+	buf[len++] = data & 0xFF;
+	buf[len++] = data >> 8;
+	data = (hvelFfFilterCutoff * 100 + 0.5f).geti32();
+	buf[len++] = data & 0xFF;
+	buf[len++] = data >> 8;
+	data = (hvelIRelaxFilterCutoff * 100 + 0.5f).geti32();
+	buf[len++] = data & 0xFF;
+	buf[len++] = data >> 8;
+	data = (hvelPushFilterCutoff * 10 + 0.5f).geti32();
+	buf[len++] = data & 0xFF;
+	buf[len++] = data >> 8;
+	data = (gpsVelocityFilterCutoff * 100 + 0.5f).geti32();
+	buf[len++] = data & 0xFF;
+	buf[len++] = data >> 8;
+	sendMsp(msgSetup, buf, len);
+}
+
+MSP_HANDLER(handleSetFilterConfig) {
+	openSettingsFile();
+
+	gyroFilterCutoff = DECODE_U2((u8 *)&reqPayload[0]);
+	getSetting(SETTING_GYRO_FILTER_CUTOFF)->updateSettingInFile();
+
+	accelFilterCutoff = DECODE_U2((u8 *)&reqPayload[2]);
+	getSetting(SETTING_ACC_FILTER_CUTOFF)->updateSettingInFile();
+
+	dFilterCutoff = DECODE_U2((u8 *)&reqPayload[4]);
+	getSetting(SETTING_DFILTER_CUTOFF)->updateSettingInFile();
+
+	setpointDiffCutoff = DECODE_U2((u8 *)&reqPayload[6]) / 10.0f;
+	getSetting(SETTING_SETPOINT_DIFF_CUTOFF)->updateSettingInFile();
+
+	magFilterCutoff = DECODE_U2((u8 *)&reqPayload[8]) / 100.0f;
+	getSetting(SETTING_MAG_FILTER_CUTOFF)->updateSettingInFile();
+
+	vvelFFFilterCutoff = DECODE_U2((u8 *)&reqPayload[10]) / 100.0f;
+	getSetting(SETTING_VVEL_FF_FILTER_CUTOFF)->updateSettingInFile();
+
+	vvelDFilterCutoff = DECODE_U2((u8 *)&reqPayload[12]) / 10.0f;
+	getSetting(SETTING_VVEL_D_FILTER_CUTOFF)->updateSettingInFile();
+
+	hvelFfFilterCutoff = DECODE_U2((u8 *)&reqPayload[14]) / 100.0f;
+	getSetting(SETTING_HVEL_FF_FILTER_CUTOFF)->updateSettingInFile();
+
+	hvelIRelaxFilterCutoff = DECODE_U2((u8 *)&reqPayload[16]) / 100.0f;
+	getSetting(SETTING_HVEL_I_RELAX_FILTER_CUTOFF)->updateSettingInFile();
+
+	hvelPushFilterCutoff = DECODE_U2((u8 *)&reqPayload[18]) / 10.0f;
+	getSetting(SETTING_HVEL_PUSH_FILTER_CUTOFF)->updateSettingInFile();
+
+	gpsVelocityFilterCutoff = DECODE_U2((u8 *)&reqPayload[20]) / 100.0f;
+	getSetting(SETTING_GPS_VEL_FILTER_CUTOFF)->updateSettingInFile();
+
+	sendMsp(msgSetup);
+}
+
+MSP_HANDLER(handleGetCrashDump) {
+	// CrashDump of the previous boot as is, see crashDump.h and python/crashDump.py. Empty if there was no crash
+	if (lastCrash.reason == CrashReason::NONE)
+		sendMsp(msgSetup);
+	else
+		sendMsp(msgSetup, (char *)&lastCrash, sizeof(lastCrash));
+}
+
+MSP_HANDLER(handleClearCrashDump) {
+	clearCrashDump();
+	sendMsp(msgSetup);
+}
+
+MSP_HANDLER(handleSetDebugLed) {
+	p.neoPixelSetValue(1, reqPayload[0] * 255, reqPayload[0] * 255, reqPayload[0] * 255, true);
+	sendMsp(msgSetup);
+}
+
+MSP_HANDLER(handlePlaySound) {
+	const u16 startFreq = random(1000, 5000);
+	const u16 endFreq = random(1000, 5000);
+	const u16 sweepDuration = random(400, 1000);
+	u16 pauseDuration = random(100, 1000);
+	const u16 pauseEn = random(0, 2);
+	pauseDuration *= pauseEn;
+	const u16 repeat = random(1, 11);
+	makeSweepSound(startFreq, endFreq, ((sweepDuration + pauseDuration) * repeat) - 1, sweepDuration, pauseDuration);
+	u8 len = 0;
+	buf[len++] = startFreq & 0xFF;
+	buf[len++] = startFreq >> 8;
+	buf[len++] = endFreq & 0xFF;
+	buf[len++] = endFreq >> 8;
+	buf[len++] = sweepDuration & 0xFF;
+	buf[len++] = sweepDuration >> 8;
+	buf[len++] = pauseDuration & 0xFF;
+	buf[len++] = pauseDuration >> 8;
+	buf[len++] = pauseEn;
+	buf[len++] = repeat;
+	buf[len++] = (((sweepDuration + pauseDuration) * repeat) - 1) & 0xFF;
+	buf[len++] = (((sweepDuration + pauseDuration) * repeat) - 1) >> 8;
+	sendMsp(msgSetup, buf, len);
+}
+
+MSP_HANDLER(handleDebugSensors) {
+	memcpy(buf, mspDebugSensors, sizeof(mspDebugSensors));
+	sendMsp(msgSetup, buf, sizeof(mspDebugSensors));
+}
+
+#define MSP_HANDLER_ENTRY(fn, handler, minLen, maxLen, flags, rev) handler,
+static const MspHandler mspHandlers[] = {MSP_COMMAND_LIST(MSP_HANDLER_ENTRY)};
+static_assert(22 * (SERIAL_COUNT - 1) == 88, "update the maxLen of SET_SERIAL_SETUP in mspRegistry.h");
+static char mspBuf[2048]; // response buffer of the handlers
+
+void processMspCmd(KoliSerial &serial, MspMsgType type, MspFn fn, MspVersion version, const char *reqPayload, u16 reqLen) {
+	serial.lastMspVersion = version;
+	if (type != MspMsgType::REQUEST) return;
+	MspMsgSetup msgSetup = {
+		.serial = serial,
+		.fn = fn,
+		.type = MspMsgType::RESPONSE,
+		.version = version,
+	};
+
+	MspCheck check = mspDispatch(mspHandlers, fn, reqLen, armed, serial, msgSetup, version, reqPayload, reqLen, mspBuf);
+	if (check != MspCheck::OK) {
+		msgSetup.type = MspMsgType::ERROR;
+		const char *msg = mspCheckMessage(check);
+		sendMsp(msgSetup, msg, strlen(msg));
+	}
+}
+
+void mspStreamLoop(KoliSerial &serial) {
+	MspStreams &streams = serial.mspParser().streams();
+	if (!streams.count()) return;
+	if (!serial) {
+		// port stopped, or on USB: the host closed it
+		streams.clear();
+		return;
+	}
+	streams.setLinkRate(serial.serialType == SerialType::USB ? MSP_STREAM_USB_BPS : serial.getBaudrate() / 10);
+	u32 now = time_us_32();
+	i32 i = streams.next(now, serial.availableForWrite());
+	if (i < 0) return;
+
+	// same response as to a request, the host can't tell the difference
+	MspFn fn = streams.get(i).fn;
+	MspMsgSetup msgSetup = {
+		.serial = serial,
+		.fn = fn,
+		.type = MspMsgType::RESPONSE,
+		.version = serial.lastMspVersion,
+	};
+	u32 before = serial.txPushed();
+	mspHandlers[mspFindCommand(fn)](serial, msgSetup, serial.lastMspVersion, "", 0, mspBuf);
+	streams.sent(i, now, serial.txPushed() - before);
+}
+
+void MspParser::handleByte(u8 c) {
+	TASK_START(TASK_CONFIGURATOR);
+
+	const MspFramer::Result res = framer.handleByte(c);
+	switch (res) {
+	case MspFramer::NONE:
+		break;
+	case MspFramer::FRAME:
+		messageCounter++;
+		mspStreams.hostSeen(time_us_32());
+		processMspCmd(ser, framer.type, framer.fn, framer.version, framer.payload, framer.payloadLen);
 		break;
+	case MspFramer::ERROR_CRC_V1:
+	case MspFramer::ERROR_CRC_V2: {
+		MspMsgSetup s = {
+			.serial = ser,
+			.fn = framer.fn,
+			.type = MspMsgType::ERROR,
+			.version = framer.version,
+		};
+		sendMsp(s, res == MspFramer::ERROR_CRC_V1 ? "CRCv1" : "CRCv2", 5);
+	} break;
 	}
 	TASK_END(TASK_CONFIGURATOR);
 }
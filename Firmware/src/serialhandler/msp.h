@@ -56,204 +56,23 @@
  */
 
 #pragma once
+#include "mspFramer.h"
+#include "mspRegistry.h"
+#include "mspStream.h"
+#include "mspTransfer.h"
+#include "mspWriter.h"
 #include <Arduino.h>
 
 class KoliSerial;
 extern i16 mspDebugSensors[4]; // write values here to see them in the sensors tab. +-100, +-1000, +-10000, +-256
 
-/**
- * @brief MSP Serial Functions
- *
- * @details These commands are used to communicate with the configurator and other peripherals. For Kolibri specific functions, the space 0x4000-0x4FFF is used. More details: https://github.com/iNavFlight/inav/wiki/MSP-V2
- */
-enum class MspFn : u16 {
-	API_VERSION = 1,
-	FIRMWARE_VARIANT = 2,
-	FIRMWARE_VERSION = 3,
-	BOARD_INFO = 4,
-	BUILD_INFO = 5,
-	GET_NAME = 10,
-	SET_NAME = 11,
-	GET_FEATURE_CONFIG = 36,
-	REBOOT = 68,
-	GET_ADVANCED_CONFIG = 90,
-	SET_ARMING_DISABLED = 99,
-	MSP_STATUS = 101,
-	MSP_RAW_IMU = 102,
-	GET_MOTOR = 104,
-	RC = 105,
-	MSP_ATTITUDE = 108,
-	MSP_ALTITUDE = 109,
-	MSP_ANALOG = 110,
-	BOXIDS = 119,
-	GET_MOTOR_3D_CONFIG = 124,
-	MSP_BATTERY_STATE = 130,
-	GET_MOTOR_CONFIG = 131,
-	UID = 160,
-	MSP_DISPLAYPORT = 182,
-	MSP_SET_OSD_CANVAS = 188,
-	MSP_GET_OSD_CANVAS = 189,
-	ACC_CALIBRATION = 205,
-	MAG_CALIBRATION = 206,
-	SET_MOTOR = 214,
-	ENABLE_4WAY_IF = 245,
-	SET_RTC = 246,
-	GET_RTC = 247,
-	MSP_V2_FRAME = 255,
-
-	// 0x400_ Configurator related commands
-	STATUS = 0x4000,
-	CONFIGURATOR_PING = 0x4001,
-	IND_MESSAGE = 0x4002,
-
-	// 0x401_ Entering special modes
-	SERIAL_PASSTHROUGH = 0x4010,
-	SERIAL_SNIFF = 0x4011,
-
-	// 0x402_ CLI
-	CLI_INIT = 0x4020,
-	CLI_COMMAND = 0x4021,
-	CLI_GET_SUGGESTION = 0x4022,
-	CLI_ABORT_COMMAND = 0x4023,
-	CLI_CHECK_RUNNING = 0x4024,
-
-	// 0x410_ Settings Meta commands
-	SAVE_SETTINGS = 0x4100,
-
-	// 0x411_ OSD settings
-	WRITE_OSD_FONT_CHARACTER = 0x4110,
-	GET_OSD_ELEMENTS = 0x4111,
-	SET_OSD_ELEMENTS = 0x4112,
-	GET_OSD_CONFIG = 0x4113,
-	SET_OSD_CONFIG = 0x4114,
-	OSD_CONTROL = 0x4115,
-	GET_OSD_STATUS = 0x4116,
-
-	// 0x412_ Blackbox
-	GET_BB_SETTINGS = 0x4120,
-	SET_BB_SETTINGS = 0x4121,
-	BB_FILE_LIST = 0x4122,
-	BB_FILE_INFO = 0x4123,
-	BB_FILE_DOWNLOAD = 0x4124,
-	BB_FILE_DELETE = 0x4125,
-	BB_FORMAT = 0x4126,
-	BB_FILE_INIT = 0x4127,
-	BB_FAST_FILE_INIT = 0x4128,
-	BB_FAST_DATA_REQ = 0x4129,
-	BB_CLOSE_FILE = 0x412A,
-
-	// 0x413_ GPS
-	GET_GPS_STATUS = 0x4130,
-	GET_GPS_ACCURACY = 0x4131,
-	GET_GPS_TIME = 0x4132,
-	GET_GPS_MOTION = 0x4133,
-
-	// 0x414_ Magnetometer
-	GET_MAG_DATA = 0x4140,
-
-	// 0x415_ Gyro/Accel
-	GET_ROTATION = 0x4150,
-	GET_IMU_SETUP_STATE = 0x4151,
-	START_IMU_ALIGNMENT = 0x4152,
-
-	// 0x416_ Barometer
-	GET_BARO_DATA = 0x4160,
-
-	// 0x417_ Task Manager
-	TASK_STATUS = 0x4170,
-
-	// 0x418_ Receiver
-	GET_RX_STATUS = 0x4180,
-	GET_RX_MODES = 0x4181,
-	SET_RX_MODES = 0x4182,
-	CRSF_SCAN_DEVICES = 0x4183,
-	CRSF_GET_DEVICES = 0x4184,
-	CRSF_SEND_MESSAGE = 0x4185,
-	CRSF_SUBSCRIBE = 0x4186,
-	CRSF_GOT_MESSAGE = 0x4187,
-
-	// 0x419_ Battery
-	GET_BATTERY_SETTINGS = 0x4190,
-	SET_BATTERY_SETTINGS = 0x4191,
-
-	// 0x41A_ Motors
-	GET_MOTOR_LAYOUT = 0x41A0,
-	SET_MOTOR_LAYOUT = 0x41A1,
-	GET_MOTOR_STATE = 0x41A2,
-
-	// 0x41B_ VTX
-	GET_VTX_CURRENT_STATE = 0x41B0,
-	GET_VTX_CONFIG = 0x41B1,
-	SET_VTX_CONFIG = 0x41B2,
-	VTX_APPLY_CONFIG = 0x41B3,
-
-	// 0x41C_ Serial setup
-	GET_IO_CONSTRAINTS = 0x41C0,
-	GET_SERIAL_SETUP = 0x41C1,
-	SET_SERIAL_SETUP = 0x41C2,
-
-	// 0x41F_ Misc (not worth a category)
-	GET_TZ_OFFSET = 0x41F0,
-	SET_TZ_OFFSET = 0x41F1,
-
-	// 0x42__ Tuning
-	// 0x420_ Flight Performance (Acro Mode)
-	GET_PIDS = 0x4200,
-	SET_PIDS = 0x4201,
-	GET_RATES = 0x4202,
-	SET_RATES = 0x4203,
-	GET_EXT_PID = 0x4204,
-	SET_EXT_PID = 0x4205,
-	GET_FILTER_CONFIG = 0x4206,
-	SET_FILTER_CONFIG = 0x4207,
-
-	// 0x421_ Angle Mode
-
-	// 0x422_ Altitude and Position Hold
-
-	// 0x4F00-0x4F1F general debug tools
-	GET_CRASH_DUMP = 0x4F00,
-	CLEAR_CRASH_DUMP = 0x4F01,
-	SET_DEBUG_LED = 0x4F02,
-	PLAY_SOUND = 0x4F03,
-	DEBUG_SENSORS = 0x4F04,
-
-	// 0x4F20-0x4FFF temporary debug tools
-};
-
-enum class MspState {
-	IDLE, // waiting for $
-	PACKET_START, // receiving M or X
-	TYPE_V1, // got M, receiving type byte (<, >, !)
-	LEN_V1, // if 255 is received in this step, inject jumbo len bytes
-	CMD_V1,
-	JUMBO_LEN_LO_V1,
-	JUMBO_LEN_HI_V1,
-	PAYLOAD_V1,
-	FLAG_V2_OVER_V1,
-	CMD_LO_V2_OVER_V1,
-	CMD_HI_V2_OVER_V1,
-	LEN_LO_V2_OVER_V1,
-	LEN_HI_V2_OVER_V1,
-	PAYLOAD_V2_OVER_V1,
-	CHECKSUM_V2_OVER_V1,
-	CHECKSUM_V1,
-	TYPE_V2, // got X, receiving type byte (<, >, !)
-	FLAG_V2,
-	CMD_LO_V2,
-	CMD_HI_V2,
-	LEN_LO_V2,
-	LEN_HI_V2,
-	PAYLOAD_V2,
-	CHECKSUM_V2,
-};
-
 #define MSP_PROTOCOL_VERSION 0
 #define API_VERSION_MAJOR 3
-#define API_VERSION_MINOR 0
+#define API_VERSION_MINOR 4
 
 #define KOLIBRI_IDENTIFIER "KOLI" // Baseflight: BAFL, Betaflight: BTFL, Cleanflight: CLFL, iNav: INAV, MultiWii: MWII, Raceflight: RCFL
 #define FIRMWARE_IDENTIFIER_LENGTH 4
+#define MSP_RX_TIMEOUT_US 100000 // a frame that stalls for this long is dropped
 
 enum class McuType : u8 {
 	SIMULATOR = 0,
@@ -278,22 +97,6 @@ enum class McuType : u8 {
 	UNKNOWN = 255,
 };
 
-enum class MspMsgType : char {
-	REQUEST = '<',
-	RESPONSE = '>',
-	ERROR = '!',
-};
-
-enum class MspVersion : char {
-	V2,
-	V1,
-	V1_JUMBO,
-	V2_OVER_V1,
-
-	V2_OVER_CRSF,
-	V1_OVER_CRSF,
-	V1_JUMBO_OVER_CRSF,
-};
 typedef struct mspMsgSetup {
 	KoliSerial &serial;
 	MspFn fn;
@@ -312,6 +115,22 @@ extern KoliSerial *lastMspSerial;
  */
 void sendMsp(MspMsgSetup setup, const char *data = nullptr, u16 len = 0);
 
+/**
+ * @brief Response that is written field by field instead of from a buffer
+ *
+ * @details V2 on a serial port goes straight into the TX ring (MspWriter), everything else (V1, MSP over CRSF) is collected in a scratch buffer and sent with sendMsp() in finish(). Give the length if it is known, then the response can be bigger than the TX ring. Don't write to the port by other means until finish().
+ */
+class MspResponse : public MspWriter {
+public:
+	MspResponse(const MspMsgSetup &setup, i32 len = -1);
+	~MspResponse() { finish(); }
+	/// @brief sends the response, returns the payload length or -1 if it was dropped
+	i32 finish();
+
+private:
+	MspMsgSetup setup;
+};
+
 class MspParser {
 public:
 	MspParser(KoliSerial &ser) : ser(ser) {}
@@ -323,26 +142,24 @@ public:
 	 */
 	void handleByte(u8 c);
 
+	/// @brief drops a partially received frame, e.g. after the line went idle
+	void abortFrame() { framer.abort(); }
+
 	void resetMessageCounter() {
 		lastMessageCounter = messageCounter;
 		messageCounter = 0;
 	}
 	int getMessageCounter() const { return lastMessageCounter; }
 
+	/// @brief responses the host subscribed to with STREAM_SUBSCRIBE
+	MspStreams &streams() { return mspStreams; }
+
 private:
-	char payloadBuf[2048] = {0}; // Payload buffer
-	u16 payloadBufIndex = 0; // Payload buffer index (0-2047)
-	u16 payloadLen = 0; // Payload Lenght
-	MspFn fn = MspFn::API_VERSION; // MSP function
-	MspMsgType msgType = MspMsgType::ERROR; // Message type
-	u8 msgFlag = 0; // Message flag
-	u32 crcV1 = 0; // Checksum for MSP V1 messages
-	u32 crcV2 = 0; // Checksum for MSP V2 messages
-	MspState mspState = MspState::IDLE; // MSP state
-	MspVersion msgMspVer; // MSP version
+	MspFramer framer;
 	KoliSerial &ser;
 	u32 messageCounter = 0; // used to sense activity
 	u32 lastMessageCounter = 0; // used to sense activity
+	MspStreams mspStreams;
 };
 
 /// @brief counter for the motor override timeout
@@ -354,5 +171,8 @@ void configuratorLoop();
 
 void processMspCmd(KoliSerial &serial, MspMsgType type, MspFn fn, MspVersion version, const char *reqPayload, u16 reqLen);
 
+/// @brief pushes the next due subscribed response of an MSP port, if the bandwidth allows it
+void mspStreamLoop(KoliSerial &serial);
+
 void printIndMessage(String msg);
 void printfIndMessage(const char *format, ...);
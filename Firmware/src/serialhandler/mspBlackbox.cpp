@@ -0,0 +1,50 @@
+/**
+ * @file mspBlackbox.cpp
+ * @brief Paging of the blackbox listings
+ *
+ * Copyright (c) 2026 Kolibri-FC contributors
+ *
+ * This file is part of Kolibri-FC (https://github.com/bastian2001/Kolibri-FC).
+ *
+ * Kolibri-FC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Kolibri-FC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mspBlackbox.h"
+
+u16 bbEncodeListPage(u8 *out, u16 maxLen, const u16 *logNums, u16 total, u16 first, u16 summarySize, BbSummaryReader readSummary) {
+	const u16 entrySize = 2 + summarySize;
+	if (first > total) first = total;
+	u16 count = total - first;
+	u16 fit = maxLen > BB_LIST_PAGE_HEADER ? (maxLen - BB_LIST_PAGE_HEADER) / entrySize : 0;
+	if (count > fit) count = fit;
+
+	u16 pos = 0;
+	out[pos++] = total;
+	out[pos++] = total >> 8;
+	out[pos++] = first;
+	out[pos++] = first >> 8;
+	for (u16 i = first; i < first + count; i++) {
+		out[pos++] = logNums[i];
+		out[pos++] = logNums[i] >> 8;
+		readSummary(logNums[i], &out[pos]);
+		pos += summarySize;
+	}
+	return pos;
+}
+
+u16 bbInfoMaxFiles(u16 maxLen, bool withSummary, u16 summarySize) {
+	const u16 entrySize = BB_INFO_ENTRY_SIZE + (withSummary ? summarySize : 0);
+	u16 n = maxLen / entrySize;
+	return n > BB_INFO_MAX_FILES ? BB_INFO_MAX_FILES : n;
+}
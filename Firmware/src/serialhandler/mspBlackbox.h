@@ -0,0 +1,48 @@
+/**
+ * @file mspBlackbox.h
+ * @brief Layout of the paged blackbox listings (BB_FILE_LIST, BB_FILE_INFO), without file access so it can be tested on the host
+ *
+ * Copyright (c) 2026 Kolibri-FC contributors
+ *
+ * This file is part of Kolibri-FC (https://github.com/bastian2001/Kolibri-FC).
+ *
+ * Kolibri-FC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Kolibri-FC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include "mspRegistry.h"
+
+#define BB_LIST_PAGE_HEADER 4 // total count (2), index of the first file (2)
+#define BB_INFO_ENTRY_SIZE 17 // file number (2), size (4), version (3), timestamp (4), duration (4)
+#define BB_INFO_MAX_FILES 15
+
+/// @brief summary of one log into out (summarySize bytes), zeros if there is none. May take a while, file access
+typedef bool (*BbSummaryReader)(u16 logNum, u8 *out);
+
+/**
+ * @brief Writes one page of BB_FILE_LIST with summaries
+ *
+ * @details Layout (little endian): total count (2), index of the first file (2), then per file: number (2), summary (summarySize). As many files as fit into maxLen, so the page adapts to the MSP version of the request. An empty page (first >= total) only has the header.
+ *
+ * @param out at least maxLen bytes
+ * @param maxLen payload limit, see mspMaxResponse()
+ * @param logNums numbers of all logs, total entries
+ * @param first index of the first file in this page
+ * @param readSummary called once per file on the page
+ * @return bytes written
+ */
+u16 bbEncodeListPage(u8 *out, u16 maxLen, const u16 *logNums, u16 total, u16 first, u16 summarySize, BbSummaryReader readSummary);
+
+/// @brief how many BB_FILE_INFO entries fit into a response of maxLen bytes, at most BB_INFO_MAX_FILES
+u16 bbInfoMaxFiles(u16 maxLen, bool withSummary, u16 summarySize);
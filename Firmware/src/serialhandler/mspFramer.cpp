@@ -0,0 +1,216 @@
+/**
+ * @file mspFramer.cpp
+ * @brief Byte-wise MSP V1/V2 frame parser, without any I/O so it builds on the host
+ *
+ * Copyright (c) 2026 Kolibri-FC contributors
+ *
+ * This file is part of Kolibri-FC (https://github.com/bastian2001/Kolibri-FC).
+ *
+ * Kolibri-FC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Kolibri-FC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mspFramer.h"
+#include "utils/checksum.h"
+
+MspFramer::Result MspFramer::handleByte(u8 c) {
+	switch (state) {
+	case MspState::IDLE:
+		if (c == '$')
+			state = MspState::PACKET_START;
+		break;
+	case MspState::PACKET_START:
+		index = 0;
+		switch (c) {
+		case 'M':
+			state = MspState::TYPE_V1;
+			version = MspVersion::V1;
+			break;
+		case 'X':
+			state = MspState::TYPE_V2;
+			version = MspVersion::V2;
+			break;
+		default:
+			state = MspState::IDLE;
+			break;
+		}
+		break;
+	case MspState::TYPE_V1:
+		crcV1 = 0;
+		state = MspState::LEN_V1;
+		switch (c) {
+		case '<':
+			type = MspMsgType::REQUEST;
+			break;
+		case '>':
+			type = MspMsgType::RESPONSE;
+			break;
+		case '!':
+			type = MspMsgType::ERROR;
+			break;
+		default:
+			state = MspState::IDLE;
+			break;
+		}
+		break;
+	case MspState::LEN_V1:
+		crcV1 ^= c;
+		payloadLen = c;
+		state = MspState::CMD_V1;
+		break;
+	case MspState::CMD_V1:
+		crcV1 ^= c;
+		fn = (MspFn)c;
+		if (c == (u8)MspFn::MSP_V2_FRAME) {
+			version = MspVersion::V2_OVER_V1;
+			crcV2 = 0;
+			state = MspState::FLAG_V2_OVER_V1;
+		} else if (payloadLen == 255) {
+			version = MspVersion::V1_JUMBO;
+			state = MspState::JUMBO_LEN_LO_V1;
+		} else {
+			state = payloadLen ? MspState::PAYLOAD_V1 : MspState::CHECKSUM_V1;
+		}
+		break;
+	case MspState::JUMBO_LEN_LO_V1:
+		payloadLen = c;
+		crcV1 ^= c;
+		state = MspState::JUMBO_LEN_HI_V1;
+		break;
+	case MspState::JUMBO_LEN_HI_V1:
+		payloadLen |= ((u16)c << 8);
+		if (payloadLen > MSP_MAX_PAYLOAD) {
+			state = MspState::IDLE;
+			break;
+		}
+		crcV1 ^= c;
+		state = payloadLen ? MspState::PAYLOAD_V1 : MspState::CHECKSUM_V1;
+		break;
+	case MspState::PAYLOAD_V1:
+		crcV1 ^= c;
+		payload[index++] = c;
+		if (index == payloadLen)
+			state = MspState::CHECKSUM_V1;
+		break;
+	case MspState::FLAG_V2_OVER_V1:
+		flag = c;
+		crcV1 ^= c;
+		crcV2 = crc8D5Byte(crcV2, c);
+		state = MspState::CMD_LO_V2_OVER_V1;
+		break;
+	case MspState::CMD_LO_V2_OVER_V1:
+		fn = (MspFn)c;
+		crcV1 ^= c;
+		crcV2 = crc8D5Byte(crcV2, c);
+		state = MspState::CMD_HI_V2_OVER_V1;
+		break;
+	case MspState::CMD_HI_V2_OVER_V1:
+		fn = (MspFn)((u32)fn | (u32)c << 8);
+		crcV1 ^= c;
+		crcV2 = crc8D5Byte(crcV2, c);
+		state = MspState::LEN_LO_V2_OVER_V1;
+		break;
+	case MspState::LEN_LO_V2_OVER_V1:
+		payloadLen = c;
+		crcV1 ^= c;
+		crcV2 = crc8D5Byte(crcV2, c);
+		state = MspState::LEN_HI_V2_OVER_V1;
+		break;
+	case MspState::LEN_HI_V2_OVER_V1:
+		payloadLen |= ((u16)c << 8);
+		if (payloadLen > MSP_MAX_PAYLOAD) {
+			state = MspState::IDLE;
+			break;
+		}
+		crcV1 ^= c;
+		crcV2 = crc8D5Byte(crcV2, c);
+		state = payloadLen ? MspState::PAYLOAD_V2_OVER_V1 : MspState::CHECKSUM_V2_OVER_V1;
+		index = 0;
+		break;
+	case MspState::PAYLOAD_V2_OVER_V1:
+		crcV1 ^= c;
+		crcV2 = crc8D5Byte(crcV2, c);
+		payload[index++] = c;
+		if (index == payloadLen)
+			state = MspState::CHECKSUM_V2_OVER_V1;
+		break;
+	case MspState::CHECKSUM_V2_OVER_V1:
+		if (c != crcV2) {
+			state = MspState::IDLE;
+			return ERROR_CRC_V2;
+		}
+		crcV1 ^= c;
+		state = MspState::CHECKSUM_V1;
+		break;
+	case MspState::CHECKSUM_V1:
+		state = MspState::IDLE;
+		return c == crcV1 ? FRAME : ERROR_CRC_V1;
+	case MspState::TYPE_V2:
+		state = MspState::FLAG_V2;
+		crcV2 = 0;
+		switch (c) {
+		case '<':
+			type = MspMsgType::REQUEST;
+			break;
+		case '>':
+			type = MspMsgType::RESPONSE;
+			break;
+		case '!':
+			type = MspMsgType::ERROR;
+			break;
+		default:
+			state = MspState::IDLE;
+			break;
+		}
+		break;
+	case MspState::FLAG_V2:
+		flag = c;
+		crcV2 = crc8D5Byte(crcV2, c);
+		state = MspState::CMD_LO_V2;
+		break;
+	case MspState::CMD_LO_V2:
+		fn = (MspFn)c;
+		crcV2 = crc8D5Byte(crcV2, c);
+		state = MspState::CMD_HI_V2;
+		break;
+	case MspState::CMD_HI_V2:
+		fn = (MspFn)((u32)fn | (u32)c << 8);
+		crcV2 = crc8D5Byte(crcV2, c);
+		state = MspState::LEN_LO_V2;
+		break;
+	case MspState::LEN_LO_V2:
+		payloadLen = c;
+		crcV2 = crc8D5Byte(crcV2, c);
+		state = MspState::LEN_HI_V2;
+		break;
+	case MspState::LEN_HI_V2:
+		payloadLen |= ((u16)c << 8);
+		if (payloadLen > MSP_MAX_PAYLOAD) {
+			state = MspState::IDLE;
+			break;
+		}
+		crcV2 = crc8D5Byte(crcV2, c);
+		state = payloadLen ? MspState::PAYLOAD_V2 : MspState::CHECKSUM_V2;
+		break;
+	case MspState::PAYLOAD_V2:
+		crcV2 = crc8D5Byte(crcV2, c);
+		payload[index++] = c;
+		if (index == payloadLen)
+			state = MspState::CHECKSUM_V2;
+		break;
+	case MspState::CHECKSUM_V2:
+		state = MspState::IDLE;
+		return c == crcV2 ? FRAME : ERROR_CRC_V2;
+	}
+	return NONE;
+}
@@ -0,0 +1,83 @@
+/**
+ * @file mspFramer.h
+ * @brief Byte-wise MSP V1/V2 frame parser, without any I/O so it builds on the host
+ *
+ * Copyright (c) 2026 Kolibri-FC contributors
+ *
+ * This file is part of Kolibri-FC (https://github.com/bastian2001/Kolibri-FC).
+ *
+ * Kolibri-FC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Kolibri-FC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include "mspRegistry.h"
+
+enum class MspState {
+	IDLE, // waiting for $
+	PACKET_START, // receiving M or X
+	TYPE_V1, // got M, receiving type byte (<, >, !)
+	LEN_V1, // if 255 is received in this step, inject jumbo len bytes
+	CMD_V1,
+	JUMBO_LEN_LO_V1,
+	JUMBO_LEN_HI_V1,
+	PAYLOAD_V1,
+	FLAG_V2_OVER_V1,
+	CMD_LO_V2_OVER_V1,
+	CMD_HI_V2_OVER_V1,
+	LEN_LO_V2_OVER_V1,
+	LEN_HI_V2_OVER_V1,
+	PAYLOAD_V2_OVER_V1,
+	CHECKSUM_V2_OVER_V1,
+	CHECKSUM_V1,
+	TYPE_V2, // got X, receiving type byte (<, >, !)
+	FLAG_V2,
+	CMD_LO_V2,
+	CMD_HI_V2,
+	LEN_LO_V2,
+	LEN_HI_V2,
+	PAYLOAD_V2,
+	CHECKSUM_V2,
+};
+
+/**
+ * @brief Assembles MSP frames (V1, V1 jumbo, V2, V2 over V1) from single bytes
+ *
+ * @details Only checks framing and checksums, what to do with a frame is up to MspParser. Lengths above MSP_MAX_PAYLOAD drop the frame, so the payload never leaves its buffer.
+ */
+class MspFramer {
+public:
+	enum Result : u8 {
+		NONE, // frame not complete yet
+		FRAME, // complete and valid, see the public fields
+		ERROR_CRC_V1, // V1 checksum wrong, fn and version are valid
+		ERROR_CRC_V2, // V2 checksum wrong, fn and version are valid
+	};
+
+	Result handleByte(u8 c);
+	/// @brief drops a partially received frame
+	void abort() { state = MspState::IDLE; }
+
+	char payload[MSP_MAX_PAYLOAD] = {0};
+	u16 payloadLen = 0;
+	MspFn fn = MspFn::API_VERSION;
+	MspMsgType type = MspMsgType::ERROR;
+	u8 flag = 0; // V2 flag byte
+	MspVersion version = MspVersion::V2;
+
+private:
+	MspState state = MspState::IDLE;
+	u16 index = 0; // write position in payload
+	u32 crcV1 = 0; // Checksum for MSP V1 messages
+	u32 crcV2 = 0; // Checksum for MSP V2 messages
+};
@@ -0,0 +1,102 @@
+/**
+ * @file mspRegistry.cpp
+ * @brief Lookup and checks of MSP requests against the command descriptors
+ *
+ * Copyright (c) 2026 Kolibri-FC contributors
+ *
+ * This file is part of Kolibri-FC (https://github.com/bastian2001/Kolibri-FC).
+ *
+ * Kolibri-FC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Kolibri-FC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mspRegistry.h"
+
+#define MSP_COMMAND_ENTRY(fn, handler, minLen, maxLen, flags, rev) {MspFn::fn, minLen, maxLen, flags, rev},
+const MspCommand mspCommands[] = {MSP_COMMAND_LIST(MSP_COMMAND_ENTRY)};
+const u16 mspCommandCount = sizeof(mspCommands) / sizeof(mspCommands[0]);
+
+i32 mspFindCommand(MspFn fn) {
+	i32 lo = 0;
+	i32 hi = mspCommandCount - 1;
+	while (lo <= hi) {
+		i32 mid = (lo + hi) / 2;
+		if (mspCommands[mid].fn == fn) return mid;
+		if (mspCommands[mid].fn < fn)
+			lo = mid + 1;
+		else
+			hi = mid - 1;
+	}
+	return -1;
+}
+
+MspCheck mspCheckRequest(i32 index, u16 len, bool armed) {
+	if (index < 0 || index >= mspCommandCount) return MspCheck::UNKNOWN;
+	const MspCommand &cmd = mspCommands[index];
+	if (len < cmd.minLen) return MspCheck::TOO_SHORT;
+	if (len > cmd.maxLen) return MspCheck::TOO_LONG;
+	if (armed && !(cmd.flags & MSP_CMD_ARMED)) return MspCheck::ARMED;
+	return MspCheck::OK;
+}
+
+const char *mspCheckMessage(MspCheck check) {
+	switch (check) {
+	case MspCheck::OK:
+		return "";
+	case MspCheck::UNKNOWN:
+		return "Unknown command";
+	case MspCheck::TOO_SHORT:
+		return "Payload too short";
+	case MspCheck::TOO_LONG:
+		return "Payload too long";
+	case MspCheck::ARMED:
+		return "Not allowed while armed";
+	}
+	return "";
+}
+
+u16 mspMaxResponse(MspVersion version) {
+	switch (version) {
+	case MspVersion::V2:
+	case MspVersion::V1_JUMBO:
+		return MSP_MAX_PAYLOAD;
+	case MspVersion::V2_OVER_V1:
+		return 248; // 255 minus the V2 header and CRC inside the V1 payload
+	case MspVersion::V1:
+	case MspVersion::V2_OVER_CRSF:
+	case MspVersion::V1_OVER_CRSF:
+	case MspVersion::V1_JUMBO_OVER_CRSF:
+		break;
+	}
+	return 254; // V1 length byte without jumbo, CRSF tunnel clients reassemble no more than that
+}
+
+u16 mspEncodeCommandList(u16 first, u8 *out) {
+	u16 pos = 0;
+	out[pos++] = mspCommandCount;
+	out[pos++] = mspCommandCount >> 8;
+	out[pos++] = first;
+	out[pos++] = first >> 8;
+	for (u32 i = first; i < mspCommandCount && i < (u32)first + MSP_COMMANDS_PER_PAGE; i++) {
+		const MspCommand &cmd = mspCommands[i];
+		out[pos++] = (u16)cmd.fn;
+		out[pos++] = (u16)cmd.fn >> 8;
+		out[pos++] = cmd.minLen;
+		out[pos++] = cmd.minLen >> 8;
+		out[pos++] = cmd.maxLen;
+		out[pos++] = cmd.maxLen >> 8;
+		out[pos++] = cmd.flags;
+		out[pos++] = cmd.rev;
+	}
+	return pos;
+}
@@ -0,0 +1,405 @@
+/**
+ * @file mspRegistry.h
+ * @brief MSP function IDs and the descriptors of all requests the FC answers
+ *
+ * Copyright (c) 2026 Kolibri-FC contributors
+ *
+ * This file is part of Kolibri-FC (https://github.com/bastian2001/Kolibri-FC).
+ *
+ * Kolibri-FC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Kolibri-FC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include "typedefs.h"
+#include <utility>
+
+/**
+ * @brief MSP Serial Functions
+ *
+ * @details These commands are used to communicate with the configurator and other peripherals. For Kolibri specific functions, the space 0x4000-0x4FFF is used. More details: https://github.com/iNavFlight/inav/wiki/MSP-V2
+ */
+enum class MspFn : u16 {
+	API_VERSION = 1,
+	FIRMWARE_VARIANT = 2,
+	FIRMWARE_VERSION = 3,
+	BOARD_INFO = 4,
+	BUILD_INFO = 5,
+	GET_NAME = 10,
+	SET_NAME = 11,
+	GET_FEATURE_CONFIG = 36,
+	REBOOT = 68,
+	GET_ADVANCED_CONFIG = 90,
+	SET_ARMING_DISABLED = 99,
+	MSP_STATUS = 101,
+	MSP_RAW_IMU = 102,
+	GET_MOTOR = 104,
+	RC = 105,
+	MSP_ATTITUDE = 108,
+	MSP_ALTITUDE = 109,
+	MSP_ANALOG = 110,
+	BOXIDS = 119,
+	GET_MOTOR_3D_CONFIG = 124,
+	MSP_BATTERY_STATE = 130,
+	GET_MOTOR_CONFIG = 131,
+	UID = 160,
+	MSP_DISPLAYPORT = 182,
+	MSP_SET_OSD_CANVAS = 188,
+	MSP_GET_OSD_CANVAS = 189,
+	ACC_CALIBRATION = 205,
+	MAG_CALIBRATION = 206,
+	SET_MOTOR = 214,
+	ENABLE_4WAY_IF = 245,
+	SET_RTC = 246,
+	GET_RTC = 247,
+	MSP_V2_FRAME = 255,
+
+	// 0x400_ Configurator related commands
+	STATUS = 0x4000,
+	CONFIGURATOR_PING = 0x4001,
+	IND_MESSAGE = 0x4002,
+	GET_MSP_COMMANDS = 0x4003,
+	STREAM_SUBSCRIBE = 0x4004,
+	TRANSFER_BEGIN = 0x4005,
+	TRANSFER_READ = 0x4006,
+	TRANSFER_WRITE = 0x4007,
+	TRANSFER_FINISH = 0x4008,
+
+	// 0x401_ Entering special modes
+	SERIAL_PASSTHROUGH = 0x4010,
+	SERIAL_SNIFF = 0x4011,
+
+	// 0x402_ CLI
+	CLI_INIT = 0x4020,
+	CLI_COMMAND = 0x4021,
+	CLI_GET_SUGGESTION = 0x4022,
+	CLI_ABORT_COMMAND = 0x4023,
+	CLI_CHECK_RUNNING = 0x4024,
+
+	// 0x410_ Settings Meta commands
+	SAVE_SETTINGS = 0x4100,
+
+	// 0x411_ OSD settings (font and elements: segmented transfer, MspObject)
+	GET_OSD_CONFIG = 0x4113,
+	SET_OSD_CONFIG = 0x4114,
+	OSD_CONTROL = 0x4115,
+	GET_OSD_STATUS = 0x4116,
+
+	// 0x412_ Blackbox
+	GET_BB_SETTINGS = 0x4120,
+	SET_BB_SETTINGS = 0x4121,
+	BB_FILE_LIST = 0x4122,
+	BB_FILE_INFO = 0x4123,
+	BB_FILE_DOWNLOAD = 0x4124,
+	BB_FILE_DELETE = 0x4125,
+	BB_FORMAT = 0x4126,
+	BB_FILE_INIT = 0x4127,
+	BB_FAST_FILE_INIT = 0x4128,
+	BB_FAST_DATA_REQ = 0x4129,
+	BB_CLOSE_FILE = 0x412A,
+	BB_FILE_STREAM = 0x412B,
+	BB_STORAGE_HEALTH = 0x412C,
+
+	// 0x413_ GPS
+	GET_GPS_STATUS = 0x4130,
+	GET_GPS_ACCURACY = 0x4131,
+	GET_GPS_TIME = 0x4132,
+	GET_GPS_MOTION = 0x4133,
+
+	// 0x414_ Magnetometer
+	GET_MAG_DATA = 0x4140,
+
+	// 0x415_ Gyro/Accel
+	GET_ROTATION = 0x4150,
+	GET_IMU_SETUP_STATE = 0x4151,
+	START_IMU_ALIGNMENT = 0x4152,
+
+	// 0x416_ Barometer
+	GET_BARO_DATA = 0x4160,
+
+	// 0x417_ Task Manager
+	TASK_STATUS = 0x4170,
+
+	// 0x418_ Receiver
+	GET_RX_STATUS = 0x4180,
+	GET_RX_MODES = 0x4181,
+	SET_RX_MODES = 0x4182,
+	CRSF_SCAN_DEVICES = 0x4183,
+	CRSF_GET_DEVICES = 0x4184,
+	CRSF_SEND_MESSAGE = 0x4185,
+	CRSF_SUBSCRIBE = 0x4186,
+	CRSF_GOT_MESSAGE = 0x4187,
+
+	// 0x419_ Battery
+	GET_BATTERY_SETTINGS = 0x4190,
+	SET_BATTERY_SETTINGS = 0x4191,
+
+	// 0x41A_ Motors
+	GET_MOTOR_LAYOUT = 0x41A0,
+	SET_MOTOR_LAYOUT = 0x41A1,
+	GET_MOTOR_STATE = 0x41A2,
+
+	// 0x41B_ VTX
+	GET_VTX_CURRENT_STATE = 0x41B0,
+	GET_VTX_CONFIG = 0x41B1,
+	SET_VTX_CONFIG = 0x41B2,
+	VTX_APPLY_CONFIG = 0x41B3,
+
+	// 0x41C_ Serial setup
+	GET_IO_CONSTRAINTS = 0x41C0,
+	GET_SERIAL_SETUP = 0x41C1,
+	SET_SERIAL_SETUP = 0x41C2,
+
+	// 0x41F_ Misc (not worth a category)
+	GET_TZ_OFFSET = 0x41F0,
+	SET_TZ_OFFSET = 0x41F1,
+
+	// 0x42__ Tuning
+	// 0x420_ Flight Performance (Acro Mode)
+	GET_PIDS = 0x4200,
+	SET_PIDS = 0x4201,
+	GET_RATES = 0x4202,
+	SET_RATES = 0x4203,
+	GET_EXT_PID = 0x4204,
+	SET_EXT_PID = 0x4205,
+	GET_FILTER_CONFIG = 0x4206,
+	SET_FILTER_CONFIG = 0x4207,
+
+	// 0x421_ Angle Mode
+
+	// 0x422_ Altitude and Position Hold
+
+	// 0x4F00-0x4F1F general debug tools
+	GET_CRASH_DUMP = 0x4F00,
+	CLEAR_CRASH_DUMP = 0x4F01,
+	SET_DEBUG_LED = 0x4F02,
+	PLAY_SOUND = 0x4F03,
+	DEBUG_SENSORS = 0x4F04,
+
+	// 0x4F20-0x4FFF temporary debug tools
+};
+
+enum class MspMsgType : char {
+	REQUEST = '<',
+	RESPONSE = '>',
+	ERROR = '!',
+};
+
+enum class MspVersion : char {
+	V2,
+	V1,
+	V1_JUMBO,
+	V2_OVER_V1,
+
+	V2_OVER_CRSF,
+	V1_OVER_CRSF,
+	V1_JUMBO_OVER_CRSF,
+};
+
+#define MSP_MAX_PAYLOAD 2048 // size of the parser's payload buffer
+#define MSP_ANY_LEN MSP_MAX_PAYLOAD // maxLen of commands that take whatever comes
+
+// MspCommand flags
+#define MSP_CMD_ARMED (1 << 0) // may run while armed. Commands without it block the loop, reconfigure hardware or move the motors
+#define MSP_CMD_STREAM (1 << 1) // read-only without request payload, can be subscribed to with STREAM_SUBSCRIBE
+
+/**
+ * @brief All requests the FC answers: X(fn, handler, minLen, maxLen, flags, rev)
+ *
+ * @details Sorted by fn, looked up by binary search. minLen/maxLen are checked before the handler runs, so handlers can read up to minLen bytes without checking. rev is the revision of the payload layout, bump it with every incompatible change so the configurator can tell (GET_MSP_COMMANDS). The handlers are in msp.cpp.
+ */
+#define MSP_COMMAND_LIST(X) \
+	X(API_VERSION, handleApiVersion, 0, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(FIRMWARE_VARIANT, handleFirmwareVariant, 0, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(FIRMWARE_VERSION, handleFirmwareVersion, 0, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(BOARD_INFO, handleBoardInfo, 0, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(BUILD_INFO, handleBuildInfo, 0, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(GET_NAME, handleGetName, 0, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(SET_NAME, handleSetName, 0, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(GET_FEATURE_CONFIG, handleGetFeatureConfig, 0, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(REBOOT, handleReboot, 1, MSP_ANY_LEN, 0, 0) \
+	X(GET_ADVANCED_CONFIG, handleGetAdvancedConfig, 0, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(SET_ARMING_DISABLED, handleSetArmingDisabled, 1, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(MSP_STATUS, handleMspStatus, 0, MSP_ANY_LEN, MSP_CMD_ARMED | MSP_CMD_STREAM, 0) \
+	X(MSP_RAW_IMU, handleMspRawImu, 0, MSP_ANY_LEN, MSP_CMD_ARMED | MSP_CMD_STREAM, 0) \
+	X(GET_MOTOR, handleGetMotor, 0, MSP_ANY_LEN, MSP_CMD_ARMED | MSP_CMD_STREAM, 0) \
+	X(RC, handleRc, 0, MSP_ANY_LEN, MSP_CMD_ARMED | MSP_CMD_STREAM, 0) \
+	X(MSP_ATTITUDE, handleMspAttitude, 0, MSP_ANY_LEN, MSP_CMD_ARMED | MSP_CMD_STREAM, 0) \
+	X(MSP_ALTITUDE, handleMspAltitude, 0, MSP_ANY_LEN, MSP_CMD_ARMED | MSP_CMD_STREAM, 0) \
+	X(MSP_ANALOG, handleMspAnalog, 0, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(BOXIDS, handleBoxids, 0, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(GET_MOTOR_3D_CONFIG, handleGetMotor3dConfig, 0, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(MSP_BATTERY_STATE, handleMspBatteryState, 0, MSP_ANY_LEN, MSP_CMD_ARMED | MSP_CMD_STREAM, 0) \
+	X(GET_MOTOR_CONFIG, handleGetMotorConfig, 0, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(UID, handleUid, 0, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(MSP_DISPLAYPORT, handleMspDisplayport, 0, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(MSP_SET_OSD_CANVAS, handleMspSetOsdCanvas, 2, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(MSP_GET_OSD_CANVAS, handleMspGetOsdCanvas, 0, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(ACC_CALIBRATION, handleAccCalibration, 0, MSP_ANY_LEN, 0, 0) \
+	X(MAG_CALIBRATION, handleMagCalibration, 0, MSP_ANY_LEN, 0, 0) \
+	X(SET_MOTOR, handleSetMotor, 8, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(ENABLE_4WAY_IF, handleEnable4wayIf, 0, MSP_ANY_LEN, 0, 0) \
+	X(SET_RTC, handleSetRtc, 6, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(GET_RTC, handleGetRtc, 0, MSP_ANY_LEN, MSP_CMD_ARMED | MSP_CMD_STREAM, 0) \
+	X(STATUS, handleStatus, 0, MSP_ANY_LEN, MSP_CMD_ARMED | MSP_CMD_STREAM, 0) \
+	X(CONFIGURATOR_PING, handleConfiguratorPing, 0, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(GET_MSP_COMMANDS, handleGetMspCommands, 0, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(STREAM_SUBSCRIBE, handleStreamSubscribe, 0, 64, MSP_CMD_ARMED, 0) \
+	X(TRANSFER_BEGIN, handleTransferBegin, 2, 10, MSP_CMD_ARMED, 0) \
+	X(TRANSFER_READ, handleTransferRead, 7, 7, MSP_CMD_ARMED, 0) \
+	X(TRANSFER_WRITE, handleTransferWrite, 5, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(TRANSFER_FINISH, handleTransferFinish, 1, 1, MSP_CMD_ARMED, 0) \
+	X(SERIAL_PASSTHROUGH, handleSerialPassthrough, 5, MSP_ANY_LEN, 0, 0) \
+	X(SERIAL_SNIFF, handleSerialSniff, 0, MSP_ANY_LEN, 0, 0) \
+	X(CLI_INIT, handleCliInit, 0, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(CLI_COMMAND, handleCliCommand, 0, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(CLI_GET_SUGGESTION, handleCliGetSuggestion, 1, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(CLI_ABORT_COMMAND, handleCliAbortCommand, 0, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(CLI_CHECK_RUNNING, handleCliCheckRunning, 0, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(SAVE_SETTINGS, handleSaveSettings, 0, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(GET_OSD_CONFIG, handleGetOsdConfig, 0, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(SET_OSD_CONFIG, handleSetOsdConfig, 1, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(OSD_CONTROL, handleOsdControl, 1, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(GET_OSD_STATUS, handleGetOsdStatus, 0, MSP_ANY_LEN, MSP_CMD_ARMED | MSP_CMD_STREAM, 0) \
+	X(GET_BB_SETTINGS, handleGetBbSettings, 0, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(SET_BB_SETTINGS, handleSetBbSettings, 10, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(BB_FILE_LIST, handleBbFileList, 0, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(BB_FILE_INFO, handleBbFileInfo, 0, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(BB_FILE_DOWNLOAD, handleBbFileDownload, 2, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(BB_FILE_DELETE, handleBbFileDelete, 2, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(BB_FORMAT, handleBbFormat, 0, MSP_ANY_LEN, 0, 0) \
+	X(BB_FILE_INIT, handleBbFileInit, 2, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(BB_FAST_FILE_INIT, handleBbFastFileInit, 3, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(BB_FAST_DATA_REQ, handleBbFastDataReq, 5, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(BB_CLOSE_FILE, handleBbCloseFile, 0, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(BB_FILE_STREAM, handleBbFileStream, 1, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(BB_STORAGE_HEALTH, handleBbStorageHealth, 0, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(GET_GPS_STATUS, handleGetGpsStatus, 0, MSP_ANY_LEN, MSP_CMD_ARMED | MSP_CMD_STREAM, 0) \
+	X(GET_GPS_ACCURACY, handleGetGpsAccuracy, 0, MSP_ANY_LEN, MSP_CMD_ARMED | MSP_CMD_STREAM, 0) \
+	X(GET_GPS_TIME, handleGetGpsTime, 0, MSP_ANY_LEN, MSP_CMD_ARMED | MSP_CMD_STREAM, 0) \
+	X(GET_GPS_MOTION, handleGetGpsMotion, 0, MSP_ANY_LEN, MSP_CMD_ARMED | MSP_CMD_STREAM, 0) \
+	X(GET_MAG_DATA, handleGetMagData, 0, MSP_ANY_LEN, MSP_CMD_ARMED | MSP_CMD_STREAM, 0) \
+	X(GET_ROTATION, handleGetRotation, 0, MSP_ANY_LEN, MSP_CMD_ARMED | MSP_CMD_STREAM, 0) \
+	X(GET_IMU_SETUP_STATE, handleGetImuSetupState, 0, MSP_ANY_LEN, MSP_CMD_ARMED | MSP_CMD_STREAM, 0) \
+	X(START_IMU_ALIGNMENT, handleStartImuAlignment, 0, MSP_ANY_LEN, 0, 0) \
+	X(GET_BARO_DATA, handleGetBaroData, 0, MSP_ANY_LEN, MSP_CMD_ARMED | MSP_CMD_STREAM, 0) \
+	X(TASK_STATUS, handleTaskStatus, 0, MSP_ANY_LEN, MSP_CMD_ARMED | MSP_CMD_STREAM, 0) \
+	X(GET_RX_STATUS, handleGetRxStatus, 0, MSP_ANY_LEN, MSP_CMD_ARMED | MSP_CMD_STREAM, 0) \
+	X(GET_RX_MODES, handleGetRxModes, 0, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(SET_RX_MODES, handleSetRxModes, 0, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(CRSF_SCAN_DEVICES, handleCrsfScanDevices, 0, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(CRSF_GET_DEVICES, handleCrsfGetDevices, 0, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(CRSF_SEND_MESSAGE, handleCrsfSendMessage, 1, 61, MSP_CMD_ARMED, 0) \
+	X(CRSF_SUBSCRIBE, handleCrsfSubscribe, 2, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(GET_BATTERY_SETTINGS, handleGetBatterySettings, 0, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(SET_BATTERY_SETTINGS, handleSetBatterySettings, 3, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(GET_MOTOR_LAYOUT, handleGetMotorLayout, 0, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(SET_MOTOR_LAYOUT, handleSetMotorLayout, 4, MSP_ANY_LEN, 0, 0) \
+	X(GET_MOTOR_STATE, handleGetMotorState, 0, MSP_ANY_LEN, MSP_CMD_ARMED | MSP_CMD_STREAM, 0) \
+	X(GET_VTX_CURRENT_STATE, handleGetVtxCurrentState, 0, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(GET_VTX_CONFIG, handleGetVtxConfig, 0, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(SET_VTX_CONFIG, handleSetVtxConfig, 7, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(VTX_APPLY_CONFIG, handleVtxApplyConfig, 0, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(GET_IO_CONSTRAINTS, handleGetIoConstraints, 0, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(GET_SERIAL_SETUP, handleGetSerialSetup, 0, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(SET_SERIAL_SETUP, handleSetSerialSetup, 0, 88, 0, 0) \
+	X(GET_TZ_OFFSET, handleGetTzOffset, 0, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(SET_TZ_OFFSET, handleSetTzOffset, 2, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(GET_PIDS, handleGetPids, 0, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(SET_PIDS, handleSetPids, 30, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(GET_RATES, handleGetRates, 0, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(SET_RATES, handleSetRates, 18, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(GET_EXT_PID, handleGetExtPid, 0, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(SET_EXT_PID, handleSetExtPid, 6, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(GET_FILTER_CONFIG, handleGetFilterConfig, 0, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(SET_FILTER_CONFIG, handleSetFilterConfig, 22, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(GET_CRASH_DUMP, handleGetCrashDump, 0, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(CLEAR_CRASH_DUMP, handleClearCrashDump, 0, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(SET_DEBUG_LED, handleSetDebugLed, 1, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(PLAY_SOUND, handlePlaySound, 0, MSP_ANY_LEN, MSP_CMD_ARMED, 0) \
+	X(DEBUG_SENSORS, handleDebugSensors, 0, MSP_ANY_LEN, MSP_CMD_ARMED | MSP_CMD_STREAM, 0)
+
+typedef struct mspCommand {
+	MspFn fn;
+	u16 minLen;
+	u16 maxLen;
+	u8 flags; // MSP_CMD_ flags
+	u8 rev; // payload layout revision
+} MspCommand;
+
+enum class MspCheck : u8 {
+	OK,
+	UNKNOWN, // not in MSP_COMMAND_LIST
+	TOO_SHORT,
+	TOO_LONG,
+	ARMED, // not allowed while armed
+};
+
+extern const MspCommand mspCommands[];
+extern const u16 mspCommandCount;
+
+/// @brief index of fn in mspCommands, -1 if the FC does not answer it
+i32 mspFindCommand(MspFn fn);
+
+/**
+ * @brief Checks a request against its descriptor
+ *
+ * @param index from mspFindCommand(), -1 for unknown
+ * @param len payload length
+ * @param armed current arming state
+ */
+MspCheck mspCheckRequest(i32 index, u16 len, bool armed);
+
+/// @brief text for the error response, empty for MspCheck::OK
+const char *mspCheckMessage(MspCheck check);
+
+/**
+ * @brief Looks a request up, checks it and runs its handler if the check passed
+ *
+ * @details processMspCmd() goes through this, and so do the host tests with their own handler table, so both use the same gate.
+ *
+ * @param handlers one per mspCommands entry, in the same order (MSP_COMMAND_LIST)
+ * @param fn requested function
+ * @param len request payload length
+ * @param armed current arming state
+ * @param args passed on to the handler
+ * @return result of the check, the caller answers anything but OK with an error
+ */
+template <typename Handler, typename... Args>
+MspCheck mspDispatch(const Handler *handlers, MspFn fn, u16 len, bool armed, Args &&...args) {
+	const i32 index = mspFindCommand(fn);
+	const MspCheck check = mspCheckRequest(index, len, armed);
+	if (check == MspCheck::OK) handlers[index](std::forward<Args>(args)...);
+	return check;
+}
+
+/**
+ * @brief Largest response payload that reaches the host in one frame of the version the request came in
+ *
+ * @details V1 and the CRSF tunnel get what fits without a jumbo frame, MSP V2 over V1 is limited by the V1 length byte. Handlers that page or batch their data size the page with this.
+ */
+u16 mspMaxResponse(MspVersion version);
+
+#define MSP_COMMANDS_PER_PAGE 30 // keeps a GET_MSP_COMMANDS response below the 248 bytes of MSP V2 over V1
+#define MSP_COMMAND_ENTRY_SIZE 8
+
+/**
+ * @brief Writes one page of the command list (GET_MSP_COMMANDS response)
+ *
+ * @details Layout (little endian): total count (2), index of the first entry (2), then per entry: fn (2), minLen (2), maxLen (2), flags (1), rev (1). An empty page (first >= count) only has the header.
+ *
+ * @param first index of the first entry
+ * @param out at least 4 + MSP_COMMANDS_PER_PAGE * MSP_COMMAND_ENTRY_SIZE bytes
+ * @return bytes written
+ */
+u16 mspEncodeCommandList(u16 first, u8 *out);
@@ -0,0 +1,122 @@
+/**
+ * @file mspStream.cpp
+ * @brief Scheduling of MSP responses that are pushed to the host without a request
+ *
+ * Copyright (c) 2026 Kolibri-FC contributors
+ *
+ * This file is part of Kolibri-FC (https://github.com/bastian2001/Kolibri-FC).
+ *
+ * Kolibri-FC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Kolibri-FC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mspStream.h"
+
+u8 MspStreams::set(const MspFn *fns, const u16 *intervalsMs, u8 count, u32 nowUs, u16 *granted) {
+	n = 0;
+	for (u8 i = 0; i < count; i++) {
+		granted[i] = 0;
+		if (!intervalsMs[i] || n >= MSP_STREAM_MAX) continue;
+		i32 index = mspFindCommand(fns[i]);
+		if (index < 0 || !(mspCommands[index].flags & MSP_CMD_STREAM)) continue;
+		bool duplicate = false;
+		for (u8 j = 0; j < n; j++) {
+			if (entries[j].fn == fns[i]) duplicate = true;
+		}
+		if (duplicate) continue;
+
+		MspStreamEntry &e = entries[n++];
+		e.fn = fns[i];
+		e.intervalMs = intervalsMs[i] < MSP_STREAM_MIN_INTERVAL_MS ? MSP_STREAM_MIN_INTERVAL_MS : intervalsMs[i];
+		e.nextUs = nowUs;
+		e.frameLen = 0;
+		granted[i] = e.intervalMs;
+	}
+	lastHostUs = nowUs;
+	lastRefillUs = nowUs;
+	tokenFrac = 0;
+	tokens = burst(); // start with a full bucket, the first round goes out right away
+	return n;
+}
+
+void MspStreams::setLinkRate(u32 bytesPerSec) {
+	this->bytesPerSec = (u64)bytesPerSec * MSP_STREAM_SHARE_PERCENT / 100;
+}
+
+i32 MspStreams::burst() const {
+	// the bucket holds 50 ms of budget, but at least the biggest frame, or slow links could never send it
+	i32 b = bytesPerSec / 20;
+	for (u8 i = 0; i < n; i++) {
+		if (entries[i].frameLen > b) b = entries[i].frameLen;
+	}
+	if (b < MSP_STREAM_DEFAULT_FRAME) b = MSP_STREAM_DEFAULT_FRAME;
+	return b;
+}
+
+void MspStreams::refill(u32 nowUs) {
+	u64 acc = (u64)(nowUs - lastRefillUs) * bytesPerSec + tokenFrac;
+	lastRefillUs = nowUs;
+	tokenFrac = acc % 1000000;
+	u64 add = acc / 1000000;
+
+	i32 max = burst();
+	if (add > (u64)max) add = max;
+	tokens += add;
+	if (tokens > max) tokens = max;
+}
+
+i32 MspStreams::next(u32 nowUs, u32 txFree) {
+	if (!n) return -1;
+	if (nowUs - lastHostUs > MSP_STREAM_TIMEOUT_US) {
+		// host is gone (closed port, unplugged, or a configurator that crashed)
+		n = 0;
+		timeouts++;
+		return -1;
+	}
+	refill(nowUs);
+
+	i32 best = -1;
+	i32 bestLate = -1;
+	for (u8 i = 0; i < n; i++) {
+		i32 late = nowUs - entries[i].nextUs;
+		if (late > bestLate) {
+			bestLate = late;
+			best = i;
+		}
+	}
+	if (best < 0) return -1;
+
+	u32 cost = entries[best].frameLen ? entries[best].frameLen : MSP_STREAM_DEFAULT_FRAME;
+	if (tokens < (i32)cost || txFree < cost + MSP_STREAM_TX_RESERVE) {
+		// out of budget: the others give up frames that are a full interval late, the one that waits longest keeps its place, so big frames don't starve behind small ones
+		for (u8 i = 0; i < n; i++) {
+			u32 intervalUs = entries[i].intervalMs * 1000;
+			if (i != best && (i32)(nowUs - entries[i].nextUs) >= (i32)intervalUs) {
+				entries[i].nextUs += intervalUs;
+				slipped++;
+			}
+		}
+		return -1;
+	}
+	return best;
+}
+
+void MspStreams::sent(i32 index, u32 nowUs, u32 frameLen) {
+	if (index < 0 || index >= n) return;
+	MspStreamEntry &e = entries[index];
+	u32 intervalUs = e.intervalMs * 1000;
+	e.nextUs += intervalUs;
+	if ((i32)(nowUs - e.nextUs) >= 0) e.nextUs = nowUs + intervalUs; // picked up more than an interval late, don't catch up
+	if (frameLen) e.frameLen = frameLen > 0xFFFF ? 0xFFFF : frameLen;
+	tokens -= frameLen;
+}
@@ -0,0 +1,93 @@
+/**
+ * @file mspStream.h
+ * @brief Scheduling of MSP responses that are pushed to the host without a request
+ *
+ * Copyright (c) 2026 Kolibri-FC contributors
+ *
+ * This file is part of Kolibri-FC (https://github.com/bastian2001/Kolibri-FC).
+ *
+ * Kolibri-FC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Kolibri-FC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include "mspRegistry.h"
+
+#define MSP_STREAM_MAX 16 // subscriptions per port
+#define MSP_STREAM_MIN_INTERVAL_MS 5 // fastest rate a subscription gets, 200 Hz
+#define MSP_STREAM_TIMEOUT_US 1000000 // subscriptions end when the host sent nothing for this long (the configurator pings every 200 ms)
+#define MSP_STREAM_SHARE_PERCENT 50 // part of the link the streams may use, the rest is left for requests
+#define MSP_STREAM_TX_RESERVE 512 // TX buffer space that is always left free for responses to requests
+#define MSP_STREAM_USB_BPS 1000000 // assumed USB throughput in bytes per second, the baud rate means nothing there
+#define MSP_STREAM_DEFAULT_FRAME 64 // cost estimate of a frame that was not sent yet
+
+typedef struct mspStreamEntry {
+	MspFn fn;
+	u16 intervalMs;
+	u32 nextUs; // when the next frame is due
+	u16 frameLen; // bytes of the last frame, including header and CRC
+} MspStreamEntry;
+
+/**
+ * @brief Subscriptions of one port
+ *
+ * @details The scheduler picks the most overdue subscription, and only lets it through if a token bucket filled at MSP_STREAM_SHARE_PERCENT of the link rate and the free TX buffer space both cover the size of its last frame. Anything that can't be sent in time slips to the next interval instead of bursting later, so an overloaded link ends up with lower rates, not with a growing backlog.
+ */
+class MspStreams {
+public:
+	/**
+	 * @brief Replaces all subscriptions of the port
+	 *
+	 * @param fns functions, each has to be in MSP_COMMAND_LIST with MSP_CMD_STREAM
+	 * @param intervalsMs requested interval of each, 0 drops it. Faster than MSP_STREAM_MIN_INTERVAL_MS is raised to it
+	 * @param count number of requested subscriptions
+	 * @param nowUs current time, the first frames are due right away
+	 * @param granted out: accepted interval per request, 0 if rejected (unknown, not streamable, table full, duplicate)
+	 * @return number of accepted subscriptions
+	 */
+	u8 set(const MspFn *fns, const u16 *intervalsMs, u8 count, u32 nowUs, u16 *granted);
+	void clear() { n = 0; };
+	u8 count() const { return n; };
+	const MspStreamEntry &get(u8 i) const { return entries[i]; };
+
+	/// @brief link throughput in bytes per second, the streams get MSP_STREAM_SHARE_PERCENT of it
+	void setLinkRate(u32 bytesPerSec);
+	/// @brief call with every valid frame from the host, keeps the subscriptions alive
+	void hostSeen(u32 nowUs) { lastHostUs = nowUs; };
+
+	/**
+	 * @brief Picks the subscription to send now
+	 *
+	 * @param nowUs current time
+	 * @param txFree free space in the TX buffer
+	 * @return index of the subscription, -1 if none is due or the budget does not allow it. Also ends all subscriptions after MSP_STREAM_TIMEOUT_US without host activity
+	 */
+	i32 next(u32 nowUs, u32 txFree);
+	/// @brief books a frame that next() picked, frameLen is what actually went out (0 if nothing did)
+	void sent(i32 index, u32 nowUs, u32 frameLen);
+
+	u32 slipped = 0; // intervals skipped because budget or TX space ran out
+	u32 timeouts = 0; // times the host went away with active subscriptions
+
+private:
+	void refill(u32 nowUs);
+	i32 burst() const; // bucket size
+
+	MspStreamEntry entries[MSP_STREAM_MAX];
+	u8 n = 0;
+	u32 bytesPerSec = 0; // stream share of the link
+	i32 tokens = 0; // bytes that may be sent now, negative after a frame that was bigger than expected
+	u32 tokenFrac = 0; // remainder of the refill, in byte-microseconds
+	u32 lastRefillUs = 0;
+	u32 lastHostUs = 0;
+};
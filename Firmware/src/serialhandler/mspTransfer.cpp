@@ -0,0 +1,131 @@
+/**
+ * @file mspTransfer.cpp
+ * @brief Segmented MSP transfers, without any I/O so it builds on the host
+ *
+ * Copyright (c) 2026 Kolibri-FC contributors
+ *
+ * This file is part of Kolibri-FC (https://github.com/bastian2001/Kolibri-FC).
+ *
+ * Kolibri-FC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Kolibri-FC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mspTransfer.h"
+#include "mspRegistry.h"
+#include "utils/checksum.h"
+#include <string.h>
+
+void MspTransfer::begin(u8 object) {
+	state = State::IDLE;
+	if (++session == 0) session = 1;
+	this->object = object;
+	pos = 0;
+}
+
+MspTransferStatus MspTransfer::beginDownload(u8 object, u8 *session, u32 *len, u32 *crc) {
+	if (object >= objectCount) return MspTransferStatus::UNKNOWN_OBJECT;
+	if (!objects[object].save) return MspTransferStatus::NOT_SUPPORTED;
+	begin(object);
+	i32 l = objects[object].save(buf, bufSize);
+	if (l < 0) return MspTransferStatus::REJECTED;
+	state = State::DOWNLOAD;
+	this->len = l;
+	this->crc = crc32(buf, l);
+	*session = this->session;
+	*len = this->len;
+	*crc = this->crc;
+	return MspTransferStatus::OK;
+}
+
+MspTransferStatus MspTransfer::beginUpload(u8 object, u32 len, u32 crc, bool armed, u8 *session) {
+	if (object >= objectCount) return MspTransferStatus::UNKNOWN_OBJECT;
+	const MspTransferObject &o = objects[object];
+	if (!o.load) return MspTransferStatus::NOT_SUPPORTED;
+	if (armed && !(o.flags & MSP_CMD_ARMED)) return MspTransferStatus::ARMED;
+	if (len > o.maxLen || len > bufSize) return MspTransferStatus::TOO_LARGE;
+	begin(object);
+	state = State::UPLOAD;
+	this->len = len;
+	this->crc = crc;
+	*session = this->session;
+	return MspTransferStatus::OK;
+}
+
+MspTransferStatus MspTransfer::read(u8 session, u32 offset, u32 maxLen, const u8 **data, u32 *len) {
+	if (session != this->session || state != State::DOWNLOAD) return MspTransferStatus::NO_SESSION;
+	if (offset > this->len) return MspTransferStatus::OFFSET;
+	*data = buf + offset;
+	*len = this->len - offset < maxLen ? this->len - offset : maxLen;
+	return MspTransferStatus::OK;
+}
+
+MspTransferStatus MspTransfer::write(u8 session, u32 offset, const u8 *data, u32 len, u32 *received) {
+	*received = pos;
+	if (session != this->session || state != State::UPLOAD) return MspTransferStatus::NO_SESSION;
+	if (offset > pos) return MspTransferStatus::OFFSET;
+	u32 skip = pos - offset;
+	if (skip >= len) return MspTransferStatus::OK;
+	if (offset + len > this->len) return MspTransferStatus::TOO_LARGE;
+	memcpy(buf + pos, data + skip, len - skip);
+	pos += len - skip;
+	*received = pos;
+	return MspTransferStatus::OK;
+}
+
+MspTransferStatus MspTransfer::finish(u8 session, u32 *progress) {
+	*progress = 0;
+	if (session != this->session) return MspTransferStatus::NO_SESSION;
+	switch (state) {
+	case State::DOWNLOAD:
+		state = State::IDLE;
+		return MspTransferStatus::OK;
+	case State::UPLOAD:
+		*progress = pos;
+		if (pos != len) return MspTransferStatus::INCOMPLETE;
+		if (crc32(buf, len) != crc) {
+			pos = 0;
+			return MspTransferStatus::CRC;
+		}
+		state = State::APPLYING;
+		pos = 0;
+		*progress = 0;
+		return MspTransferStatus::BUSY;
+	case State::APPLYING:
+		*progress = pos;
+		return MspTransferStatus::BUSY;
+	case State::APPLIED:
+		*progress = len;
+		return MspTransferStatus::OK;
+	case State::FAILED:
+		*progress = pos;
+		return MspTransferStatus::REJECTED;
+	default:
+		return MspTransferStatus::NO_SESSION;
+	}
+}
+
+void MspTransfer::loop(bool armed) {
+	if (state != State::APPLYING) return;
+	const MspTransferObject &o = objects[object];
+	if (armed && !(o.flags & MSP_CMD_ARMED)) {
+		state = State::FAILED;
+		return;
+	}
+	i32 p = o.load(buf, len, pos);
+	if (p < 0 || (u32)p > len || (u32)p < pos) {
+		state = State::FAILED;
+		return;
+	}
+	pos = p;
+	if (pos == len) state = State::APPLIED;
+}
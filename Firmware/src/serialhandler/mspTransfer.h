@@ -0,0 +1,125 @@
+/**
+ * @file mspTransfer.h
+ * @brief Segmented MSP transfers of objects that don't fit into one frame
+ *
+ * Copyright (c) 2026 Kolibri-FC contributors
+ *
+ * This file is part of Kolibri-FC (https://github.com/bastian2001/Kolibri-FC).
+ *
+ * Kolibri-FC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Kolibri-FC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include "typedefs.h"
+
+#define MSP_TRANSFER_BUF_SIZE 16384 // staging buffer, fits the biggest object (OSD font, 256 x 54)
+#define MSP_TRANSFER_HEADER 6 // status, session, offset (4) in front of the data of a TRANSFER_READ response
+
+/// @brief IDs of the objects, the configurator uses the same ones
+enum class MspObject : u8 {
+	OSD_ELEMENTS = 0, // 8 bytes per element: type (2), col, row, option (4)
+	OSD_FONT = 1, // 54 bytes per character, from character 0 on
+	COUNT
+};
+
+enum class MspTransferStatus : u8 {
+	OK,
+	BUSY, // upload is being applied, ask again (TRANSFER_FINISH)
+	UNKNOWN_OBJECT,
+	NOT_SUPPORTED, // object can't go in this direction
+	ARMED, // object may not be changed while armed
+	TOO_LARGE,
+	NO_SESSION, // session ID is not the current one, start over
+	OFFSET, // write does not continue the received data, the response has the offset to continue at
+	INCOMPLETE, // finish before all bytes arrived
+	CRC, // CRC32 over the whole object does not match, the upload starts over at 0
+	REJECTED, // the object refused the data
+};
+
+typedef struct mspTransferObject {
+	/// @brief writes the object to buf for a download, returns its length or -1. nullptr if it can't be downloaded
+	i32 (*save)(u8 *buf, u32 bufSize);
+	/**
+	 * @brief applies an uploaded object, nullptr if it can't be uploaded
+	 *
+	 * @details Called from the loop until it returns len, so slow objects (NVM writes) can go in steps. pos is what the previous call returned, 0 at first
+	 * @return new position, -1 if the data is invalid
+	 */
+	i32 (*load)(const u8 *data, u32 len, u32 pos);
+	u32 maxLen; // upload size limit
+	u8 flags; // MSP_CMD_ARMED: may be uploaded while armed
+} MspTransferObject;
+
+/**
+ * @brief One transfer at a time, between the staging buffer and an object
+ *
+ * @details Downloads take a snapshot of the object when they begin, so the host can read any offset in any order and just read again what got lost. Uploads only accept the bytes that continue what was received, every write answers with that offset, so after an interruption the host sends an empty write, reads where to continue and goes on from there. Nothing is applied before the CRC32 over the whole object matches. A session stays until the next one begins, also across reconnects.
+ */
+class MspTransfer {
+public:
+	/**
+	 * @param objects table indexed by MspObject
+	 * @param buf staging buffer, shared by downloads and uploads
+	 */
+	MspTransfer(const MspTransferObject *objects, u8 objectCount, u8 *buf, u32 bufSize)
+		: objects(objects), objectCount(objectCount), buf(buf), bufSize(bufSize) {}
+
+	/// @brief snapshots the object, returns the session, length and CRC32 of the snapshot
+	MspTransferStatus beginDownload(u8 object, u8 *session, u32 *len, u32 *crc);
+	/// @brief starts receiving len bytes for the object, crc is the CRC32 over all of them
+	MspTransferStatus beginUpload(u8 object, u32 len, u32 crc, bool armed, u8 *session);
+
+	/// @brief points data to up to maxLen bytes of the download from offset on
+	MspTransferStatus read(u8 session, u32 offset, u32 maxLen, const u8 **data, u32 *len);
+	/**
+	 * @brief takes the part of data that continues the upload
+	 *
+	 * @details Bytes before *received are dropped (repeated after a lost response), a gap after it is an error. len 0 just asks for the offset
+	 * @param received out: bytes received so far, the offset of the next write
+	 */
+	MspTransferStatus write(u8 session, u32 offset, const u8 *data, u32 len, u32 *received);
+	/**
+	 * @brief ends a download, or checks and applies an upload
+	 *
+	 * @details The upload is applied by loop(), until then this returns BUSY. Repeating it after OK or REJECTED returns the same again
+	 * @param progress out: bytes of the upload applied so far
+	 */
+	MspTransferStatus finish(u8 session, u32 *progress);
+
+	/// @brief applies a checked upload in steps, aborts it if the FC got armed and the object does not allow that
+	void loop(bool armed);
+
+private:
+	enum class State : u8 {
+		IDLE,
+		DOWNLOAD,
+		UPLOAD,
+		APPLYING,
+		APPLIED,
+		FAILED,
+	};
+	void begin(u8 object); // new session, drops the previous one
+
+	const MspTransferObject *objects;
+	const u8 objectCount;
+	u8 *buf;
+	const u32 bufSize;
+
+	State state = State::IDLE;
+	u8 object = 0;
+	u8 session = 0; // 0 is never used, so a host that never began one can't hit it
+	u32 len = 0;
+	u32 crc = 0;
+	u32 pos = 0; // received bytes while uploading, applied bytes while applying
+};
@@ -0,0 +1,134 @@
+/**
+ * @file mspWriter.cpp
+ * @brief MSP V2 responses serialized in place in the TX buffer of a port
+ *
+ * Copyright (c) 2026 Kolibri-FC contributors
+ *
+ * This file is part of Kolibri-FC (https://github.com/bastian2001/Kolibri-FC).
+ *
+ * Kolibri-FC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Kolibri-FC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mspWriter.h"
+
+MspWriter::MspWriter(MspTxTarget &target, MspFn fn, MspMsgType type, i32 len, bool raw)
+	: target(target),
+	  fn(fn),
+	  type(type),
+	  announced(len),
+	  raw(raw) {
+	target.txLock();
+	if (raw) return;
+	if (announced >= 0) {
+		// header is final right away, spans can be published as soon as they are full
+		const u8 header[MSP_V2_HEADER_SIZE] = {'$', 'X', (u8)type, 0, (u8)((u16)fn & 0xFF), (u8)((u16)fn >> 8), (u8)(announced & 0xFF), (u8)(announced >> 8)};
+		for (u32 i = 0; i < MSP_V2_HEADER_SIZE; i++)
+			writeAt(i, header[i]);
+	}
+	pending = MSP_V2_HEADER_SIZE; // with unknown length: left empty until finish()
+}
+
+MspWriter::~MspWriter() {
+	if (locked) finish();
+}
+
+void MspWriter::writeAt(u32 offset, u8 v) {
+	u32 len;
+	u8 *p = target.txSpan(offset, &len);
+	if (len)
+		*p = v;
+	else
+		failed = true;
+}
+
+void MspWriter::closeSpan() {
+	u32 n = pos - spanStart;
+	if (!raw) crc = crc8D5(spanStart, n, crc);
+	written += n;
+	pending += n;
+	spanStart = pos;
+}
+
+bool MspWriter::nextSpan() {
+	if (failed || !locked) return false;
+	closeSpan();
+	if (!raw && announced >= 0) {
+		if (written >= (u32)announced) {
+			failed = true; // more than announced, the header can't be changed anymore
+			return false;
+		}
+		target.txPublish(pending);
+		pending = 0;
+	}
+	spanStart = pos = target.txSpan(pending, &left);
+	if (!left) {
+		failed = true;
+		return false;
+	}
+	if (!raw && announced >= 0 && left > announced - written)
+		left = announced - written;
+	return true;
+}
+
+void MspWriter::put(const void *data, u32 len) {
+	const u8 *d = (const u8 *)data;
+	while (len) {
+		if (!left && !nextSpan()) return;
+		u32 c = len < left ? len : left;
+		memcpy(pos, d, c);
+		pos += c;
+		left -= c;
+		d += c;
+		len -= c;
+	}
+}
+
+u8 *MspWriter::space(u32 *len) {
+	if (!left && !nextSpan()) {
+		*len = 0;
+		return nullptr;
+	}
+	if (*len > left) *len = left;
+	return pos;
+}
+
+i32 MspWriter::finish() {
+	if (!locked) return -1;
+	if (!raw && announced >= 0) {
+		// the header is already out: pad a short payload, so the stream stays in sync
+		bool broken = failed || length() < (u32)announced;
+		failed = false;
+		while (length() < (u32)announced && !failed)
+			put8(0);
+		failed |= broken;
+	}
+	closeSpan();
+	left = 0;
+
+	if (!raw && (!failed || announced >= 0)) {
+		if (written > 0xFFFF) failed = true;
+		const u8 header[MSP_V2_HEADER_SIZE] = {'$', 'X', (u8)type, 0, (u8)((u16)fn & 0xFF), (u8)((u16)fn >> 8), (u8)(written & 0xFF), (u8)(written >> 8)};
+		if (announced < 0) {
+			for (u32 i = 0; i < MSP_V2_HEADER_SIZE; i++)
+				writeAt(i, header[i]);
+		}
+		// CRC over flag, fn and len, moved past the payload, plus the payload CRC that started at 0
+		writeAt(pending, crc8D5Combine(crc8D5(&header[3], MSP_V2_HEADER_SIZE - 3), crc, written));
+		// a frame with announced length goes out even if it went wrong, parts of it are already published
+		if (!failed || announced >= 0) target.txPublish(pending + 1);
+	}
+	locked = false;
+	target.txUnlock();
+	return failed ? -1 : written;
+}
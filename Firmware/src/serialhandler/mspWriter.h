@@ -0,0 +1,150 @@
+/**
+ * @file mspWriter.h
+ * @brief MSP V2 responses serialized in place in the TX buffer of a port
+ *
+ * Copyright (c) 2026 Kolibri-FC contributors
+ *
+ * This file is part of Kolibri-FC (https://github.com/bastian2001/Kolibri-FC).
+ *
+ * Kolibri-FC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Kolibri-FC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include "mspRegistry.h"
+#include "utils/checksum.h"
+#include <stddef.h>
+#include <string.h>
+
+#define MSP_V2_HEADER_SIZE 8 // $ X type flag fn(2) len(2)
+
+/**
+ * @brief Something with a TX buffer that responses can be written into
+ *
+ * @details The writer asks for free space behind what was already published, fills it and then publishes it in one go. Between txLock() and txUnlock() nobody else may write to the target.
+ */
+class MspTxTarget {
+public:
+	virtual void txLock() = 0;
+	virtual void txUnlock() = 0;
+	/**
+	 * @brief Free space offset bytes behind the last published byte
+	 *
+	 * @details Waits (and drains the buffer) until at least one byte is free, unless the unpublished bytes alone fill the whole buffer
+	 *
+	 * @param offset bytes written but not yet published
+	 * @param len out: contiguous bytes at the returned address, 0 if there is no space
+	 */
+	virtual u8 *txSpan(u32 offset, u32 *len) = 0;
+	/// @brief hands len bytes to the consumer
+	virtual void txPublish(u32 len) = 0;
+};
+
+/**
+ * @brief Builds a response directly in the TX buffer
+ *
+ * @details Fields go straight into the buffer, the CRC is run over each filled span when the writer moves to the next one, so the payload is touched once after the handler produced it. The header is filled in finish(), when the length is known: the payload CRC starts at 0 and is combined with the header CRC by advancing the header CRC over the payload length.
+ *
+ * With an unknown length the whole frame has to fit into the TX buffer, as nothing can be published before the header is complete. If the length is given up front, filled spans are published as they go, so frames of any size stream through.
+ *
+ * In raw mode (anything but V2 on a serial port), only the payload is written and the caller frames it, see MspResponse.
+ */
+class MspWriter {
+public:
+	/**
+	 * @param target TX buffer, stays locked until finish()
+	 * @param fn function of the response
+	 * @param type response type, RESPONSE or ERROR
+	 * @param len payload length if known, -1 otherwise
+	 * @param raw only the payload, no header and CRC
+	 */
+	MspWriter(MspTxTarget &target, MspFn fn, MspMsgType type, i32 len = -1, bool raw = false);
+	MspWriter(const MspWriter &) = delete;
+	~MspWriter();
+
+	void put8(u8 v) {
+		if (!left && !nextSpan()) return;
+		*pos++ = v;
+		left--;
+	};
+	void put16(u16 v) {
+		if (left < 2) {
+			put8(v);
+			put8(v >> 8);
+			return;
+		}
+		memcpy(pos, &v, 2); // little endian, like MSP
+		pos += 2;
+		left -= 2;
+	};
+	void put32(u32 v) {
+		if (left < 4) {
+			put16(v);
+			put16(v >> 16);
+			return;
+		}
+		memcpy(pos, &v, 4);
+		pos += 4;
+		left -= 4;
+	};
+	/// @brief copies len bytes
+	void put(const void *data, u32 len);
+	/**
+	 * @brief Direct access for producers that fill a buffer themselves (e.g. file reads)
+	 *
+	 * @param len in: wanted, out: contiguous bytes at the returned address, may be less than wanted
+	 * @return nullptr if the buffer is full, the frame is then dropped
+	 */
+	u8 *space(u32 *len);
+	/// @brief marks len bytes of the last space() as written
+	void advance(u32 len) {
+		pos += len;
+		left -= len;
+	};
+
+	/// @brief payload bytes written so far
+	u32 length() const { return written + (pos - spanStart); };
+	/// @brief true if the buffer ran out or more than the announced length was written, finish() drops the frame then
+	bool overflow() const { return failed; };
+
+	/**
+	 * @brief Completes the frame (header, CRC) and publishes it, releases the target
+	 *
+	 * @return payload length, -1 if the frame was dropped
+	 */
+	i32 finish();
+	/// @brief drops the frame instead, only possible without announced length (otherwise parts may be out already, finish() pads them)
+	void discard() {
+		failed = true;
+		finish();
+	};
+
+private:
+	bool nextSpan();
+	void closeSpan(); // CRC over the filled part of the current span
+	void writeAt(u32 offset, u8 v); // byte of the unpublished area, e.g. the header
+
+	MspTxTarget &target;
+	const MspFn fn;
+	const MspMsgType type;
+	const i32 announced;
+	const bool raw;
+	bool locked = true;
+	bool failed = false;
+	u8 *pos = nullptr; // write position in the current span
+	u8 *spanStart = nullptr;
+	u32 left = 0; // bytes left in the current span
+	u32 pending = 0; // bytes written to the target but not published, header included
+	u32 written = 0; // payload bytes in closed spans
+	u8 crc = 0; // payload CRC, init 0
+};
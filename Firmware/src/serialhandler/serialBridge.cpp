@@ -0,0 +1,102 @@
+/**
+ * @file serialBridge.cpp
+ * @brief Transparent link between two serial ports (SERIAL_PASSTHROUGH)
+ *
+ * Copyright (c) 2026 Kolibri-FC contributors
+ *
+ * This file is part of Kolibri-FC (https://github.com/bastian2001/Kolibri-FC).
+ *
+ * Kolibri-FC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Kolibri-FC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "global.h"
+
+#define BREAK_NONE 0
+#define BREAK_HOLD 0xFFFF // CDC: until the host ends it
+
+static volatile bool breakRequested = false;
+static volatile u16 breakMs = BREAK_NONE;
+
+#ifdef USE_TINYUSB
+// TinyUSB callback (weak in the stack), the host asks for a break on the CDC line. Nothing else uses it, so it only matters while a bridge runs
+extern "C" void tud_cdc_send_break_cb(uint8_t itf, uint16_t durationMs) {
+	breakMs = durationMs;
+	breakRequested = true;
+}
+#endif
+
+static u32 hostLineBaud(KoliSerial &host) {
+#ifdef USE_TINYUSB
+	if (host.serialType == SerialType::USB) return Serial.baud();
+#endif
+	return 0;
+}
+
+// moves what src received and dst has room for, returns the bytes moved
+static u32 forward(KoliSerial &src, KoliSerial &dst, u8 *buf) {
+	i32 room = dst.availableForWrite();
+	if (room <= 0) return 0;
+	u32 n = src.read(buf, room < SERIAL_BRIDGE_CHUNK ? room : SERIAL_BRIDGE_CHUNK);
+	if (n) dst.write(buf, n);
+	return n;
+}
+
+void runSerialBridge(KoliSerial &host, KoliSerial &device, u32 baud) {
+	static u8 buf[SERIAL_BRIDGE_CHUNK];
+	const u32 oldBaud = device.getBaudrate();
+	device.end();
+	device.begin(baud);
+
+	u32 lineBaud = hostLineBaud(host); // only changes after this are mirrored, the host port usually still has the configurator's rate
+	bool breakActive = false;
+	elapsedMillis breakTimer = 0;
+	u8 plusCount = 0;
+	elapsedMillis hostSilence = 0;
+	breakRequested = false;
+
+	while (!(plusCount >= 3 && hostSilence > SERIAL_BRIDGE_ESCAPE_MS)) {
+		u32 n = forward(host, device, buf);
+		if (n) {
+			hostSilence = 0;
+			for (u32 i = 0; i < n; i++)
+				plusCount = buf[i] == '+' ? plusCount + 1 : 0;
+			if (plusCount > 3) plusCount = 3;
+		}
+		forward(device, host, buf);
+		device.loop(SERIAL_BRIDGE_CHUNK);
+		host.loop(SERIAL_BRIDGE_CHUNK);
+
+		u32 b = hostLineBaud(host);
+		if (b && b != lineBaud) {
+			lineBaud = b;
+			device.setBaudrate(b);
+		}
+		if (breakRequested) {
+			breakRequested = false;
+			breakActive = breakMs != BREAK_NONE;
+			device.setBreak(breakActive);
+			breakTimer = 0;
+		}
+		if (breakActive && breakMs != BREAK_HOLD && breakTimer >= breakMs) {
+			breakActive = false;
+			device.setBreak(false);
+		}
+		rp2040.wdt_reset();
+	}
+
+	if (breakActive) device.setBreak(false);
+	device.flush();
+	device.end();
+	device.begin(oldBaud);
+}
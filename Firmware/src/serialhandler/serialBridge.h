@@ -0,0 +1,39 @@
+/**
+ * @file serialBridge.h
+ * @brief Transparent link between two serial ports (SERIAL_PASSTHROUGH), e.g. to flash a receiver or set up a VTX from the PC
+ *
+ * Copyright (c) 2026 Kolibri-FC contributors
+ *
+ * This file is part of Kolibri-FC (https://github.com/bastian2001/Kolibri-FC).
+ *
+ * Kolibri-FC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Kolibri-FC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include "typedefs.h"
+
+class KoliSerial;
+
+#define SERIAL_BRIDGE_CHUNK 512 // bytes moved per direction and pass
+#define SERIAL_BRIDGE_ESCAPE_MS 1000 // "+++" from the host followed by this much silence ends the bridge
+
+/**
+ * @brief Forwards everything between host and device until the host sends the escape sequence
+ *
+ * @details Blocks core 0 in a tight loop that moves whole chunks from one port's RX ring into the other's TX ring, each direction only as much as the TX side has room for, so a slow side holds the fast one back instead of losing bytes. The DMA of both ports does the rest. When the host is USB CDC, baud rate changes the host makes after the start are applied to the device port, and a CDC break (SEND_BREAK) is sent on it as a line break (hardware UARTs only). The device port gets its previous baud rate back afterwards.
+ *
+ * @param host port the request came from (or another one chosen by the host)
+ * @param device port to link to, restarted at baud
+ */
+void runSerialBridge(KoliSerial &host, KoliSerial &device, u32 baud);
@@ -0,0 +1,164 @@
+/**
+ * @file serialDetect.cpp
+ * @brief Serial protocol detection by baud rate and polarity probing
+ *
+ * Copyright (c) 2026 Kolibri-FC contributors
+ *
+ * This file is part of Kolibri-FC (https://github.com/bastian2001/Kolibri-FC).
+ *
+ * Kolibri-FC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Kolibri-FC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "serialDetect.h"
+#include <string.h>
+
+// CRSF first, it is the most common and the fastest to recognize, GPS receivers ship with 9600 or 38400
+static const SerialProbe probes[] = {
+	{420000, false, false},
+	{115200, false, false},
+	{38400, false, false},
+	{9600, false, true},
+	{230400, false, false},
+	{57600, false, false},
+	{420000, true, false},
+	{115200, true, false},
+	{38400, true, false},
+	{9600, true, true},
+	{230400, true, false},
+	{57600, true, false},
+};
+
+static const char protocolNames[SerialDetector::PROTOCOL_COUNT][8] = {
+	"None",
+	"CRSF",
+	"MSP",
+	"GPS",
+	"Tramp",
+};
+
+
+u8 SerialDetector::probeCount() { return sizeof(probes) / sizeof(probes[0]); }
+
+const char *SerialDetector::protocolName(Protocol p) {
+	if (p >= PROTOCOL_COUNT) return protocolNames[NONE];
+	return protocolNames[p];
+}
+
+const SerialProbe &SerialDetector::probe() const { return probes[stepIndex]; }
+
+void SerialDetector::begin(u32 nowMs) {
+	stepIndex = 0;
+	stepStartMs = nowMs;
+	detected = NONE;
+	reset();
+}
+
+void SerialDetector::reset() {
+	memset(frames, 0, sizeof(frames));
+	crsf = CrsfParser();
+	msp.abort();
+	nmeaActive = false;
+	memset(tramp, 0, sizeof(tramp));
+	// the UBX parser resyncs on its own, half a frame from the last step fails its checksum
+}
+
+bool SerialDetector::tick(u32 nowMs) {
+	if (detected != NONE) return false;
+	if (nowMs - stepStartMs < SERIAL_DETECT_DWELL_MS) return false;
+	if (++stepIndex >= probeCount()) stepIndex = 0;
+	stepStartMs = nowMs;
+	reset();
+	return true;
+}
+
+u8 SerialDetector::query(u8 *out) const {
+	if (!probe().trampQuery) return 0;
+	// Tramp INIT ('r') without parameters, the checksum is over bytes 1 to 13
+	memset(out, 0, 16);
+	out[0] = 0x0F;
+	out[1] = 'r';
+	out[14] = 'r';
+	return 16;
+}
+
+static i32 hexDigit(char c) {
+	if (c >= '0' && c <= '9') return c - '0';
+	if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+	if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+	return -1;
+}
+
+// $<talker and type>,<fields>*<two hex digits of the XOR of everything in between>
+bool SerialDetector::nmeaByte(u8 c) {
+	if (c == '$') {
+		nmeaActive = true;
+		nmeaLen = 0;
+		return false;
+	}
+	if (!nmeaActive) return false;
+	if (c < 0x20 || c > 0x7E || nmeaLen >= sizeof(nmea)) {
+		nmeaActive = false;
+		return false;
+	}
+	nmea[nmeaLen++] = c;
+	if (nmeaLen < 3 || nmea[nmeaLen - 3] != '*') return false;
+
+	nmeaActive = false;
+	u8 bodyLen = nmeaLen - 3;
+	if (bodyLen < 5) return false; // talker and type alone are 5 characters
+	i32 hi = hexDigit(nmea[nmeaLen - 2]);
+	i32 lo = hexDigit(nmea[nmeaLen - 1]);
+	if (hi < 0 || lo < 0) return false;
+	u8 sum = 0;
+	for (int i = 0; i < bodyLen; i++)
+		sum ^= nmea[i];
+	return sum == (hi << 4 | lo);
+}
+
+// answer to the INIT query: min frequency, max frequency, max power. Our own query (all zero) comes back as echo on a half duplex line and must not count
+bool SerialDetector::trampByte(u8 c) {
+	memmove(tramp, tramp + 1, 15);
+	tramp[15] = c;
+	if (tramp[0] != 0x0F || tramp[15] != 0 || tramp[1] != 'r') return false;
+	u8 sum = 0;
+	for (int i = 1; i < 14; i++)
+		sum += tramp[i];
+	if (sum != tramp[14]) return false;
+	u16 minFreq = tramp[2] | tramp[3] << 8;
+	u16 maxFreq = tramp[4] | tramp[5] << 8;
+	u16 maxPwr = tramp[6] | tramp[7] << 8;
+	return minFreq >= 4900 && minFreq <= maxFreq && maxFreq <= 6100 && maxPwr;
+}
+
+SerialDetector::Protocol SerialDetector::feed(const u8 *data, u32 len) {
+	for (u32 i = 0; i < len && detected == NONE; i++) {
+		u8 c = data[i];
+		if (crsf.parseChar(c) == CrsfParser::FRAME) frames[CRSF]++;
+		if (msp.handleByte(c) == MspFramer::FRAME) frames[MSP]++;
+		if (ubx.feed(c)) {
+			frames[GPS]++;
+			while (ubx.poll()) frames[GPS]++;
+		}
+		if (nmeaByte(c)) frames[GPS]++;
+		if (trampByte(c)) frames[TRAMP]++;
+
+		for (int p = CRSF; p < PROTOCOL_COUNT; p++) {
+			if (frames[p] >= (p == TRAMP ? 1 : SERIAL_DETECT_FRAMES)) {
+				detected = (Protocol)p;
+				break;
+			}
+		}
+	}
+	return detected;
+}
@@ -0,0 +1,104 @@
+/**
+ * @file serialDetect.h
+ * @brief Finds out what is connected to a serial port by probing baud rates and inversion and looking for valid frames
+ *
+ * Copyright (c) 2026 Kolibri-FC contributors
+ *
+ * This file is part of Kolibri-FC (https://github.com/bastian2001/Kolibri-FC).
+ *
+ * Kolibri-FC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Kolibri-FC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include "serialhandler/crsf.h"
+#include "serialhandler/mspFramer.h"
+#include "serialhandler/ubx.h"
+#include "typedefs.h"
+
+#define SERIAL_DETECT_DWELL_MS 1100 // time per probe step, long enough to catch a sentence of a 1 Hz NMEA receiver
+#define SERIAL_DETECT_FRAMES 2 // valid frames of one protocol within a step before it counts, Tramp only answers once per query, so one is enough there
+#define SERIAL_DETECT_NMEA_MAX 82 // longest NMEA sentence, from $ to the checksum
+
+typedef struct serialProbe {
+	u32 baud;
+	bool inverted;
+	bool trampQuery; // Tramp VTXs stay silent until asked, send an INIT query at the start of the step
+} SerialProbe;
+
+/**
+ * @brief Probes one port for CRSF, MSP, GPS (UBX and NMEA) and Tramp
+ *
+ * @details Steps through a fixed list of baud rates, first all of them normal, then inverted. In each step, the received bytes go through the same framers that the handlers use (CrsfParser, MspFramer, UbxParser) plus an NMEA and a Tramp recognizer. Only frames with a valid checksum count, so the garbage a UART produces at the wrong baud rate or polarity does not trigger a detection. The first protocol that reaches its frame count wins, and the current probe is the setting it works with.
+ *
+ * The caller owns the port: on every step change (tick() returns true), it applies probe() and sends query() if that is not empty.
+ */
+class SerialDetector {
+public:
+	enum Protocol : u8 {
+		NONE,
+		CRSF,
+		MSP,
+		GPS,
+		TRAMP,
+		PROTOCOL_COUNT,
+	};
+
+	/// @brief starts over at the first probe
+	void begin(u32 nowMs);
+	/**
+	 * @brief Moves on to the next probe after SERIAL_DETECT_DWELL_MS
+	 *
+	 * @return true if the probe changed, the port has to be reconfigured. Always false once something was detected
+	 */
+	bool tick(u32 nowMs);
+	/**
+	 * @brief Feeds bytes received with the current probe
+	 *
+	 * @return the detected protocol, NONE until then. Bytes after the detection are ignored
+	 */
+	Protocol feed(const u8 *data, u32 len);
+
+	const SerialProbe &probe() const;
+	u8 step() const { return stepIndex; }
+	Protocol result() const { return detected; }
+	/**
+	 * @brief Bytes to send at the start of the current step
+	 *
+	 * @param out buffer of at least 16 bytes
+	 * @return number of bytes, 0 for listening only
+	 */
+	u8 query(u8 *out) const;
+
+	static u8 probeCount();
+	static const char *protocolName(Protocol p);
+
+	u8 frames[PROTOCOL_COUNT] = {}; // valid frames in the current step
+
+private:
+	void reset();
+	bool nmeaByte(u8 c);
+	bool trampByte(u8 c);
+
+	u8 stepIndex = 0;
+	u32 stepStartMs = 0;
+	Protocol detected = NONE;
+
+	CrsfParser crsf;
+	MspFramer msp;
+	UbxParser ubx;
+	char nmea[SERIAL_DETECT_NMEA_MAX + 3]; // sentence without $, up to the second checksum digit
+	u8 nmeaLen = 0;
+	bool nmeaActive = false;
+	u8 tramp[16] = {}; // the last 16 bytes, a Tramp frame once the first one is 0x0F
+};
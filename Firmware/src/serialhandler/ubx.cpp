@@ -0,0 +1,173 @@
+/**
+ * @file ubx.cpp
+ * @brief u-blox UBX protocol: streaming parser, message schema dispatch and the ACK/NAK configuration sequencer
+ *
+ * Copyright (c) 2026 Kolibri-FC contributors
+ *
+ * This file is part of Kolibri-FC (https://github.com/bastian2001/Kolibri-FC).
+ *
+ * Kolibri-FC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Kolibri-FC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ubx.h"
+#include "utils/checksum.h"
+#include <string.h>
+
+void ubxChecksum(const u8 *buf, u32 len, u8 *ck_a, u8 *ck_b) {
+	*ck_a = 0;
+	*ck_b = 0;
+	fletcher8(buf, len, ck_a, ck_b);
+}
+
+u16 ubxBuildFrame(u8 *out, u8 cls, u8 id, const u8 *payload, u16 len) {
+	out[0] = UBX_SYNC1;
+	out[1] = UBX_SYNC2;
+	out[2] = cls;
+	out[3] = id;
+	out[4] = len & 0xFF;
+	out[5] = len >> 8;
+	if (len) memcpy(&out[6], payload, len);
+	ubxChecksum(&out[2], len + 4, &out[len + 6], &out[len + 7]);
+	return len + UBX_FRAME_OVERHEAD;
+}
+
+void UbxParser::drop(u32 n) {
+	count -= n;
+	memmove(buf, &buf[n], count);
+}
+
+bool UbxParser::process() {
+	while (count) {
+		if (buf[0] != UBX_SYNC1 || (count >= 2 && buf[1] != UBX_SYNC2)) {
+			// skip up to the next possible start of a frame
+			u32 next = 1;
+			while (next < count && buf[next] != UBX_SYNC1) next++;
+			skipped += next;
+			drop(next);
+			continue;
+		}
+		if (count < 6) return false;
+		const u16 len = buf[4] | buf[5] << 8;
+		if (len > UBX_MAX_PAYLOAD) {
+			lengthErrors++;
+			lastError = 2;
+			skipped++;
+			drop(1);
+			continue;
+		}
+		if (count < (u32)len + UBX_FRAME_OVERHEAD) return false;
+		u8 ck_a, ck_b;
+		ubxChecksum(&buf[2], len + 4, &ck_a, &ck_b);
+		if (ck_a != buf[len + 6] || ck_b != buf[len + 7]) {
+			checksumErrors++;
+			lastError = 3;
+			skipped++;
+			drop(1);
+			continue;
+		}
+		messages++;
+		msgLen = len;
+		consumed = len + UBX_FRAME_OVERHEAD;
+		return true;
+	}
+	return false;
+}
+
+bool UbxParser::poll() {
+	if (consumed) {
+		drop(consumed);
+		consumed = 0;
+	}
+	return process();
+}
+
+bool UbxParser::feed(u8 c) {
+	if (consumed) {
+		drop(consumed);
+		consumed = 0;
+	}
+	if (count == sizeof(buf)) {
+		// can only happen if the rest of a resync filled the buffer, the oldest byte can not start a complete frame anymore
+		skipped++;
+		drop(1);
+	}
+	buf[count++] = c;
+	return process();
+}
+
+UbxDispatch ubxDispatch(const UbxMsgSchema *table, u32 tableLen, u8 cls, u8 id, const u8 *payload, u16 len) {
+	for (u32 i = 0; i < tableLen; i++) {
+		const UbxMsgSchema &s = table[i];
+		if (s.cls != cls || s.id != id) continue;
+		u32 expected = s.len;
+		if (s.blockLen) {
+			if (len < s.len) return UbxDispatch::BAD_LENGTH;
+			expected += (u32)s.blockLen * payload[s.countOffset];
+		}
+		if (len != expected) return UbxDispatch::BAD_LENGTH;
+		s.handler(payload, len);
+		return UbxDispatch::HANDLED;
+	}
+	return UbxDispatch::UNKNOWN;
+}
+
+void UbxConfigSequencer::restart(u32 now) {
+	step = 0;
+	attempt = 0;
+	due = false;
+	lastSend = now;
+}
+
+void UbxConfigSequencer::next() {
+	step++;
+	attempt = 0;
+	due = true;
+}
+
+void UbxConfigSequencer::loop(u32 now) {
+	if (done()) return;
+	if (!due && now - lastSend < timeoutUs) return;
+	if (!due && attempt) timeouts++;
+	if (attempt >= maxAttempts) {
+		if (steps[step].optional) {
+			skippedSteps++;
+			next();
+			if (done()) return;
+		} else {
+			restarts++;
+			step = 0;
+			attempt = 0;
+		}
+	}
+	const UbxConfigStep &s = steps[step];
+	if (s.beforeSend) s.beforeSend(attempt);
+	u8 frame[UBX_FRAME_OVERHEAD + 255];
+	send(frame, ubxBuildFrame(frame, s.cls, s.id, s.payload, s.len));
+	attempt++;
+	due = false;
+	lastSend = now;
+}
+
+void UbxConfigSequencer::onAck(const u8 *payload, bool ack) {
+	if (done()) return;
+	const UbxConfigStep &s = steps[step];
+	if (payload[0] != s.cls || payload[1] != s.id) return;
+	if (ack) {
+		next();
+	} else {
+		// rejected, try again right away until the attempts run out
+		naks++;
+		due = true;
+	}
+}
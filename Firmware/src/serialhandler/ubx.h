@@ -0,0 +1,274 @@
+/**
+ * @file ubx.h
+ * @brief u-blox UBX protocol: streaming parser, message schema dispatch and the ACK/NAK configuration sequencer
+ *
+ * Copyright (c) 2026 Kolibri-FC contributors
+ *
+ * This file is part of Kolibri-FC (https://github.com/bastian2001/Kolibri-FC).
+ *
+ * Kolibri-FC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Kolibri-FC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include "typedefs.h"
+
+#define UBX_SYNC1 0xB5
+#define UBX_SYNC2 0x62
+#define UBX_MAX_PAYLOAD 3068 // NAV-SAT with the maximum of 255 satellites (8 + 12 * 255)
+#define UBX_FRAME_OVERHEAD 8 // sync, class, id, length, checksum
+
+enum ubx_class : u8 {
+	UBX_CLASS_NAV = 0x01,
+	UBX_CLASS_RXM = 0x02,
+	UBX_CLASS_INF = 0x04,
+	UBX_CLASS_ACK = 0x05,
+	UBX_CLASS_CFG = 0x06,
+	UBX_CLASS_UPD = 0x09,
+	UBX_CLASS_MON = 0x0A,
+	UBX_CLASS_AID = 0x0B,
+	UBX_CLASS_TIM = 0x0D,
+	UBX_CLASS_ESF = 0x10,
+	UBX_CLASS_MGA = 0x13,
+	UBX_CLASS_LOG = 0x21,
+	UBX_CLASS_SEC = 0x27,
+	UBX_CLASS_HNR = 0x28,
+	UBX_CLASS_TP5 = 0x31,
+};
+
+enum nmea_class : u8 {
+	NMEA_CLASS_STANDARD = 0xF0,
+	NMEA_CLASS_PUBX = 0xF1,
+};
+
+enum ubx_msg_id : u8 {
+	UBX_ID_ACK_ACK = 0x01,
+	UBX_ID_ACK_NAK = 0x00,
+	UBX_ID_AID_ALM = 0x30,
+	UBX_ID_AID_AOP = 0x33,
+	UBX_ID_AID_EPH = 0x31,
+	UBX_ID_AID_HUI = 0x02,
+	UBX_ID_AID_INI = 0x01,
+	UBX_ID_CFG_ANT = 0x13,
+	UBX_ID_CFG_BATCH = 0x93,
+	UBX_ID_CFG_CFG = 0x09,
+	UBX_ID_CFG_DAT = 0x06,
+	UBX_ID_CFG_DGNSS = 0x70,
+	UBX_ID_CFG_DOSC = 0x61,
+	UBX_ID_CFG_ESFALG = 0x56,
+	UBX_ID_CFG_ESFA = 0x4C,
+	UBX_ID_CFG_ESFG = 0x4D,
+	UBX_ID_CFG_ESFWT = 0x82,
+	UBX_ID_CFG_ESRC = 0x60,
+	UBX_ID_CFG_GEOFENCE = 0x69,
+	UBX_ID_CFG_GNSS = 0x3E,
+	UBX_ID_CFG_HNR = 0x5C,
+	UBX_ID_CFG_INF = 0x02,
+	UBX_ID_CFG_ITFM = 0x39,
+	UBX_ID_CFG_LOGFILTER = 0x47,
+	UBX_ID_CFG_MSG = 0x01,
+	UBX_ID_CFG_NAV5 = 0x24,
+	UBX_ID_CFG_NAVX5 = 0x23,
+	UBX_ID_CFG_NMEA = 0x17,
+	UBX_ID_CFG_ODO = 0x1E,
+	UBX_ID_CFG_PM2 = 0x3B,
+	UBX_ID_CFG_PMS = 0x86,
+	UBX_ID_CFG_PRT = 0x00,
+	UBX_ID_CFG_PWR = 0x57,
+	UBX_ID_CFG_RATE = 0x08,
+	UBX_ID_CFG_RINV = 0x34,
+	UBX_ID_CFG_RST = 0x04,
+	UBX_ID_CFG_RXM = 0x11,
+	UBX_ID_CFG_SBAS = 0x16,
+	UBX_ID_CFG_SENIF = 0x88,
+	UBX_ID_CFG_SLAS = 0x8D,
+	UBX_ID_CFG_SMGR = 0x62,
+	UBX_ID_CFG_SPT = 0x64,
+	UBX_ID_CFG_TMODE2 = 0x3D,
+	UBX_ID_CFG_TMODE3 = 0x71,
+	UBX_ID_CFG_TP5 = 0x31,
+	UBX_ID_CFG_TXSLOT = 0x53,
+	UBX_ID_CFG_USB = 0x1B,
+	UBX_ID_ESF_ALG = 0x14,
+	UBX_ID_ESF_INS = 0x15,
+	UBX_ID_ESF_MEAS = 0x02,
+	UBX_ID_ESF_RAW = 0x03,
+	UBX_ID_ESF_STATUS = 0x10,
+	UBX_ID_HNR_ATT = 0x01,
+	UBX_ID_HNR_INS = 0x02,
+	UBX_ID_HNR_PVT = 0x00,
+	UBX_ID_INF_DEBUG = 0x04,
+	UBX_ID_INF_ERROR = 0x00,
+	UBX_ID_INF_NOTICE = 0x02,
+	UBX_ID_INF_TEST = 0x03,
+	UBX_ID_INF_WARNING = 0x01,
+	UBX_ID_SEC_UNIQID = 0x03,
+	UBX_ID_MON_HW = 0x09,
+	UBX_ID_NAV_STATUS = 0x03,
+	UBX_ID_NAV_DOP = 0x04,
+	UBX_ID_NAV_PVT = 0x07,
+	UBX_ID_NAV_SAT = 0x35,
+};
+
+enum nmea_msg_id : u8 {
+	NMEA_ID_DTM = 0x0A,
+	NMEA_ID_GBQ = 0x44,
+	NMEA_ID_GBS = 0x09,
+	NMEA_ID_GGA = 0x00,
+	NMEA_ID_GLL = 0x01,
+	NMEA_ID_GLQ = 0x43,
+	NMEA_ID_GNQ = 0x42,
+	NMEA_ID_GNS = 0x0D,
+	NMEA_ID_GPQ = 0x40,
+	NMEA_ID_GRS = 0x06,
+	NMEA_ID_GSA = 0x02,
+	NMEA_ID_GST = 0x07,
+	NMEA_ID_GSV = 0x03,
+	NMEA_ID_RMC = 0x04,
+	NMEA_ID_THS = 0x0E,
+	NMEA_ID_TXT = 0x41,
+	NMEA_ID_VLW = 0x0F,
+	NMEA_ID_VTG = 0x05,
+	NMEA_ID_ZDA = 0x08,
+
+	NMEA_ID_CONFIG = 0x41,
+	NMEA_ID_POSITION = 0x00,
+	NMEA_ID_RATE = 0x40,
+	NMEA_ID_SVSTATUS = 0x03,
+	NMEA_ID_TIME = 0x04,
+};
+
+/// @brief Fletcher-8 checksum of UBX frames, over class, id, length and payload
+void ubxChecksum(const u8 *buf, u32 len, u8 *ck_a, u8 *ck_b);
+
+/**
+ * @brief Builds a complete UBX frame
+ *
+ * @param out buffer of at least len + UBX_FRAME_OVERHEAD bytes
+ * @return length of the frame
+ */
+u16 ubxBuildFrame(u8 *out, u8 cls, u8 id, const u8 *payload, u16 len);
+
+/**
+ * @brief Streaming UBX parser
+ *
+ * @details Bytes are collected until a frame is complete and its checksum matches. Bytes that do not start a frame (NMEA, line noise) are skipped. If a frame turns out to be broken (length too large, wrong checksum), the search starts again one byte after its sync, so that a real frame hidden behind a false sync or a corrupted length is not lost.
+ */
+class UbxParser {
+public:
+	/**
+	 * @brief Feeds one byte
+	 *
+	 * @return true if a message is complete, see cls(), id(), payload() and len(). Valid until the next call of feed() or poll()
+	 */
+	bool feed(u8 c);
+
+	/// @brief returns further complete messages that are left in the buffer after a resync, without new bytes
+	bool poll();
+
+	u8 cls() const { return buf[2]; }
+	u8 id() const { return buf[3]; }
+	u16 len() const { return msgLen; }
+	const u8 *payload() const { return &buf[6]; }
+
+	u32 messages = 0; // valid frames
+	u32 checksumErrors = 0;
+	u32 lengthErrors = 0; // length above UBX_MAX_PAYLOAD
+	u32 skipped = 0; // bytes outside of frames
+	u8 lastError = 0; // 2: length, 3: checksum
+
+private:
+	bool process();
+	void drop(u32 n);
+	u8 buf[UBX_MAX_PAYLOAD + UBX_FRAME_OVERHEAD];
+	u32 count = 0;
+	u16 msgLen = 0;
+	u16 consumed = 0; // length of the frame returned last, removed on the next call
+};
+
+typedef void (*UbxHandler)(const u8 *payload, u16 len);
+
+/// @brief one entry of a message table, see ubxDispatch()
+typedef struct ubxMsgSchema {
+	u8 cls;
+	u8 id;
+	u16 len; // fixed length, or the length of the header for messages with repeated blocks
+	u16 blockLen; // length of each repeated block, 0 for fixed length messages
+	u8 countOffset; // payload offset of the U1 number of blocks
+	UbxHandler handler;
+} UbxMsgSchema;
+
+enum class UbxDispatch : u8 {
+	HANDLED = 0,
+	UNKNOWN, // not in the table
+	BAD_LENGTH, // length does not match the schema, the handler was not called
+};
+
+/**
+ * @brief Calls the handler of a message if its length matches the schema
+ *
+ * @details Handlers can rely on the length: fixed messages have exactly schema.len bytes, messages with blocks exactly len + blockLen * number of blocks.
+ */
+UbxDispatch ubxDispatch(const UbxMsgSchema *table, u32 tableLen, u8 cls, u8 id, const u8 *payload, u16 len);
+
+/// @brief one message of a configuration sequence, acknowledged by ACK-ACK
+typedef struct ubxConfigStep {
+	u8 cls;
+	u8 id;
+	const u8 *payload;
+	u8 len;
+	void (*beforeSend)(u8 attempt); // optional, e.g. to change the baud rate or fill the payload with current settings
+	bool optional; // skipped after too many attempts, otherwise the sequence starts over
+} UbxConfigStep;
+
+typedef void (*UbxSendFn)(const u8 *frame, u16 len);
+
+/**
+ * @brief Sends configuration messages one by one, each after the previous one was acknowledged
+ *
+ * @details A step is sent again after a timeout or a NAK. After maxAttempts, an optional step is skipped, a required one restarts the whole sequence from the first step (e.g. the receiver lost the baud rate).
+ */
+class UbxConfigSequencer {
+public:
+	UbxConfigSequencer(const UbxConfigStep *steps, u8 stepCount, UbxSendFn send, u32 timeoutUs = 1000000, u8 maxAttempts = 5)
+		: steps(steps), stepCount(stepCount), send(send), timeoutUs(timeoutUs), maxAttempts(maxAttempts) {}
+
+	/// @brief starts over at the first step, which is sent after the timeout
+	void restart(u32 now);
+
+	/// @brief sends the current step if it is due, call regularly
+	void loop(u32 now);
+
+	/// @brief feed ACK-ACK (ack = true) and ACK-NAK messages (payload: class and id of the acknowledged message)
+	void onAck(const u8 *payload, bool ack);
+
+	bool done() const { return step >= stepCount; }
+	u8 currentStep() const { return step; }
+
+	u32 naks = 0;
+	u32 timeouts = 0;
+	u32 restarts = 0;
+	u32 skippedSteps = 0;
+
+private:
+	void next();
+	const UbxConfigStep *steps;
+	const u8 stepCount;
+	const UbxSendFn send;
+	const u32 timeoutUs;
+	const u8 maxAttempts;
+	u8 step = 0;
+	u8 attempt = 0;
+	bool due = false; // send without waiting for the timeout
+	u32 lastSend = 0;
+};
@@ -29,10 +29,16 @@
 #define SETTING_BB_FLAGS "blackbox_flags"
 #define SETTING_BB_DIV "blackbox_freq_divider"
 #define SETTING_BB_SYNC "blackbox_sync_frequency"
+#define SETTING_BB_KEEP_LOGS "blackbox_keep_logs"
 
 // GPS settings
 #define SETTING_GPS_UPDATE_RATE "gps_update_rate"
 #define SETTING_GPS_VEL_FILTER_CUTOFF "gps_velocity_filter_cutoff"
+#define SETTING_GPS_PPS_PIN "gps_pps_pin"
+
+// barometer settings
+#define SETTING_BARO_RATE "baro_rate"
+#define SETTING_BARO_TEMP_COEFF "baro_temp_coefficient"
 
 // magnetometer settings
 #define SETTING_MAG_CAL_HARD "compass_calibration_hard"
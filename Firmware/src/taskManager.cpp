@@ -22,6 +22,7 @@
 
 #include "global.h"
 __attribute__((__aligned__(4))) volatile FCTask tasks[TASK_LENGTH];
+volatile u8 currentTask[2] = {TASK_LENGTH, TASK_LENGTH};
 
 static elapsedMicros taskManagerTimer;
 
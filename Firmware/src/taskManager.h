@@ -23,13 +23,17 @@
 #include "typedefs.h"
 #include <Arduino.h>
 
-#define TASK_START(taskname) elapsedMicros taskTimer##taskname = 0;
+#define TASK_START(taskname)                                     \
+	elapsedMicros taskTimer##taskname = 0;                       \
+	const u8 parentTask##taskname = currentTask[get_core_num()]; \
+	currentTask[get_core_num()] = taskname;
 #if __ARM_FEATURE_SIMD32
 #define TASK_END(taskname)                               \
 	u32 duration##taskname = taskTimer##taskname;        \
 	tasks[taskname].runCounter++;                        \
 	tasks[taskname].totalDuration += duration##taskname; \
-	tasks[taskname].minMaxDuration = minmax16x2(duration##taskname << 16 | duration##taskname, tasks[taskname].minMaxDuration);
+	tasks[taskname].minMaxDuration = minmax16x2(duration##taskname << 16 | duration##taskname, tasks[taskname].minMaxDuration); \
+	currentTask[get_core_num()] = parentTask##taskname;
 #else
 #define TASK_END(taskname)                                \
 	u32 duration##taskname = taskTimer##taskname;         \
@@ -38,7 +42,8 @@
 	if (duration##taskname < tasks[taskname].minDuration) \
 		tasks[taskname].minDuration = duration##taskname; \
 	if (duration##taskname > tasks[taskname].maxDuration) \
-		tasks[taskname].maxDuration = duration##taskname;
+		tasks[taskname].maxDuration = duration##taskname; \
+	currentTask[get_core_num()] = parentTask##taskname;
 #endif
 
 enum Tasks {
@@ -61,6 +66,7 @@ enum Tasks {
 	TASK_MAG_CHECK,
 	TASK_MAG_READ,
 	TASK_MAG_EVAL,
+	TASK_I2C,
 	TASK_OSD,
 	TASK_ANALOG_OSD,
 	TASK_VTX,
@@ -106,6 +112,7 @@ typedef struct task {
 	u32 maxGap; // maximum gap between two runs of the task (from end to start)
 } FCTask;
 extern volatile FCTask tasks[TASK_LENGTH]; // holds all the task stats
+extern volatile u8 currentTask[2]; // innermost Tasks entry that is running on each core, TASK_LENGTH if none, for crash dumps
 
 /// @brief resets all task stats
 void initTaskManager();
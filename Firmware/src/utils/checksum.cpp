@@ -0,0 +1,206 @@
+/**
+ * @file checksum.cpp
+ * @brief Table driven checksums of the serial protocols: CRC8 0xD5 (CRSF, MSP V2), CRC16 XMODEM (4way) and Fletcher-8 (UBX)
+ *
+ * Copyright (c) 2026 Kolibri-FC contributors
+ *
+ * This file is part of Kolibri-FC (https://github.com/bastian2001/Kolibri-FC).
+ *
+ * Kolibri-FC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Kolibri-FC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "checksum.h"
+#include <string.h>
+
+// below this, setting up the slices costs more than it saves
+#define CRC_SLICE_MIN_LEN 16
+
+u32 crcLutD5[256] = {};
+static u8 sliceD5[8][256]; // sliceD5[k][v]: CRC of v followed by k zero bytes
+static u8 advanceD5[16][8]; // advanceD5[k][b]: CRC after 2^k zero bytes, starting from only bit b set
+static u16 sliceXmodem[4][256];
+static u32 sliceCrc32[4][256]; // reflected, sliceCrc32[k][v] like sliceD5
+
+// words are read little endian, like both the RP2350 and the host
+static inline u32 load32(const u8 *p) {
+	u32 v;
+	memcpy(&v, p, 4);
+	return v;
+}
+
+// the CRC is linear, so any start value is the XOR of what its bits turn into
+static u8 applyAdvance(const u8 *columns, u8 crc) {
+	u8 out = 0;
+	for (int b = 0; b < 8; b++) {
+		if (crc & (1 << b)) out ^= columns[b];
+	}
+	return out;
+}
+
+void crcInit() {
+	for (u32 i = 0; i < 256; i++) {
+		u32 crc = i;
+		for (u32 j = 0; j < 8; j++) {
+			if (crc & 0x80)
+				crc = (crc << 1) ^ 0xD5;
+			else
+				crc <<= 1;
+		}
+		crcLutD5[i] = crc & 0xFF;
+		sliceD5[0][i] = crc & 0xFF;
+
+		u16 x = i << 8;
+		for (u32 j = 0; j < 8; j++) {
+			if (x & 0x8000)
+				x = (x << 1) ^ 0x1021;
+			else
+				x <<= 1;
+		}
+		sliceXmodem[0][i] = x;
+
+		u32 r = i;
+		for (u32 j = 0; j < 8; j++)
+			r = r & 1 ? (r >> 1) ^ 0xEDB88320 : r >> 1;
+		sliceCrc32[0][i] = r;
+	}
+	for (u32 k = 1; k < 8; k++) {
+		for (u32 i = 0; i < 256; i++)
+			sliceD5[k][i] = sliceD5[0][sliceD5[k - 1][i]];
+	}
+	for (u32 k = 1; k < 4; k++) {
+		for (u32 i = 0; i < 256; i++) {
+			u16 prev = sliceXmodem[k - 1][i];
+			sliceXmodem[k][i] = (prev << 8) ^ sliceXmodem[0][prev >> 8];
+			u32 prev32 = sliceCrc32[k - 1][i];
+			sliceCrc32[k][i] = (prev32 >> 8) ^ sliceCrc32[0][prev32 & 0xFF];
+		}
+	}
+
+	for (int b = 0; b < 8; b++)
+		advanceD5[0][b] = sliceD5[0][1 << b];
+	for (int k = 1; k < 16; k++) {
+		for (int b = 0; b < 8; b++)
+			advanceD5[k][b] = applyAdvance(advanceD5[k - 1], applyAdvance(advanceD5[k - 1], 1 << b));
+	}
+}
+
+u8 crc8D5Bytewise(const u8 *data, u32 len, u8 crc) {
+	u32 c = crc;
+	for (u32 i = 0; i < len; i++)
+		c = crcLutD5[c ^ data[i]];
+	return c;
+}
+
+u8 crc8D5Slice4(const u8 *data, u32 len, u8 crc) {
+	u32 c = crc;
+	for (; len >= 4; len -= 4, data += 4) {
+		u32 w = load32(data) ^ c;
+		c = sliceD5[3][w & 0xFF] ^ sliceD5[2][(w >> 8) & 0xFF] ^ sliceD5[1][(w >> 16) & 0xFF] ^ sliceD5[0][w >> 24];
+	}
+	return crc8D5Bytewise(data, len, c);
+}
+
+u8 crc8D5Slice8(const u8 *data, u32 len, u8 crc) {
+	u32 c = crc;
+	for (; len >= 8; len -= 8, data += 8) {
+		u32 w0 = load32(data) ^ c;
+		u32 w1 = load32(data + 4);
+		c = sliceD5[7][w0 & 0xFF] ^ sliceD5[6][(w0 >> 8) & 0xFF] ^ sliceD5[5][(w0 >> 16) & 0xFF] ^ sliceD5[4][w0 >> 24] ^
+			sliceD5[3][w1 & 0xFF] ^ sliceD5[2][(w1 >> 8) & 0xFF] ^ sliceD5[1][(w1 >> 16) & 0xFF] ^ sliceD5[0][w1 >> 24];
+	}
+	return crc8D5Bytewise(data, len, c);
+}
+
+u8 crc8D5(const u8 *data, u32 len, u8 crc) {
+	if (len < CRC_SLICE_MIN_LEN) return crc8D5Bytewise(data, len, crc);
+	return crc8D5Slice8(data, len, crc);
+}
+
+u8 crc8D5Advance(u8 crc, u32 n) {
+	for (int k = 0; n && k < 16; k++, n >>= 1) {
+		if (n & 1) crc = applyAdvance(advanceD5[k], crc);
+	}
+	return crc;
+}
+
+u16 crc16XmodemByte(u16 crc, u8 data) {
+	return (crc << 8) ^ sliceXmodem[0][(crc >> 8) ^ data];
+}
+
+u16 crc16XmodemBytewise(const u8 *data, u32 len, u16 crc) {
+	for (u32 i = 0; i < len; i++)
+		crc = (crc << 8) ^ sliceXmodem[0][(crc >> 8) ^ data[i]];
+	return crc;
+}
+
+u16 crc16XmodemSlice4(const u8 *data, u32 len, u16 crc) {
+	u32 c = crc;
+	for (; len >= 4; len -= 4, data += 4) {
+		// the CRC goes into the first two bytes, high byte first
+		u32 w = load32(data) ^ (c >> 8) ^ ((c & 0xFF) << 8);
+		c = sliceXmodem[3][w & 0xFF] ^ sliceXmodem[2][(w >> 8) & 0xFF] ^ sliceXmodem[1][(w >> 16) & 0xFF] ^ sliceXmodem[0][w >> 24];
+	}
+	return crc16XmodemBytewise(data, len, c);
+}
+
+u16 crc16Xmodem(const u8 *data, u32 len, u16 crc) {
+	if (len < CRC_SLICE_MIN_LEN) return crc16XmodemBytewise(data, len, crc);
+	return crc16XmodemSlice4(data, len, crc);
+}
+
+u32 crc32Bytewise(const u8 *data, u32 len, u32 crc) {
+	u32 c = ~crc;
+	for (u32 i = 0; i < len; i++)
+		c = (c >> 8) ^ sliceCrc32[0][(c ^ data[i]) & 0xFF];
+	return ~c;
+}
+
+u32 crc32Slice4(const u8 *data, u32 len, u32 crc) {
+	// reflected: the CRC lines up with the word as it is, lowest byte first
+	u32 c = ~crc;
+	for (; len >= 4; len -= 4, data += 4) {
+		u32 w = load32(data) ^ c;
+		c = sliceCrc32[3][w & 0xFF] ^ sliceCrc32[2][(w >> 8) & 0xFF] ^ sliceCrc32[1][(w >> 16) & 0xFF] ^ sliceCrc32[0][w >> 24];
+	}
+	return crc32Bytewise(data, len, ~c);
+}
+
+u32 crc32(const u8 *data, u32 len, u32 crc) {
+	if (len < CRC_SLICE_MIN_LEN) return crc32Bytewise(data, len, crc);
+	return crc32Slice4(data, len, crc);
+}
+
+void fletcher8Bytewise(const u8 *data, u32 len, u8 *ckA, u8 *ckB) {
+	u8 a = *ckA, b = *ckB;
+	for (u32 i = 0; i < len; i++) {
+		a += data[i];
+		b += a;
+	}
+	*ckA = a;
+	*ckB = b;
+}
+
+void fletcher8(const u8 *data, u32 len, u8 *ckA, u8 *ckB) {
+	// u32 wraps at a multiple of 256, so the sums only need to be cut at the end
+	u32 a = *ckA, b = *ckB;
+	for (; len >= 4; len -= 4, data += 4) {
+		u32 w = load32(data);
+		u32 x0 = w & 0xFF, x1 = (w >> 8) & 0xFF, x2 = (w >> 16) & 0xFF, x3 = w >> 24;
+		b += 4 * (a + x0) + 3 * x1 + 2 * x2 + x3;
+		a += x0 + x1 + x2 + x3;
+	}
+	*ckA = a;
+	*ckB = b;
+	fletcher8Bytewise(data, len, ckA, ckB);
+}
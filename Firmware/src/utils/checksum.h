@@ -0,0 +1,71 @@
+/**
+ * @file checksum.h
+ * @brief Table driven checksums of the serial protocols: CRC8 0xD5 (CRSF, MSP V2), CRC16 XMODEM (4way) and Fletcher-8 (UBX)
+ *
+ * Copyright (c) 2026 Kolibri-FC contributors
+ *
+ * This file is part of Kolibri-FC (https://github.com/bastian2001/Kolibri-FC).
+ *
+ * Kolibri-FC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Kolibri-FC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include "typedefs.h"
+
+/*
+ * All functions are incremental: pass the result of the previous call (or the init value) as crc, the result is the same as one call over the concatenated data.
+ *
+ * Bulk functions use slicing-by-N: N bytes are looked up in N tables (the table for byte k already contains the k zero bytes behind it) and XORed together, so there is no dependency from one byte to the next. Short inputs and the tail go byte by byte.
+ */
+
+extern u32 crcLutD5[256]; // byte table for parsers that get one byte at a time, u32 is used because it is faster than u8
+
+/// @brief fills all tables, call once before any other function here
+void crcInit();
+
+/// @brief CRC8 with poly 0xD5 (CRSF, a.k.a. CRC8 DVB-S2 in MSP V2), one byte
+static inline u8 crc8D5Byte(u8 crc, u8 data) { return crcLutD5[crc ^ data]; }
+/// @brief CRC8 0xD5, best variant for the length
+u8 crc8D5(const u8 *data, u32 len, u8 crc = 0);
+u8 crc8D5Bytewise(const u8 *data, u32 len, u8 crc = 0);
+u8 crc8D5Slice4(const u8 *data, u32 len, u8 crc = 0);
+u8 crc8D5Slice8(const u8 *data, u32 len, u8 crc = 0);
+/// @brief advances a CRC8 0xD5 over n zero bytes in log(n) steps (n < 64k)
+u8 crc8D5Advance(u8 crc, u32 n);
+/**
+ * @brief CRC8 0xD5 of A followed by B, from the CRC of A and the CRC of B (init 0)
+ *
+ * @details Allows to CRC parts in any order, e.g. a payload before its header is known
+ */
+static inline u8 crc8D5Combine(u8 crcA, u8 crcB, u32 lenB) { return crc8D5Advance(crcA, lenB) ^ crcB; }
+
+/// @brief CRC16 XMODEM (poly 0x1021, init 0, not reflected) of the 4way interface, one byte
+u16 crc16XmodemByte(u16 crc, u8 data);
+/// @brief CRC16 XMODEM, best table variant for the length, see also crc16XmodemDma()
+u16 crc16Xmodem(const u8 *data, u32 len, u16 crc = 0);
+u16 crc16XmodemBytewise(const u8 *data, u32 len, u16 crc = 0);
+u16 crc16XmodemSlice4(const u8 *data, u32 len, u16 crc = 0);
+
+/// @brief CRC32 (IEEE 802.3, as in zlib), init and final XOR are included, so crc = 0 starts a new one. Used by segmented MSP transfers
+u32 crc32(const u8 *data, u32 len, u32 crc = 0);
+u32 crc32Bytewise(const u8 *data, u32 len, u32 crc = 0);
+u32 crc32Slice4(const u8 *data, u32 len, u32 crc = 0);
+
+/**
+ * @brief Fletcher-8 as used by UBX, continues from ckA and ckB (both 0 at the start)
+ *
+ * @details Works on 4 bytes at a time: b grows by 4a + 4x0 + 3x1 + 2x2 + x3, everything mod 256
+ */
+void fletcher8(const u8 *data, u32 len, u8 *ckA, u8 *ckB);
+void fletcher8Bytewise(const u8 *data, u32 len, u8 *ckA, u8 *ckB);
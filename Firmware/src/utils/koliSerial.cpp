@@ -30,6 +30,14 @@ const char KoliSerial::SERIAL_TYPE_NAMES[4][8] = {
 };
 elapsedMicros KoliSerial::sinceReset = 0;
 
+void KoliSerial::initTx(size_t size) {
+	mutex_init(&writeMutex);
+	mutex_init(&pumpMutex);
+	txSize = 1;
+	while (txSize < size) txSize <<= 1;
+	txBuf = new u8[txSize];
+}
+
 void KoliSerial::begin(unsigned long baudrate) {
 	return begin(baudrate, SERIAL_8N1);
 }
@@ -39,23 +47,61 @@ void KoliSerial::begin(unsigned long baudrate, uint16_t config) {
 	case SerialType::USB:
 		static_cast<UsbSerialClass *>(stream)->begin(baudrate, config);
 		break;
-	case SerialType::UART:
-		static_cast<SerialUART *>(stream)->begin(baudrate, config);
-		break;
-	case SerialType::PIO:
-		static_cast<SerialPio *>(stream)->begin(baudrate, config);
-		break;
-	case SerialType::PIO_HDX:
-		static_cast<SerialPioHdx *>(stream)->begin(baudrate, config); // config unused
-		break;
+	case SerialType::UART: {
+		SerialUART *s = static_cast<SerialUART *>(stream);
+		s->begin(baudrate, config);
+		if (!*s) break;
+		uart = s == &Serial1 ? uart0 : uart1;
+		uart_hw_t *hw = uart_get_hw(uart);
+		// the core's RX interrupt stays masked, it would compete with the DMA for the FIFO
+		if (uartRx.setSize(rxFifoSize) && uartRx.start(&hw->dr, uart_get_dreq(uart, false))) {
+			hw_clear_bits(&hw->imsc, UART_UARTIMSC_RXIM_BITS | UART_UARTIMSC_RTIM_BITS);
+			hw_set_bits(&hw->dmacr, UART_UARTDMACR_RXDMAE_BITS);
+			dmaRx = &uartRx;
+		}
+		if (uartTx.start(&hw->dr, uart_get_dreq(uart, true), SerialDmaTxFormat::BYTES)) {
+			hw_set_bits(&hw->dmacr, UART_UARTDMACR_TXDMAE_BITS);
+			dmaTx = &uartTx;
+		}
+	} break;
+	case SerialType::PIO: {
+		SerialPio *s = static_cast<SerialPio *>(stream);
+		s->begin(baudrate, config);
+		if (!*s) break;
+		dmaRx = &s->dmaRx();
+		if (s->dmaTx().running()) dmaTx = &s->dmaTx();
+	} break;
+	case SerialType::PIO_HDX: {
+		SerialPioHdx *s = static_cast<SerialPioHdx *>(stream);
+		s->begin(baudrate, config); // config unused
+		if (!*s) break;
+		dmaRx = &s->dmaRx();
+		if (s->dmaTx().running()) dmaTx = &s->dmaTx();
+	} break;
 	}
+	applyInversion(inverted);
+	lastRxUs = time_us_32();
 }
 void KoliSerial::end() {
+	mutex_enter_blocking(&pumpMutex);
+	// whatever the DMA did not send yet is dropped
+	dmaRx = nullptr;
+	dmaTx = nullptr;
+	txTail = txHead;
+	txInFlight = 0;
+	mutex_exit(&pumpMutex);
+
 	switch (serialType) {
 	case SerialType::USB:
 		static_cast<UsbSerialClass *>(stream)->end();
 		break;
 	case SerialType::UART:
+		if (uart != nullptr) {
+			hw_clear_bits(&uart_get_hw(uart)->dmacr, UART_UARTDMACR_RXDMAE_BITS | UART_UARTDMACR_TXDMAE_BITS);
+			uart = nullptr;
+		}
+		uartRx.stop();
+		uartTx.stop();
 		static_cast<SerialUART *>(stream)->end();
 		break;
 	case SerialType::PIO:
@@ -65,6 +111,7 @@ void KoliSerial::end() {
 		static_cast<SerialPioHdx *>(stream)->end();
 		break;
 	}
+	applyInversion(false); // the pins may be used for something else next, begin() sets it again
 }
 
 KoliSerial::operator bool() {
@@ -99,6 +146,174 @@ KoliSerial::~KoliSerial() {
 
 	if (msp != nullptr) delete msp;
 	if (dpOutput != nullptr) delete dpOutput;
+	delete[] txBuf;
+}
+
+size_t KoliSerial::read(u8 *buf, size_t len) {
+	size_t n;
+	if (dmaRx != nullptr) {
+		n = dmaRx->read(buf, len);
+	} else {
+		// never more than available, so readBytes does not wait for its timeout
+		int avail = stream->available();
+		if (avail <= 0) return 0;
+		n = (size_t)avail < len ? avail : len;
+		n = stream->readBytes((char *)buf, n);
+	}
+	if (n) {
+		totalRx += n;
+		lastRxUs = time_us_32();
+	}
+	return n;
+}
+
+u32 KoliSerial::rxIdleUs() {
+	if (dmaRx != nullptr) return dmaRx->idleUs();
+	return time_us_32() - lastRxUs;
+}
+
+void KoliSerial::pumpTx(u32 maxWrite) {
+	if (dmaTx != nullptr) {
+		if (dmaTx->busy()) return;
+		txTail += txInFlight;
+		totalTx += txInFlight;
+		txInFlight = 0;
+	}
+	u32 pending = txHead - txTail;
+	if (!pending) return;
+	__mem_fence_acquire(); // see the data before the head that announced it
+	u32 pos = txTail & (txSize - 1);
+	u32 c = txSize - pos; // up to the end of the ring, the rest follows with the next transfer
+	if (c > pending) c = pending;
+
+	if (dmaTx != nullptr) {
+		txInFlight = dmaTx->write(txBuf + pos, c);
+		return;
+	}
+
+	if (c > maxWrite) c = maxWrite;
+	if (serialType == SerialType::UART) {
+		// special treatment: UART cannot tell how many bytes it can still send, only _that_ it can still send at least one
+		SerialUART &s = *static_cast<SerialUART *>(stream);
+		u32 sent = 0;
+		while (sent < c && s.availableForWrite())
+			s.write(txBuf[pos + sent++]);
+		c = sent;
+	} else {
+		i32 writable = stream->availableForWrite();
+		if (writable < 0) writable = 0;
+		if (c > (u32)writable) c = writable;
+		if (c) stream->write(txBuf + pos, c);
+	}
+	txTail += c;
+	totalTx += c;
+}
+
+size_t KoliSerial::write(const uint8_t *p, size_t len) {
+	mutex_enter_blocking(&writeMutex);
+	size_t left = len;
+	while (left) {
+		u32 free = txSize - (txHead - txTail);
+		if (!free) {
+			// ring full: push out data right here instead of waiting for loop(), which may run on this very core
+			mutex_enter_blocking(&pumpMutex);
+			pumpTx(txSize);
+			mutex_exit(&pumpMutex);
+			continue;
+		}
+		u32 pos = txHead & (txSize - 1);
+		u32 c = txSize - pos;
+		if (c > free) c = free;
+		if (c > left) c = left;
+		memcpy(txBuf + pos, p, c);
+		__mem_fence_release(); // data first, then the head
+		txHead += c;
+		p += c;
+		left -= c;
+	}
+	mutex_exit(&writeMutex);
+	return len;
+}
+
+u8 *KoliSerial::txSpan(u32 offset, u32 *len) {
+	*len = 0;
+	if (offset >= txSize) return nullptr; // the unpublished part already fills the ring
+	while (txSize - (txHead - txTail) <= offset) {
+		// full: drain right here, like write() does
+		mutex_enter_blocking(&pumpMutex);
+		pumpTx(txSize);
+		mutex_exit(&pumpMutex);
+	}
+	u32 free = txSize - (txHead - txTail) - offset;
+	u32 pos = (txHead + offset) & (txSize - 1);
+	u32 c = txSize - pos;
+	if (c > free) c = free;
+	*len = c;
+	return txBuf + pos;
+}
+
+void KoliSerial::txPublish(u32 len) {
+	CRASH_ASSERT(txHead - txTail + len <= txSize); // more than txSpan() handed out would overwrite unsent data
+	__mem_fence_release(); // data first, then the head
+	txHead += len;
+}
+
+void KoliSerial::flush() {
+	mutex_enter_blocking(&writeMutex);
+	mutex_enter_blocking(&pumpMutex);
+	while (txHead != txTail || txInFlight) {
+		pumpTx(txSize);
+		// USB can take advantage of larger chunks, let it free the TX buffer completely before retrying any new
+		if (serialType == SerialType::USB) {
+			stream->flush();
+		}
+	}
+	mutex_exit(&pumpMutex);
+	mutex_exit(&writeMutex);
+	if (serialType == SerialType::UART && uart != nullptr)
+		uart_tx_wait_blocking(uart);
+	else
+		stream->flush();
+}
+
+bool KoliSerial::setBaudrate(u32 baud) {
+	if (baud == baudrate) return true;
+	switch (serialType) {
+	case SerialType::USB:
+		baudrate = baud; // means nothing on USB
+		return true;
+	case SerialType::UART:
+		if (uart == nullptr) break;
+		flush(); // bytes still in the ring go out at the old rate
+		uart_set_baudrate(uart, baud);
+		baudrate = baud;
+		return true;
+	default:
+		break;
+	}
+	end();
+	begin(baud);
+	return (bool)*this;
+}
+
+bool KoliSerial::setBreak(bool on) {
+	if (serialType != SerialType::UART || uart == nullptr) return false;
+	if (on) flush();
+	uart_set_break(uart, on);
+	return true;
+}
+
+void KoliSerial::applyInversion(bool on) {
+	if (serialType == SerialType::USB) return;
+	// the pad overrides work the same for the UART and PIO functions, and for a half duplex pin that is both TX and RX
+	gpio_override over = on ? GPIO_OVERRIDE_INVERT : GPIO_OVERRIDE_NORMAL;
+	if (txPin < NUM_BANK0_GPIOS) gpio_set_outover(txPin, over);
+	if (rxPin < NUM_BANK0_GPIOS) gpio_set_inover(rxPin, over);
+}
+
+void KoliSerial::setInverted(bool on) {
+	inverted = on;
+	if (*this) applyInversion(on);
 }
 
 bool KoliSerial::setRxFifoSize(size_t size) {
@@ -107,6 +322,8 @@ bool KoliSerial::setRxFifoSize(size_t size) {
 		// FIFO size is set at compile time in TinyUSB config
 		return false;
 	case SerialType::UART:
+		// the DMA ring is allocated in begin(), the core's buffer is the fallback if no channel is free
+		rxFifoSize = size;
 		return static_cast<SerialUART *>(stream)->setFIFOSize(size);
 	case SerialType::PIO:
 		return static_cast<SerialPio *>(stream)->setFIFOSize(size);
@@ -22,8 +22,9 @@
 
 #pragma once
 #include "drivers/halfduplexUart.h"
+#include "drivers/pioUart.h"
+#include "drivers/serialDma.h"
 #include "elapsedMillis.h"
-#include "ringbuffer.h"
 #include "serialhandler/msp.h"
 #include "typedefs.h"
 #include <Arduino.h>
@@ -43,7 +44,7 @@ typedef Adafruit_USBD_CDC UsbSerialClass;
 typedef SerialUSB UsbSerialClass;
 #endif
 
-class KoliSerial : public HardwareSerial {
+class KoliSerial : public HardwareSerial, public MspTxTarget {
 public:
 	const SerialType serialType;
 
@@ -53,30 +54,26 @@ public:
 
 	KoliSerial(UsbSerialClass *const usbStream, int txfSize)
 		: stream(usbStream),
-		  serialType(SerialType::USB),
-		  writeBuffer(txfSize) {
-		mutex_init(&writeMutex);
+		  serialType(SerialType::USB) {
+		initTx(txfSize);
 	};
 
 	KoliSerial(SerialUART *const uartStream, int txfSize)
 		: stream(uartStream),
-		  serialType(SerialType::UART),
-		  writeBuffer(txfSize) {
-		mutex_init(&writeMutex);
+		  serialType(SerialType::UART) {
+		initTx(txfSize);
 	};
 
 	KoliSerial(PIO pioTx, PIO pioRx, u8 smTx, u8 smRx, size_t txfSize)
 		: stream(new SerialPio(pioTx, pioRx, smTx, smRx)),
-		  serialType(SerialType::PIO),
-		  writeBuffer(txfSize) {
-		mutex_init(&writeMutex);
+		  serialType(SerialType::PIO) {
+		initTx(txfSize);
 	};
 
 	KoliSerial(PIO pio, u8 sm, size_t txfSize)
 		: stream(new SerialPioHdx(pio, sm)),
-		  serialType(SerialType::PIO_HDX),
-		  writeBuffer(txfSize) {
-		mutex_init(&writeMutex);
+		  serialType(SerialType::PIO_HDX) {
+		initTx(txfSize);
 	};
 
 	~KoliSerial();
@@ -85,126 +82,71 @@ public:
 	virtual void begin(unsigned long baudrate, uint16_t config) override;
 	virtual void end() override;
 	virtual int available() override {
+		if (dmaRx != nullptr) return dmaRx->available();
 		return stream->available();
 	}
 	virtual int availableForWrite() override {
-		mutex_enter_blocking(&writeMutex);
-		u32 writable = writeBuffer.freeSpace();
-		mutex_exit(&writeMutex);
-		return writable;
+		return txSize - (txHead - txTail);
+	}
+	/// @brief bytes written since begin(), the difference of two calls is what was written in between
+	u32 txPushed() { return txHead; }
+
+	// in-place writing into the TX ring, see MspWriter. Holds the write lock, so nothing else may write() to this port in between
+	virtual void txLock() override { mutex_enter_blocking(&writeMutex); }
+	virtual void txUnlock() override { mutex_exit(&writeMutex); }
+	virtual u8 *txSpan(u32 offset, u32 *len) override;
+	virtual void txPublish(u32 len) override;
+	int peek() {
+		if (dmaRx != nullptr) return dmaRx->peek();
+		return stream->peek();
 	}
-	int peek() { return stream->peek(); }
 	int read() {
-		int i = stream->read();
-		if (i != -1) totalRx++;
+		int i = dmaRx != nullptr ? dmaRx->read() : stream->read();
+		if (i != -1) {
+			totalRx++;
+			lastRxUs = time_us_32();
+		}
 		return i;
 	}
+	/// @brief copies up to len received bytes into buf without blocking, returns how many
+	size_t read(u8 *buf, size_t len);
+	/**
+	 * @brief Moves the TX buffer to the peripheral, call regularly
+	 *
+	 * @details DMA ports start the next transfer when the last one is done (maxWrite unused). USB and ports without a free DMA channel write up to maxWrite bytes, as many as the peripheral takes.
+	 */
 	void loop(i32 maxWrite = 64) {
-		// write the lowest of
-		// - maxWrite
-		// - available space in peripheral
-		// - available data
-		i32 c = writeBuffer.itemCount();
-		if (c > maxWrite) c = maxWrite;
-		if (!mutex_try_enter(&writeMutex, nullptr)) return;
-
-		if (serialType == SerialType::UART) {
-			// special treatment: UART cannot tell how many bytes it can still send, only _that_ it can still send at least one
-			SerialUART &s = *static_cast<SerialUART *>(stream);
-			if (!c) return mutex_exit(&writeMutex);
-			while (c--) {
-				if (!s.availableForWrite())
-					return mutex_exit(&writeMutex);
-				s.write(writeBuffer.pop());
-				totalTx++;
-			}
-			return mutex_exit(&writeMutex);
-		}
-
-		maxWrite = stream->availableForWrite();
-		if (c > maxWrite) c = maxWrite;
-		if (!c) return mutex_exit(&writeMutex);
-
-		u8 buf[c];
-		writeBuffer.copyToArray(buf, 0, c);
-		writeBuffer.erase(c);
-		mutex_exit(&writeMutex);
-		stream->write(buf, c);
-		totalTx += c;
-	};
-	virtual void flush() override {
-		mutex_enter_blocking(&writeMutex);
-		while (!writeBuffer.isEmpty()) {
-			i32 c = stream->availableForWrite();
-			i32 maxWrite = writeBuffer.itemCount();
-			if (c > maxWrite) c = maxWrite;
-			if (!c) continue;
-			u8 buf[c];
-			writeBuffer.copyToArray(buf, 0, c);
-			writeBuffer.erase(c);
-			stream->write(buf, c);
-			totalTx += c;
-			// USB can take advantage of larger chunks, let it free the TX buffer completely before retrying any new
-			if (serialType == SerialType::USB) {
-				stream->flush();
-			}
-		}
-		mutex_exit(&writeMutex);
-		stream->flush();
+		if (!mutex_try_enter(&pumpMutex, nullptr)) return;
+		pumpTx(maxWrite);
+		mutex_exit(&pumpMutex);
 	};
+	virtual void flush() override;
 	virtual size_t write(uint8_t c) override {
-		mutex_enter_blocking(&writeMutex);
-		if (writeBuffer.isFull()) {
-			stream->write(writeBuffer.pop());
-			totalTx++;
-		}
-		writeBuffer.push(c);
-		mutex_exit(&writeMutex);
-		return 1;
+		return write(&c, 1);
 	};
-	virtual size_t write(const uint8_t *p, size_t len) override {
-		mutex_enter_blocking(&writeMutex);
-		u32 free = writeBuffer.freeSpace();
-		if (free >= len) {
-			while (len--) {
-				writeBuffer.push(*p++);
-			}
-		} else {
-			len -= free;
-			// first fill as many into the buffer as possible
-			while (free--) {
-				writeBuffer.push(*p++);
-			}
-			// then empty the buf as much as needed into the peripheral
-			while (len > 0) {
-				i32 c = stream->availableForWrite();
-				i32 maxWrite = writeBuffer.itemCount();
-				if (c > maxWrite) c = maxWrite;
-				if (c > len) c = len;
-				if (!c) continue;
-				u8 buf[c];
-				// pull from internal buffer
-				writeBuffer.copyToArray(buf, 0, c);
-				writeBuffer.erase(c);
-				// write to peri
-				stream->write(buf, c);
-				totalTx += c;
-				len -= c;
-				// refill internal buffer
-				while (c--) {
-					writeBuffer.push(*p++);
-				}
-			}
-		}
-		mutex_exit(&writeMutex);
-		return len;
+	virtual size_t write(const uint8_t *p, size_t len) override;
+
+	/// @brief time since the last byte came in, the line is idle after about 10 bit times
+	u32 rxIdleUs();
+	/// @brief bytes lost because the RX ring was full
+	u32 rxOverruns() { return dmaRx != nullptr ? dmaRx->overruns : 0; };
+	void resetRxOverruns() {
+		if (dmaRx != nullptr) dmaRx->overruns = 0;
 	};
+	bool rxUsesDma() { return dmaRx != nullptr; };
+	bool txUsesDma() { return dmaTx != nullptr; };
 
 	bool setRxFifoSize(size_t size);
 	bool setPinout(pin_size_t tx, pin_size_t rx);
 	pin_size_t getRxPin() { return rxPin; };
 	pin_size_t getTxPin() { return txPin; };
+	/// @brief changes the baud rate of a running port, hardware UARTs keep their DMA and buffers, PIO ports restart
 	bool setBaudrate(u32 baud);
+	/// @brief holds TX low (line break) or releases it, hardware UARTs only
+	bool setBreak(bool on);
+	/// @brief inverts RX and TX at the pads, stays through end() and begin() (e.g. the GPS driver restarting its port)
+	void setInverted(bool on);
+	bool isInverted() { return inverted; };
 	const u32 &getBaudrate() { return baudrate; };
 	const u32 &functions() { return funcs; };
 	void setFunctions(u32 newFunctions);
@@ -224,10 +166,30 @@ public:
 	MspVersion lastMspVersion = MspVersion::V2;
 
 private:
-	RingBuffer<u8> writeBuffer;
+	void initTx(size_t size);
+	void pumpTx(u32 maxWrite); // call with pumpMutex held
+	void applyInversion(bool on);
+
+	// TX ring: producers (write()) only move txHead and hold writeMutex against each other, the consumer (loop(), flush(), or a writer that found the ring full) only moves txTail and holds pumpMutex. The two sides never wait for each other.
+	u8 *txBuf = nullptr;
+	u32 txSize = 0; // power of 2
+	volatile u32 txHead = 0; // bytes pushed since begin
+	volatile u32 txTail = 0; // bytes handed to the peripheral
+	u32 txInFlight = 0; // bytes of the running DMA transfer, still in the ring until it is done
 	mutex_t writeMutex;
+	mutex_t pumpMutex;
+
+	// DMA transport, nullptr while not running or when falling back to the stream (USB, no free channel)
+	SerialDmaRx *dmaRx = nullptr;
+	SerialDmaTx *dmaTx = nullptr;
+	SerialDmaRx uartRx; // only used by hardware UARTs, PIO ports own theirs
+	SerialDmaTx uartTx;
+	uart_inst_t *uart = nullptr;
+	size_t rxFifoSize = 0;
+	u32 lastRxUs = 0;
 	u32 baudrate = 0;
-	pin_size_t txPin, rxPin;
+	bool inverted = false;
+	pin_size_t txPin = 255, rxPin = 255; // 255 until setPinout(), applyInversion() leaves those alone
 	MspOsdOutput *dpOutput = nullptr;
 
 	Stream *const stream;
@@ -0,0 +1,14 @@
+#!/bin/sh
+# Builds the libFuzzer targets with ASan and UBSan, needs clang. Run from Firmware/:
+#   test/fuzz/build.sh && .fuzz/fuzz_crsf test/fuzz/corpus/crsf -max_len=512
+set -e
+CXX=${CXX:-clang++}
+OUT=${OUT:-.fuzz}
+FLAGS="-std=gnu++17 -O1 -g -fsanitize=fuzzer,address,undefined -fno-sanitize-recover=all -Iinclude -Isrc"
+SRC="src/serialhandler/mspFramer.cpp src/serialhandler/crsf.cpp src/serialhandler/4wayParser.cpp src/serialhandler/ubx.cpp src/utils/checksum.cpp"
+
+mkdir -p "$OUT"
+for target in msp crsf ubx 4way; do
+	$CXX $FLAGS $SRC "test/fuzz/fuzz_$target.cpp" -o "$OUT/fuzz_$target"
+	echo "$OUT/fuzz_$target"
+done
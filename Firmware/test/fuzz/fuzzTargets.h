@@ -0,0 +1,179 @@
+/**
+ * @file fuzzTargets.h
+ * @brief Fuzz targets of the serial parsers, shared by the libFuzzer entry points and test_fuzz
+ *
+ * Copyright (c) 2026 Kolibri-FC contributors
+ *
+ * This file is part of Kolibri-FC (https://github.com/bastian2001/Kolibri-FC).
+ *
+ * Kolibri-FC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Kolibri-FC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include "serialhandler/4wayParser.h"
+#include "serialhandler/crsf.h"
+#include "serialhandler/mspFramer.h"
+#include "serialhandler/ubx.h"
+#include "utils/checksum.h"
+#include <stdlib.h>
+
+/*
+ * Each target feeds the input as one byte stream into a fresh parser, the way the serial port would deliver it. Whatever the parser reports as valid is read completely, so ASan catches a length that does not match the buffer, and checked against the limits the rest of the firmware relies on. A violated limit aborts, which libFuzzer and test_fuzz both treat as a crash.
+ */
+
+#define FUZZ_CHECK(x) \
+	do { \
+		if (!(x)) abort(); \
+	} while (0)
+
+#define CRSF_FRAMETYPE_SUBSET_RC_CHANNELS_PACKED 0x17
+#define CRSF_FRAMETYPE_MSP_REQ 0x7A
+#define CRSF_FRAMETYPE_MSP_WRITE 0x7C
+
+static volatile u32 fuzzSink; // keeps the reads from being optimized away
+
+static inline void fuzzInit() {
+	static bool done = false;
+	if (done) return;
+	crcInit();
+	done = true;
+}
+
+static inline void fuzzTouch(const void *data, u32 len) {
+	const u8 *p = (const u8 *)data;
+	u32 sum = 0;
+	for (u32 i = 0; i < len; i++)
+		sum += p[i];
+	fuzzSink = fuzzSink + sum;
+}
+
+/// @brief MspParser without the command handlers: framing of V1, V1 jumbo, V2 and V2 over V1
+static inline u32 fuzzMspFramer(const u8 *data, size_t size) {
+	fuzzInit();
+	MspFramer framer;
+	u32 frames = 0;
+	for (size_t i = 0; i < size; i++) {
+		switch (framer.handleByte(data[i])) {
+		case MspFramer::FRAME:
+			FUZZ_CHECK(framer.payloadLen <= MSP_MAX_PAYLOAD);
+			fuzzTouch(framer.payload, framer.payloadLen);
+			frames++;
+			break;
+		case MspFramer::ERROR_CRC_V1:
+		case MspFramer::ERROR_CRC_V2:
+			fuzzSink = fuzzSink + (u32)framer.fn;
+			break;
+		default:
+			break;
+		}
+	}
+	return frames;
+}
+
+/// @brief CRSF framing, then what ExpressLRS does with subset RC channels and MSP requests
+static inline u32 fuzzCrsf(const u8 *data, size_t size) {
+	fuzzInit();
+	static CrsfParser parser; // ~600 bytes with mspRx, static to keep the stack small under ASan
+	static CrsfMspRx mspRx;
+	parser = CrsfParser();
+	mspRx.reset();
+	u32 frames = 0;
+	u32 raw[16] = {};
+	for (size_t i = 0; i < size; i++) {
+		if (parser.parseChar(data[i]) != CrsfParser::FRAME) continue;
+		FUZZ_CHECK(parser.len <= CRSF_MAX_PAYLOAD);
+		fuzzTouch(parser.payload, parser.len);
+		frames++;
+		switch (parser.type) {
+		case CRSF_FRAMETYPE_SUBSET_RC_CHANNELS_PACKED: {
+			u8 first = 0xFF, count = 0xFF;
+			if (crsfUnpackSubsetChannels(parser.payload, parser.len, raw, &first, &count)) {
+				FUZZ_CHECK(count && first + count <= 16);
+				for (int c = 0; c < 16; c++)
+					FUZZ_CHECK(raw[c] < 8192); // 13 bit at most
+			} else {
+				FUZZ_CHECK(first == 0xFF && count == 0xFF); // untouched
+			}
+		} break;
+		case CRSF_FRAMETYPE_MSP_REQ:
+		case CRSF_FRAMETYPE_MSP_WRITE:
+			if (!parser.len) break;
+			if (mspRx.feed(parser.payload, parser.len, parser.extSrc) == CrsfMspRx::COMPLETE) {
+				FUZZ_CHECK(mspRx.payloadLen <= CRSF_MSP_MAX_PAYLOAD);
+				fuzzTouch(mspRx.payload, mspRx.payloadLen);
+				mspRx.reset();
+			}
+			break;
+		}
+	}
+	return frames;
+}
+
+// handlers of the GPS message table read every byte the schema promises, not more and not less
+template <u16 N>
+static void fuzzUbxFixed(const u8 *payload, u16 len) {
+	FUZZ_CHECK(len == N);
+	fuzzTouch(payload, N);
+}
+
+static void fuzzUbxNavSat(const u8 *payload, u16 len) {
+	const u32 numSvs = payload[5];
+	FUZZ_CHECK(len == 8 + 12 * numSvs);
+	fuzzTouch(payload, 8);
+	for (u32 i = 0; i < numSvs; i++)
+		fuzzTouch(&payload[8 + 12 * i], 12);
+}
+
+// same table as gps.cpp
+static const UbxMsgSchema fuzzUbxMessages[] = {
+	{UBX_CLASS_ACK, UBX_ID_ACK_ACK, 2, 0, 0, fuzzUbxFixed<2>},
+	{UBX_CLASS_ACK, UBX_ID_ACK_NAK, 2, 0, 0, fuzzUbxFixed<2>},
+	{UBX_CLASS_NAV, UBX_ID_NAV_PVT, 92, 0, 0, fuzzUbxFixed<92>},
+	{UBX_CLASS_NAV, UBX_ID_NAV_STATUS, 16, 0, 0, fuzzUbxFixed<16>},
+	{UBX_CLASS_NAV, UBX_ID_NAV_DOP, 18, 0, 0, fuzzUbxFixed<18>},
+	{UBX_CLASS_NAV, UBX_ID_NAV_SAT, 8, 12, 5, fuzzUbxNavSat},
+	{UBX_CLASS_MON, UBX_ID_MON_HW, 60, 0, 0, fuzzUbxFixed<60>},
+};
+
+/// @brief UBX framing with resync, then the schema checked dispatch of gps.cpp
+static inline u32 fuzzUbx(const u8 *data, size_t size) {
+	fuzzInit();
+	static UbxParser parser;
+	parser = UbxParser();
+	u32 frames = 0;
+	for (size_t i = 0; i < size; i++) {
+		bool ready = parser.feed(data[i]);
+		while (ready) {
+			FUZZ_CHECK(parser.len() <= UBX_MAX_PAYLOAD);
+			ubxDispatch(fuzzUbxMessages, sizeof(fuzzUbxMessages) / sizeof(fuzzUbxMessages[0]), parser.cls(), parser.id(), parser.payload(), parser.len());
+			frames++;
+			ready = parser.poll();
+		}
+	}
+	return frames;
+}
+
+/// @brief 4way interface requests of the configurator
+static inline u32 fuzz4Way(const u8 *data, size_t size) {
+	fuzzInit();
+	Parser4Way parser;
+	u32 frames = 0;
+	for (size_t i = 0; i < size; i++) {
+		if (parser.feed(data[i]) != Parser4Way::FRAME) continue;
+		FUZZ_CHECK(parser.len >= 1 && parser.len <= 256);
+		fuzzTouch(parser.payload, parser.len);
+		frames++;
+	}
+	return frames;
+}
@@ -0,0 +1,163 @@
+#!/usr/bin/env python3
+# Writes the seed corpus of the fuzz targets to corpus/<target>/. The frames are built from the protocol
+# definitions (same as test_fuzz does), not captured from real devices.
+# usage: python3 makeCorpus.py [output dir, default: corpus next to this script]
+
+import os
+import random
+import struct
+import sys
+
+
+def crc8D5(data, crc=0):
+	for b in data:
+		crc ^= b
+		for _ in range(8):
+			crc = ((crc << 1) ^ 0xD5) & 0xFF if crc & 0x80 else (crc << 1) & 0xFF
+	return crc
+
+
+def crc16Xmodem(data, crc=0):
+	for b in data:
+		crc ^= b << 8
+		for _ in range(8):
+			crc = ((crc << 1) ^ 0x1021) & 0xFFFF if crc & 0x8000 else (crc << 1) & 0xFFFF
+	return crc
+
+
+def xor(data):
+	x = 0
+	for b in data:
+		x ^= b
+	return x
+
+
+def mspV1(cmd, payload, dir=b'<'):
+	body = bytes([len(payload), cmd]) + payload
+	return b'$M' + dir + body + bytes([xor(body)])
+
+
+def mspJumbo(cmd, payload):
+	body = bytes([255, cmd]) + struct.pack('<H', len(payload)) + payload
+	return b'$M<' + body + bytes([xor(body)])
+
+
+def mspV2(cmd, payload, flag=0, dir=b'<'):
+	body = struct.pack('<BHH', flag, cmd, len(payload)) + payload
+	return b'$X' + dir + body + bytes([crc8D5(body)])
+
+
+def mspV2OverV1(cmd, payload):
+	inner = struct.pack('<BHH', 0, cmd, len(payload)) + payload
+	inner += bytes([crc8D5(inner)])
+	body = bytes([min(len(inner), 255), 255]) + inner
+	return b'$M<' + body + bytes([xor(body)])
+
+
+def crsf(type, payload, dest=0xC8, src=0xEA):
+	body = bytes([type]) + (bytes([dest, src]) if type >= 0x28 else b'') + payload
+	return bytes([0xC8, len(body) + 1]) + body + bytes([crc8D5(body)])
+
+
+def crsfChannels(values, bits):
+	v = 0
+	for i, c in enumerate(values):
+		v |= (c & ((1 << bits) - 1)) << (i * bits)
+	return v.to_bytes((len(values) * bits + 7) // 8, 'little')
+
+
+def crsfMsp(version, header, payload, chunk=57):
+	# status byte: bit 4 start, bits 5-6 version, bits 0-3 sequence
+	data = header + payload
+	frames = b''
+	seq = 0
+	first = True
+	while first or data:
+		status = (version << 5) | (0x10 if first else 0) | seq
+		frames += crsf(0x7A, bytes([status]) + data[:chunk])
+		data = data[chunk:]
+		seq = (seq + 1) & 0xF
+		first = False
+	return frames
+
+
+def ubx(cls, id, payload):
+	body = bytes([cls, id]) + struct.pack('<H', len(payload)) + payload
+	a = b = 0
+	for x in body:
+		a = (a + x) & 0xFF
+		b = (b + a) & 0xFF
+	return b'\xb5\x62' + body + bytes([a, b])
+
+
+def fourWay(cmd, address, payload):
+	frame = bytes([0x2F, cmd, address >> 8, address & 0xFF, len(payload) & 0xFF]) + payload
+	crc = crc16Xmodem(frame)
+	return frame + bytes([crc >> 8, crc & 0xFF])
+
+
+def seeds():
+	rng = random.Random(1)
+	rand = lambda n: bytes(rng.getrandbits(8) for _ in range(n))
+	msp = {
+		'v1_api_version': mspV1(1, b''),
+		'v1_set_rx': mspV1(200, rand(16)),
+		'v1_response': mspV1(2, b'KOLI', b'>'),
+		'jumbo_1k': mspJumbo(70, rand(1024)),
+		'v2_status': mspV2(101, b''),
+		'v2_settings_write': mspV2(0x4002, rand(300)),
+		'v2_max_payload': mspV2(0x4002, rand(2048)),
+		'v2_over_v1': mspV2OverV1(0x4001, rand(40)),
+		'mixed_stream': mspV1(1, b'') + b'noise\r\n' + mspV2(101, b'') + mspJumbo(70, rand(300)),
+	}
+	ch11 = [rng.randrange(172, 1812) for _ in range(16)]
+	crsfSeeds = {
+		'rc_channels': crsf(0x16, crsfChannels(ch11, 11)),
+		'subset_11bit': crsf(0x17, bytes([4 | 1 << 5]) + crsfChannels(ch11[:8], 11)),
+		'subset_13bit_full': crsf(0x17, bytes([0 | 3 << 5]) + crsfChannels(ch11, 13)),
+		'subset_10bit_tail': crsf(0x17, bytes([12]) + crsfChannels(ch11[:4], 10)),
+		'link_stats': crsf(0x14, rand(10)),
+		'msp_v2_single': crsfMsp(2, struct.pack('<BHH', 0, 101, 0), b''),
+		'msp_v2_chained': crsfMsp(2, struct.pack('<BHH', 0, 0x4002, 200), rand(200)),
+		'msp_v1': crsfMsp(1, bytes([4, 200]), rand(4)),
+		'msp_v1_jumbo': crsfMsp(1, bytes([0xFF, 70]) + struct.pack('<H', 120), rand(120)),
+		'ping': crsf(0x28, b''),
+	}
+	pvt = bytearray(rand(92))
+	pvt[20] = 3
+	sat = bytearray(rand(8 + 12 * 20))
+	sat[5] = 20
+	ubxSeeds = {
+		'nav_pvt': ubx(0x01, 0x07, bytes(pvt)),
+		'nav_status': ubx(0x01, 0x03, rand(16)),
+		'nav_dop': ubx(0x01, 0x04, rand(18)),
+		'nav_sat': ubx(0x01, 0x35, bytes(sat)),
+		'mon_hw': ubx(0x0A, 0x09, rand(60)),
+		'ack': ubx(0x05, 0x01, bytes([0x06, 0x01])),
+		'nmea_and_ubx': b'$GNGGA,,,,,,0,00,99.99,,,,,,*56\r\n' + ubx(0x01, 0x07, bytes(pvt)),
+		'false_sync': b'\xb5\x62\xb5' + ubx(0x05, 0x00, bytes([0x06, 0x08])),
+	}
+	fourWaySeeds = {
+		'interface_test': fourWay(0x30, 0, b'\x00'),
+		'get_version': fourWay(0x33, 0, b'\x00'),
+		'device_init': fourWay(0x37, 0, b'\x02'),
+		'device_read': fourWay(0x3A, 0x1000, b'\x80'),
+		'device_write_256': fourWay(0x3B, 0x1000, rand(256)),
+		'device_write_16': fourWay(0x3B, 0x7C00, rand(16)),
+	}
+	return {'msp': msp, 'crsf': crsfSeeds, 'ubx': ubxSeeds, '4way': fourWaySeeds}
+
+
+def main():
+	out = sys.argv[1] if len(sys.argv) > 1 else os.path.join(os.path.dirname(os.path.abspath(__file__)), 'corpus')
+	for target, files in seeds().items():
+		d = os.path.join(out, target)
+		os.makedirs(d, exist_ok=True)
+		for name, data in files.items():
+			with open(os.path.join(d, name), 'wb') as f:
+				f.write(data)
+		print(f'{target}: {len(files)} seeds')
+
+
+if __name__ == '__main__':
+	main()
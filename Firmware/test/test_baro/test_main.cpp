@@ -0,0 +1,298 @@
+/**
+ * @file test_main.cpp
+ * @brief Baro pipeline benchmark against the previous single PT2 on synthesized flights, run with pio test -e native_baro
+ *
+ * Set BARO_LOG to a text file with raw LOG_BARO values (one per line, 40.96 counts per Pa, 50 Hz) to also replay a recorded blackbox stream
+ *
+ * Copyright (c) 2026 Kolibri-FC contributors
+ *
+ * This file is part of Kolibri-FC (https://github.com/bastian2001/Kolibri-FC).
+ *
+ * Kolibri-FC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Kolibri-FC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "drivers/baroPipeline.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unity.h>
+#include <vector>
+
+using std::vector;
+
+#define SAMPLE_HZ 50
+#define COUNTS_PER_PA 40.96f // LPS22, as logged in LOG_BARO
+
+static u32 rngState = 1;
+static u32 rng() {
+	rngState ^= rngState << 13;
+	rngState ^= rngState >> 17;
+	rngState ^= rngState << 5;
+	return rngState;
+}
+static f32 uniform() {
+	return (rng() >> 8) / 16777216.f;
+}
+static f32 gaussian() {
+	return sqrtf(-2 * logf(uniform() + 1e-9f)) * cosf(2 * (f32)M_PI * uniform());
+}
+
+static f32 toPressure(f32 alt) {
+	return 101325 * powf(1 - alt / 44330, 5.255f);
+}
+
+typedef struct sample {
+	f32 trueAlt; // m
+	f32 pressure; // Pa, as read from the sensor
+	f32 temperature; // °C
+} Sample;
+
+typedef struct simConfig {
+	f32 noisePa; // white sensor noise
+	f32 propWashPa; // low frequency noise while flying
+	f32 spikePercent; // short pressure spikes (impacts, prop wash gusts onto the port)
+	f32 glitchPercent; // broken I2C reads: one byte of the raw value wrong
+	f32 tempStart, tempEnd; // sensor warms up over the first minute
+	f32 tempDriftPa; // per °C, error of the sensor
+} SimConfig;
+
+static SimConfig cfg;
+
+// hover, climb, hover, fast descent, sine, hover: 90 s
+static f32 profile(f32 t) {
+	if (t < 10) return 100;
+	if (t < 20) return 100 + 3 * (t - 10);
+	if (t < 30) return 130;
+	if (t < 36) return 130 - 5 * (t - 30);
+	if (t < 60) return 100 + 4 * sinf((t - 36) * 0.8f);
+	return 100 + 4 * sinf(24 * 0.8f);
+}
+
+static vector<Sample> simulate(f32 seconds) {
+	vector<Sample> out;
+	f32 wash = 0;
+	for (u32 i = 0; i < seconds * SAMPLE_HZ; i++) {
+		const f32 t = (f32)i / SAMPLE_HZ;
+		Sample s;
+		s.trueAlt = profile(t);
+		s.temperature = cfg.tempStart + (cfg.tempEnd - cfg.tempStart) * fminf(t / 60, 1);
+		wash += 0.1f * (gaussian() * cfg.propWashPa - wash);
+		s.pressure = toPressure(s.trueAlt) + gaussian() * cfg.noisePa + wash + cfg.tempDriftPa * (s.temperature - cfg.tempStart);
+		if (uniform() * 100 < cfg.spikePercent) s.pressure += (uniform() < .5f ? -1 : 1) * (100 + uniform() * 400);
+		if (uniform() * 100 < cfg.glitchPercent) {
+			i32 raw = s.pressure * COUNTS_PER_PA;
+			raw ^= (rng() & 0xFF) << (8 * (rng() % 3));
+			s.pressure = raw / COUNTS_PER_PA;
+		}
+		out.push_back(s);
+	}
+	return out;
+}
+
+typedef struct stats {
+	f32 rms; // m
+	f32 max; // m
+	f32 mean; // m, signed
+} Stats;
+
+/// @brief the previous processing: PT2 at 1 Hz on the altitude of the raw pressure
+class Baseline {
+public:
+	Baseline() {
+		const f32 omega = 2 * (f32)M_PI * 1.5537f / SAMPLE_HZ;
+		alpha = omega / (omega + 1);
+	}
+	f32 update(f32 pressure) {
+		const f32 alt = 44330 * (1 - powf(pressure / 101325.f, 1 / 5.255f));
+		if (first) y1 = y = alt;
+		first = false;
+		y1 += alpha * (alt - y1);
+		y += alpha * (y1 - y);
+		return y;
+	}
+
+private:
+	bool first = true;
+	f32 alpha, y1 = 0, y = 0;
+};
+
+static Stats evaluate(const vector<f32> &out, const vector<Sample> &in, f32 from, f32 to) {
+	Stats s = {};
+	u32 n = 0;
+	for (u32 i = from * SAMPLE_HZ; i < to * SAMPLE_HZ && i < in.size(); i++) {
+		const f32 e = out[i] - in[i].trueAlt;
+		s.rms += e * e;
+		s.max = fmaxf(s.max, fabsf(e));
+		s.mean += e;
+		n++;
+	}
+	s.rms = sqrtf(s.rms / n);
+	s.mean /= n;
+	return s;
+}
+
+typedef struct run {
+	vector<f32> pipeline, baseline;
+} Run;
+
+static Run process(const vector<Sample> &in, BaroPipeline &p) {
+	Run r;
+	Baseline b;
+	p.reset(in[0].pressure, in[0].temperature);
+	for (const Sample &s : in) {
+		p.update(s.pressure, s.temperature);
+		r.pipeline.push_back(p.altitude());
+		r.baseline.push_back(b.update(s.pressure));
+	}
+	return r;
+}
+
+static void report(const char *name, Stats p, Stats b) {
+	char msg[160];
+	snprintf(msg, sizeof(msg), "%s: pipeline rms %.3f max %.3f mean %.3f m, baseline rms %.3f max %.3f mean %.3f m", name, p.rms, p.max, p.mean, b.rms, b.max, b.mean);
+	TEST_MESSAGE(msg);
+}
+
+void setUp() {
+	rngState = 0x1357BDF1;
+	cfg = {1, 3, 0, 0, 25, 25, 0};
+}
+
+void tearDown() {}
+
+void test_clean_flight() {
+	vector<Sample> in = simulate(90);
+	BaroPipeline p(SAMPLE_HZ, 1);
+	Run r = process(in, p);
+	Stats ps = evaluate(r.pipeline, in, 2, 90);
+	Stats bs = evaluate(r.baseline, in, 2, 90);
+	report("clean", ps, bs);
+	// nothing is rejected on a normal flight, including the fast descent
+	TEST_ASSERT_TRUE(p.outliers < in.size() / 200);
+	TEST_ASSERT_TRUE(ps.rms < bs.rms);
+}
+
+void test_latency_compensation() {
+	cfg.propWashPa = 0;
+	vector<Sample> in = simulate(40);
+	BaroPipeline p(SAMPLE_HZ, 1);
+	Run r = process(in, p);
+	// steady 3 m/s climb: the plain PT2 lags by its group delay, the pipeline does not
+	Stats ps = evaluate(r.pipeline, in, 14, 20);
+	Stats bs = evaluate(r.baseline, in, 14, 20);
+	report("climb", ps, bs);
+	TEST_ASSERT_TRUE(bs.mean < -0.5f);
+	TEST_ASSERT_TRUE(fabsf(ps.mean) < 0.1f);
+	TEST_ASSERT_TRUE(ps.rms < bs.rms / 3);
+	// 5 m/s descent
+	ps = evaluate(r.pipeline, in, 33, 36);
+	bs = evaluate(r.baseline, in, 33, 36);
+	report("descent", ps, bs);
+	TEST_ASSERT_TRUE(fabsf(ps.mean) < 0.2f);
+	TEST_ASSERT_TRUE(bs.mean > 0.8f);
+}
+
+void test_spikes_and_glitches() {
+	cfg.spikePercent = 2;
+	cfg.glitchPercent = 0.5f;
+	vector<Sample> in = simulate(90);
+	BaroPipeline p(SAMPLE_HZ, 1);
+	Run r = process(in, p);
+	Stats ps = evaluate(r.pipeline, in, 2, 90);
+	Stats bs = evaluate(r.baseline, in, 2, 90);
+	report("spikes", ps, bs);
+	TEST_ASSERT_GREATER_THAN_UINT32(in.size() / 100, p.outliers);
+	TEST_ASSERT_TRUE(ps.max < 1.f);
+	TEST_ASSERT_TRUE(bs.max > 3 * ps.max);
+	// the velocity that goes into the altitude fusion stays sane while hovering, the previous one was the difference of two PT2 outputs
+	f32 maxVel = 0, maxBaselineVel = 0;
+	for (u32 i = 1; i < 10 * SAMPLE_HZ; i++) {
+		maxBaselineVel = fmaxf(maxBaselineVel, fabsf(r.baseline[i] - r.baseline[i - 1]) * SAMPLE_HZ);
+	}
+	BaroPipeline v(SAMPLE_HZ, 1);
+	v.reset(in[0].pressure, in[0].temperature);
+	for (u32 i = 0; i < 10 * SAMPLE_HZ; i++) {
+		v.update(in[i].pressure, in[i].temperature);
+		maxVel = fmaxf(maxVel, fabsf(v.velocity()));
+	}
+	TEST_ASSERT_TRUE(maxVel < 1.f);
+	TEST_ASSERT_TRUE(maxBaselineVel > 5 * maxVel);
+}
+
+void test_temperature_compensation() {
+	cfg.tempEnd = 40;
+	cfg.tempDriftPa = 1.5f;
+	vector<Sample> in = simulate(90);
+	BaroPipeline off(SAMPLE_HZ, 1), on(SAMPLE_HZ, 1);
+	on.tempCoeff = 1.5f;
+	Run roff = process(in, off);
+	Run ron = process(in, on);
+	Stats soff = evaluate(roff.pipeline, in, 70, 90);
+	Stats son = evaluate(ron.pipeline, in, 70, 90);
+	report("warm up", son, soff);
+	TEST_ASSERT_TRUE(fabsf(soff.mean) > 1.f);
+	TEST_ASSERT_TRUE(fabsf(son.mean) < 0.2f);
+}
+
+void test_recorded_log() {
+	const char *path = getenv("BARO_LOG");
+	if (!path) {
+		TEST_MESSAGE("BARO_LOG not set, skipped");
+		return;
+	}
+	FILE *f = fopen(path, "r");
+	TEST_ASSERT_TRUE(f != nullptr);
+	vector<f32> pressure;
+	long raw;
+	while (fscanf(f, "%ld", &raw) == 1) pressure.push_back(raw / COUNTS_PER_PA);
+	fclose(f);
+	TEST_ASSERT_GREATER_THAN_UINT32(SAMPLE_HZ, pressure.size());
+	// no ground truth: compare the noise of the outputs (difference to their centered 2 s average) and count the rejected samples
+	BaroPipeline p(SAMPLE_HZ, 1);
+	Baseline b;
+	p.reset(pressure[0], 25);
+	vector<f32> outP, outB;
+	for (f32 pr : pressure) {
+		p.update(pr, 25);
+		outP.push_back(p.filteredAltitude());
+		outB.push_back(b.update(pr));
+	}
+	f32 noiseP = 0, noiseB = 0;
+	u32 n = 0;
+	for (u32 i = SAMPLE_HZ; i + SAMPLE_HZ < outP.size(); i++) {
+		f32 avgP = 0, avgB = 0;
+		for (u32 j = i - SAMPLE_HZ; j < i + SAMPLE_HZ; j++) {
+			avgP += outP[j];
+			avgB += outB[j];
+		}
+		avgP /= 2 * SAMPLE_HZ;
+		avgB /= 2 * SAMPLE_HZ;
+		noiseP += (outP[i] - avgP) * (outP[i] - avgP);
+		noiseB += (outB[i] - avgB) * (outB[i] - avgB);
+		n++;
+	}
+	char msg[160];
+	snprintf(msg, sizeof(msg), "%u samples, %u rejected, noise pipeline %.3f m, baseline %.3f m", (u32)pressure.size(), p.outliers, sqrtf(noiseP / n), sqrtf(noiseB / n));
+	TEST_MESSAGE(msg);
+}
+
+int main(int argc, char **argv) {
+	UNITY_BEGIN();
+	RUN_TEST(test_clean_flight);
+	RUN_TEST(test_latency_compensation);
+	RUN_TEST(test_spikes_and_glitches);
+	RUN_TEST(test_temperature_compensation);
+	RUN_TEST(test_recorded_log);
+	return UNITY_END();
+}
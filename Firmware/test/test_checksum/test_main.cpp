@@ -0,0 +1,258 @@
+/**
+ * @file test_main.cpp
+ * @brief Checksum tables against bitwise reference implementations, and a cycles per byte benchmark, run with pio test -e native_checksum
+ *
+ * Copyright (c) 2026 Kolibri-FC contributors
+ *
+ * This file is part of Kolibri-FC (https://github.com/bastian2001/Kolibri-FC).
+ *
+ * Kolibri-FC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Kolibri-FC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "utils/checksum.h"
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC
+#endif
+
+static u32 rngState = 1;
+static u32 rng() {
+	rngState ^= rngState << 13;
+	rngState ^= rngState >> 17;
+	rngState ^= rngState << 5;
+	return rngState;
+}
+
+// bitwise references, straight from the definitions
+
+static u8 refCrc8D5(const u8 *data, u32 len, u8 crc = 0) {
+	for (u32 i = 0; i < len; i++) {
+		crc ^= data[i];
+		for (int j = 0; j < 8; j++)
+			crc = crc & 0x80 ? (crc << 1) ^ 0xD5 : crc << 1;
+	}
+	return crc;
+}
+
+static u16 refXmodem(const u8 *data, u32 len, u16 crc = 0) {
+	for (u32 i = 0; i < len; i++) {
+		crc ^= (u16)data[i] << 8;
+		for (int j = 0; j < 8; j++)
+			crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+	}
+	return crc;
+}
+
+static u32 refCrc32(const u8 *data, u32 len, u32 crc = 0) {
+	crc = ~crc;
+	for (u32 i = 0; i < len; i++) {
+		crc ^= data[i];
+		for (int j = 0; j < 8; j++)
+			crc = crc & 1 ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+	}
+	return ~crc;
+}
+
+static void refFletcher(const u8 *data, u32 len, u8 *a, u8 *b) {
+	for (u32 i = 0; i < len; i++) {
+		*a += data[i];
+		*b += *a;
+	}
+}
+
+#define DATA_LEN 4096
+static u8 data[DATA_LEN + 8];
+
+void setUp() {}
+void tearDown() {}
+
+void test_check_values() {
+	const u8 *check = (const u8 *)"123456789";
+	TEST_ASSERT_EQUAL_HEX8(0xBC, crc8D5(check, 9)); // CRC-8/DVB-S2
+	TEST_ASSERT_EQUAL_HEX8(0xBC, crc8D5Slice8(check, 9));
+	TEST_ASSERT_EQUAL(0x31C3, crc16Xmodem(check, 9)); // CRC-16/XMODEM
+	TEST_ASSERT_EQUAL(0x31C3, crc16XmodemSlice4(check, 9));
+	TEST_ASSERT_EQUAL_HEX32(0xCBF43926, crc32(check, 9)); // CRC-32/ISO-HDLC
+	TEST_ASSERT_EQUAL_HEX32(0xCBF43926, crc32Slice4(check, 9));
+
+	// UBX-CFG-RST, checksum over class, id, length and payload
+	const u8 cfgRst[] = {0xB5, 0x62, 0x06, 0x04, 0x04, 0x00, 0xFF, 0xFF, 0x00, 0x00, 0x0C, 0x5D};
+	u8 a = 0, b = 0;
+	fletcher8(&cfgRst[2], 8, &a, &b);
+	TEST_ASSERT_EQUAL_HEX8(cfgRst[10], a);
+	TEST_ASSERT_EQUAL_HEX8(cfgRst[11], b);
+}
+
+void test_crc8_variants() {
+	// every length around the slice boundaries, every alignment, any start value
+	for (int n = 0; n < 20000; n++) {
+		u32 len = n < 600 ? n : rng() % DATA_LEN;
+		u32 offset = rng() % 8;
+		u8 crc = rng();
+		u8 ref = refCrc8D5(&data[offset], len, crc);
+		TEST_ASSERT_EQUAL_HEX8(ref, crc8D5Bytewise(&data[offset], len, crc));
+		TEST_ASSERT_EQUAL_HEX8(ref, crc8D5Slice4(&data[offset], len, crc));
+		TEST_ASSERT_EQUAL_HEX8(ref, crc8D5Slice8(&data[offset], len, crc));
+		TEST_ASSERT_EQUAL_HEX8(ref, crc8D5(&data[offset], len, crc));
+		if (len) TEST_ASSERT_EQUAL_HEX8(refCrc8D5(&data[offset], 1, crc), crc8D5Byte(crc, data[offset]));
+	}
+}
+
+void test_crc16_variants() {
+	for (int n = 0; n < 20000; n++) {
+		u32 len = n < 600 ? n : rng() % DATA_LEN;
+		u32 offset = rng() % 8;
+		u16 crc = rng();
+		u16 ref = refXmodem(&data[offset], len, crc);
+		TEST_ASSERT_EQUAL(ref, crc16XmodemBytewise(&data[offset], len, crc));
+		TEST_ASSERT_EQUAL(ref, crc16XmodemSlice4(&data[offset], len, crc));
+		TEST_ASSERT_EQUAL(ref, crc16Xmodem(&data[offset], len, crc));
+		if (len) TEST_ASSERT_EQUAL(refXmodem(&data[offset], 1, crc), crc16XmodemByte(crc, data[offset]));
+	}
+}
+
+void test_crc32_variants() {
+	for (int n = 0; n < 20000; n++) {
+		u32 len = n < 600 ? n : rng() % DATA_LEN;
+		u32 offset = rng() % 8;
+		u32 crc = rng();
+		u32 ref = refCrc32(&data[offset], len, crc);
+		TEST_ASSERT_EQUAL_HEX32(ref, crc32Bytewise(&data[offset], len, crc));
+		TEST_ASSERT_EQUAL_HEX32(ref, crc32Slice4(&data[offset], len, crc));
+		TEST_ASSERT_EQUAL_HEX32(ref, crc32(&data[offset], len, crc));
+	}
+}
+
+void test_fletcher_variants() {
+	for (int n = 0; n < 20000; n++) {
+		u32 len = n < 600 ? n : rng() % DATA_LEN;
+		u32 offset = rng() % 8;
+		u8 refA = rng(), refB = rng();
+		u8 a = refA, b = refB, byteA = refA, byteB = refB;
+		refFletcher(&data[offset], len, &refA, &refB);
+		fletcher8(&data[offset], len, &a, &b);
+		fletcher8Bytewise(&data[offset], len, &byteA, &byteB);
+		TEST_ASSERT_EQUAL_HEX8(refA, a);
+		TEST_ASSERT_EQUAL_HEX8(refB, b);
+		TEST_ASSERT_EQUAL_HEX8(refA, byteA);
+		TEST_ASSERT_EQUAL_HEX8(refB, byteB);
+	}
+}
+
+void test_incremental() {
+	// any split gives the same result as one call
+	for (int n = 0; n < 5000; n++) {
+		u32 len = rng() % DATA_LEN;
+		u32 split = len ? rng() % len : 0;
+		u8 c8 = crc8D5(data, split);
+		TEST_ASSERT_EQUAL_HEX8(crc8D5(data, len), crc8D5(&data[split], len - split, c8));
+		u16 c16 = crc16Xmodem(data, split);
+		TEST_ASSERT_EQUAL(crc16Xmodem(data, len), crc16Xmodem(&data[split], len - split, c16));
+		u32 c32 = crc32(data, split);
+		TEST_ASSERT_EQUAL_HEX32(crc32(data, len), crc32(&data[split], len - split, c32));
+		u8 a = 0, b = 0, wholeA = 0, wholeB = 0;
+		fletcher8(data, split, &a, &b);
+		fletcher8(&data[split], len - split, &a, &b);
+		fletcher8(data, len, &wholeA, &wholeB);
+		TEST_ASSERT_EQUAL_HEX8(wholeA, a);
+		TEST_ASSERT_EQUAL_HEX8(wholeB, b);
+
+		// second part first, the first part joined later
+		TEST_ASSERT_EQUAL_HEX8(crc8D5(data, len), crc8D5Combine(c8, crc8D5(&data[split], len - split), len - split));
+	}
+}
+
+void test_advance() {
+	static u8 zeros[65535] = {};
+	for (int n = 0; n < 10000; n++) {
+		u8 crc = rng();
+		u32 len = n < 300 ? n : rng() % sizeof(zeros);
+		TEST_ASSERT_EQUAL_HEX8(refCrc8D5(zeros, len, crc), crc8D5Advance(crc, len));
+	}
+}
+
+static volatile u32 benchSink;
+
+// cycles per byte (TSC on x86, otherwise ns) of fn over len bytes
+template <typename F>
+static f64 bench(u32 len, F fn) {
+	const u32 rounds = 4000000 / (len + 16) + 10;
+	using clk = std::chrono::steady_clock;
+	u32 acc = 0;
+	auto t0 = clk::now();
+#ifdef HAVE_TSC
+	u64 c0 = __rdtsc();
+#endif
+	for (u32 n = 0; n < rounds; n++)
+		acc += fn(&data[n & 7], len);
+#ifdef HAVE_TSC
+	u64 c1 = __rdtsc();
+	benchSink = acc;
+	(void)t0;
+	return (f64)(c1 - c0) / rounds / len;
+#else
+	auto t1 = clk::now();
+	benchSink = acc;
+	return std::chrono::duration<f64, std::nano>(t1 - t0).count() / rounds / len;
+#endif
+}
+
+void test_benchmark() {
+	const u32 lens[] = {8, 26, 64, 262, 1030, 4096}; // CRSF RC, 4way frame, MSP TASK_STATUS, BB chunk
+#ifdef HAVE_TSC
+	printf("host TSC cycles per byte\n");
+#else
+	printf("host ns per byte\n");
+#endif
+	printf("%6s | %8s %8s %8s | %8s %8s | %8s %8s\n", "len", "crc8 1", "crc8 4", "crc8 8", "crc16 1", "crc16 4", "fl8 1", "fl8 4");
+	for (u32 len : lens) {
+		f64 c8b = bench(len, [](const u8 *d, u32 l) { return (u32)crc8D5Bytewise(d, l); });
+		f64 c84 = bench(len, [](const u8 *d, u32 l) { return (u32)crc8D5Slice4(d, l); });
+		f64 c88 = bench(len, [](const u8 *d, u32 l) { return (u32)crc8D5Slice8(d, l); });
+		f64 c16b = bench(len, [](const u8 *d, u32 l) { return (u32)crc16XmodemBytewise(d, l); });
+		f64 c164 = bench(len, [](const u8 *d, u32 l) { return (u32)crc16XmodemSlice4(d, l); });
+		f64 flb = bench(len, [](const u8 *d, u32 l) {
+			u8 a = 0, b = 0;
+			fletcher8Bytewise(d, l, &a, &b);
+			return (u32)(a | b << 8);
+		});
+		f64 fl4 = bench(len, [](const u8 *d, u32 l) {
+			u8 a = 0, b = 0;
+			fletcher8(d, l, &a, &b);
+			return (u32)(a | b << 8);
+		});
+		printf("%6u | %8.2f %8.2f %8.2f | %8.2f %8.2f | %8.2f %8.2f\n", len, c8b, c84, c88, c16b, c164, flb, fl4);
+	}
+}
+
+int main(int argc, char **argv) {
+	crcInit();
+	for (auto &b : data)
+		b = rng();
+
+	UNITY_BEGIN();
+	RUN_TEST(test_check_values);
+	RUN_TEST(test_crc8_variants);
+	RUN_TEST(test_crc16_variants);
+	RUN_TEST(test_crc32_variants);
+	RUN_TEST(test_fletcher_variants);
+	RUN_TEST(test_incremental);
+	RUN_TEST(test_advance);
+	RUN_TEST(test_benchmark);
+	return UNITY_END();
+}
@@ -0,0 +1,96 @@
+/**
+ * @file fckafdNative.h
+ * @brief Replaces global.h when flashBb.cpp is built for the host (pio test -e native)
+ *
+ * Copyright (c) 2026 Kolibri-FC contributors
+ *
+ * This file is part of Kolibri-FC (https://github.com/bastian2001/Kolibri-FC).
+ *
+ * Kolibri-FC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Kolibri-FC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include "typedefs.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+#define SD_BB 0
+#define FLASH_BB 1
+#define BLACKBOX_STORAGE FLASH_BB
+
+#define DECODE_U2(buf) ((*(buf) & 0xFF) + ((u16)(*((u8 *)(buf) + 1)) << 8))
+static inline u32 DECODE_U4(const u8 *buf) {
+	u32 result;
+	memcpy(&result, buf, 4);
+	return result;
+}
+
+#ifdef FCKAFD_VERBOSE
+#define DEBUG_PRINTLN(x) printf("%15s:%3d: %s\n", __FILE__, __LINE__, x)
+#define DEBUG_PRINTF(x, ...)                       \
+	printf("%15s:%3d: ", __FILE__, __LINE__); \
+	printf(x, __VA_ARGS__)
+#else
+#define DEBUG_PRINTLN(x)
+#define DEBUG_PRINTF(x, ...)
+#endif
+
+// SdFat open flags
+typedef int oflag_t;
+#ifndef O_RDONLY
+#define O_RDONLY 0x00
+#endif
+#ifndef O_WRITE
+#define O_WRITE 0x01
+#endif
+#ifndef O_CREAT
+#define O_CREAT 0x40
+#endif
+
+typedef u8 pin_size_t;
+
+// minimal Arduino Print/Stream, only what FlashFile overrides
+class Print {
+public:
+	virtual ~Print() = default;
+	virtual size_t write(uint8_t) = 0;
+	virtual size_t write(const uint8_t *buffer, size_t size) = 0;
+	virtual int availableForWrite() { return 0; };
+	virtual void flush() {};
+};
+
+class Stream : public Print {
+public:
+	virtual int available() = 0;
+	virtual int read() = 0;
+	virtual int peek() = 0;
+};
+
+// implemented in nandSim.cpp, they advance the simulated clock
+void sleep_ms(u32 ms);
+void tight_loop_contents();
+
+struct NativeRp2040 {
+	void wdt_reset() {};
+};
+inline NativeRp2040 rp2040;
+
+inline time_t rtcGetUnixTimestamp() { return 1767225600; }
+inline void printIndMessage(const char *msg) { printf("%s\n", msg); }
+
+#include "drivers/flashBb.h"
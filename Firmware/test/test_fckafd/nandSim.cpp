@@ -0,0 +1,399 @@
+/**
+ * @file nandSim.cpp
+ * @brief Simulated SPI NAND flash chip and the SPI layer of Fckafd for the native build
+ *
+ * Copyright (c) 2026 Kolibri-FC contributors
+ *
+ * This file is part of Kolibri-FC (https://github.com/bastian2001/Kolibri-FC).
+ *
+ * Kolibri-FC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Kolibri-FC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "nandSim.h"
+
+NandSim *nandSim = nullptr;
+
+#define STATUS_OIP (1 << 0)
+#define STATUS_WEL (1 << 1)
+#define STATUS_E_FAIL (1 << 2)
+#define STATUS_P_FAIL (1 << 3)
+#define STATUS_ECC_SHIFT 4
+#define STATUS_CRBSY (1 << 7)
+
+#define FEATURE_LOCK 0
+#define FEATURE_CONFIG 1
+#define FEATURE_STATUS 2
+#define FEATURE_DIE 3
+#define CONFIG_OTP (1 << 6) // parameter page instead of the array
+#define CONFIG_ECC (1 << 4)
+
+NandSim::NandSim(u32 blocks) : blockCount(blocks) {
+	mem.assign((size_t)blocks * NAND_PAGES_PER_BLOCK * NAND_FULL_PAGE, 0xFF);
+	programCounts.assign((size_t)blocks * NAND_PAGES_PER_BLOCK, 0);
+	sectorsProgrammed.assign((size_t)blocks * NAND_PAGES_PER_BLOCK, 0);
+	tornSectors.assign((size_t)blocks * NAND_PAGES_PER_BLOCK, 0);
+	eraseCounts.assign(blocks, 0);
+	powerCycle();
+}
+
+void NandSim::powerCycle() {
+	memset(cache, 0xFF, sizeof(cache));
+	memset(cacheLoaded, 0, sizeof(cacheLoaded));
+	cachePlane = 0;
+	dataRegValid = false;
+	dataRegReadyAt = now;
+	features[FEATURE_LOCK] = 0x38; // all blocks locked after power up
+	features[FEATURE_CONFIG] = CONFIG_ECC;
+	features[FEATURE_STATUS] = 0;
+	features[FEATURE_DIE] = 0;
+	wel = false;
+	busyUntil = now;
+	pendingStatus = 0;
+	powerLossCountdown = 0;
+	selected = false;
+	cmd.clear();
+}
+
+void NandSim::setFactoryBad(u32 block) {
+	mem[((size_t)block * NAND_PAGES_PER_BLOCK) * NAND_FULL_PAGE + NAND_PAGE_SIZE] = 0x00;
+	failingPrograms.insert(block);
+	failingErases.insert(block);
+}
+
+void NandSim::flipBits(u32 block, u32 page, u32 sector, u32 count) {
+	std::vector<u32> &f = flips[block * NAND_PAGES_PER_BLOCK + page];
+	for (u32 i = 0; i < count; i++)
+		f.push_back(sector * 512 * 8 + (i * 37 + f.size() * 101) % (512 * 8));
+}
+
+bool NandSim::isErased(u32 block) const {
+	const u8 *p = page(block, 0);
+	for (size_t i = 0; i < (size_t)NAND_PAGES_PER_BLOCK * NAND_FULL_PAGE; i++)
+		if (p[i] != 0xFF) return false;
+	return true;
+}
+
+//==============================SPI BUS===================================//
+void NandSim::select() {
+	selected = true;
+	cmd.clear();
+}
+
+void NandSim::deselect() {
+	if (!selected) return;
+	selected = false;
+	if (cmd.empty()) return;
+	execute();
+}
+
+u8 NandSim::transfer(u8 tx) {
+	now += 8000000000ULL / spiHz;
+	if (!selected) return 0xFF;
+	cmd.push_back(tx);
+	const size_t i = cmd.size() - 1;
+	switch (cmd[0]) {
+	case 0x9F: // READ ID
+		if (i == 2) return 0x2C;
+		if (i == 3) return 0x24;
+		return 0;
+	case 0x0F: // GET FEATURE
+		if (i != 2) return 0;
+		if (cmd[1] == 0xC0) {
+			const u8 crbsy = cacheReadBusy() ? STATUS_CRBSY : 0;
+			if (busy()) return STATUS_OIP | crbsy | (wel ? STATUS_WEL : 0);
+			return pendingStatus | crbsy | (wel ? STATUS_WEL : 0);
+		}
+		if ((cmd[1] & 0x0F) || cmd[1] < 0xA0 || cmd[1] > 0xD0) return 0;
+		return features[(cmd[1] - 0xA0) >> 4];
+	case 0x03: // READ FROM CACHE x1: 2 column bytes, 1 dummy byte, then data
+		if (i == 3) {
+			if (busy()) violations.busy++;
+			if (((cmd[1] >> 4) & 1) != cachePlane) violations.plane++;
+		}
+		if (i < 4) return 0;
+		return readCache((((cmd[1] << 8) | cmd[2]) & 0xFFF) + i - 4);
+	default:
+		return 0;
+	}
+}
+
+void NandSim::execute() {
+	const u8 c = cmd[0];
+	if (busy() && c != 0x0F && c != 0xFF && c != 0x03) {
+		// the chip ignores everything except GET FEATURE and RESET while busy
+		violations.busy++;
+		return;
+	}
+	if (cacheReadBusy() && c != 0x0F && c != 0xFF && c != 0x03 && c != 0x30 && c != 0x3F) {
+		// while reading ahead, only reading the cache and continuing the cache read are allowed
+		violations.busy++;
+		return;
+	}
+	const u32 addr = cmd.size() >= 4 ? ((u32)cmd[1] << 16) | ((u32)cmd[2] << 8) | cmd[3] : 0;
+	switch (c) {
+	case 0xFF: // RESET
+		busyUntil = now;
+		pendingStatus = 0;
+		wel = false;
+		break;
+	case 0x1F: // SET FEATURE
+		if (cmd.size() >= 3 && !(cmd[1] & 0x0F) && cmd[1] >= 0xA0 && cmd[1] <= 0xD0 && cmd[1] != 0xC0)
+			features[(cmd[1] - 0xA0) >> 4] = cmd[2];
+		break;
+	case 0x06: // WRITE ENABLE
+		wel = true;
+		break;
+	case 0x04: // WRITE DISABLE
+		wel = false;
+		break;
+	case 0x13: // PAGE READ
+		if (cmd.size() >= 4) pageRead(addr >> 6, addr & 0x3F);
+		break;
+	case 0x30: // PAGE READ CACHE RANDOM
+		if (cmd.size() >= 4) pageReadCache(false, addr >> 6, addr & 0x3F);
+		break;
+	case 0x3F: // PAGE READ CACHE LAST
+		pageReadCache(true, 0, 0);
+		break;
+	case 0x02: // PROGRAM LOAD, resets the cache
+		memset(cache, 0xFF, sizeof(cache));
+		memset(cacheLoaded, 0, sizeof(cacheLoaded));
+		[[fallthrough]];
+	case 0x84: { // PROGRAM LOAD RANDOM DATA, keeps the rest of the cache
+		if (cmd.size() < 3) break;
+		cachePlane = (cmd[1] >> 4) & 1;
+		const u32 col = ((cmd[1] << 8) | cmd[2]) & 0xFFF;
+		for (size_t j = 3; j < cmd.size() && col + j - 3 < NAND_FULL_PAGE; j++) {
+			cache[col + j - 3] = cmd[j];
+			cacheLoaded[col + j - 3] = true;
+		}
+	} break;
+	case 0x10: // PROGRAM EXECUTE
+		if (cmd.size() >= 4) program(addr >> 6, addr & 0x3F);
+		break;
+	case 0xD8: // BLOCK ERASE
+		if (cmd.size() >= 4) erase(addr >> 6);
+		break;
+	}
+}
+
+//==============================ARRAY=====================================//
+u8 NandSim::readCache(u32 column) {
+	if (column >= NAND_FULL_PAGE) return 0xFF;
+	return cache[column];
+}
+
+u8 NandSim::readArray(u32 block, u32 page, u8 *dst) {
+	pageReads++;
+	if ((features[FEATURE_CONFIG] & CONFIG_OTP) && block == 0 && page == 1) {
+		// parameter page, the fields Fckafd::begin() reads
+		memset(dst, 0, NAND_FULL_PAGE);
+		memcpy(&dst[0], "ONFI", 4);
+		memcpy(&dst[32], "MICRON      ", 12);
+		memcpy(&dst[44], "MT29F2G01ABAGDWB     ", 20);
+		dst[64] = 0x2C;
+		const u32 pageSize = NAND_PAGE_SIZE, pages = NAND_PAGES_PER_BLOCK;
+		const u16 spare = NAND_SPARE_SIZE;
+		const u16 maxProg = 600, maxErase = 10000, maxRead = 115; // us
+		memcpy(&dst[80], &pageSize, 4);
+		memcpy(&dst[84], &spare, 2);
+		memcpy(&dst[92], &pages, 4);
+		memcpy(&dst[96], &blockCount, 4);
+		memcpy(&dst[133], &maxProg, 2);
+		memcpy(&dst[135], &maxErase, 2);
+		memcpy(&dst[137], &maxRead, 2);
+		return 0;
+	}
+	if (block >= blockCount || page >= NAND_PAGES_PER_BLOCK) {
+		memset(dst, 0xFF, NAND_FULL_PAGE);
+		return 0;
+	}
+	memcpy(dst, this->page(block, page), NAND_FULL_PAGE);
+
+	// a sector with a cut program has neither its data nor its parity complete
+	if (tornSectors[block * NAND_PAGES_PER_BLOCK + page] && (features[FEATURE_CONFIG] & CONFIG_ECC)) return 0b010 << STATUS_ECC_SHIFT;
+	auto it = flips.find(block * NAND_PAGES_PER_BLOCK + page);
+	if (it == flips.end()) return 0;
+	u32 perSector[4] = {0};
+	for (u32 bit : it->second) perSector[bit / (512 * 8)]++;
+	u8 ecc = 0;
+	for (u32 bit : it->second) {
+		const u32 n = perSector[bit / (512 * 8)];
+		if ((features[FEATURE_CONFIG] & CONFIG_ECC) && n <= NAND_ECC_BITS) continue; // corrected
+		dst[bit / 8] ^= 1 << (bit % 8);
+	}
+	if (!(features[FEATURE_CONFIG] & CONFIG_ECC)) return 0;
+	for (u32 n : perSector) {
+		if (!n) continue;
+		u8 e;
+		if (n > NAND_ECC_BITS)
+			e = 0b010;
+		else if (n >= 7)
+			e = 0b101;
+		else if (n >= 4)
+			e = 0b011;
+		else
+			e = 0b001;
+		// uncorrectable wins, otherwise the highest correction count
+		if (ecc != 0b010 && (e == 0b010 || e > ecc)) ecc = e;
+	}
+	return ecc << STATUS_ECC_SHIFT;
+}
+
+void NandSim::pageRead(u32 block, u32 page) {
+	busyUntil = now + tRead;
+	dataRegEcc = readArray(block, page, dataReg);
+	dataRegValid = true;
+	memcpy(cache, dataReg, NAND_FULL_PAGE);
+	pendingStatus = dataRegEcc;
+	cachePlane = block & 1;
+	memset(cacheLoaded, 1, sizeof(cacheLoaded)); // an internal data move programs the whole page
+}
+
+void NandSim::pageReadCache(bool last, u32 block, u32 page) {
+	if (!dataRegValid) {
+		// nothing read before, the cache register would get undefined data
+		violations.busy++;
+		return;
+	}
+	// waits for a read ahead that is still running, then moves the data register into the cache register
+	const u64 start = now > dataRegReadyAt ? now : dataRegReadyAt;
+	busyUntil = start + tCacheBusy;
+	memcpy(cache, dataReg, NAND_FULL_PAGE);
+	pendingStatus = dataRegEcc;
+	memset(cacheLoaded, 1, sizeof(cacheLoaded));
+	if (last) {
+		dataRegValid = false;
+		dataRegReadyAt = busyUntil;
+		return;
+	}
+	if ((block & 1) != cachePlane) violations.plane++;
+	dataRegEcc = readArray(block, page, dataReg);
+	dataRegReadyAt = busyUntil + tRead;
+}
+
+bool NandSim::cutPower() {
+	if (!powerLossCountdown) return false;
+	return --powerLossCountdown == 0;
+}
+
+void NandSim::program(u32 block, u32 page) {
+	pendingStatus = 0;
+	if (!wel) {
+		violations.writeEnable++;
+		return;
+	}
+	wel = false;
+	if (features[FEATURE_LOCK] & 0x38) {
+		violations.locked++;
+		return;
+	}
+	if (block >= blockCount || page >= NAND_PAGES_PER_BLOCK) return;
+	if ((block & 1) != cachePlane) violations.plane++;
+	programs++;
+	busyUntil = now + tProg;
+	const size_t p = (size_t)block * NAND_PAGES_PER_BLOCK + page;
+	if (failingPrograms.count(block)) {
+		pendingStatus = STATUS_P_FAIL;
+		return;
+	}
+	if (++programCounts[p] > NAND_MAX_PARTIAL_PROGRAMS) violations.partialPrograms++;
+
+	const bool powerLoss = cutPower();
+	u8 *dst = &mem[p * NAND_FULL_PAGE];
+	u8 sectors = 0;
+	u32 loaded = 0;
+	for (u32 i = 0; i < NAND_FULL_PAGE; i++) {
+		if (!cacheLoaded[i]) continue;
+		if (powerLoss) {
+			tornSectors[p] |= 1 << (i < NAND_PAGE_SIZE ? i / 512 : (i - NAND_PAGE_SIZE) / 32);
+			if (++loaded % 2) continue; // only some of the cells are programmed
+		}
+		if ((dst[i] & cache[i]) != cache[i]) violations.notErased++;
+		dst[i] &= cache[i];
+		if (i < NAND_PAGE_SIZE && cache[i] != 0xFF) sectors |= 1 << (i / 512);
+	}
+	dataRegValid = false; // the page went through the data register
+	// the ECC parity of a sector can only be programmed once
+	if (sectors & sectorsProgrammed[p]) violations.sectorReprogram++;
+	sectorsProgrammed[p] |= sectors;
+	if (powerLoss) throw NandPowerLoss();
+}
+
+void NandSim::erase(u32 block) {
+	pendingStatus = 0;
+	if (!wel) {
+		violations.writeEnable++;
+		return;
+	}
+	wel = false;
+	if (features[FEATURE_LOCK] & 0x38) {
+		violations.locked++;
+		return;
+	}
+	if (block >= blockCount) return;
+	if (page(block, 0)[NAND_PAGE_SIZE] != 0xFF) violations.badBlockErase++;
+	erases++;
+	busyUntil = now + tErase;
+	if (failingErases.count(block)) {
+		pendingStatus = STATUS_E_FAIL;
+		return;
+	}
+	dataRegValid = false;
+	const size_t first = (size_t)block * NAND_PAGES_PER_BLOCK;
+	// a cut erase leaves the first half of the block erased
+	const u32 pages = cutPower() ? NAND_PAGES_PER_BLOCK / 2 : NAND_PAGES_PER_BLOCK;
+	memset(&mem[first * NAND_FULL_PAGE], 0xFF, (size_t)pages * NAND_FULL_PAGE);
+	for (u32 i = 0; i < pages; i++) {
+		programCounts[first + i] = 0;
+		sectorsProgrammed[first + i] = 0;
+		tornSectors[first + i] = 0;
+		flips.erase(first + i);
+	}
+	eraseCounts[block]++;
+	if (pages != NAND_PAGES_PER_BLOCK) throw NandPowerLoss();
+}
+
+//==============================FCKAFD SPI LAYER==========================//
+void sleep_ms(u32 ms) {
+	if (nandSim) nandSim->advance((u64)ms * 1000000);
+}
+
+void tight_loop_contents() {
+	if (nandSim) nandSim->advance(10);
+}
+
+void Fckafd::initSpi(pin_size_t ioBase, pin_size_t sckPin, pin_size_t csPin) {}
+
+void Fckafd::select() {
+	nandSim->select();
+}
+
+void Fckafd::deselect() {
+	nandSim->deselect();
+}
+
+u8 Fckafd::singleSpiTransfer(u8 txByte) {
+	return nandSim->transfer(txByte);
+}
+
+void Fckafd::burstSpiRead(u16 len, void *dst) {
+	u8 *d = (u8 *)dst;
+	for (u16 i = 0; i < len; i++) d[i] = nandSim->transfer(0);
+}
+
+void Fckafd::burstSpiWrite(u16 len, const void *src) {
+	const u8 *s = (const u8 *)src;
+	for (u16 i = 0; i < len; i++) nandSim->transfer(s[i]);
+}
@@ -0,0 +1,145 @@
+/**
+ * @file nandSim.h
+ * @brief Simulated Micron SPI NAND flash chip for host-side Fckafd tests
+ *
+ * Copyright (c) 2026 Kolibri-FC contributors
+ *
+ * This file is part of Kolibri-FC (https://github.com/bastian2001/Kolibri-FC).
+ *
+ * Kolibri-FC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Kolibri-FC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include "fckafdNative.h"
+#include <map>
+#include <set>
+#include <vector>
+
+#define NAND_PAGE_SIZE 2048
+#define NAND_SPARE_SIZE 128
+#define NAND_FULL_PAGE (NAND_PAGE_SIZE + NAND_SPARE_SIZE)
+#define NAND_PAGES_PER_BLOCK 64
+#define NAND_MAX_PARTIAL_PROGRAMS 4 // NOP: programs of the same page between two erases
+#define NAND_ECC_BITS 8 // bit errors per 512 byte sector that the on-chip ECC corrects
+
+/// @brief thrown by the simulator when the power is cut, see NandSim::cutPowerAfter()
+struct NandPowerLoss {};
+
+/// @brief counts of protocol violations, a correct driver never causes any of these
+typedef struct nandViolations {
+	u32 busy; // command other than GET FEATURE while an operation (or a read ahead) was in progress
+	u32 notErased; // program that needed a 0 -> 1 transition (page not erased)
+	u32 partialPrograms; // page programmed more than NAND_MAX_PARTIAL_PROGRAMS times
+	u32 sectorReprogram; // data of an already programmed 512 byte sector changed again (breaks its ECC)
+	u32 writeEnable; // program/erase without WRITE ENABLE
+	u32 locked; // program/erase while the block lock was active
+	u32 plane; // cache plane select did not match the block that was read/programmed
+	u32 badBlockErase; // erase of a block that carries a bad block marker
+
+	u32 total() const { return busy + notErased + partialPrograms + sectorReprogram + writeEnable + locked + plane + badBlockErase; };
+} NandViolations;
+
+/**
+ * @brief Command-level model of an MT29F SPI NAND
+ *
+ * @details Replaces the PIO/DMA SPI layer of Fckafd (select(), deselect(), singleSpiTransfer(), burstSpiRead(), burstSpiWrite()). It implements the commands Fckafd uses with the chip's rules: program can only clear bits, erase sets a whole block to 0xFF, a limited number of partial page programs, write enable latch, block lock and busy time. Operations take time on a simulated clock, so that throughput can be measured. Faults can be injected: factory bad blocks, failing programs/erases, bit flips and power loss.
+ */
+class NandSim {
+public:
+	NandSim(u32 blocks = 256); // 256 blocks (32 MiB) keep tests fast, begin() reads the size from the parameter page
+
+	// SPI bus, called by Fckafd
+	void select();
+	void deselect();
+	u8 transfer(u8 tx);
+
+	/// @brief reset all volatile state (cache, features, busy), memory content stays
+	void powerCycle();
+
+	/// @brief advance the simulated clock
+	void advance(u64 ns) { now += ns; };
+
+	// fault injection
+	/// @brief sets the factory bad block marker and lets all programs/erases of the block fail
+	void setFactoryBad(u32 block);
+	/// @brief programs (or erases) of this block report P_FAIL (E_FAIL) from now on
+	void failProgram(u32 block) { failingPrograms.insert(block); };
+	void failErase(u32 block) { failingErases.insert(block); };
+	/// @brief flips bits of a page when it is read, up to NAND_ECC_BITS per sector are corrected by ECC
+	void flipBits(u32 block, u32 page, u32 sector, u32 count);
+	/**
+	 * @brief Cuts the power during a program or erase
+	 *
+	 * @details The n-th following program execute or block erase is applied only partially, then NandPowerLoss is thrown. Call powerCycle() afterwards.
+	 * @param n 0 to disable
+	 */
+	void cutPowerAfter(u32 n) { powerLossCountdown = n; };
+
+	// inspection
+	const u8 *page(u32 block, u32 page) const { return &mem[((size_t)block * NAND_PAGES_PER_BLOCK + page) * NAND_FULL_PAGE]; };
+	bool isErased(u32 block) const;
+
+	u32 blockCount;
+	u64 now = 0; // ns
+	NandViolations violations = {};
+	u32 programs = 0;
+	u32 erases = 0;
+	u32 pageReads = 0; // array reads, including reads ahead
+	std::vector<u32> eraseCounts;
+
+	// timing
+	u32 spiHz = 24000000; // 264 MHz / 11 cycles per bit of extended_spi.pio
+	u32 tRead = 46000; // ns, page read into cache with ECC
+	u32 tCacheBusy = 3000; // ns, data register to cache register transfer of PAGE READ CACHE
+	u32 tProg = 220000; // ns
+	u32 tErase = 2000000; // ns
+
+private:
+	void execute(); // runs the command of the current transaction on CS rising
+	u8 readCache(u32 column);
+	u8 readArray(u32 block, u32 page, u8 *dst); // returns the ECC status
+	void pageRead(u32 block, u32 page);
+	void pageReadCache(bool last, u32 block, u32 page);
+	void program(u32 block, u32 page);
+	void erase(u32 block);
+	bool busy() const { return now < busyUntil; };
+	bool cacheReadBusy() const { return now < dataRegReadyAt; };
+	bool cutPower();
+
+	std::vector<u8> mem;
+	std::vector<u8> programCounts; // per page since the last erase
+	std::vector<u8> sectorsProgrammed; // per page since the last erase, bitmask of the 4 main sectors
+	std::vector<u8> tornSectors; // per page, bitmask of the 4 ECC sectors (main + spare part) whose program was cut, they read as uncorrectable
+	std::set<u32> failingPrograms;
+	std::set<u32> failingErases;
+	std::map<u32, std::vector<u32>> flips; // page index -> flipped bit positions
+
+	u8 cache[NAND_FULL_PAGE];
+	bool cacheLoaded[NAND_FULL_PAGE]; // bytes that PROGRAM EXECUTE writes
+	u8 cachePlane = 0;
+	u8 dataReg[NAND_FULL_PAGE]; // between array and cache, holds the page read ahead by PAGE READ CACHE
+	u8 dataRegEcc = 0;
+	bool dataRegValid = false;
+	u64 dataRegReadyAt = 0;
+	u8 features[4]; // 0xA0 block lock, 0xB0 config, 0xC0 status, 0xD0 die select
+	bool wel = false;
+	u64 busyUntil = 0;
+	u8 pendingStatus = 0; // P_FAIL/E_FAIL/ECC bits that become visible once the operation finishes
+	u32 powerLossCountdown = 0;
+
+	bool selected = false;
+	std::vector<u8> cmd; // bytes received in the current transaction
+};
+
+extern NandSim *nandSim; // chip that Fckafd talks to
@@ -0,0 +1,630 @@
+/**
+ * @file test_main.cpp
+ * @brief Fckafd tests on the simulated NAND, run with pio test -e native
+ *
+ * Copyright (c) 2026 Kolibri-FC contributors
+ *
+ * This file is part of Kolibri-FC (https://github.com/bastian2001/Kolibri-FC).
+ *
+ * Kolibri-FC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Kolibri-FC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "nandSim.h"
+#include <unity.h>
+
+#define BLOCK_SIZE (NAND_PAGE_SIZE * NAND_PAGES_PER_BLOCK)
+
+static NandSim *sim = nullptr;
+static Fckafd *fs = nullptr;
+
+void setUp() {
+	sim = new NandSim();
+	nandSim = sim;
+	fs = new Fckafd();
+}
+
+void tearDown() {
+	delete fs;
+	delete sim;
+	fs = nullptr;
+	sim = nullptr;
+	nandSim = nullptr;
+}
+
+static u8 pattern(u32 pos, u16 fileNum) {
+	return pos * 31 + (pos >> 11) * 7 + fileNum * 13;
+}
+
+// mounts a fresh Fckafd instance, as after a reboot
+static bool remount() {
+	delete fs;
+	fs = new Fckafd();
+	bool fsReady = false;
+	TEST_ASSERT_TRUE(fs->begin(0, 0, 0, fsReady));
+	return fsReady;
+}
+
+static void formatAndMount() {
+	TEST_ASSERT_FALSE(remount());
+	TEST_ASSERT_TRUE(fs->format(0));
+	TEST_ASSERT_TRUE(remount());
+}
+
+static void writeFile(u16 num, u32 size, u32 chunk = 512) {
+	FlashFile f = fs->open(num, O_WRITE | O_CREAT);
+	TEST_ASSERT_TRUE(f);
+	u8 buf[4096];
+	for (u32 pos = 0; pos < size;) {
+		u32 len = size - pos < chunk ? size - pos : chunk;
+		for (u32 i = 0; i < len; i++) buf[i] = pattern(pos + i, num);
+		TEST_ASSERT_EQUAL_UINT32(len, f.write(buf, len));
+		pos += len;
+	}
+	f.close();
+}
+
+static void checkFile(u16 num, u32 size) {
+	FlashFile f = fs->open(num);
+	TEST_ASSERT_TRUE(f);
+	TEST_ASSERT_EQUAL_UINT32(size, f.size());
+	u8 buf[3000]; // not a multiple of the page size, reads cross page and block boundaries
+	for (u32 pos = 0; pos < size;) {
+		i32 len = f.read(buf, sizeof(buf));
+		TEST_ASSERT_GREATER_THAN_INT32(0, len);
+		for (i32 i = 0; i < len; i++)
+			if (buf[i] != pattern(pos + i, num)) TEST_FAIL_MESSAGE("data mismatch");
+		pos += len;
+	}
+	TEST_ASSERT_EQUAL_INT(0, f.available());
+}
+
+//==============================BASICS====================================//
+void test_blank_chip_needs_format() {
+	TEST_ASSERT_FALSE(remount());
+	TEST_ASSERT_FALSE(fs->otherVersion); // nothing to keep, formatted right away
+	TEST_ASSERT_EQUAL_UINT32(NAND_PAGE_SIZE, fs->pageSize);
+	TEST_ASSERT_EQUAL_UINT32(256, fs->blockCount);
+	TEST_ASSERT_TRUE(fs->format(0));
+	TEST_ASSERT_TRUE(remount());
+	TEST_ASSERT_EQUAL_UINT16(0, fs->getFileCount());
+	TEST_ASSERT_EQUAL_UINT16(0, fs->getNewBbFileNum());
+	TEST_ASSERT_EQUAL_UINT32(0, sim->violations.total());
+}
+
+void test_other_version_is_kept() {
+	formatAndMount();
+	writeFile(0, 3 * BLOCK_SIZE);
+	// file table header of an older firmware (FCKAFD 0.1.0) in the meta block
+	fs->eraseBlock(0);
+	const u8 header[9] = {'F', 'C', 'K', 'A', 'F', 'D', 0, 1, 0};
+	fs->programLoad(0, 0, sizeof(header), header);
+	fs->programExecute(0, 0);
+	const u32 erases = sim->erases;
+	TEST_ASSERT_FALSE(remount());
+	TEST_ASSERT_TRUE(fs->otherVersion);
+	// mounting leaves the logs alone
+	TEST_ASSERT_EQUAL_UINT32(erases, sim->erases);
+	TEST_ASSERT_FALSE(sim->isErased(fs->firstDataBlock));
+	// only a requested format replaces it
+	TEST_ASSERT_TRUE(fs->format(0));
+	TEST_ASSERT_FALSE(fs->otherVersion);
+	TEST_ASSERT_TRUE(remount());
+	TEST_ASSERT_EQUAL_UINT16(0, fs->getFileCount());
+	TEST_ASSERT_EQUAL_UINT32(0, sim->violations.total());
+}
+
+void test_write_read_across_blocks() {
+	formatAndMount();
+	const u32 size = 3 * BLOCK_SIZE + 12345;
+	writeFile(0, size);
+	checkFile(0, size);
+	TEST_ASSERT_TRUE(remount());
+	TEST_ASSERT_TRUE(fs->exists((u16)0));
+	checkFile(0, size);
+	TEST_ASSERT_EQUAL_UINT32(0, sim->violations.total());
+}
+
+void test_odd_write_sizes() {
+	formatAndMount();
+	writeFile(0, 100000, 1);
+	writeFile(1, 100000, 3001);
+	writeFile(2, 2 * NAND_PAGE_SIZE, NAND_PAGE_SIZE); // ends exactly on a page boundary
+	TEST_ASSERT_TRUE(remount());
+	checkFile(0, 100000);
+	checkFile(1, 100000);
+	checkFile(2, 2 * NAND_PAGE_SIZE);
+	TEST_ASSERT_EQUAL_UINT32(0, sim->violations.total());
+}
+
+void test_no_duplicate_or_parallel_files() {
+	formatAndMount();
+	FlashFile a = fs->open((u16)0, O_WRITE | O_CREAT);
+	TEST_ASSERT_TRUE(a);
+	FlashFile b = fs->open(1, O_WRITE | O_CREAT);
+	TEST_ASSERT_FALSE(b); // only one file can be written at a time
+	a.close();
+	FlashFile c = fs->open((u16)0, O_WRITE | O_CREAT);
+	TEST_ASSERT_FALSE(c); // exists already
+	FlashFile d = fs->open((u16)5);
+	TEST_ASSERT_FALSE(d);
+}
+
+void test_seek() {
+	formatAndMount();
+	const u32 size = 2 * BLOCK_SIZE + 5000;
+	writeFile(0, size);
+	FlashFile f = fs->open((u16)0);
+	const u32 positions[] = {0, 1, NAND_PAGE_SIZE - 1, NAND_PAGE_SIZE, BLOCK_SIZE - 2, BLOCK_SIZE, 2 * BLOCK_SIZE + 4999, 777};
+	for (u32 pos : positions) {
+		TEST_ASSERT_TRUE(f.seek(pos));
+		TEST_ASSERT_EQUAL_UINT32(pos, f.position());
+		TEST_ASSERT_EQUAL_INT(pattern(pos, 0), f.peek());
+		TEST_ASSERT_EQUAL_INT(pattern(pos, 0), f.read());
+		u8 buf[10];
+		i32 len = f.read(buf, 10);
+		TEST_ASSERT_EQUAL_INT32(size - pos - 1 < 10 ? size - pos - 1 : 10, len);
+		for (i32 i = 0; i < len; i++) TEST_ASSERT_EQUAL_UINT8(pattern(pos + 1 + i, 0), buf[i]);
+	}
+	TEST_ASSERT_TRUE(f.seek(size));
+	TEST_ASSERT_EQUAL_INT(-1, f.read());
+	TEST_ASSERT_FALSE(f.seek(size + 1));
+}
+
+void test_correction_mode() {
+	formatAndMount();
+	const u32 size = BLOCK_SIZE + 150;
+	FlashFile f = fs->open((u16)0, O_WRITE | O_CREAT);
+	u8 buf[512];
+	for (u32 pos = 0; pos < size; pos += 100) {
+		const u32 len = size - pos < 100 ? size - pos : 100;
+		for (u32 i = 0; i < len; i++) buf[i] = pattern(pos + i, 0);
+		f.write(buf, len);
+	}
+	// seeking back flushes the file, only FLASH_CORRECTION_BYTES bytes can be replaced afterwards
+	TEST_ASSERT_TRUE(f.seek(10));
+	TEST_ASSERT_EQUAL_INT(FLASH_CORRECTION_BYTES, f.availableForWrite());
+	const u8 header[4] = {0xDE, 0xAD, 0xBE, 0xEF};
+	TEST_ASSERT_EQUAL_UINT32(4, f.write(header, 4));
+	TEST_ASSERT_TRUE(f.seek(BLOCK_SIZE + 50));
+	TEST_ASSERT_EQUAL_UINT32(1, f.write((u8)0x42));
+	TEST_ASSERT_EQUAL_INT(FLASH_CORRECTION_BYTES - 5, f.availableForWrite());
+	u8 many[FLASH_CORRECTION_BYTES];
+	memset(many, 0, sizeof(many));
+	TEST_ASSERT_TRUE(f.seek(1000));
+	TEST_ASSERT_EQUAL_UINT32(FLASH_CORRECTION_BYTES - 5, f.write(many, sizeof(many)));
+	f.close();
+
+	TEST_ASSERT_TRUE(remount());
+	FlashFile r = fs->open((u16)0);
+	TEST_ASSERT_EQUAL_UINT32(size, r.size());
+	u8 data[BLOCK_SIZE + 150];
+	TEST_ASSERT_EQUAL_INT32(size, r.read(data, size));
+	for (u32 i = 0; i < size; i++) {
+		u8 expected = pattern(i, 0);
+		if (i >= 10 && i < 14) expected = header[i - 10];
+		if (i == BLOCK_SIZE + 50) expected = 0x42;
+		if (i >= 1000 && i < 1000 + FLASH_CORRECTION_BYTES - 5) expected = 0;
+		if (data[i] != expected) TEST_FAIL_MESSAGE("correction byte mismatch");
+	}
+	TEST_ASSERT_TRUE(r.seek(11));
+	TEST_ASSERT_EQUAL_INT(0xAD, r.read());
+	TEST_ASSERT_EQUAL_UINT32(0, sim->violations.total());
+}
+
+void test_remove_and_reuse() {
+	formatAndMount();
+	writeFile(0, BLOCK_SIZE);
+	writeFile(1, 3 * BLOCK_SIZE);
+	writeFile(2, BLOCK_SIZE);
+	TEST_ASSERT_TRUE(fs->remove(1));
+	TEST_ASSERT_FALSE(fs->remove(1));
+	TEST_ASSERT_TRUE(remount());
+	TEST_ASSERT_EQUAL_UINT16(2, fs->getFileCount());
+	TEST_ASSERT_FALSE(fs->exists(1));
+	TEST_ASSERT_EQUAL_UINT16(3, fs->getNewBbFileNum());
+	checkFile(0, BLOCK_SIZE);
+	checkFile(2, BLOCK_SIZE);
+
+	// fill the partition, the oldest files have to make room
+	u16 num = 3;
+	for (int i = 0; i < 40; i++, num++) {
+		fs->removeOldest(0xFFFF, 20);
+		writeFile(num, 10 * BLOCK_SIZE);
+	}
+	TEST_ASSERT_TRUE(remount());
+	checkFile(num - 1, 10 * BLOCK_SIZE);
+	checkFile(num - 2, 10 * BLOCK_SIZE);
+	TEST_ASSERT_EQUAL_UINT32(0, sim->violations.total());
+}
+
+void test_file_table_compaction() {
+	formatAndMount();
+	// every file and every tombstone takes a slot, this wraps the table several times
+	for (u16 num = 0; num < 3 * FCKAFD_MAX_SLOTS; num++) {
+		writeFile(num, 3000);
+		if (num >= 4) TEST_ASSERT_TRUE(fs->remove(num - 4));
+	}
+	TEST_ASSERT_TRUE(remount());
+	TEST_ASSERT_EQUAL_UINT16(4, fs->getFileCount());
+	for (u16 num = 3 * FCKAFD_MAX_SLOTS - 4; num < 3 * FCKAFD_MAX_SLOTS; num++)
+		checkFile(num, 3000);
+	TEST_ASSERT_EQUAL_UINT32(0, sim->violations.total());
+}
+
+//==============================READ CACHE================================//
+void test_read_cache_sequential() {
+	formatAndMount();
+	const u32 blocks = 3;
+	writeFile(0, blocks * BLOCK_SIZE);
+	TEST_ASSERT_TRUE(remount());
+	checkFile(0, blocks * BLOCK_SIZE); // 3000 byte reads, every page is loaded once
+	const u32 pages = blocks * NAND_PAGES_PER_BLOCK;
+	TEST_ASSERT_EQUAL_UINT32(pages, fs->cacheMisses);
+	TEST_ASSERT_GREATER_THAN_UINT32(0, fs->cacheHits);
+	TEST_ASSERT_TRUE(fs->readAheads >= pages - 2 * blocks); // the first pages of a block are not read ahead
+	TEST_ASSERT_EQUAL_UINT32(0, sim->violations.total());
+}
+
+void test_read_cache_small_reads() {
+	formatAndMount();
+	writeFile(0, 10000);
+	TEST_ASSERT_TRUE(remount());
+	FlashFile f = fs->open((u16)0);
+	const u32 readsBefore = sim->pageReads;
+	// scanning back and forth byte by byte, like searching for SYNC frames
+	for (int pass = 0; pass < 3; pass++) {
+		TEST_ASSERT_TRUE(f.seek(1000));
+		for (u32 pos = 1000; pos < 7000; pos++) TEST_ASSERT_EQUAL_INT(pattern(pos, 0), f.read());
+	}
+	TEST_ASSERT_TRUE(sim->pageReads - readsBefore <= 5); // pages 0-3 fit into the cache, plus page 4 read ahead
+	TEST_ASSERT_EQUAL_UINT32(0, sim->violations.total());
+}
+
+void test_read_cache_coherent() {
+	formatAndMount();
+	writeFile(0, 2 * BLOCK_SIZE);
+	TEST_ASSERT_TRUE(remount());
+	u16 first;
+	u8 buf[16];
+	FlashFile f = fs->open((u16)0);
+	TEST_ASSERT_EQUAL_INT32(16, f.read(buf, 16)); // page 0 is cached, page 1 is being read ahead
+
+	// writing another file in between ends the read ahead
+	writeFile(1, BLOCK_SIZE + 100);
+	TEST_ASSERT_TRUE(f.seek(16));
+	for (u32 pos = 16; pos < 2 * BLOCK_SIZE; pos += sizeof(buf)) {
+		f.read(buf, sizeof(buf));
+		for (u32 i = 0; i < sizeof(buf); i++)
+			if (buf[i] != pattern(pos + i, 0)) TEST_FAIL_MESSAGE("data mismatch after write");
+	}
+	checkFile(1, BLOCK_SIZE + 100);
+
+	// cached pages of an erased block are dropped
+	fs->allocateExtent(first);
+	fs->readCached(first, 0, 0, 16, buf);
+	u8 data[4] = {1, 2, 3, 4};
+	fs->eraseBlock(first);
+	fs->programLoad(first, 0, 4, data);
+	fs->programExecute(first, 0);
+	fs->readCached(first, 0, 0, 16, buf);
+	TEST_ASSERT_EQUAL_UINT8(3, buf[2]);
+	TEST_ASSERT_EQUAL_UINT8(0xFF, buf[4]);
+	TEST_ASSERT_EQUAL_UINT32(0, sim->violations.total());
+}
+
+void test_read_throughput() {
+	formatAndMount();
+	const u32 size = 20 * BLOCK_SIZE;
+	writeFile(0, size);
+	TEST_ASSERT_TRUE(remount());
+	FlashFile f = fs->open((u16)0);
+	u8 buf[1024]; // chunk of a download
+	const u64 start = sim->now;
+	for (u32 pos = 0; pos < size; pos += sizeof(buf)) f.read(buf, sizeof(buf));
+	const u64 duration = sim->now - start;
+
+	// with the page read hidden behind the transfer, only the bus limits
+	const f64 busLimit = size / (f64)NAND_PAGE_SIZE * (NAND_PAGE_SIZE + 4) * 8e9 / sim->spiHz;
+	char msg[100];
+	snprintf(msg, sizeof(msg), "%.2f MB/s, %.1f %% of the bus limit", size / (duration / 1e3), busLimit / duration * 100);
+	TEST_MESSAGE(msg);
+	TEST_ASSERT_TRUE(busLimit / duration > 0.95);
+}
+
+//==============================FAULTS====================================//
+void test_factory_bad_blocks() {
+	sim->setFactoryBad(3);
+	sim->setFactoryBad(4);
+	sim->setFactoryBad(200);
+	formatAndMount();
+	FckafdHealth h = fs->getHealth();
+	TEST_ASSERT_EQUAL_UINT16(3, h.factoryBadBlocks);
+	TEST_ASSERT_TRUE(fs->isBadBlock(3));
+	const u32 size = 5 * BLOCK_SIZE;
+	writeFile(0, size);
+	TEST_ASSERT_TRUE(remount());
+	checkFile(0, size);
+	// reformatting keeps the markers
+	TEST_ASSERT_TRUE(fs->format(0));
+	TEST_ASSERT_EQUAL_UINT16(3, fs->getHealth().factoryBadBlocks);
+	TEST_ASSERT_EQUAL_UINT32(0, sim->violations.total());
+}
+
+void test_bad_meta_block() {
+	// only block 0 is guaranteed, the file table moves to the next good block
+	sim->setFactoryBad(1);
+	formatAndMount();
+	TEST_ASSERT_TRUE(fs->isBadBlock(1));
+	TEST_ASSERT_EQUAL_UINT16(3, fs->firstDataBlock);
+	// wraps the table, so that both meta blocks are used
+	for (u16 num = 0; num < FCKAFD_MAX_SLOTS + 10; num++) {
+		writeFile(num, 3000);
+		if (num >= 4) TEST_ASSERT_TRUE(fs->remove(num - 4));
+	}
+	TEST_ASSERT_TRUE(remount());
+	TEST_ASSERT_EQUAL_UINT16(4, fs->getFileCount());
+	for (u16 num = FCKAFD_MAX_SLOTS + 6; num < FCKAFD_MAX_SLOTS + 10; num++)
+		checkFile(num, 3000);
+	TEST_ASSERT_TRUE(fs->format(0));
+	TEST_ASSERT_TRUE(remount());
+	TEST_ASSERT_EQUAL_UINT32(0, sim->violations.total());
+}
+
+void test_program_failure_remaps_block() {
+	formatAndMount();
+	u16 first;
+	fs->allocateExtent(first);
+	sim->failProgram(first + 1); // second block of the next file
+	const u32 size = 4 * BLOCK_SIZE;
+	writeFile(0, size);
+	TEST_ASSERT_EQUAL_UINT32(1, fs->programFailures);
+	TEST_ASSERT_EQUAL_UINT16(1, fs->getHealth().remappedBlocks);
+	TEST_ASSERT_NOT_EQUAL(first + 1, fs->mapBlock(first + 1));
+	checkFile(0, size);
+	TEST_ASSERT_TRUE(remount());
+	TEST_ASSERT_EQUAL_UINT16(1, fs->getHealth().remappedBlocks);
+	checkFile(0, size);
+	// the failed block carries a marker now, format() takes it out of use
+	TEST_ASSERT_TRUE(fs->format(0));
+	TEST_ASSERT_TRUE(fs->isBadBlock(first + 1));
+	TEST_ASSERT_EQUAL_UINT16(0, fs->getHealth().remappedBlocks);
+	TEST_ASSERT_EQUAL_UINT32(0, sim->violations.badBlockErase);
+}
+
+void test_erase_failure_remaps_block() {
+	formatAndMount();
+	u16 first;
+	fs->allocateExtent(first);
+	sim->failErase(first);
+	const u32 size = 2 * BLOCK_SIZE;
+	writeFile(0, size);
+	TEST_ASSERT_EQUAL_UINT32(1, fs->eraseFailures);
+	TEST_ASSERT_TRUE(remount());
+	checkFile(0, size);
+}
+
+void test_bit_flips() {
+	formatAndMount();
+	u16 first;
+	fs->allocateExtent(first);
+	writeFile(0, BLOCK_SIZE);
+	TEST_ASSERT_TRUE(remount());
+
+	// correctable: data is intact, the status register reports the corrected bits
+	sim->flipBits(first, 2, 1, 5);
+	checkFile(0, BLOCK_SIZE);
+	u8 data[16];
+	fs->getData(first, 2, 600, 16, data);
+	TEST_ASSERT_EQUAL_UINT8(0b011, (fs->getFeature() >> 4) & 0b111);
+
+	// uncorrectable: the chip reports it, the data is wrong
+	sim->flipBits(first, 3, 0, NAND_ECC_BITS + 4);
+	fs->invalidateCaches();
+	u8 page[NAND_PAGE_SIZE];
+	fs->getData(first, 3, 0, NAND_PAGE_SIZE, page);
+	TEST_ASSERT_EQUAL_UINT8(0b010, (fs->getFeature() >> 4) & 0b111);
+	u32 wrong = 0;
+	for (u32 i = 0; i < NAND_PAGE_SIZE; i++)
+		if (page[i] != pattern(3 * NAND_PAGE_SIZE + i, 0)) wrong++;
+	TEST_ASSERT_GREATER_THAN_UINT32(0, wrong);
+}
+
+//==============================POWER LOSS================================//
+/**
+ * Cuts the power at every program/erase of a sequence in turn. After each cut the filesystem has to mount and the files that were closed before have to be intact.
+ */
+static void powerLossSweep(void (*prepare)(), void (*action)(), void (*verify)()) {
+	NandSim base;
+	nandSim = &base;
+	delete sim;
+	sim = nullptr;
+	prepare();
+	const NandSim snapshot = base;
+
+	for (u32 n = 1;; n++) {
+		NandSim run = snapshot;
+		nandSim = &run;
+		TEST_ASSERT_TRUE(remount());
+		run.cutPowerAfter(n);
+		bool cut = false;
+		try {
+			action();
+		} catch (NandPowerLoss &) {
+			cut = true;
+		}
+		run.powerCycle();
+		if (!remount()) {
+			char msg[64];
+			snprintf(msg, sizeof(msg), "not mountable after power loss at operation %u", n);
+			TEST_FAIL_MESSAGE(msg);
+		}
+		verify();
+		if (!cut) break; // the whole action ran through
+	}
+	delete fs;
+	fs = nullptr;
+	nandSim = nullptr;
+}
+
+static void prepareTwoFiles() {
+	formatAndMount();
+	writeFile(0, BLOCK_SIZE + 777);
+	writeFile(1, 4000);
+}
+
+static void verifyTwoFiles() {
+	checkFile(0, BLOCK_SIZE + 777);
+	checkFile(1, 4000);
+}
+
+void test_power_loss_while_logging() {
+	powerLossSweep(prepareTwoFiles, []() { writeFile(2, BLOCK_SIZE + 5000); }, verifyTwoFiles);
+}
+
+void test_power_loss_while_removing() {
+	powerLossSweep(prepareTwoFiles, []() {
+		writeFile(2, 4000);
+		fs->remove(2);
+		fs->removeOldest(0xFFFF, 0xFFFF); // deletes everything, 0 and 1 must either survive intact or be gone
+	}, []() {
+		if (fs->exists((u16)0)) checkFile(0, BLOCK_SIZE + 777);
+		if (fs->exists(1)) checkFile(1, 4000);
+	});
+}
+
+void test_power_loss_while_compacting() {
+	powerLossSweep([]() {
+		formatAndMount();
+		for (u16 num = 0; num < 70; num++) writeFile(num, 100);
+		for (u16 num = 0; num < 48; num++) fs->remove(num); // 118 slots used
+	}, []() {
+		fs->remove(48); // no slot left for the tombstone, the table is compacted
+	}, []() {
+		TEST_ASSERT_GREATER_OR_EQUAL_UINT16(21, fs->getFileCount());
+		for (u16 num = 49; num < 70; num++) checkFile(num, 100);
+	});
+}
+
+//==============================RECOVERY==================================//
+// checks a file that was recovered after a power loss, returns its size
+static u32 checkRecoveredFile(u16 num, u32 writtenSize) {
+	FlashFile f = fs->open(num);
+	TEST_ASSERT_TRUE(f);
+	const u32 size = f.size();
+	TEST_ASSERT_TRUE(size <= writtenSize);
+	// only whole pages are lost, except for the last page of the file
+	if (size != writtenSize) TEST_ASSERT_EQUAL_UINT32(0, size % NAND_PAGE_SIZE);
+	u8 buf[3000];
+	for (u32 pos = 0; pos < size;) {
+		i32 len = f.read(buf, sizeof(buf));
+		TEST_ASSERT_GREATER_THAN_INT32(0, len);
+		for (i32 i = 0; i < len; i++)
+			if (buf[i] != pattern(pos + i, num)) TEST_FAIL_MESSAGE("data mismatch");
+		pos += len;
+	}
+	TEST_ASSERT_EQUAL_INT(0, f.available());
+	return size;
+}
+
+void test_power_loss_recovers_unclosed_file() {
+	powerLossSweep(prepareTwoFiles, []() { writeFile(2, 2 * BLOCK_SIZE + 5000); }, []() {
+		verifyTwoFiles();
+		if (fs->exists(2)) checkRecoveredFile(2, 2 * BLOCK_SIZE + 5000);
+		// the recovered file does not block new files, and its blocks are not handed out again
+		writeFile(3, BLOCK_SIZE);
+		checkFile(3, BLOCK_SIZE);
+		if (fs->exists(2)) checkRecoveredFile(2, 2 * BLOCK_SIZE + 5000);
+		TEST_ASSERT_TRUE(remount());
+		checkFile(3, BLOCK_SIZE);
+	});
+}
+
+void test_power_loss_while_closing() {
+	formatAndMount();
+	FlashFile f = fs->open((u16)0, O_WRITE | O_CREAT);
+	u8 buf[NAND_PAGE_SIZE];
+	for (u32 pos = 0; pos < 3 * NAND_PAGE_SIZE; pos += sizeof(buf)) {
+		for (u32 i = 0; i < sizeof(buf); i++) buf[i] = pattern(pos + i, 0);
+		f.write(buf, sizeof(buf));
+	}
+	// all pages are programmed, the only program left is the end of the file in its slot
+	fs->drain();
+	sim->cutPowerAfter(1);
+	bool cut = false;
+	try {
+		f.close();
+	} catch (NandPowerLoss &) {
+		cut = true;
+	}
+	TEST_ASSERT_TRUE(cut);
+	sim->powerCycle();
+	TEST_ASSERT_TRUE(remount());
+	TEST_ASSERT_EQUAL_UINT32(3 * NAND_PAGE_SIZE, checkRecoveredFile(0, 3 * NAND_PAGE_SIZE));
+
+	// compacting the table moves the recovered end into the file slot
+	for (u16 num = 1; num <= 60; num++) writeFile(num, 100);
+	for (u16 num = 1; num <= 57; num++) fs->remove(num);
+	TEST_ASSERT_EQUAL_UINT32(3 * NAND_PAGE_SIZE, checkRecoveredFile(0, 3 * NAND_PAGE_SIZE));
+	TEST_ASSERT_TRUE(remount());
+	TEST_ASSERT_EQUAL_UINT32(3 * NAND_PAGE_SIZE, checkRecoveredFile(0, 3 * NAND_PAGE_SIZE));
+	for (u16 num = 58; num <= 60; num++) checkFile(num, 100);
+	TEST_ASSERT_EQUAL_UINT32(0, sim->violations.total());
+}
+
+//==============================TIMING====================================//
+void test_throughput() {
+	formatAndMount();
+	const u32 size = 40 * BLOCK_SIZE;
+	const u64 start = sim->now;
+	writeFile(0, size);
+	const u64 duration = sim->now - start;
+
+	// the bus is busy while a page is loaded, the chip while it programs and erases, so these add up
+	const f64 pageTime = (NAND_PAGE_SIZE + 10) * 8e9 / sim->spiHz + sim->tProg + (f64)sim->tErase / NAND_PAGES_PER_BLOCK;
+	const f64 ideal = size / (f64)NAND_PAGE_SIZE * pageTime;
+	char msg[100];
+	snprintf(msg, sizeof(msg), "%.2f MB/s, %.1f %% of the chip limit", size / (duration / 1e3), ideal / duration * 100);
+	TEST_MESSAGE(msg);
+	TEST_ASSERT_TRUE(ideal / duration > 0.9);
+	TEST_ASSERT_EQUAL_UINT32(0, sim->violations.busy);
+}
+
+int main(int argc, char **argv) {
+	UNITY_BEGIN();
+	RUN_TEST(test_blank_chip_needs_format);
+	RUN_TEST(test_other_version_is_kept);
+	RUN_TEST(test_write_read_across_blocks);
+	RUN_TEST(test_odd_write_sizes);
+	RUN_TEST(test_no_duplicate_or_parallel_files);
+	RUN_TEST(test_seek);
+	RUN_TEST(test_correction_mode);
+	RUN_TEST(test_remove_and_reuse);
+	RUN_TEST(test_file_table_compaction);
+	RUN_TEST(test_read_cache_sequential);
+	RUN_TEST(test_read_cache_small_reads);
+	RUN_TEST(test_read_cache_coherent);
+	RUN_TEST(test_read_throughput);
+	RUN_TEST(test_factory_bad_blocks);
+	RUN_TEST(test_bad_meta_block);
+	RUN_TEST(test_program_failure_remaps_block);
+	RUN_TEST(test_erase_failure_remaps_block);
+	RUN_TEST(test_bit_flips);
+	RUN_TEST(test_power_loss_while_logging);
+	RUN_TEST(test_power_loss_while_removing);
+	RUN_TEST(test_power_loss_while_compacting);
+	RUN_TEST(test_power_loss_recovers_unclosed_file);
+	RUN_TEST(test_power_loss_while_closing);
+	RUN_TEST(test_throughput);
+	return UNITY_END();
+}
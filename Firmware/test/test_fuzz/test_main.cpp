@@ -0,0 +1,428 @@
+/**
+ * @file test_main.cpp
+ * @brief Replays seed frames and mutations of them through the serial parsers, plus a throughput benchmark, run with pio test -e native_fuzz (ASan and UBSan)
+ *
+ * Copyright (c) 2026 Kolibri-FC contributors
+ *
+ * This file is part of Kolibri-FC (https://github.com/bastian2001/Kolibri-FC).
+ *
+ * Kolibri-FC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Kolibri-FC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "../fuzz/fuzzTargets.h"
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+#include <vector>
+
+using std::vector;
+
+// deterministic, a failure has to show up again on the next run
+static u32 rngState = 1;
+static u32 rng() {
+	rngState ^= rngState << 13;
+	rngState ^= rngState >> 17;
+	rngState ^= rngState << 5;
+	return rngState;
+}
+
+static vector<u8> randBytes(u32 n) {
+	vector<u8> v(n);
+	for (auto &b : v) b = rng();
+	return v;
+}
+
+static void append(vector<u8> &dst, const vector<u8> &src) {
+	dst.insert(dst.end(), src.begin(), src.end());
+}
+
+static void put16(vector<u8> &v, u16 x) {
+	v.push_back(x);
+	v.push_back(x >> 8);
+}
+
+// frame builders, same as makeCorpus.py
+
+static vector<u8> mspV1(u8 cmd, const vector<u8> &payload) {
+	vector<u8> f = {'$', 'M', '<', (u8)payload.size(), cmd};
+	append(f, payload);
+	u8 x = 0;
+	for (u32 i = 3; i < f.size(); i++) x ^= f[i];
+	f.push_back(x);
+	return f;
+}
+
+static vector<u8> mspJumbo(u8 cmd, const vector<u8> &payload) {
+	vector<u8> f = {'$', 'M', '<', 255, cmd};
+	put16(f, payload.size());
+	append(f, payload);
+	u8 x = 0;
+	for (u32 i = 3; i < f.size(); i++) x ^= f[i];
+	f.push_back(x);
+	return f;
+}
+
+static vector<u8> mspV2(u16 cmd, const vector<u8> &payload) {
+	vector<u8> f = {'$', 'X', '<', 0};
+	put16(f, cmd);
+	put16(f, payload.size());
+	append(f, payload);
+	f.push_back(crc8D5(&f[3], f.size() - 3));
+	return f;
+}
+
+static vector<u8> mspV2OverV1(u16 cmd, const vector<u8> &payload) {
+	vector<u8> f = {'$', 'M', '<', (u8)(payload.size() + 6), 255, 0};
+	put16(f, cmd);
+	put16(f, payload.size());
+	append(f, payload);
+	f.push_back(crc8D5(&f[5], f.size() - 5));
+	u8 x = 0;
+	for (u32 i = 3; i < f.size(); i++) x ^= f[i];
+	f.push_back(x);
+	return f;
+}
+
+static vector<u8> crsf(u8 type, const vector<u8> &payload) {
+	vector<u8> body = {type};
+	if (type >= 0x28) {
+		body.push_back(0xC8);
+		body.push_back(0xEA);
+	}
+	append(body, payload);
+	vector<u8> f = {CRSF_SYNC_BYTE, (u8)(body.size() + 1)};
+	append(f, body);
+	f.push_back(crc8D5(body.data(), body.size()));
+	return f;
+}
+
+static vector<u8> crsfChannels(const u32 *values, u32 count, u32 bits) {
+	vector<u8> out((count * bits + 7) / 8);
+	for (u32 i = 0; i < count; i++) {
+		for (u32 b = 0; b < bits; b++) {
+			if (values[i] >> b & 1) out[(i * bits + b) / 8] |= 1 << ((i * bits + b) % 8);
+		}
+	}
+	return out;
+}
+
+// MSP V2 request split into MSP_REQ frames of at most chunk bytes
+static vector<u8> crsfMspV2(u16 cmd, const vector<u8> &payload, u32 chunk = 57) {
+	vector<u8> data = {0};
+	put16(data, cmd);
+	put16(data, payload.size());
+	append(data, payload);
+	vector<u8> out;
+	u32 pos = 0;
+	for (u8 seq = 0; pos < data.size() || !seq; seq = (seq + 1) & 0xF) {
+		u32 n = data.size() - pos < chunk ? data.size() - pos : chunk;
+		vector<u8> p = {(u8)(2 << 5 | (pos ? 0 : 0x10) | seq)};
+		p.insert(p.end(), data.begin() + pos, data.begin() + pos + n);
+		append(out, crsf(CRSF_FRAMETYPE_MSP_REQ, p));
+		pos += n;
+	}
+	return out;
+}
+
+static vector<u8> ubx(u8 cls, u8 id, const vector<u8> &payload) {
+	vector<u8> f(payload.size() + UBX_FRAME_OVERHEAD);
+	ubxBuildFrame(f.data(), cls, id, payload.data(), payload.size());
+	return f;
+}
+
+static vector<u8> fourWay(u8 cmd, u16 address, const vector<u8> &payload) {
+	vector<u8> f = {'/', cmd, (u8)(address >> 8), (u8)address, (u8)payload.size()};
+	append(f, payload);
+	u16 crc = crc16Xmodem(f.data(), f.size());
+	f.push_back(crc >> 8);
+	f.push_back(crc);
+	return f;
+}
+
+typedef struct fuzzTarget {
+	const char *name;
+	u32 (*fn)(const u8 *data, size_t size);
+	vector<vector<u8>> seeds; // each is exactly one valid frame, except for the CRSF MSP chains
+} FuzzTarget;
+
+static FuzzTarget targets[4];
+
+static void makeSeeds() {
+	targets[0] = {"msp", fuzzMspFramer, {}};
+	auto &msp = targets[0].seeds;
+	msp.push_back(mspV1(1, {}));
+	msp.push_back(mspV1(200, randBytes(16)));
+	msp.push_back(mspJumbo(70, randBytes(1024)));
+	msp.push_back(mspV2(101, {}));
+	msp.push_back(mspV2(0x4002, randBytes(300)));
+	msp.push_back(mspV2(0x4002, randBytes(MSP_MAX_PAYLOAD)));
+	msp.push_back(mspV2OverV1(0x4001, randBytes(40)));
+
+	targets[1] = {"crsf", fuzzCrsf, {}};
+	auto &cr = targets[1].seeds;
+	u32 ch[16];
+	for (auto &c : ch) c = 172 + rng() % 1640;
+	cr.push_back(crsf(0x16, crsfChannels(ch, 16, 11)));
+	for (u32 res = 0; res < 4; res++) {
+		vector<u8> p = {(u8)(res << 5 | 4)};
+		append(p, crsfChannels(ch, 12, 10 + res));
+		cr.push_back(crsf(CRSF_FRAMETYPE_SUBSET_RC_CHANNELS_PACKED, p));
+	}
+	cr.push_back(crsf(0x14, randBytes(10)));
+	cr.push_back(crsf(0x28, {}));
+	cr.push_back(crsfMspV2(101, {}));
+	cr.push_back(crsfMspV2(0x4002, randBytes(200)));
+
+	targets[2] = {"ubx", fuzzUbx, {}};
+	auto &ub = targets[2].seeds;
+	ub.push_back(ubx(UBX_CLASS_NAV, UBX_ID_NAV_PVT, randBytes(92)));
+	ub.push_back(ubx(UBX_CLASS_NAV, UBX_ID_NAV_STATUS, randBytes(16)));
+	ub.push_back(ubx(UBX_CLASS_NAV, UBX_ID_NAV_DOP, randBytes(18)));
+	vector<u8> sat = randBytes(8 + 12 * 20);
+	sat[5] = 20;
+	ub.push_back(ubx(UBX_CLASS_NAV, UBX_ID_NAV_SAT, sat));
+	ub.push_back(ubx(UBX_CLASS_MON, UBX_ID_MON_HW, randBytes(60)));
+	ub.push_back(ubx(UBX_CLASS_ACK, UBX_ID_ACK_ACK, {UBX_CLASS_CFG, UBX_ID_CFG_MSG}));
+
+	targets[3] = {"4way", fuzz4Way, {}};
+	auto &fw = targets[3].seeds;
+	fw.push_back(fourWay(0x30, 0, {0}));
+	fw.push_back(fourWay(0x37, 0, {2}));
+	fw.push_back(fourWay(0x3A, 0x1000, {0x80}));
+	fw.push_back(fourWay(0x3B, 0x1000, randBytes(256)));
+	fw.push_back(fourWay(0x3B, 0x7C00, randBytes(16)));
+}
+
+// a few rounds of what libFuzzer's default mutators do: bit flips, special values, insert, erase, copy, splice
+static void mutate(vector<u8> &d, const vector<vector<u8>> &seeds) {
+	static const u8 special[] = {0, 1, 0x7F, 0x80, 0xFF, 0xFE, '$', 'M', 'X', '<', CRSF_SYNC_BYTE, UBX_SYNC1, UBX_SYNC2, '/'};
+	const u32 rounds = 1 + rng() % 4;
+	for (u32 r = 0; r < rounds; r++) {
+		const u32 pos = d.empty() ? 0 : rng() % d.size();
+		switch (rng() % 6) {
+		case 0:
+			if (!d.empty()) d[pos] ^= 1 << (rng() % 8);
+			break;
+		case 1:
+			if (!d.empty()) d[pos] = special[rng() % sizeof(special)];
+			break;
+		case 2:
+			d.insert(d.begin() + pos, 1 + rng() % 8, (u8)rng());
+			break;
+		case 3:
+			if (!d.empty()) d.erase(d.begin() + pos, d.begin() + pos + rng() % (d.size() - pos) % 16 + 1);
+			break;
+		case 4:
+			if (!d.empty()) {
+				u32 len = rng() % (d.size() - pos) % 32 + 1;
+				vector<u8> copy(d.begin() + pos, d.begin() + pos + len);
+				d.insert(d.begin() + rng() % d.size(), copy.begin(), copy.end());
+			}
+			break;
+		default: {
+			const vector<u8> &other = seeds[rng() % seeds.size()];
+			u32 from = rng() % other.size();
+			d.insert(d.begin() + pos, other.begin() + from, other.end());
+		} break;
+		}
+	}
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_seeds_parse() {
+	for (auto &t : targets) {
+		vector<u8> all;
+		for (auto &s : t.seeds) {
+			u32 frames = t.fn(s.data(), s.size());
+			if (t.fn == fuzzCrsf) {
+				TEST_ASSERT_MESSAGE(frames >= 1, t.name);
+			} else {
+				TEST_ASSERT_EQUAL_MESSAGE(1, frames, t.name);
+			}
+			append(all, s);
+		}
+		// back to back, and with a broken copy of everything in front
+		const u32 single = t.fn(all.data(), all.size());
+		vector<u8> broken = all;
+		for (u32 i = 0; i < broken.size(); i += 7) broken[i] ^= 0x10;
+		append(broken, all);
+		TEST_ASSERT_MESSAGE(t.fn(broken.data(), broken.size()) >= single, t.name);
+	}
+}
+
+void test_mutations() {
+	const u32 iterations = 30000;
+	for (auto &t : targets) {
+		u32 frames = 0, bytes = 0;
+		for (u32 n = 0; n < iterations; n++) {
+			vector<u8> d = t.seeds[rng() % t.seeds.size()];
+			mutate(d, t.seeds);
+			frames += t.fn(d.data(), d.size());
+			bytes += d.size();
+		}
+		printf("%-5s %u inputs, %u bytes, %u frames accepted\n", t.name, iterations, bytes, frames);
+		TEST_ASSERT_MESSAGE(frames > 0, t.name); // splices keep frames intact, the rest goes through the error paths
+	}
+}
+
+void test_random_bytes() {
+	for (auto &t : targets) {
+		for (u32 n = 0; n < 2000; n++) {
+			vector<u8> d = randBytes(rng() % 4096);
+			t.fn(d.data(), d.size());
+		}
+	}
+}
+
+void test_crsf_subset_limits() {
+	u32 raw[16];
+	for (u32 i = 0; i < 16; i++) raw[i] = 1000 + i;
+	u8 first = 0, count = 0;
+	u8 payload[CRSF_MAX_PAYLOAD];
+	memset(payload, 0xFF, sizeof(payload));
+
+	// only the config byte: no channels
+	payload[0] = 0;
+	TEST_ASSERT_FALSE(crsfUnpackSubsetChannels(payload, 1, raw, &first, &count));
+	// longest frame with 10 bit: 47 channels do not fit
+	TEST_ASSERT_FALSE(crsfUnpackSubsetChannels(payload, CRSF_MAX_PAYLOAD, raw, &first, &count));
+	// 8 channels from channel 12 on
+	payload[0] = 12 | 1 << 5;
+	TEST_ASSERT_FALSE(crsfUnpackSubsetChannels(payload, 12, raw, &first, &count));
+	for (u32 i = 0; i < 16; i++) TEST_ASSERT_EQUAL(1000 + i, raw[i]);
+
+	// all 16 channels with 13 bit: 26 bytes plus 1 byte that is not a channel
+	payload[0] = 3 << 5;
+	TEST_ASSERT_TRUE(crsfUnpackSubsetChannels(payload, 28, raw, &first, &count));
+	TEST_ASSERT_EQUAL(0, first);
+	TEST_ASSERT_EQUAL(16, count);
+	for (u32 i = 0; i < 16; i++) TEST_ASSERT_EQUAL(8191, raw[i]);
+
+	// channel 0 is not touched by a subset starting at 1
+	raw[0] = 5;
+	payload[0] = 1;
+	TEST_ASSERT_TRUE(crsfUnpackSubsetChannels(payload, 6, raw, &first, &count));
+	TEST_ASSERT_EQUAL(1, first);
+	TEST_ASSERT_EQUAL(4, count);
+	TEST_ASSERT_EQUAL(5, raw[0]);
+	TEST_ASSERT_EQUAL(1023, raw[1]);
+}
+
+void test_crsf_msp_limits() {
+	CrsfMspRx rx;
+	// continuation without a start
+	const u8 cont[] = {2 << 5 | 1, 1, 2, 3};
+	TEST_ASSERT_EQUAL(CrsfMspRx::ERROR, rx.feed(cont, sizeof(cont), 0xEA));
+	// V2 request larger than the buffer
+	const u8 big[] = {2 << 5 | 0x10, 0, 0x02, 0x40, 0x01, 0x02};
+	TEST_ASSERT_EQUAL(CrsfMspRx::ERROR, rx.feed(big, sizeof(big), 0xEA));
+	// only the status byte of a V1 jumbo request
+	const u8 jumbo[] = {1 << 5 | 0x10};
+	TEST_ASSERT_EQUAL(CrsfMspRx::ERROR, rx.feed(jumbo, sizeof(jumbo), 0xEA));
+	// error flag
+	const u8 err[] = {0x80 | 2 << 5 | 0x10, 0, 1, 0, 0, 0};
+	TEST_ASSERT_EQUAL(CrsfMspRx::ERROR, rx.feed(err, sizeof(err), 0xEA));
+	// a complete one still works after all that
+	const u8 ok[] = {2 << 5 | 0x10, 0, 101, 0, 2, 0, 0xAB, 0xCD};
+	TEST_ASSERT_EQUAL(CrsfMspRx::COMPLETE, rx.feed(ok, sizeof(ok), 0xEE));
+	TEST_ASSERT_EQUAL(101, rx.cmd);
+	TEST_ASSERT_EQUAL(2, rx.payloadLen);
+	TEST_ASSERT_EQUAL_HEX8(0xCD, rx.payload[1]);
+	TEST_ASSERT_EQUAL_HEX8(0xEE, rx.srcAddr);
+}
+
+void test_msp_oversize() {
+	// lengths above the buffer drop the frame, the next one is parsed normally
+	vector<u8> d = {'$', 'M', '<', 255, 70, 0xFF, 0xFF};
+	append(d, randBytes(100));
+	append(d, {'$', 'X', '<', 0, 101, 0, 0x01, 0x08});
+	append(d, randBytes(100));
+	append(d, mspV2(101, {1, 2, 3}));
+	TEST_ASSERT_EQUAL(1, fuzzMspFramer(d.data(), d.size()));
+
+	MspFramer framer;
+	vector<u8> f = mspV1(1, {});
+	f.back() ^= 1;
+	MspFramer::Result res = MspFramer::NONE;
+	for (u8 c : f) res = framer.handleByte(c);
+	TEST_ASSERT_EQUAL(MspFramer::ERROR_CRC_V1, res);
+}
+
+void test_4way_limits() {
+	// length 0 means 256
+	vector<u8> f = fourWay(0x3B, 0x1000, randBytes(256));
+	TEST_ASSERT_EQUAL(0, f[4]);
+	Parser4Way parser;
+	Parser4Way::Result res = Parser4Way::NONE;
+	for (u8 c : f) res = parser.feed(c);
+	TEST_ASSERT_EQUAL(Parser4Way::FRAME, res);
+	TEST_ASSERT_EQUAL(256, parser.len);
+	TEST_ASSERT_EQUAL_HEX8(f[5 + 255], parser.payload[255]);
+	TEST_ASSERT_EQUAL(0x1000, parser.address);
+
+	f = fourWay(0x30, 0, {0});
+	f[5] = 1;
+	for (u8 c : f) res = parser.feed(c);
+	TEST_ASSERT_EQUAL(Parser4Way::ERROR_CRC, res);
+	TEST_ASSERT_EQUAL(0x30, parser.cmd);
+}
+
+void test_ubx_schema() {
+	// NAV-SAT whose length does not match numSvs never reaches the handler
+	vector<u8> sat = randBytes(8 + 12 * 3);
+	sat[5] = 4;
+	vector<u8> f = ubx(UBX_CLASS_NAV, UBX_ID_NAV_SAT, sat);
+	TEST_ASSERT_EQUAL(1, fuzzUbx(f.data(), f.size())); // FUZZ_CHECK in the handler would abort
+	TEST_ASSERT_EQUAL(UbxDispatch::BAD_LENGTH, ubxDispatch(fuzzUbxMessages, sizeof(fuzzUbxMessages) / sizeof(fuzzUbxMessages[0]), UBX_CLASS_NAV, UBX_ID_NAV_SAT, &f[6], sat.size()));
+	vector<u8> pvt = randBytes(91);
+	TEST_ASSERT_EQUAL(UbxDispatch::BAD_LENGTH, ubxDispatch(fuzzUbxMessages, sizeof(fuzzUbxMessages) / sizeof(fuzzUbxMessages[0]), UBX_CLASS_NAV, UBX_ID_NAV_PVT, pvt.data(), pvt.size()));
+}
+
+void test_throughput() {
+	using clk = std::chrono::steady_clock;
+	for (auto &t : targets) {
+		vector<u8> stream;
+		while (stream.size() < (1 << 20)) {
+			append(stream, t.seeds[rng() % t.seeds.size()]);
+			append(stream, randBytes(rng() % 8)); // a little noise between frames
+		}
+		u32 frames = 0;
+		auto t0 = clk::now();
+		for (int n = 0; n < 4; n++)
+			frames += t.fn(stream.data(), stream.size());
+		f64 s = std::chrono::duration<f64>(clk::now() - t0).count();
+		printf("%-5s %7.1f MB/s, %u frames\n", t.name, 4 * stream.size() / s / 1e6, frames);
+		TEST_ASSERT_TRUE(frames > 0);
+	}
+}
+
+int main(int argc, char **argv) {
+	fuzzInit();
+	makeSeeds();
+
+	UNITY_BEGIN();
+	RUN_TEST(test_seeds_parse);
+	RUN_TEST(test_mutations);
+	RUN_TEST(test_random_bytes);
+	RUN_TEST(test_crsf_subset_limits);
+	RUN_TEST(test_crsf_msp_limits);
+	RUN_TEST(test_msp_oversize);
+	RUN_TEST(test_4way_limits);
+	RUN_TEST(test_ubx_schema);
+	RUN_TEST(test_throughput);
+	return UNITY_END();
+}
@@ -0,0 +1,238 @@
+/**
+ * @file test_main.cpp
+ * @brief GPS time pulse timebase tests with a simulated receiver: drifting local clock, jittered pulses and message latency, run with pio test -e native_gps
+ *
+ * Copyright (c) 2026 Kolibri-FC contributors
+ *
+ * This file is part of Kolibri-FC (https://github.com/bastian2001/Kolibri-FC).
+ *
+ * Kolibri-FC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Kolibri-FC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "serialhandler/gpsTimebase.h"
+#include <algorithm>
+#include <stdio.h>
+#include <unity.h>
+#include <vector>
+
+using std::vector;
+
+static u32 rngState = 1;
+static u32 rng() {
+	rngState ^= rngState << 13;
+	rngState ^= rngState >> 17;
+	rngState ^= rngState << 5;
+	return rngState;
+}
+
+/// @brief receiver and FC clock model, all times in true GPS microseconds since the start of the simulation
+typedef struct simConfig {
+	f64 driftPpm; // local timer runs this much fast
+	u32 localStart; // local timer at the start, close to the wrap to test it
+	u32 startTow; // GPS time of week at the start, in s
+	u32 rateHz; // navigation rate
+	u32 minLatencyUs, maxLatencyUs; // from the epoch to the decoded message
+	u32 pulseJitterUs; // interrupt latency of the capture
+	u32 missedPulsePercent;
+	u32 glitchPercent; // extra pulses at random times
+} SimConfig;
+
+enum EventType {
+	PULSE,
+	EPOCH,
+};
+
+typedef struct event {
+	EventType type;
+	i64 processUs; // true time at which the FC handles it
+	u32 captureLocal; // PULSE: captured local time
+	u32 iTow; // EPOCH
+	i64 epochTrueUs; // EPOCH
+	bool glitch;
+} Event;
+
+static SimConfig cfg;
+
+static u32 toLocal(i64 trueUs) {
+	return cfg.localStart + (u32)(i64)(trueUs * (1 + cfg.driftPpm * 1e-6));
+}
+
+static vector<Event> simulate(u32 seconds) {
+	vector<Event> events;
+	for (u32 s = 0; s < seconds; s++) {
+		const i64 second = (i64)s * 1000000;
+		if (rng() % 100 >= cfg.missedPulsePercent) {
+			const u32 delay = cfg.pulseJitterUs ? rng() % cfg.pulseJitterUs : 0;
+			events.push_back({PULSE, second + delay + rng() % 800, toLocal(second + delay), 0, 0, false});
+		}
+		if (rng() % 100 < cfg.glitchPercent) {
+			const i64 t = second + 100000 + rng() % 800000;
+			events.push_back({PULSE, t, toLocal(t), 0, 0, true});
+		}
+		for (u32 e = 0; e < cfg.rateHz; e++) {
+			const i64 epoch = second + (i64)e * 1000000 / cfg.rateHz;
+			const u32 latency = cfg.minLatencyUs + rng() % (cfg.maxLatencyUs - cfg.minLatencyUs);
+			const u32 iTow = ((cfg.startTow + s) * 1000 + e * 1000 / cfg.rateHz) % 604800000;
+			events.push_back({EPOCH, epoch + latency, 0, iTow, epoch, false});
+		}
+	}
+	std::stable_sort(events.begin(), events.end(), [](const Event &a, const Event &b) { return a.processUs < b.processUs; });
+	return events;
+}
+
+typedef struct result {
+	u32 epochs, matched;
+	u32 maxErrorUs; // of matched epochs
+	u32 maxTowErrorUs;
+} Result;
+
+static Result run(GpsTimebase &tb, const vector<Event> &events, i64 warmupUs = 2500000) {
+	Result r = {};
+	for (const Event &e : events) {
+		if (e.type == PULSE) {
+			tb.addPulse(e.captureLocal);
+			continue;
+		}
+		u32 epochUs;
+		const u32 rx = toLocal(e.processUs);
+		const bool ok = tb.epochTime(e.iTow, true, rx, &epochUs);
+		if (e.processUs < warmupUs) continue;
+		r.epochs++;
+		if (!ok) {
+			TEST_ASSERT_EQUAL_UINT32(rx, epochUs);
+			continue;
+		}
+		r.matched++;
+		const u32 err = abs((i32)(epochUs - toLocal(e.epochTrueUs)));
+		r.maxErrorUs = std::max(r.maxErrorUs, err);
+		u32 towMs;
+		u16 subMs;
+		TEST_ASSERT_TRUE(tb.localToTow(toLocal(e.processUs), &towMs, &subMs));
+		const i64 expectTow = ((i64)cfg.startTow * 1000000 + e.processUs) % 604800000000LL;
+		i64 towErr = ((i64)towMs * 1000 + subMs) - expectTow;
+		if (towErr > 302400000000LL) towErr -= 604800000000LL;
+		if (towErr < -302400000000LL) towErr += 604800000000LL;
+		r.maxTowErrorUs = std::max(r.maxTowErrorUs, (u32)std::min<i64>(llabs(towErr), 0xFFFFFFFF));
+	}
+	return r;
+}
+
+void setUp() {
+	rngState = 0x2468ACE1;
+	cfg = {25, 0xFFF00000, 345600, 20, 30000, 120000, 3, 0, 0};
+}
+
+void tearDown() {}
+
+void test_clean_pulses() {
+	GpsTimebase tb;
+	Result r = run(tb, simulate(60));
+	TEST_ASSERT_EQUAL_UINT32(r.epochs, r.matched);
+	TEST_ASSERT_TRUE(r.maxErrorUs <= 6);
+	TEST_ASSERT_TRUE(r.maxTowErrorUs <= 6);
+	TEST_ASSERT_EQUAL_UINT32(0, tb.rejectedPulses);
+	// drift estimate: 25 ppm fast
+	TEST_ASSERT_TRUE(abs((i32)(tb.periodQ8 >> 8) - 1000025) <= 2);
+	TEST_ASSERT_TRUE(tb.lastLatencyUs >= 30000 && tb.lastLatencyUs < 120000);
+}
+
+void test_long_latency_and_slow_rate() {
+	// 1 Hz fixes that arrive after the next pulse was already captured
+	cfg.rateHz = 1;
+	cfg.minLatencyUs = 300000;
+	cfg.maxLatencyUs = 850000;
+	cfg.driftPpm = -40;
+	GpsTimebase tb;
+	Result r = run(tb, simulate(60));
+	TEST_ASSERT_EQUAL_UINT32(r.epochs, r.matched);
+	TEST_ASSERT_TRUE(r.maxErrorUs <= 6);
+	TEST_ASSERT_TRUE(r.maxTowErrorUs <= 6);
+}
+
+void test_missed_and_glitched_pulses() {
+	cfg.missedPulsePercent = 15;
+	cfg.glitchPercent = 5;
+	cfg.pulseJitterUs = 10;
+	GpsTimebase tb;
+	Result r = run(tb, simulate(300));
+	TEST_ASSERT_GREATER_THAN_UINT32(0, tb.rejectedPulses);
+	// nearly all epochs come through, and the ones that do are right
+	TEST_ASSERT_GREATER_THAN_UINT32(r.epochs * 95 / 100, r.matched);
+	TEST_ASSERT_TRUE(r.maxErrorUs <= 20);
+	TEST_ASSERT_TRUE(r.maxTowErrorUs <= 20);
+}
+
+void test_week_rollover() {
+	cfg.startTow = 604800 - 20;
+	GpsTimebase tb;
+	Result r = run(tb, simulate(40));
+	TEST_ASSERT_EQUAL_UINT32(r.epochs, r.matched);
+	TEST_ASSERT_TRUE(r.maxTowErrorUs <= 6);
+}
+
+void test_pulse_lost() {
+	GpsTimebase tb;
+	vector<Event> events = simulate(30);
+	// no pulses from 10 s to 20 s, e.g. a loose contact
+	events.erase(std::remove_if(events.begin(), events.end(), [](const Event &e) { return e.type == PULSE && e.processUs > 10000000 && e.processUs < 20000000; }), events.end());
+	u32 matchedLate = 0, fallback = 0, recovered = 0;
+	for (const Event &e : events) {
+		if (e.type == PULSE) {
+			tb.addPulse(e.captureLocal);
+			continue;
+		}
+		u32 epochUs;
+		const u32 rx = toLocal(e.processUs);
+		const bool ok = tb.epochTime(e.iTow, true, rx, &epochUs);
+		if (e.processUs > 13600000 && e.processUs < 20000000) {
+			if (ok) matchedLate++;
+			fallback += epochUs == rx;
+			TEST_ASSERT_FALSE(tb.synced(rx));
+		}
+		if (e.processUs > 22000000) {
+			TEST_ASSERT_TRUE(ok);
+			TEST_ASSERT_TRUE(abs((i32)(epochUs - toLocal(e.epochTrueUs))) <= 6);
+			recovered++;
+		}
+	}
+	TEST_ASSERT_EQUAL_UINT32(0, matchedLate);
+	TEST_ASSERT_GREATER_THAN_UINT32(100, fallback);
+	TEST_ASSERT_GREATER_THAN_UINT32(100, recovered);
+}
+
+void test_time_not_valid() {
+	GpsTimebase tb;
+	for (const Event &e : simulate(5)) {
+		if (e.type == PULSE) {
+			tb.addPulse(e.captureLocal);
+			continue;
+		}
+		u32 epochUs;
+		const u32 rx = toLocal(e.processUs);
+		TEST_ASSERT_FALSE(tb.epochTime(e.iTow, false, rx, &epochUs));
+		TEST_ASSERT_EQUAL_UINT32(rx, epochUs);
+	}
+	TEST_ASSERT_TRUE(tb.synced(toLocal(5000000)));
+}
+
+int main(int argc, char **argv) {
+	UNITY_BEGIN();
+	RUN_TEST(test_clean_pulses);
+	RUN_TEST(test_long_latency_and_slow_rate);
+	RUN_TEST(test_missed_and_glitched_pulses);
+	RUN_TEST(test_week_rollover);
+	RUN_TEST(test_pulse_lost);
+	RUN_TEST(test_time_not_valid);
+	return UNITY_END();
+}
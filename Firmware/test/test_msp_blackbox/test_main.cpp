@@ -0,0 +1,135 @@
+/**
+ * @file test_main.cpp
+ * @brief Paging of BB_FILE_LIST and batching of BB_FILE_INFO against the frame limits of each MSP version, run with pio test -e native_msp
+ *
+ * Copyright (c) 2026 Kolibri-FC contributors
+ *
+ * This file is part of Kolibri-FC (https://github.com/bastian2001/Kolibri-FC).
+ *
+ * Kolibri-FC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Kolibri-FC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "serialhandler/mspBlackbox.h"
+#include <string.h>
+#include <unity.h>
+
+#define SUMMARY_SIZE 32 // LOG_HEAD_SUMMARY_SIZE
+
+static u32 summaryReads;
+
+// summary bytes derived from the log number, so each entry can be checked
+static bool fakeSummary(u16 logNum, u8 *out) {
+	summaryReads++;
+	for (int i = 0; i < SUMMARY_SIZE; i++) out[i] = logNum * 7 + i;
+	return true;
+}
+
+void setUp() { summaryReads = 0; }
+void tearDown() {}
+
+void test_max_response() {
+	TEST_ASSERT_EQUAL(MSP_MAX_PAYLOAD, mspMaxResponse(MspVersion::V2));
+	TEST_ASSERT_EQUAL(MSP_MAX_PAYLOAD, mspMaxResponse(MspVersion::V1_JUMBO));
+	TEST_ASSERT_EQUAL(248, mspMaxResponse(MspVersion::V2_OVER_V1));
+	TEST_ASSERT_EQUAL(254, mspMaxResponse(MspVersion::V1));
+	TEST_ASSERT_EQUAL(254, mspMaxResponse(MspVersion::V2_OVER_CRSF));
+	TEST_ASSERT_EQUAL(254, mspMaxResponse(MspVersion::V1_OVER_CRSF));
+	TEST_ASSERT_EQUAL(254, mspMaxResponse(MspVersion::V1_JUMBO_OVER_CRSF));
+}
+
+// walks all pages like a client does and checks that every file shows up exactly once, in order, with its summary
+static void checkPaging(MspVersion version, u16 total) {
+	u16 logNums[500];
+	for (int i = 0; i < total; i++) logNums[i] = 3 * i + 1;
+	const u16 maxLen = mspMaxResponse(version);
+	u8 out[MSP_MAX_PAYLOAD];
+	u16 first = 0;
+	u16 pages = 0;
+	do {
+		memset(out, 0xAA, sizeof(out));
+		u16 len = bbEncodeListPage(out, maxLen, logNums, total, first, SUMMARY_SIZE, fakeSummary);
+		TEST_ASSERT_LESS_OR_EQUAL(maxLen, len);
+		TEST_ASSERT_EQUAL(0xAA, out[len]); // nothing behind the page
+		TEST_ASSERT_EQUAL(0, (len - BB_LIST_PAGE_HEADER) % (2 + SUMMARY_SIZE));
+		TEST_ASSERT_EQUAL(total, out[0] | out[1] << 8);
+		TEST_ASSERT_EQUAL(first, out[2] | out[3] << 8);
+		u16 count = (len - BB_LIST_PAGE_HEADER) / (2 + SUMMARY_SIZE);
+		if (first < total) TEST_ASSERT_GREATER_THAN(0, count);
+		for (int i = 0; i < count; i++) {
+			const u8 *e = &out[BB_LIST_PAGE_HEADER + i * (2 + SUMMARY_SIZE)];
+			u16 num = e[0] | e[1] << 8;
+			TEST_ASSERT_EQUAL(logNums[first + i], num);
+			for (int j = 0; j < SUMMARY_SIZE; j++)
+				TEST_ASSERT_EQUAL((u8)(num * 7 + j), e[2 + j]);
+		}
+		first += count;
+		pages++;
+		if (!count) break;
+	} while (first < total);
+	TEST_ASSERT_EQUAL(total, first);
+	TEST_ASSERT_EQUAL(total, summaryReads);
+	const u16 perPage = (maxLen - BB_LIST_PAGE_HEADER) / (2 + SUMMARY_SIZE);
+	TEST_ASSERT_EQUAL(total ? (total + perPage - 1) / perPage : 1, pages);
+}
+
+void test_list_pages() {
+	const MspVersion versions[] = {MspVersion::V2, MspVersion::V2_OVER_V1, MspVersion::V2_OVER_CRSF};
+	const u16 totals[] = {0, 1, 7, 8, 60, 500};
+	for (MspVersion v : versions) {
+		for (u16 t : totals) {
+			summaryReads = 0;
+			checkPaging(v, t);
+		}
+	}
+	// 7 files per V2 over V1 frame: 4 + 7 * 34 = 242
+	u16 logNums[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+	u8 out[MSP_MAX_PAYLOAD];
+	TEST_ASSERT_EQUAL(242, bbEncodeListPage(out, 248, logNums, 8, 0, SUMMARY_SIZE, fakeSummary));
+}
+
+void test_list_past_end() {
+	u16 logNums[3] = {5, 6, 7};
+	u8 out[16];
+	TEST_ASSERT_EQUAL(BB_LIST_PAGE_HEADER, bbEncodeListPage(out, 248, logNums, 3, 9, SUMMARY_SIZE, fakeSummary));
+	TEST_ASSERT_EQUAL(3, out[0]);
+	TEST_ASSERT_EQUAL(3, out[2]); // clamped to the end
+	TEST_ASSERT_EQUAL(0, summaryReads);
+	// a limit below the header size only gets the header
+	TEST_ASSERT_EQUAL(BB_LIST_PAGE_HEADER, bbEncodeListPage(out, 2, logNums, 3, 0, SUMMARY_SIZE, fakeSummary));
+}
+
+void test_info_batch() {
+	// 15 entries with summary are 735 bytes, more than a u8 index or a V1 frame holds
+	TEST_ASSERT_EQUAL(BB_INFO_MAX_FILES, bbInfoMaxFiles(mspMaxResponse(MspVersion::V2), true, SUMMARY_SIZE));
+	TEST_ASSERT_EQUAL(BB_INFO_MAX_FILES, bbInfoMaxFiles(mspMaxResponse(MspVersion::V2), false, SUMMARY_SIZE));
+	TEST_ASSERT_EQUAL(5, bbInfoMaxFiles(mspMaxResponse(MspVersion::V2_OVER_V1), true, SUMMARY_SIZE));
+	TEST_ASSERT_EQUAL(14, bbInfoMaxFiles(mspMaxResponse(MspVersion::V2_OVER_V1), false, SUMMARY_SIZE));
+	TEST_ASSERT_EQUAL(5, bbInfoMaxFiles(mspMaxResponse(MspVersion::V2_OVER_CRSF), true, SUMMARY_SIZE));
+	const MspVersion versions[] = {MspVersion::V2, MspVersion::V1, MspVersion::V2_OVER_V1, MspVersion::V2_OVER_CRSF};
+	for (MspVersion v : versions) {
+		for (int s = 0; s < 2; s++) {
+			u16 n = bbInfoMaxFiles(mspMaxResponse(v), s, SUMMARY_SIZE);
+			TEST_ASSERT_LESS_OR_EQUAL(mspMaxResponse(v), n * (BB_INFO_ENTRY_SIZE + s * SUMMARY_SIZE));
+		}
+	}
+}
+
+int main(int argc, char **argv) {
+	UNITY_BEGIN();
+	RUN_TEST(test_max_response);
+	RUN_TEST(test_list_pages);
+	RUN_TEST(test_list_past_end);
+	RUN_TEST(test_info_batch);
+	return UNITY_END();
+}
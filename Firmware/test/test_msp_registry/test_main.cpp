@@ -0,0 +1,339 @@
+/**
+ * @file test_main.cpp
+ * @brief MSP command table checks: lookup, length and arming gates, dispatch of framed requests, introspection paging, run with pio test -e native_msp
+ *
+ * Copyright (c) 2026 Kolibri-FC contributors
+ *
+ * This file is part of Kolibri-FC (https://github.com/bastian2001/Kolibri-FC).
+ *
+ * Kolibri-FC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Kolibri-FC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "serialhandler/mspFramer.h"
+#include "serialhandler/mspRegistry.h"
+#include "utils/checksum.h"
+#include <string.h>
+#include <unity.h>
+#include <vector>
+
+using std::vector;
+
+static u32 rngState = 1;
+static u32 rng() {
+	rngState ^= rngState << 13;
+	rngState ^= rngState >> 17;
+	rngState ^= rngState << 5;
+	return rngState;
+}
+
+// stand-ins for the firmware handlers, same table, same order as in msp.cpp
+static i32 calledIndex;
+static const char *calledPayload;
+static u16 calledLen;
+static i32 handlerCalls;
+
+#define STUB_HANDLER(fn, handler, minLen, maxLen, flags, rev)   \
+	static void handler(const char *payload, u16 len) {         \
+		calledIndex = mspFindCommand(MspFn::fn);                \
+		calledPayload = payload;                                \
+		calledLen = len;                                        \
+		handlerCalls++;                                         \
+	}
+MSP_COMMAND_LIST(STUB_HANDLER)
+
+typedef void (*StubHandler)(const char *payload, u16 len);
+#define STUB_ENTRY(fn, handler, minLen, maxLen, flags, rev) handler,
+static const StubHandler stubHandlers[] = {MSP_COMMAND_LIST(STUB_ENTRY)};
+
+// the gate of processMspCmd, with the stubs
+static MspCheck dispatch(MspFn fn, u16 len, bool armed, const char *payload = "") {
+	return mspDispatch(stubHandlers, fn, len, armed, payload, len);
+}
+
+void setUp() {
+	calledIndex = -1;
+	calledPayload = nullptr;
+	calledLen = 0;
+	handlerCalls = 0;
+}
+void tearDown() {}
+
+void test_table_sorted() {
+	TEST_ASSERT_EQUAL(sizeof(stubHandlers) / sizeof(stubHandlers[0]), mspCommandCount);
+	for (u32 i = 1; i < mspCommandCount; i++)
+		TEST_ASSERT_LESS_THAN((u16)mspCommands[i].fn, (u16)mspCommands[i - 1].fn);
+}
+
+void test_descriptors() {
+	for (u32 i = 0; i < mspCommandCount; i++) {
+		const MspCommand &cmd = mspCommands[i];
+		TEST_ASSERT_LESS_OR_EQUAL(cmd.maxLen, cmd.minLen);
+		TEST_ASSERT_LESS_OR_EQUAL(MSP_MAX_PAYLOAD, cmd.maxLen);
+		TEST_ASSERT_EQUAL(0, cmd.flags & ~(MSP_CMD_ARMED | MSP_CMD_STREAM));
+		if (cmd.flags & MSP_CMD_STREAM) {
+			// pushed without a request: no payload, and it has to be fine while flying
+			TEST_ASSERT_EQUAL(0, cmd.minLen);
+			TEST_ASSERT_TRUE(cmd.flags & MSP_CMD_ARMED);
+		}
+	}
+	// only sent by the FC, or handled by the parser
+	TEST_ASSERT_EQUAL(-1, mspFindCommand(MspFn::IND_MESSAGE));
+	TEST_ASSERT_EQUAL(-1, mspFindCommand(MspFn::CRSF_GOT_MESSAGE));
+	TEST_ASSERT_EQUAL(-1, mspFindCommand(MspFn::MSP_V2_FRAME));
+	// must never run while flying
+	TEST_ASSERT_EQUAL(MspCheck::ARMED, mspCheckRequest(mspFindCommand(MspFn::REBOOT), 1, true));
+	TEST_ASSERT_EQUAL(MspCheck::ARMED, mspCheckRequest(mspFindCommand(MspFn::SERIAL_PASSTHROUGH), 5, true));
+	TEST_ASSERT_EQUAL(MspCheck::ARMED, mspCheckRequest(mspFindCommand(MspFn::SET_SERIAL_SETUP), 0, true));
+}
+
+void test_lookup() {
+	for (u32 i = 0; i < mspCommandCount; i++)
+		TEST_ASSERT_EQUAL(i, mspFindCommand(mspCommands[i].fn));
+	for (int n = 0; n < 100000; n++) {
+		MspFn fn = (MspFn)(u16)rng();
+		i32 index = mspFindCommand(fn);
+		if (index < 0) {
+			for (u32 i = 0; i < mspCommandCount; i++)
+				TEST_ASSERT_NOT_EQUAL((u16)fn, (u16)mspCommands[i].fn);
+		} else {
+			TEST_ASSERT_EQUAL((u16)fn, (u16)mspCommands[index].fn);
+		}
+	}
+}
+
+static void checkOne(u32 i, u16 len, bool armed) {
+	const MspCommand &cmd = mspCommands[i];
+	MspCheck expected = MspCheck::OK;
+	if (len < cmd.minLen)
+		expected = MspCheck::TOO_SHORT;
+	else if (len > cmd.maxLen)
+		expected = MspCheck::TOO_LONG;
+	else if (armed && !(cmd.flags & MSP_CMD_ARMED))
+		expected = MspCheck::ARMED;
+
+	setUp();
+	MspCheck check = dispatch(cmd.fn, len, armed);
+	TEST_ASSERT_EQUAL(expected, check);
+	if (check == MspCheck::OK) {
+		// the handler must be the one of this command, and never see a payload outside its bounds
+		TEST_ASSERT_EQUAL(1, handlerCalls);
+		TEST_ASSERT_EQUAL(i, calledIndex);
+		TEST_ASSERT_EQUAL(len, calledLen);
+		TEST_ASSERT_TRUE(len >= cmd.minLen && len <= cmd.maxLen);
+	} else {
+		TEST_ASSERT_EQUAL(0, handlerCalls);
+		TEST_ASSERT_GREATER_THAN(0, strlen(mspCheckMessage(check)));
+	}
+}
+
+void test_gate_all_commands() {
+	for (u32 i = 0; i < mspCommandCount; i++) {
+		const MspCommand &cmd = mspCommands[i];
+		const u16 edges[] = {0, 1, (u16)(cmd.minLen - 1), cmd.minLen, (u16)(cmd.minLen + 1), (u16)(cmd.maxLen - 1), cmd.maxLen, (u16)(cmd.maxLen + 1), 0xFFFF};
+		for (u16 len : edges) {
+			checkOne(i, len, false);
+			checkOne(i, len, true);
+		}
+		for (int n = 0; n < 1000; n++) {
+			u32 r = rng();
+			u16 len = (r & 1) ? (r >> 16) % (MSP_MAX_PAYLOAD + 16) : r >> 16;
+			checkOne(i, len, r & 2);
+		}
+	}
+}
+
+void test_unknown_commands() {
+	for (int n = 0; n < 100000; n++) {
+		u32 r = rng();
+		MspFn fn = (MspFn)(u16)r;
+		if (mspFindCommand(fn) >= 0) continue;
+		setUp();
+		TEST_ASSERT_EQUAL(MspCheck::UNKNOWN, dispatch(fn, (r >> 16) % MSP_MAX_PAYLOAD, r & 0x80000000));
+		TEST_ASSERT_EQUAL(0, handlerCalls);
+	}
+}
+
+static void put16(vector<u8> &v, u16 x) {
+	v.push_back(x);
+	v.push_back(x >> 8);
+}
+
+// request frames as the configurator sends them
+static vector<u8> mspV1(u8 cmd, const vector<u8> &payload) {
+	vector<u8> f = {'$', 'M', '<'};
+	if (payload.size() < 255) {
+		f.push_back(payload.size());
+		f.push_back(cmd);
+	} else {
+		f.push_back(255);
+		f.push_back(cmd);
+		put16(f, payload.size());
+	}
+	f.insert(f.end(), payload.begin(), payload.end());
+	u8 x = 0;
+	for (u32 i = 3; i < f.size(); i++) x ^= f[i];
+	f.push_back(x);
+	return f;
+}
+
+static vector<u8> mspV2(u16 cmd, const vector<u8> &payload) {
+	vector<u8> f = {'$', 'X', '<', 0};
+	put16(f, cmd);
+	put16(f, payload.size());
+	f.insert(f.end(), payload.begin(), payload.end());
+	f.push_back(crc8D5(&f[3], f.size() - 3));
+	return f;
+}
+
+static vector<u8> mspV2OverV1(u16 cmd, const vector<u8> &payload) {
+	vector<u8> f = {'$', 'M', '<', (u8)(payload.size() + 6), 255, 0};
+	put16(f, cmd);
+	put16(f, payload.size());
+	f.insert(f.end(), payload.begin(), payload.end());
+	f.push_back(crc8D5(&f[5], f.size() - 5));
+	u8 x = 0;
+	for (u32 i = 3; i < f.size(); i++) x ^= f[i];
+	f.push_back(x);
+	return f;
+}
+
+static vector<u8> randomRequest(MspFn *fn, vector<u8> *payload) {
+	u32 r = rng();
+	// mostly known commands, some unknown ones
+	*fn = (r & 7) ? mspCommands[(r >> 3) % mspCommandCount].fn : (MspFn)(u16)(r >> 3);
+	r = rng();
+	u32 len = (r & 3) ? r % 64 : r % 1200;
+	payload->resize(len);
+	for (auto &b : *payload) b = rng();
+	u16 fnNum = (u16)*fn;
+	switch (rng() % 3) {
+	case 0:
+		if (fnNum < 255) return mspV1(fnNum, *payload);
+		[[fallthrough]];
+	case 1:
+		return mspV2(fnNum, *payload);
+	default:
+		if (len > 248) return mspV2(fnNum, *payload);
+		return mspV2OverV1(fnNum, *payload);
+	}
+}
+
+// framer and gate like MspParser::handleByte and processMspCmd, returns the result for every request frame
+static void feed(MspFramer &framer, const vector<u8> &stream, bool armed, vector<MspCheck> *checks) {
+	for (u8 c : stream) {
+		if (framer.handleByte(c) != MspFramer::FRAME || framer.type != MspMsgType::REQUEST) continue;
+		setUp();
+		MspCheck check = dispatch(framer.fn, framer.payloadLen, armed, framer.payload);
+		if (check == MspCheck::OK) {
+			const MspCommand &cmd = mspCommands[mspFindCommand(framer.fn)];
+			TEST_ASSERT_EQUAL(1, handlerCalls);
+			TEST_ASSERT_EQUAL((u16)framer.fn, (u16)mspCommands[calledIndex].fn);
+			TEST_ASSERT_EQUAL_PTR(framer.payload, calledPayload);
+			TEST_ASSERT_EQUAL(framer.payloadLen, calledLen);
+			TEST_ASSERT_TRUE(calledLen >= cmd.minLen && calledLen <= cmd.maxLen);
+		} else {
+			TEST_ASSERT_EQUAL(0, handlerCalls);
+		}
+		if (checks) checks->push_back(check);
+	}
+}
+
+void test_replay_requests() {
+	// clean stream: every request arrives, with its payload, at its handler or gets the error of the gate
+	for (int armed = 0; armed < 2; armed++) {
+		MspFramer framer;
+		for (int n = 0; n < 3000; n++) {
+			MspFn fn;
+			vector<u8> payload;
+			vector<u8> frame = randomRequest(&fn, &payload);
+			vector<MspCheck> checks;
+			feed(framer, frame, armed, &checks);
+			TEST_ASSERT_EQUAL(1, checks.size());
+			TEST_ASSERT_EQUAL(mspCheckRequest(mspFindCommand(fn), payload.size(), armed), checks[0]);
+			if (checks[0] == MspCheck::OK) TEST_ASSERT_EQUAL_MEMORY(payload.data(), framer.payload, payload.size());
+		}
+	}
+}
+
+void test_fuzz_request_stream() {
+	// corrupted requests, garbage and truncated frames in between: handlers only ever see payloads inside their bounds
+	MspFramer framer;
+	for (int n = 0; n < 20000; n++) {
+		MspFn fn;
+		vector<u8> payload;
+		vector<u8> frame = randomRequest(&fn, &payload);
+		u32 r = rng();
+		switch (r & 7) {
+		case 0: // bit flip
+			frame[rng() % frame.size()] ^= 1 << (rng() & 7);
+			break;
+		case 1: // cut off, the next frame starts within
+			frame.resize(rng() % frame.size());
+			break;
+		case 2: // noise in front
+			for (u32 i = rng() % 16; i; i--) frame.insert(frame.begin(), (u8)rng());
+			break;
+		case 3: // lone sync bytes
+			frame.insert(frame.begin(), {'$', 'X'});
+			break;
+		}
+		feed(framer, frame, r & 8, nullptr);
+		// the line goes idle after a broken frame now and then, like MSP_RX_TIMEOUT_US in serialLoop()
+		if ((r & 0x30) == 0) framer.abort();
+	}
+}
+
+void test_command_list_paging() {
+	static u8 page[4 + MSP_COMMANDS_PER_PAGE * MSP_COMMAND_ENTRY_SIZE + 16];
+	u32 seen = 0;
+	u16 first = 0;
+	while (true) {
+		memset(page, 0xAA, sizeof(page));
+		u16 len = mspEncodeCommandList(first, page);
+		TEST_ASSERT_LESS_OR_EQUAL(4 + MSP_COMMANDS_PER_PAGE * MSP_COMMAND_ENTRY_SIZE, len);
+		TEST_ASSERT_EQUAL(0, (len - 4) % MSP_COMMAND_ENTRY_SIZE);
+		TEST_ASSERT_EQUAL(mspCommandCount, page[0] | page[1] << 8);
+		TEST_ASSERT_EQUAL(first, page[2] | page[3] << 8);
+		TEST_ASSERT_EQUAL_HEX8(0xAA, page[len]);
+		u32 entries = (len - 4) / MSP_COMMAND_ENTRY_SIZE;
+		if (!entries) break;
+		for (u32 e = 0; e < entries; e++) {
+			const u8 *p = page + 4 + e * MSP_COMMAND_ENTRY_SIZE;
+			const MspCommand &cmd = mspCommands[first + e];
+			TEST_ASSERT_EQUAL((u16)cmd.fn, p[0] | p[1] << 8);
+			TEST_ASSERT_EQUAL(cmd.minLen, p[2] | p[3] << 8);
+			TEST_ASSERT_EQUAL(cmd.maxLen, p[4] | p[5] << 8);
+			TEST_ASSERT_EQUAL(cmd.flags, p[6]);
+			TEST_ASSERT_EQUAL(cmd.rev, p[7]);
+		}
+		seen += entries;
+		first += entries;
+	}
+	TEST_ASSERT_EQUAL(mspCommandCount, seen);
+	// out of range start index: header only
+	TEST_ASSERT_EQUAL(4, mspEncodeCommandList(0xFFFF, page));
+}
+
+int main(int argc, char **argv) {
+	UNITY_BEGIN();
+	RUN_TEST(test_table_sorted);
+	RUN_TEST(test_descriptors);
+	RUN_TEST(test_lookup);
+	RUN_TEST(test_gate_all_commands);
+	RUN_TEST(test_unknown_commands);
+	RUN_TEST(test_replay_requests);
+	RUN_TEST(test_fuzz_request_stream);
+	RUN_TEST(test_command_list_paging);
+	return UNITY_END();
+}
@@ -0,0 +1,217 @@
+/**
+ * @file test_main.cpp
+ * @brief MSP stream scheduler on simulated links: rates, bandwidth cap, TX space and host timeout, run with pio test -e native_msp
+ *
+ * Copyright (c) 2026 Kolibri-FC contributors
+ *
+ * This file is part of Kolibri-FC (https://github.com/bastian2001/Kolibri-FC).
+ *
+ * Kolibri-FC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Kolibri-FC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "serialhandler/mspStream.h"
+#include <stdio.h>
+#include <unity.h>
+
+#define TX_RING 2048 // size of the KoliSerial TX ring
+#define LOOP_US 100 // serial loop period of the simulation
+#define V2_OVERHEAD 9 // $X> flag fn(2) len(2) crc
+
+static u32 rngState = 1;
+static u32 rng() {
+	rngState ^= rngState << 13;
+	rngState ^= rngState >> 17;
+	rngState ^= rngState << 5;
+	return rngState;
+}
+
+// TX ring drained by a UART at the given baud rate
+typedef struct link {
+	u32 bytesPerSec;
+	u32 reportedBps; // what the scheduler is told, 0 = bytesPerSec
+	u64 queuedUs; // queued bytes * 1e6, drained by bytesPerSec every µs
+	u32 queued() const { return (queuedUs + 999999) / 1000000; }
+} Link;
+
+typedef struct simResult {
+	u32 frames[MSP_STREAM_MAX];
+	u64 bytes;
+	u32 minFree;
+} SimResult;
+
+/**
+ * @brief Runs the scheduler like serialLoop() would
+ *
+ * @param payload payload size of each stream, indexed like the subscriptions
+ * @param pingUs host activity interval, 0 for none
+ */
+static SimResult simulate(MspStreams &s, Link &link, const u16 *payload, u32 startUs, u32 durationUs, u32 pingUs) {
+	SimResult r = {};
+	r.minFree = TX_RING;
+	u32 lastPing = startUs;
+	for (u32 t = startUs; t - startUs < durationUs; t += LOOP_US + rng() % 20) {
+		u64 drain = (u64)link.bytesPerSec * (LOOP_US + 10);
+		link.queuedUs = link.queuedUs > drain ? link.queuedUs - drain : 0;
+		if (pingUs && t - lastPing >= pingUs) {
+			s.hostSeen(t);
+			lastPing = t;
+		}
+		s.setLinkRate(link.reportedBps ? link.reportedBps : link.bytesPerSec);
+		u32 txFree = TX_RING - link.queued();
+		i32 i = s.next(t, txFree);
+		if (i < 0) continue;
+		u32 frame = payload[i] + V2_OVERHEAD;
+		TEST_ASSERT_LESS_OR_EQUAL(txFree, frame);
+		link.queuedUs += (u64)frame * 1000000;
+		s.sent(i, t, frame);
+		r.frames[i]++;
+		r.bytes += frame;
+		u32 free = TX_RING - link.queued();
+		if (free < r.minFree) r.minFree = free;
+	}
+	return r;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_set() {
+	MspStreams s;
+	const MspFn fns[] = {MspFn::GET_ROTATION, MspFn::SET_PIDS, (MspFn)0x1234, MspFn::TASK_STATUS, MspFn::GET_ROTATION, MspFn::RC, MspFn::GET_MOTOR};
+	const u16 intervals[] = {20, 20, 20, 1, 50, 0, 100};
+	u16 granted[7];
+	TEST_ASSERT_EQUAL(3, s.set(fns, intervals, 7, 0, granted));
+	TEST_ASSERT_EQUAL(20, granted[0]);
+	TEST_ASSERT_EQUAL(0, granted[1]); // not streamable
+	TEST_ASSERT_EQUAL(0, granted[2]); // unknown
+	TEST_ASSERT_EQUAL(MSP_STREAM_MIN_INTERVAL_MS, granted[3]); // too fast
+	TEST_ASSERT_EQUAL(0, granted[4]); // duplicate
+	TEST_ASSERT_EQUAL(0, granted[5]); // interval 0
+	TEST_ASSERT_EQUAL(100, granted[6]);
+
+	// table full
+	MspFn many[MSP_STREAM_MAX + 4];
+	u16 manyIntervals[MSP_STREAM_MAX + 4];
+	u16 manyGranted[MSP_STREAM_MAX + 4];
+	u8 n = 0;
+	for (u32 i = 0; i < mspCommandCount && n < MSP_STREAM_MAX + 4; i++) {
+		if (!(mspCommands[i].flags & MSP_CMD_STREAM)) continue;
+		many[n] = mspCommands[i].fn;
+		manyIntervals[n++] = 100;
+	}
+	TEST_ASSERT_EQUAL(MSP_STREAM_MAX + 4, n);
+	TEST_ASSERT_EQUAL(MSP_STREAM_MAX, s.set(many, manyIntervals, n, 0, manyGranted));
+	for (u8 i = 0; i < n; i++)
+		TEST_ASSERT_EQUAL(i < MSP_STREAM_MAX ? 100 : 0, manyGranted[i]);
+
+	// empty request ends everything
+	TEST_ASSERT_EQUAL(0, s.set(nullptr, nullptr, 0, 0, nullptr));
+	TEST_ASSERT_EQUAL(-1, s.next(1000, TX_RING));
+}
+
+void test_rates_fast_link() {
+	// USB-like link: every stream gets its rate, no slips
+	MspStreams s;
+	Link link = {.bytesPerSec = 1000000};
+	s.setLinkRate(link.bytesPerSec);
+	const MspFn fns[] = {MspFn::GET_ROTATION, MspFn::TASK_STATUS, MspFn::GET_GPS_MOTION, MspFn::GET_BARO_DATA};
+	const u16 intervals[] = {10, 200, 100, 20};
+	const u16 payload[] = {8, 600, 40, 16};
+	u16 granted[4];
+	u32 start = 0xFFF00000; // runs over the 32 bit wrap
+	s.set(fns, intervals, 4, start, granted);
+	SimResult r = simulate(s, link, payload, start, 10000000, 200000);
+	for (int i = 0; i < 4; i++) {
+		u32 expected = 10000 / intervals[i];
+		TEST_ASSERT_TRUE(r.frames[i] >= expected - 1 && r.frames[i] <= expected + 1);
+	}
+	TEST_ASSERT_EQUAL(0, s.slipped);
+	TEST_ASSERT_EQUAL(4, s.count());
+}
+
+void test_bandwidth_cap() {
+	// 115200 baud asked for 30 times what it can carry
+	MspStreams s;
+	Link link = {.bytesPerSec = 11520};
+	const MspFn fns[] = {MspFn::GET_ROTATION, MspFn::TASK_STATUS, MspFn::GET_GPS_MOTION, MspFn::GET_BARO_DATA};
+	const u16 intervals[] = {5, 5, 5, 5};
+	const u16 payload[] = {8, 600, 40, 16};
+	u16 granted[4];
+	s.setLinkRate(link.bytesPerSec);
+	s.set(fns, intervals, 4, 0, granted);
+	u32 durationUs = 20000000;
+	SimResult r = simulate(s, link, payload, 0, durationUs, 200000);
+
+	f64 share = link.bytesPerSec * MSP_STREAM_SHARE_PERCENT / 100.;
+	f64 used = r.bytes * 1e6 / durationUs;
+	printf("115200 baud: streams used %.0f B/s of %.0f B/s share, %u slipped intervals, min TX free %u\n", used, share, s.slipped, r.minFree);
+	TEST_ASSERT_TRUE(used <= share * 1.05);
+	TEST_ASSERT_TRUE(used >= share * 0.8); // the budget is used, not wasted
+	TEST_ASSERT_GREATER_THAN(0, s.slipped);
+	// TX space for requests is never taken
+	TEST_ASSERT_LESS_OR_EQUAL(r.minFree, MSP_STREAM_TX_RESERVE);
+	// no stream starves, the most overdue goes first
+	for (int i = 0; i < 4; i++)
+		TEST_ASSERT_GREATER_THAN(durationUs / 1000000, r.frames[i]);
+}
+
+void test_tx_space() {
+	// the UART is slower than the scheduler thinks, the TX buffer fills up before the token bucket runs dry
+	MspStreams s;
+	Link link = {.bytesPerSec = 20000, .reportedBps = 1000000};
+	const MspFn fns[] = {MspFn::TASK_STATUS};
+	const u16 intervals[] = {5};
+	const u16 payload[] = {1000};
+	u16 granted[1];
+	s.setLinkRate(link.reportedBps);
+	s.set(fns, intervals, 1, 0, granted);
+	SimResult r = simulate(s, link, payload, 0, 5000000, 200000);
+	TEST_ASSERT_LESS_OR_EQUAL(r.minFree, MSP_STREAM_TX_RESERVE);
+	// paced by what the UART takes, not by the interval
+	TEST_ASSERT_LESS_OR_EQUAL(5 * 20000 + TX_RING, r.bytes);
+	TEST_ASSERT_GREATER_THAN(5 * 20000 * 8 / 10, r.bytes);
+}
+
+void test_host_timeout() {
+	MspStreams s;
+	Link link = {.bytesPerSec = 1000000};
+	s.setLinkRate(link.bytesPerSec);
+	const MspFn fns[] = {MspFn::GET_ROTATION};
+	const u16 intervals[] = {10};
+	const u16 payload[] = {8};
+	u16 granted[1];
+
+	// pings keep it going
+	s.set(fns, intervals, 1, 0, granted);
+	simulate(s, link, payload, 0, 5000000, 200000);
+	TEST_ASSERT_EQUAL(1, s.count());
+	TEST_ASSERT_EQUAL(0, s.timeouts);
+
+	// host went silent: streaming stops after MSP_STREAM_TIMEOUT_US
+	s.set(fns, intervals, 1, 0, granted);
+	SimResult r = simulate(s, link, payload, 0, 3000000, 0);
+	TEST_ASSERT_EQUAL(0, s.count());
+	TEST_ASSERT_EQUAL(1, s.timeouts);
+	TEST_ASSERT_TRUE(r.frames[0] <= MSP_STREAM_TIMEOUT_US / 10000 + 1);
+}
+
+int main(int argc, char **argv) {
+	UNITY_BEGIN();
+	RUN_TEST(test_set);
+	RUN_TEST(test_rates_fast_link);
+	RUN_TEST(test_bandwidth_cap);
+	RUN_TEST(test_tx_space);
+	RUN_TEST(test_host_timeout);
+	return UNITY_END();
+}
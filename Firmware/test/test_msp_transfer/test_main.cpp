@@ -0,0 +1,257 @@
+/**
+ * @file test_main.cpp
+ * @brief Segmented MSP transfers: resume, CRC check and stepwise apply, run with pio test -e native_msp
+ *
+ * Copyright (c) 2026 Kolibri-FC contributors
+ *
+ * This file is part of Kolibri-FC (https://github.com/bastian2001/Kolibri-FC).
+ *
+ * Kolibri-FC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Kolibri-FC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "serialhandler/mspRegistry.h"
+#include "serialhandler/mspTransfer.h"
+#include "utils/checksum.h"
+#include <string.h>
+#include <unity.h>
+
+static u32 rngState = 1;
+static u32 rng() {
+	rngState ^= rngState << 13;
+	rngState ^= rngState >> 17;
+	rngState ^= rngState << 5;
+	return rngState;
+}
+
+// object 0: read and write, applied at once. Object 1: write only, applied 100 bytes per step, not while armed
+#define OBJ_LEN 5000
+static u8 objA[OBJ_LEN];
+static u32 objALen = 0;
+static u8 objB[OBJ_LEN];
+static u32 objBSteps = 0;
+
+static i32 saveA(u8 *buf, u32 bufSize) {
+	if (objALen > bufSize) return -1;
+	memcpy(buf, objA, objALen);
+	return objALen;
+}
+static i32 loadA(const u8 *data, u32 len, u32 pos) {
+	if (len && data[0] == 0xFF) return -1; // "invalid"
+	memcpy(objA, data, len);
+	objALen = len;
+	return len;
+}
+static i32 loadB(const u8 *data, u32 len, u32 pos) {
+	u32 n = len - pos < 100 ? len - pos : 100;
+	memcpy(&objB[pos], &data[pos], n);
+	objBSteps++;
+	return pos + n;
+}
+
+static const MspTransferObject objects[] = {
+	{.save = saveA, .load = loadA, .maxLen = OBJ_LEN, .flags = MSP_CMD_ARMED},
+	{.save = nullptr, .load = loadB, .maxLen = OBJ_LEN, .flags = 0},
+};
+static u8 stage[8192];
+static u8 src[OBJ_LEN];
+
+void setUp() {
+	for (auto &b : src)
+		b = rng();
+	src[0] = 0;
+	objALen = 0;
+	objBSteps = 0;
+	memset(objB, 0, sizeof(objB));
+}
+void tearDown() {}
+
+// runs finish() and loop() until the upload is done
+static MspTransferStatus applyAll(MspTransfer &t, u8 session, bool armed = false) {
+	u32 progress;
+	MspTransferStatus s;
+	for (int i = 0; i < 1000; i++) {
+		s = t.finish(session, &progress);
+		if (s != MspTransferStatus::BUSY) return s;
+		t.loop(armed);
+	}
+	return s;
+}
+
+void test_download() {
+	MspTransfer t(objects, 2, stage, sizeof(stage));
+	memcpy(objA, src, 3000);
+	objALen = 3000;
+	u8 session;
+	u32 len, crc;
+	TEST_ASSERT_EQUAL((u8)MspTransferStatus::OK, (u8)t.beginDownload(0, &session, &len, &crc));
+	TEST_ASSERT_EQUAL(3000, len);
+	TEST_ASSERT_EQUAL_HEX32(crc32(src, 3000), crc);
+
+	// the snapshot does not change with the object
+	objA[10] ^= 0xFF;
+	u8 out[3000];
+	const u8 *data;
+	u32 got;
+	// out of order and with repeats, like after lost responses
+	const u32 offsets[] = {2048, 0, 1024, 1024, 2048};
+	for (u32 off : offsets) {
+		TEST_ASSERT_EQUAL((u8)MspTransferStatus::OK, (u8)t.read(session, off, 1024, &data, &got));
+		TEST_ASSERT_EQUAL(off == 2048 ? 952 : 1024, got);
+		memcpy(&out[off], data, got);
+	}
+	TEST_ASSERT_EQUAL(0, memcmp(src, out, 3000));
+	TEST_ASSERT_EQUAL((u8)MspTransferStatus::OK, (u8)t.read(session, 3000, 1024, &data, &got));
+	TEST_ASSERT_EQUAL(0, got);
+	TEST_ASSERT_EQUAL((u8)MspTransferStatus::OFFSET, (u8)t.read(session, 3001, 1024, &data, &got));
+	TEST_ASSERT_EQUAL((u8)MspTransferStatus::NO_SESSION, (u8)t.read(session + 1, 0, 1024, &data, &got));
+
+	u32 progress;
+	TEST_ASSERT_EQUAL((u8)MspTransferStatus::OK, (u8)t.finish(session, &progress));
+	TEST_ASSERT_EQUAL((u8)MspTransferStatus::NO_SESSION, (u8)t.read(session, 0, 1024, &data, &got));
+	TEST_ASSERT_EQUAL((u8)MspTransferStatus::NOT_SUPPORTED, (u8)t.beginDownload(1, &session, &len, &crc));
+	TEST_ASSERT_EQUAL((u8)MspTransferStatus::UNKNOWN_OBJECT, (u8)t.beginDownload(2, &session, &len, &crc));
+}
+
+void test_upload_resume() {
+	MspTransfer t(objects, 2, stage, sizeof(stage));
+	u8 session;
+	TEST_ASSERT_EQUAL((u8)MspTransferStatus::OK, (u8)t.beginUpload(0, 4000, crc32(src, 4000), false, &session));
+	u32 received;
+	TEST_ASSERT_EQUAL((u8)MspTransferStatus::OK, (u8)t.write(session, 0, src, 1500, &received));
+	TEST_ASSERT_EQUAL(1500, received);
+	// gap: rejected, tells where to continue
+	TEST_ASSERT_EQUAL((u8)MspTransferStatus::OFFSET, (u8)t.write(session, 2000, &src[2000], 500, &received));
+	TEST_ASSERT_EQUAL(1500, received);
+	// interrupted, the host asks where it stands
+	TEST_ASSERT_EQUAL((u8)MspTransferStatus::OK, (u8)t.write(session, 0, nullptr, 0, &received));
+	TEST_ASSERT_EQUAL(1500, received);
+	// a repeat that overlaps: only the new part counts
+	TEST_ASSERT_EQUAL((u8)MspTransferStatus::OK, (u8)t.write(session, 1000, &src[1000], 1500, &received));
+	TEST_ASSERT_EQUAL(2500, received);
+	u32 progress;
+	TEST_ASSERT_EQUAL((u8)MspTransferStatus::INCOMPLETE, (u8)t.finish(session, &progress));
+	TEST_ASSERT_EQUAL(2500, progress);
+	TEST_ASSERT_EQUAL((u8)MspTransferStatus::TOO_LARGE, (u8)t.write(session, 2500, &src[2500], 1501, &received));
+	TEST_ASSERT_EQUAL((u8)MspTransferStatus::OK, (u8)t.write(session, 2500, &src[2500], 1500, &received));
+	TEST_ASSERT_EQUAL(0, objALen); // nothing applied before finish
+	TEST_ASSERT_EQUAL((u8)MspTransferStatus::OK, (u8)applyAll(t, session));
+	TEST_ASSERT_EQUAL(4000, objALen);
+	TEST_ASSERT_EQUAL(0, memcmp(src, objA, 4000));
+	// asking again after a lost response gives the same answer
+	TEST_ASSERT_EQUAL((u8)MspTransferStatus::OK, (u8)t.finish(session, &progress));
+	TEST_ASSERT_EQUAL(4000, progress);
+	TEST_ASSERT_EQUAL((u8)MspTransferStatus::NO_SESSION, (u8)t.write(session, 4000, src, 1, &received));
+}
+
+void test_upload_crc() {
+	MspTransfer t(objects, 2, stage, sizeof(stage));
+	u8 session;
+	t.beginUpload(0, 1000, crc32(src, 1000), false, &session);
+	u32 received, progress;
+	u8 bad[1000];
+	memcpy(bad, src, 1000);
+	bad[500] ^= 1;
+	t.write(session, 0, bad, 1000, &received);
+	TEST_ASSERT_EQUAL((u8)MspTransferStatus::CRC, (u8)t.finish(session, &progress));
+	TEST_ASSERT_EQUAL(0, objALen);
+	// starts over at 0 in the same session
+	t.write(session, 0, nullptr, 0, &received);
+	TEST_ASSERT_EQUAL(0, received);
+	t.write(session, 0, src, 1000, &received);
+	TEST_ASSERT_EQUAL((u8)MspTransferStatus::OK, (u8)applyAll(t, session));
+	TEST_ASSERT_EQUAL(1000, objALen);
+
+	// valid CRC, but the object refuses it
+	src[0] = 0xFF;
+	t.beginUpload(0, 10, crc32(src, 10), false, &session);
+	t.write(session, 0, src, 10, &received);
+	TEST_ASSERT_EQUAL((u8)MspTransferStatus::REJECTED, (u8)applyAll(t, session));
+	TEST_ASSERT_EQUAL(1000, objALen);
+}
+
+void test_apply_steps() {
+	MspTransfer t(objects, 2, stage, sizeof(stage));
+	u8 session, old;
+	TEST_ASSERT_EQUAL((u8)MspTransferStatus::ARMED, (u8)t.beginUpload(1, 1050, 0, true, &session));
+	TEST_ASSERT_EQUAL((u8)MspTransferStatus::TOO_LARGE, (u8)t.beginUpload(1, OBJ_LEN + 1, 0, false, &session));
+	TEST_ASSERT_EQUAL((u8)MspTransferStatus::OK, (u8)t.beginUpload(1, 1050, crc32(src, 1050), false, &session));
+	u32 received, progress;
+	for (u32 off = 0; off < 1050; off += 200)
+		t.write(session, off, &src[off], off + 200 > 1050 ? 1050 - off : 200, &received);
+	TEST_ASSERT_EQUAL(1050, received);
+	TEST_ASSERT_EQUAL((u8)MspTransferStatus::BUSY, (u8)t.finish(session, &progress));
+	TEST_ASSERT_EQUAL(0, progress);
+	t.loop(false);
+	TEST_ASSERT_EQUAL((u8)MspTransferStatus::BUSY, (u8)t.finish(session, &progress));
+	TEST_ASSERT_EQUAL(100, progress);
+	TEST_ASSERT_EQUAL((u8)MspTransferStatus::OK, (u8)applyAll(t, session));
+	TEST_ASSERT_EQUAL(11, objBSteps);
+	TEST_ASSERT_EQUAL(0, memcmp(src, objB, 1050));
+
+	// arming in the middle stops it
+	old = session;
+	t.beginUpload(1, 1000, crc32(src, 1000), false, &session);
+	TEST_ASSERT_NOT_EQUAL(old, session);
+	t.write(session, 0, src, 1000, &received);
+	t.finish(session, &progress);
+	t.loop(false);
+	t.loop(true);
+	TEST_ASSERT_EQUAL((u8)MspTransferStatus::REJECTED, (u8)t.finish(session, &progress));
+	TEST_ASSERT_EQUAL(100, progress);
+}
+
+void test_random_link() {
+	// lossy link: every write or its response gets lost with 30 %, the host resumes from what the FC reports
+	for (int round = 0; round < 200; round++) {
+		MspTransfer t(objects, 2, stage, sizeof(stage));
+		for (auto &b : src)
+			b = rng() & 0x7F;
+		u32 len = rng() % OBJ_LEN;
+		u8 session;
+		TEST_ASSERT_EQUAL((u8)MspTransferStatus::OK, (u8)t.beginUpload(0, len, crc32(src, len), false, &session));
+		u32 hostPos = 0, received = 0;
+		int writes = 0;
+		while (true) {
+			u32 n = 1 + rng() % 700;
+			if (hostPos + n > len) n = len - hostPos;
+			bool lostRequest = rng() % 10 < 3;
+			bool lostResponse = rng() % 10 < 3;
+			if (!lostRequest) {
+				MspTransferStatus s = t.write(session, hostPos, &src[hostPos], n, &received);
+				TEST_ASSERT_EQUAL((u8)MspTransferStatus::OK, (u8)s);
+			}
+			if (lostRequest || lostResponse) {
+				// timeout: ask where to continue
+				t.write(session, 0, nullptr, 0, &received);
+			}
+			hostPos = received;
+			TEST_ASSERT_LESS_THAN(100000, ++writes);
+			if (hostPos == len) break;
+		}
+		TEST_ASSERT_EQUAL((u8)MspTransferStatus::OK, (u8)applyAll(t, session));
+		TEST_ASSERT_EQUAL(len, objALen);
+		TEST_ASSERT_EQUAL(0, memcmp(src, objA, len));
+	}
+}
+
+int main(int argc, char **argv) {
+	crcInit();
+	UNITY_BEGIN();
+	RUN_TEST(test_download);
+	RUN_TEST(test_upload_resume);
+	RUN_TEST(test_upload_crc);
+	RUN_TEST(test_apply_steps);
+	RUN_TEST(test_random_link);
+	return UNITY_END();
+}
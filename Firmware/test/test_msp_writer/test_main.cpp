@@ -0,0 +1,396 @@
+/**
+ * @file test_main.cpp
+ * @brief In-place MSP response writer against a simulated TX ring, and a benchmark against the buffered sendMsp() path, run with pio test -e native_msp_writer
+ *
+ * Copyright (c) 2026 Kolibri-FC contributors
+ *
+ * This file is part of Kolibri-FC (https://github.com/bastian2001/Kolibri-FC).
+ *
+ * Kolibri-FC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Kolibri-FC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "serialhandler/mspWriter.h"
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+#include <vector>
+
+using std::vector;
+
+static u32 rngState = 1;
+static u32 rng() {
+	rngState ^= rngState << 13;
+	rngState ^= rngState >> 17;
+	rngState ^= rngState << 5;
+	return rngState;
+}
+
+// same ring as KoliSerial, the consumer moves the bytes to out
+class FakeRing : public MspTxTarget {
+public:
+	FakeRing(u32 size) : size(size), buf(size) {}
+	virtual void txLock() override {
+		TEST_ASSERT_FALSE(locked);
+		locked = true;
+	}
+	virtual void txUnlock() override {
+		TEST_ASSERT_TRUE(locked);
+		locked = false;
+	}
+	virtual u8 *txSpan(u32 offset, u32 *len) override {
+		TEST_ASSERT_TRUE(locked);
+		*len = 0;
+		if (offset >= size) return nullptr;
+		if (randomDrain) drain(rng() % (size / 4 + 1));
+		while (size - (head - tail) <= offset)
+			drain(1 + rng() % size);
+		u32 free = size - (head - tail) - offset;
+		u32 pos = (head + offset) & (size - 1);
+		u32 c = size - pos;
+		if (c > free) c = free;
+		*len = c;
+		return &buf[pos];
+	}
+	virtual void txPublish(u32 len) override {
+		TEST_ASSERT_TRUE(locked);
+		head += len;
+		TEST_ASSERT_LESS_OR_EQUAL(size, head - tail);
+	}
+	void drain(u32 n) {
+		while (n-- && tail != head)
+			out.push_back(buf[tail++ & (size - 1)]);
+	}
+	void drainAll() { drain(size); }
+
+	const u32 size;
+	vector<u8> buf;
+	vector<u8> out;
+	u32 head = 0, tail = 0;
+	bool locked = false;
+	bool randomDrain = true;
+};
+
+// bitwise, independent of the tables under test
+static u8 crcD5(const u8 *data, u32 len, u8 crc = 0) {
+	for (u32 i = 0; i < len; i++) {
+		crc ^= data[i];
+		for (int j = 0; j < 8; j++)
+			crc = crc & 0x80 ? (crc << 1) ^ 0xD5 : crc << 1;
+	}
+	return crc;
+}
+
+typedef struct frame {
+	MspFn fn;
+	MspMsgType type;
+	vector<u8> payload;
+} Frame;
+
+// strict V2 parser: everything in the stream has to be a valid frame
+static vector<Frame> parse(const vector<u8> &s) {
+	vector<Frame> frames;
+	size_t i = 0;
+	while (i < s.size()) {
+		TEST_ASSERT_LESS_OR_EQUAL(s.size(), i + MSP_V2_HEADER_SIZE + 1);
+		TEST_ASSERT_EQUAL('$', s[i]);
+		TEST_ASSERT_EQUAL('X', s[i + 1]);
+		TEST_ASSERT_EQUAL(0, s[i + 3]);
+		u16 len = s[i + 6] | s[i + 7] << 8;
+		TEST_ASSERT_LESS_OR_EQUAL(s.size(), i + MSP_V2_HEADER_SIZE + len + 1);
+		TEST_ASSERT_EQUAL_HEX8(crcD5(&s[i + 3], 5 + len), s[i + MSP_V2_HEADER_SIZE + len]);
+		Frame f;
+		f.fn = (MspFn)(s[i + 4] | s[i + 5] << 8);
+		f.type = (MspMsgType)s[i + 2];
+		f.payload.assign(s.begin() + i + MSP_V2_HEADER_SIZE, s.begin() + i + MSP_V2_HEADER_SIZE + len);
+		frames.push_back(f);
+		i += MSP_V2_HEADER_SIZE + len + 1;
+	}
+	return frames;
+}
+
+// writes p with a random mix of the writer calls
+static void writeMixed(MspWriter &w, const vector<u8> &p) {
+	size_t i = 0;
+	while (i < p.size()) {
+		size_t rest = p.size() - i;
+		switch (rng() % 5) {
+		case 0:
+			w.put8(p[i++]);
+			break;
+		case 1:
+			if (rest < 2) break;
+			w.put16(p[i] | p[i + 1] << 8);
+			i += 2;
+			break;
+		case 2:
+			if (rest < 4) break;
+			w.put32(p[i] | p[i + 1] << 8 | p[i + 2] << 16 | (u32)p[i + 3] << 24);
+			i += 4;
+			break;
+		case 3: {
+			u32 n = 1 + rng() % rest;
+			w.put(&p[i], n);
+			i += n;
+		} break;
+		case 4: {
+			u32 n = 1 + rng() % rest;
+			u8 *d = w.space(&n);
+			if (d == nullptr) return;
+			memcpy(d, &p[i], n);
+			w.advance(n);
+			i += n;
+		} break;
+		}
+	}
+}
+
+static vector<u8> randomPayload(u32 len) {
+	vector<u8> p(len);
+	for (auto &b : p)
+		b = rng();
+	return p;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_unknown_length() {
+	// any size that fits the ring, at any ring position
+	FakeRing ring(1024);
+	vector<Frame> sent;
+	for (int n = 0; n < 3000; n++) {
+		Frame f = {(MspFn)(rng() & 0xFFFF), rng() & 1 ? MspMsgType::RESPONSE : MspMsgType::ERROR, randomPayload(rng() % (1024 - MSP_V2_HEADER_SIZE))};
+		MspWriter w(ring, f.fn, f.type);
+		writeMixed(w, f.payload);
+		TEST_ASSERT_EQUAL(f.payload.size(), w.length());
+		TEST_ASSERT_EQUAL(f.payload.size(), w.finish());
+		sent.push_back(f);
+	}
+	ring.drainAll();
+	vector<Frame> got = parse(ring.out);
+	TEST_ASSERT_EQUAL(sent.size(), got.size());
+	for (size_t i = 0; i < sent.size(); i++) {
+		TEST_ASSERT_EQUAL((u16)sent[i].fn, (u16)got[i].fn);
+		TEST_ASSERT_EQUAL((char)sent[i].type, (char)got[i].type);
+		TEST_ASSERT_TRUE(sent[i].payload == got[i].payload);
+	}
+}
+
+void test_announced_length() {
+	// announced frames stream through a ring much smaller than themselves
+	FakeRing ring(256);
+	vector<Frame> sent;
+	for (int n = 0; n < 500; n++) {
+		Frame f = {(MspFn)(rng() & 0xFFFF), MspMsgType::RESPONSE, randomPayload(rng() % 5000)};
+		MspWriter w(ring, f.fn, f.type, f.payload.size());
+		writeMixed(w, f.payload);
+		TEST_ASSERT_EQUAL(f.payload.size(), w.finish());
+		sent.push_back(f);
+	}
+	ring.drainAll();
+	vector<Frame> got = parse(ring.out);
+	TEST_ASSERT_EQUAL(sent.size(), got.size());
+	for (size_t i = 0; i < sent.size(); i++)
+		TEST_ASSERT_TRUE(sent[i].payload == got[i].payload);
+}
+
+void test_errors_keep_stream_in_sync() {
+	FakeRing ring(512);
+	vector<u8> p = randomPayload(100);
+	{
+		// too big for the ring without a length: dropped, nothing published
+		MspWriter w(ring, MspFn::TASK_STATUS, MspMsgType::RESPONSE);
+		vector<u8> big = randomPayload(600);
+		w.put(big.data(), big.size());
+		TEST_ASSERT_TRUE(w.overflow());
+		TEST_ASSERT_EQUAL(-1, w.finish());
+		TEST_ASSERT_EQUAL(0, ring.head);
+	}
+	{
+		// announced more than written: padded with zeros
+		MspWriter w(ring, MspFn::GET_ROTATION, MspMsgType::RESPONSE, 120);
+		w.put(p.data(), p.size());
+		TEST_ASSERT_EQUAL(-1, w.finish());
+	}
+	{
+		// announced less than written: cut
+		MspWriter w(ring, MspFn::GET_ROTATION, MspMsgType::RESPONSE, 80);
+		w.put(p.data(), p.size());
+		TEST_ASSERT_TRUE(w.overflow());
+		TEST_ASSERT_EQUAL(-1, w.finish());
+	}
+	{
+		// discarded
+		MspWriter w(ring, MspFn::GET_ROTATION, MspMsgType::RESPONSE);
+		w.put(p.data(), p.size());
+		w.discard();
+	}
+	{
+		// finished by the destructor
+		MspWriter w(ring, MspFn::GET_ROTATION, MspMsgType::RESPONSE);
+		w.put(p.data(), p.size());
+	}
+	TEST_ASSERT_FALSE(ring.locked);
+	ring.drainAll();
+	vector<Frame> got = parse(ring.out);
+	TEST_ASSERT_EQUAL(3, got.size());
+	TEST_ASSERT_EQUAL(120, got[0].payload.size());
+	TEST_ASSERT_TRUE(memcmp(got[0].payload.data(), p.data(), 100) == 0);
+	for (int i = 100; i < 120; i++)
+		TEST_ASSERT_EQUAL(0, got[0].payload[i]);
+	TEST_ASSERT_EQUAL(80, got[1].payload.size());
+	TEST_ASSERT_TRUE(memcmp(got[1].payload.data(), p.data(), 80) == 0);
+	TEST_ASSERT_TRUE(got[2].payload == p);
+}
+
+void test_raw() {
+	// raw mode: payload only, at offset 0, nothing published
+	FakeRing scratch(256);
+	scratch.randomDrain = false;
+	vector<u8> p = randomPayload(200);
+	MspWriter w(scratch, MspFn::GET_ROTATION, MspMsgType::RESPONSE, -1, true);
+	writeMixed(w, p);
+	TEST_ASSERT_EQUAL(200, w.finish());
+	TEST_ASSERT_EQUAL(0, scratch.head);
+	TEST_ASSERT_TRUE(memcmp(scratch.buf.data(), p.data(), 200) == 0);
+}
+
+// ---- benchmark: the previous path, payload built in a buffer, CRC per byte, then copied into the ring like sendMsp() and KoliSerial::write() do
+
+static void ringWrite(FakeRing &r, const u8 *p, u32 len) {
+	while (len) {
+		u32 free = r.size - (r.head - r.tail);
+		if (!free) {
+			r.tail = r.head; // the UART took it
+			continue;
+		}
+		u32 pos = r.head & (r.size - 1);
+		u32 c = r.size - pos;
+		if (c > free) c = free;
+		if (c > len) c = len;
+		memcpy(&r.buf[pos], p, c);
+		r.head += c;
+		p += c;
+		len -= c;
+	}
+}
+
+static void oldSendMsp(FakeRing &r, MspFn fn, const u8 *data, u16 len) {
+	u8 header[MSP_V2_HEADER_SIZE] = {'$', 'X', '>', 0, (u8)((u16)fn & 0xFF), (u8)((u16)fn >> 8), (u8)(len & 0xFF), (u8)(len >> 8)};
+	u8 crc = crc8D5(&header[3], MSP_V2_HEADER_SIZE - 3);
+	crc = crc8D5(data, len, crc);
+	ringWrite(r, header, MSP_V2_HEADER_SIZE);
+	ringWrite(r, data, len);
+	ringWrite(r, &crc, 1);
+}
+
+#define BENCH_TASKS 35 // TASK_STATUS: 7 u32 per task
+#define BENCH_CHUNK 1024 // BB_FILE_DOWNLOAD chunk
+
+static u32 taskStats[BENCH_TASKS * 7];
+static u8 file[BENCH_CHUNK * 64];
+
+static void fileRead(u8 *dest, u32 offset, u32 len) {
+	memcpy(dest, &file[offset % sizeof(file)], len); // the flash read, same in both paths
+}
+
+void test_benchmark() {
+	for (auto &t : taskStats)
+		t = rng();
+	for (auto &b : file)
+		b = rng();
+	FakeRing ring(2048);
+	ring.randomDrain = false;
+	const int rounds = 200000;
+	using clk = std::chrono::steady_clock;
+
+	// TASK_STATUS: per-field put32() loses against filling a buffer and one sendMsp(), so the firmware keeps the buffer for small fixed replies
+	auto t0 = clk::now();
+	for (int n = 0; n < rounds; n++) {
+		static u32 buf[BENCH_TASKS * 7];
+		for (int i = 0; i < BENCH_TASKS * 7; i++)
+			buf[i] = taskStats[i] + n;
+		oldSendMsp(ring, MspFn::TASK_STATUS, (u8 *)buf, sizeof(buf));
+	}
+	auto t1 = clk::now();
+	for (int n = 0; n < rounds; n++) {
+		if (ring.size - (ring.head - ring.tail) < 1100) ring.tail = ring.head;
+		MspWriter w(ring, MspFn::TASK_STATUS, MspMsgType::RESPONSE, BENCH_TASKS * 7 * 4);
+		for (int i = 0; i < BENCH_TASKS * 7; i++)
+			w.put32(taskStats[i] + n);
+		w.finish();
+	}
+	auto t2 = clk::now();
+	f64 oldTask = std::chrono::duration<f64, std::nano>(t1 - t0).count() / rounds;
+	f64 newTask = std::chrono::duration<f64, std::nano>(t2 - t1).count() / rounds;
+
+	// BB_FILE_DOWNLOAD
+	t0 = clk::now();
+	for (int n = 0; n < rounds; n++) {
+		u8 buffer[BENCH_CHUNK + 6];
+		buffer[0] = 1;
+		buffer[1] = 0;
+		memcpy(&buffer[2], &n, 4);
+		fileRead(buffer + 6, n * BENCH_CHUNK, BENCH_CHUNK);
+		oldSendMsp(ring, MspFn::BB_FILE_DOWNLOAD, buffer, BENCH_CHUNK + 6);
+	}
+	t1 = clk::now();
+	for (int n = 0; n < rounds; n++) {
+		if (ring.size - (ring.head - ring.tail) < BENCH_CHUNK + 16) ring.tail = ring.head;
+		MspWriter w(ring, MspFn::BB_FILE_DOWNLOAD, MspMsgType::RESPONSE);
+		w.put16(1);
+		w.put32(n);
+		u32 done = 0;
+		while (done < BENCH_CHUNK) {
+			u32 len = BENCH_CHUNK - done;
+			u8 *p = w.space(&len);
+			fileRead(p, n * BENCH_CHUNK + done, len);
+			w.advance(len);
+			done += len;
+		}
+		w.finish();
+	}
+	t2 = clk::now();
+	f64 oldFile = std::chrono::duration<f64, std::nano>(t1 - t0).count() / rounds;
+	f64 newFile = std::chrono::duration<f64, std::nano>(t2 - t1).count() / rounds;
+
+	printf("TASK_STATUS (%d B):       sendMsp %6.0f ns, in place %6.0f ns, stays on sendMsp\n", BENCH_TASKS * 28, oldTask, newTask);
+	printf("BB_FILE_DOWNLOAD (%d B): sendMsp %6.0f ns, in place %6.0f ns, payload copies 2 -> 1 (+ file read)\n", BENCH_CHUNK + 6, oldFile, newFile);
+
+	// both paths produce the same bytes
+	FakeRing a(2048), b(2048);
+	a.randomDrain = b.randomDrain = false;
+	oldSendMsp(a, MspFn::TASK_STATUS, (u8 *)taskStats, sizeof(taskStats));
+	{
+		MspWriter w(b, MspFn::TASK_STATUS, MspMsgType::RESPONSE);
+		for (int i = 0; i < BENCH_TASKS * 7; i++)
+			w.put32(taskStats[i]);
+	}
+	a.drainAll();
+	b.drainAll();
+	TEST_ASSERT_TRUE(a.out == b.out);
+}
+
+int main(int argc, char **argv) {
+	crcInit();
+
+	UNITY_BEGIN();
+	RUN_TEST(test_unknown_length);
+	RUN_TEST(test_announced_length);
+	RUN_TEST(test_errors_keep_stream_in_sync);
+	RUN_TEST(test_raw);
+	RUN_TEST(test_benchmark);
+	return UNITY_END();
+}
@@ -0,0 +1,289 @@
+/**
+ * @file test_main.cpp
+ * @brief Serial protocol detection with recorded device output, replayed through a UART model at wrong baud rates and polarity, run with pio test -e native_serial_detect
+ *
+ * Copyright (c) 2026 Kolibri-FC contributors
+ *
+ * This file is part of Kolibri-FC (https://github.com/bastian2001/Kolibri-FC).
+ *
+ * Kolibri-FC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Kolibri-FC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "serialhandler/serialDetect.h"
+#include "utils/checksum.h"
+#include <string.h>
+#include <unity.h>
+#include <vector>
+
+static u32 rngState = 1;
+static u32 rng() {
+	rngState ^= rngState << 13;
+	rngState ^= rngState >> 17;
+	rngState ^= rngState << 5;
+	return rngState;
+}
+
+// ELRS receiver: RC channels, link statistics, RC channels
+static const u8 crsfStream[] = {
+	0xC8, 0x18, 0x16, 0xE0, 0x03, 0x1F, 0x2B, 0xC0, 0xC7, 0x0A, 0x56, 0x80, 0x6F, 0xE2, 0xE0, 0x03,
+	0x1F, 0xF8, 0xC0, 0x07, 0x3E, 0xF0, 0x81, 0x0F, 0x7C, 0xA1, 0xC8, 0x0C, 0x14, 0x5A, 0x5C, 0x64,
+	0x05, 0x00, 0x04, 0x03, 0x60, 0x64, 0x08, 0xCA, 0xC8, 0x18, 0x16, 0xE0, 0x03, 0x1F, 0x2B, 0xC0,
+	0xC7, 0x0A, 0x56, 0x80, 0x6F, 0xE2, 0xE0, 0x03, 0x1F, 0xF8, 0xC0, 0x07, 0x3E, 0xF0, 0x81, 0x0F,
+	0x7C, 0xA1,
+};
+// u-blox M8 in UBX mode: NAV-STATUS (3D fix), NAV-DOP
+static const u8 ubxStream[] = {
+	0xB5, 0x62, 0x01, 0x03, 0x10, 0x00, 0x00, 0xCA, 0x5B, 0x07, 0x03, 0xDD, 0x00, 0x00, 0x72, 0x14,
+	0x00, 0x00, 0xC0, 0x27, 0x09, 0x00, 0x96, 0xDE, 0xB5, 0x62, 0x01, 0x04, 0x12, 0x00, 0x00, 0xCA,
+	0x5B, 0x07, 0xB4, 0x00, 0xA0, 0x00, 0x78, 0x00, 0x5A, 0x00, 0x46, 0x00, 0x50, 0x00, 0x3C, 0x00,
+	0x3B, 0x89,
+};
+// GPS receiver in its NMEA default, one second of output
+static const char nmeaStream[] =
+	"$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*47\r\n"
+	"$GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W*6A\r\n";
+// MSP host polling: FC_VARIANT and STATUS (V1), API_VERSION (V2), ATTITUDE (V1)
+static const u8 mspStream[] = {
+	0x24, 0x4D, 0x3C, 0x00, 0x02, 0x02, 0x24, 0x4D, 0x3C, 0x00, 0x65, 0x65, 0x24, 0x58, 0x3C, 0x00,
+	0x01, 0x00, 0x00, 0x00, 0x45, 0x24, 0x4D, 0x3C, 0x00, 0x6C, 0x6C,
+};
+// Tramp answer to INIT: 5600-5950 MHz, 800 mW
+static const u8 trampStream[] = {
+	0x0F, 0x72, 0xE0, 0x15, 0x3E, 0x17, 0x20, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xDF, 0x00,
+};
+
+/**
+ * UART model: the device sends 8N1 at its baud rate with idle gaps between bursts, the receiver looks for a falling edge after an idle (high) line and samples in the middle of each bit at its own rate. Bytes with a framing error are kept, like the DMA of the RP2350 UART does.
+ */
+static std::vector<u8> uartResample(const u8 *data, u32 len, u32 txBaud, bool txInverted, u32 rxBaud, bool rxInverted, u32 gapBits = 20) {
+	std::vector<bool> bits;
+	for (u32 i = 0; i < gapBits; i++) bits.push_back(true);
+	for (u32 i = 0; i < len; i++) {
+		bits.push_back(false);
+		for (int b = 0; b < 8; b++) bits.push_back((data[i] >> b) & 1);
+		bits.push_back(true);
+	}
+	for (u32 i = 0; i < gapBits; i++) bits.push_back(true);
+
+	const double txBit = 1.0 / txBaud;
+	const double rxBit = 1.0 / rxBaud;
+	const double end = bits.size() * txBit;
+	auto level = [&](double t) {
+		size_t i = (size_t)(t / txBit);
+		bool l = i < bits.size() ? bits[i] : true;
+		return l ^ txInverted ^ rxInverted;
+	};
+
+	std::vector<u8> out;
+	const double step = rxBit / 16;
+	double t = 0;
+	bool idle = false;
+	while (t < end) {
+		if (level(t)) {
+			idle = true;
+			t += step;
+			continue;
+		}
+		if (!idle) {
+			// line stuck low (break or wrong polarity), no new start bit
+			t += step;
+			continue;
+		}
+		u8 c = 0;
+		for (int b = 0; b < 8; b++)
+			c |= level(t + rxBit * (1.5 + b)) << b;
+		out.push_back(c);
+		t += rxBit * 9.5; // middle of the stop bit
+		idle = level(t);
+	}
+	return out;
+}
+
+typedef struct device {
+	const u8 *data;
+	u32 len;
+	u32 baud;
+	bool inverted;
+	bool answersQuery; // Tramp: only sends when asked at its baud rate and polarity
+} Device;
+
+// runs the detector for up to two full probe cycles, the device sends its recording three times per step
+static SerialDetector::Protocol runDetection(SerialDetector &det, const Device &dev) {
+	u32 now = 1000;
+	det.begin(now);
+	for (int s = 0; s < 2 * SerialDetector::probeCount(); s++) {
+		const SerialProbe &p = det.probe();
+		u8 query[16];
+		u8 queryLen = det.query(query);
+		if (queryLen) {
+			// half duplex: our own query comes back first
+			det.feed(query, queryLen);
+		}
+		std::vector<u8> burst;
+		if (!dev.answersQuery || (queryLen && p.baud == dev.baud && p.inverted == dev.inverted)) {
+			for (int r = 0; r < 3; r++) burst.insert(burst.end(), dev.data, dev.data + dev.len);
+		}
+		if (burst.size()) {
+			std::vector<u8> rx = uartResample(burst.data(), burst.size(), dev.baud, dev.inverted, p.baud, p.inverted);
+			if (det.feed(rx.data(), rx.size()) != SerialDetector::NONE) return det.result();
+		}
+		now += SERIAL_DETECT_DWELL_MS;
+		TEST_ASSERT_TRUE(det.tick(now));
+	}
+	return det.result();
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_recorded_streams() {
+	struct {
+		const u8 *data;
+		u32 len;
+		SerialDetector::Protocol expected;
+	} cases[] = {
+		{crsfStream, sizeof(crsfStream), SerialDetector::CRSF},
+		{ubxStream, sizeof(ubxStream), SerialDetector::GPS},
+		{(const u8 *)nmeaStream, sizeof(nmeaStream) - 1, SerialDetector::GPS},
+		{mspStream, sizeof(mspStream), SerialDetector::MSP},
+		{trampStream, sizeof(trampStream), SerialDetector::TRAMP},
+	};
+	for (auto &c : cases) {
+		SerialDetector det;
+		det.begin(0);
+		det.feed(c.data, c.len);
+		TEST_ASSERT_EQUAL(c.expected, det.result());
+		TEST_ASSERT_EQUAL(420000, det.probe().baud);
+	}
+
+	// a single frame is not enough, except for Tramp. UBX and NMEA both count as GPS
+	SerialDetector det;
+	det.begin(0);
+	det.feed(crsfStream, 26); // RC channels only
+	det.feed(mspStream, 6); // FC_VARIANT only
+	det.feed(ubxStream, 24); // NAV-STATUS only
+	TEST_ASSERT_EQUAL(SerialDetector::NONE, det.result());
+	TEST_ASSERT_EQUAL(1, det.frames[SerialDetector::CRSF]);
+	TEST_ASSERT_EQUAL(1, det.frames[SerialDetector::MSP]);
+	TEST_ASSERT_EQUAL(1, det.frames[SerialDetector::GPS]);
+	det.feed((const u8 *)nmeaStream, 68); // GGA
+	TEST_ASSERT_EQUAL(SerialDetector::GPS, det.result());
+}
+
+void test_baud_and_inversion() {
+	Device devices[] = {
+		{crsfStream, sizeof(crsfStream), 420000, false, false},
+		{crsfStream, sizeof(crsfStream), 420000, true, false},
+		{mspStream, sizeof(mspStream), 115200, false, false},
+		{mspStream, sizeof(mspStream), 115200, true, false},
+		{mspStream, sizeof(mspStream), 230400, false, false},
+		{ubxStream, sizeof(ubxStream), 38400, false, false},
+		{ubxStream, sizeof(ubxStream), 57600, true, false},
+		{(const u8 *)nmeaStream, sizeof(nmeaStream) - 1, 9600, false, false},
+		{(const u8 *)nmeaStream, sizeof(nmeaStream) - 1, 38400, true, false},
+		{trampStream, sizeof(trampStream), 9600, false, true},
+		{trampStream, sizeof(trampStream), 9600, true, true},
+	};
+	const SerialDetector::Protocol expected[] = {
+		SerialDetector::CRSF,
+		SerialDetector::CRSF,
+		SerialDetector::MSP,
+		SerialDetector::MSP,
+		SerialDetector::MSP,
+		SerialDetector::GPS,
+		SerialDetector::GPS,
+		SerialDetector::GPS,
+		SerialDetector::GPS,
+		SerialDetector::TRAMP,
+		SerialDetector::TRAMP,
+	};
+	for (u32 i = 0; i < sizeof(devices) / sizeof(devices[0]); i++) {
+		SerialDetector det;
+		char msg[64];
+		snprintf(msg, sizeof(msg), "device %u at %u baud", i, devices[i].baud);
+		TEST_ASSERT_EQUAL_MESSAGE(expected[i], runDetection(det, devices[i]), msg);
+		TEST_ASSERT_EQUAL_MESSAGE(devices[i].baud, det.probe().baud, msg);
+		TEST_ASSERT_EQUAL_MESSAGE(devices[i].inverted, det.probe().inverted, msg);
+	}
+}
+
+void test_stays_after_detection() {
+	SerialDetector det;
+	det.begin(0);
+	det.feed(crsfStream, sizeof(crsfStream));
+	TEST_ASSERT_EQUAL(SerialDetector::CRSF, det.result());
+	TEST_ASSERT_FALSE(det.tick(10 * SERIAL_DETECT_DWELL_MS));
+	det.feed(mspStream, sizeof(mspStream));
+	TEST_ASSERT_EQUAL(SerialDetector::CRSF, det.result());
+	TEST_ASSERT_EQUAL(0, det.step());
+
+	// begin() starts over
+	det.begin(0);
+	TEST_ASSERT_EQUAL(SerialDetector::NONE, det.result());
+	TEST_ASSERT_FALSE(det.tick(SERIAL_DETECT_DWELL_MS - 1));
+	TEST_ASSERT_TRUE(det.tick(SERIAL_DETECT_DWELL_MS));
+	TEST_ASSERT_EQUAL(1, det.step());
+}
+
+void test_tramp_echo() {
+	// nothing but our own queries on a half duplex line
+	SerialDetector det;
+	det.begin(0);
+	u32 now = 0;
+	for (int s = 0; s < 2 * SerialDetector::probeCount(); s++) {
+		u8 query[16];
+		u8 len = det.query(query);
+		if (len) {
+			TEST_ASSERT_EQUAL(16, len);
+			TEST_ASSERT_EQUAL_HEX8(0x0F, query[0]);
+			TEST_ASSERT_EQUAL_HEX8('r', query[1]);
+			TEST_ASSERT_EQUAL(9600, det.probe().baud);
+			for (int i = 0; i < 4; i++) det.feed(query, len);
+		}
+		now += SERIAL_DETECT_DWELL_MS;
+		det.tick(now);
+	}
+	TEST_ASSERT_EQUAL(SerialDetector::NONE, det.result());
+}
+
+void test_noise() {
+	// random bytes and random line levels at every probe: nothing may be detected
+	SerialDetector det;
+	det.begin(0);
+	u32 now = 0;
+	u8 buf[4096];
+	for (int cycle = 0; cycle < 4; cycle++) {
+		for (int s = 0; s < SerialDetector::probeCount(); s++) {
+			for (u32 i = 0; i < sizeof(buf); i++) buf[i] = rng();
+			det.feed(buf, sizeof(buf));
+			std::vector<u8> rx = uartResample(buf, 512, 115200, false, det.probe().baud, det.probe().inverted, 3);
+			det.feed(rx.data(), rx.size());
+			now += SERIAL_DETECT_DWELL_MS;
+			det.tick(now);
+		}
+	}
+	TEST_ASSERT_EQUAL(SerialDetector::NONE, det.result());
+}
+
+int main(int argc, char **argv) {
+	crcInit();
+	UNITY_BEGIN();
+	RUN_TEST(test_recorded_streams);
+	RUN_TEST(test_baud_and_inversion);
+	RUN_TEST(test_stays_after_detection);
+	RUN_TEST(test_tramp_echo);
+	RUN_TEST(test_noise);
+	return UNITY_END();
+}
@@ -0,0 +1,452 @@
+/**
+ * @file test_main.cpp
+ * @brief UBX parser, schema and configuration sequencer tests on replayed receiver streams, run with pio test -e native_gps
+ *
+ * Copyright (c) 2026 Kolibri-FC contributors
+ *
+ * This file is part of Kolibri-FC (https://github.com/bastian2001/Kolibri-FC).
+ *
+ * Kolibri-FC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Kolibri-FC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "serialhandler/ubx.h"
+#include <string.h>
+#include <unity.h>
+#include <vector>
+
+using std::vector;
+
+// small deterministic PRNG, the streams and the corruption have to be the same on every run
+static u32 rngState = 1;
+static u32 rng() {
+	rngState ^= rngState << 13;
+	rngState ^= rngState >> 17;
+	rngState ^= rngState << 5;
+	return rngState;
+}
+
+static void put16(u8 *p, u16 v) {
+	p[0] = v;
+	p[1] = v >> 8;
+}
+
+static void put32(u8 *p, u32 v) {
+	put16(p, v);
+	put16(p + 2, v >> 16);
+}
+
+static u32 get32(const u8 *p) {
+	return p[0] | p[1] << 8 | p[2] << 16 | (u32)p[3] << 24;
+}
+
+typedef struct frame {
+	u8 cls;
+	u8 id;
+	u32 iTow; // identifies the frame after the replay
+	vector<u8> bytes;
+} Frame;
+
+static Frame makeFrame(u8 cls, u8 id, const vector<u8> &payload, u32 iTow) {
+	Frame f = {cls, id, iTow, vector<u8>(payload.size() + UBX_FRAME_OVERHEAD)};
+	ubxBuildFrame(f.bytes.data(), cls, id, payload.data(), payload.size());
+	return f;
+}
+
+// the messages of one navigation epoch as the receiver sends them after the configuration, iTOW first in every NAV message
+static void addEpoch(vector<Frame> &frames, u32 iTow, u8 numSvs) {
+	vector<u8> pvt(92);
+	put32(&pvt[0], iTow);
+	put16(&pvt[4], 2026);
+	pvt[6] = 10;
+	pvt[7] = 19;
+	pvt[8] = iTow / 3600000 % 24;
+	pvt[9] = iTow / 60000 % 60;
+	pvt[10] = iTow / 1000 % 60;
+	pvt[11] = 0x37;
+	pvt[20] = 3; // 3D fix
+	pvt[21] = 0x01;
+	pvt[23] = numSvs;
+	put32(&pvt[24], 110000000 + (rng() & 0xFFF)); // lon
+	put32(&pvt[28], 480000000 + (rng() & 0xFFF)); // lat
+	put32(&pvt[36], 520000); // alt
+	put32(&pvt[40], 1500); // hAcc
+	put32(&pvt[44], 2500); // vAcc
+	put16(&pvt[76], 120); // pDop
+	frames.push_back(makeFrame(UBX_CLASS_NAV, UBX_ID_NAV_PVT, pvt, iTow));
+
+	if (iTow % 500 == 0) {
+		vector<u8> status(16);
+		put32(&status[0], iTow);
+		status[4] = 3;
+		status[5] = 0x0D;
+		put32(&status[8], 28500); // ttff
+		put32(&status[12], iTow + 123456); // msss
+		frames.push_back(makeFrame(UBX_CLASS_NAV, UBX_ID_NAV_STATUS, status, iTow));
+
+		vector<u8> dop(18);
+		put32(&dop[0], iTow);
+		for (int i = 0; i < 7; i++) put16(&dop[4 + 2 * i], 90 + 10 * i);
+		frames.push_back(makeFrame(UBX_CLASS_NAV, UBX_ID_NAV_DOP, dop, iTow));
+	}
+	if (iTow % 1000 == 0) {
+		vector<u8> sat(8 + 12 * numSvs);
+		put32(&sat[0], iTow);
+		sat[4] = 1;
+		sat[5] = numSvs;
+		for (int i = 0; i < numSvs; i++) {
+			u8 *sv = &sat[8 + 12 * i];
+			sv[0] = i % 4 == 3 ? 6 : i % 2 * 2; // GPS, Galileo, GLONASS
+			sv[1] = i + 1;
+			sv[2] = 20 + rng() % 30;
+			sv[3] = rng() % 90;
+			put16(&sv[4], rng() % 360);
+			put32(&sv[8], 0x1F | (rng() & 0x08));
+		}
+		frames.push_back(makeFrame(UBX_CLASS_NAV, UBX_ID_NAV_SAT, sat, iTow));
+
+		vector<u8> hw(60);
+		put16(&hw[16], 87); // noisePerMS
+		put16(&hw[18], 5400); // agcCnt
+		hw[20] = 2; // antenna ok
+		hw[21] = 1;
+		hw[22] = 1 << 2; // jamming ok
+		hw[45] = 12;
+		put32(&hw[48], iTow); // pinIrq, used as the frame id here
+		frames.push_back(makeFrame(UBX_CLASS_MON, UBX_ID_MON_HW, hw, iTow));
+	}
+}
+
+static vector<Frame> makeStream(int epochs, u8 numSvs = 24) {
+	vector<Frame> frames;
+	for (int i = 0; i < epochs; i++) addEpoch(frames, 100000 + i * 100, numSvs);
+	return frames;
+}
+
+static const char nmea[] = "$GNGGA,092725.00,4717.11399,N,00833.91590,E,1,08,1.01,499.6,M,48.0,M,,*5B\r\n$GNRMC,092725.00,A,4717.11437,N,00833.91522,E,0.004,77.52,191026,,,A*57\r\n";
+
+// replay results per handler
+static vector<u32> seenPvt, seenStatus, seenDop, seenSat, seenHw;
+static u8 lastNumSvs = 0;
+
+static void onPvt(const u8 *p, u16 len) {
+	seenPvt.push_back(get32(p));
+}
+static void onStatus(const u8 *p, u16 len) {
+	seenStatus.push_back(get32(p));
+}
+static void onDop(const u8 *p, u16 len) {
+	seenDop.push_back(get32(p));
+}
+static void onSat(const u8 *p, u16 len) {
+	seenSat.push_back(get32(p));
+	lastNumSvs = p[5];
+}
+static void onHw(const u8 *p, u16 len) {
+	seenHw.push_back(get32(&p[48]));
+}
+
+static const UbxMsgSchema schema[] = {
+	{UBX_CLASS_NAV, UBX_ID_NAV_PVT, 92, 0, 0, onPvt},
+	{UBX_CLASS_NAV, UBX_ID_NAV_STATUS, 16, 0, 0, onStatus},
+	{UBX_CLASS_NAV, UBX_ID_NAV_DOP, 18, 0, 0, onDop},
+	{UBX_CLASS_NAV, UBX_ID_NAV_SAT, 8, 12, 5, onSat},
+	{UBX_CLASS_MON, UBX_ID_MON_HW, 60, 0, 0, onHw},
+};
+
+static vector<u32> &seenFor(const Frame &f) {
+	switch (f.id) {
+	case UBX_ID_NAV_PVT: return seenPvt;
+	case UBX_ID_NAV_STATUS: return seenStatus;
+	case UBX_ID_NAV_DOP: return seenDop;
+	case UBX_ID_NAV_SAT: return seenSat;
+	default: return seenHw;
+	}
+}
+
+static UbxParser *parser = nullptr;
+static u32 dispatchErrors = 0;
+
+static void handle() {
+	if (ubxDispatch(schema, sizeof(schema) / sizeof(schema[0]), parser->cls(), parser->id(), parser->payload(), parser->len()) != UbxDispatch::HANDLED)
+		dispatchErrors++;
+}
+
+// replays a byte stream in chunks of random size, as the UART delivers them
+static void replay(const vector<u8> &stream) {
+	for (size_t pos = 0; pos < stream.size();) {
+		size_t chunk = 1 + rng() % 64;
+		for (size_t i = 0; i < chunk && pos < stream.size(); i++, pos++)
+			if (parser->feed(stream[pos])) handle();
+	}
+	while (parser->poll()) handle();
+}
+
+void setUp() {
+	rngState = 0x12345678;
+	parser = new UbxParser();
+	dispatchErrors = 0;
+	seenPvt.clear();
+	seenStatus.clear();
+	seenDop.clear();
+	seenSat.clear();
+	seenHw.clear();
+	lastNumSvs = 0;
+}
+
+void tearDown() {
+	delete parser;
+	parser = nullptr;
+}
+
+void test_checksum_and_frame() {
+	// UBX-CFG-MSG disabling GxGGA, as sent by the firmware since the beginning
+	const u8 payload[] = {0xF0, 0x00, 0x00};
+	const u8 expected[] = {0xB5, 0x62, 0x06, 0x01, 0x03, 0x00, 0xF0, 0x00, 0x00, 0xFA, 0x0F};
+	u8 frame[16];
+	TEST_ASSERT_EQUAL_UINT16(sizeof(expected), ubxBuildFrame(frame, UBX_CLASS_CFG, UBX_ID_CFG_MSG, payload, 3));
+	TEST_ASSERT_TRUE(memcmp(frame, expected, sizeof(expected)) == 0);
+}
+
+void test_replay_clean_stream() {
+	vector<Frame> frames = makeStream(200);
+	vector<u8> stream(nmea, nmea + sizeof(nmea) - 1); // NMEA before the configuration disabled it
+	for (auto &f : frames) stream.insert(stream.end(), f.bytes.begin(), f.bytes.end());
+	replay(stream);
+
+	TEST_ASSERT_EQUAL_UINT32(frames.size(), parser->messages);
+	TEST_ASSERT_EQUAL_UINT32(0, parser->checksumErrors);
+	TEST_ASSERT_EQUAL_UINT32(0, parser->lengthErrors);
+	TEST_ASSERT_EQUAL_UINT32(sizeof(nmea) - 1, parser->skipped);
+	TEST_ASSERT_EQUAL_UINT32(0, dispatchErrors);
+	TEST_ASSERT_EQUAL_UINT32(200, seenPvt.size());
+	TEST_ASSERT_EQUAL_UINT32(40, seenStatus.size());
+	TEST_ASSERT_EQUAL_UINT32(40, seenDop.size());
+	TEST_ASSERT_EQUAL_UINT32(20, seenSat.size());
+	TEST_ASSERT_EQUAL_UINT32(20, seenHw.size());
+	TEST_ASSERT_EQUAL_UINT8(24, lastNumSvs);
+}
+
+void test_replay_full_sky() {
+	// 255 satellites: the largest NAV-SAT the U1 numSvs allows, has to fit into the parser
+	vector<Frame> frames = makeStream(10, 255);
+	vector<u8> stream;
+	for (auto &f : frames) stream.insert(stream.end(), f.bytes.begin(), f.bytes.end());
+	replay(stream);
+	TEST_ASSERT_EQUAL_UINT32(frames.size(), parser->messages);
+	TEST_ASSERT_EQUAL_UINT8(255, lastNumSvs);
+	TEST_ASSERT_EQUAL_UINT32(0, dispatchErrors);
+}
+
+enum Corruption {
+	FLIP_BIT,
+	DROP_BYTE,
+	INSERT_BYTE,
+	TRUNCATE,
+	BAD_LENGTH,
+	SYNC_IN_NOISE,
+	CORRUPTION_COUNT,
+};
+
+void test_replay_with_corruption() {
+	vector<Frame> frames = makeStream(1000);
+	vector<u8> stream;
+	vector<bool> intact(frames.size(), true);
+	u32 corrupted[CORRUPTION_COUNT] = {};
+	for (size_t i = 0; i < frames.size(); i++) {
+		vector<u8> bytes = frames[i].bytes;
+		if (rng() % 8 == 0) {
+			Corruption c = (Corruption)(rng() % CORRUPTION_COUNT);
+			const size_t at = rng() % bytes.size();
+			switch (c) {
+			case FLIP_BIT:
+				bytes[at] ^= 1 << (rng() % 8);
+				break;
+			case DROP_BYTE:
+				bytes.erase(bytes.begin() + at);
+				break;
+			case INSERT_BYTE:
+				bytes.insert(bytes.begin() + 1 + at % (bytes.size() - 1), rng()); // not in front of the sync, that would just be noise
+				break;
+			case TRUNCATE:
+				bytes.resize(at);
+				break;
+			case BAD_LENGTH:
+				bytes[5] = 0x40 | rng() % 0x40; // far above UBX_MAX_PAYLOAD
+				break;
+			case SYNC_IN_NOISE: {
+				// a false frame start with a plausible length right in front of the frame, it swallows the real one until its checksum fails
+				const u8 noise[] = {UBX_SYNC1, UBX_SYNC2, UBX_CLASS_NAV, UBX_ID_NAV_PVT, 92, 0};
+				bytes.insert(bytes.begin(), noise, noise + sizeof(noise));
+			} break;
+			default:
+				break;
+			}
+			corrupted[c]++;
+			intact[i] = c == SYNC_IN_NOISE; // the frame itself is still whole and has to be found behind the noise
+		}
+		stream.insert(stream.end(), bytes.begin(), bytes.end());
+	}
+	replay(stream);
+
+	for (int c = 0; c < CORRUPTION_COUNT; c++) TEST_ASSERT_GREATER_THAN_UINT32(0, corrupted[c]);
+	TEST_ASSERT_GREATER_THAN_UINT32(0, parser->checksumErrors);
+	TEST_ASSERT_GREATER_THAN_UINT32(0, parser->lengthErrors);
+	TEST_ASSERT_EQUAL_UINT32(0, dispatchErrors);
+
+	// every intact frame has to come through exactly once, every damaged one must not
+	u32 intactCount = 0;
+	for (size_t i = 0; i < frames.size(); i++) {
+		const vector<u32> &seen = seenFor(frames[i]);
+		u32 n = 0;
+		for (u32 t : seen)
+			if (t == frames[i].iTow) n++;
+		if (intact[i]) {
+			intactCount++;
+			if (n != 1) {
+				char msg[80];
+				snprintf(msg, 80, "intact frame %d (id 0x%02X) seen %d times", (int)i, frames[i].id, n);
+				TEST_FAIL_MESSAGE(msg);
+			}
+		} else if (n != 0) {
+			char msg[80];
+			snprintf(msg, 80, "damaged frame %d (id 0x%02X) was accepted", (int)i, frames[i].id);
+			TEST_FAIL_MESSAGE(msg);
+		}
+	}
+	TEST_ASSERT_EQUAL_UINT32(intactCount, parser->messages);
+}
+
+void test_dispatch_length() {
+	u8 sat[8 + 12 * 3] = {};
+	sat[5] = 3;
+	TEST_ASSERT_TRUE(ubxDispatch(schema, 5, UBX_CLASS_NAV, UBX_ID_NAV_SAT, sat, sizeof(sat)) == UbxDispatch::HANDLED);
+	sat[5] = 4; // numSvs does not match the length
+	TEST_ASSERT_TRUE(ubxDispatch(schema, 5, UBX_CLASS_NAV, UBX_ID_NAV_SAT, sat, sizeof(sat)) == UbxDispatch::BAD_LENGTH);
+	TEST_ASSERT_TRUE(ubxDispatch(schema, 5, UBX_CLASS_NAV, UBX_ID_NAV_SAT, sat, 4) == UbxDispatch::BAD_LENGTH);
+	u8 pvt[92] = {};
+	TEST_ASSERT_TRUE(ubxDispatch(schema, 5, UBX_CLASS_NAV, UBX_ID_NAV_PVT, pvt, 84) == UbxDispatch::BAD_LENGTH);
+	TEST_ASSERT_TRUE(ubxDispatch(schema, 5, UBX_CLASS_NAV, UBX_ID_NAV_DOP + 0x40, pvt, 18) == UbxDispatch::UNKNOWN);
+	TEST_ASSERT_EQUAL_UINT32(1, seenSat.size());
+}
+
+// simulated receiver for the sequencer: parses what the FC sends and answers with ACK or NAK
+static vector<vector<u8>> sent;
+static void captureSend(const u8 *frame, u16 len) {
+	sent.push_back(vector<u8>(frame, frame + len));
+}
+
+static vector<u8> beforeSendAttempts;
+static void recordAttempt(u8 attempt) {
+	beforeSendAttempts.push_back(attempt);
+}
+
+static const u8 cfgA[] = {0xF0, 0x00, 0x00};
+static const u8 cfgB[] = {0xF0, 0x02, 0x00};
+static const u8 cfgC[] = {0x01, 0x35, 0x0A};
+static const u8 cfgRate[] = {0x64, 0x00, 0x01, 0x00, 0x01, 0x00};
+static const UbxConfigStep steps[] = {
+	{UBX_CLASS_CFG, UBX_ID_CFG_MSG, cfgA, 3, recordAttempt},
+	{UBX_CLASS_CFG, UBX_ID_CFG_RATE, cfgRate, 6},
+	{UBX_CLASS_CFG, UBX_ID_CFG_MSG, cfgC, 3, nullptr, true},
+	{UBX_CLASS_CFG, UBX_ID_CFG_MSG, cfgB, 3},
+};
+
+static void answer(UbxConfigSequencer &seq, bool ack) {
+	const vector<u8> &f = sent.back();
+	const u8 payload[] = {f[2], f[3]};
+	seq.onAck(payload, ack);
+}
+
+void test_sequencer_acks() {
+	sent.clear();
+	beforeSendAttempts.clear();
+	UbxConfigSequencer seq(steps, 4, captureSend, 1000, 3);
+	seq.restart(0);
+	seq.loop(500);
+	TEST_ASSERT_EQUAL_UINT32(0, sent.size()); // first step only after the timeout
+	u32 now = 1000;
+	for (int i = 0; i < 4; i++) {
+		seq.loop(now++);
+		TEST_ASSERT_EQUAL_UINT32(i + 1, sent.size());
+		answer(seq, true);
+	}
+	TEST_ASSERT_TRUE(seq.done());
+	// the payloads went out in order, framed and with a valid checksum
+	UbxParser p;
+	u32 n = 0;
+	for (auto &f : sent)
+		for (u8 c : f)
+			if (p.feed(c)) {
+				TEST_ASSERT_EQUAL_UINT8(steps[n].id, p.id());
+				TEST_ASSERT_TRUE(memcmp(p.payload(), steps[n].payload, steps[n].len) == 0);
+				n++;
+			}
+	TEST_ASSERT_EQUAL_UINT32(4, n);
+	TEST_ASSERT_EQUAL_UINT32(1, beforeSendAttempts.size());
+	seq.loop(now + 5000);
+	TEST_ASSERT_EQUAL_UINT32(4, sent.size()); // nothing after the end
+}
+
+void test_sequencer_retries() {
+	sent.clear();
+	beforeSendAttempts.clear();
+	UbxConfigSequencer seq(steps, 4, captureSend, 1000, 3);
+	seq.restart(0);
+	// the receiver does not answer: 3 attempts, then the required first step starts over
+	for (u32 t = 1000; t <= 4000; t += 1000) seq.loop(t);
+	TEST_ASSERT_EQUAL_UINT32(4, sent.size());
+	TEST_ASSERT_EQUAL_UINT32(1, seq.restarts);
+	TEST_ASSERT_EQUAL_UINT32(3, seq.timeouts);
+	TEST_ASSERT_EQUAL_UINT32(4, beforeSendAttempts.size());
+	TEST_ASSERT_EQUAL_UINT8(0, beforeSendAttempts[3]);
+	answer(seq, true);
+	TEST_ASSERT_EQUAL_UINT8(1, seq.currentStep());
+
+	// an ACK for a different message does not count
+	const u8 other[] = {UBX_CLASS_CFG, UBX_ID_CFG_PRT};
+	seq.loop(4001);
+	seq.onAck(other, true);
+	TEST_ASSERT_EQUAL_UINT8(1, seq.currentStep());
+
+	// NAK: sent again right away
+	answer(seq, false);
+	seq.loop(4002);
+	TEST_ASSERT_EQUAL_UINT32(6, sent.size());
+	TEST_ASSERT_EQUAL_UINT32(1, seq.naks);
+	answer(seq, true);
+
+	// the optional step is skipped after 3 NAKs
+	for (int i = 0; i < 3; i++) {
+		seq.loop(4003 + i);
+		answer(seq, false);
+	}
+	TEST_ASSERT_EQUAL_UINT8(2, seq.currentStep());
+	seq.loop(4010);
+	TEST_ASSERT_EQUAL_UINT8(3, seq.currentStep());
+	TEST_ASSERT_EQUAL_UINT32(1, seq.skippedSteps);
+	answer(seq, true);
+	TEST_ASSERT_TRUE(seq.done());
+}
+
+int main(int argc, char **argv) {
+	UNITY_BEGIN();
+	RUN_TEST(test_checksum_and_frame);
+	RUN_TEST(test_replay_clean_stream);
+	RUN_TEST(test_replay_full_sky);
+	RUN_TEST(test_replay_with_corruption);
+	RUN_TEST(test_dispatch_length);
+	RUN_TEST(test_sequencer_acks);
+	RUN_TEST(test_sequencer_retries);
+	return UNITY_END();
+}
@@ -0,0 +1,691 @@
+/**
+ * @file kbb.cpp
+ * @brief Decoding of Kolibri blackbox (.kbb) files into columns
+ *
+ * Copyright (c) 2026 Kolibri-FC contributors
+ *
+ * This file is part of Kolibri-FC (https://github.com/bastian2001/Kolibri-FC).
+ *
+ * Kolibri-FC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Kolibri-FC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "kbb.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+enum class KbbPacking : u8 {
+	LE, // little endian value of the column type
+	PACKED12, // four 12 bit values in 6 bytes, column index selects the value
+	U24, // 24 bit unsigned value
+};
+
+/// @brief one LOG_ flag and how it is laid out in a normal frame
+typedef struct kbbFieldDesc {
+	const char *flag;
+	u8 size; // bytes in the normal frame, 0 = logged in its own frame type
+	KbbPacking packing;
+	KbbType type;
+	u8 count; // number of columns
+	const char *columns[4];
+	const char *unit;
+	f64 scale;
+	u8 decimals;
+} KbbFieldDesc;
+
+// indexed by the bit in the LOG_ bitmask. Scaling matches the configurator (Configurator/src/utils/blackbox/parsing.ts)
+static const KbbFieldDesc fieldDescs[KBB_FIELD_COUNT] = {
+	{"LOG_ELRS_RAW", 0},
+	{"LOG_ROLL_SETPOINT", 2, KbbPacking::LE, KbbType::I16, 1, {"setpointRoll"}, "deg/s", 1. / 16, 4},
+	{"LOG_PITCH_SETPOINT", 2, KbbPacking::LE, KbbType::I16, 1, {"setpointPitch"}, "deg/s", 1. / 16, 4},
+	{"LOG_THROTTLE_SETPOINT", 2, KbbPacking::LE, KbbType::I16, 1, {"setpointThrottle"}, "", 1. / 16, 4},
+	{"LOG_YAW_SETPOINT", 2, KbbPacking::LE, KbbType::I16, 1, {"setpointYaw"}, "deg/s", 1. / 16, 4},
+	{"LOG_ROLL_GYRO_RAW", 2, KbbPacking::LE, KbbType::I16, 1, {"gyroRoll"}, "deg/s", 1. / 16, 4},
+	{"LOG_PITCH_GYRO_RAW", 2, KbbPacking::LE, KbbType::I16, 1, {"gyroPitch"}, "deg/s", 1. / 16, 4},
+	{"LOG_YAW_GYRO_RAW", 2, KbbPacking::LE, KbbType::I16, 1, {"gyroYaw"}, "deg/s", 1. / 16, 4},
+	{"LOG_ROLL_PID_P", 2, KbbPacking::LE, KbbType::I16, 1, {"pidRollP"}, "", 1, 0},
+	{"LOG_ROLL_PID_I", 2, KbbPacking::LE, KbbType::I16, 1, {"pidRollI"}, "", 1, 0},
+	{"LOG_ROLL_PID_D", 2, KbbPacking::LE, KbbType::I16, 1, {"pidRollD"}, "", 1, 0},
+	{"LOG_ROLL_PID_FF", 2, KbbPacking::LE, KbbType::I16, 1, {"pidRollFF"}, "", 1, 0},
+	{"LOG_ROLL_PID_S", 2, KbbPacking::LE, KbbType::I16, 1, {"pidRollS"}, "", 1, 0},
+	{"LOG_PITCH_PID_P", 2, KbbPacking::LE, KbbType::I16, 1, {"pidPitchP"}, "", 1, 0},
+	{"LOG_PITCH_PID_I", 2, KbbPacking::LE, KbbType::I16, 1, {"pidPitchI"}, "", 1, 0},
+	{"LOG_PITCH_PID_D", 2, KbbPacking::LE, KbbType::I16, 1, {"pidPitchD"}, "", 1, 0},
+	{"LOG_PITCH_PID_FF", 2, KbbPacking::LE, KbbType::I16, 1, {"pidPitchFF"}, "", 1, 0},
+	{"LOG_PITCH_PID_S", 2, KbbPacking::LE, KbbType::I16, 1, {"pidPitchS"}, "", 1, 0},
+	{"LOG_YAW_PID_P", 2, KbbPacking::LE, KbbType::I16, 1, {"pidYawP"}, "", 1, 0},
+	{"LOG_YAW_PID_I", 2, KbbPacking::LE, KbbType::I16, 1, {"pidYawI"}, "", 1, 0},
+	{"LOG_YAW_PID_D", 2, KbbPacking::LE, KbbType::I16, 1, {"pidYawD"}, "", 1, 0},
+	{"LOG_YAW_PID_FF", 2, KbbPacking::LE, KbbType::I16, 1, {"pidYawFF"}, "", 1, 0},
+	{"LOG_YAW_PID_S", 2, KbbPacking::LE, KbbType::I16, 1, {"pidYawS"}, "", 1, 0},
+	{"LOG_MOTOR_OUTPUTS", 6, KbbPacking::PACKED12, KbbType::U16, 4, {"motorRR", "motorFR", "motorRL", "motorFL"}, "", 1, 0},
+	{"LOG_FRAMETIME", 2, KbbPacking::LE, KbbType::U16, 1, {"frametime"}, "us", 1, 0},
+	{"LOG_ALTITUDE", 2, KbbPacking::LE, KbbType::I16, 1, {"altitude"}, "m", 1. / 64, 3},
+	{"LOG_VVEL", 2, KbbPacking::LE, KbbType::I16, 1, {"vvel"}, "m/s", 1. / 256, 4},
+	{"LOG_GPS", 0},
+	{"LOG_ATT_ROLL", 2, KbbPacking::LE, KbbType::I16, 1, {"attRoll"}, "rad", 1. / 10000, 4},
+	{"LOG_ATT_PITCH", 2, KbbPacking::LE, KbbType::I16, 1, {"attPitch"}, "rad", 1. / 10000, 4},
+	{"LOG_ATT_YAW", 2, KbbPacking::LE, KbbType::I16, 1, {"attYaw"}, "rad", 1. / 10000, 4},
+	{"LOG_MOTOR_RPM", 6, KbbPacking::PACKED12, KbbType::U16, 4, {"erpmRawRR", "erpmRawFR", "erpmRawRL", "erpmRawFL"}, "", 1, 0},
+	{"LOG_ACCEL_RAW", 6, KbbPacking::LE, KbbType::I16, 3, {"accelRawX", "accelRawY", "accelRawZ"}, "m/s^2", 9.81 / 2048, 4},
+	{"LOG_ACCEL_FILTERED", 6, KbbPacking::LE, KbbType::I16, 3, {"accelFilteredX", "accelFilteredY", "accelFilteredZ"}, "m/s^2", 9.81 / 2048, 4},
+	{"LOG_VERTICAL_ACCEL", 2, KbbPacking::LE, KbbType::I16, 1, {"accelVertical"}, "m/s^2", 1. / 128, 4},
+	{"LOG_VVEL_SETPOINT", 2, KbbPacking::LE, KbbType::I16, 1, {"setpointVvel"}, "m/s", 1. / 4096, 4},
+	{"LOG_MAG_HEADING", 2, KbbPacking::LE, KbbType::I16, 1, {"magHeading"}, "rad", 1. / 8192, 4},
+	{"LOG_COMBINED_HEADING", 2, KbbPacking::LE, KbbType::I16, 1, {"combinedHeading"}, "rad", 1. / 8192, 4},
+	{"LOG_HVEL", 4, KbbPacking::LE, KbbType::I16, 2, {"hvelN", "hvelE"}, "m/s", 1. / 256, 4},
+	{"LOG_BARO", 3, KbbPacking::U24, KbbType::U32, 1, {"baro"}, "hPa", 1. / 4096, 4},
+	{"LOG_DEBUG_1", 4, KbbPacking::LE, KbbType::I32, 1, {"debug1"}, "", 1, 0},
+	{"LOG_DEBUG_2", 4, KbbPacking::LE, KbbType::I32, 1, {"debug2"}, "", 1, 0},
+	{"LOG_DEBUG_3", 2, KbbPacking::LE, KbbType::I16, 1, {"debug3"}, "", 1, 0},
+	{"LOG_DEBUG_4", 2, KbbPacking::LE, KbbType::I16, 1, {"debug4"}, "", 1, 0},
+	{"LOG_PID_SUM", 6, KbbPacking::LE, KbbType::I16, 3, {"pidSumRoll", "pidSumPitch", "pidSumYaw"}, "", 1, 0},
+	{"LOG_VBAT", 0},
+	{"LOG_LINK_STATS", 0},
+};
+
+/// @brief a value inside the payload of an event frame
+typedef struct kbbEventColumnDesc {
+	const char *name;
+	u8 offset; // byte offset in the payload, or value index for PACKED12
+	KbbPacking packing;
+	KbbType type;
+	const char *unit;
+	f64 scale;
+	u8 decimals;
+} KbbEventColumnDesc;
+
+typedef struct kbbEventDesc {
+	const char *name;
+	u8 frameType;
+	u8 payloadSize;
+	u8 count;
+	KbbEventColumnDesc columns[28];
+} KbbEventDesc;
+
+static const KbbEventDesc eventDescs[] = {
+	{"flightModes", KBB_FRAME_FLIGHTMODE, KBB_PAYLOAD_FLIGHTMODE, 1, {{"mode", 0, KbbPacking::LE, KbbType::U8, "", 1, 0}}},
+	{"highlights", KBB_FRAME_HIGHLIGHT, 0, 0, {}},
+	{
+		"rc",
+		KBB_FRAME_RC,
+		KBB_PAYLOAD_RC,
+		4,
+		{
+			{"rcRoll", 0, KbbPacking::PACKED12, KbbType::U16, "us", 1, 0},
+			{"rcPitch", 1, KbbPacking::PACKED12, KbbType::U16, "us", 1, 0},
+			{"rcThrottle", 2, KbbPacking::PACKED12, KbbType::U16, "us", 1, 0},
+			{"rcYaw", 3, KbbPacking::PACKED12, KbbType::U16, "us", 1, 0},
+		},
+	},
+	{
+		"gps",
+		KBB_FRAME_GPS,
+		KBB_PAYLOAD_GPS,
+		26,
+		{
+			// UBX-NAV-PVT
+			{"iTOW", 0, KbbPacking::LE, KbbType::U32, "ms", 1, 0},
+			{"year", 4, KbbPacking::LE, KbbType::U16, "", 1, 0},
+			{"month", 6, KbbPacking::LE, KbbType::U8, "", 1, 0},
+			{"day", 7, KbbPacking::LE, KbbType::U8, "", 1, 0},
+			{"hour", 8, KbbPacking::LE, KbbType::U8, "", 1, 0},
+			{"minute", 9, KbbPacking::LE, KbbType::U8, "", 1, 0},
+			{"second", 10, KbbPacking::LE, KbbType::U8, "", 1, 0},
+			{"timeValid", 11, KbbPacking::LE, KbbType::U8, "", 1, 0},
+			{"tAcc", 12, KbbPacking::LE, KbbType::U32, "ns", 1, 0},
+			{"nano", 16, KbbPacking::LE, KbbType::I32, "ns", 1, 0},
+			{"fixType", 20, KbbPacking::LE, KbbType::U8, "", 1, 0},
+			{"flags", 21, KbbPacking::LE, KbbType::U8, "", 1, 0},
+			{"flags2", 22, KbbPacking::LE, KbbType::U8, "", 1, 0},
+			{"numSV", 23, KbbPacking::LE, KbbType::U8, "", 1, 0},
+			{"lon", 24, KbbPacking::LE, KbbType::I32, "deg", 1e-7, 7},
+			{"lat", 28, KbbPacking::LE, KbbType::I32, "deg", 1e-7, 7},
+			{"height", 32, KbbPacking::LE, KbbType::I32, "m", 1e-3, 3},
+			{"hMSL", 36, KbbPacking::LE, KbbType::I32, "m", 1e-3, 3},
+			{"hAcc", 40, KbbPacking::LE, KbbType::U32, "m", 1e-3, 3},
+			{"vAcc", 44, KbbPacking::LE, KbbType::U32, "m", 1e-3, 3},
+			{"velN", 48, KbbPacking::LE, KbbType::I32, "m/s", 1e-3, 3},
+			{"velE", 52, KbbPacking::LE, KbbType::I32, "m/s", 1e-3, 3},
+			{"velD", 56, KbbPacking::LE, KbbType::I32, "m/s", 1e-3, 3},
+			{"gSpeed", 60, KbbPacking::LE, KbbType::I32, "m/s", 1e-3, 3},
+			{"headMot", 64, KbbPacking::LE, KbbType::I32, "deg", 1e-5, 5},
+			{"pDOP", 76, KbbPacking::LE, KbbType::U16, "", 0.01, 2},
+		},
+	},
+	{"vbat", KBB_FRAME_VBAT, KBB_PAYLOAD_VBAT, 1, {{"vbat", 0, KbbPacking::LE, KbbType::U16, "V", 0.01, 2}}},
+	{
+		"linkStats",
+		KBB_FRAME_LINK_STATS,
+		KBB_PAYLOAD_LINK_STATS,
+		8,
+		{
+			{"rssiA", 0, KbbPacking::LE, KbbType::U8, "dBm", -1, 0}, // stored negated
+			{"rssiB", 1, KbbPacking::LE, KbbType::U8, "dBm", -1, 0},
+			{"lq", 2, KbbPacking::LE, KbbType::U8, "%", 1, 0},
+			{"snr", 3, KbbPacking::LE, KbbType::I8, "dB", 1, 0},
+			{"antenna", 4, KbbPacking::LE, KbbType::U8, "", 1, 0},
+			{"targetRate", 5, KbbPacking::LE, KbbType::U16, "Hz", 1, 0},
+			{"actualRate", 7, KbbPacking::LE, KbbType::U16, "Hz", 1, 0},
+			{"txPower", 9, KbbPacking::LE, KbbType::U16, "mW", 1, 0},
+		},
+	},
+};
+#define EVENT_TYPE_COUNT (sizeof(eventDescs) / sizeof(eventDescs[0]))
+
+static const u16 gyroRanges[] = {2000, 1000, 500, 250, 125};
+static const u8 accelRanges[] = {2, 4, 8, 16};
+
+const char *kbbFlagName(u8 bit) {
+	if (bit >= KBB_FIELD_COUNT) return nullptr;
+	return fieldDescs[bit].flag;
+}
+
+KbbColumn *kbbTable::column(const char *name) {
+	for (auto &c : columns)
+		if (c.name == name) return &c;
+	return nullptr;
+}
+const KbbColumn *kbbTable::column(const char *name) const {
+	for (auto &c : columns)
+		if (c.name == name) return &c;
+	return nullptr;
+}
+KbbTable *kbbLog::event(const char *name) {
+	for (auto &t : events)
+		if (t.name == name) return &t;
+	return nullptr;
+}
+const KbbTable *kbbLog::event(const char *name) const {
+	for (auto &t : events)
+		if (t.name == name) return &t;
+	return nullptr;
+}
+
+template <typename T>
+static inline T readLe(const u8 *p) {
+	T v;
+	memcpy(&v, p, sizeof(T)); // all supported hosts are little endian
+	return v;
+}
+
+static inline u64 readU48(const u8 *p) {
+	return (u64)readLe<u32>(p) | (u64)readLe<u16>(p + 4) << 32;
+}
+
+bool kbbParseHeader(const u8 *data, KbbHeader &h, std::string &error) {
+	if (readLe<u64>(data) != KBB_MAGIC) {
+		error = "invalid magic bytes, not a Kolibri blackbox file";
+		return false;
+	}
+	memcpy(h.version, data + 8, 3);
+	h.startTime = readLe<u32>(data + 11);
+	h.duration = readLe<u32>(data + 15);
+	h.pidFrequency = 16000 / (data[19] + 1);
+	h.frequencyDivider = data[20];
+	h.gyroRange = gyroRanges[(data[21] >> 2) % 5];
+	h.accelRange = accelRanges[data[21] & 0b11];
+	for (int ax = 0; ax < 3; ax++)
+		for (int i = 0; i < 3; i++)
+			h.rateCoeffs[ax][i] = readLe<i32>(data + 22 + ax * 12 + i * 4) / 65536.;
+	for (int ax = 0; ax < 3; ax++)
+		for (int i = 0; i < 5; i++)
+			h.pidGains[ax][i] = readLe<u16>(data + 82 + ax * 10 + i * 2);
+	h.flags = readLe<u64>(data + 142);
+	h.motorPoles = data[150];
+	h.disarmReason = data[151];
+	h.syncFrequency = data[152];
+	h.frameSize = data[153];
+
+	const u8 *s = data + 160;
+	KbbSummary &sum = h.summary;
+	sum.valid = s[0] == 1;
+	if (sum.valid) {
+		for (int ax = 0; ax < 3; ax++) sum.maxGyro[ax] = readLe<u16>(s + 2 + ax * 2);
+		sum.motorSaturation = readLe<u16>(s + 8);
+		sum.minVbat = readLe<u16>(s + 10);
+		sum.avgVbat = readLe<u16>(s + 12);
+		sum.avgLoopTime = readLe<u16>(s + 14);
+		sum.loopJitter = readLe<u16>(s + 16);
+		sum.droppedFrames = readLe<u32>(s + 18);
+		sum.peakITerm = readLe<u16>(s + 22);
+		sum.flightTime = readLe<u32>(s + 24);
+		sum.frames = readLe<u32>(s + 28);
+	}
+	return true;
+}
+
+/// @brief where a value of a normal frame is located
+typedef struct kbbFieldLayout {
+	const KbbFieldDesc *desc;
+	u8 offset; // byte offset inside the (unescaped) normal frame
+} KbbFieldLayout;
+
+/**
+ * @brief reproduce the order in which writeSingleFrame() packs the fields
+ *
+ * @details the FC writes 4 byte aligned fields first, then 2 byte, then 1 byte aligned ones, each group in flag order
+ */
+static std::vector<KbbFieldLayout> getLayout(u64 flags, u32 &frameSize) {
+	std::vector<KbbFieldLayout> layout;
+	u32 offset = 0;
+	for (u8 alignment : {8, 4, 2, 1}) {
+		for (int bit = 0; bit < KBB_FIELD_COUNT; bit++) {
+			if (!(flags & (1ULL << bit))) continue;
+			const KbbFieldDesc &d = fieldDescs[bit];
+			if (!d.size || d.size % alignment || (d.size % (alignment * 2) == 0)) continue;
+			layout.push_back({&d, (u8)offset});
+			offset += d.size;
+		}
+	}
+	frameSize = offset;
+	return layout;
+}
+
+/// @brief the part of the file between two SYNCs (or the start/end of the data)
+typedef struct segment {
+	size_t start;
+	size_t end;
+	std::vector<u8> rows; // unescaped normal frames, frameSize bytes each
+	std::vector<u32> frameNums;
+	std::vector<u32> eventFrames[EVENT_TYPE_COUNT];
+	std::vector<u8> eventPayloads[EVENT_TYPE_COUNT];
+	u32 syncs = 0;
+	u32 resyncs = 0;
+	size_t skippedBytes = 0;
+	u32 missingFrames = 0;
+} Segment;
+
+/**
+ * @brief copy len net bytes from the escaped data, removing the ! of every SYN!
+ *
+ * @details the FC escapes each payload on its own, so a SYN can never span two frames
+ *
+ * @param d escaped data
+ * @param pos start of the payload, moved behind the payload (and the trailing ! if any)
+ * @param end end of the readable data
+ * @param len net payload length
+ * @param out destination, len bytes
+ * @return false if the data ended or the escaping was broken
+ */
+static inline bool readPayload(const u8 *d, size_t &pos, size_t end, size_t len, u8 *out) {
+	if (pos + len > end) return false;
+	// fast path: without an S there cannot be a SYN
+	const u8 *s = (const u8 *)memchr(d + pos, 'S', len);
+	if (!s) {
+		memcpy(out, d + pos, len);
+		pos += len;
+		return true;
+	}
+	size_t p = pos;
+	size_t o = 0;
+	while (s) {
+		// copy everything up to the S
+		size_t n = s - (d + p);
+		memcpy(out + o, d + p, n);
+		o += n;
+		p += n;
+		// only a complete SYN inside the payload got escaped
+		if (len - o >= 3 && p + 3 < end && d[p + 1] == 'Y' && d[p + 2] == 'N') {
+			if (d[p + 3] != '!') return false;
+			memcpy(out + o, "SYN", 3);
+			o += 3;
+			p += 4;
+		} else {
+			out[o++] = 'S';
+			p++;
+		}
+		if (o == len || p + (len - o) > end) break;
+		s = (const u8 *)memchr(d + p, 'S', len - o);
+	}
+	if (o < len) {
+		if (p + (len - o) > end) return false;
+		memcpy(out + o, d + p, len - o);
+		p += len - o;
+	}
+	pos = p;
+	return true;
+}
+
+/// @brief find the next "SYNC" in [from, end), returns end if there is none
+static size_t findSync(const u8 *d, size_t from, size_t end) {
+	while (from + 4 <= end) {
+		const u8 *s = (const u8 *)memchr(d + from, 'S', end - from - 3);
+		if (!s) break;
+		size_t p = s - d;
+		if (d[p + 1] == 'Y' && d[p + 2] == 'N' && d[p + 3] == 'C') return p;
+		from = p + 1;
+	}
+	return end;
+}
+
+static void decodeSegment(const u8 *d, Segment &seg, u32 frameSize, const i8 eventIndex[256]) {
+	size_t pos = seg.start;
+	const size_t end = seg.end;
+	const bool firstSegment = seg.start == KBB_HEADER_SIZE; // later segments start with a SYNC, gaps before it are counted when gathering
+	u32 frame = 0;
+	u8 buf[KBB_PAYLOAD_GPS];
+
+	// upper bound of the frame count, so rows never have to be reallocated
+	size_t maxFrames = (end - pos) / (frameSize + 1) + 1;
+	seg.rows.resize(maxFrames * frameSize);
+	seg.frameNums.reserve(maxFrames);
+	u8 *row = seg.rows.data();
+
+	while (pos < end) {
+		u8 type = d[pos];
+		size_t p = pos + 1;
+		bool ok = true;
+		if (type == KBB_FRAME_NORMAL) {
+			ok = readPayload(d, p, end, frameSize, row);
+			if (ok) {
+				seg.frameNums.push_back(frame++);
+				row += frameSize;
+			}
+		} else if (type == KBB_FRAME_SYNC) {
+			ok = p + 3 <= end && d[p] == 'Y' && d[p + 1] == 'N' && d[p + 2] == 'C';
+			if (ok) {
+				p += 3;
+				ok = readPayload(d, p, end, KBB_PAYLOAD_SYNC, buf);
+			}
+			if (ok) {
+				u32 syncFrame = readLe<u32>(buf + 1);
+				if (syncFrame > frame && (seg.syncs || firstSegment)) seg.missingFrames += syncFrame - frame;
+				frame = syncFrame;
+				seg.syncs++;
+			}
+		} else if (eventIndex[type] >= 0) {
+			int e = eventIndex[type];
+			u8 len = eventDescs[e].payloadSize;
+			// VBAT and flight mode payloads are written without escaping, but they are too short to contain a SYN
+			ok = readPayload(d, p, end, len, buf);
+			if (ok) {
+				seg.eventFrames[e].push_back(frame);
+				seg.eventPayloads[e].insert(seg.eventPayloads[e].end(), buf, buf + len);
+			}
+		} else {
+			ok = false;
+		}
+
+		if (ok) {
+			pos = p;
+			continue;
+		}
+		// corrupted or truncated: continue at the next SYNC, which restores the frame number
+		size_t next = findSync(d, pos + 1, end);
+		seg.skippedBytes += next - pos;
+		seg.resyncs++;
+		pos = next;
+	}
+	seg.rows.resize(row - seg.rows.data());
+}
+
+template <typename T>
+static void unpackLe(const u8 *rows, size_t count, u32 stride, u32 offset, T *dst) {
+	const u8 *src = rows + offset;
+	for (size_t i = 0; i < count; i++, src += stride)
+		memcpy(&dst[i], src, sizeof(T));
+}
+
+static void unpackPacked12(const u8 *rows, size_t count, u32 stride, u32 offset, u8 index, u16 *dst) {
+	const u8 *src = rows + offset;
+	const u32 shift = index * 12;
+	for (size_t i = 0; i < count; i++, src += stride)
+		dst[i] = (readU48(src) >> shift) & 0xFFF;
+}
+
+static void unpackU24(const u8 *rows, size_t count, u32 stride, u32 offset, u32 *dst) {
+	const u8 *src = rows + offset;
+	for (size_t i = 0; i < count; i++, src += stride)
+		dst[i] = src[0] | src[1] << 8 | src[2] << 16;
+}
+
+/// @brief unpack one column from row major data (stride bytes per row) into dst
+static void unpackColumn(const u8 *rows, size_t count, u32 stride, u32 offset, KbbPacking packing, KbbType type, u8 index, u8 *dst) {
+	switch (packing) {
+	case KbbPacking::PACKED12:
+		unpackPacked12(rows, count, stride, offset, index, (u16 *)dst);
+		break;
+	case KbbPacking::U24:
+		unpackU24(rows, count, stride, offset, (u32 *)dst);
+		break;
+	case KbbPacking::LE:
+		switch (kbbTypeSize(type)) {
+		case 1: unpackLe(rows, count, stride, offset, dst); break;
+		case 2: unpackLe(rows, count, stride, offset, (u16 *)dst); break;
+		case 4: unpackLe(rows, count, stride, offset, (u32 *)dst); break;
+		}
+		break;
+	}
+}
+
+static KbbColumn makeColumn(const char *name, const char *unit, KbbType type, f64 scale, u8 decimals, size_t rows) {
+	KbbColumn c;
+	c.name = name;
+	c.unit = unit;
+	c.type = type;
+	c.scale = scale;
+	c.decimals = decimals;
+	c.data.resize(rows * kbbTypeSize(type));
+	return c;
+}
+
+bool kbbDecode(const u8 *d, size_t len, KbbLog &log, u32 threads, std::string &error) {
+	threads = kbbThreadCount(threads);
+	log.stats = KbbDecodeStats();
+	log.stats.fileSize = len;
+	if (len < KBB_HEADER_SIZE) {
+		error = "file too short";
+		return false;
+	}
+	KbbHeader &h = log.header;
+	if (!kbbParseHeader(d, h, error)) return false;
+	memcpy(log.rawHeader, d, KBB_HEADER_SIZE);
+
+	u32 frameSize;
+	std::vector<KbbFieldLayout> layout = getLayout(h.flags, frameSize);
+	if (h.frameSize && h.frameSize != frameSize) {
+		error = "frame size in header (" + std::to_string(h.frameSize) + ") does not match the logged fields (" + std::to_string(frameSize) + ")";
+		return false;
+	}
+
+	// a log that was not closed properly may still have its preallocated (zeroed) space at the end
+	size_t end = len;
+	if (!h.duration) {
+		while (end > KBB_HEADER_SIZE && d[end - 1] == 0) end--;
+		log.stats.trimmedBytes = len - end;
+	}
+
+	// split at SYNCs into roughly equal parts
+	std::vector<size_t> bounds = {KBB_HEADER_SIZE};
+	const size_t dataLen = end - KBB_HEADER_SIZE;
+	const size_t minSegment = 1 << 20;
+	size_t segCount = threads * 4;
+	if (segCount > dataLen / minSegment) segCount = dataLen / minSegment;
+	if (!h.syncFrequency || segCount < 2) segCount = 1;
+	for (size_t i = 1; i < segCount; i++) {
+		size_t target = KBB_HEADER_SIZE + dataLen * i / segCount;
+		if (target <= bounds.back()) target = bounds.back() + 1;
+		size_t s = findSync(d, target, end);
+		if (s >= end) break;
+		if (s > bounds.back()) bounds.push_back(s);
+	}
+	bounds.push_back(end);
+	std::vector<Segment> segments(bounds.size() - 1);
+	for (size_t i = 0; i < segments.size(); i++) {
+		segments[i].start = bounds[i];
+		segments[i].end = bounds[i + 1];
+	}
+
+	i8 eventIndex[256];
+	memset(eventIndex, -1, sizeof(eventIndex));
+	for (size_t e = 0; e < EVENT_TYPE_COUNT; e++) eventIndex[eventDescs[e].frameType] = e;
+
+	// frame numbers of segments that start with a SYNC are taken from that SYNC, so the segments are independent
+	kbbParallelFor(segments.size(), threads, [&](size_t i) {
+		decodeSegment(d, segments[i], frameSize, eventIndex);
+	});
+
+	// gather
+	size_t rowCount = 0;
+	std::vector<size_t> rowOffsets(segments.size());
+	for (size_t i = 0; i < segments.size(); i++) {
+		Segment &s = segments[i];
+		rowOffsets[i] = rowCount;
+		rowCount += s.frameNums.size();
+		log.stats.syncs += s.syncs;
+		log.stats.resyncs += s.resyncs;
+		log.stats.skippedBytes += s.skippedBytes;
+		log.stats.missingFrames += s.missingFrames;
+		// frames between two segments, e.g. lost in corrupted data right before a segment's SYNC
+		if (i && s.frameNums.size() && segments[i - 1].frameNums.size()) {
+			u32 expected = segments[i - 1].frameNums.back() + 1;
+			if (s.frameNums.front() > expected) log.stats.missingFrames += s.frameNums.front() - expected;
+		}
+	}
+	log.stats.segments = segments.size();
+
+	KbbTable &t = log.frames;
+	t.name = "frames";
+	t.rowCount = rowCount;
+	t.columns.clear();
+	t.columns.push_back(makeColumn("frame", "", KbbType::U32, 1, 0, rowCount));
+	struct ColumnSource {
+		u32 offset;
+		KbbPacking packing;
+		u8 index;
+	};
+	std::vector<ColumnSource> sources = {{0, KbbPacking::LE, 0}};
+	for (auto &l : layout) {
+		const KbbFieldDesc &f = *l.desc;
+		u32 elemSize = f.packing == KbbPacking::LE ? kbbTypeSize(f.type) : 0;
+		for (u8 c = 0; c < f.count; c++) {
+			t.columns.push_back(makeColumn(f.columns[c], f.unit, f.type, f.scale, f.decimals, rowCount));
+			sources.push_back({l.offset + c * elemSize, f.packing, c});
+		}
+	}
+
+	// unpack every segment directly into its part of the final columns
+	kbbParallelFor(segments.size() * t.columns.size(), threads, [&](size_t job) {
+		size_t si = job / t.columns.size();
+		size_t ci = job % t.columns.size();
+		Segment &s = segments[si];
+		KbbColumn &col = t.columns[ci];
+		size_t n = s.frameNums.size();
+		if (!n) return;
+		if (ci == 0) {
+			memcpy(col.values<u32>() + rowOffsets[si], s.frameNums.data(), n * 4);
+			return;
+		}
+		u8 *dst = col.data.data() + rowOffsets[si] * kbbTypeSize(col.type);
+		unpackColumn(s.rows.data(), n, frameSize, sources[ci].offset, sources[ci].packing, col.type, sources[ci].index, dst);
+	});
+
+	log.events.clear();
+	for (size_t e = 0; e < EVENT_TYPE_COUNT; e++) {
+		const KbbEventDesc &ed = eventDescs[e];
+		KbbTable ev;
+		ev.name = ed.name;
+		for (auto &s : segments) ev.rowCount += s.eventFrames[e].size();
+		ev.columns.push_back(makeColumn("frame", "", KbbType::U32, 1, 0, ev.rowCount));
+		for (u8 c = 0; c < ed.count; c++) {
+			const KbbEventColumnDesc &cd = ed.columns[c];
+			ev.columns.push_back(makeColumn(cd.name, cd.unit, cd.type, cd.scale, cd.decimals, ev.rowCount));
+		}
+		size_t row = 0;
+		for (auto &s : segments) {
+			size_t n = s.eventFrames[e].size();
+			if (!n) continue;
+			memcpy(ev.columns[0].values<u32>() + row, s.eventFrames[e].data(), n * 4);
+			for (u8 c = 0; c < ed.count; c++) {
+				const KbbEventColumnDesc &cd = ed.columns[c];
+				KbbColumn &col = ev.columns[c + 1];
+				bool packed = cd.packing == KbbPacking::PACKED12;
+				unpackColumn(s.eventPayloads[e].data(), n, ed.payloadSize, packed ? 0 : cd.offset, cd.packing, cd.type, packed ? cd.offset : 0, col.data.data() + row * kbbTypeSize(col.type));
+			}
+			row += n;
+		}
+		log.events.push_back(std::move(ev));
+	}
+	return true;
+}
+
+/// @brief read-only memory mapping of a whole file
+class MappedFile {
+public:
+	MappedFile(const std::string &path) {
+#ifdef _WIN32
+		file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE) return;
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file, &size)) return;
+		len = size.QuadPart;
+		if (!len) return;
+		mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!mapping) return;
+		data = (const u8 *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+		fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0) return;
+		struct stat st;
+		if (fstat(fd, &st)) return;
+		len = st.st_size;
+		if (!len) return;
+		void *p = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (p == MAP_FAILED) return;
+		madvise(p, len, MADV_WILLNEED);
+		data = (const u8 *)p;
+#endif
+	}
+	~MappedFile() {
+#ifdef _WIN32
+		if (data) UnmapViewOfFile(data);
+		if (mapping) CloseHandle(mapping);
+		if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+#else
+		if (data) munmap((void *)data, len);
+		if (fd >= 0) close(fd);
+#endif
+	}
+	MappedFile(const MappedFile &) = delete;
+	MappedFile &operator=(const MappedFile &) = delete;
+
+	const u8 *data = nullptr;
+	size_t len = 0;
+
+private:
+#ifdef _WIN32
+	HANDLE file = INVALID_HANDLE_VALUE;
+	HANDLE mapping = nullptr;
+#else
+	int fd = -1;
+#endif
+};
+
+bool kbbDecodeFile(const std::string &path, KbbLog &log, u32 threads, std::string &error) {
+	log.path = path;
+	MappedFile f(path);
+	if (!f.data) {
+		error = f.len ? "could not map file" : "could not open file or file is empty";
+		return false;
+	}
+	return kbbDecode(f.data, f.len, log, threads, error);
+}
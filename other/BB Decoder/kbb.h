@@ -0,0 +1,257 @@
+/**
+ * @file kbb.h
+ * @brief Host side decoder for Kolibri blackbox (.kbb) files
+ *
+ * Copyright (c) 2026 Kolibri-FC contributors
+ *
+ * This file is part of Kolibri-FC (https://github.com/bastian2001/Kolibri-FC).
+ *
+ * Kolibri-FC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Kolibri-FC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int8_t i8;
+typedef int16_t i16;
+typedef int32_t i32;
+typedef int64_t i64;
+typedef float f32;
+typedef double f64;
+
+// file layout, see Firmware/docs/blackbox logging.md and Firmware/src/blackbox.h
+#define KBB_HEADER_SIZE 256
+#define KBB_MAGIC 0x0001494C4F4BDFDCULL
+#define KBB_FIELD_COUNT 47 // number of LOG_ flags known to this decoder
+
+#define KBB_FRAME_NORMAL 0
+#define KBB_FRAME_FLIGHTMODE 1
+#define KBB_FRAME_HIGHLIGHT 2
+#define KBB_FRAME_GPS 3
+#define KBB_FRAME_RC 4
+#define KBB_FRAME_VBAT 5
+#define KBB_FRAME_LINK_STATS 6
+#define KBB_FRAME_SYNC 'S'
+
+// net payload sizes (without the frame identifier)
+#define KBB_PAYLOAD_FLIGHTMODE 1
+#define KBB_PAYLOAD_GPS 92
+#define KBB_PAYLOAD_RC 6
+#define KBB_PAYLOAD_VBAT 2
+#define KBB_PAYLOAD_LINK_STATS 11
+#define KBB_PAYLOAD_SYNC 9 // after "SYNC": u8 flags, u32 frame number, u32 position of the previous SYNC
+
+/// @brief storage type of a column
+enum class KbbType : u8 {
+	U8,
+	I8,
+	U16,
+	I16,
+	U32,
+	I32,
+};
+
+/// @brief size of a column element in bytes
+static inline size_t kbbTypeSize(KbbType t) {
+	switch (t) {
+	case KbbType::U8:
+	case KbbType::I8:
+		return 1;
+	case KbbType::U16:
+	case KbbType::I16:
+		return 2;
+	default:
+		return 4;
+	}
+}
+
+/**
+ * @brief one contiguous array of values
+ *
+ * @details values are stored raw (as logged), multiply by scale to get the physical value in unit
+ */
+typedef struct kbbColumn {
+	std::string name;
+	std::string unit;
+	KbbType type = KbbType::I32;
+	f64 scale = 1; // raw * scale = physical value
+	u8 decimals = 0; // decimals that are meaningful for the physical value
+	std::vector<u8> data; // rowCount * kbbTypeSize(type) bytes
+
+	template <typename T>
+	T *values() { return (T *)data.data(); }
+	template <typename T>
+	const T *values() const { return (const T *)data.data(); }
+
+	/// @brief raw value at row, sign extended
+	i64 raw(size_t row) const {
+		switch (type) {
+		case KbbType::U8: return values<u8>()[row];
+		case KbbType::I8: return values<i8>()[row];
+		case KbbType::U16: return values<u16>()[row];
+		case KbbType::I16: return values<i16>()[row];
+		case KbbType::U32: return values<u32>()[row];
+		case KbbType::I32: return values<i32>()[row];
+		}
+		return 0;
+	}
+	/// @brief physical value at row
+	f64 value(size_t row) const { return raw(row) * scale; }
+} KbbColumn;
+
+/// @brief a set of columns with the same number of rows. The first column is always "frame"
+typedef struct kbbTable {
+	std::string name;
+	size_t rowCount = 0;
+	std::vector<KbbColumn> columns;
+
+	KbbColumn *column(const char *name);
+	const KbbColumn *column(const char *name) const;
+} KbbTable;
+
+/// @brief summary block that the FC writes into the header at the end of a log (LOG_HEAD_SUMMARY)
+typedef struct kbbSummary {
+	bool valid = false;
+	u16 maxGyro[3] = {}; // deg/s
+	u16 motorSaturation = 0; // 0.01%
+	u16 minVbat = 0; // centivolts
+	u16 avgVbat = 0; // centivolts
+	u16 avgLoopTime = 0; // 0.01us
+	u16 loopJitter = 0; // 0.01us
+	u32 droppedFrames = 0;
+	u16 peakITerm = 0;
+	u32 flightTime = 0; // ms
+	u32 frames = 0;
+} KbbSummary;
+
+typedef struct kbbHeader {
+	u8 version[3] = {};
+	u32 startTime = 0; // UNIX timestamp, UTC
+	u32 duration = 0; // ms, 0 if the log was not closed properly
+	u32 pidFrequency = 0; // Hz
+	u8 frequencyDivider = 0;
+	u16 gyroRange = 0; // deg/s
+	u8 accelRange = 0; // g
+	f64 rateCoeffs[3][3] = {}; // [axis][center, max, expo]
+	u16 pidGains[3][5] = {}; // [axis][P, I, D, FF, S]
+	u64 flags = 0; // LOG_ bitmask
+	u8 motorPoles = 0;
+	u8 disarmReason = 0;
+	u8 syncFrequency = 0;
+	u8 frameSize = 0; // bytes of a normal frame (without identifier)
+	KbbSummary summary;
+
+	f64 framesPerSecond() const { return frequencyDivider ? (f64)pidFrequency / frequencyDivider : 0; }
+} KbbHeader;
+
+/// @brief statistics about the decoding process
+typedef struct kbbDecodeStats {
+	size_t fileSize = 0;
+	u32 segments = 0; // SYNC delimited segments that were decoded independently
+	u32 syncs = 0;
+	u32 resyncs = 0; // number of times the decoder had to search for the next SYNC due to corrupted data
+	size_t skippedBytes = 0; // bytes that were skipped while searching for a SYNC
+	u32 missingFrames = 0; // frames that were lost according to the frame numbers in the SYNCs
+	size_t trimmedBytes = 0; // trailing zero bytes (preallocated, unwritten file space) that were ignored
+} KbbDecodeStats;
+
+typedef struct kbbLog {
+	std::string path;
+	u8 rawHeader[KBB_HEADER_SIZE] = {};
+	KbbHeader header;
+	KbbTable frames; // normal frames, one column per logged value
+	std::vector<KbbTable> events; // flight modes, highlights, RC, GPS, VBAT and link stats, first column is the frame they apply to
+	KbbDecodeStats stats;
+
+	KbbTable *event(const char *name);
+	const KbbTable *event(const char *name) const;
+} KbbLog;
+
+/**
+ * @brief name of a LOG_ flag
+ *
+ * @param bit bit index in the flags bitmask
+ * @return const char* e.g. "LOG_ROLL_SETPOINT", nullptr if unknown
+ */
+const char *kbbFlagName(u8 bit);
+
+/**
+ * @brief parse the 256 byte header of a log
+ *
+ * @param data at least KBB_HEADER_SIZE bytes
+ * @param header destination
+ * @param error set if parsing failed
+ * @return false if this is not a valid log header
+ */
+bool kbbParseHeader(const u8 *data, KbbHeader &header, std::string &error);
+
+/**
+ * @brief decode a whole log from memory
+ *
+ * @details The data is split into SYNC delimited segments, which are decoded in parallel. Corrupted data is skipped up to the next SYNC, and frame numbers are recovered from that SYNC.
+ *
+ * @param data file contents (including the header)
+ * @param len length of data
+ * @param log destination
+ * @param threads worker threads, 0 = number of hardware threads
+ * @param error set if decoding failed
+ * @return false if the data could not be decoded at all (invalid header)
+ */
+bool kbbDecode(const u8 *data, size_t len, KbbLog &log, u32 threads, std::string &error);
+
+/**
+ * @brief memory map a file and decode it, see kbbDecode()
+ */
+bool kbbDecodeFile(const std::string &path, KbbLog &log, u32 threads, std::string &error);
+
+/**
+ * @brief export a log as CSV
+ *
+ * @details writes <basePath>.csv with the normal frames and <basePath>.<event>.csv (e.g. .gps.csv) for every event type that occurs in the log
+ *
+ * @param log decoded log
+ * @param basePath path without extension
+ * @param raw write raw values instead of physical units
+ * @param threads worker threads for formatting, 0 = number of hardware threads
+ * @param error set if writing failed
+ */
+bool kbbWriteCsv(const KbbLog &log, const std::string &basePath, bool raw, u32 threads, std::string &error);
+
+/**
+ * @brief export a log in the compact columnar binary format (.kbc)
+ *
+ * @details Format (little endian):
+ * - 8 bytes magic "KBCOL\0\0\1" (last byte: format version)
+ * - 256 bytes: original log header
+ * - u32 table count, then per table:
+ *   - u8 name length, name, u32 column count, u64 row count
+ *   - per column: u8 name length, name, u8 unit length, unit, u8 type (KbbType), f64 scale
+ *   - column data, each column contiguous, row count * type size bytes
+ *
+ * @param log decoded log
+ * @param path output file
+ * @param error set if writing failed
+ */
+bool kbbWriteColumnar(const KbbLog &log, const std::string &path, std::string &error);
+
+#include "kbbParallel.h"
@@ -0,0 +1,190 @@
+/**
+ * @file kbbExport.cpp
+ * @brief CSV and columnar binary export of decoded blackbox logs
+ *
+ * Copyright (c) 2026 Kolibri-FC contributors
+ *
+ * This file is part of Kolibri-FC (https://github.com/bastian2001/Kolibri-FC).
+ *
+ * Kolibri-FC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Kolibri-FC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "kbb.h"
+#include <cmath>
+#include <cstdio>
+
+#define CSV_BLOCK_ROWS 32768 // rows that are formatted by one job
+
+static const i64 pow10s[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000};
+
+static inline char *appendUint(char *p, u64 v) {
+	char tmp[20];
+	int n = 0;
+	do {
+		tmp[n++] = '0' + v % 10;
+		v /= 10;
+	} while (v);
+	while (n) *p++ = tmp[--n];
+	return p;
+}
+
+static inline char *appendInt(char *p, i64 v) {
+	if (v < 0) {
+		*p++ = '-';
+		return appendUint(p, -(u64)v);
+	}
+	return appendUint(p, v);
+}
+
+/// @brief prints raw * scale with at most decimals decimals, trailing zeros removed
+static inline char *appendScaled(char *p, i64 raw, f64 scale, u8 decimals) {
+	if (scale == 1) return appendInt(p, raw);
+	if (scale == -1) return appendInt(p, -raw);
+	i64 m = llround(raw * scale * pow10s[decimals]);
+	if (m < 0) {
+		*p++ = '-';
+		m = -m;
+	}
+	p = appendUint(p, m / pow10s[decimals]);
+	i64 frac = m % pow10s[decimals];
+	if (!frac) return p;
+	*p++ = '.';
+	u8 d = decimals;
+	while (frac % 10 == 0) {
+		frac /= 10;
+		d--;
+	}
+	for (i64 div = pow10s[d - 1]; div; div /= 10) *p++ = '0' + (frac / div) % 10;
+	return p;
+}
+
+static bool writeTableCsv(const KbbTable &t, const std::string &path, bool raw, f64 framesPerSecond, u32 threads, std::string &error) {
+	FILE *f = fopen(path.c_str(), "wb");
+	if (!f) {
+		error = "could not create " + path;
+		return false;
+	}
+
+	const bool withTime = framesPerSecond > 0;
+	std::string head;
+	if (withTime) head += raw ? "time" : "time (s)";
+	for (auto &c : t.columns) {
+		if (!head.empty()) head += ',';
+		head += c.name;
+		if (!raw && !c.unit.empty()) head += " (" + c.unit + ")";
+	}
+	head += '\n';
+	fwrite(head.data(), 1, head.size(), f);
+
+	// upper bound of one row: sign + 10 digits + point per value, plus the time column
+	const size_t maxRowLen = (t.columns.size() + 1) * 24 + 1;
+	const size_t blockCount = (t.rowCount + CSV_BLOCK_ROWS - 1) / CSV_BLOCK_ROWS;
+	threads = kbbThreadCount(threads);
+	const size_t batch = threads * 2;
+	std::vector<std::string> buffers(batch);
+	const u32 *frames = t.columns[0].values<u32>();
+
+	// format a few blocks in parallel, then write them in order
+	for (size_t first = 0; first < blockCount; first += batch) {
+		size_t jobs = blockCount - first < batch ? blockCount - first : batch;
+		kbbParallelFor(jobs, threads, [&](size_t j) {
+			size_t startRow = (first + j) * CSV_BLOCK_ROWS;
+			size_t endRow = startRow + CSV_BLOCK_ROWS < t.rowCount ? startRow + CSV_BLOCK_ROWS : t.rowCount;
+			std::string &buf = buffers[j];
+			buf.resize((endRow - startRow) * maxRowLen);
+			char *p = &buf[0];
+			for (size_t r = startRow; r < endRow; r++) {
+				if (withTime) {
+					if (raw)
+						p = appendUint(p, frames[r]);
+					else
+						p = appendScaled(p, frames[r], 1 / framesPerSecond, 6);
+				}
+				for (size_t c = 0; c < t.columns.size(); c++) {
+					if (withTime || c) *p++ = ',';
+					const KbbColumn &col = t.columns[c];
+					if (raw)
+						p = appendInt(p, col.raw(r));
+					else
+						p = appendScaled(p, col.raw(r), col.scale, col.decimals);
+				}
+				*p++ = '\n';
+			}
+			buf.resize(p - &buf[0]);
+		});
+		for (size_t j = 0; j < jobs; j++) {
+			if (fwrite(buffers[j].data(), 1, buffers[j].size(), f) != buffers[j].size()) {
+				error = "could not write " + path;
+				fclose(f);
+				return false;
+			}
+		}
+	}
+	if (fclose(f)) {
+		error = "could not write " + path;
+		return false;
+	}
+	return true;
+}
+
+bool kbbWriteCsv(const KbbLog &log, const std::string &basePath, bool raw, u32 threads, std::string &error) {
+	const f64 fps = log.header.framesPerSecond();
+	if (!writeTableCsv(log.frames, basePath + ".csv", raw, fps, threads, error)) return false;
+	for (auto &t : log.events) {
+		if (!t.rowCount) continue;
+		if (!writeTableCsv(t, basePath + "." + t.name + ".csv", raw, fps, threads, error)) return false;
+	}
+	return true;
+}
+
+static void putString(FILE *f, const std::string &s) {
+	u8 len = s.size() > 255 ? 255 : s.size();
+	fputc(len, f);
+	fwrite(s.data(), 1, len, f);
+}
+
+static void writeTableColumnar(FILE *f, const KbbTable &t) {
+	putString(f, t.name);
+	u32 columnCount = t.columns.size();
+	u64 rowCount = t.rowCount;
+	fwrite(&columnCount, 4, 1, f);
+	fwrite(&rowCount, 8, 1, f);
+	for (auto &c : t.columns) {
+		putString(f, c.name);
+		putString(f, c.unit);
+		fputc((u8)c.type, f);
+		fwrite(&c.scale, 8, 1, f);
+	}
+	for (auto &c : t.columns)
+		fwrite(c.data.data(), 1, c.data.size(), f);
+}
+
+bool kbbWriteColumnar(const KbbLog &log, const std::string &path, std::string &error) {
+	FILE *f = fopen(path.c_str(), "wb");
+	if (!f) {
+		error = "could not create " + path;
+		return false;
+	}
+	const u8 magic[8] = {'K', 'B', 'C', 'O', 'L', 0, 0, 1};
+	fwrite(magic, 1, 8, f);
+	fwrite(log.rawHeader, 1, KBB_HEADER_SIZE, f);
+	u32 tableCount = 1 + log.events.size();
+	fwrite(&tableCount, 4, 1, f);
+	writeTableColumnar(f, log.frames);
+	for (auto &t : log.events) writeTableColumnar(f, t);
+	bool ok = !ferror(f);
+	if (fclose(f)) ok = false;
+	if (!ok) error = "could not write " + path;
+	return ok;
+}
@@ -0,0 +1,56 @@
+/**
+ * @file kbbParallel.h
+ * @brief Minimal work distribution used by the decoder
+ *
+ * Copyright (c) 2026 Kolibri-FC contributors
+ *
+ * This file is part of Kolibri-FC (https://github.com/bastian2001/Kolibri-FC).
+ *
+ * Kolibri-FC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Kolibri-FC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <thread>
+
+/// @brief resolves 0 to the number of hardware threads
+static inline u32 kbbThreadCount(u32 threads) {
+	if (threads) return threads;
+	u32 hw = std::thread::hardware_concurrency();
+	return hw ? hw : 1;
+}
+
+/**
+ * @brief runs fn(i) for i in [0, count) on up to threads threads (0 = number of hardware threads)
+ */
+template <typename F>
+void kbbParallelFor(size_t count, u32 threads, F fn) {
+	threads = kbbThreadCount(threads);
+	if (threads > count) threads = count;
+	if (threads <= 1) {
+		for (size_t i = 0; i < count; i++) fn(i);
+		return;
+	}
+	// items are handed out one by one, so that uneven items (e.g. files of different sizes) still spread well
+	std::atomic<size_t> next(0);
+	std::vector<std::thread> workers;
+	workers.reserve(threads - 1);
+	auto work = [&]() {
+		for (size_t i = next++; i < count; i = next++) fn(i);
+	};
+	for (u32 t = 1; t < threads; t++) workers.emplace_back(work);
+	work();
+	for (auto &w : workers) w.join();
+}
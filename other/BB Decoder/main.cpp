@@ -0,0 +1,151 @@
+/**
+ * @file main.cpp
+ * @brief Command line interface of the blackbox decoder
+ *
+ * Copyright (c) 2026 Kolibri-FC contributors
+ *
+ * This file is part of Kolibri-FC (https://github.com/bastian2001/Kolibri-FC).
+ *
+ * Kolibri-FC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Kolibri-FC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "kbb.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+
+static void printUsage(const char *name) {
+	printf("Usage: %s [options] <file.kbb>...\n", name);
+	printf("Decodes Kolibri blackbox logs into columns and exports them.\n\n");
+	printf("  -c, --csv          write <name>.csv and <name>.<event>.csv (default)\n");
+	printf("  -b, --binary       write the compact columnar format <name>.kbc\n");
+	printf("  -r, --raw          write raw values instead of physical units into the CSV\n");
+	printf("  -o, --out <dir>    output directory (default: next to the log)\n");
+	printf("  -j, --threads <n>  worker threads (default: all hardware threads)\n");
+	printf("  -i, --info         print the header, the log summary and decoding statistics\n");
+	printf("  -n, --no-output    only decode, e.g. for benchmarking\n");
+}
+
+static void printInfo(const KbbLog &log) {
+	const KbbHeader &h = log.header;
+	printf("  version %d.%d.%d, started %u, duration %.3f s\n", h.version[0], h.version[1], h.version[2], h.startTime, h.duration / 1000.);
+	printf("  PID loop %u Hz, divider %d => %.1f frames/s, frame size %d bytes, SYNC every %d frames\n", h.pidFrequency, h.frequencyDivider, h.framesPerSecond(), h.frameSize, h.syncFrequency);
+	printf("  gyro range %d deg/s, accel range %d g, %d motor poles, disarm reason %d\n", h.gyroRange, h.accelRange, h.motorPoles, h.disarmReason);
+	printf("  fields:");
+	for (int bit = 0; bit < 64; bit++) {
+		if (!(h.flags & (1ULL << bit))) continue;
+		const char *name = kbbFlagName(bit);
+		if (name)
+			printf(" %s", name + 4);
+		else
+			printf(" UNKNOWN_%d", bit);
+	}
+	printf("\n");
+	const KbbSummary &s = h.summary;
+	if (s.valid) {
+		printf("  summary: max gyro %d/%d/%d deg/s, motor saturation %.2f%%, vbat min %.2f V avg %.2f V\n", s.maxGyro[0], s.maxGyro[1], s.maxGyro[2], s.motorSaturation / 100., s.minVbat / 100., s.avgVbat / 100.);
+		printf("           loop %.2f us (jitter %.2f us), %u dropped, peak I %d, flight time %.1f s, %u frames\n", s.avgLoopTime / 100., s.loopJitter / 100., s.droppedFrames, s.peakITerm, s.flightTime / 1000., s.frames);
+	}
+	const KbbDecodeStats &st = log.stats;
+	printf("  decoded %zu frames in %u segments, %u SYNCs, %u resyncs (%zu bytes skipped), %u frames missing, %zu trailing bytes trimmed\n", log.frames.rowCount, st.segments, st.syncs, st.resyncs, st.skippedBytes, st.missingFrames, st.trimmedBytes);
+	for (auto &t : log.events)
+		if (t.rowCount) printf("  %zu %s\n", t.rowCount, t.name.c_str());
+}
+
+static std::string outputBase(const std::string &path, const std::string &outDir) {
+	std::string base = path;
+	size_t dot = base.find_last_of('.');
+	size_t slash = base.find_last_of("/\\");
+	if (dot != std::string::npos && (slash == std::string::npos || dot > slash)) base.resize(dot);
+	if (outDir.empty()) return base;
+	std::string name = slash == std::string::npos ? base : base.substr(slash + 1);
+	char last = outDir.back();
+	return outDir + (last == '/' || last == '\\' ? "" : "/") + name;
+}
+
+int main(int argc, char **argv) {
+	bool csv = false, binary = false, raw = false, info = false, noOutput = false;
+	u32 threads = 0;
+	std::string outDir;
+	std::vector<std::string> files;
+
+	for (int i = 1; i < argc; i++) {
+		std::string a = argv[i];
+		if (a == "-c" || a == "--csv")
+			csv = true;
+		else if (a == "-b" || a == "--binary")
+			binary = true;
+		else if (a == "-r" || a == "--raw")
+			raw = true;
+		else if (a == "-i" || a == "--info")
+			info = true;
+		else if (a == "-n" || a == "--no-output")
+			noOutput = true;
+		else if ((a == "-o" || a == "--out") && i + 1 < argc)
+			outDir = argv[++i];
+		else if ((a == "-j" || a == "--threads") && i + 1 < argc)
+			threads = atoi(argv[++i]);
+		else if (a == "-h" || a == "--help") {
+			printUsage(argv[0]);
+			return 0;
+		} else if (a[0] == '-') {
+			fprintf(stderr, "Unknown option %s\n", a.c_str());
+			printUsage(argv[0]);
+			return 1;
+		} else
+			files.push_back(a);
+	}
+	if (files.empty()) {
+		printUsage(argv[0]);
+		return 1;
+	}
+	if (!csv && !binary) csv = true;
+	if (noOutput) csv = binary = false;
+
+	// many files: one file per thread, few files: split the threads among them
+	threads = kbbThreadCount(threads);
+	u32 fileThreads = threads < files.size() ? threads : files.size();
+	u32 threadsPerFile = threads / fileThreads;
+
+	std::mutex printMutex;
+	int failed = 0;
+	kbbParallelFor(files.size(), fileThreads, [&](size_t i) {
+		const std::string &path = files[i];
+		std::string error;
+		KbbLog log;
+		auto start = std::chrono::steady_clock::now();
+		bool ok = kbbDecodeFile(path, log, threadsPerFile, error);
+		auto decoded = std::chrono::steady_clock::now();
+		std::string base = outputBase(path, outDir);
+		if (ok && csv) ok = kbbWriteCsv(log, base, raw, threadsPerFile, error);
+		if (ok && binary) ok = kbbWriteColumnar(log, base + ".kbc", error);
+		auto done = std::chrono::steady_clock::now();
+
+		std::lock_guard<std::mutex> lock(printMutex);
+		if (!ok) {
+			fprintf(stderr, "%s: %s\n", path.c_str(), error.c_str());
+			failed++;
+			return;
+		}
+		f64 decodeTime = std::chrono::duration<f64>(decoded - start).count();
+		f64 exportTime = std::chrono::duration<f64>(done - decoded).count();
+		printf("%s: %zu frames, %.1f MB decoded in %.3f s", path.c_str(), log.frames.rowCount, log.stats.fileSize / 1e6, decodeTime);
+		if (csv || binary) printf(", exported in %.3f s", exportTime);
+		if (log.stats.resyncs) printf(", %u resyncs", log.stats.resyncs);
+		printf("\n");
+		if (info) printInfo(log);
+	});
+	return failed ? 2 : 0;
+}
@@ -0,0 +1,414 @@
+/**
+ * @file test_main.cpp
+ * @brief Round trip of log headers and frames through the decoder, run with ctest --test-dir build
+ *
+ * Copyright (c) 2026 Kolibri-FC contributors
+ *
+ * This file is part of Kolibri-FC (https://github.com/bastian2001/Kolibri-FC).
+ *
+ * Kolibri-FC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Kolibri-FC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Kolibri-FC. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "kbb.h"
+#include <cstdio>
+
+// header offsets, same as the LOG_HEAD_ defines in Firmware/src/blackbox.h
+#define LOG_HEAD_BB_VERSION 8
+#define LOG_HEAD_TIMESTAMP 11
+#define LOG_HEAD_DURATION 15
+#define LOG_HEAD_PID_FREQ 19
+#define LOG_HEAD_LOOP_DIV 20
+#define LOG_HEAD_GYRO_ACCEL_RANGE 21
+#define LOG_HEAD_RATE_COEFFS 22
+#define LOG_HEAD_PID_GAINS 82
+#define LOG_HEAD_LOGGED_FIELDS 142
+#define LOG_HEAD_MOTOR_POLES 150
+#define LOG_HEAD_DISARM_REASON 151
+#define LOG_HEAD_SYNC_FREQ 152
+#define LOG_HEAD_FRAMESIZE 153
+#define LOG_HEAD_SUMMARY 160
+
+// the fields of the test log, packed by the FC as debug1 (4 bytes), setpointRoll and motors (2 byte aligned), baro (1 byte aligned)
+#define TEST_FLAGS (1ULL << 40 | 1ULL << 1 | 1ULL << 23 | 1ULL << 39)
+#define TEST_FRAMESIZE 15
+
+static int failures = 0;
+static int checks = 0;
+
+#define CHECK(cond)                                                                  \
+	do {                                                                             \
+		checks++;                                                                    \
+		if (!(cond)) {                                                               \
+			fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+			failures++;                                                              \
+		}                                                                            \
+	} while (0)
+
+#define CHECK_EQ(expected, actual)                                                                                                  \
+	do {                                                                                                                            \
+		checks++;                                                                                                                   \
+		const i64 exp_ = (i64)(expected), act_ = (i64)(actual);                                                                     \
+		if (exp_ != act_) {                                                                                                         \
+			fprintf(stderr, "%s:%d: %s: expected %lld, got %lld\n", __FILE__, __LINE__, #actual, (long long)exp_, (long long)act_); \
+			failures++;                                                                                                             \
+		}                                                                                                                           \
+	} while (0)
+
+template <typename T>
+static void put(u8 *p, T v) { memcpy(p, &v, sizeof(T)); }
+
+/**
+ * @brief writes a header the way startLogging() and endLogging() lay it out
+ *
+ * @details the inverse of kbbParseHeader(), gyro and accel range are given as the index that the FC stores
+ */
+static void encodeHeader(const KbbHeader &h, u8 gyroRangeIndex, u8 accelRangeIndex, u8 *out) {
+	memset(out, 0, KBB_HEADER_SIZE);
+	put<u64>(out, KBB_MAGIC);
+	memcpy(&out[LOG_HEAD_BB_VERSION], h.version, 3);
+	put<u32>(&out[LOG_HEAD_TIMESTAMP], h.startTime);
+	put<u32>(&out[LOG_HEAD_DURATION], h.duration);
+	out[LOG_HEAD_PID_FREQ] = 16000 / h.pidFrequency - 1;
+	out[LOG_HEAD_LOOP_DIV] = h.frequencyDivider;
+	out[LOG_HEAD_GYRO_ACCEL_RANGE] = gyroRangeIndex << 2 | accelRangeIndex;
+	for (int ax = 0; ax < 3; ax++)
+		for (int i = 0; i < 3; i++)
+			put<i32>(&out[LOG_HEAD_RATE_COEFFS + ax * 12 + i * 4], h.rateCoeffs[ax][i] * 65536);
+	for (int ax = 0; ax < 3; ax++)
+		for (int i = 0; i < 5; i++)
+			put<u16>(&out[LOG_HEAD_PID_GAINS + ax * 10 + i * 2], h.pidGains[ax][i]);
+	put<u64>(&out[LOG_HEAD_LOGGED_FIELDS], h.flags);
+	out[LOG_HEAD_MOTOR_POLES] = h.motorPoles;
+	out[LOG_HEAD_DISARM_REASON] = h.disarmReason;
+	out[LOG_HEAD_SYNC_FREQ] = h.syncFrequency;
+	out[LOG_HEAD_FRAMESIZE] = h.frameSize;
+
+	const KbbSummary &s = h.summary;
+	u8 *sum = &out[LOG_HEAD_SUMMARY];
+	if (!s.valid) return;
+	sum[0] = 1;
+	for (int ax = 0; ax < 3; ax++) put<u16>(&sum[2 + ax * 2], s.maxGyro[ax]);
+	put<u16>(&sum[8], s.motorSaturation);
+	put<u16>(&sum[10], s.minVbat);
+	put<u16>(&sum[12], s.avgVbat);
+	put<u16>(&sum[14], s.avgLoopTime);
+	put<u16>(&sum[16], s.loopJitter);
+	put<u32>(&sum[18], s.droppedFrames);
+	put<u16>(&sum[22], s.peakITerm);
+	put<u32>(&sum[24], s.flightTime);
+	put<u32>(&sum[28], s.frames);
+}
+
+static KbbHeader makeHeader() {
+	KbbHeader h;
+	h.version[0] = 0;
+	h.version[1] = 0;
+	h.version[2] = 1;
+	h.startTime = 1792396800;
+	h.duration = 12345;
+	h.pidFrequency = 3200;
+	h.frequencyDivider = 2;
+	h.gyroRange = 2000;
+	h.accelRange = 16;
+	// exactly representable in 16.16 fixed point
+	const f64 rates[3][3] = {{200, 670.5, 0.25}, {200, 670.5, 0.25}, {180.75, 500, 0.125}};
+	memcpy(h.rateCoeffs, rates, sizeof(rates));
+	for (int ax = 0; ax < 3; ax++)
+		for (int i = 0; i < 5; i++)
+			h.pidGains[ax][i] = 1000 + ax * 100 + i * 7;
+	h.flags = TEST_FLAGS;
+	h.motorPoles = 14;
+	h.disarmReason = 3;
+	h.syncFrequency = 4;
+	h.frameSize = TEST_FRAMESIZE;
+	KbbSummary &s = h.summary;
+	s.valid = true;
+	s.maxGyro[0] = 1234;
+	s.maxGyro[1] = 987;
+	s.maxGyro[2] = 456;
+	s.motorSaturation = 1250;
+	s.minVbat = 1432;
+	s.avgVbat = 1580;
+	s.avgLoopTime = 31250;
+	s.loopJitter = 42;
+	s.droppedFrames = 70000;
+	s.peakITerm = 3210;
+	s.flightTime = 98765;
+	s.frames = 5000000;
+	return h;
+}
+
+static void checkHeader(const KbbHeader &e, const KbbHeader &a) {
+	for (int i = 0; i < 3; i++) CHECK_EQ(e.version[i], a.version[i]);
+	CHECK_EQ(e.startTime, a.startTime);
+	CHECK_EQ(e.duration, a.duration);
+	CHECK_EQ(e.pidFrequency, a.pidFrequency);
+	CHECK_EQ(e.frequencyDivider, a.frequencyDivider);
+	CHECK_EQ(e.gyroRange, a.gyroRange);
+	CHECK_EQ(e.accelRange, a.accelRange);
+	for (int ax = 0; ax < 3; ax++)
+		for (int i = 0; i < 3; i++)
+			CHECK(e.rateCoeffs[ax][i] == a.rateCoeffs[ax][i]);
+	for (int ax = 0; ax < 3; ax++)
+		for (int i = 0; i < 5; i++)
+			CHECK_EQ(e.pidGains[ax][i], a.pidGains[ax][i]);
+	CHECK(e.flags == a.flags);
+	CHECK_EQ(e.motorPoles, a.motorPoles);
+	CHECK_EQ(e.disarmReason, a.disarmReason);
+	CHECK_EQ(e.syncFrequency, a.syncFrequency);
+	CHECK_EQ(e.frameSize, a.frameSize);
+	const KbbSummary &es = e.summary, &as = a.summary;
+	CHECK_EQ(es.valid, as.valid);
+	for (int ax = 0; ax < 3; ax++) CHECK_EQ(es.maxGyro[ax], as.maxGyro[ax]);
+	CHECK_EQ(es.motorSaturation, as.motorSaturation);
+	CHECK_EQ(es.minVbat, as.minVbat);
+	CHECK_EQ(es.avgVbat, as.avgVbat);
+	CHECK_EQ(es.avgLoopTime, as.avgLoopTime);
+	CHECK_EQ(es.loopJitter, as.loopJitter);
+	CHECK_EQ(es.droppedFrames, as.droppedFrames);
+	CHECK_EQ(es.peakITerm, as.peakITerm);
+	CHECK_EQ(es.flightTime, as.flightTime);
+	CHECK_EQ(es.frames, as.frames);
+}
+
+/// @brief appends a payload with every SYN escaped as SYN!, like writeToBlackboxWithEscape()
+static void writeEscaped(std::vector<u8> &out, const u8 *buf, size_t len) {
+	for (size_t i = 0; i < len; i++) {
+		out.push_back(buf[i]);
+		if (i + 2 < len && buf[i] == 'S' && buf[i + 1] == 'Y' && buf[i + 2] == 'N') {
+			out.push_back('Y');
+			out.push_back('N');
+			out.push_back('!');
+			i += 2;
+		}
+	}
+}
+
+// values of frame n, debug1 of frame 5 contains a SYN that has to be escaped
+static i32 debug1Of(u32 n) { return n == 5 ? 0x004E5953 : (i32)n * 100003 - 500000; }
+static i16 setpointOf(u32 n) { return n * 37 - 200; }
+static u16 motorOf(u32 n, u8 m) { return (n * 211 + m * 1000) & 0xFFF; }
+static u32 baroOf(u32 n) { return 0x3F0000 + n * 5; }
+
+static void writeFrame(std::vector<u8> &out, u32 n) {
+	u8 f[TEST_FRAMESIZE];
+	put<i32>(&f[0], debug1Of(n));
+	put<i16>(&f[4], setpointOf(n));
+	u64 motors = 0;
+	for (u8 m = 0; m < 4; m++) motors |= (u64)motorOf(n, m) << (m * 12);
+	memcpy(&f[6], &motors, 6);
+	const u32 baro = baroOf(n);
+	memcpy(&f[12], &baro, 3);
+	out.push_back(KBB_FRAME_NORMAL);
+	writeEscaped(out, f, TEST_FRAMESIZE);
+}
+
+static void writeSync(std::vector<u8> &out, u32 frameNum, u32 &lastSyncPos) {
+	const u32 pos = out.size();
+	out.insert(out.end(), {'S', 'Y', 'N', 'C'});
+	u8 buf[KBB_PAYLOAD_SYNC] = {};
+	put<u32>(&buf[1], frameNum);
+	put<u32>(&buf[5], lastSyncPos);
+	lastSyncPos = pos;
+	writeEscaped(out, buf, KBB_PAYLOAD_SYNC);
+}
+
+/**
+ * @brief a log as the FC writes it: header, flight mode, then frames with a SYNC in front of every syncFrequency-th frame
+ *
+ * @param frames number of normal frames
+ * @param vbatAt a VBAT event is written in front of this frame
+ * @param framePos if set, receives the file position of every normal frame
+ */
+static std::vector<u8> makeLog(const KbbHeader &h, u32 frames, u32 vbatAt, std::vector<size_t> *framePos = nullptr) {
+	std::vector<u8> log(KBB_HEADER_SIZE);
+	encodeHeader(h, 0, 3, log.data());
+	log.push_back(KBB_FRAME_FLIGHTMODE);
+	log.push_back(2);
+	u32 lastSyncPos = 0;
+	for (u32 n = 0; n < frames; n++) {
+		if (n == vbatAt) {
+			log.push_back(KBB_FRAME_VBAT);
+			log.push_back(1620 & 0xFF);
+			log.push_back(1620 >> 8);
+		}
+		if (n % h.syncFrequency == 0) writeSync(log, n, lastSyncPos);
+		if (framePos) framePos->push_back(log.size());
+		writeFrame(log, n);
+	}
+	return log;
+}
+
+static void checkFrames(const KbbLog &log, u32 first, u32 count) {
+	const KbbTable &t = log.frames;
+	const KbbColumn *frame = t.column("frame");
+	const KbbColumn *debug1 = t.column("debug1");
+	const KbbColumn *setpoint = t.column("setpointRoll");
+	const KbbColumn *motorFL = t.column("motorFL");
+	const KbbColumn *baro = t.column("baro");
+	CHECK(frame && debug1 && setpoint && motorFL && baro);
+	if (!frame || !debug1 || !setpoint || !motorFL || !baro) return;
+	for (u32 i = 0; i < count && i < t.rowCount; i++) {
+		const u32 n = frame->values<u32>()[first + i];
+		CHECK_EQ(debug1Of(n), debug1->raw(first + i));
+		CHECK_EQ(setpointOf(n), setpoint->raw(first + i));
+		CHECK_EQ(motorOf(n, 3), motorFL->raw(first + i));
+		CHECK_EQ(baroOf(n), baro->raw(first + i));
+	}
+}
+
+void test_header_round_trip() {
+	const KbbHeader h = makeHeader();
+	u8 buf[KBB_HEADER_SIZE];
+	encodeHeader(h, 0, 3, buf);
+	KbbHeader parsed;
+	std::string error;
+	CHECK(kbbParseHeader(buf, parsed, error));
+	checkHeader(h, parsed);
+	CHECK(parsed.framesPerSecond() == 1600);
+}
+
+void test_header_ranges() {
+	// every gyro and accel range index the FC can store
+	const u16 gyro[] = {2000, 1000, 500, 250, 125};
+	const u8 accel[] = {2, 4, 8, 16};
+	for (u8 g = 0; g < 5; g++) {
+		for (u8 a = 0; a < 4; a++) {
+			KbbHeader h = makeHeader();
+			h.gyroRange = gyro[g];
+			h.accelRange = accel[a];
+			u8 buf[KBB_HEADER_SIZE];
+			encodeHeader(h, g, a, buf);
+			KbbHeader parsed;
+			std::string error;
+			CHECK(kbbParseHeader(buf, parsed, error));
+			CHECK_EQ(h.gyroRange, parsed.gyroRange);
+			CHECK_EQ(h.accelRange, parsed.accelRange);
+		}
+	}
+}
+
+void test_header_without_summary() {
+	// log that was not closed properly: no duration, no disarm reason, no summary
+	KbbHeader h = makeHeader();
+	h.duration = 0;
+	h.disarmReason = 0;
+	h.summary = KbbSummary();
+	u8 buf[KBB_HEADER_SIZE];
+	encodeHeader(h, 0, 3, buf);
+	KbbHeader parsed;
+	std::string error;
+	CHECK(kbbParseHeader(buf, parsed, error));
+	checkHeader(h, parsed);
+
+	// unknown summary version: ignored as a whole
+	buf[LOG_HEAD_SUMMARY] = 2;
+	buf[LOG_HEAD_SUMMARY + 2] = 0x55;
+	CHECK(kbbParseHeader(buf, parsed, error));
+	CHECK(!parsed.summary.valid);
+	CHECK_EQ(0, parsed.summary.maxGyro[0]);
+}
+
+void test_header_bad_magic() {
+	const KbbHeader h = makeHeader();
+	u8 buf[KBB_HEADER_SIZE];
+	encodeHeader(h, 0, 3, buf);
+	buf[5] ^= 1;
+	KbbHeader parsed;
+	std::string error;
+	CHECK(!kbbParseHeader(buf, parsed, error));
+	CHECK(!error.empty());
+}
+
+void test_log_round_trip() {
+	const KbbHeader h = makeHeader();
+	std::vector<u8> data = makeLog(h, 50, 17);
+	KbbLog log;
+	std::string error;
+	CHECK(kbbDecode(data.data(), data.size(), log, 2, error));
+	checkHeader(h, log.header);
+	CHECK(!memcmp(log.rawHeader, data.data(), KBB_HEADER_SIZE));
+	CHECK_EQ(50, log.frames.rowCount);
+	for (u32 i = 0; i < log.frames.rowCount; i++) CHECK_EQ(i, log.frames.column("frame")->values<u32>()[i]);
+	checkFrames(log, 0, 50);
+	CHECK_EQ(13, log.stats.syncs);
+	CHECK_EQ(0, log.stats.resyncs);
+	CHECK_EQ(0, log.stats.missingFrames);
+
+	const KbbTable *fm = log.event("flightModes");
+	CHECK(fm && fm->rowCount == 1);
+	if (fm && fm->rowCount == 1) CHECK_EQ(2, fm->column("mode")->raw(0));
+	const KbbTable *vbat = log.event("vbat");
+	CHECK(vbat && vbat->rowCount == 1);
+	if (vbat && vbat->rowCount == 1) {
+		CHECK_EQ(17, vbat->column("frame")->raw(0));
+		CHECK(vbat->column("vbat")->value(0) == 1620 * 0.01);
+	}
+}
+
+void test_log_frame_size_mismatch() {
+	KbbHeader h = makeHeader();
+	h.frameSize = TEST_FRAMESIZE + 1;
+	std::vector<u8> data = makeLog(h, 8, 100);
+	KbbLog log;
+	std::string error;
+	CHECK(!kbbDecode(data.data(), data.size(), log, 1, error));
+	CHECK(error.find("frame size") != std::string::npos);
+}
+
+void test_log_unclosed_and_corrupted() {
+	// not closed properly: preallocated zeros at the end are trimmed
+	KbbHeader h = makeHeader();
+	h.duration = 0;
+	h.summary = KbbSummary();
+	std::vector<size_t> framePos;
+	std::vector<u8> data = makeLog(h, 20, 100, &framePos);
+	// frame 9 gets an invalid frame type, the decoder continues at the SYNC in front of frame 12
+	const size_t pos = framePos[9];
+	data[pos] = 0xEE;
+	data.resize(data.size() + 4096, 0);
+
+	KbbLog log;
+	std::string error;
+	CHECK(kbbDecode(data.data(), data.size(), log, 1, error));
+	CHECK_EQ(4096, log.stats.trimmedBytes);
+	CHECK_EQ(1, log.stats.resyncs);
+	CHECK_EQ(3, log.stats.missingFrames);
+	CHECK_EQ(17, log.frames.rowCount);
+	const KbbColumn *frame = log.frames.column("frame");
+	CHECK(frame && log.frames.rowCount == 17);
+	if (!frame || log.frames.rowCount != 17) return;
+	CHECK_EQ(8, frame->raw(8));
+	CHECK_EQ(12, frame->raw(9));
+	checkFrames(log, 0, log.frames.rowCount);
+}
+
+#define RUN_TEST(fn)                                                   \
+	do {                                                               \
+		const int before = failures;                                   \
+		fn();                                                          \
+		printf("%s: %s\n", #fn, failures == before ? "PASS" : "FAIL"); \
+	} while (0)
+
+int main() {
+	RUN_TEST(test_header_round_trip);
+	RUN_TEST(test_header_ranges);
+	RUN_TEST(test_header_without_summary);
+	RUN_TEST(test_header_bad_magic);
+	RUN_TEST(test_log_round_trip);
+	RUN_TEST(test_log_frame_size_mismatch);
+	RUN_TEST(test_log_unclosed_and_corrupted);
+	printf("%d checks, %d failures\n", checks, failures);
+	return failures ? 1 : 0;
+}